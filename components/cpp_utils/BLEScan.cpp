@@ -200,7 +200,7 @@ void BLEScan::setWindow(uint16_t windowMSecs) {
 bool BLEScan::start(uint32_t duration, void (*scanCompleteCB)(BLEScanResults), bool is_continue) {
 	ESP_LOGD(LOG_TAG, ">> start(duration=%d)", duration);
 
-	m_semaphoreScanEnd.take(std::string("start"));
+	m_semaphoreScanEnd.take("start");
 	m_scanCompleteCB = scanCompleteCB;                  // Save the callback to be invoked when the scan completes.
 
 	//  if we are connecting to devices that are advertising even after being connected, multiconnecting peripherals
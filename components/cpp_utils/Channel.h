@@ -0,0 +1,340 @@
+/*
+ * Channel.h
+ *
+ * Typed, bounded queue to hand items from one or more producer tasks to a single consumer task.
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_CHANNEL_H_
+#define COMPONENTS_CPP_UTILS_CHANNEL_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#ifdef ESP_PLATFORM
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#define CHANNEL_ALIGNMENT 4    // The ESP32 has no cache lines to keep producer and consumer apart.
+#else
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#define CHANNEL_ALIGNMENT 64
+#endif
+
+/**
+ * @brief A bounded channel of items of type T.
+ *
+ * Items are constructed in place in a ring of N slots (N must be a power of two) and moved out by the
+ * consumer, so there is no allocation and no untyped copy like with Ringbuffer.  Every slot carries a
+ * sequence number, which makes sending and receiving lock free.  With MultiProducer set, producers
+ * claim slots with a compare and swap and any number of tasks may send.  Otherwise only a single task
+ * may send, which saves the compare and swap.  There is always a single consumer.
+ *
+ * The try* methods never block.  The other methods wait up to a timeout in milliseconds, 0 meaning
+ * not at all and WAIT_FOREVER meaning no limit.  On FreeRTOS a waiting consumer sleeps on its direct
+ * to task notification, so the consumer task should not use notifications for anything else.  A
+ * producer waiting for a full channel polls once per tick.  On a host the channel waits on a
+ * condition variable instead.
+ *
+ * @code{.cpp}
+ * static Channel<sample_t, 16> samples;
+ *
+ * // Producer task
+ * samples.tryEmplace(probe, temperature);
+ *
+ * // Consumer task
+ * sample_t batch[8];
+ * size_t count = samples.receive(batch, 8, 1000);
+ * @endcode
+ */
+template <typename T, size_t N, bool MultiProducer = false>
+class Channel {
+	static_assert(N >= 2 && (N & (N - 1)) == 0, "The capacity of a channel must be a power of two");
+
+public:
+	static const uint32_t WAIT_FOREVER = UINT32_MAX;
+
+	Channel() : m_tail(0), m_head(0), m_consumerWaiting(false) {
+		for (size_t i = 0; i < N; i++) {
+			m_slots[i].sequence.store(i, std::memory_order_relaxed);
+		}
+#ifdef ESP_PLATFORM
+		m_consumerTask = nullptr;
+#endif
+	} // Channel
+
+	~Channel() {
+		size_t position = m_head.load(std::memory_order_relaxed);
+		while (hasData(position)) {
+			reinterpret_cast<T*>(&m_slots[position & MASK].storage)->~T();
+			position++;
+		}
+	} // ~Channel
+
+	/**
+	 * @brief Construct an item in the next free slot.
+	 * @param [in] args The arguments for the constructor of T.
+	 * @return False if the channel is full.
+	 */
+	template <typename... Args>
+	bool tryEmplace(Args&&... args) {
+		size_t position;
+		if (!claim(position)) return false;
+		Slot& slot = m_slots[position & MASK];
+		new (&slot.storage) T(std::forward<Args>(args)...);
+		slot.sequence.store(position + 1, std::memory_order_release);
+		notifyConsumer();
+		return true;
+	} // tryEmplace
+
+	bool trySend(const T& item) {
+		return tryEmplace(item);
+	} // trySend
+
+	bool trySend(T&& item) {
+		return tryEmplace(std::move(item));
+	} // trySend
+
+	/**
+	 * @brief Send an item, waiting for a free slot if the channel is full.
+	 * @param [in] item The item to send.
+	 * @param [in] timeoutMs How long to wait for a free slot.
+	 * @return False if the channel stayed full.
+	 */
+	bool send(const T& item, uint32_t timeoutMs = WAIT_FOREVER) {
+		Deadline deadline(timeoutMs);
+		while (!tryEmplace(item)) {
+			if (!waitForSpace(deadline)) return false;
+		}
+		return true;
+	} // send
+
+	/**
+	 * @brief Send an item by moving it, waiting for a free slot if the channel is full.
+	 * The item is only moved from once a slot was claimed, so it is left intact on a timeout.
+	 */
+	bool send(T&& item, uint32_t timeoutMs = WAIT_FOREVER) {
+		Deadline deadline(timeoutMs);
+		while (!tryEmplace(std::move(item))) {
+			if (!waitForSpace(deadline)) return false;
+		}
+		return true;
+	} // send
+
+	/**
+	 * @brief Take the oldest item without waiting.
+	 * @param [out] item Receives the item.
+	 * @return False if the channel is empty.
+	 */
+	bool tryReceive(T& item) {
+		size_t position = m_head.load(std::memory_order_relaxed);
+		if (!hasData(position)) return false;
+		Slot& slot = m_slots[position & MASK];
+		T* pStored = reinterpret_cast<T*>(&slot.storage);
+		item = std::move(*pStored);
+		pStored->~T();
+		slot.sequence.store(position + N, std::memory_order_release);
+		m_head.store(position + 1, std::memory_order_relaxed);
+		return true;
+	} // tryReceive
+
+	/**
+	 * @brief Take the oldest item, waiting for one if the channel is empty.
+	 * @param [out] item Receives the item.
+	 * @param [in] timeoutMs How long to wait for an item.
+	 * @return False if no item arrived in time.
+	 */
+	bool receive(T& item, uint32_t timeoutMs = WAIT_FOREVER) {
+		Deadline deadline(timeoutMs);
+		while (!tryReceive(item)) {
+			if (!waitForData(deadline)) return false;
+		}
+		return true;
+	} // receive
+
+	/**
+	 * @brief Take up to maxItems of the oldest items at once.
+	 * Waits only until the first item is available, then takes whatever else is already queued.
+	 * @param [out] items Receives the items.
+	 * @param [in] maxItems The size of items.
+	 * @param [in] timeoutMs How long to wait for the first item.
+	 * @return The number of items received.
+	 */
+	size_t receive(T* items, size_t maxItems, uint32_t timeoutMs = 0) {
+		if (maxItems == 0 || !receive(items[0], timeoutMs)) return 0;
+		size_t count = 1;
+		while (count < maxItems && tryReceive(items[count])) {
+			count++;
+		}
+		return count;
+	} // receive
+
+	/**
+	 * @brief Get the number of queued items.  Only a snapshot while other tasks send or receive.
+	 */
+	size_t size() const {
+		size_t tail = m_tail.load(std::memory_order_acquire);
+		size_t head = m_head.load(std::memory_order_acquire);
+		return tail - head;
+	} // size
+
+	bool empty() const {
+		return size() == 0;
+	} // empty
+
+	static constexpr size_t capacity() {
+		return N;
+	} // capacity
+
+private:
+	static const size_t MASK = N - 1;
+
+	struct Slot {
+		std::atomic<size_t> sequence;   // position + 1 when filled, position + N when free again.
+		typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+	};
+
+	Slot m_slots[N];
+	alignas(CHANNEL_ALIGNMENT) std::atomic<size_t> m_tail;   // Next position to be claimed by a producer.
+	alignas(CHANNEL_ALIGNMENT) std::atomic<size_t> m_head;   // Next position to be read by the consumer.
+	std::atomic<bool> m_consumerWaiting;
+
+	Channel(const Channel&) = delete;
+	Channel& operator=(const Channel&) = delete;
+
+	/**
+	 * @brief Has the item at a position been published?
+	 * Unlike size() this does not count slots a producer claimed but is still filling.
+	 */
+	bool hasData(size_t position) const {
+		return m_slots[position & MASK].sequence.load(std::memory_order_acquire) == position + 1;
+	} // hasData
+
+	/**
+	 * @brief Claim the slot for the next item.
+	 * @param [out] position The position of the claimed slot.
+	 * @return False if the channel is full.
+	 */
+	bool claim(size_t& position) {
+		position = m_tail.load(std::memory_order_relaxed);
+		while (true) {
+			size_t sequence = m_slots[position & MASK].sequence.load(std::memory_order_acquire);
+			intptr_t difference = (intptr_t) (sequence - position);   // Stays right when the positions wrap.
+			if (difference < 0) return false;   // The consumer has not freed the slot yet.
+			if (difference == 0) {
+				if (!MultiProducer) {
+					m_tail.store(position + 1, std::memory_order_relaxed);
+					return true;
+				}
+				if (m_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+					return true;
+				}
+			} else {
+				position = m_tail.load(std::memory_order_relaxed);   // Another producer claimed it first.
+			}
+		}
+	} // claim
+
+#ifdef ESP_PLATFORM
+	TaskHandle_t m_consumerTask;
+
+	struct Deadline {
+		TickType_t start;
+		TickType_t ticks;
+		bool       forever;
+		Deadline(uint32_t timeoutMs) : start(xTaskGetTickCount()), ticks(pdMS_TO_TICKS(timeoutMs)), forever(timeoutMs == WAIT_FOREVER) {}
+		TickType_t remaining() const {
+			if (forever) return portMAX_DELAY;
+			TickType_t elapsed = xTaskGetTickCount() - start;
+			return elapsed < ticks ? ticks - elapsed : 0;
+		}
+	};
+
+	void notifyConsumer() {
+		std::atomic_thread_fence(std::memory_order_seq_cst);   // Order the published item before reading the flag.
+		if (m_consumerWaiting.load() && m_consumerWaiting.exchange(false)) {
+			xTaskNotifyGive(m_consumerTask);
+		}
+	} // notifyConsumer
+
+	bool waitForData(const Deadline& deadline) {
+		TickType_t remaining = deadline.remaining();
+		if (remaining == 0) return false;
+		m_consumerTask = xTaskGetCurrentTaskHandle();
+		m_consumerWaiting.store(true);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (!hasData(m_head.load(std::memory_order_relaxed))) {   // Check again, a producer may have sent before it could see the flag.
+			ulTaskNotifyTake(pdTRUE, remaining);
+		}
+		m_consumerWaiting.store(false);
+		return true;
+	} // waitForData
+
+	bool waitForSpace(const Deadline& deadline) {
+		if (deadline.remaining() == 0) return false;
+		vTaskDelay(1);
+		return true;
+	} // waitForSpace
+#else
+	std::mutex              m_mutex;
+	std::condition_variable m_dataAvailable;
+
+	struct Deadline {
+		std::chrono::steady_clock::time_point end;
+		bool forever;
+		Deadline(uint32_t timeoutMs) : end(std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs)), forever(timeoutMs == WAIT_FOREVER) {}
+		bool expired() const {
+			return !forever && std::chrono::steady_clock::now() >= end;
+		}
+	};
+
+	void notifyConsumer() {
+		std::atomic_thread_fence(std::memory_order_seq_cst);   // Order the published item before reading the flag.
+		if (m_consumerWaiting.load() && m_consumerWaiting.exchange(false)) {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_dataAvailable.notify_one();
+		}
+	} // notifyConsumer
+
+	bool waitForData(const Deadline& deadline) {
+		if (deadline.expired()) return false;
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_consumerWaiting.store(true);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (!hasData(m_head.load(std::memory_order_relaxed))) {   // Check again, a producer may have sent before it could see the flag.
+			if (deadline.forever) {
+				m_dataAvailable.wait(lock);
+			} else {
+				m_dataAvailable.wait_until(lock, deadline.end);
+			}
+		}
+		m_consumerWaiting.store(false);
+		return true;
+	} // waitForData
+
+	bool waitForSpace(const Deadline& deadline) {
+		if (deadline.expired()) return false;
+		std::this_thread::yield();
+		return true;
+	} // waitForSpace
+#endif
+}; // Channel
+
+
+/**
+ * @brief A channel any number of tasks may send to.
+ */
+template <typename T, size_t N>
+using MpscChannel = Channel<T, N, true>;
+
+/**
+ * @brief A channel a single task sends to.
+ */
+template <typename T, size_t N>
+using SpscChannel = Channel<T, N, false>;
+
+#endif /* COMPONENTS_CPP_UTILS_CHANNEL_H_ */
@@ -12,6 +12,8 @@
 #include <iomanip>
 #include "FreeRTOS.h"
 #include <esp_log.h>
+#include <esp_timer.h>
+#include <string.h>
 #include "sdkconfig.h"
 
 static const char* LOG_TAG = "FreeRTOS";
@@ -55,32 +57,32 @@ uint32_t FreeRTOS::getTimeSinceStart() {
 } // getTimeSinceStart
 
 
+// All semaphores, for diagnostics.  Only touched inside the critical section.
+static FreeRTOS::Semaphore* s_pFirstSemaphore = nullptr;
+static portMUX_TYPE         s_semaphoreMux    = portMUX_INITIALIZER_UNLOCKED;
+
+
 /**
  * @brief Wait for a semaphore to be released by trying to take it and
  * then releasing it again.
- * @param [in] owner A debug tag.
+ * @param [in] owner A debug tag.  Has to be a string literal or otherwise outlive the semaphore.
  * @return The value associated with the semaphore.
  */
-uint32_t FreeRTOS::Semaphore::wait(std::string owner) {
-	ESP_LOGV(LOG_TAG, ">> wait: Semaphore waiting: %s for %s", toString().c_str(), owner.c_str());
-
-	if (m_usePthreads) {
-		pthread_mutex_lock(&m_pthread_mutex);
-	} else {
-		xSemaphoreTake(m_semaphore, portMAX_DELAY);
-	}
+uint32_t FreeRTOS::Semaphore::wait(const char* owner) {
+	ESP_LOGV(LOG_TAG, ">> wait: Semaphore waiting: %s for %s", m_name.c_str(), owner);
 
-	m_owner = owner;
+	takeAndRecord(portMAX_DELAY, owner);
 
+	// Nothing of the semaphore is touched once it is given again, its owner may delete it right away.
+	uint32_t value = m_value;
+	m_owner = "<N/A>";
+	ESP_LOGV(LOG_TAG, "<< wait: Semaphore released: %s", m_name.c_str());
 	if (m_usePthreads) {
 		pthread_mutex_unlock(&m_pthread_mutex);
 	} else {
 		xSemaphoreGive(m_semaphore);
 	}
-
-	ESP_LOGV(LOG_TAG, "<< wait: Semaphore released: %s", toString().c_str());
-	m_owner = std::string("<N/A>");
-	return m_value;
+	return value;
 } // wait
 
 
@@ -93,12 +95,27 @@ FreeRTOS::Semaphore::Semaphore(std::string name) {
 	}
 
 	m_name      = name;
-	m_owner     = std::string("<N/A>");
+	m_owner     = "<N/A>";
 	m_value     = 0;
+	memset(&m_stats, 0, sizeof(m_stats));
+
+	portENTER_CRITICAL(&s_semaphoreMux);
+	m_pNext           = s_pFirstSemaphore;
+	s_pFirstSemaphore = this;
+	portEXIT_CRITICAL(&s_semaphoreMux);
 }
 
 
 FreeRTOS::Semaphore::~Semaphore() {
+	portENTER_CRITICAL(&s_semaphoreMux);
+	for (Semaphore** ppSemaphore = &s_pFirstSemaphore; *ppSemaphore != nullptr; ppSemaphore = &(*ppSemaphore)->m_pNext) {
+		if (*ppSemaphore == this) {
+			*ppSemaphore = m_pNext;
+			break;
+		}
+	}
+	portEXIT_CRITICAL(&s_semaphoreMux);
+
 	if (m_usePthreads) {
 		pthread_mutex_destroy(&m_pthread_mutex);
 	} else {
@@ -112,7 +129,8 @@ FreeRTOS::Semaphore::~Semaphore() {
  * The Semaphore is given.
  */
 void FreeRTOS::Semaphore::give() {
-	ESP_LOGV(LOG_TAG, "Semaphore giving: %s", toString().c_str());
+	ESP_LOGV(LOG_TAG, "Semaphore giving: %s", m_name.c_str());
+	m_owner = "<N/A>";   // Before giving, the task waiting for it may delete the semaphore right away.
 	if (m_usePthreads) {
 		pthread_mutex_unlock(&m_pthread_mutex);
 	} else {
@@ -121,8 +139,6 @@ void FreeRTOS::Semaphore::give() {
 // #ifdef ARDUINO_ARCH_ESP32
 // 	FreeRTOS::sleep(10);
 // #endif
-
-	m_owner = std::string("<N/A>");
 } // Semaphore::give
 
 
@@ -151,24 +167,69 @@ void FreeRTOS::Semaphore::giveFromISR() {
 
 
 /**
- * @brief Take a semaphore.
- * Take a semaphore and wait indefinitely.
- * @param [in] owner The new owner (for debugging)
+ * @brief Take the semaphore and update the statistics.
+ * The semaphore is first tried without waiting, so the clock is only read when there is contention.
+ * @param [in] ticks How long to wait.
+ * @param [in] owner The new owner (for debugging).
  * @return True if we took the semaphore.
  */
-bool FreeRTOS::Semaphore::take(std::string owner) {
-	ESP_LOGD(LOG_TAG, "Semaphore taking: %s for %s", toString().c_str(), owner.c_str());
-	bool rc = false;
+bool FreeRTOS::Semaphore::takeAndRecord(TickType_t ticks, const char* owner) {
+	bool rc;
+	bool contended = false;
+	uint32_t waitUs = 0;
 	if (m_usePthreads) {
-		pthread_mutex_lock(&m_pthread_mutex);
+		rc = pthread_mutex_trylock(&m_pthread_mutex) == 0;
+		if (!rc) {
+			contended = true;
+			int64_t start = esp_timer_get_time();
+			rc = pthread_mutex_lock(&m_pthread_mutex) == 0;   // We apparently don't have a timed wait for pthreads.
+			waitUs = esp_timer_get_time() - start;
+		}
+	} else {
+		rc = ::xSemaphoreTake(m_semaphore, 0) == pdTRUE;
+		if (!rc && ticks > 0) {
+			contended = true;
+			int64_t start = esp_timer_get_time();
+			rc = ::xSemaphoreTake(m_semaphore, ticks) == pdTRUE;
+			waitUs = esp_timer_get_time() - start;
+		}
+	}
+
+	portENTER_CRITICAL(&s_semaphoreMux);
+	if (rc) {
+		m_stats.takeCount++;
 	} else {
-		rc = ::xSemaphoreTake(m_semaphore, portMAX_DELAY) == pdTRUE;
+		m_stats.timeoutCount++;
+	}
+	if (contended) {
+		m_stats.contentionCount++;
+		m_stats.totalWaitUs += waitUs;
+		if (waitUs > m_stats.maxWaitUs) {
+			m_stats.maxWaitUs = waitUs;
+		}
+	}
+	portEXIT_CRITICAL(&s_semaphoreMux);
+
+	if (rc) {
+		m_owner = owner;
 	}
-	m_owner = owner;
+	return rc;
+} // takeAndRecord
+
+
+/**
+ * @brief Take a semaphore.
+ * Take a semaphore and wait indefinitely.
+ * @param [in] owner The new owner (for debugging).  Has to be a string literal or otherwise outlive the semaphore.
+ * @return True if we took the semaphore.
+ */
+bool FreeRTOS::Semaphore::take(const char* owner) {
+	ESP_LOGV(LOG_TAG, "Semaphore taking: %s for %s", m_name.c_str(), owner);
+	bool rc = takeAndRecord(portMAX_DELAY, owner);
 	if (rc) {
-		ESP_LOGD(LOG_TAG, "Semaphore taken:  %s", toString().c_str());
+		ESP_LOGV(LOG_TAG, "Semaphore taken:  %s", m_name.c_str());
 	} else {
-		ESP_LOGE(LOG_TAG, "Semaphore NOT taken:  %s", toString().c_str());
+		ESP_LOGE(LOG_TAG, "Semaphore NOT taken:  %s", m_name.c_str());
 	}
 	return rc;
 } // Semaphore::take
@@ -178,27 +239,67 @@ bool FreeRTOS::Semaphore::take(std::string owner) {
  * @brief Take a semaphore.
  * Take a semaphore but return if we haven't obtained it in the given period of milliseconds.
  * @param [in] timeoutMs Timeout in milliseconds.
- * @param [in] owner The new owner (for debugging)
+ * @param [in] owner The new owner (for debugging).  Has to be a string literal or otherwise outlive the semaphore.
  * @return True if we took the semaphore.
  */
-bool FreeRTOS::Semaphore::take(uint32_t timeoutMs, std::string owner) {
-	ESP_LOGV(LOG_TAG, "Semaphore taking: %s for %s", toString().c_str(), owner.c_str());
-	bool rc = false;
+bool FreeRTOS::Semaphore::take(uint32_t timeoutMs, const char* owner) {
+	ESP_LOGV(LOG_TAG, "Semaphore taking: %s for %s", m_name.c_str(), owner);
 	if (m_usePthreads) {
 		assert(false);  // We apparently don't have a timed wait for pthreads.
-	} else {
-		rc = ::xSemaphoreTake(m_semaphore, timeoutMs / portTICK_PERIOD_MS) == pdTRUE;
 	}
-	m_owner = owner;
+	bool rc = takeAndRecord(timeoutMs / portTICK_PERIOD_MS, owner);
 	if (rc) {
-		ESP_LOGV(LOG_TAG, "Semaphore taken:  %s", toString().c_str());
+		ESP_LOGV(LOG_TAG, "Semaphore taken:  %s", m_name.c_str());
 	} else {
-		ESP_LOGE(LOG_TAG, "Semaphore NOT taken:  %s", toString().c_str());
+		ESP_LOGE(LOG_TAG, "Semaphore NOT taken:  %s", m_name.c_str());
 	}
 	return rc;
 } // Semaphore::take
 
 
+/**
+ * @brief Get the tag of the current owner of the semaphore.
+ */
+const char* FreeRTOS::Semaphore::getOwner() {
+	return m_owner;
+} // getOwner
+
+
+/**
+ * @brief Get the usage counters of the semaphore.
+ */
+FreeRTOS::Semaphore::Stats FreeRTOS::Semaphore::getStats() {
+	portENTER_CRITICAL(&s_semaphoreMux);
+	Stats stats = m_stats;
+	portEXIT_CRITICAL(&s_semaphoreMux);
+	return stats;
+} // getStats
+
+
+/**
+ * @brief Take a snapshot of all semaphores for diagnostics.
+ * Nothing is allocated, the snapshot is copied into the array provided by the caller.
+ * @param [out] pInfos Receives one entry per semaphore.
+ * @param [in] maxInfos The size of pInfos.
+ * @return The number of semaphores, which may be more than maxInfos.
+ */
+size_t FreeRTOS::Semaphore::getAllInfo(Info* pInfos, size_t maxInfos) {
+	size_t count = 0;
+	portENTER_CRITICAL(&s_semaphoreMux);
+	for (Semaphore* pSemaphore = s_pFirstSemaphore; pSemaphore != nullptr; pSemaphore = pSemaphore->m_pNext) {
+		if (count < maxInfos) {
+			Info& info = pInfos[count];
+			strncpy(info.name, pSemaphore->m_name.c_str(), sizeof(info.name) - 1);
+			info.name[sizeof(info.name) - 1] = '\0';
+			info.owner = pSemaphore->m_owner;
+			info.stats = pSemaphore->m_stats;
+		}
+		count++;
+	}
+	portEXIT_CRITICAL(&s_semaphoreMux);
+	return count;
+} // getAllInfo
+
 
 /**
  * @brief Create a string representation of the semaphore.
@@ -206,7 +307,7 @@ bool FreeRTOS::Semaphore::take(uint32_t timeoutMs, std::string owner) {
  */
 std::string FreeRTOS::Semaphore::toString() {
 	std::stringstream stringStream;
-	stringStream << "name: "<< m_name << " (0x" << std::hex << std::setfill('0') << (uint32_t)m_semaphore << "), owner: " << m_owner;
+	stringStream << "name: "<< m_name << " (0x" << std::hex << std::setfill('0') << (uintptr_t)m_semaphore << "), owner: " << m_owner;
 	return stringStream.str();
 } // toString
 
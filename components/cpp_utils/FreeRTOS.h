@@ -30,25 +30,52 @@ public:
 
 	class Semaphore {
 	public:
+		/**
+		 * @brief Usage counters of a semaphore.
+		 */
+		struct Stats {
+			uint32_t takeCount;        // Number of successful takes.
+			uint32_t contentionCount;  // Number of takes that found the semaphore held and had to wait.
+			uint32_t timeoutCount;     // Number of takes that gave up waiting.
+			uint32_t maxWaitUs;        // Longest wait of a take.
+			uint64_t totalWaitUs;      // Sum of the waits of all takes.
+		};
+
+		/**
+		 * @brief Snapshot of a semaphore for diagnostics.
+		 */
+		struct Info {
+			char        name[24];
+			const char* owner;         // Tag of the last taker.
+			Stats       stats;
+		};
+
 		Semaphore(std::string owner = "<Unknown>");
 		~Semaphore();
 		void        give();
 		void        give(uint32_t value);
 		void        giveFromISR();
+		const char* getOwner();
+		Stats       getStats();
 		void        setName(std::string name);
-		bool        take(std::string owner = "<Unknown>");
-		bool        take(uint32_t timeoutMs, std::string owner = "<Unknown>");
+		bool        take(const char* owner = "<Unknown>");
+		bool        take(uint32_t timeoutMs, const char* owner = "<Unknown>");
 		std::string toString();
-		uint32_t	wait(std::string owner = "<Unknown>");
+		uint32_t	wait(const char* owner = "<Unknown>");
+
+		static size_t getAllInfo(Info* pInfos, size_t maxInfos);   // Snapshot of all semaphores.
 
 	private:
 		SemaphoreHandle_t m_semaphore;
 		pthread_mutex_t   m_pthread_mutex;
 		std::string       m_name;
-		std::string       m_owner;
+		const char*       m_owner;         // Tags are string literals, so taking never allocates.
 		uint32_t          m_value;
 		bool              m_usePthreads;
+		Stats             m_stats;
+		Semaphore*        m_pNext;         // Next semaphore in the list of all semaphores.
 
+		bool takeAndRecord(TickType_t ticks, const char* owner);
 	};
 };
 
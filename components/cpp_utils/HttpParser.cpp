@@ -10,6 +10,7 @@
 #include <cstdlib>
 #include "HttpParser.h"
 #include "HttpRequest.h"
+#include "HttpRequestParser.h"
 #include "GeneralUtils.h"
 
 #include <esp_log.h>
@@ -108,6 +109,8 @@ std::pair<std::string, std::string> parseHeader(std::string& line) {
 
 
 HttpParser::HttpParser() {
+	m_errorStatus = 0;
+	m_keepAlive   = false;
 }
 
 HttpParser::~HttpParser() {
@@ -191,41 +194,108 @@ bool HttpParser::hasHeader(const std::string& name) {
  * @param [in] s The socket from which to retrieve data.
  */
 void HttpParser::parse(Socket s) {
-	ESP_LOGD(LOG_TAG, ">> parse: socket: %s", s.toString().c_str());
-	std::string line;
-	line = s.readToDelim(lineTerminator);
-	parseRequestLine(line);
-	line = s.readToDelim(lineTerminator);
-	while (!line.empty()) {
-		m_headers.insert(parseHeader(line));
-		line = s.readToDelim(lineTerminator);
+	SocketReader reader(s);
+	parse(reader);
+} // parse
+
+
+/**
+ * @brief Parse the next request from a buffered socket reader.
+ * The request line and headers are parsed in place in the reader's buffer, so the whole head has to
+ * fit into it.  Data following the request, e.g. a pipelined request, stays in the reader.
+ * @param [in] reader The reader from which to retrieve data.
+ * @return True if a complete and valid request was read.
+ */
+bool HttpParser::parse(SocketReader& reader) {
+	ESP_LOGD(LOG_TAG, ">> parse: socket: %s", reader.getSocket().toString().c_str());
+	HttpRequestParser parser(reader.capacity());
+	HttpRequestParser::Result result;
+	while ((result = parser.parse((const char*) reader.data(), reader.available())) == HttpRequestParser::RESULT_INCOMPLETE) {
+		if (reader.fill() <= 0) {
+			ESP_LOGD(LOG_TAG, "<< parse: connection closed before the request was complete");
+			m_errorStatus = reader.available() > 0 ? 400 : 0;
+			return false;
+		}
+	}
+	if (result == HttpRequestParser::RESULT_ERROR) {
+		m_errorStatus = parser.getErrorStatus();
+		ESP_LOGD(LOG_TAG, "<< parse: invalid request, status %d", m_errorStatus);
+		return false;
 	}
-	// Only PUT and POST requests have a body
-	if (getMethod() != "POST" && getMethod() != "PUT") {
-		ESP_LOGD(LOG_TAG, "<< parse");
-		return;
+
+	m_method  = parser.getMethod().toString();
+	m_url     = parser.getPath().toString();
+	m_version = parser.getVersion().toString();
+	for (size_t i = 0; i < parser.getHeaderCount(); i++) {
+		std::string name = parser.getHeaderName(i).toString();
+		// We normalize the header name to be lower case.
+		GeneralUtils::toLower(name);
+		m_headers.insert(std::pair<std::string, std::string>(name, parser.getHeaderValue(i).toString()));
 	}
+	m_keepAlive     = parser.isKeepAlive();
+	int length      = parser.getContentLength();
+	reader.consume(parser.getHeadLength());
+	m_errorStatus   = 200;
 
 	// We have now parsed up to and including the separator ... we are now at the point where we
-	// want to read the body.  There are two stories here.  The first is that we know the exact length
-	// of the body or we read until we can't read anymore.
-	if (hasHeader(HttpRequest::HTTP_HEADER_CONTENT_LENGTH)) {
-		std::string val = getHeader(HttpRequest::HTTP_HEADER_CONTENT_LENGTH);
-		int length = std::atoi(val.c_str());
-		uint8_t data[length];
-		s.receive(data, length, true);
-		m_body = std::string((char*) data, length);
-	} else {
+	// want to read the body.  Any request with a Content-Length has a body of that length, whatever
+	// its method, and it has to be read completely or the rest of it would be taken for the next
+	// request on the connection.  Transfer-Encoding was already rejected by the parser.
+	if (length >= 0) {
+		if ((size_t) length > MAX_BODY_SIZE) {
+			ESP_LOGW(LOG_TAG, "<< parse: body of %d bytes is larger than %d", length, MAX_BODY_SIZE);
+			m_errorStatus = 413;
+			m_keepAlive   = false;
+			return false;
+		}
+		m_body.resize(length);
+		int rc = length > 0 ? reader.read((uint8_t*) &m_body[0], length, true) : 0;
+		if (rc != length) {
+			ESP_LOGD(LOG_TAG, "<< parse: connection closed after %d of %d body bytes", rc, length);
+			m_body.clear();
+			m_errorStatus = 400;
+			m_keepAlive   = false;
+			return false;
+		}
+	} else if (getMethod() == "POST" || getMethod() == "PUT") {
+		// Without a length, we read what is available, which also means the connection can't be kept alive.
 		uint8_t data[512];
-		int rc = s.receive(data, sizeof(data));
+		int rc = reader.read(data, sizeof(data));
 		if (rc > 0) {
 			m_body = std::string((char*) data, rc);
 		}
+		m_keepAlive = false;
 	}
 	ESP_LOGD(LOG_TAG, "<< parse: Size of body: %d", m_body.length());
+	return true;
 } // parse
 
 
+/**
+ * @brief Get the status code a failed parse should be answered with.
+ * @return 200 for a valid request, 0 if the connection was closed without a request.
+ */
+int HttpParser::getErrorStatus() {
+	return m_errorStatus;
+} // getErrorStatus
+
+
+/**
+ * @brief Should the connection stay open for further requests?
+ */
+bool HttpParser::isKeepAlive() {
+	return m_keepAlive;
+} // isKeepAlive
+
+
+/**
+ * @brief Was a complete and valid request parsed?
+ */
+bool HttpParser::isValid() {
+	return m_errorStatus == 200;
+} // isValid
+
+
 /**
  * @brief Parse a string message.
  * @param [in] message The HTTP message to parse.
@@ -10,9 +10,12 @@
 #include <string>
 #include <map>
 #include "Socket.h"
+#include "SocketReader.h"
 
 class HttpParser {
 public:
+	static const size_t MAX_BODY_SIZE = 16 * 1024;
+
 	HttpParser();
 	virtual ~HttpParser();
 	std::string getBody();
@@ -23,9 +26,13 @@ public:
 	std::string getVersion();
 	std::string getStatus();
 	std::string getReason();
+	int getErrorStatus();
+	bool isKeepAlive();
+	bool isValid();
 	bool hasHeader(const std::string& name);
 	void parse(std::string message);
 	void parse(Socket s);
+	bool parse(SocketReader& reader);
 	void parseResponse(std::string message);
 
 private:
@@ -36,6 +43,8 @@ private:
 	std::string m_status;
 	std::string m_reason;
 	std::map<std::string, std::string> m_headers;
+	int         m_errorStatus;
+	bool        m_keepAlive;
 	void dump();
 	void parseRequestLine(std::string& line);
 	void parseStatusLine(std::string& line);
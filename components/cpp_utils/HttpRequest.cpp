@@ -98,6 +98,34 @@ HttpRequest::HttpRequest(Socket clientSocket) {
 	m_isClosed     = false;
 
 	m_parser.parse(clientSocket); // Parse the socket stream to build the HTTP data.
+	checkWebSocketUpgrade();
+} // HttpRequest
+
+
+/**
+ * @brief Create an HTTP Request instance from a connection that may carry more than one request.
+ *
+ * Only the bytes of this request are consumed from the reader.  Anything the client pipelined after
+ * it stays buffered for the next request on the same connection.
+ *
+ * @param [in] clientSocket The socket connected to the client.
+ * @param [in] reader The buffered reader of the connection.
+ */
+HttpRequest::HttpRequest(Socket clientSocket, SocketReader& reader) {
+	m_clientSocket = clientSocket;
+	m_pWebSocket   = nullptr;
+	m_isClosed     = false;
+
+	m_parser.parse(reader);
+	checkWebSocketUpgrade();
+} // HttpRequest
+
+
+/**
+ * @brief Answer the WebSocket handshake if the request asks for an upgrade.
+ */
+void HttpRequest::checkWebSocketUpgrade() {
+	if (!isValid()) return;
 
 	// We have to take some special action on the Connection header.  We want to know if it contains "Upgrade"
 	// however it has come to light that the Connection header can contain multiple parts.  For example, it has
@@ -133,9 +161,9 @@ HttpRequest::HttpRequest(Socket clientSocket) {
 		response.sendData("");
 
 		// Now that we have converted the request into a WebSocket, create the new WebSocket entry.
-		m_pWebSocket = new WebSocket(clientSocket);
+		m_pWebSocket = new WebSocket(m_clientSocket);
 	} // if this is a web socket ...
-} // HttpRequest
+} // checkWebSocketUpgrade
 
 
 HttpRequest::~HttpRequest() {
@@ -168,6 +196,34 @@ void HttpRequest::dump() {
 } // dump
 
 
+/**
+ * @brief Get the status code to reject the request with if it could not be parsed.
+ * @return 200 for a valid request, 0 if the client closed the connection without sending a request.
+ */
+int HttpRequest::getErrorStatus() {
+	return m_parser.getErrorStatus();
+} // getErrorStatus
+
+
+/**
+ * @brief Determine if a complete and valid request was received.
+ */
+bool HttpRequest::isValid() {
+	return m_parser.isValid();
+} // isValid
+
+
+/**
+ * @brief Determine if the connection may be reused for another request once the response is complete.
+ *
+ * HTTP/1.1 connections are persistent unless the client asked to close them, HTTP/1.0 ones only if
+ * the client asked for keep-alive.  A connection that became a WebSocket is never reused for HTTP.
+ */
+bool HttpRequest::isKeepAlive() {
+	return !m_isClosed && !isWebsocket() && m_parser.isKeepAlive();
+} // isKeepAlive
+
+
 /**
  * @brief Get the body of the HttpRequest.
  */
@@ -201,6 +257,29 @@ std::string HttpRequest::getPath() {
 } // getPath
 
 
+/**
+ * @brief Get a value captured from the path by the route of the handler.
+ * For the route `/probes/:id` and the path `/probes/3`, getPathParam("id") returns "3".  A trailing
+ * wildcard is captured as "*".
+ * @param [in] name The name of the capture in the route pattern.
+ * @return The URL decoded value or an empty string if the route has no such capture.
+ */
+std::string HttpRequest::getPathParam(const std::string& name) {
+	int index = m_pathParams.indexOf(name);
+	if (index < 0) return "";
+	return urlDecode(m_pathParams.getValue(index, getPath()));
+} // getPathParam
+
+
+/**
+ * @brief Remember the values the matching route captured from the path.
+ * @param [in] params The captured values.
+ */
+void HttpRequest::setPathParams(const HttpRouteParams& params) {
+	m_pathParams = params;
+} // setPathParams
+
+
 /**
  * @brief Get the query part of the request.
  * The query is a set of name = value pairs.  The return is a map keyed by the name items.
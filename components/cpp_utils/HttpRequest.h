@@ -13,12 +13,14 @@
 #include "Socket.h"
 #include "WebSocket.h"
 #include "HttpParser.h"
+#include "HttpRouter.h"
 
 #undef close
 
 class HttpRequest {
 public:
 	HttpRequest(Socket s);
+	HttpRequest(Socket s, SocketReader& reader);
 	virtual ~HttpRequest();
 	static const char HTTP_HEADER_ACCEPT[];
 	static const char HTTP_HEADER_ALLOW[];
@@ -52,13 +54,18 @@ public:
 	std::map<std::string, std::string> getHeaders();                 // Get all the headers.
 	std::string                        getMethod();                  // Get the request method.
 	std::string                        getPath();                    // Get the request path.
+	std::string                        getPathParam(const std::string& name);  // Get a value captured by the route.
 	std::map<std::string, std::string> getQuery();                   // Get the query part of the request.
 	Socket                             getSocket();                  // Get the underlying TCP/IP socket.
 	std::string                        getVersion();                 // Get the HTTP version.
 	WebSocket*                         getWebSocket();               // Get the WebSocket reference if this is a web socket.
+	int                                getErrorStatus();             // Status code to reject an invalid request with.
 	bool                               isClosed();                   // Has the connection been closed?
+	bool                               isKeepAlive();                // May the connection be reused after the response?
+	bool                               isValid();                    // Was a complete and valid request received?
 	bool                               isWebsocket();                // Is this request to create a web socket?
 	std::map<std::string, std::string> parseForm();                  // Parse the body as a form.
+	void                               setPathParams(const HttpRouteParams& params);
 	std::vector<std::string>           pathSplit();
 	std::string                        urlDecode(std::string str);   // Decode a URL.
 private:
@@ -66,6 +73,8 @@ private:
 	bool		m_isClosed;	 // Is the client connection closed?
 	HttpParser  m_parser;	   // The parse to parse HTTP data.
 	WebSocket*  m_pWebSocket;   // A possible reference to a WebSocket object instance.
+	HttpRouteParams m_pathParams;  // Values captured from the path by the matching route.
+	void        checkWebSocketUpgrade();
 
 };
 
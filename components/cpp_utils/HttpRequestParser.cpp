@@ -0,0 +1,313 @@
+/*
+ * HttpRequestParser.cpp
+ *
+ * Incremental, non-owning parser for the head of an HTTP/1.1 request.
+ */
+#include <string.h>
+#include <stdlib.h>
+#include "HttpRequestParser.h"
+
+
+static inline char toLowerChar(char c) {
+	return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+} // toLowerChar
+
+
+static inline bool isWhitespace(char c) {
+	return c == ' ' || c == '\t';
+} // isWhitespace
+
+
+bool HttpStringView::equals(const char* str) const {
+	return ::strlen(str) == length && ::memcmp(data, str, length) == 0;
+} // equals
+
+
+bool HttpStringView::equalsIgnoreCase(const char* str) const {
+	size_t i = 0;
+	for (; i < length; i++) {
+		if (str[i] == '\0' || toLowerChar(data[i]) != toLowerChar(str[i])) return false;
+	}
+	return str[i] == '\0';
+} // equalsIgnoreCase
+
+
+/**
+ * @brief Create a parser.
+ * @param [in] maxHeadSize The largest request line plus headers we accept.
+ */
+HttpRequestParser::HttpRequestParser(size_t maxHeadSize) {
+	// Spans store 16 bit offsets
+	m_maxHeadSize = maxHeadSize > UINT16_MAX ? UINT16_MAX : maxHeadSize;
+	reset();
+} // HttpRequestParser
+
+
+/**
+ * @brief Forget everything about the current request, e.g. to parse the next request on a keep-alive connection.
+ */
+void HttpRequestParser::reset() {
+	m_buffer      = nullptr;
+	m_scanned     = 0;
+	m_headLength  = 0;
+	m_result      = RESULT_INCOMPLETE;
+	m_error       = ERROR_NONE;
+	m_method      = {0, 0};
+	m_path        = {0, 0};
+	m_version     = {0, 0};
+	m_headerCount = 0;
+} // reset
+
+
+HttpRequestParser::Result HttpRequestParser::fail(Error error) {
+	m_error  = error;
+	m_result = RESULT_ERROR;
+	return m_result;
+} // fail
+
+
+/**
+ * @brief Continue parsing with more data.
+ * @param [in] buffer The buffer holding the request, starting at the request line.  It has to contain
+ * the same data as the last call plus optionally more data at the end.
+ * @param [in] length The number of bytes in the buffer.
+ * @return RESULT_COMPLETE once the empty line after the headers was found.
+ */
+HttpRequestParser::Result HttpRequestParser::parse(const char* buffer, size_t length) {
+	m_buffer = buffer;
+	if (m_result != RESULT_INCOMPLETE) return m_result;
+
+	size_t limit = length < m_maxHeadSize ? length : m_maxHeadSize;
+	while (m_scanned < limit) {
+		const char* eol = (const char*) ::memchr(buffer + m_scanned, '\n', limit - m_scanned);
+		if (eol == nullptr) break;
+
+		size_t start = m_scanned;
+		size_t end   = eol - buffer;         // Points at the '\n'
+		m_scanned    = end + 1;
+		if (end > start && buffer[end - 1] == '\r') end--;
+
+		if (m_method.length == 0) {
+			// Robustness: ignore empty lines before the request line (RFC7230 3.5)
+			if (end == start) continue;
+			if (!parseRequestLine(start, end)) return m_result;
+			continue;
+		}
+		if (end == start) {
+			if (!validateFraming()) return m_result;
+			m_headLength = m_scanned;
+			m_result     = RESULT_COMPLETE;
+			return m_result;
+		}
+		if (!parseHeaderLine(start, end)) return m_result;
+	}
+
+	if (length >= m_maxHeadSize) {
+		return fail(m_method.length == 0 && m_scanned == 0 ? ERROR_URI_TOO_LONG : ERROR_HEADERS_TOO_LARGE);
+	}
+	return RESULT_INCOMPLETE;
+} // parse
+
+
+/**
+ * @brief Parse <method> <sp> <request-target> <sp> <HTTP-version>
+ */
+bool HttpRequestParser::parseRequestLine(size_t start, size_t end) {
+	const char* sp1 = (const char*) ::memchr(m_buffer + start, ' ', end - start);
+	if (sp1 == nullptr || sp1 == m_buffer + start) {
+		fail(ERROR_BAD_REQUEST);
+		return false;
+	}
+	size_t pathStart = sp1 - m_buffer + 1;
+	const char* sp2 = (const char*) ::memchr(m_buffer + pathStart, ' ', end - pathStart);
+	if (sp2 == nullptr || sp2 == m_buffer + pathStart) {
+		fail(ERROR_BAD_REQUEST);
+		return false;
+	}
+	size_t versionStart = sp2 - m_buffer + 1;
+
+	m_method  = {(uint16_t) start, (uint16_t) (sp1 - m_buffer - start)};
+	m_path    = {(uint16_t) pathStart, (uint16_t) (sp2 - m_buffer - pathStart)};
+	m_version = {(uint16_t) versionStart, (uint16_t) (end - versionStart)};
+
+	if (m_path.length > MAX_URL_LENGTH) {
+		fail(ERROR_URI_TOO_LONG);
+		return false;
+	}
+	HttpStringView version = view(m_version);
+	if (version.length != 8 || ::memcmp(version.data, "HTTP/1.", 7) != 0) {
+		fail(ERROR_VERSION_NOT_SUPPORTED);
+		return false;
+	}
+	return true;
+} // parseRequestLine
+
+
+/**
+ * @brief Parse <name> ":" <OWS> <value> <OWS>
+ */
+bool HttpRequestParser::parseHeaderLine(size_t start, size_t end) {
+	// Obsolete line folding is not supported (RFC7230 3.2.4)
+	if (isWhitespace(m_buffer[start])) {
+		fail(ERROR_BAD_REQUEST);
+		return false;
+	}
+	const char* colon = (const char*) ::memchr(m_buffer + start, ':', end - start);
+	if (colon == nullptr || colon == m_buffer + start || isWhitespace(colon[-1])) {
+		fail(ERROR_BAD_REQUEST);
+		return false;
+	}
+	if (m_headerCount >= MAX_HEADERS) {
+		fail(ERROR_TOO_MANY_HEADERS);
+		return false;
+	}
+	size_t nameEnd    = colon - m_buffer;
+	size_t valueStart = nameEnd + 1;
+	while (valueStart < end && isWhitespace(m_buffer[valueStart])) valueStart++;
+	size_t valueEnd = end;
+	while (valueEnd > valueStart && isWhitespace(m_buffer[valueEnd - 1])) valueEnd--;
+
+	m_headerNames[m_headerCount]  = {(uint16_t) start, (uint16_t) (nameEnd - start)};
+	m_headerValues[m_headerCount] = {(uint16_t) valueStart, (uint16_t) (valueEnd - valueStart)};
+	m_headerCount++;
+	return true;
+} // parseHeaderLine
+
+
+/**
+ * @brief Make sure the end of the request is known before it is handed on.
+ * Chunked bodies are not supported and a Content-Length that is sent twice or isn't a number could
+ * be read differently by a proxy in front of us, so the body would be taken for the next request
+ * (RFC7230 3.3.3).  The connection has to be closed after any of these errors.
+ */
+bool HttpRequestParser::validateFraming() {
+	bool hasLength = false;
+	for (size_t i = 0; i < m_headerCount; i++) {
+		HttpStringView name = view(m_headerNames[i]);
+		if (name.equalsIgnoreCase("Transfer-Encoding")) {
+			fail(ERROR_NOT_IMPLEMENTED);
+			return false;
+		}
+		if (name.equalsIgnoreCase("Content-Length")) {
+			if (hasLength) {
+				fail(ERROR_BAD_REQUEST);
+				return false;
+			}
+			hasLength = true;
+		}
+	}
+	if (hasLength && getContentLength() < 0) {
+		fail(ERROR_BAD_REQUEST);
+		return false;
+	}
+	return true;
+} // validateFraming
+
+
+HttpStringView HttpRequestParser::view(const Span& span) const {
+	HttpStringView ret = {m_buffer + span.offset, span.length};
+	return ret;
+} // view
+
+
+/**
+ * @brief Get the value of the Content-Length header.
+ * @return The content length or -1 if there is none or it is invalid.
+ */
+int HttpRequestParser::getContentLength() const {
+	HttpStringView value;
+	if (!getHeader("Content-Length", &value) || value.empty() || value.length > 9) return -1;
+	int length = 0;
+	for (size_t i = 0; i < value.length; i++) {
+		if (value.data[i] < '0' || value.data[i] > '9') return -1;
+		length = length * 10 + (value.data[i] - '0');
+	}
+	return length;
+} // getContentLength
+
+
+HttpRequestParser::Error HttpRequestParser::getError() const {
+	return m_error;
+} // getError
+
+
+/**
+ * @brief Map the parse error to the status code the request should be rejected with.
+ */
+int HttpRequestParser::getErrorStatus() const {
+	switch (m_error) {
+		case ERROR_NONE:                  return 200;
+		case ERROR_URI_TOO_LONG:          return 414;
+		case ERROR_TOO_MANY_HEADERS:
+		case ERROR_HEADERS_TOO_LARGE:     return 431;
+		case ERROR_VERSION_NOT_SUPPORTED: return 505;
+		case ERROR_NOT_IMPLEMENTED:       return 501;
+		default:                          return 400;
+	}
+} // getErrorStatus
+
+
+/**
+ * @brief Find a header by its case insensitive name.
+ * @param [in] name The name of the header.
+ * @param [out] value The value of the header if found.
+ * @return True if the header is present.
+ */
+bool HttpRequestParser::getHeader(const char* name, HttpStringView* value) const {
+	for (size_t i = 0; i < m_headerCount; i++) {
+		if (view(m_headerNames[i]).equalsIgnoreCase(name)) {
+			*value = view(m_headerValues[i]);
+			return true;
+		}
+	}
+	return false;
+} // getHeader
+
+
+size_t HttpRequestParser::getHeaderCount() const {
+	return m_headerCount;
+} // getHeaderCount
+
+
+HttpStringView HttpRequestParser::getHeaderName(size_t index) const {
+	return view(m_headerNames[index]);
+} // getHeaderName
+
+
+HttpStringView HttpRequestParser::getHeaderValue(size_t index) const {
+	return view(m_headerValues[index]);
+} // getHeaderValue
+
+
+size_t HttpRequestParser::getHeadLength() const {
+	return m_headLength;
+} // getHeadLength
+
+
+HttpStringView HttpRequestParser::getMethod() const {
+	return view(m_method);
+} // getMethod
+
+
+HttpStringView HttpRequestParser::getPath() const {
+	return view(m_path);
+} // getPath
+
+
+HttpStringView HttpRequestParser::getVersion() const {
+	return view(m_version);
+} // getVersion
+
+
+/**
+ * @brief Determine if the connection should stay open after this request.
+ * HTTP/1.1 defaults to keep-alive unless "Connection: close" is sent, HTTP/1.0 is the other way round.
+ */
+bool HttpRequestParser::isKeepAlive() const {
+	HttpStringView connection;
+	bool hasConnection = getHeader("Connection", &connection);
+	if (getVersion().equals("HTTP/1.1")) {
+		return !(hasConnection && connection.equalsIgnoreCase("close"));
+	}
+	return hasConnection && connection.equalsIgnoreCase("keep-alive");
+} // isKeepAlive
@@ -0,0 +1,107 @@
+/*
+ * HttpRequestParser.h
+ *
+ * Incremental, non-owning parser for the head of an HTTP/1.1 request.
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_HTTPREQUESTPARSER_H_
+#define COMPONENTS_CPP_UTILS_HTTPREQUESTPARSER_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+/**
+ * @brief A non-owning reference to a piece of text.
+ */
+struct HttpStringView {
+	const char* data;
+	size_t      length;
+
+	bool        empty() const { return length == 0; }
+	bool        equals(const char* str) const;
+	bool        equalsIgnoreCase(const char* str) const;
+	std::string toString() const { return std::string(data, length); }
+}; // HttpStringView
+
+
+/**
+ * @brief Parse the request line and headers of an HTTP/1.1 request.
+ *
+ * The parser does not copy anything.  It is handed the buffer holding the request data, which may grow
+ * between calls to parse() as more data arrives.  Lines that were already parsed are not looked at
+ * again.  The parts of the request are remembered as offsets into the buffer and are returned as views
+ * into the buffer passed to the last parse() call.
+ *
+ * @code{.cpp}
+ * HttpRequestParser parser;
+ * while (parser.parse(buf, len) == HttpRequestParser::RESULT_INCOMPLETE) {
+ *    len += receiveMore(buf + len);
+ * }
+ * @endcode
+ */
+class HttpRequestParser {
+public:
+	static const size_t MAX_HEADERS    = 24;
+	static const size_t MAX_URL_LENGTH = 512;
+
+	enum Result {
+		RESULT_INCOMPLETE,
+		RESULT_COMPLETE,
+		RESULT_ERROR
+	};
+
+	enum Error {
+		ERROR_NONE,
+		ERROR_BAD_REQUEST,
+		ERROR_URI_TOO_LONG,
+		ERROR_TOO_MANY_HEADERS,
+		ERROR_HEADERS_TOO_LARGE,
+		ERROR_VERSION_NOT_SUPPORTED,
+		ERROR_NOT_IMPLEMENTED
+	};
+
+	HttpRequestParser(size_t maxHeadSize = 2048);
+
+	Result         parse(const char* buffer, size_t length);
+	void           reset();
+
+	int            getContentLength() const;                // -1 if there is no Content-Length header.
+	Error          getError() const;
+	int            getErrorStatus() const;                  // HTTP status code to answer an error with.
+	bool           getHeader(const char* name, HttpStringView* value) const;
+	size_t         getHeaderCount() const;
+	HttpStringView getHeaderName(size_t index) const;
+	HttpStringView getHeaderValue(size_t index) const;
+	size_t         getHeadLength() const;                   // Length of request line and headers including the empty line.
+	HttpStringView getMethod() const;
+	HttpStringView getPath() const;
+	HttpStringView getVersion() const;
+	bool           isKeepAlive() const;
+
+private:
+	struct Span {
+		uint16_t offset;
+		uint16_t length;
+	};
+
+	const char* m_buffer;
+	size_t      m_maxHeadSize;
+	size_t      m_scanned;        // Offset of the first line not parsed yet.
+	size_t      m_headLength;
+	Result      m_result;
+	Error       m_error;
+	Span        m_method;
+	Span        m_path;
+	Span        m_version;
+	Span        m_headerNames[MAX_HEADERS];
+	Span        m_headerValues[MAX_HEADERS];
+	size_t      m_headerCount;
+
+	Result         fail(Error error);
+	bool           parseHeaderLine(size_t start, size_t end);
+	bool           parseRequestLine(size_t start, size_t end);
+	bool           validateFraming();
+	HttpStringView view(const Span& span) const;
+}; // HttpRequestParser
+
+#endif /* COMPONENTS_CPP_UTILS_HTTPREQUESTPARSER_H_ */
@@ -4,6 +4,7 @@
  *  Created on: Sep 2, 2017
  *      Author: kolban
  */
+#include <stdio.h>
 #include <sstream>
 #include <fstream>
 #include "HttpRequest.h"
@@ -30,11 +31,22 @@ HttpResponse::HttpResponse(HttpRequest* request) {
 	m_request = request;
 	m_status  = 200;
 	m_headerCommitted = false; // We have not yet sent a header.
+	m_chunked   = false;
+	m_keepAlive = false;
+	m_closed    = false;
 }
 
 
+/**
+ * @brief Complete a response the handler did not close.
+ * On a persistent connection the client needs to see the end of the body before it can send the
+ * next request, so an unfinished response is terminated here.
+ */
 HttpResponse::~HttpResponse() {
-}
+	if (!m_closed && !m_request->isClosed() && (m_headerCommitted || m_request->isKeepAlive())) {
+		close();
+	}
+} // ~HttpResponse
 
 
 /**
@@ -51,15 +63,28 @@ void HttpResponse::addHeader(const std::string name, const std::string value) {
 
 /**
  * @brief Close the response.
- * We close the response.  If we haven't yet sent the header, we send that now and then close
- * the socket.
+ * We complete the response.  If we haven't yet sent the header, we send that now.  If the connection
+ * can be kept alive the body is terminated and the socket stays open for the next request, otherwise
+ * the socket is closed.
  */
 void HttpResponse::close() {
-	// If we haven't yet sent the header of the data, send that now.
+	if (m_closed) return;
+	m_closed = true;
+	if (m_request->isClosed()) return;
+
+	// If we haven't yet sent the header of the data, send that now.  Nothing was sent, so the body is empty.
 	if (!m_headerCommitted) {
+		if (getHeader(HttpRequest::HTTP_HEADER_CONTENT_LENGTH).empty()) {
+			addHeader(HttpRequest::HTTP_HEADER_CONTENT_LENGTH, "0");
+		}
 		sendHeader();
 	}
-	m_request->close();
+	if (m_chunked) {
+		m_request->getSocket().send("0" + lineTerminator + lineTerminator);   // The last chunk.
+	}
+	if (!m_keepAlive) {
+		m_request->close();
+	}
 } // close
 
 
@@ -79,6 +104,16 @@ std::map<std::string, std::string> HttpResponse::getHeaders() {
 } // getHeaders
 
 
+/**
+ * @brief Determine if the connection stays open once the response is complete.
+ * This is only known once the header has been sent, as it depends on how the body is framed.
+ * @return True if the client can send another request on the same connection.
+ */
+bool HttpResponse::isKeepAlive() {
+	return m_keepAlive;
+} // isKeepAlive
+
+
 /**
  * @brief Send data to the partner.
  * Send some data to the partner.  If we haven't yet sent the HTTP header then send that now.  We can call this function
@@ -88,7 +123,7 @@ std::map<std::string, std::string> HttpResponse::getHeaders() {
 void HttpResponse::sendData(std::string data) {
 	ESP_LOGD(LOG_TAG, ">> sendData");
 	// If the request is already closed, nothing further to do.
-	if (m_request->isClosed()) {
+	if (m_closed || m_request->isClosed()) {
 		ESP_LOGE(LOG_TAG, "<< sendData: Request to send more data but the request/response is already closed");
 		return;
 	}
@@ -99,14 +134,14 @@ void HttpResponse::sendData(std::string data) {
 	}
 
 	// Send the payload data.
-	m_request->getSocket().send(data);
+	sendChunk((const uint8_t*) data.data(), data.length());
 	ESP_LOGD(LOG_TAG, "<< sendData");
 } // sendData
 
 void HttpResponse::sendData(uint8_t* pData, size_t size) {
-	ESP_LOGD(LOG_TAG, ">> sendData: 0x%x, size: %d", (uint32_t) pData, size);
+	ESP_LOGD(LOG_TAG, ">> sendData: %p, size: %d", pData, size);
 	// If the request is already closed, nothing further to do.
-	if (m_request->isClosed()) {
+	if (m_closed || m_request->isClosed()) {
 		ESP_LOGE(LOG_TAG, "<< sendData: Request to send more data but the request/response is already closed");
 		return;
 	}
@@ -117,10 +152,32 @@ void HttpResponse::sendData(uint8_t* pData, size_t size) {
 	}
 
 	// Send the payload data.
-	m_request->getSocket().send(pData, size);
+	sendChunk(pData, size);
 	ESP_LOGD(LOG_TAG, "<< sendData");
 } // sendData
 
+/**
+ * @brief Send body data to the client.
+ * With chunked transfer encoding every piece of data becomes one chunk.  Empty data is not sent at
+ * all, as an empty chunk marks the end of the body.
+ * @param [in] pData The data to send.
+ * @param [in] size The number of bytes to send.
+ */
+void HttpResponse::sendChunk(const uint8_t* pData, size_t size) {
+	if (size == 0) return;
+	Socket socket = m_request->getSocket();
+	if (m_chunked) {
+		char sizeLine[12];
+		int length = snprintf(sizeLine, sizeof(sizeLine), "%x\r\n", (unsigned) size);
+		socket.send((const uint8_t*) sizeLine, length);
+	}
+	socket.send(pData, size);
+	if (m_chunked) {
+		socket.send(lineTerminator);
+	}
+} // sendChunk
+
+
 void HttpResponse::sendFile(std::string fileName, size_t bufSize) {
 	ESP_LOGI(LOG_TAG, "Opening file: %s", fileName.c_str());
 	std::ifstream ifStream;
@@ -140,6 +197,14 @@ void HttpResponse::sendFile(std::string fileName, size_t bufSize) {
 	// because of defect #252 we have to do some pretty important re-work here.  Specifically, we can't host the whole file in
 	// RAM at one time.  Instead what we have to do is ensure that we only have enough data in RAM to be sent.
 
+	// Knowing the size up front lets the body go out without chunk framing on a persistent connection.
+	ifStream.seekg(0, std::ifstream::end);
+	std::streamoff fileSize = ifStream.tellg();
+	ifStream.seekg(0, std::ifstream::beg);
+	if (fileSize >= 0) {
+		addHeader(HttpRequest::HTTP_HEADER_CONTENT_LENGTH, std::to_string((long) fileSize));
+	}
+
 	setStatus(HttpResponse::HTTP_STATUS_OK, "OK");
 	uint8_t *pData = new uint8_t[bufSize];
 	while (!ifStream.eof()) {
@@ -157,8 +222,26 @@ void HttpResponse::sendFile(std::string fileName, size_t bufSize) {
 void HttpResponse::sendHeader() {
 	// If we haven't yet sent the header of the data, send that now.
 	if (!m_headerCommitted) {
+		// Decide how the end of the body is signalled.  A persistent connection needs either a known
+		// length or chunked encoding, otherwise the client only sees the end when the socket closes.
+		if (m_status == HTTP_STATUS_SWITCHING_PROTOCOL) {
+			m_keepAlive = true;   // The socket is handed over to the new protocol.
+		} else if (m_request->isKeepAlive()) {
+			if (!getHeader(HttpRequest::HTTP_HEADER_CONTENT_LENGTH).empty()) {
+				m_keepAlive = true;
+			} else if (m_request->getVersion() == "HTTP/1.1") {
+				addHeader("Transfer-Encoding", "chunked");
+				m_chunked   = true;
+				m_keepAlive = true;
+			}
+		}
+		if (!m_keepAlive) {
+			addHeader(HttpRequest::HTTP_HEADER_CONNECTION, "close");
+		}
+
+		std::string version = m_request->getVersion().empty() ? "HTTP/1.1" : m_request->getVersion();
 		std::ostringstream oss;
-		oss << m_request->getVersion() << " " << m_status << " " << m_statusMessage << lineTerminator;
+		oss << version << " " << m_status << " " << m_statusMessage << lineTerminator;
 		for (auto it = m_responseHeaders.begin(); it != m_responseHeaders.end(); ++it) {
 			oss << it->first.c_str() << ": " << it->second.c_str() << lineTerminator;
 		}
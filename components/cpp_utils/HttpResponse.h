@@ -32,22 +32,27 @@ public:
 	virtual ~HttpResponse();
 
 	void                               addHeader(std::string name, std::string value);  // Add a header to be sent to the client.
-	void                               close();                                         // Close the request/response.
+	void                               close();                                         // Complete the response.
 	std::string                        getHeader(std::string name);                     // Get a named header.
 	std::map<std::string, std::string> getHeaders();                                    // Get all headers.
 	void                               sendData(std::string data);                      // Send data to the client.
 	void                               sendData(uint8_t* pData, size_t size);           // Send data to the client.
 	void                               setStatus(int status, std::string message);      // Set the response status.
 	void 							   sendFile(std::string fileName, size_t bufSize = 4 * 1024);	// Send file contents if exists.
+	bool                               isKeepAlive();                                   // Will the connection stay open after the response?
 
 private:
 	bool							   m_headerCommitted;  // Has the header been sent?
+	bool							   m_chunked;		  // Is the body sent with chunked transfer encoding?
+	bool							   m_keepAlive;		// Does the framing allow the connection to be reused?
+	bool							   m_closed;		   // Has the response been completed?
 	HttpRequest*					   m_request;		  // The request associated with this response.
 	std::map<std::string, std::string> m_responseHeaders;  // The headers to be sent with the response.
 	int								m_status;		   // The status to be sent with the response.
 	std::string						m_statusMessage;	// The status message to be sent with the response.
 
 	void sendHeader();									 // Send the header to the client.
+	void sendChunk(const uint8_t* pData, size_t size);	 // Send body data with the transfer encoding in use.
 
 };
 
@@ -0,0 +1,292 @@
+/*
+ * HttpRouter.cpp
+ *
+ * Match request paths against a table of routes.
+ */
+
+#include <string.h>
+#include "HttpRouter.h"
+
+#include <esp_log.h>
+
+static const char* LOG_TAG = "HttpRouter";
+
+static const char WILDCARD_NAME[] = "*";
+
+
+HttpRouteParams::HttpRouteParams() {
+	m_count = 0;
+} // HttpRouteParams
+
+
+/**
+ * @brief Get the number of values captured by the route.
+ */
+size_t HttpRouteParams::getCount() const {
+	return m_count;
+} // getCount
+
+
+/**
+ * @brief Get the name of a captured value.
+ * @param [in] index The index of the value.
+ * @return The name of the capture in the route pattern, `*` for a wildcard.
+ */
+const char* HttpRouteParams::getName(size_t index) const {
+	if (index >= m_count) return "";
+	return m_params[index].name;
+} // getName
+
+
+/**
+ * @brief Get a captured value.
+ * @param [in] index The index of the value.
+ * @param [in] path The path that was matched.
+ * @return The captured part of the path, still URL encoded.
+ */
+std::string HttpRouteParams::getValue(size_t index, const std::string& path) const {
+	if (index >= m_count || m_params[index].offset + m_params[index].length > path.length()) return "";
+	return path.substr(m_params[index].offset, m_params[index].length);
+} // getValue
+
+
+/**
+ * @brief Find a captured value by name.
+ * @param [in] name The name of the capture in the route pattern.
+ * @return The index of the value or -1 if the route has no such capture.
+ */
+int HttpRouteParams::indexOf(const std::string& name) const {
+	for (uint8_t i = 0; i < m_count; i++) {
+		if (name == m_params[i].name) return i;
+	}
+	return -1;
+} // indexOf
+
+
+HttpRouter::HttpRouter() {
+	m_routeCount = 0;
+	addNode("");   // The root node.
+} // HttpRouter
+
+
+/**
+ * @brief Add a node to the trie.
+ * @param [in] segment The literal or capture name of the node.
+ * @return The index of the new node.
+ */
+uint16_t HttpRouter::addNode(const std::string& segment) {
+	Node node;
+	node.segment       = segment;
+	node.paramChild    = NO_NODE;
+	node.wildcardChild = NO_NODE;
+	m_nodes.push_back(node);
+	return m_nodes.size() - 1;
+} // addNode
+
+
+/**
+ * @brief Find the literal child of a node.
+ * @param [in] index The index of the parent node.
+ * @param [in] segment The literal to look for.
+ * @return The index of the child or NO_NODE.
+ */
+int16_t HttpRouter::findChild(uint16_t index, const std::string& segment) const {
+	for (auto it = m_nodes[index].children.begin(); it != m_nodes[index].children.end(); ++it) {
+		if (m_nodes[*it].segment == segment) return *it;
+	}
+	return NO_NODE;
+} // findChild
+
+
+/**
+ * @brief Add a route.
+ *
+ * @param [in] method The method to be matched ("GET", "POST" etc).
+ * @param [in] pattern The path pattern to be matched.
+ * @param [in] value The value returned by match() for this route.
+ * @return False if the pattern is invalid or the route conflicts with an existing one.
+ */
+bool HttpRouter::addRoute(const std::string& method, const std::string& pattern, size_t value) {
+	std::vector<std::string> segments;
+	size_t pos = 0;
+	while (pos < pattern.length()) {
+		size_t end = pattern.find('/', pos);
+		if (end == std::string::npos) end = pattern.length();
+		if (end > pos) segments.push_back(pattern.substr(pos, end - pos));
+		pos = end + 1;
+	}
+
+	// Validate the whole pattern against the table first, so a rejected route leaves no nodes behind.
+	int16_t  index      = 0;      // Existing node matching the pattern so far, NO_NODE once the pattern leaves the trie.
+	uint8_t  paramCount = 0;
+	for (size_t i = 0; i < segments.size(); i++) {
+		const std::string& segment = segments[i];
+		if (segment == WILDCARD_NAME) {
+			if (i != segments.size() - 1) {
+				ESP_LOGE(LOG_TAG, "A wildcard has to be the last segment: %s", pattern.c_str());
+				return false;
+			}
+			paramCount++;
+			if (index != NO_NODE) index = m_nodes[index].wildcardChild;
+		} else if (segment[0] == ':') {
+			std::string name = segment.substr(1);
+			if (name.empty()) {
+				ESP_LOGE(LOG_TAG, "Capture without a name: %s", pattern.c_str());
+				return false;
+			}
+			for (size_t j = 0; j < i; j++) {
+				if (segments[j] == segment) {
+					ESP_LOGE(LOG_TAG, "Capture %s used twice: %s", segment.c_str(), pattern.c_str());
+					return false;
+				}
+			}
+			paramCount++;
+			if (index != NO_NODE) {
+				int16_t child = m_nodes[index].paramChild;
+				if (child != NO_NODE && m_nodes[child].segment != name) {
+					ESP_LOGE(LOG_TAG, "Capture %s conflicts with :%s: %s",
+						segment.c_str(), m_nodes[child].segment.c_str(), pattern.c_str());
+					return false;
+				}
+				index = child;
+			}
+		} else if (index != NO_NODE) {
+			index = findChild(index, segment);
+		}
+		if (paramCount > HttpRouteParams::MAX_PARAMS) {
+			ESP_LOGE(LOG_TAG, "More than %d captures: %s", HttpRouteParams::MAX_PARAMS, pattern.c_str());
+			return false;
+		}
+	} // For each segment
+	if (index != NO_NODE) {
+		for (auto it = m_nodes[index].routes.begin(); it != m_nodes[index].routes.end(); ++it) {
+			if (it->method == method) {
+				ESP_LOGE(LOG_TAG, "Route %s %s registered twice", method.c_str(), pattern.c_str());
+				return false;
+			}
+		}
+	}
+
+	uint16_t node = 0;
+	for (auto it = segments.begin(); it != segments.end(); ++it) {
+		const std::string& segment = *it;
+		if (segment == WILDCARD_NAME) {
+			if (m_nodes[node].wildcardChild == NO_NODE) {
+				uint16_t child = addNode(WILDCARD_NAME);
+				m_nodes[node].wildcardChild = child;
+			}
+			node = m_nodes[node].wildcardChild;
+		} else if (segment[0] == ':') {
+			if (m_nodes[node].paramChild == NO_NODE) {
+				uint16_t child = addNode(segment.substr(1));
+				m_nodes[node].paramChild = child;
+			}
+			node = m_nodes[node].paramChild;
+		} else {
+			int16_t child = findChild(node, segment);
+			if (child == NO_NODE) {
+				child = addNode(segment);
+				m_nodes[node].children.push_back(child);
+			}
+			node = child;
+		}
+	}
+
+	Route route;
+	route.method = method;
+	route.value  = value;
+	m_nodes[node].routes.push_back(route);
+	m_routeCount++;
+	return true;
+} // addRoute
+
+
+/**
+ * @brief Get the number of routes in the table.
+ */
+size_t HttpRouter::getRouteCount() const {
+	return m_routeCount;
+} // getRouteCount
+
+
+/**
+ * @brief Find the route for a method among the routes ending at a node.
+ */
+bool HttpRouter::findRoute(const Node& node, const char* method, size_t* pValue) const {
+	for (auto it = node.routes.begin(); it != node.routes.end(); ++it) {
+		if (strcmp(it->method.c_str(), method) == 0) {
+			*pValue = it->value;
+			return true;
+		}
+	}
+	return false;
+} // findRoute
+
+
+/**
+ * @brief Match the rest of the path against the subtree of a node.
+ * Literal children are tried first, then the capture and then the wildcard.  If a more specific branch
+ * fails further down the path, the next one is tried.
+ */
+bool HttpRouter::matchNode(uint16_t index, const char* method, const char* path, size_t pos, size_t length,
+		size_t* pValue, HttpRouteParams* pParams) const {
+	const Node& node = m_nodes[index];
+	while (pos < length && path[pos] == '/') pos++;
+
+	if (pos < length) {
+		size_t end = pos;
+		while (end < length && path[end] != '/') end++;
+		size_t segmentLength = end - pos;
+
+		for (auto it = node.children.begin(); it != node.children.end(); ++it) {
+			const std::string& segment = m_nodes[*it].segment;
+			if (segment.length() == segmentLength && memcmp(segment.data(), path + pos, segmentLength) == 0 &&
+					matchNode(*it, method, path, end, length, pValue, pParams)) {
+				return true;
+			}
+		}
+		if (node.paramChild != NO_NODE && pParams->m_count < HttpRouteParams::MAX_PARAMS) {
+			uint8_t count = pParams->m_count;
+			pParams->m_params[count].name   = m_nodes[node.paramChild].segment.c_str();
+			pParams->m_params[count].offset = pos;
+			pParams->m_params[count].length = segmentLength;
+			pParams->m_count++;
+			if (matchNode(node.paramChild, method, path, end, length, pValue, pParams)) {
+				return true;
+			}
+			pParams->m_count = count;
+		}
+	} else if (findRoute(node, method, pValue)) {
+		return true;
+	}
+
+	if (node.wildcardChild != NO_NODE && pParams->m_count < HttpRouteParams::MAX_PARAMS &&
+			findRoute(m_nodes[node.wildcardChild], method, pValue)) {
+		uint8_t count = pParams->m_count;
+		pParams->m_params[count].name   = WILDCARD_NAME;
+		pParams->m_params[count].offset = pos;
+		pParams->m_params[count].length = length - pos;
+		pParams->m_count++;
+		return true;
+	}
+	return false;
+} // matchNode
+
+
+/**
+ * @brief Find the route for a request.
+ *
+ * @param [in] method The method of the request.
+ * @param [in] path The path of the request, a query string is ignored.
+ * @param [in] pathLength The length of the path.
+ * @param [out] pValue The value the matching route was added with.
+ * @param [out] pParams The values captured by the route.
+ * @return True if a route matched.
+ */
+bool HttpRouter::match(const char* method, const char* path, size_t pathLength, size_t* pValue, HttpRouteParams* pParams) const {
+	pParams->m_count = 0;
+	size_t length = 0;
+	while (length < pathLength && path[length] != '?' && path[length] != '#') length++;
+	if (length > UINT16_MAX) return false;   // Captures are stored as 16 bit offsets.
+	return matchNode(0, method, path, 0, length, pValue, pParams);
+} // match
@@ -0,0 +1,95 @@
+/*
+ * HttpRouter.h
+ *
+ * Match request paths against a table of routes.
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_HTTPROUTER_H_
+#define COMPONENTS_CPP_UTILS_HTTPROUTER_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The values captured from a path by a route.
+ *
+ * Values are stored as offsets into the matched path, so capturing them does not allocate.
+ */
+class HttpRouteParams {
+public:
+	static const uint8_t MAX_PARAMS = 4;
+
+	HttpRouteParams();
+	size_t      getCount() const;                                           // Number of captured values.
+	int         indexOf(const std::string& name) const;                     // Index of a named value or -1.
+	const char* getName(size_t index) const;                                // Name of a captured value.
+	std::string getValue(size_t index, const std::string& path) const;      // Captured value taken from the matched path.
+
+private:
+	friend class HttpRouter;
+	struct Param {
+		const char* name;
+		uint16_t    offset;
+		uint16_t    length;
+	};
+	Param   m_params[MAX_PARAMS];
+	uint8_t m_count;
+}; // HttpRouteParams
+
+
+/**
+ * @brief Route table organized as a trie of path segments.
+ *
+ * A route pattern is a path whose segments are one of:
+ *
+ * * a literal, which has to match the path segment exactly.
+ * * `:name`, which matches any single segment and captures it as `name`.
+ * * `*`, only allowed as the last segment, which matches the rest of the path (possibly nothing) and
+ *   captures it as `*`.
+ *
+ * For example `/api/probes/:id`, or `/static` followed by a `*` segment.  Literals take precedence over captures and captures over
+ * wildcards.  Empty segments are ignored, so `/a/` and `/a` are the same path, and anything after `?` is
+ * not part of the path.
+ *
+ * Routes are added once before the server starts.  Matching walks the trie segment by segment and does
+ * not allocate.
+ *
+ * @code{.cpp}
+ * HttpRouter router;
+ * router.addRoute("GET", "/api/probes/:id", 0);
+ * size_t value;
+ * HttpRouteParams params;
+ * if (router.match("GET", path.c_str(), path.length(), &value, &params)) { ... }
+ * @endcode
+ */
+class HttpRouter {
+public:
+	HttpRouter();
+	bool   addRoute(const std::string& method, const std::string& pattern, size_t value);
+	bool   match(const char* method, const char* path, size_t pathLength, size_t* pValue, HttpRouteParams* pParams) const;
+	size_t getRouteCount() const;
+
+private:
+	static const int16_t NO_NODE = -1;
+	struct Route {
+		std::string method;
+		size_t      value;
+	};
+	struct Node {
+		std::string           segment;      // Literal segment or the name of a capture.
+		std::vector<uint16_t> children;     // Literal children.
+		int16_t               paramChild;
+		int16_t               wildcardChild;
+		std::vector<Route>    routes;       // Routes ending at this node, one per method.
+	};
+	std::vector<Node> m_nodes;
+	size_t            m_routeCount;
+
+	uint16_t addNode(const std::string& segment);
+	int16_t  findChild(uint16_t index, const std::string& segment) const;
+	bool     findRoute(const Node& node, const char* method, size_t* pValue) const;
+	bool     matchNode(uint16_t index, const char* method, const char* path, size_t pos, size_t length, size_t* pValue, HttpRouteParams* pParams) const;
+}; // HttpRouter
+
+#endif /* COMPONENTS_CPP_UTILS_HTTPROUTER_H_ */
@@ -11,16 +11,23 @@
  */
 
 #include <fstream>
+#include <sstream>
 #include "HttpServer.h"
 #include "SockServ.h"
 #include "Task.h"
 #include <esp_log.h>
 #include "HttpRequest.h"
+#include "HttpRequestParser.h"
 #include "HttpResponse.h"
 #include "FileSystem.h"
 #include "WebSocket.h"
 #include "GeneralUtils.h"
 #include "Memory.h"
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include <string.h>
+#include <freertos/queue.h>
 static const char* LOG_TAG = "HttpServer";
 
 #undef close
@@ -36,28 +43,145 @@ HttpServer::HttpServer() {
 	m_useSSL     = false;         // Default SSL is no.
 	setDirectoryListing(false);   // Default directory listing is disabled.
 	m_fileBufferSize = 4 * 1024;	// Default size of the file buffer.
+	m_maxConnections = 6;         // Default maximum of open client connections, lwIP has 10 sockets by default.
+	m_workerCount    = 2;         // Default number of tasks processing requests.
+	m_pServerTask    = nullptr;
 } // HttpServer
 
 
-HttpServer::~HttpServer() {
-	ESP_LOGD(LOG_TAG, "~HttpServer");
-}
+/**
+ * @brief Get the reason phrase for the status codes used to reject unparsable requests.
+ */
+static std::string errorStatusMessage(int status) {
+	switch (status) {
+		case 413: return "Payload Too Large";
+		case 414: return "URI Too Long";
+		case 431: return "Request Header Fields Too Large";
+		case 501: return "Not Implemented";
+		case 505: return "HTTP Version Not Supported";
+		default:  return "Bad Request";
+	}
+} // errorStatusMessage
+
+
+// Per connection buffer for request heads.  Bodies are read into the request itself.
+#define REQUEST_BUFFER_SIZE 1024
+// Upper bound for how long the server task sleeps in select() before it checks for idle connections.
+#define SELECT_INTERVAL_MS  1000
+
+static const char BUSY_RESPONSE[] = "HTTP/1.1 503 Service Unavailable\r\nConnection: close\r\nContent-Length: 0\r\n\r\n";
+
+
+/**
+ * @brief A client connection.
+ *
+ * A connection is either idle, in which case the server task reads the next request as it arrives,
+ * or it is owned by exactly one worker while its requests are being processed.  Data the client sent
+ * ahead of time (pipelined requests) stays in the reader between requests.
+ */
+class HttpConnection {
+public:
+	HttpConnection(Socket socket): m_socket(socket), m_reader(socket, REQUEST_BUFFER_SIZE), m_parser(REQUEST_BUFFER_SIZE) {
+		m_lastActivity = xTaskGetTickCount();
+		m_busy         = false;
+		m_closed       = false;
+		m_upgraded     = false;
+	}
+
+	/**
+	 * @brief Can the next request be served without waiting for the client?
+	 * That is the case once its head and, if it fits into the buffer, its body were received, or as soon
+	 * as it can be rejected.  Only a body larger than the buffer is still read by the worker.
+	 * @return True if the request can be handed to a worker.
+	 */
+	bool hasRequest() {
+		HttpRequestParser::Result result = m_parser.parse((const char*) m_reader.data(), m_reader.available());
+		if (result == HttpRequestParser::RESULT_INCOMPLETE) return false;
+		if (result == HttpRequestParser::RESULT_ERROR) return true;
+		int length = m_parser.getContentLength();
+		if (length <= 0) return true;
+		size_t requestLength = m_parser.getHeadLength() + length;
+		return requestLength > m_reader.capacity() || m_reader.available() >= requestLength;
+	} // hasRequest
+
+	Socket            m_socket;
+	SocketReader      m_reader;
+	HttpRequestParser m_parser;        // Parses the next request in the reader while it arrives.
+	TickType_t        m_lastActivity;  // When the connection was opened or its last request was completed.
+	bool              m_busy;          // Is a worker processing the connection?  Only used by the server task.
+	bool              m_closed;        // Set by the worker when the connection has ended.
+	bool              m_upgraded;      // Set by the worker when the connection was handed over to a WebSocket.
+}; // HttpConnection
 
 
 /**
  * @brief Be an HTTP server task.
- * Here we define a Task that will be run when the HTTP server starts.  It is this task
- * that executes the majority of the passive work of the server.  It listens for incoming
- * connections and processes them when they arrive.
+ * Here we define a Task that will be run when the HTTP server starts.  It listens for incoming
+ * connections and watches all idle connections with select().  Whatever arrives on a connection is
+ * parsed right away, and only once a request is complete the connection is passed to one of the
+ * worker tasks to process it.  A client that sends its request slowly never holds up a worker, it
+ * is closed when it did not complete a request within the client timeout.
  */
 class HttpServerTask: public Task {
 public:
 	HttpServerTask(std::string name): Task(name, 16 * 1024) {
+		m_pHttpServer    = nullptr;
+		m_workQueue      = nullptr;
+		m_doneQueue      = nullptr;
+		m_stoppedWorkers = 0;
+		m_stopRequested  = false;
+		createWakeSocket();   // Before the task starts, so that stop() can always wake it up.
+	};
+
+	~HttpServerTask() {
+		if (m_wakeSocket >= 0) {
+			::closesocket(m_wakeSocket);
+		}
+	}
+
+	void connectionDone(HttpConnection* pConnection);
+	void requestStop();
+
+private:
+	friend class HttpServerWorker;
+	HttpServer*                    m_pHttpServer;    // Reference to the HTTP Server
+	std::vector<HttpConnection*>   m_connections;    // All open connections.
+	std::vector<HttpServerWorker*> m_workers;        // Deleted once they all ended.
+	QueueHandle_t                  m_workQueue;      // Connections with a complete request, read by the workers.
+	QueueHandle_t                  m_doneQueue;      // Connections handed back by the workers.
+	int                            m_wakeSocket;     // Loopback UDP socket used to wake up select().
+	struct sockaddr_in             m_wakeAddress;
+	uint8_t                        m_stoppedWorkers;
+	std::atomic<bool>              m_stopRequested;  // Set by stop(), which runs in another task.
+
+	bool createWakeSocket();
+	void acceptConnection();
+	void closeIdleConnections();
+	void readRequest(HttpConnection* pConnection);
+	void releaseConnection(HttpConnection* pConnection);
+	void removeConnection(HttpConnection* pConnection);
+	void shutdown();
+	static void stopped(void* data);
+
+	void run(void* data);
+}; // HttpServerTask
+
+
+/**
+ * @brief Process the requests arriving on client connections.
+ * A worker takes one connection at a time from the server task, answers every request that is
+ * available on it and then hands the connection back.
+ */
+class HttpServerWorker: public Task {
+public:
+	HttpServerWorker(std::string name, HttpServerTask* pServerTask): Task(name, 16 * 1024) {
 		m_pHttpServer = nullptr;
+		m_pServerTask = pServerTask;
 	};
 
 private:
-	HttpServer* m_pHttpServer; // Reference to the HTTP Server
+	HttpServer*     m_pHttpServer; // Reference to the HTTP Server
+	HttpServerTask* m_pServerTask; // The task owning the connections.
 
 	/**
 	 * @brief Process an incoming HTTP Request
@@ -74,23 +198,25 @@ private:
 		ESP_LOGD("HttpServerTask", ">> processRequest: Method: %s, Path: %s",
 			request.getMethod().c_str(), request.getPath().c_str());
 
-		// Loop over all the path handlers we have looking for the first one that matches.  Note that none of them
+		// Look up the path handler for the method/path pair in the route table.  Note that none of them
 		// need to match.  If we find one that does, then invoke the handler and that is the end of processing.
-		for (auto pathHandlerIterartor = m_pHttpServer->m_pathHandlers.begin();
-				pathHandlerIterartor != m_pHttpServer->m_pathHandlers.end();
-				++pathHandlerIterartor) {
-			if (pathHandlerIterartor->match(request.getMethod(), request.getPath())) { // Did we match the handler?
-				ESP_LOGD("HttpServerTask", "Found a path handler match!!");
-				if (request.isWebsocket()) {                                     // Is this handler to be invoked for a web socket?
-					pathHandlerIterartor->invokePathHandler(&request, nullptr);    // Invoke the handler.
-					request.getWebSocket()->startReader();
-				} else {
-					HttpResponse response(&request);
-					pathHandlerIterartor->invokePathHandler(&request, &response); // Invoke the handler.
-				}
-				return;                                                         // End of processing the request
-			} // Path handler match
-		} // For each path handler
+		std::string     method = request.getMethod();
+		std::string     path   = request.getPath();
+		size_t          handlerIndex;
+		HttpRouteParams params;
+		if (m_pHttpServer->m_router.match(method.c_str(), path.c_str(), path.length(), &handlerIndex, &params)) {
+			ESP_LOGD("HttpServerTask", "Found a path handler match!!");
+			PathHandler& pathHandler = m_pHttpServer->m_pathHandlers[handlerIndex];
+			request.setPathParams(params);
+			if (request.isWebsocket()) {                                     // Is this handler to be invoked for a web socket?
+				pathHandler.invokePathHandler(&request, nullptr);              // Invoke the handler.
+				request.getWebSocket()->startReader();
+			} else {
+				HttpResponse response(&request);
+				pathHandler.invokePathHandler(&request, &response);            // Invoke the handler.
+			}
+			return;                                                           // End of processing the request
+		} // Path handler match
 
 		ESP_LOGD("HttpServerTask", "No Path handler found");
 		// If we reach here, then we did not find a handler for the request.
@@ -123,81 +249,356 @@ private:
 
 
 	/**
-	 * @brief Perform the task handling for server.
-	 * We loop forever waiting for new client connections to arrive.  When they do, we parse the
-	 * content and look for a handler for that content.
+	 * @brief Answer the requests waiting on a connection.
+	 * Pipelined requests that are complete in the reader are answered in the order they arrived, a
+	 * partial one is left to the server task.  The connection is marked as closed unless the client may
+	 * send another request on it.
+	 * @param [in] pConnection The connection to serve.
+	 */
+	void serve(HttpConnection* pConnection) {
+		do {
+			pConnection->m_parser.reset();
+			HttpRequest request(pConnection->m_socket, pConnection->m_reader);   // Build the HTTP Request from the socket.
+			if (!request.isValid()) {           // Reject requests that could not be parsed.
+				if (request.getErrorStatus() != 0) {
+					HttpResponse response(&request);
+					response.setStatus(request.getErrorStatus(), errorStatusMessage(request.getErrorStatus()));
+					response.sendData("");
+				}
+				request.close();
+				pConnection->m_closed = true;
+				return;
+			}
+			if (request.isWebsocket()) {        // If this is a WebSocket
+				pConnection->m_socket.setTimeout(0);   // Clear the timeout.
+				processRequest(request);
+				pConnection->m_upgraded = true;   // The WebSocket owns the socket from now on.
+				return;
+			}
+			request.dump();                      // debug.
+			processRequest(request);             // Process the request.
+
+			// mbedtls may hold decrypted data that select() can't see, so SSL connections are not reused.
+			if (request.isClosed() || !request.isKeepAlive() || m_pHttpServer->getSSL()) {
+				if (!request.isClosed()) {
+					request.close();
+				}
+				pConnection->m_closed = true;
+				return;
+			}
+		} while (pConnection->hasRequest());
+	} // serve
+
+
+	/**
+	 * @brief Tell the server task that a worker has ended, which then deletes it.
+	 */
+	static void stopped(void* data) {
+		((HttpServerTask*) data)->connectionDone(nullptr);
+	} // stopped
+
+	/**
+	 * @brief Perform the task handling for a worker.
+	 * We wait for connections with a request and serve them until the server task tells us to stop by
+	 * queueing a null connection.
 	 * @param [in] data A reference to the HttpServer.
 	 */
 	void run(void* data) {
-		m_pHttpServer = (HttpServer*) data;			 // The passed in data is an instance of an HttpServer.
-		m_pHttpServer->m_socket.setSSL(m_pHttpServer->m_useSSL);
-		m_pHttpServer->m_socket.listen(m_pHttpServer->m_portNumber, false /* is datagram */, true /* Allow address reuse */);
-		ESP_LOGD("HttpServerTask", "Listening on port %d", m_pHttpServer->getPort());
-		Socket clientSocket;
-		while (true) {   // Loop forever.
-			ESP_LOGD("HttpServerTask", "Waiting for new peer client");
+		m_pHttpServer = (HttpServer*) data;
+		HttpConnection* pConnection;
+		while (xQueueReceive(m_pServerTask->m_workQueue, &pConnection, portMAX_DELAY) == pdTRUE && pConnection != nullptr) {
+			serve(pConnection);
+			m_pServerTask->connectionDone(pConnection);
+		}
+		finish(stopped, m_pServerTask);
+	} // run
+}; // HttpServerWorker
+
 
+/**
+ * @brief Perform the task handling for server.
+ * We loop forever waiting for new client connections and requests on idle connections.  When a
+ * request arrives, the connection is queued for the workers.
+ * @param [in] data A reference to the HttpServer.
+ */
+void HttpServerTask::run(void* data) {
+	m_pHttpServer = (HttpServer*) data;			 // The passed in data is an instance of an HttpServer.
+	m_pHttpServer->m_socket.setSSL(m_pHttpServer->m_useSSL);
+	m_pHttpServer->m_socket.listen(m_pHttpServer->m_portNumber, false /* is datagram */, true /* Allow address reuse */);
+	ESP_LOGD("HttpServerTask", "Listening on port %d", m_pHttpServer->getPort());
+
+	if (m_wakeSocket < 0) {
+		m_pHttpServer->m_socket.close();
+		finish(stopped, m_pHttpServer);
+	}
+	m_workQueue = xQueueCreate(m_pHttpServer->m_maxConnections + m_pHttpServer->m_workerCount, sizeof(HttpConnection*));
+	m_doneQueue = xQueueCreate(m_pHttpServer->m_maxConnections + m_pHttpServer->m_workerCount, sizeof(HttpConnection*));
+	for (uint8_t i = 0; i < m_pHttpServer->m_workerCount; i++) {
+		HttpServerWorker* pWorker = new HttpServerWorker("HttpServerWorker", this);
+		m_workers.push_back(pWorker);
+		pWorker->start(m_pHttpServer);
+	}
+
+	while (!m_stopRequested && m_pHttpServer->m_socket.isValid()) {   // Loop until stop() is called.
+		HttpConnection* pConnection;
+		while (xQueueReceive(m_doneQueue, &pConnection, 0) == pdTRUE) {
+			releaseConnection(pConnection);
+		}
+		closeIdleConnections();
+
+		int listenFd = m_pHttpServer->m_socket.getFD();
+		int maxFd    = std::max(listenFd, m_wakeSocket);
+		fd_set readSet;
+		FD_ZERO(&readSet);
+		FD_SET(listenFd, &readSet);
+		FD_SET(m_wakeSocket, &readSet);
+		for (auto it = m_connections.begin(); it != m_connections.end(); ++it) {
+			if (!(*it)->m_busy) {
+				FD_SET((*it)->m_socket.getFD(), &readSet);
+				maxFd = std::max(maxFd, (*it)->m_socket.getFD());
+			}
+		}
+
+		struct timeval timeout;
+		timeout.tv_sec  = SELECT_INTERVAL_MS / 1000;
+		timeout.tv_usec = (SELECT_INTERVAL_MS % 1000) * 1000;
+		int rc = ::select(maxFd + 1, &readSet, nullptr, nullptr, &timeout);
+		if (rc < 0) {
+			if (errno == EINTR) continue;
+			ESP_LOGE("HttpServerTask", "select failed: %s", strerror(errno));
+			break;
+		}
+		if (rc == 0) continue;
+
+		if (FD_ISSET(m_wakeSocket, &readSet)) {   // A worker handed back a connection, picked up at the top of the loop.
+			uint8_t buffer[16];
+			while (::recv(m_wakeSocket, buffer, sizeof(buffer), MSG_DONTWAIT) > 0) {}
+		}
+		std::vector<HttpConnection*> readable;
+		for (auto it = m_connections.begin(); it != m_connections.end(); ++it) {
+			if (!(*it)->m_busy && FD_ISSET((*it)->m_socket.getFD(), &readSet)) {
+				readable.push_back(*it);
+			}
+		}
+		for (auto it = readable.begin(); it != readable.end(); ++it) {
+			readRequest(*it);
+		}
+		if (FD_ISSET(listenFd, &readSet)) {
 			try {
-				clientSocket = m_pHttpServer->m_socket.accept();   // Block waiting for a new external client connection.
-				clientSocket.setTimeout(m_pHttpServer->getClientTimeout());
+				acceptConnection();
 			} catch (std::exception& e) {
 				ESP_LOGE("HttpServerTask", "Caught an exception waiting for new client!");
-				m_pHttpServer->m_semaphoreServerStarted.give();  // Release the semaphore .. we are now no longer running.
-				return;
+				break;
 			}
+		}
+	} // while
 
-			ESP_LOGD("HttpServerTask", "HttpServer that was listening on port %d has received a new client connection; sockFd=%d", m_pHttpServer->getPort(), clientSocket.getFD());
+	shutdown();
+	finish(stopped, m_pHttpServer);
+} // run
 
-			HttpRequest request(clientSocket);   // Build the HTTP Request from the socket.
-			if (request.isWebsocket()) {        // If this is a WebSocket
-				clientSocket.setTimeout(0);     //   Clear the timeout.
-			}
-			request.dump();                      // debug.
-			processRequest(request);             // Process the request.
-			if (!request.isWebsocket()) {        // If this is NOT a WebSocket, then close it as the request
-				request.close();                   //   has been completed.
-			}
-		} // while
-	} // run
-}; // HttpServerTask
+
+/**
+ * @brief Tell stop() that the server ended.  HttpServer deletes the task from then on.
+ * @param [in] data A reference to the HttpServer.
+ */
+void HttpServerTask::stopped(void* data) {
+	((HttpServer*) data)->m_semaphoreServerStarted.give();  // Release the semaphore .. we are now no longer running.
+} // stopped
 
 
 /**
- * @brief Register a handler for a path.
- *
- * When a browser request arrives, the request will contain a method (GET, POST, etc) and a path
- * to be accessed.  Using this method we can register a regular expression and, if the incoming method
- * and path match the expression, the corresponding handler will be called.
- *
- * Example:
- * @code{.cpp}
- * static void handle_REST_WiFi(WebServer::HttpRequest *pRequest, WebServer::HttpResponse *pResponse) {
- *	...
- * }
- *
- * webServer.addPathHandler("GET", "\\/ESP32\\/WiFi", handle_REST_WiFi);
- * @endcode
- *
- * @param [in] method The method being used for access ("GET", "POST" etc).
- * @param [in] pathExpr The path being accessed.
- * @param [in] handler The callback function to be invoked when a request arrives.
+ * @brief Hand a connection back to the server task.
+ * Called by a worker once it has served the connection.  A null connection signals that the worker ended.
+ * @param [in] pConnection The connection that was served.
  */
-void HttpServer::addPathHandler(
-		std::string method,
-		std::regex* pathExpr,
-		void (*handler)(HttpRequest* pHttpRequest, HttpResponse* pHttpResponse)) {
+void HttpServerTask::connectionDone(HttpConnection* pConnection) {
+	xQueueSend(m_doneQueue, &pConnection, portMAX_DELAY);
+	if (pConnection == nullptr) return;   // shutdown() waits on the queue, there is nothing to wake up.
+	uint8_t wake = 0;
+	::sendto(m_wakeSocket, &wake, sizeof(wake), 0, (struct sockaddr*) &m_wakeAddress, sizeof(m_wakeAddress));
+} // connectionDone
 
-	// We are maintaining a C++ vector of PathHandler objects.  We add a new entry into that vector.
-	m_pathHandlers.push_back(PathHandler(method, pathExpr, handler));
-} // addPathHandler
+
+/**
+ * @brief Create the socket the workers use to interrupt select().
+ * FreeRTOS has no pipes, so a UDP socket bound to the loopback interface serves the same purpose.
+ * @return True on success.
+ */
+bool HttpServerTask::createWakeSocket() {
+	m_wakeSocket = ::socket(AF_INET, SOCK_DGRAM, 0);
+	if (m_wakeSocket < 0) {
+		ESP_LOGE("HttpServerTask", "Unable to create the wake up socket: %s", strerror(errno));
+		return false;
+	}
+	memset(&m_wakeAddress, 0, sizeof(m_wakeAddress));
+	m_wakeAddress.sin_family      = AF_INET;
+	m_wakeAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	m_wakeAddress.sin_port        = 0;   // Let the stack pick a port.
+	socklen_t length = sizeof(m_wakeAddress);
+	if (::bind(m_wakeSocket, (struct sockaddr*) &m_wakeAddress, sizeof(m_wakeAddress)) != 0 ||
+			::getsockname(m_wakeSocket, (struct sockaddr*) &m_wakeAddress, &length) != 0) {
+		ESP_LOGE("HttpServerTask", "Unable to bind the wake up socket: %s", strerror(errno));
+		::closesocket(m_wakeSocket);
+		m_wakeSocket = -1;
+		return false;
+	}
+	return true;
+} // createWakeSocket
+
+
+/**
+ * @brief Accept a new client connection.
+ * If the server already has the maximum number of connections open, the client is answered with a 503.
+ */
+void HttpServerTask::acceptConnection() {
+	Socket clientSocket = m_pHttpServer->m_socket.accept();
+	ESP_LOGD("HttpServerTask", "HttpServer that was listening on port %d has received a new client connection; sockFd=%d", m_pHttpServer->getPort(), clientSocket.getFD());
+	if (m_connections.size() >= m_pHttpServer->m_maxConnections) {
+		ESP_LOGW("HttpServerTask", "Rejecting client, %d connections are open already", m_connections.size());
+		clientSocket.send((const uint8_t*) BUSY_RESPONSE, sizeof(BUSY_RESPONSE) - 1);
+		clientSocket.close();
+		return;
+	}
+	clientSocket.setTimeout(m_pHttpServer->getClientTimeout());
+	// A response is sent in pieces, the header first.  With Nagle's algorithm every piece after it waits
+	// for the ACK of the client, which delays it, so a keep-alive client would wait ~40 ms per request.
+	int noDelay = 1;
+	::setsockopt(clientSocket.getFD(), IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+	m_connections.push_back(new HttpConnection(clientSocket));
+} // acceptConnection
+
+
+/**
+ * @brief Close connections on which the client did not complete a request for longer than the client timeout.
+ */
+void HttpServerTask::closeIdleConnections() {
+	if (m_pHttpServer->getClientTimeout() == 0) return;
+	TickType_t now = xTaskGetTickCount();
+	TickType_t idleTimeout = pdMS_TO_TICKS(m_pHttpServer->getClientTimeout() * 1000);
+	for (auto it = m_connections.begin(); it != m_connections.end(); ) {
+		HttpConnection* pConnection = *it;
+		if (!pConnection->m_busy && now - pConnection->m_lastActivity > idleTimeout) {
+			ESP_LOGD("HttpServerTask", "Closing idle connection; sockFd=%d", pConnection->m_socket.getFD());
+			pConnection->m_socket.close();
+			delete pConnection;
+			it = m_connections.erase(it);
+		} else {
+			++it;
+		}
+	}
+} // closeIdleConnections
+
+
+/**
+ * @brief Receive what the client sent and pass the connection to a worker once a request is complete.
+ * select() reported the socket as readable, so this receive doesn't block.
+ * @param [in] pConnection An idle connection.
+ */
+void HttpServerTask::readRequest(HttpConnection* pConnection) {
+	if (pConnection->m_reader.fill() <= 0) {   // The client closed the connection or it failed.
+		ESP_LOGD("HttpServerTask", "Client closed the connection; sockFd=%d", pConnection->m_socket.getFD());
+		pConnection->m_socket.close();
+		removeConnection(pConnection);
+		return;
+	}
+	if (pConnection->hasRequest()) {
+		pConnection->m_busy = true;
+		xQueueSend(m_workQueue, &pConnection, portMAX_DELAY);   // Never blocks, the queue can hold every connection.
+	}
+} // readRequest
+
+
+/**
+ * @brief Take back a connection from a worker.
+ * Connections that ended or became WebSockets are forgotten, all others are watched for the next request.
+ * @param [in] pConnection The connection handed back, null if a worker ended.
+ */
+void HttpServerTask::releaseConnection(HttpConnection* pConnection) {
+	if (pConnection == nullptr) {
+		m_stoppedWorkers++;
+		return;
+	}
+	pConnection->m_busy         = false;
+	pConnection->m_lastActivity = xTaskGetTickCount();
+	if (pConnection->m_closed || pConnection->m_upgraded) {
+		removeConnection(pConnection);
+	}
+} // releaseConnection
+
+
+/**
+ * @brief Forget about a connection.  The socket is not closed here.
+ * @param [in] pConnection The connection to remove.
+ */
+void HttpServerTask::removeConnection(HttpConnection* pConnection) {
+	auto it = std::find(m_connections.begin(), m_connections.end(), pConnection);
+	if (it != m_connections.end()) {
+		m_connections.erase(it);
+	}
+	delete pConnection;
+} // removeConnection
+
+
+/**
+ * @brief Stop the workers and close all connections.
+ * Workers finish the connection they are serving before they see the request to stop.
+ */
+void HttpServerTask::shutdown() {
+	HttpConnection* pConnection = nullptr;
+	for (uint8_t i = 0; i < m_pHttpServer->m_workerCount; i++) {
+		xQueueSend(m_workQueue, &pConnection, portMAX_DELAY);
+	}
+	while (m_stoppedWorkers < m_pHttpServer->m_workerCount) {
+		if (xQueueReceive(m_doneQueue, &pConnection, portMAX_DELAY) == pdTRUE) {
+			releaseConnection(pConnection);
+		}
+	}
+	for (auto it = m_workers.begin(); it != m_workers.end(); ++it) {
+		delete *it;
+	}
+	m_workers.clear();
+	for (auto it = m_connections.begin(); it != m_connections.end(); ++it) {
+		(*it)->m_socket.close();
+		delete *it;
+	}
+	m_connections.clear();
+	vQueueDelete(m_workQueue);
+	vQueueDelete(m_doneQueue);
+	m_pHttpServer->m_socket.close();   // Stop listening for incoming requests.
+} // shutdown
+
+
+/**
+ * @brief Ask the server task to stop.
+ * Called by HttpServer::stop() from another task.  The wake up socket lives as long as the server task
+ * object, so this is safe even if the server task has ended already.
+ */
+void HttpServerTask::requestStop() {
+	m_stopRequested = true;
+	uint8_t wake = 0;
+	::sendto(m_wakeSocket, &wake, sizeof(wake), 0, (struct sockaddr*) &m_wakeAddress, sizeof(m_wakeAddress));
+} // requestStop
+
+
+
+
+HttpServer::~HttpServer() {
+	ESP_LOGD(LOG_TAG, "~HttpServer");
+	delete m_pServerTask;
+}
 
 
 /**
  * @brief Register a handler for a path.
  *
  * When a browser request arrives, the request will contain a method (GET, POST, etc) and a path
- * to be accessed.  Using this method we can register a regular expression and, if the incoming method
- * and path match the expression, the corresponding handler will be called.
+ * to be accessed.  Using this method we can register a path pattern and, if the incoming method
+ * and path match the pattern, the corresponding handler will be called.  A pattern segment can be
+ * a literal, a `:name` capture or a trailing `*` wildcard, see HttpRouter.  Captured values are
+ * available to the handler through HttpRequest::getPathParam().
+ *
+ * Handlers have to be registered before the server is started.
  *
  * Example:
  * @code{.cpp}
@@ -206,10 +607,11 @@ void HttpServer::addPathHandler(
  * }
  *
  * webServer.addPathHandler("GET", "/ESP32/WiFi", handle_REST_WiFi);
+ * webServer.addPathHandler("GET", "/ESP32/GPIO/:pin", handle_REST_GPIO);
  * @endcode
  *
  * @param [in] method The method being used for access ("GET", "POST" etc).
- * @param [in] path The plain path being accessed.
+ * @param [in] path The path pattern being accessed.
  * @param [in] handler The callback function to be invoked when a request arrives.
  */
 void HttpServer::addPathHandler(
@@ -217,7 +619,11 @@ void HttpServer::addPathHandler(
 		std::string path,
 		void (*handler)(HttpRequest* pHttpRequest, HttpResponse* pHttpResponse)) {
 
-	// We are maintaining a C++ vector of PathHandler objects.  We add a new entry into that vector.
+	// We are maintaining a C++ vector of PathHandler objects.  The route table maps to the index in that vector.
+	if (!m_router.addRoute(method, path, m_pathHandlers.size())) {
+		ESP_LOGE(LOG_TAG, "Unable to add path handler for %s %s", method.c_str(), path.c_str());
+		return;
+	}
 	m_pathHandlers.push_back(PathHandler(method, path, handler));
 } // addPathHandler
 
@@ -234,6 +640,15 @@ size_t HttpServer::getFileBufferSize() {
 } // getFileBufferSize
 
 
+/**
+ * @brief Get the maximum number of client connections that can be open at the same time.
+ * @return The maximum number of client connections.
+ */
+size_t HttpServer::getMaxConnections() {
+	return m_maxConnections;
+} // getMaxConnections
+
+
 /**
  * @brief Get the port number on which the HTTP Server is listening.
  * @return The port number on which the HTTP server is listening.
@@ -252,6 +667,15 @@ std::string HttpServer::getRootPath() {
 } // getRootPath
 
 
+/**
+ * @brief Get the number of tasks that process requests.
+ * @return The number of worker tasks.
+ */
+uint8_t HttpServer::getWorkerCount() {
+	return m_workerCount;
+} // getWorkerCount
+
+
 /**
  * @brief Return whether or not we are using SSL.
  * @return True if we are using SSL.
@@ -351,6 +775,17 @@ void HttpServer::setFileBufferSize(size_t fileBufferSize) {
 } // setFileBufferSize
 
 
+/**
+ * @brief Set the maximum number of client connections that can be open at the same time.
+ * Further clients are answered with a 503.  Each connection uses a socket and a request buffer, so
+ * the limit has to leave room for the other sockets of the application.  Takes effect on the next start().
+ * @param [in] maxConnections The maximum number of client connections.
+ */
+void HttpServer::setMaxConnections(size_t maxConnections) {
+	m_maxConnections = maxConnections;
+} // setMaxConnections
+
+
 /**
  * @brief Set the root path for URL file mapping.
  *
@@ -378,6 +813,16 @@ void HttpServer::setRootPath(std::string path) {
 } // setRootPath
 
 
+/**
+ * @brief Set the number of tasks that process requests.
+ * Every worker is a task with its own stack, handlers run on these stacks.  Takes effect on the next start().
+ * @param [in] workerCount The number of worker tasks, at least one.
+ */
+void HttpServer::setWorkerCount(uint8_t workerCount) {
+	m_workerCount = workerCount > 0 ? workerCount : 1;
+} // setWorkerCount
+
+
 /**
  * @brief Start the HTTP server listening.
  * We start an instance of the HTTP server listening.  A new task is spawned to perform this work in the
@@ -400,8 +845,9 @@ void HttpServer::start(uint16_t portNumber, bool useSSL) {
 	m_useSSL     = useSSL;
 	m_portNumber = portNumber;
 
-	HttpServerTask* pHttpServerTask = new HttpServerTask("HttpServerTask");
-	pHttpServerTask->start(this);
+	delete m_pServerTask;   // The task of the previous start has ended, or we could not have taken the semaphore.
+	m_pServerTask = new HttpServerTask("HttpServerTask");
+	m_pServerTask->start(this);
 	ESP_LOGD(LOG_TAG, "<< start");
 } // start
 
@@ -410,11 +856,12 @@ void HttpServer::start(uint16_t portNumber, bool useSSL) {
  * @brief Shutdown the HTTP server.
  */
 void HttpServer::stop() {
-	// Shutdown the HTTP Server.  The high level is that we will stop the server socket
-	// that is listening for incoming connections.  That will then shutdown all the other
-	// activities.
+	// Shutdown the HTTP Server.  The high level is that we ask the server task to stop.  It closes the
+	// socket that is listening for incoming connections and then shuts down all the other activities.
 	ESP_LOGD(LOG_TAG, ">> stop");
-	m_socket.close();                      // Close the socket that is being used to watch for incoming requests.
+	if (m_pServerTask != nullptr) {
+		m_pServerTask->requestStop();
+	}
 	m_semaphoreServerStarted.wait("stop"); // Wait for the server to stop.
 	ESP_LOGD(LOG_TAG, "<< stop");
 } // stop
@@ -427,27 +874,6 @@ void HttpServer::stop() {
  * @param [in] pathPattern The path pattern to be matched.
  * @param [in] webServerRequestHandler The request handler to be called.
  */
-PathHandler::PathHandler(std::string method, std::regex* pRegex,
-		void (*pWebServerRequestHandler)
-		(
-			HttpRequest*  pHttpRequest,
-			HttpResponse* pHttpResponse)
-		) {
-	m_method          = method;                  // Save the method we are looking for.
-	m_pRegex          = pRegex;                  // Save the Regex
-	m_textPattern     = "<Regex>";               // The plain text of the regex pattern.
-	m_isRegex         = true;
-	m_pRequestHandler = pWebServerRequestHandler; // The handler to be invoked if the pattern matches.
-} // PathHandler
-
-
-/**
- * @brief Construct an instance of a PathHandler.
- *
- * @param [in] method The method to be matched.
- * @param [in] pathPattern The path to be matched.  Must be an exact match.
- * @param [in] webServerRequestHandler The request handler to be called.
- */
 PathHandler::PathHandler(std::string method, std::string matchPath,
 		void (*pWebServerRequestHandler)
 		(
@@ -456,30 +882,10 @@ PathHandler::PathHandler(std::string method, std::string matchPath,
 		) {
 	m_method          = method;                  // Save the method we are looking for.
 	m_textPattern     = matchPath;
-	m_isRegex         = false;
-	m_pRegex          = nullptr;
 	m_pRequestHandler = pWebServerRequestHandler; // The handler to be invoked if the pattern matches.
 } // PathHandler
 
 
-/**
- * @brief Determine if the path matches.
- *
- * @param [in] method The method to be matched.
- * @param [in] path The path to be matched.
- * @return True if the path matches.
- */
-bool PathHandler::match(std::string method, std::string path) {
-	if (method != m_method) return false;
-	if (m_isRegex) {
-		ESP_LOGD("PathHandler", "regex matching: %s with %s", m_textPattern.c_str(), path.c_str());
-		return std::regex_search(path, *m_pRegex);
-	}
-	ESP_LOGD("PathHandler", "plain matching: %s with %s", m_textPattern.c_str(), path.c_str());
-	return m_textPattern.compare(0, m_textPattern.length(), path) ==0;
-} // match
-
-
 /**
  * @brief Invoke the handler.
  * @param [in] request An object representing the request.
@@ -17,9 +17,10 @@
 #include "HttpRequest.h"
 #include "HttpResponse.h"
 #include "FreeRTOS.h"
-#include <regex>
+#include "HttpRouter.h"
 
 class HttpServerTask;
+class HttpServerWorker;
 
 /**
  * @brief Handle path matching for an incoming HTTP request.
@@ -34,20 +35,9 @@ class PathHandler {
 				HttpRequest*  pHttpRequest,
 				HttpResponse* pHttpResponse)
 			);
-		PathHandler(
-			std::string method,                // The method in the request to be matched.
-			std::regex* pathPattern,           // The pattern in the request to be matched (regex)
-			void (*pWebServerRequestHandler)   // The handler function to be invoked upon a match.
-			(
-				HttpRequest*  pHttpRequest,
-				HttpResponse* pHttpResponse)
-			);
-		bool match(std::string method, std::string path);   // Does the request method and pattern match?
 		void invokePathHandler(HttpRequest* request, HttpResponse* response);
 	private:
 		std::string m_method;
-		std::regex* m_pRegex;
-		bool        m_isRegex;
 		std::string m_textPattern;
 		void (*m_pRequestHandler)(HttpRequest* pHttpRequest, HttpResponse* pHttpResponse);
 }; // PathHandler
@@ -66,38 +56,39 @@ public:
 			HttpRequest*  pHttpRequest,
 			HttpResponse* pHttpResponse)
 		);
-	void        addPathHandler(
-		std::string method,
-		std::regex* pRegex,
-		void (*webServerRequestHandler)
-		(
-			HttpRequest*  pHttpRequest,
-			HttpResponse* pHttpResponse)
-		);
 	uint32_t    getClientTimeout();							// Get client's socket timeout
 	size_t      getFileBufferSize();  // Get the current size of the file buffer.
+	size_t      getMaxConnections();  // Get the maximum number of open client connections.
 	uint16_t    getPort();            // Get the port on which the Http server is listening.
 	std::string getRootPath();        // Get the root of the file system path.
+	uint8_t     getWorkerCount();     // Get the number of tasks processing requests.
 	bool        getSSL();             // Are we using SSL?
 	void        setClientTimeout(uint32_t timeout);			   // Set client's socket timeout
 	void        setDirectoryListing(bool use);             // Should we list the content of directories?
 	void        setFileBufferSize(size_t fileBufferSize);  // Set the size of the file buffer
+	void        setMaxConnections(size_t maxConnections);  // Set the maximum number of open client connections.
 	void        setRootPath(std::string path);             // Set the root of the file system path.
+	void        setWorkerCount(uint8_t workerCount);       // Set the number of tasks processing requests.
 	void        start(uint16_t portNumber, bool useSSL = false);
 	void        stop();          // Stop a previously started server.
 
 private:
 	friend class HttpServerTask;
+	friend class HttpServerWorker;
 	friend class WebSocket;
 	void                     listDirectory(std::string path, HttpResponse& response);
 	size_t                   m_fileBufferSize;     // Size of the file buffer.
 	bool                     m_directoryListing;   // Should we list directory content?
 	std::vector<PathHandler> m_pathHandlers;       // Vector of path handlers.
+	HttpRouter               m_router;             // Maps method and path to an index into m_pathHandlers.
 	uint16_t                 m_portNumber;         // Port number on which server is listening.
 	std::string              m_rootPath;           // Root path into the file system.
 	Socket                   m_socket;
 	bool                     m_useSSL;             // Is this server listening on an HTTPS port?
-	uint32_t                 m_clientTimeout;      // Default Timeout
+	uint32_t                 m_clientTimeout;      // Default Timeout, also the idle time after which a kept alive connection is closed.
+	size_t                   m_maxConnections;     // Maximum number of client connections open at the same time.
+	uint8_t                  m_workerCount;        // Number of tasks processing requests.
+	HttpServerTask*          m_pServerTask;        // The task of the last start(), deleted once it has ended.
 	FreeRTOS::Semaphore      m_semaphoreServerStarted = FreeRTOS::Semaphore("ServerStarted");
 }; // HttpServer
 
@@ -181,7 +181,7 @@ std::string JsonArray::getString(int item) {
 std::string JsonArray::toString() {
 	char* data = cJSON_Print(m_node);
 	std::string ret(data);
-	free(data);
+	cJSON_free(data);
 	return ret;
 } // toString
 
@@ -193,7 +193,7 @@ std::string JsonArray::toString() {
 std::string JsonArray::toStringUnformatted() {
 	char* data = cJSON_PrintUnformatted(m_node);
 	std::string ret(data);
-	free(data);
+	cJSON_free(data);
 	return ret;
 } // toStringUnformatted
 
@@ -369,7 +369,7 @@ void JsonObject::setString(std::string name, std::string value) {
 std::string JsonObject::toString() {
 	char* data = cJSON_Print(m_node);
 	std::string ret(data);
-	free(data);
+	cJSON_free(data);
 	return ret;
 } // toString
 
@@ -381,6 +381,6 @@ std::string JsonObject::toString() {
 std::string JsonObject::toStringUnformatted() {
 	char* data = cJSON_PrintUnformatted(m_node);
 	std::string ret(data);
-	free(data);
+	cJSON_free(data);
 	return ret;
 } // toStringUnformatted
@@ -59,7 +59,7 @@ Socket Socket::accept() {
 	getBind(&addr);
 	ESP_LOGD(LOG_TAG, ">> accept: Accepting on %s; sockFd: %d, using SSL: %d", addressToString(&addr).c_str(), m_sock, getSSL());
 	struct sockaddr_in client_addr;
-	socklen_t sin_size;
+	socklen_t sin_size = sizeof(client_addr);
 	int clientSockFD = ::lwip_accept_r(m_sock,  (struct sockaddr*) &client_addr, &sin_size);
 	//printf("------> new connection client %s:%d\n", inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port));
 	if (clientSockFD == -1) {
@@ -311,6 +311,12 @@ int Socket::setTimeout(uint32_t seconds) {
 }
 
 
+/**
+ * @brief Read until the delimiter is found.
+ * This issues one receive per byte.  Use a SocketReader to read through a buffer instead.
+ * @param [in] delim The delimiter to read up to.
+ * @return The data read before the delimiter.
+ */
 std::string Socket::readToDelim(std::string delim) {
 	std::string ret;
 	std::string part;
@@ -448,6 +454,92 @@ int Socket::send(const uint8_t* data, size_t length) const {
 } // send
 
 
+/**
+ * @brief Send data from several buffers with a single call.
+ *
+ * The buffers are sent in order as if they were one, which lets a caller put a protocol header and a
+ * payload on the wire without copying them together first.
+ *
+ * @param [in] iov The buffers to send.
+ * @param [in] iovCount The number of buffers, at most MAX_IOV.
+ * @param [in] wait If true, block until everything is sent.  If false, send only what the stack can
+ * take right now.  SSL sockets always block.
+ * @return The number of bytes sent, which is less than the total if wait is false or the send timeout
+ * expired, or a negative value on error.
+ */
+int Socket::send(const struct iovec* iov, int iovCount, bool wait) const {
+	int total = 0;
+	if (getSSL()) {
+		for (int i = 0; i < iovCount; i++) {
+			int rc = send((const uint8_t*) iov[i].iov_base, iov[i].iov_len);
+			if (rc < 0) return rc;
+			total += iov[i].iov_len;
+		}
+		return total;
+	}
+
+	struct iovec remaining[MAX_IOV];   // Copy as the entries are advanced over partially sent data.
+	if (iovCount > MAX_IOV) {
+		ESP_LOGE(LOG_TAG, "send: %d buffers, at most %d are supported", iovCount, MAX_IOV);
+		return -1;
+	}
+	memcpy(remaining, iov, iovCount * sizeof(struct iovec));
+	int first = 0;
+	while (first < iovCount) {
+		struct msghdr message;
+		memset(&message, 0, sizeof(message));
+		message.msg_iov    = &remaining[first];
+		message.msg_iovlen = iovCount - first;
+		int rc = ::lwip_sendmsg_r(m_sock, &message, wait ? 0 : MSG_DONTWAIT);
+		if (rc < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				if (!wait || !waitWritable()) break;
+				continue;
+			}
+			ESP_LOGE(LOG_TAG, "send: socket=%d, %s", m_sock, strerror(errno));
+			return rc;
+		}
+		total += rc;
+		size_t sent = rc;
+		while (first < iovCount && sent >= remaining[first].iov_len) {
+			sent -= remaining[first].iov_len;
+			first++;
+		}
+		if (first < iovCount) {
+			remaining[first].iov_base = (uint8_t*) remaining[first].iov_base + sent;
+			remaining[first].iov_len -= sent;
+			if (!wait) break;
+		}
+	}
+	return total;
+} // send
+
+
+/**
+ * @brief Wait until the socket can take more data.
+ * Waits at most the send timeout set with setTimeout(), or forever if none is set.
+ * @return True if the socket is writable, false if the timeout expired or select() failed.
+ */
+bool Socket::waitWritable() const {
+	struct timeval timeout;
+	socklen_t length = sizeof(timeout);
+	if (::getsockopt(m_sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, &length) != 0) {
+		timeout.tv_sec  = 0;
+		timeout.tv_usec = 0;
+	}
+	bool hasTimeout = timeout.tv_sec != 0 || timeout.tv_usec != 0;
+	fd_set writeSet;
+	FD_ZERO(&writeSet);
+	FD_SET(m_sock, &writeSet);
+	int rc = ::select(m_sock + 1, nullptr, &writeSet, nullptr, hasTimeout ? &timeout : nullptr);
+	if (rc <= 0) {
+		ESP_LOGW(LOG_TAG, "send: socket=%d not writable, %s", m_sock, rc == 0 ? "timeout" : strerror(errno));
+		return false;
+	}
+	return true;
+} // waitWritable
+
+
 /**
  * @brief Send a string to the partner.
  *
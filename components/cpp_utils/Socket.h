@@ -61,6 +61,7 @@ private:
  */
 class Socket {
 public:
+	static const int MAX_IOV = 16;   // Most buffers a single scatter/gather send accepts.
 	Socket();
 	virtual ~Socket();
 
@@ -85,6 +86,7 @@ public:
 	int  receiveFrom(uint8_t* data, size_t length, struct sockaddr* pAddr);
 	int  send(std::string value) const;
 	int  send(const uint8_t* data, size_t length) const;
+	int  send(const struct iovec* iov, int iovCount, bool wait = true) const;
 	int  send(uint16_t value);
 	int  send(uint32_t value);
 	void sendTo(const uint8_t* data, size_t length, struct sockaddr* pAddr);
@@ -102,6 +104,7 @@ private:
 	mbedtls_x509_crt         m_srvcert;
 	mbedtls_pk_context       m_pkey;
 	void sslHandshake();
+	bool waitWritable() const;
 
 };
 
@@ -0,0 +1,202 @@
+/*
+ * SocketReader.cpp
+ *
+ * Buffered reading from a Socket.
+ */
+#include <string.h>
+#include <esp_log.h>
+#include "SocketReader.h"
+
+static const char* LOG_TAG = "SocketReader";
+
+
+/**
+ * @brief Create a reader on a socket.
+ * @param [in] socket The socket to read from.
+ * @param [in] bufferSize The size of the refill buffer.  This also limits how much data a parser
+ * can look at in one piece.
+ */
+SocketReader::SocketReader(Socket socket, size_t bufferSize) {
+	m_socket       = socket;
+	m_bufferSize   = bufferSize;
+	m_buffer       = new uint8_t[bufferSize];
+	m_start        = 0;
+	m_end          = 0;
+	m_receiveCount = 0;
+} // SocketReader
+
+
+SocketReader::~SocketReader() {
+	delete[] m_buffer;
+} // ~SocketReader
+
+
+/**
+ * @brief Get the number of buffered bytes that have not been consumed yet.
+ * @return The number of available bytes.
+ */
+size_t SocketReader::available() const {
+	return m_end - m_start;
+} // available
+
+
+size_t SocketReader::capacity() const {
+	return m_bufferSize;
+} // capacity
+
+
+/**
+ * @brief Mark buffered data as processed.
+ * @param [in] length The number of bytes to consume, limited to the available bytes.
+ */
+void SocketReader::consume(size_t length) {
+	if (length > available()) {
+		length = available();
+	}
+	m_start += length;
+	if (m_start == m_end) {
+		m_start = m_end = 0;
+	}
+} // consume
+
+
+/**
+ * @brief Move the unconsumed data to the start of the buffer to make room at the end.
+ */
+void SocketReader::compact() {
+	if (m_start == 0) return;
+	::memmove(m_buffer, m_buffer + m_start, available());
+	m_end  -= m_start;
+	m_start = 0;
+} // compact
+
+
+const uint8_t* SocketReader::data() const {
+	return m_buffer + m_start;
+} // data
+
+
+/**
+ * @brief Receive more data from the socket.
+ * A single receive is issued for all of the free space in the buffer.  Unconsumed data is kept, but
+ * may move, so pointers returned from data() are invalid afterwards.
+ * @return The number of bytes received, 0 if the partner closed the connection or the buffer is full
+ * and -1 on an error.
+ */
+int SocketReader::fill() {
+	compact();
+	if (isFull()) {
+		ESP_LOGD(LOG_TAG, "fill: buffer of %d bytes is full", m_bufferSize);
+		return 0;
+	}
+	m_receiveCount++;
+	int rc = (int) m_socket.receive(m_buffer + m_end, m_bufferSize - m_end);
+	if (rc > 0) {
+		m_end += rc;
+	}
+	return rc;
+} // fill
+
+
+Socket SocketReader::getSocket() const {
+	return m_socket;
+} // getSocket
+
+
+uint32_t SocketReader::getReceiveCount() const {
+	return m_receiveCount;
+} // getReceiveCount
+
+
+bool SocketReader::isFull() const {
+	return m_start == 0 && m_end == m_bufferSize;
+} // isFull
+
+
+/**
+ * @brief Read up to length bytes.
+ * Buffered data is returned first.  If nothing is buffered, a single receive is issued.  Large reads
+ * bypass the buffer and go straight into the caller's memory.
+ * @param [in] data The storage for the data.
+ * @param [in] length The maximum number of bytes to read.
+ * @return The number of bytes read, 0 on end of stream and -1 on error.
+ */
+int SocketReader::read(uint8_t* data, size_t length) {
+	if (available() == 0) {
+		if (length >= m_bufferSize) {
+			m_receiveCount++;
+			return (int) m_socket.receive(data, length);
+		}
+		int rc = fill();
+		if (rc <= 0) return rc;
+	}
+	size_t amount = length < available() ? length : available();
+	::memcpy(data, this->data(), amount);
+	consume(amount);
+	return amount;
+} // read
+
+
+/**
+ * @brief Read exactly length bytes unless the stream ends early.
+ * @param [in] data The storage for the data.
+ * @param [in] length The number of bytes to read.
+ * @param [in] exact Keep reading until length bytes were read.
+ * @return The number of bytes read or -1 on error.
+ */
+int SocketReader::read(uint8_t* data, size_t length, bool exact) {
+	if (!exact) return read(data, length);
+	size_t total = 0;
+	while (total < length) {
+		int rc = read(data + total, length - total);
+		if (rc < 0) return total > 0 ? total : -1;
+		if (rc == 0) break;
+		total += rc;
+	}
+	return total;
+} // read
+
+
+/**
+ * @brief Read until the delimiter is found.
+ * The delimiter is consumed but not part of the returned string.
+ * @param [in] delim The delimiter to look for.
+ * @param [in] maxLength Stop after this many bytes even if the delimiter was not found.
+ * @return The data read before the delimiter.
+ */
+std::string SocketReader::readToDelim(const std::string& delim, size_t maxLength) {
+	std::string ret;
+	while (true) {
+		const char* start = (const char*) data();
+		std::string::size_type found = std::string::npos;
+		size_t avail = available();
+		if (avail >= delim.length()) {
+			for (size_t i = 0; i + delim.length() <= avail; i++) {
+				if (::memcmp(start + i, delim.data(), delim.length()) == 0) {
+					found = i;
+					break;
+				}
+			}
+		}
+		if (found != std::string::npos) {
+			ret.append(start, found);
+			consume(found + delim.length());
+			return ret;
+		}
+		if (ret.length() + avail >= maxLength) {
+			ret.append(start, avail);
+			consume(avail);
+			return ret;
+		}
+		// Keep a possible partial delimiter at the end of the buffer
+		size_t keep = avail < delim.length() ? avail : delim.length() - 1;
+		ret.append(start, avail - keep);
+		consume(avail - keep);
+		int rc = fill();
+		if (rc <= 0) {
+			ret.append((const char*) data(), available());
+			consume(available());
+			return ret;
+		}
+	}
+} // readToDelim
@@ -0,0 +1,50 @@
+/*
+ * SocketReader.h
+ *
+ * Buffered reading from a Socket.
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_SOCKETREADER_H_
+#define COMPONENTS_CPP_UTILS_SOCKETREADER_H_
+#include <stdint.h>
+#include <string>
+#include "Socket.h"
+
+/**
+ * @brief Buffered reader on top of a socket.
+ *
+ * The reader owns a fixed size buffer that is refilled with as much data as the socket has available
+ * in a single receive call.  Parsers can look at the buffered data directly through data()/available()
+ * and consume() what they have processed, which avoids a receive call per byte.
+ */
+class SocketReader {
+public:
+	SocketReader(Socket socket, size_t bufferSize = 1024);
+	virtual ~SocketReader();
+
+	size_t         available() const;                            // Number of buffered bytes not yet consumed.
+	size_t         capacity() const;                             // Size of the refill buffer.
+	void           consume(size_t length);                       // Mark buffered bytes as processed.
+	const uint8_t* data() const;                                 // Start of the buffered, unconsumed data.
+	int            fill();                                       // Receive more data into the free buffer space.
+	bool           isFull() const;                               // Is there no more space to fill?
+	int            read(uint8_t* data, size_t length);           // Read up to length bytes.
+	int            read(uint8_t* data, size_t length, bool exact);
+	std::string    readToDelim(const std::string& delim, size_t maxLength = 1024);
+	Socket         getSocket() const;
+	uint32_t       getReceiveCount() const;                      // Number of receive calls on the socket.
+
+private:
+	Socket   m_socket;
+	uint8_t* m_buffer;
+	size_t   m_bufferSize;
+	size_t   m_start;         // Offset of the first unconsumed byte.
+	size_t   m_end;           // Offset after the last buffered byte.
+	uint32_t m_receiveCount;
+	void     compact();
+
+	SocketReader(const SocketReader&) = delete;
+	SocketReader& operator=(const SocketReader&) = delete;
+};
+
+#endif /* COMPONENTS_CPP_UTILS_SOCKETREADER_H_ */
@@ -12,6 +12,7 @@
 #include <string>
 
 #include "Task.h"
+#include "TaskRegistry.h"
 #include "sdkconfig.h"
 
 static const char* LOG_TAG = "Task";
@@ -72,6 +73,7 @@ void Task::start(void* taskData) {
 		ESP_LOGW(LOG_TAG, "Task::start - There might be a task already running!");
 	}
 	m_taskData = taskData;
+	TaskRegistry::add(m_taskName.c_str(), m_stackSize);   // Before the task runs, it may end and remove itself right away.
 	::xTaskCreatePinnedToCore(&runTask, m_taskName.c_str(), m_stackSize, this, m_priority, &m_handle, m_coreId);
 } // start
 
@@ -85,9 +87,27 @@ void Task::stop() {
 	if (m_handle == nullptr) return;
 	xTaskHandle temp = m_handle;
 	m_handle = nullptr;
+	TaskRegistry::remove(m_taskName.c_str());
 	::vTaskDelete(temp);
 } // stop
 
+
+/**
+ * @brief End the task from within without using the instance any more.
+ * When run() returns, runTask() still uses the instance.  A task whose instance is deleted by another
+ * task, once that task learns that it ended, calls this from run() instead of returning.
+ * @param [in] pReleased Called once the instance is no longer used, it may be deleted from then on.
+ * @param [in] arg The argument passed to the callback.
+ * @return Never returns.
+ */
+void Task::finish(void (*pReleased)(void*), void* arg) {
+	m_handle = nullptr;
+	TaskRegistry::remove(m_taskName.c_str());
+	pReleased(arg);
+	::vTaskDelete(nullptr);
+} // finish
+
+
 /**
  * @brief Set the stack size of the task.
  *
@@ -41,6 +41,7 @@ public:
 	void setCore(BaseType_t coreId);
 	void start(void* taskData = nullptr);
 	void stop();
+	void finish(void (*pReleased)(void*), void* arg);
 	/**
 	 * @brief Body of the task to execute.
 	 *
@@ -0,0 +1,256 @@
+/*
+ * TaskRegistry.cpp
+ *
+ * Runtime statistics of the tasks of the application.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include "FreeRTOS.h"
+#include "TaskRegistry.h"
+#include "sdkconfig.h"
+
+static const char* LOG_TAG = "TaskRegistry";
+
+ESP_EVENT_DEFINE_BASE(TASK_REGISTRY_EVENT);
+
+#define TASK_REGISTRY_PROBE 0
+
+// A registered task.  Free entries have an empty name.
+struct TaskEntry {
+	char                    name[configMAX_TASK_NAME_LEN];
+	uint32_t                stackSize;
+	esp_event_loop_handle_t loop;
+	uint32_t                latencyCount;
+	uint32_t                latencyMaxUs;
+	uint64_t                latencyTotalUs;
+};
+
+static TaskEntry           s_entries[TaskRegistry::MAX_TASKS] = {};
+static portMUX_TYPE        s_mux        = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t  s_probeTimer = nullptr;
+
+// Run time counters of the previous sample, to report the CPU share in between.
+struct LastRunTime {
+	UBaseType_t taskNumber;
+	uint32_t    runTime;
+};
+static LastRunTime         s_lastRunTimes[TaskRegistry::MAX_TASKS * 2];
+static size_t              s_lastRunTimeCount = 0;
+static uint32_t            s_lastTotalRunTime = 0;
+static FreeRTOS::Semaphore s_sampleLock("TaskRegistry");
+
+
+/**
+ * @brief Find a registered task.
+ * Has to be called inside the critical section.
+ * @param [in] name The name of the task.  Only compared up to the length FreeRTOS keeps of a name.
+ * @return The index of the entry or -1.
+ */
+int TaskRegistry::find(const char* name) {
+	for (int i = 0; i < MAX_TASKS; i++) {
+		if (s_entries[i].name[0] != '\0' && strncmp(s_entries[i].name, name, configMAX_TASK_NAME_LEN - 1) == 0) {
+			return i;
+		}
+	}
+	return -1;
+} // find
+
+
+/**
+ * @brief Add or update an entry.
+ * @return The index of the entry or -1 if the registry is full.
+ */
+int TaskRegistry::insert(const char* name, uint32_t stackSize, esp_event_loop_handle_t loop) {
+	portENTER_CRITICAL(&s_mux);
+	int index = find(name);
+	if (index < 0) {
+		for (int i = 0; i < MAX_TASKS; i++) {
+			if (s_entries[i].name[0] == '\0') {
+				index = i;
+				memset(&s_entries[i], 0, sizeof(s_entries[i]));
+				strncpy(s_entries[i].name, name, configMAX_TASK_NAME_LEN - 1);
+				break;
+			}
+		}
+	}
+	if (index >= 0) {
+		s_entries[index].stackSize = stackSize;
+		if (loop != nullptr) {
+			s_entries[index].loop = loop;
+		}
+	}
+	portEXIT_CRITICAL(&s_mux);
+
+	if (index < 0) {
+		ESP_LOGE(LOG_TAG, "More than %d tasks, %s is not registered", MAX_TASKS, name);
+	}
+	return index;
+} // insert
+
+
+/**
+ * @brief Register a task.
+ * @param [in] name The name the task was created with.
+ * @param [in] stackSize The stack size the task was created with.
+ * @return False if the registry is full.
+ */
+bool TaskRegistry::add(const char* name, uint32_t stackSize) {
+	return insert(name, stackSize, nullptr) >= 0;
+} // add
+
+
+/**
+ * @brief Register the task of an event loop and measure its scheduling latency.
+ * @param [in] loop The event loop.
+ * @param [in] name The task_name the loop was created with.
+ * @param [in] stackSize The task_stack_size the loop was created with.
+ * @return False if the task could not be registered.
+ */
+bool TaskRegistry::addEventLoop(esp_event_loop_handle_t loop, const char* name, uint32_t stackSize) {
+	int index = insert(name, stackSize, loop);
+	if (index < 0) return false;
+
+	esp_err_t errRc = ::esp_event_handler_register_with(loop, TASK_REGISTRY_EVENT, TASK_REGISTRY_PROBE,
+		probeHandler, (void*) (intptr_t) index);
+	if (errRc != ESP_OK) {
+		ESP_LOGE(LOG_TAG, "esp_event_handler_register_with: rc=%d %s", errRc, esp_err_to_name(errRc));
+		return false;
+	}
+
+	if (s_probeTimer == nullptr) {
+		esp_timer_create_args_t timerArgs = {};
+		timerArgs.callback = postProbes;
+		timerArgs.name     = "task_probe";
+		::esp_timer_create(&timerArgs, &s_probeTimer);
+		::esp_timer_start_periodic(s_probeTimer, PROBE_INTERVAL_MS * 1000);
+	}
+	return true;
+} // addEventLoop
+
+
+/**
+ * @brief Forget a task, for example because it was deleted.
+ * @param [in] name The name of the task.
+ */
+void TaskRegistry::remove(const char* name) {
+	portENTER_CRITICAL(&s_mux);
+	int index = find(name);
+	if (index >= 0 && s_entries[index].loop == nullptr) {   // Loops keep their probe handler, so their entries stay.
+		s_entries[index].name[0] = '\0';
+	}
+	portEXIT_CRITICAL(&s_mux);
+} // remove
+
+
+/**
+ * @brief Post a timestamped probe to every registered event loop.
+ * Runs on the esp_timer task.  A loop whose queue is full just misses this probe.
+ */
+void TaskRegistry::postProbes(void* arg) {
+	esp_event_loop_handle_t loops[MAX_TASKS];
+	size_t count = 0;
+	portENTER_CRITICAL(&s_mux);
+	for (int i = 0; i < MAX_TASKS; i++) {
+		if (s_entries[i].loop != nullptr) {
+			loops[count++] = s_entries[i].loop;
+		}
+	}
+	portEXIT_CRITICAL(&s_mux);
+
+	for (size_t i = 0; i < count; i++) {
+		int64_t now = ::esp_timer_get_time();
+		::esp_event_post_to(loops[i], TASK_REGISTRY_EVENT, TASK_REGISTRY_PROBE, &now, sizeof(now), 0);
+	}
+} // postProbes
+
+
+/**
+ * @brief Record the time a probe waited for the event loop task.
+ */
+void TaskRegistry::probeHandler(void* arg, esp_event_base_t base, int32_t id, void* data) {
+	uint32_t latencyUs = ::esp_timer_get_time() - *(int64_t*) data;
+	TaskEntry& entry = s_entries[(intptr_t) arg];
+	portENTER_CRITICAL(&s_mux);
+	entry.latencyCount++;
+	entry.latencyTotalUs += latencyUs;
+	if (latencyUs > entry.latencyMaxUs) {
+		entry.latencyMaxUs = latencyUs;
+	}
+	portEXIT_CRITICAL(&s_mux);
+} // probeHandler
+
+
+/**
+ * @brief Take a snapshot of the statistics of all tasks.
+ * Registered tasks that use more than 100 - LOW_STACK_PERCENT percent of their stack are logged.
+ * @param [out] pInfos Receives one entry per task.
+ * @param [in] maxInfos The size of pInfos.
+ * @return The number of entries filled in.
+ */
+size_t TaskRegistry::sample(Info* pInfos, size_t maxInfos) {
+#if configUSE_TRACE_FACILITY
+	UBaseType_t taskCount = ::uxTaskGetNumberOfTasks() + 2;   // Leave room for tasks created in between.
+	TaskStatus_t* pStatus = (TaskStatus_t*) malloc(taskCount * sizeof(TaskStatus_t));
+	if (pStatus == nullptr) {
+		ESP_LOGE(LOG_TAG, "No memory for %d task states", taskCount);
+		return 0;
+	}
+	uint32_t totalRunTime = 0;
+	taskCount = ::uxTaskGetSystemState(pStatus, taskCount, &totalRunTime);
+
+	s_sampleLock.take("sample");
+	uint32_t elapsed = (totalRunTime - s_lastTotalRunTime) * portNUM_PROCESSORS;
+	size_t count = 0;
+	for (UBaseType_t i = 0; i < taskCount && count < maxInfos; i++) {
+		Info& info = pInfos[count++];
+		memset(&info, 0, sizeof(info));
+		strncpy(info.name, pStatus[i].pcTaskName, configMAX_TASK_NAME_LEN - 1);
+		info.priority     = pStatus[i].uxCurrentPriority;
+		info.stackFreeMin = pStatus[i].usStackHighWaterMark;
+
+		uint32_t lastRunTime = 0;
+		for (size_t j = 0; j < s_lastRunTimeCount; j++) {
+			if (s_lastRunTimes[j].taskNumber == pStatus[i].xTaskNumber) {
+				lastRunTime = s_lastRunTimes[j].runTime;
+				break;
+			}
+		}
+		if (elapsed > 0) {
+			info.cpuPermille = (uint64_t) (pStatus[i].ulRunTimeCounter - lastRunTime) * 1000 / elapsed;
+		}
+
+		portENTER_CRITICAL(&s_mux);
+		int index = find(info.name);
+		if (index >= 0) {
+			info.stackSize      = s_entries[index].stackSize;
+			info.latencyCount   = s_entries[index].latencyCount;
+			info.latencyMaxUs   = s_entries[index].latencyMaxUs;
+			info.latencyTotalUs = s_entries[index].latencyTotalUs;
+		}
+		portEXIT_CRITICAL(&s_mux);
+
+		if (info.stackSize > 0 && info.stackFreeMin * 100 < info.stackSize * LOW_STACK_PERCENT) {
+			ESP_LOGW(LOG_TAG, "Task %s has used all but %u of its %u bytes of stack", info.name,
+				(unsigned) info.stackFreeMin, (unsigned) info.stackSize);
+		}
+	}
+
+	s_lastRunTimeCount = 0;
+	for (UBaseType_t i = 0; i < taskCount && s_lastRunTimeCount < MAX_TASKS * 2; i++) {
+		s_lastRunTimes[s_lastRunTimeCount].taskNumber = pStatus[i].xTaskNumber;
+		s_lastRunTimes[s_lastRunTimeCount].runTime    = pStatus[i].ulRunTimeCounter;
+		s_lastRunTimeCount++;
+	}
+	s_lastTotalRunTime = totalRunTime;
+	s_sampleLock.give();
+
+	free(pStatus);
+	return count;
+#else
+	ESP_LOGE(LOG_TAG, "Task statistics need CONFIG_FREERTOS_USE_TRACE_FACILITY");
+	return 0;
+#endif
+} // sample
@@ -0,0 +1,62 @@
+/*
+ * TaskRegistry.h
+ *
+ * Runtime statistics of the tasks of the application.
+ */
+
+#ifndef COMPONENTS_CPP_UTILS_TASKREGISTRY_H_
+#define COMPONENTS_CPP_UTILS_TASKREGISTRY_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_event.h>
+
+ESP_EVENT_DECLARE_BASE(TASK_REGISTRY_EVENT);
+
+/**
+ * @brief Registry of the tasks created by the application.
+ *
+ * FreeRTOS knows how much of its stack a task has used, but not how big the stack is, so the code that
+ * creates a task registers it here by name together with its stack size.  The Task class does this
+ * itself.  For an event loop task, addEventLoop() also measures the scheduling latency: once every
+ * PROBE_INTERVAL_MS a timestamped probe event is posted to the loop and the time until its handler runs
+ * is recorded.
+ *
+ * sample() reports every task of the system with its stack high water mark and its share of the CPU
+ * since the previous sample.  The CPU share needs CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS and the task
+ * list needs CONFIG_FREERTOS_USE_TRACE_FACILITY.
+ */
+class TaskRegistry {
+public:
+	static const uint8_t  MAX_TASKS         = 16;
+	static const uint32_t PROBE_INTERVAL_MS = 1000;
+	static const uint8_t  LOW_STACK_PERCENT = 10;    // Warn when less of the stack was ever free.
+
+	/**
+	 * @brief Statistics of a task.
+	 */
+	struct Info {
+		char        name[configMAX_TASK_NAME_LEN];
+		UBaseType_t priority;
+		uint32_t    stackSize;        // Stack in bytes, 0 if the task is not registered.
+		uint32_t    stackFreeMin;     // Least free stack in bytes since the task started.
+		uint16_t    cpuPermille;      // Share of the time of all cores since the previous sample.
+		uint32_t    latencyCount;     // Number of latency probes handled.
+		uint32_t    latencyMaxUs;
+		uint64_t    latencyTotalUs;
+	};
+
+	static bool   add(const char* name, uint32_t stackSize);
+	static bool   addEventLoop(esp_event_loop_handle_t loop, const char* name, uint32_t stackSize);
+	static void   remove(const char* name);
+	static size_t sample(Info* pInfos, size_t maxInfos);
+
+private:
+	static int  find(const char* name);
+	static int  insert(const char* name, uint32_t stackSize, esp_event_loop_handle_t loop);
+	static void postProbes(void* arg);
+	static void probeHandler(void* arg, esp_event_base_t base, int32_t id, void* data);
+}; // TaskRegistry
+
+#endif /* COMPONENTS_CPP_UTILS_TASKREGISTRY_H_ */
@@ -6,6 +6,7 @@
  */
 
 #include <sstream>
+#include <string.h>
 #include "WebSocket.h"
 #include "Task.h"
 #include "GeneralUtils.h"
@@ -242,6 +243,7 @@ WebSocket::WebSocket(Socket socket) {
 	m_socket            = socket;
 	m_pWebSockerReader  = new WebSocketReader();
 	m_pWebSocketHandler = nullptr;
+	m_pBroadcaster      = nullptr;
 } // WebSocket
 
 
@@ -249,6 +251,10 @@ WebSocket::WebSocket(Socket socket) {
  * @brief Destructor.
  */
 WebSocket::~WebSocket() {
+	WebSocketBroadcaster* pBroadcaster = m_pBroadcaster;
+	if (pBroadcaster != nullptr) {
+		pBroadcaster->removeSubscriber(this);
+	}
 	m_pWebSockerReader->stop();
 	delete m_pWebSockerReader;
 } // ~WebSocket
@@ -270,23 +276,24 @@ void WebSocket::close(uint16_t status, std::string message) {
 	}
 	m_sentClose = true;              // Flag that we have sent a close request.
 
-	Frame frame;                     // Build the web socket frame indicating a close request.
-	frame.fin    = 1;
-	frame.rsv1   = 0;
-	frame.rsv2   = 0;
-	frame.rsv3   = 0;
-	frame.opCode = OPCODE_CLOSE;
-	frame.mask   = 0;
-	frame.len    = message.length() + 2;
-	int rc = m_socket.send((uint8_t*) &frame, sizeof(frame));
-
-	if (rc > 0) {
-		rc = m_socket.send(status);
+	WebSocketBroadcaster* pBroadcaster = m_pBroadcaster;
+	if (pBroadcaster != nullptr) {   // No more broadcasts, and one that was partly sent is completed first.
+		pBroadcaster->removeSubscriber(this);
 	}
 
-	if (rc > 0) {
-		m_socket.send(message);
+	if (message.length() > 123) {    // Control frames carry at most 125 bytes.
+		message.resize(123);
 	}
+	uint8_t header[MAX_FRAME_HEADER + 2];   // Build the web socket frame indicating a close request.
+	size_t headerLength = buildFrameHeader(header, OPCODE_CLOSE, message.length() + 2);
+	header[headerLength++] = status >> 8;   // The status code in network byte order.
+	header[headerLength++] = status & 0xff;
+	struct iovec iov[2];
+	iov[0].iov_base = header;
+	iov[0].iov_len  = headerLength;
+	iov[1].iov_base = (void*) message.data();
+	iov[1].iov_len  = message.length();
+	int rc = m_socket.send(iov, 2);
 
 	if (m_receivedClose || rc == 0 || rc == -1) {
 		m_socket.close();            // Close the underlying socket.
@@ -314,62 +321,78 @@ Socket WebSocket::getSocket() {
 } // getSocket
 
 
+/**
+ * @brief Build the header of an unmasked, final WebSocket frame.
+ * See the WebSocket spec (RFC6455) section "5.2 Base Framing Protocol".
+ * @param [out] header Buffer for the header, at least MAX_FRAME_HEADER bytes.
+ * @param [in] opCode The op code of the frame.
+ * @param [in] length The length of the payload.
+ * @return The length of the header.
+ */
+size_t WebSocket::buildFrameHeader(uint8_t* header, uint8_t opCode, size_t length) {
+	header[0] = 0x80 | (opCode & 0x0f);   // FIN and the op code.
+	if (length < 126) {
+		header[1] = length;
+		return 2;
+	}
+	if (length <= 0xffff) {
+		header[1] = 126;
+		header[2] = length >> 8;
+		header[3] = length & 0xff;
+		return 4;
+	}
+	header[1] = 127;
+	uint64_t length64 = length;
+	for (int i = 0; i < 8; i++) {
+		header[2 + i] = (length64 >> (56 - 8 * i)) & 0xff;
+	}
+	return 10;
+} // buildFrameHeader
+
+
 /**
  * @brief Send data down the web socket
  * See the WebSocket spec (RFC6455) section "6.1 Sending Data".
- * We build a WebSocket frame, send the frame followed by the data.
+ * We build a WebSocket frame and send the frame header and the data with a single call.
  * @param [in] data The data to send down the WebSocket.
  * @param [in] sendType The type of payload.  Either SEND_TYPE_TEXT or SEND_TYPE_BINARY.
  */
-void WebSocket::send(std::string data, uint8_t sendType) {
-	ESP_LOGD(LOG_TAG, ">> send: Length: %d", data.length());
-	Frame frame;
-	frame.fin    = 1;
-	frame.rsv1   = 0;
-	frame.rsv2   = 0;
-	frame.rsv3   = 0;
-	frame.opCode = (sendType == SEND_TYPE_TEXT) ? OPCODE_TEXT : OPCODE_BINARY;
-	frame.mask   = 0;
-	if (data.length() < 126) {
-		frame.len = data.length();
-		m_socket.send((uint8_t*) &frame, sizeof(frame));
-	} else {
-		frame.len = 126;
-		m_socket.send((uint8_t*) &frame, sizeof(frame));
-		m_socket.send(htons((uint16_t) data.length()));  // Convert to network byte order from host byte order
-	}
-	m_socket.send((uint8_t*)data.data(), data.length());
-	ESP_LOGD(LOG_TAG, "<< send");
+void WebSocket::send(const std::string& data, uint8_t sendType) {
+	send((const uint8_t*) data.data(), data.length(), sendType);
 } // send_cpp
 
 
 /**
  * @brief Send data down the web socket
  * See the WebSocket spec (RFC6455) section "6.1 Sending Data".
- * We build a WebSocket frame, send the frame followed by the data.
+ * We build a WebSocket frame and send the frame header and the data with a single call.  While the
+ * WebSocket is subscribed to a broadcaster, the frame is queued behind the broadcasts it has not sent
+ * yet instead, and is sent as the socket takes it.
  * @param [in] data The data to send down the WebSocket.
+ * @param [in] length The length of the data.
  * @param [in] sendType The type of payload.  Either SEND_TYPE_TEXT or SEND_TYPE_BINARY.
  */
-void WebSocket::send(uint8_t* data, uint16_t length, uint8_t sendType) {
+void WebSocket::send(const uint8_t* data, size_t length, uint8_t sendType) {
 	ESP_LOGD(LOG_TAG, ">> send: Length: %d", length);
-	Frame frame;
-	frame.fin    = 1;
-	frame.rsv1   = 0;
-	frame.rsv2   = 0;
-	frame.rsv3   = 0;
-	frame.opCode = (sendType==SEND_TYPE_TEXT) ? OPCODE_TEXT : OPCODE_BINARY;
-	frame.mask   = 0;
-	if (length < 126) {
-		frame.len = length;
-		m_socket.send((uint8_t*) &frame, sizeof(frame));
-	} else {
-		frame.len = 126;
-		m_socket.send((uint8_t*) &frame, sizeof(frame));
-		m_socket.send(htons(length));  // Convert to network byte order from host byte order
+	WebSocketBroadcaster* pBroadcaster = m_pBroadcaster;
+	if (pBroadcaster != nullptr) {
+		WebSocketFrame* pFrame = WebSocketFrame::create(data, length, sendType);
+		bool queued = pBroadcaster->sendTo(this, pFrame);
+		pFrame->release();
+		if (queued) {
+			ESP_LOGD(LOG_TAG, "<< send: queued");
+			return;
+		}
 	}
-	m_socket.send(data, length);
+	uint8_t header[MAX_FRAME_HEADER];
+	struct iovec iov[2];
+	iov[0].iov_base = header;
+	iov[0].iov_len  = buildFrameHeader(header, (sendType == SEND_TYPE_TEXT) ? OPCODE_TEXT : OPCODE_BINARY, length);
+	iov[1].iov_base = (void*) data;
+	iov[1].iov_len  = length;
+	m_socket.send(iov, 2);
 	ESP_LOGD(LOG_TAG, "<< send");
-}
+} // send
 
 
 /**
@@ -510,3 +533,329 @@ WebSocketInputStreambuf::int_type WebSocketInputStreambuf::underflow() {
  */
 WebSocketHandler::~WebSocketHandler() {
 } // ~WebSocketHandler()
+
+
+/**
+ * @brief Create a frame holding a copy of the data.
+ * @param [in] data The payload.
+ * @param [in] length The length of the payload.
+ * @param [in] sendType The type of payload.  Either SEND_TYPE_TEXT or SEND_TYPE_BINARY.
+ * @return The frame with a single reference held by the caller.
+ */
+WebSocketFrame* WebSocketFrame::create(const uint8_t* data, size_t length, uint8_t sendType) {
+	uint8_t header[WebSocket::MAX_FRAME_HEADER];
+	size_t headerLength = WebSocket::buildFrameHeader(header,
+		(sendType == WebSocket::SEND_TYPE_TEXT) ? OPCODE_TEXT : OPCODE_BINARY, length);
+	WebSocketFrame* pFrame = new WebSocketFrame(headerLength + length);
+	memcpy(pFrame->m_data, header, headerLength);
+	memcpy(pFrame->m_data + headerLength, data, length);
+	return pFrame;
+} // create
+
+
+WebSocketFrame::WebSocketFrame(size_t length) : m_refCount(1) {
+	m_data   = new uint8_t[length];
+	m_length = length;
+} // WebSocketFrame
+
+
+WebSocketFrame::~WebSocketFrame() {
+	delete[] m_data;
+} // ~WebSocketFrame
+
+
+/**
+ * @brief Take an additional reference to the frame.
+ */
+void WebSocketFrame::acquire() {
+	m_refCount.fetch_add(1, std::memory_order_relaxed);
+} // acquire
+
+
+/**
+ * @brief Give up a reference to the frame.  The frame is deleted with the last reference.
+ */
+void WebSocketFrame::release() {
+	if (m_refCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		delete this;
+	}
+} // release
+
+
+/**
+ * @brief Get the frame as it is sent on the wire.
+ */
+const uint8_t* WebSocketFrame::getData() const {
+	return m_data;
+} // getData
+
+
+/**
+ * @brief Get the length of the frame, header included.
+ */
+size_t WebSocketFrame::getLength() const {
+	return m_length;
+} // getLength
+
+
+/**
+ * @brief Construct a broadcaster.
+ * @param [in] backlogLimit Most bytes that may be queued for one subscriber before it is dropped.
+ */
+WebSocketBroadcaster::WebSocketBroadcaster(size_t backlogLimit) {
+	m_backlogLimit = backlogLimit;
+	m_droppedCount = 0;
+} // WebSocketBroadcaster
+
+
+WebSocketBroadcaster::~WebSocketBroadcaster() {
+	for (auto it = m_subscribers.begin(); it != m_subscribers.end(); ++it) {
+		it->pWebSocket->m_pBroadcaster = nullptr;
+		for (uint8_t i = 0; i < it->queueLength; i++) {
+			it->queue[i]->release();
+		}
+	}
+} // ~WebSocketBroadcaster
+
+
+/**
+ * @brief Add a WebSocket that receives all following broadcasts.
+ * @param [in] pWebSocket The WebSocket to add.  It must not be subscribed to a broadcaster already.
+ */
+void WebSocketBroadcaster::addSubscriber(WebSocket* pWebSocket) {
+	Subscriber subscriber;
+	subscriber.pWebSocket  = pWebSocket;
+	subscriber.socketFd    = pWebSocket->getSocket().getFD();
+	subscriber.queueLength = 0;
+	subscriber.offset      = 0;
+	subscriber.queuedBytes = 0;
+	WebSocketBroadcaster* pNone = nullptr;
+	if (!pWebSocket->m_pBroadcaster.compare_exchange_strong(pNone, this)) {
+		ESP_LOGE(LOG_TAG, "addSubscriber: socket %d is subscribed already", subscriber.socketFd);
+		assert(false);
+		return;
+	}
+	m_lock.take("addSubscriber");
+	m_subscribers.push_back(subscriber);
+	m_lock.give();
+} // addSubscriber
+
+
+/**
+ * @brief Send a message to all subscribers.
+ * @param [in] data The message.
+ * @param [in] sendType The type of payload.  Either SEND_TYPE_TEXT or SEND_TYPE_BINARY.
+ */
+void WebSocketBroadcaster::broadcast(const std::string& data, uint8_t sendType) {
+	broadcast((const uint8_t*) data.data(), data.length(), sendType);
+} // broadcast
+
+
+/**
+ * @brief Send a message to all subscribers.
+ * @param [in] data The message.
+ * @param [in] length The length of the message.
+ * @param [in] sendType The type of payload.  Either SEND_TYPE_TEXT or SEND_TYPE_BINARY.
+ */
+void WebSocketBroadcaster::broadcast(const uint8_t* data, size_t length, uint8_t sendType) {
+	WebSocketFrame* pFrame = WebSocketFrame::create(data, length, sendType);
+	broadcast(pFrame);
+	pFrame->release();
+} // broadcast
+
+
+/**
+ * @brief Send a prepared frame to all subscribers.
+ * Subscribers that can't queue the frame without going past the backlog limit are dropped.
+ * @param [in] pFrame The frame to send.  The caller keeps its reference.
+ */
+void WebSocketBroadcaster::broadcast(WebSocketFrame* pFrame) {
+	m_lock.take("broadcast");
+	for (auto it = m_subscribers.begin(); it != m_subscribers.end(); ) {
+		if (!enqueue(*it, pFrame)) {
+			it = m_subscribers.erase(it);
+			continue;
+		}
+		++it;
+	}
+	m_lock.give();
+} // broadcast
+
+
+/**
+ * @brief Queue a frame for a subscriber and send as much of its queue as the socket takes.
+ * A subscriber that can't queue the frame without going past the backlog limit is dropped.
+ * @param [in] subscriber The subscriber.
+ * @param [in] pFrame The frame to queue.  The caller keeps its reference.
+ * @return False if the subscriber was dropped and has to be erased.
+ */
+bool WebSocketBroadcaster::enqueue(Subscriber& subscriber, WebSocketFrame* pFrame) {
+	if (subscriber.queueLength == MAX_QUEUED_FRAMES ||
+			subscriber.queuedBytes + pFrame->getLength() > m_backlogLimit) {
+		ESP_LOGW(LOG_TAG, "Dropping slow subscriber, socket %d has %d bytes queued", subscriber.socketFd, subscriber.queuedBytes);
+		drop(subscriber);
+		return false;
+	}
+	pFrame->acquire();
+	subscriber.queue[subscriber.queueLength++] = pFrame;
+	subscriber.queuedBytes += pFrame->getLength();
+	if (!send(subscriber)) {
+		drop(subscriber);
+		return false;
+	}
+	return true;
+} // enqueue
+
+
+/**
+ * @brief Let go of a subscriber.
+ * Its queued frames are released and its socket is shut down so that its reader ends and closes the
+ * WebSocket.  The subscriber still has to be erased by the caller.
+ */
+void WebSocketBroadcaster::drop(Subscriber& subscriber) {
+	for (uint8_t i = 0; i < subscriber.queueLength; i++) {
+		subscriber.queue[i]->release();
+	}
+	subscriber.queueLength = 0;
+	subscriber.pWebSocket->m_pBroadcaster = nullptr;
+	::shutdown(subscriber.socketFd, SHUT_RDWR);
+	m_droppedCount++;
+} // drop
+
+
+/**
+ * @brief Try to send what is queued for slow subscribers without waiting for a new broadcast.
+ */
+void WebSocketBroadcaster::flush() {
+	m_lock.take("flush");
+	for (auto it = m_subscribers.begin(); it != m_subscribers.end(); ) {
+		if (it->queueLength > 0 && !send(*it)) {
+			drop(*it);
+			it = m_subscribers.erase(it);
+			continue;
+		}
+		++it;
+	}
+	m_lock.give();
+} // flush
+
+
+size_t WebSocketBroadcaster::getBacklogLimit() {
+	return m_backlogLimit;
+} // getBacklogLimit
+
+
+size_t WebSocketBroadcaster::getDroppedCount() {
+	return m_droppedCount;
+} // getDroppedCount
+
+
+size_t WebSocketBroadcaster::getSubscriberCount() {
+	m_lock.take("getSubscriberCount");
+	size_t count = m_subscribers.size();
+	m_lock.give();
+	return count;
+} // getSubscriberCount
+
+
+/**
+ * @brief Stop sending broadcasts to a WebSocket.
+ * A frame that was partly sent is completed, so that the WebSocket can go on sending its own frames.
+ * This waits for the socket like WebSocket::send(), but without holding up the other subscribers.
+ * Frames that were not started are discarded.
+ * @param [in] pWebSocket The WebSocket to remove.
+ */
+void WebSocketBroadcaster::removeSubscriber(WebSocket* pWebSocket) {
+	Subscriber subscriber;
+	bool       found = false;
+	m_lock.take("removeSubscriber");
+	for (auto it = m_subscribers.begin(); it != m_subscribers.end(); ++it) {
+		if (it->pWebSocket == pWebSocket) {
+			subscriber = *it;
+			found      = true;
+			m_subscribers.erase(it);
+			break;
+		}
+	}
+	m_lock.give();
+	if (!found) return;
+
+	if (subscriber.offset > 0) {
+		WebSocketFrame* pFrame = subscriber.queue[0];
+		pWebSocket->getSocket().send(pFrame->getData() + subscriber.offset, pFrame->getLength() - subscriber.offset);
+	}
+	for (uint8_t i = 0; i < subscriber.queueLength; i++) {
+		subscriber.queue[i]->release();
+	}
+	pWebSocket->m_pBroadcaster = nullptr;
+} // removeSubscriber
+
+
+/**
+ * @brief Set the most bytes that may be queued for one subscriber before it is dropped.
+ * @param [in] backlogLimit The limit in bytes.
+ */
+void WebSocketBroadcaster::setBacklogLimit(size_t backlogLimit) {
+	m_lock.take("setBacklogLimit");
+	m_backlogLimit = backlogLimit;
+	m_lock.give();
+} // setBacklogLimit
+
+
+/**
+ * @brief Queue a frame of WebSocket::send() for a subscriber.
+ * @param [in] pWebSocket The WebSocket sending the frame.
+ * @param [in] pFrame The frame.  The caller keeps its reference.
+ * @return False if the WebSocket is not subscribed (any more) and has to send the frame itself.
+ */
+bool WebSocketBroadcaster::sendTo(WebSocket* pWebSocket, WebSocketFrame* pFrame) {
+	bool found = false;
+	m_lock.take("sendTo");
+	for (auto it = m_subscribers.begin(); it != m_subscribers.end(); ++it) {
+		if (it->pWebSocket == pWebSocket) {
+			found = true;
+			if (!enqueue(*it, pFrame)) {
+				m_subscribers.erase(it);
+			}
+			break;
+		}
+	}
+	m_lock.give();
+	return found;
+} // sendTo
+
+
+/**
+ * @brief Send as much of a subscriber's queue as the network stack takes without blocking.
+ * All queued frames go out with a single scatter/gather send.
+ * @return False if the socket failed.
+ */
+bool WebSocketBroadcaster::send(Subscriber& subscriber) {
+	struct iovec iov[MAX_QUEUED_FRAMES];
+	for (uint8_t i = 0; i < subscriber.queueLength; i++) {
+		size_t offset = (i == 0) ? subscriber.offset : 0;
+		iov[i].iov_base = (void*) (subscriber.queue[i]->getData() + offset);
+		iov[i].iov_len  = subscriber.queue[i]->getLength() - offset;
+	}
+	int rc = subscriber.pWebSocket->getSocket().send(iov, subscriber.queueLength, false);
+	if (rc < 0) {
+		return false;
+	}
+
+	// Release the frames that are completely sent and remember how far we got into the next one.
+	size_t sent = rc;
+	subscriber.queuedBytes -= sent;
+	sent += subscriber.offset;
+	uint8_t done = 0;
+	while (done < subscriber.queueLength && sent >= subscriber.queue[done]->getLength()) {
+		sent -= subscriber.queue[done]->getLength();
+		subscriber.queue[done]->release();
+		done++;
+	}
+	for (uint8_t i = done; i < subscriber.queueLength; i++) {
+		subscriber.queue[i - done] = subscriber.queue[i];
+	}
+	subscriber.queueLength -= done;
+	subscriber.offset       = sent;
+	return true;
+} // send
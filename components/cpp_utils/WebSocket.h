@@ -8,12 +8,16 @@
 #ifndef COMPONENTS_WEBSOCKET_H_
 #define COMPONENTS_WEBSOCKET_H_
 #include <string>
+#include <vector>
+#include <atomic>
 #include "Socket.h"
+#include "FreeRTOS.h"
 
 #undef close
 #undef send
 class WebSocketReader;
 class WebSocket;
+class WebSocketBroadcaster;
 
 // +-------------------------------+
 // | WebSocketInputStreambuf |
@@ -83,20 +87,112 @@ public:
 	void              close(uint16_t status = CLOSE_NORMAL_CLOSURE, std::string message = "");
 	WebSocketHandler* getHandler();
 	Socket            getSocket();
-	void              send(std::string data, uint8_t sendType = SEND_TYPE_BINARY);
-	void              send(uint8_t* data, uint16_t length, uint8_t sendType = SEND_TYPE_BINARY);
+	void              send(const std::string& data, uint8_t sendType = SEND_TYPE_BINARY);
+	void              send(const uint8_t* data, size_t length, uint8_t sendType = SEND_TYPE_BINARY);
 	void              setHandler(WebSocketHandler *handler);
 
+	static const size_t MAX_FRAME_HEADER = 10;
+	static size_t     buildFrameHeader(uint8_t* header, uint8_t opCode, size_t length);
+
 private:
 	friend class WebSocketReader;
+	friend class WebSocketBroadcaster;
 	friend class HttpServerTask;
+	friend class HttpServerWorker;
 	void              startReader();
 	bool              m_receivedClose; // True when we have received a close request.
 	bool              m_sentClose;	 // True when we have sent a close request.
 	Socket            m_socket;		// Partner socket.
 	WebSocketHandler* m_pWebSocketHandler;
 	WebSocketReader*  m_pWebSockerReader;
+	std::atomic<WebSocketBroadcaster*> m_pBroadcaster;   // Set while subscribed, sends then queue behind its frames.
 
 }; // WebSocket
 
+
+// +----------------+
+// | WebSocketFrame |
+// +----------------+
+/**
+ * @brief A complete, reference counted WebSocket frame.
+ *
+ * The header and payload are built once into a single buffer that can be queued on any number of
+ * sockets.  The frame is deleted when the last reference is released.
+ */
+class WebSocketFrame {
+public:
+	static WebSocketFrame* create(const uint8_t* data, size_t length, uint8_t sendType = WebSocket::SEND_TYPE_BINARY);
+	void           acquire();
+	void           release();
+	const uint8_t* getData() const;
+	size_t         getLength() const;
+
+private:
+	WebSocketFrame(size_t length);
+	~WebSocketFrame();
+	std::atomic<uint16_t> m_refCount;
+	uint8_t*              m_data;
+	size_t                m_length;
+}; // WebSocketFrame
+
+
+// +----------------------+
+// | WebSocketBroadcaster |
+// +----------------------+
+/**
+ * @brief Send the same message to many WebSockets.
+ *
+ * A message is framed once into a shared WebSocketFrame.  Each subscriber then gets one non-blocking
+ * scatter/gather send covering the frames it still has queued and the new one.  Frames the network
+ * stack could not take right away stay queued for the subscriber.  A subscriber whose queue grows past
+ * the backlog limit is too slow to keep up and is dropped: its socket is shut down, which ends its
+ * WebSocket reader.
+ *
+ * While a WebSocket is subscribed, WebSocket::send() queues its frame behind the broadcast frames that
+ * were not sent yet, so the frames never interleave on the socket.  A WebSocket can only be subscribed
+ * to one broadcaster at a time.  Removing a subscriber completes a frame that was partly sent and
+ * discards the rest of its queue, WebSocket::close() does so before it sends the close frame.
+ *
+ * Subscribers have to be removed by the application when their WebSocket closes, for example from
+ * WebSocketHandler::onClose().
+ */
+class WebSocketBroadcaster {
+public:
+	static const uint8_t MAX_QUEUED_FRAMES = 8;
+
+	WebSocketBroadcaster(size_t backlogLimit = 4096);
+	virtual ~WebSocketBroadcaster();
+
+	void   addSubscriber(WebSocket* pWebSocket);
+	void   broadcast(const std::string& data, uint8_t sendType = WebSocket::SEND_TYPE_TEXT);
+	void   broadcast(const uint8_t* data, size_t length, uint8_t sendType = WebSocket::SEND_TYPE_BINARY);
+	void   broadcast(WebSocketFrame* pFrame);
+	void   flush();                                       // Try to send what is queued for slow subscribers.
+	size_t getBacklogLimit();
+	size_t getDroppedCount();                             // Number of subscribers dropped for being too slow.
+	size_t getSubscriberCount();
+	void   removeSubscriber(WebSocket* pWebSocket);
+	void   setBacklogLimit(size_t backlogLimit);          // Most bytes that may be queued for one subscriber.
+
+private:
+	struct Subscriber {
+		WebSocket*      pWebSocket;
+		int             socketFd;
+		WebSocketFrame* queue[MAX_QUEUED_FRAMES];
+		uint8_t         queueLength;
+		size_t          offset;       // Bytes of the first queued frame that were already sent.
+		size_t          queuedBytes;  // Bytes queued and not yet sent.
+	};
+	std::vector<Subscriber> m_subscribers;
+	size_t                  m_backlogLimit;
+	size_t                  m_droppedCount;
+	FreeRTOS::Semaphore     m_lock = FreeRTOS::Semaphore("WebSocketBroadcaster");
+
+	friend class WebSocket;
+	bool enqueue(Subscriber& subscriber, WebSocketFrame* pFrame);
+	bool send(Subscriber& subscriber);
+	bool sendTo(WebSocket* pWebSocket, WebSocketFrame* pFrame);
+	void drop(Subscriber& subscriber);
+}; // WebSocketBroadcaster
+
 #endif /* COMPONENTS_WEBSOCKET_H_ */
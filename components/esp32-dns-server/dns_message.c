@@ -0,0 +1,289 @@
+/*
+MIT License
+
+Copyright (c) 2017 Olof Astrand (Ebiroll)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "dns_message.h"
+
+#include <string.h>
+
+#define DNS_HEADER_SIZE 12
+
+#define DNS_FLAG_QR 0x80
+#define DNS_FLAG_AA 0x04
+#define DNS_FLAG_RD 0x01
+#define DNS_OPCODE_QUERY 0x00
+
+#define DNS_RCODE_NOERROR 0
+#define DNS_RCODE_FORMERR 1
+#define DNS_RCODE_NOTIMP 4
+#define DNS_RCODE_REFUSED 5
+// Extended RCODE 16 is transported as 1 in the upper bits of the OPT TTL
+#define DNS_EXT_RCODE_BADVERS 1
+
+#define DNS_TYPE_A 1
+#define DNS_TYPE_OPT 41
+#define DNS_TYPE_ANY 255
+#define DNS_CLASS_IN 1
+
+#define DNS_OPT_SIZE 11
+
+typedef struct dns_query
+{
+    uint16_t qtype;
+    uint16_t qclass;
+    // End of the question section in the query
+    size_t question_end;
+    bool name_matches;
+    bool has_opt;
+    uint8_t edns_version;
+} dns_query_t;
+
+static inline uint16_t read_u16(const uint8_t *pData)
+{
+    return (uint16_t)((pData[0] << 8) | pData[1]);
+}
+
+static inline void write_u16(uint8_t *pData, uint16_t val)
+{
+    pData[0] = val >> 8;
+    pData[1] = val & 0xFF;
+}
+
+static inline uint8_t lower(uint8_t c)
+{
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+// Converts a dotted hostname (trailing dot optional) into lower case wire format
+static size_t encode_name(const char *hostname, uint8_t *out, size_t out_len)
+{
+    size_t pos = 0;
+    const char *label = hostname;
+    while (*label != '\0')
+    {
+        const char *end = strchr(label, '.');
+        size_t label_len = end ? (size_t)(end - label) : strlen(label);
+        if (label_len == 0 || label_len > 63 || pos + label_len + 2 > out_len)
+        {
+            return 0;
+        }
+        out[pos++] = label_len;
+        for (size_t i = 0; i < label_len; i++)
+        {
+            out[pos++] = lower(label[i]);
+        }
+        if (!end)
+        {
+            break;
+        }
+        label = end + 1;
+    }
+    out[pos++] = 0x00;
+    return pos;
+}
+
+bool dns_responder_init(dns_responder_t *responder, const char *hostname, bool answer_all, uint32_t ip)
+{
+    responder->answer_all = answer_all;
+    responder->name_len = encode_name(hostname, responder->name, sizeof(responder->name));
+
+    uint8_t *rr = responder->answer;
+    // Compression pointer to the name of the question at offset 12
+    rr[0] = 0xC0;
+    rr[1] = DNS_HEADER_SIZE;
+    write_u16(&rr[2], DNS_TYPE_A);
+    write_u16(&rr[4], DNS_CLASS_IN);
+    // TTL of 0, clients shouldn't cache captive portal answers
+    memset(&rr[6], 0, 4);
+    write_u16(&rr[10], 4);
+    memcpy(&rr[12], &ip, 4);
+    return responder->name_len > 0;
+}
+
+// Walks the name at offset and compares it against the configured name without copying.
+// Returns the offset after the name or 0 if the name is malformed.
+static size_t match_name(const dns_responder_t *responder, const uint8_t *pkt, size_t len, size_t offset, bool *matches)
+{
+    size_t start = offset;
+    bool equal = true;
+    while (offset < len)
+    {
+        uint8_t label_len = pkt[offset];
+        if (label_len == 0)
+        {
+            offset++;
+            *matches = equal && (offset - start) == responder->name_len;
+            return offset;
+        }
+        // Compression pointers and the extended label types are not valid in a question
+        if (label_len > 63 || offset + label_len + 1 > len || offset - start + label_len + 1 > DNS_MAX_NAME_SIZE)
+        {
+            return 0;
+        }
+        for (size_t i = 0; i <= label_len && equal; i++)
+        {
+            size_t pos = offset - start + i;
+            uint8_t c = i == 0 ? label_len : lower(pkt[offset + i]);
+            equal = pos < responder->name_len && responder->name[pos] == c;
+        }
+        offset += label_len + 1;
+    }
+    return 0;
+}
+
+// Skips over a resource record and records whether it is an EDNS0 OPT record.
+// Returns the offset after the record or 0 if it is malformed.
+static size_t parse_additional(const uint8_t *pkt, size_t len, size_t offset, dns_query_t *query)
+{
+    // Only the root name is valid for OPT, other records may use compression
+    while (offset < len && pkt[offset] != 0)
+    {
+        if ((pkt[offset] & 0xC0) == 0xC0)
+        {
+            offset++;
+            break;
+        }
+        offset += pkt[offset] + 1;
+    }
+    offset++;
+    if (offset + 10 > len)
+    {
+        return 0;
+    }
+    uint16_t type = read_u16(&pkt[offset]);
+    uint16_t rdlen = read_u16(&pkt[offset + 8]);
+    if (type == DNS_TYPE_OPT)
+    {
+        query->has_opt = true;
+        query->edns_version = pkt[offset + 5];
+    }
+    offset += 10 + rdlen;
+    return offset <= len ? offset : 0;
+}
+
+static void write_header(uint8_t *resp, const uint8_t *pkt, uint8_t rcode, uint16_t qdcount, uint16_t ancount, uint16_t arcount)
+{
+    resp[0] = pkt[0];
+    resp[1] = pkt[1];
+    // Response, copy the opcode, authoritative answer, not truncated, copy the recursion bit
+    resp[2] = DNS_FLAG_QR | (pkt[2] & 0x78) | DNS_FLAG_AA | (pkt[2] & DNS_FLAG_RD);
+    // No recursion available
+    resp[3] = rcode & 0x0F;
+    write_u16(&resp[4], qdcount);
+    write_u16(&resp[6], ancount);
+    write_u16(&resp[8], 0);
+    write_u16(&resp[10], arcount);
+}
+
+static size_t write_opt(uint8_t *resp, uint8_t ext_rcode)
+{
+    resp[0] = 0x00; // root name
+    write_u16(&resp[1], DNS_TYPE_OPT);
+    write_u16(&resp[3], DNS_MAX_PACKET_SIZE); // our UDP payload size
+    resp[5] = ext_rcode;
+    resp[6] = 0; // EDNS version 0
+    write_u16(&resp[7], 0);
+    write_u16(&resp[9], 0);
+    return DNS_OPT_SIZE;
+}
+
+size_t dns_build_response(const dns_responder_t *responder, const uint8_t *pkt, size_t len, uint8_t *resp)
+{
+    if (len < DNS_HEADER_SIZE || (pkt[2] & DNS_FLAG_QR))
+    {
+        // Too short to answer or a response, which we never answer to avoid loops
+        return 0;
+    }
+    if (((pkt[2] >> 3) & 0x0F) != DNS_OPCODE_QUERY)
+    {
+        write_header(resp, pkt, DNS_RCODE_NOTIMP, 0, 0, 0);
+        return DNS_HEADER_SIZE;
+    }
+    if (read_u16(&pkt[4]) != 1)
+    {
+        write_header(resp, pkt, DNS_RCODE_FORMERR, 0, 0, 0);
+        return DNS_HEADER_SIZE;
+    }
+
+    dns_query_t query = {};
+    size_t offset = match_name(responder, pkt, len, DNS_HEADER_SIZE, &query.name_matches);
+    if (offset == 0 || offset + 4 > len)
+    {
+        write_header(resp, pkt, DNS_RCODE_FORMERR, 0, 0, 0);
+        return DNS_HEADER_SIZE;
+    }
+    query.qtype = read_u16(&pkt[offset]);
+    query.qclass = read_u16(&pkt[offset + 2]);
+    query.question_end = offset + 4;
+
+    uint16_t records = read_u16(&pkt[6]) + read_u16(&pkt[8]) + read_u16(&pkt[10]);
+    offset = query.question_end;
+    for (uint16_t i = 0; i < records && offset != 0; i++)
+    {
+        offset = parse_additional(pkt, len, offset, &query);
+    }
+    if (offset == 0)
+    {
+        write_header(resp, pkt, DNS_RCODE_FORMERR, 0, 0, 0);
+        return DNS_HEADER_SIZE;
+    }
+
+    // The question is echoed verbatim to preserve the case of the query (DNS 0x20)
+    size_t question_len = query.question_end - DNS_HEADER_SIZE;
+    if (DNS_HEADER_SIZE + question_len + DNS_ANSWER_SIZE + DNS_OPT_SIZE > DNS_MAX_PACKET_SIZE)
+    {
+        return 0;
+    }
+    memcpy(resp + DNS_HEADER_SIZE, pkt + DNS_HEADER_SIZE, question_len);
+    size_t idx = query.question_end;
+
+    if (query.has_opt && query.edns_version != 0)
+    {
+        write_header(resp, pkt, DNS_RCODE_NOERROR, 1, 0, 1);
+        return idx + write_opt(resp + idx, DNS_EXT_RCODE_BADVERS);
+    }
+
+    uint8_t rcode = DNS_RCODE_NOERROR;
+    uint16_t ancount = 0;
+    if (responder->answer_all || query.name_matches)
+    {
+        // Other types for our name get an empty NOERROR answer
+        if (query.qclass == DNS_CLASS_IN && (query.qtype == DNS_TYPE_A || query.qtype == DNS_TYPE_ANY))
+        {
+            memcpy(resp + idx, responder->answer, DNS_ANSWER_SIZE);
+            idx += DNS_ANSWER_SIZE;
+            ancount = 1;
+        }
+    }
+    else
+    {
+        rcode = DNS_RCODE_REFUSED;
+    }
+
+    if (query.has_opt)
+    {
+        idx += write_opt(resp + idx, 0);
+    }
+    write_header(resp, pkt, rcode, 1, ancount, query.has_opt ? 1 : 0);
+    return idx;
+}
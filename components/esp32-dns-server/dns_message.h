@@ -0,0 +1,64 @@
+/*
+MIT License
+
+Copyright (c) 2017 Olof Astrand (Ebiroll)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef DNS_MESSAGE_H
+#define DNS_MESSAGE_H
+
+// Parsing of queries and building of responses in DNS wire format, without any sockets
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define DNS_MAX_PACKET_SIZE 512
+#define DNS_MAX_NAME_SIZE 255
+#define DNS_ANSWER_SIZE 16
+
+    typedef struct dns_responder
+    {
+        bool answer_all;
+        // Configured hostname in lower case wire format, e.g. \x04ibbq\x07gateway\x00
+        uint8_t name[DNS_MAX_NAME_SIZE];
+        size_t name_len;
+        // Answer RR pointing to the question name, only the IP changes after startup
+        uint8_t answer[DNS_ANSWER_SIZE];
+    } dns_responder_t;
+
+    // Encodes the hostname and the answer once. Returns false if the hostname is invalid, the
+    // responder then only answers if answer_all is set.
+    bool dns_responder_init(dns_responder_t *responder, const char *hostname, bool answer_all, uint32_t ip);
+    // Builds the response for a single query into resp, which has room for DNS_MAX_PACKET_SIZE bytes.
+    // Returns the response length or 0 if the packet should be dropped without an answer.
+    size_t dns_build_response(const dns_responder_t *responder, const uint8_t *pkt, size_t len, uint8_t *resp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -23,6 +23,7 @@ SOFTWARE.
 */
 
 #include "dns_server.h"
+#include "dns_message.h"
 
 #include <lwip/sockets.h>
 #include <string.h>
@@ -42,16 +43,14 @@ SOFTWARE.
 #include <lwip/netdb.h>
 #include <lwip/dns.h>
 
-#define STANDARD_QUERY 0b00000000
+#define DNS_PORT 53
+// Number of queued queries handled per wakeup before blocking in recvfrom again
+#define DNS_RECV_BATCH 8
 
 static const char TAG[] = "DNSSRV";
 
-uint16_t bigEndianInt(char *pData)
-{
-    uint16_t val = pData[0] << 8;
-    val = val | pData[1];
-    return val;
-}
+static uint8_t rx_buf[DNS_MAX_PACKET_SIZE];
+static uint8_t tx_buf[DNS_MAX_PACKET_SIZE];
 
 void receive_thread(void *pvParameters)
 {
@@ -65,161 +64,63 @@ void receive_thread(void *pvParameters)
         ESP_LOGI(TAG, "Only answering %s with our IP", cfg->hostname);
     }
     int socket_fd;
-    struct sockaddr_in sa, ra;
+    struct sockaddr_in ra;
 
     socket_fd = socket(AF_INET, SOCK_DGRAM, 0);
     if (socket_fd < 0)
     {
         ESP_LOGE(TAG, "Failed to create socket");
-        exit(0);
+        vTaskDelete(NULL);
+        return;
     }
 
-    memset(&sa, 0, sizeof(struct sockaddr_in));
-
     tcpip_adapter_ip_info_t ip;
     tcpip_adapter_get_ip_info(TCPIP_ADAPTER_IF_AP, &ip);
+    memset(&ra, 0, sizeof(struct sockaddr_in));
     ra.sin_family = AF_INET;
     ra.sin_addr.s_addr = ip.ip.addr;
-    ra.sin_port = htons(53);
+    ra.sin_port = htons(DNS_PORT);
     if (bind(socket_fd, (struct sockaddr *)&ra, sizeof(struct sockaddr_in)) == -1)
     {
         ESP_LOGE(TAG, "Failed to bind to 53/udp");
         close(socket_fd);
-        exit(1);
+        vTaskDelete(NULL);
+        return;
+    }
+    ESP_LOGI(TAG, "Listening on local IP: %s", ip4addr_ntoa(&ip.ip));
+
+    dns_responder_t responder = {};
+    if (!dns_responder_init(&responder, cfg->hostname, cfg->answer_all, ip.ip.addr))
+    {
+        ESP_LOGE(TAG, "Invalid hostname %s, not answering any names", cfg->hostname);
     }
-    ESP_LOGI(TAG, "Listening on local IP: %s", ip4addr_ntoa(&ip.ip.addr));
 
     struct sockaddr_in client;
     socklen_t client_len;
-    client_len = sizeof(client);
     int length;
-    char data[80];
-    char response[100];
-    char ipAddress[INET_ADDRSTRLEN];
-    int idx;
-    int err;
 
     ESP_LOGI(TAG, "DNS Server listening on 53/udp");
     while (1)
     {
-        length = recvfrom(socket_fd, data, sizeof(data), 0, (struct sockaddr *)&client, &client_len);
-        if (length > 0)
+        // Block for the first query, then drain whatever else is queued without blocking
+        int flags = 0;
+        for (int batch = 0; batch < DNS_RECV_BATCH; batch++)
         {
-            data[length] = '\0';
-
-            inet_ntop(AF_INET, &(client.sin_addr), ipAddress, INET_ADDRSTRLEN);
-
-            uint16_t questionCount = bigEndianInt(&data[4]); //And implicitly data[5]
-            uint16_t answerCount = bigEndianInt(&data[6]);
-            uint16_t nsCount = bigEndianInt(&data[8]);
-            uint16_t arCount = bigEndianInt(&data[10]);
-
-            // Prepare our response
-            // Copy ID (16 bits)
-            response[0] = data[0];
-            response[1] = data[1];
-            response[2] = 0b10000100 | (0b00000001 & data[2]); //response, authorative answer, not truncated, copy the recursion bit
-            response[3] = 0b00000000;                          //no recursion available, no errors
-            response[4] = data[4];
-            response[5] = data[5]; //Question count
-            response[6] = data[4];
-            response[7] = data[5]; //answer count
-            response[8] = 0x00;
-            response[9] = 0x00; //NS record count
-            response[10] = 0x00;
-            response[11] = 0x00; //Resource record count
-
-            memcpy(response + 12, data + 12, length - 12); //Copy the rest of the query section
-            idx = length;
-
-            if ((data[1] & STANDARD_QUERY) > 0)
-            {
-                ESP_LOGW(TAG, "Received non query response, responding with SERVFAIL");
-                response[3] = 0b00000100; //no recursion available, NOTIMP error
-                response[6] = 0x00;
-                response[7] = 0x00;
-                err = sendto(socket_fd, response, length, 0, (struct sockaddr *)&client, client_len);
-                continue;
-            }
-
-            size_t label_count = 0;
-            size_t buf_pos = 0;
-            char label_buf[128];
-            for (int i = 12; i < length;)
-            {
-                if (data[i] == 0x00)
-                {
-                    break;
-                }
-                size_t curr_label_len = data[i];
-                label_count++;
-                if (length < curr_label_len + i)
-                {
-                    ESP_LOGE(TAG, "malformed DNS request");
-                    break;
-                }
-                memcpy(label_buf + buf_pos, data + i + 1, curr_label_len);
-                label_buf[buf_pos + curr_label_len] = '.';
-                buf_pos = buf_pos + curr_label_len + 1;
-                i += curr_label_len + 1;
-            }
-            if (buf_pos > 62)
+            client_len = sizeof(client);
+            length = recvfrom(socket_fd, rx_buf, sizeof(rx_buf), flags, (struct sockaddr *)&client, &client_len);
+            if (length <= 0)
             {
-                buf_pos = 62;
+                break;
             }
-            label_buf[buf_pos] = '\0';
+            flags = MSG_DONTWAIT;
 
-            if (strcmp(cfg->hostname, label_buf) != 0)
+            size_t resp_len = dns_build_response(&responder, rx_buf, length, tx_buf);
+            if (resp_len == 0)
             {
-                ESP_LOGD(TAG, "We don't know %s", label_buf);
-                // TODO answer with no unknown
-                response[3] = 0b00000101; //no recursion available, REFUSED error
-                response[6] = 0x00;
-                response[7] = 0x00;
-                err = sendto(socket_fd, response, length, 0, (struct sockaddr *)&client, client_len);
+                ESP_LOGD(TAG, "Dropping invalid DNS packet of %d bytes", length);
                 continue;
             }
-
-            memcpy(response + 12, data + 12, length - 12); //Copy the rest of the query section
-            idx = length;
-
-            // Prune off the OPT
-            // FIXME: We should parse the packet better than this!
-            if ((response[idx - 11] == 0x00) && (response[idx - 10] == 0x00) && (response[idx - 9] == 0x29))
-                idx -= 11;
-
-            //Set a pointer to the domain name in the question section
-            response[idx] = 0xC0;
-            response[idx + 1] = 0x0C;
-
-            //Set the type to "Host Address"
-            response[idx + 2] = 0x00;
-            response[idx + 3] = 0x01;
-
-            //Set the response class to IN
-            response[idx + 4] = 0x00;
-            response[idx + 5] = 0x01;
-
-            //A 32 bit integer specifying TTL in seconds, 0 means no caching
-            response[idx + 6] = 0x00;
-            response[idx + 7] = 0x00;
-            response[idx + 8] = 0x00;
-            response[idx + 9] = 0x00;
-
-            //RDATA length
-            response[idx + 10] = 0x00;
-            response[idx + 11] = 0x04; //4 byte IP address
-
-            //The IP address
-            // TODO use IP address from interface
-            memcpy(&response[idx + 12], &ip.ip.addr, 4);
-            /*response[idx + 12] = 192;
-            response[idx + 13] = 168;
-            response[idx + 14] = 4;
-            response[idx + 15] = 1;*/
-
-            err = sendto(socket_fd, response, idx + 16, 0, (struct sockaddr *)&client, client_len);
-            if (err < 0)
+            if (sendto(socket_fd, tx_buf, resp_len, 0, (struct sockaddr *)&client, client_len) < 0)
             {
                 ESP_LOGE(TAG, "sendto failed: %s", strerror(errno));
             }
@@ -228,7 +129,14 @@ void receive_thread(void *pvParameters)
     close(socket_fd);
 }
 
+static TaskHandle_t dns_task_handle = NULL;
+
 void init_dns_server(dns_server_config_t *cfg)
 {
-    xTaskCreate(&receive_thread, "receive_thread", 3048, cfg, 5, NULL);
+    if (dns_task_handle != NULL)
+    {
+        ESP_LOGD(TAG, "DNS server already running");
+        return;
+    }
+    xTaskCreatePinnedToCore(&receive_thread, "receive_thread", DNS_SERVER_STACK_SIZE, cfg, cfg->task_priority, &dns_task_handle, cfg->task_core_id);
 }
@@ -2,6 +2,7 @@
 #define DNS_SERVER_H
 
 #include "esp_system.h"
+#include "freertos/FreeRTOS.h"
 
 #ifdef __cplusplus
 
@@ -9,10 +10,15 @@ extern "C"
 {
 #endif
 
+#define DNS_SERVER_STACK_SIZE 3048
+
     typedef struct dns_server_config
     {
         bool answer_all;
         const char *hostname;
+        UBaseType_t task_priority;
+        // tskNO_AFFINITY to let the scheduler pick
+        BaseType_t task_core_id;
     } dns_server_config_t;
 
     void init_dns_server(dns_server_config_t *cfg);
@@ -0,0 +1,291 @@
+#include "ble_capture.h"
+
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "cJSON.h"
+#include "TaskRegistry.h"
+#include "heap_stats.h"
+#include "task_plan.h"
+
+// Records are sent in chunks of whole records
+#define CAPTURE_CHUNK_SIZE 512
+#define REPLAY_MAX_RECV_RETRIES 5
+#define REPLAY_STACK_SIZE 4096
+// A replay at maximum speed sleeps for a tick this often, so the idle task still runs
+#define REPLAY_YIELD_INTERVAL_MS 100
+
+static const char *TAG = "ble-capture";
+
+#ifdef BLE_CAPTURE
+static capture_ring_t ring = {};
+static portMUX_TYPE ring_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// Copies whole records starting at pos. The lock is only held for one record at a time,
+// so a download never holds up the BLE callbacks for long.
+static size_t capture_read(uint32_t *pos, uint8_t *out, size_t size)
+{
+    size_t copied = 0;
+    while (true)
+    {
+        portENTER_CRITICAL(&ring_mux);
+        size_t length = capture_ring_read(&ring, pos, out + copied, size - copied);
+        portEXIT_CRITICAL(&ring_mux);
+        if (length == 0)
+        {
+            break;
+        }
+        copied += length;
+    }
+    return copied;
+}
+#endif
+
+#ifdef BLE_REPLAY
+typedef struct replay
+{
+    volatile bool running;
+    bool max_speed;
+    uint8_t *data;
+    size_t length;
+    uint32_t records;
+} replay_t;
+
+static ble_replay_handler_t replay_handler = NULL;
+static replay_t replay = {};
+
+static void replay_task(void *arg)
+{
+    int64_t start_us = esp_timer_get_time();
+    int64_t yield_us = start_us;
+    uint32_t first_ms = 0;
+    uint32_t last_ms = 0;
+    size_t offset = 0;
+    for (uint32_t i = 0; i < replay.records; i++)
+    {
+        ble_capture_record_t record;
+        const uint8_t *data;
+        capture_next_record(replay.data, &offset, &record, &data);
+        if (i == 0)
+        {
+            first_ms = record.time_ms;
+        }
+        last_ms = record.time_ms;
+
+        int64_t now_us = esp_timer_get_time();
+        if (!replay.max_speed)
+        {
+            int64_t wait_us = start_us + (int64_t)(record.time_ms - first_ms) * 1000 - now_us;
+            if (wait_us > 0)
+            {
+                vTaskDelay(wait_us / 1000 / portTICK_PERIOD_MS);
+            }
+        }
+        else if (now_us - yield_us > REPLAY_YIELD_INTERVAL_MS * 1000)
+        {
+            vTaskDelay(1);
+            yield_us = esp_timer_get_time();
+        }
+        replay_handler(&record, data);
+    }
+
+    int64_t duration_ms = (esp_timer_get_time() - start_us) / 1000;
+    ESP_LOGI(TAG, "Replayed %u records covering %u ms in %lld ms", replay.records, last_ms - first_ms, duration_ms);
+    heap_stats_free(replay.data);
+    replay.data = NULL;
+    TaskRegistry::remove("ble_replay");
+    replay.running = false;
+    vTaskDelete(NULL);
+}
+#endif
+
+void ble_capture_init(ble_replay_handler_t handler)
+{
+#ifdef BLE_CAPTURE
+    if (ring.buffer == NULL)
+    {
+        uint8_t *buffer = (uint8_t *)heap_stats_malloc(HEAP_TAG_BLE, BLE_CAPTURE_BUFFER_SIZE);
+        if (buffer == NULL)
+        {
+            ESP_LOGE(TAG, "Not enough memory for the capture buffer");
+            return;
+        }
+        capture_ring_init(&ring, buffer, BLE_CAPTURE_BUFFER_SIZE);
+        ESP_LOGI(TAG, "Capturing BLE traffic into %d bytes", BLE_CAPTURE_BUFFER_SIZE);
+    }
+#endif
+#ifdef BLE_REPLAY
+    replay_handler = handler;
+#endif
+#if !defined(BLE_CAPTURE) && !defined(BLE_REPLAY)
+    ESP_LOGD(TAG, "BLE capture and replay disabled");
+#endif
+}
+
+void ble_capture_record(ble_capture_type_t type, uint16_t uuid, const uint8_t *data, size_t length)
+{
+#ifdef BLE_CAPTURE
+    if (ring.buffer == NULL)
+    {
+        return;
+    }
+    uint32_t time_ms = esp_timer_get_time() / 1000;
+    portENTER_CRITICAL(&ring_mux);
+    capture_ring_append(&ring, time_ms, type, uuid, data, length);
+    portEXIT_CRITICAL(&ring_mux);
+#endif
+}
+
+static esp_err_t capture_get_handler(httpd_req_t *req)
+{
+#ifdef BLE_CAPTURE
+    if (ring.buffer == NULL)
+    {
+        httpd_resp_set_status(req, "503");
+        httpd_resp_send(req, NULL, 0);
+        return ESP_OK;
+    }
+    ble_capture_header_t header = {};
+    header.magic = BLE_CAPTURE_MAGIC;
+    header.version = BLE_CAPTURE_VERSION;
+    portENTER_CRITICAL(&ring_mux);
+    header.dropped = ring.dropped;
+    portEXIT_CRITICAL(&ring_mux);
+
+    httpd_resp_set_type(req, "application/octet-stream");
+    httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"capture.ibqc\"");
+    if (httpd_resp_send_chunk(req, (const char *)&header, sizeof(header)) != ESP_OK)
+    {
+        return ESP_FAIL;
+    }
+
+    // Records added while downloading are sent as well, the thermometer is slower than the network
+    uint8_t chunk[CAPTURE_CHUNK_SIZE];
+    uint32_t pos = 0;
+    size_t length;
+    while ((length = capture_read(&pos, chunk, sizeof(chunk))) > 0)
+    {
+        if (httpd_resp_send_chunk(req, (const char *)chunk, length) != ESP_OK)
+        {
+            return ESP_FAIL;
+        }
+    }
+    httpd_resp_send_chunk(req, NULL, 0);
+#else
+    const char *msg = "Capture not enabled";
+    httpd_resp_set_status(req, "404");
+    httpd_resp_send(req, msg, strlen(msg));
+#endif
+    return ESP_OK;
+}
+
+static esp_err_t capture_replay_handler(httpd_req_t *req)
+{
+#ifdef BLE_REPLAY
+    if (replay.running || replay_handler == NULL)
+    {
+        httpd_resp_set_status(req, "409");
+        httpd_resp_send(req, NULL, 0);
+        return ESP_OK;
+    }
+    if (req->content_len == 0 || req->content_len > BLE_REPLAY_MAX_SIZE)
+    {
+        httpd_resp_set_status(req, "413");
+        httpd_resp_send(req, NULL, 0);
+        return ESP_OK;
+    }
+
+    uint8_t *data = (uint8_t *)heap_stats_malloc(HEAP_TAG_BLE, req->content_len);
+    if (data == NULL)
+    {
+        httpd_resp_set_status(req, "503");
+        httpd_resp_send(req, NULL, 0);
+        return ESP_OK;
+    }
+    size_t received = 0;
+    int retries = 0;
+    while (received < req->content_len)
+    {
+        int ret = httpd_req_recv(req, (char *)data + received, req->content_len - received);
+        if (ret == HTTPD_SOCK_ERR_TIMEOUT && retries++ < REPLAY_MAX_RECV_RETRIES)
+        {
+            continue;
+        }
+        if (ret <= 0)
+        {
+            heap_stats_free(data);
+            httpd_resp_set_status(req, "408");
+            httpd_resp_send(req, NULL, 0);
+            return ESP_OK;
+        }
+        retries = 0;
+        received += ret;
+    }
+
+    uint32_t records;
+    if (!capture_parse(data, received, &records))
+    {
+        heap_stats_free(data);
+        const char *msg = "Not a capture of this version or truncated";
+        httpd_resp_set_status(req, "400");
+        httpd_resp_send(req, msg, strlen(msg));
+        return ESP_OK;
+    }
+
+    char query[32];
+    char speed[8] = "";
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK)
+    {
+        httpd_query_key_value(query, "speed", speed, sizeof(speed));
+    }
+    replay.max_speed = strcmp(speed, "max") == 0;
+    replay.data = data;
+    replay.length = received;
+    replay.records = records;
+    replay.running = true;
+    ESP_LOGI(TAG, "Replaying %u records %s", records, replay.max_speed ? "as fast as possible" : "with original timing");
+    xTaskCreatePinnedToCore(&replay_task, "ble_replay", REPLAY_STACK_SIZE, NULL, TASK_PRIO_BLE_REPLAY, NULL, TASK_CORE_BLE);
+    TaskRegistry::add("ble_replay", REPLAY_STACK_SIZE);
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddNumberToObject(root, "records", records);
+    cJSON_AddBoolToObject(root, "max_speed", replay.max_speed);
+    char *jsonString = cJSON_Print(root);
+    cJSON_Delete(root);
+    httpd_resp_set_status(req, "202");
+    // The replay already runs, out of memory for the answer only loses its body
+    if (jsonString == NULL)
+    {
+        httpd_resp_send(req, NULL, 0);
+        return ESP_OK;
+    }
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, jsonString, strlen(jsonString));
+    cJSON_free(jsonString);
+#else
+    const char *msg = "Replay not enabled";
+    httpd_resp_set_status(req, "404");
+    httpd_resp_send(req, msg, strlen(msg));
+#endif
+    return ESP_OK;
+}
+
+static httpd_uri_t capture_get_route = {
+    .uri = "/capture",
+    .method = HTTP_GET,
+    .handler = capture_get_handler,
+    .user_ctx = NULL};
+
+static httpd_uri_t capture_replay_route = {
+    .uri = "/capture",
+    .method = HTTP_POST,
+    .handler = capture_replay_handler,
+    .user_ctx = NULL};
+
+void register_capture_routes(httpd_handle_t server)
+{
+    httpd_register_uri_handler(server, &capture_get_route);
+    httpd_register_uri_handler(server, &capture_replay_route);
+}
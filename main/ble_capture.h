@@ -0,0 +1,39 @@
+#ifndef BLE_CAPTURE_H
+#define BLE_CAPTURE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+#include "capture_records.h"
+
+// Record the traffic with the thermometer in RAM, GET /capture downloads it
+//#define BLE_CAPTURE
+// Leave the radio off and feed captures uploaded with POST /capture through the iBBQ callbacks instead
+//#define BLE_REPLAY
+
+// Oldest records are dropped once the buffer is full, about 20 minutes of a cook
+#define BLE_CAPTURE_BUFFER_SIZE 16384
+#define BLE_REPLAY_MAX_SIZE 65536
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef void (*ble_replay_handler_t)(const ble_capture_record_t *record, const uint8_t *data);
+
+    // Allocates the capture buffer, the handler receives the records of uploaded captures with BLE_REPLAY
+    void ble_capture_init(ble_replay_handler_t replay_handler);
+    // Safe to call from any task, does nothing without BLE_CAPTURE
+    void ble_capture_record(ble_capture_type_t type, uint16_t uuid, const uint8_t *data, size_t length);
+    // Registers GET /capture to download the recorded traffic and POST /capture to replay a capture,
+    // POST /capture?speed=max replays it as fast as possible instead of with the original timing
+    void register_capture_routes(httpd_handle_t server);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,86 @@
+#include "boot.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "boot";
+
+#define PHASE_BIT(phase) ((EventBits_t)1 << (phase))
+
+static EventGroupHandle_t boot_event_group = NULL;
+static boot_phase_record_t timeline[BOOT_PHASE_COUNT] = {};
+
+static const char *phase_names[BOOT_PHASE_COUNT] = {
+    "nvs",
+    "settings",
+    "spiffs",
+    "ble",
+    "wifi",
+    "network_up",
+    "webserver",
+    "ibbq_connected",
+    "first_temp"};
+
+static_assert(BOOT_PHASE_COUNT <= 24, "FreeRTOS event groups only provide 24 usable bits");
+
+void boot_init()
+{
+    if (boot_event_group == NULL)
+    {
+        boot_event_group = xEventGroupCreate();
+    }
+}
+
+void boot_phase_start(boot_phase_t phase)
+{
+    if (timeline[phase].started_us == 0)
+    {
+        timeline[phase].started_us = esp_timer_get_time();
+    }
+}
+
+void boot_phase_done(boot_phase_t phase, esp_err_t result)
+{
+    if (boot_phase_is_done(phase))
+    {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    if (timeline[phase].started_us == 0)
+    {
+        timeline[phase].started_us = now;
+    }
+    timeline[phase].result = result;
+    timeline[phase].done_us = now;
+    xEventGroupSetBits(boot_event_group, PHASE_BIT(phase));
+
+    ESP_LOGI(TAG, "Boot phase %s finished after %lld ms (took %lld ms): %s",
+             phase_names[phase], now / 1000, (now - timeline[phase].started_us) / 1000, esp_err_to_name(result));
+}
+
+bool boot_phase_wait(boot_phase_t phase, TickType_t timeout)
+{
+    EventBits_t bits = xEventGroupWaitBits(boot_event_group, PHASE_BIT(phase), pdFALSE, pdTRUE, timeout);
+    return (bits & PHASE_BIT(phase)) != 0;
+}
+
+bool boot_phase_is_done(boot_phase_t phase)
+{
+    return (xEventGroupGetBits(boot_event_group) & PHASE_BIT(phase)) != 0;
+}
+
+const char *boot_phase_name(boot_phase_t phase)
+{
+    if (phase >= BOOT_PHASE_COUNT)
+    {
+        return "unknown";
+    }
+    return phase_names[phase];
+}
+
+const boot_phase_record_t *boot_timeline()
+{
+    return timeline;
+}
@@ -0,0 +1,49 @@
+#ifndef BOOT_H
+#define BOOT_H
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef enum boot_phase
+    {
+        BOOT_PHASE_NVS,
+        BOOT_PHASE_SETTINGS,
+        BOOT_PHASE_SPIFFS,
+        BOOT_PHASE_BLE,
+        BOOT_PHASE_WIFI,
+        BOOT_PHASE_NETWORK_UP,
+        BOOT_PHASE_WEBSERVER,
+        BOOT_PHASE_IBBQ_CONNECTED,
+        BOOT_PHASE_FIRST_TEMP,
+        BOOT_PHASE_COUNT
+    } boot_phase_t;
+
+    typedef struct boot_phase_record
+    {
+        // Both timestamps are microseconds since power on, 0 if not reached yet
+        int64_t started_us;
+        int64_t done_us;
+        esp_err_t result;
+    } boot_phase_record_t;
+
+    void boot_init();
+    void boot_phase_start(boot_phase_t phase);
+    // Only the first call per phase is recorded, so hot paths can call this unconditionally
+    void boot_phase_done(boot_phase_t phase, esp_err_t result);
+    bool boot_phase_wait(boot_phase_t phase, TickType_t timeout);
+    bool boot_phase_is_done(boot_phase_t phase);
+
+    const char *boot_phase_name(boot_phase_t phase);
+    const boot_phase_record_t *boot_timeline();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
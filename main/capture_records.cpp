@@ -0,0 +1,149 @@
+#include "capture_records.h"
+
+#include <string.h>
+
+#include "ibbq_notify.h"
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+// Both copy in at most two pieces, split where the ring wraps around
+static void ring_write(capture_ring_t *ring, uint32_t pos, const void *data, size_t length)
+{
+    size_t offset = pos % ring->size;
+    size_t first = MIN(length, ring->size - offset);
+    memcpy(ring->buffer + offset, data, first);
+    memcpy(ring->buffer, (const uint8_t *)data + first, length - first);
+}
+
+static void ring_read(const capture_ring_t *ring, uint32_t pos, void *data, size_t length)
+{
+    size_t offset = pos % ring->size;
+    size_t first = MIN(length, ring->size - offset);
+    memcpy(data, ring->buffer + offset, first);
+    memcpy((uint8_t *)data + first, ring->buffer, length - first);
+}
+
+void capture_ring_init(capture_ring_t *ring, uint8_t *buffer, size_t size)
+{
+    memset(ring, 0, sizeof(*ring));
+    ring->buffer = buffer;
+    ring->size = size;
+}
+
+void capture_ring_append(capture_ring_t *ring, uint32_t time_ms, ble_capture_type_t type, uint16_t uuid,
+                         const uint8_t *data, size_t length)
+{
+    ble_capture_record_t record;
+    record.time_ms = time_ms;
+    record.type = type;
+    record.length = MIN(length, BLE_CAPTURE_MAX_DATA);
+    record.uuid = uuid;
+    size_t total = sizeof(record) + record.length;
+    while (ring->head + total - ring->tail > ring->size)
+    {
+        ble_capture_record_t oldest;
+        ring_read(ring, ring->tail, &oldest, sizeof(oldest));
+        ring->tail += sizeof(oldest) + oldest.length;
+        ring->dropped++;
+    }
+    ring_write(ring, ring->head, &record, sizeof(record));
+    // Events without data pass NULL, which memcpy must not get even for 0 bytes
+    if (record.length > 0)
+    {
+        ring_write(ring, ring->head + sizeof(record), data, record.length);
+    }
+    ring->head += total;
+}
+
+size_t capture_ring_read(const capture_ring_t *ring, uint32_t *pos, uint8_t *out, size_t size)
+{
+    if (*pos < ring->tail)
+    {
+        *pos = ring->tail;
+    }
+    if (*pos == ring->head)
+    {
+        return 0;
+    }
+    ble_capture_record_t record;
+    ring_read(ring, *pos, &record, sizeof(record));
+    size_t length = sizeof(record) + record.length;
+    if (length > size)
+    {
+        return 0;
+    }
+    ring_read(ring, *pos, out, length);
+    *pos += length;
+    return length;
+}
+
+bool capture_parse(const uint8_t *capture, size_t length, uint32_t *records)
+{
+    ble_capture_header_t header;
+    if (length < sizeof(header))
+    {
+        return false;
+    }
+    memcpy(&header, capture, sizeof(header));
+    if (header.magic != BLE_CAPTURE_MAGIC || header.version != BLE_CAPTURE_VERSION)
+    {
+        return false;
+    }
+    *records = 0;
+    size_t pos = sizeof(header);
+    while (pos + sizeof(ble_capture_record_t) <= length)
+    {
+        ble_capture_record_t record;
+        memcpy(&record, capture + pos, sizeof(record));
+        pos += sizeof(record) + record.length;
+        (*records)++;
+    }
+    return pos == length;
+}
+
+void capture_next_record(const uint8_t *capture, size_t *offset, ble_capture_record_t *record, const uint8_t **data)
+{
+    if (*offset == 0)
+    {
+        *offset = sizeof(ble_capture_header_t);
+    }
+    memcpy(record, capture + *offset, sizeof(*record));
+    *data = capture + *offset + sizeof(*record);
+    *offset += sizeof(*record) + record->length;
+}
+
+capture_replay_event_t capture_replay_apply(capture_replay_state_t *state, const ble_capture_record_t *record,
+                                            const uint8_t *data)
+{
+    switch (record->type)
+    {
+    case BLE_CAPTURE_READY:
+        state->connected = true;
+        return CAPTURE_REPLAY_CONNECTED;
+    case BLE_CAPTURE_DISCONNECTED:
+    case BLE_CAPTURE_TIMEOUT:
+        state->connected = false;
+        state->probe_count = 0;
+        return CAPTURE_REPLAY_DISCONNECTED;
+    case BLE_CAPTURE_NOTIFY:
+        if (record->uuid == IBBQ_UUID_REALTIME_DATA)
+        {
+            state->probe_count = ibbq_parse_realtime(data, record->length, state->raw_values);
+            return CAPTURE_REPLAY_TEMPS;
+        }
+        if (record->uuid == IBBQ_UUID_SETTINGS_RESULT && ibbq_parse_battery(data, record->length, &state->battery_percent))
+        {
+            return CAPTURE_REPLAY_BATTERY;
+        }
+        return CAPTURE_REPLAY_NONE;
+    case BLE_CAPTURE_RSSI:
+        if (record->length > 0)
+        {
+            state->rssi = data[0];
+            return CAPTURE_REPLAY_RSSI;
+        }
+        return CAPTURE_REPLAY_NONE;
+    default:
+        return CAPTURE_REPLAY_NONE;
+    }
+}
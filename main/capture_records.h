@@ -0,0 +1,118 @@
+#ifndef CAPTURE_RECORDS_H
+#define CAPTURE_RECORDS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "probe_state.h"
+
+// Format, ring buffer and replay of BLE captures. Locking, timing and the HTTP routes live in
+// ble_capture.cpp, this header doesn't pull in ESP-IDF so the code also builds on a PC.
+
+// Longer payloads are truncated, iBBQ payloads never exceed 20 bytes
+#define BLE_CAPTURE_MAX_DATA 32
+
+#define BLE_CAPTURE_MAGIC 0x43514269 // "iBQC"
+#define BLE_CAPTURE_VERSION 1
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef enum ble_capture_type
+    {
+        // Scan found the thermometer, data is the address and the RSSI as int8
+        BLE_CAPTURE_DISCOVERED = 1,
+        // Result of the connection attempt, data is 1 on success
+        BLE_CAPTURE_CONNECT,
+        // Authenticated and subscribed, temperatures follow
+        BLE_CAPTURE_READY,
+        BLE_CAPTURE_DISCONNECTED,
+        // The connection attempt didn't finish in time and BLE was restarted
+        BLE_CAPTURE_TIMEOUT,
+        // GATT operations, uuid is the 16 bit UUID of the characteristic
+        BLE_CAPTURE_READ,
+        BLE_CAPTURE_WRITE,
+        BLE_CAPTURE_NOTIFY,
+        // Data is the RSSI of the connection as int8
+        BLE_CAPTURE_RSSI
+    } ble_capture_type_t;
+
+    // A capture is this header followed by the records, oldest first, all little endian
+    typedef struct __attribute__((packed)) ble_capture_header
+    {
+        uint32_t magic;
+        uint8_t version;
+        uint8_t reserved[3];
+        // Records that were overwritten before the download
+        uint32_t dropped;
+    } ble_capture_header_t;
+
+    // Followed by length bytes of data
+    typedef struct __attribute__((packed)) ble_capture_record
+    {
+        // Since boot
+        uint32_t time_ms;
+        uint8_t type;
+        uint8_t length;
+        uint16_t uuid;
+    } ble_capture_record_t;
+
+    // Records wrap around buffer, the oldest are dropped to make room. Positions count every
+    // byte ever written, so a reader notices when its data was overwritten.
+    typedef struct capture_ring
+    {
+        uint8_t *buffer;
+        // At least one record with BLE_CAPTURE_MAX_DATA bytes
+        size_t size;
+        uint32_t head;
+        uint32_t tail;
+        uint32_t dropped;
+    } capture_ring_t;
+
+    void capture_ring_init(capture_ring_t *ring, uint8_t *buffer, size_t size);
+    // Data longer than BLE_CAPTURE_MAX_DATA is truncated
+    void capture_ring_append(capture_ring_t *ring, uint32_t time_ms, ble_capture_type_t type, uint16_t uuid,
+                             const uint8_t *data, size_t length);
+    // Copies the record at pos into out and moves pos past it, pos first skips ahead if the record
+    // there was already overwritten. Returns 0 once pos reached the head or the record doesn't fit.
+    size_t capture_ring_read(const capture_ring_t *ring, uint32_t *pos, uint8_t *out, size_t size);
+
+    // Counts the records, returns false unless the header matches and the capture ends exactly
+    // after the last record
+    bool capture_parse(const uint8_t *capture, size_t length, uint32_t *records);
+    // Walks the records of a capture checked by capture_parse, offset starts at 0
+    void capture_next_record(const uint8_t *capture, size_t *offset, ble_capture_record_t *record,
+                             const uint8_t **data);
+
+    typedef enum capture_replay_event
+    {
+        CAPTURE_REPLAY_NONE,
+        CAPTURE_REPLAY_CONNECTED,
+        CAPTURE_REPLAY_DISCONNECTED,
+        CAPTURE_REPLAY_TEMPS,
+        CAPTURE_REPLAY_BATTERY,
+        CAPTURE_REPLAY_RSSI
+    } capture_replay_event_t;
+
+    // What the records replayed so far say about the thermometer
+    typedef struct capture_replay_state
+    {
+        bool connected;
+        uint8_t rssi;
+        size_t probe_count;
+        uint16_t raw_values[MAX_PROBE_COUNT];
+        float battery_percent;
+    } capture_replay_state_t;
+
+    // Applies a record the way the BLE callbacks handle the same traffic, returns what changed
+    capture_replay_event_t capture_replay_apply(capture_replay_state_t *state, const ble_capture_record_t *record,
+                                                const uint8_t *data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,156 @@
+#include "cbor_stream.h"
+
+#include <string.h>
+#include <math.h>
+
+#define MAJOR_UINT 0
+#define MAJOR_NEGATIVE 1
+#define MAJOR_TEXT 3
+#define MAJOR_ARRAY 4
+#define MAJOR_MAP 5
+#define MAJOR_SIMPLE 7
+
+#define SIMPLE_FALSE 20
+#define SIMPLE_TRUE 21
+#define SIMPLE_NULL 22
+#define SIMPLE_FLOAT32 26
+
+void cbor_stream_init(cbor_stream_t *stream, cbor_stream_write_t write, void *ctx)
+{
+    memset(stream, 0, sizeof(*stream));
+    stream->write = write;
+    stream->ctx = ctx;
+}
+
+static void flush(cbor_stream_t *stream)
+{
+    if (stream->len > 0 && !stream->failed)
+    {
+        stream->failed = !stream->write(stream->buf, stream->len, stream->ctx);
+    }
+    stream->len = 0;
+}
+
+static void put(cbor_stream_t *stream, const uint8_t *data, size_t len)
+{
+    stream->total += len;
+    while (len > 0)
+    {
+        if (stream->len == CBOR_STREAM_BUF_SIZE)
+        {
+            flush(stream);
+        }
+        size_t n = CBOR_STREAM_BUF_SIZE - stream->len;
+        if (n > len)
+        {
+            n = len;
+        }
+        memcpy(stream->buf + stream->len, data, n);
+        stream->len += n;
+        data += n;
+        len -= n;
+    }
+}
+
+// Initial byte with the shortest encoding of the argument, followed by it in network byte order
+static void put_head(cbor_stream_t *stream, uint8_t major, uint64_t value)
+{
+    uint8_t head[9];
+    size_t len;
+    if (value < 24)
+    {
+        head[0] = (major << 5) | value;
+        len = 1;
+    }
+    else if (value <= UINT8_MAX)
+    {
+        head[0] = (major << 5) | 24;
+        len = 2;
+    }
+    else if (value <= UINT16_MAX)
+    {
+        head[0] = (major << 5) | 25;
+        len = 3;
+    }
+    else if (value <= UINT32_MAX)
+    {
+        head[0] = (major << 5) | 26;
+        len = 5;
+    }
+    else
+    {
+        head[0] = (major << 5) | 27;
+        len = 9;
+    }
+    for (size_t i = len - 1; i > 0; i--)
+    {
+        head[i] = value & 0xFF;
+        value >>= 8;
+    }
+    put(stream, head, len);
+}
+
+void cbor_stream_map(cbor_stream_t *stream, size_t pairs)
+{
+    put_head(stream, MAJOR_MAP, pairs);
+}
+
+void cbor_stream_array(cbor_stream_t *stream, size_t count)
+{
+    put_head(stream, MAJOR_ARRAY, count);
+}
+
+void cbor_stream_uint(cbor_stream_t *stream, uint64_t value)
+{
+    put_head(stream, MAJOR_UINT, value);
+}
+
+void cbor_stream_int(cbor_stream_t *stream, int64_t value)
+{
+    if (value < 0)
+    {
+        // -1 - value without overflowing for INT64_MIN
+        put_head(stream, MAJOR_NEGATIVE, ~(uint64_t)value);
+    }
+    else
+    {
+        put_head(stream, MAJOR_UINT, value);
+    }
+}
+
+void cbor_stream_float(cbor_stream_t *stream, float value)
+{
+    if (value == floorf(value) && fabsf(value) < 2147483648.0f)
+    {
+        cbor_stream_int(stream, (int64_t)value);
+        return;
+    }
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint8_t data[5] = {(MAJOR_SIMPLE << 5) | SIMPLE_FLOAT32,
+                       (uint8_t)(bits >> 24), (uint8_t)(bits >> 16), (uint8_t)(bits >> 8), (uint8_t)bits};
+    put(stream, data, sizeof(data));
+}
+
+void cbor_stream_bool(cbor_stream_t *stream, bool value)
+{
+    put_head(stream, MAJOR_SIMPLE, value ? SIMPLE_TRUE : SIMPLE_FALSE);
+}
+
+void cbor_stream_null(cbor_stream_t *stream)
+{
+    put_head(stream, MAJOR_SIMPLE, SIMPLE_NULL);
+}
+
+void cbor_stream_string(cbor_stream_t *stream, const char *value)
+{
+    size_t len = strlen(value);
+    put_head(stream, MAJOR_TEXT, len);
+    put(stream, (const uint8_t *)value, len);
+}
+
+bool cbor_stream_finish(cbor_stream_t *stream)
+{
+    flush(stream);
+    return !stream->failed;
+}
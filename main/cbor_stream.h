@@ -0,0 +1,52 @@
+#ifndef CBOR_STREAM_H
+#define CBOR_STREAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Bytes collected before they are handed to the writer
+#define CBOR_STREAM_BUF_SIZE 256
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Returns false if the bytes could not be sent, everything encoded afterwards is dropped
+    typedef bool (*cbor_stream_write_t)(const uint8_t *data, size_t len, void *ctx);
+
+    // Encoder for CBOR (RFC 7049) that writes through a small buffer, so a response of any
+    // size is sent in chunks without building it in memory first. Maps and arrays have a
+    // definite length, the caller passes the number of pairs or items up front.
+    typedef struct cbor_stream
+    {
+        cbor_stream_write_t write;
+        void *ctx;
+        uint8_t buf[CBOR_STREAM_BUF_SIZE];
+        size_t len;
+        // Bytes encoded so far
+        size_t total;
+        bool failed;
+    } cbor_stream_t;
+
+    void cbor_stream_init(cbor_stream_t *stream, cbor_stream_write_t write, void *ctx);
+
+    void cbor_stream_map(cbor_stream_t *stream, size_t pairs);
+    void cbor_stream_array(cbor_stream_t *stream, size_t count);
+    void cbor_stream_uint(cbor_stream_t *stream, uint64_t value);
+    void cbor_stream_int(cbor_stream_t *stream, int64_t value);
+    // Whole numbers are sent as integers, everything else as single precision
+    void cbor_stream_float(cbor_stream_t *stream, float value);
+    void cbor_stream_bool(cbor_stream_t *stream, bool value);
+    void cbor_stream_null(cbor_stream_t *stream);
+    void cbor_stream_string(cbor_stream_t *stream, const char *value);
+
+    // Writes what is left in the buffer, returns false if any write failed
+    bool cbor_stream_finish(cbor_stream_t *stream);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,206 @@
+#include "event_log.h"
+
+#include <atomic>
+#include <string.h>
+#include <stdio.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "TaskRegistry.h"
+
+#define EVENT_LOG_MASK (EVENT_LOG_SIZE - 1)
+#define CONSOLE_POLL_INTERVAL_MS 500
+#define CONSOLE_STACK_SIZE 2048
+
+static_assert((EVENT_LOG_SIZE & EVENT_LOG_MASK) == 0, "EVENT_LOG_SIZE must be a power of two");
+
+static const char *TAG = "event-log";
+
+static const char *formats[EVT_COUNT] = {
+    "Probe %d has value %.1f",
+    "Current battery level %.0f %%",
+    "Discovered %d BLE devices",
+    "Discovered device %06X%06X with RSSI %d"};
+
+typedef struct event_log_slot
+{
+    // Sequence number of the record + 1, 0 while a writer is filling the slot
+    std::atomic<uint32_t> seq;
+    // Set while a writer fills the slot, only one writer may touch the record
+    std::atomic<bool> writing;
+    // Sequence number + 1 of a record that gave up the slot, the reader skips it instead of waiting
+    std::atomic<uint32_t> dropped;
+    event_log_record_t record;
+} event_log_slot_t;
+
+static std::atomic<uint32_t> head(0);
+static event_log_slot_t ring[EVENT_LOG_SIZE];
+
+void event_log_write(event_log_id_t id, uint8_t argc, const event_log_arg_t *args)
+{
+    uint32_t idx = head.fetch_add(1, std::memory_order_relaxed);
+    event_log_slot_t *slot = &ring[idx & EVENT_LOG_MASK];
+
+    // A writer preempted for a whole lap may still be in the slot, or a later lap already filled it.
+    // Two writers in one slot would mix their records, so this one drops its record instead of waiting.
+    if (slot->writing.exchange(true, std::memory_order_acquire))
+    {
+        slot->dropped.store(idx + 1, std::memory_order_release);
+        return;
+    }
+    if ((int32_t)(slot->seq.load(std::memory_order_relaxed) - (idx + 1)) > 0)
+    {
+        slot->writing.store(false, std::memory_order_release);
+        return;
+    }
+
+    slot->seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot->record.timestamp_ms = esp_timer_get_time() / 1000;
+    slot->record.id = id;
+    slot->record.argc = argc > EVENT_LOG_MAX_ARGS ? EVENT_LOG_MAX_ARGS : argc;
+    memcpy(slot->record.args, args, slot->record.argc * sizeof(event_log_arg_t));
+    slot->seq.store(idx + 1, std::memory_order_release);
+    slot->writing.store(false, std::memory_order_release);
+}
+
+uint32_t event_log_oldest()
+{
+    uint32_t current = head.load(std::memory_order_acquire);
+    return current > EVENT_LOG_SIZE ? current - EVENT_LOG_SIZE : 0;
+}
+
+bool event_log_read(uint32_t *cursor, event_log_record_t *record, uint32_t *lost)
+{
+    while (true)
+    {
+        uint32_t current = head.load(std::memory_order_acquire);
+        if (*cursor >= current)
+        {
+            return false;
+        }
+        if (current - *cursor > EVENT_LOG_SIZE)
+        {
+            uint32_t oldest = current - EVENT_LOG_SIZE;
+            if (lost)
+            {
+                *lost += oldest - *cursor;
+            }
+            *cursor = oldest;
+        }
+
+        event_log_slot_t *slot = &ring[*cursor & EVENT_LOG_MASK];
+        uint32_t seq = slot->seq.load(std::memory_order_acquire);
+        // head is advanced before the writer clears the slot, so the slot may still hold 0
+        // or the record of the previous lap. The wanted record shows up on the next read, unless
+        // its writer dropped it.
+        if ((int32_t)(seq - (*cursor + 1)) < 0 && slot->dropped.load(std::memory_order_acquire) != *cursor + 1)
+        {
+            return false;
+        }
+        if (seq == *cursor + 1)
+        {
+            memcpy(record, &slot->record, sizeof(event_log_record_t));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot->seq.load(std::memory_order_relaxed) == seq)
+            {
+                (*cursor)++;
+                return true;
+            }
+        }
+        // A later lap overwrote the slot before or while copying or the writer dropped the record
+        if (lost)
+        {
+            (*lost)++;
+        }
+        (*cursor)++;
+    }
+}
+
+int event_log_format(const event_log_record_t *record, char *buf, size_t len)
+{
+    if (record->id >= EVT_COUNT)
+    {
+        return snprintf(buf, len, "%u: unknown event %u\n", (unsigned)record->timestamp_ms, (unsigned)record->id);
+    }
+
+    int written = snprintf(buf, len, "%u: ", (unsigned)record->timestamp_ms);
+    const char *fmt = formats[record->id];
+    uint8_t arg = 0;
+    char spec[16];
+    while (*fmt != '\0' && written >= 0)
+    {
+        size_t remaining = (size_t)written < len ? len - written : 0;
+        char *out = buf + (remaining > 0 ? written : 0);
+        if (*fmt != '%' || fmt[1] == '%')
+        {
+            if (remaining > 1)
+            {
+                *out = *fmt;
+                out[1] = '\0';
+            }
+            written++;
+            fmt += (*fmt == '%') ? 2 : 1;
+            continue;
+        }
+
+        // Isolate a single conversion and format it with the type it expects
+        size_t spec_len = 0;
+        do
+        {
+            spec[spec_len++] = *fmt++;
+        } while (*fmt != '\0' && strchr("diouxXeEfgGc", fmt[-1]) == NULL && spec_len < sizeof(spec) - 1);
+        spec[spec_len] = '\0';
+
+        event_log_arg_t val = arg < record->argc ? record->args[arg] : event_log_arg_t{0};
+        arg++;
+        char conversion = spec[spec_len - 1];
+        if (strchr("eEfgG", conversion) != NULL)
+        {
+            written += snprintf(out, remaining, spec, (double)val.f);
+        }
+        else
+        {
+            written += snprintf(out, remaining, spec, val.i);
+        }
+    }
+    size_t remaining = (size_t)written < len ? len - written : 0;
+    written += snprintf(buf + (remaining > 0 ? written : 0), remaining, "\n");
+    return written;
+}
+
+#ifdef EVENT_LOG_CONSOLE
+static void console_task(void *arg)
+{
+    uint32_t cursor = event_log_oldest();
+    uint32_t lost = 0;
+    event_log_record_t record;
+    char line[128];
+    while (true)
+    {
+        while (event_log_read(&cursor, &record, &lost))
+        {
+            event_log_format(&record, line, sizeof(line));
+            printf("%s", line);
+        }
+        if (lost > 0)
+        {
+            ESP_LOGW(TAG, "Console was too slow, lost %u events", (unsigned)lost);
+            lost = 0;
+        }
+        vTaskDelay(pdMS_TO_TICKS(CONSOLE_POLL_INTERVAL_MS));
+    }
+}
+#endif
+
+void event_log_start_console()
+{
+#ifdef EVENT_LOG_CONSOLE
+    xTaskCreate(&console_task, "event_log_console", CONSOLE_STACK_SIZE, NULL, tskIDLE_PRIORITY + 1, NULL);
+    TaskRegistry::add("event_log_console", CONSOLE_STACK_SIZE);
+#else
+    ESP_LOGD(TAG, "Event log console echo disabled, events are available via GET /log");
+#endif
+}
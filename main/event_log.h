@@ -0,0 +1,89 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define EVENT_LOG_MAX_ARGS 4
+// Must be a power of two
+#define EVENT_LOG_SIZE 64
+
+// Echo all events to the console from a low priority task
+//#define EVENT_LOG_CONSOLE
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Every id maps to a format string in event_log.cpp, keep both in the same order
+    typedef enum event_log_id
+    {
+        EVT_PROBE_TEMP,
+        EVT_BATTERY_LEVEL,
+        EVT_BLE_SCAN_FINISHED,
+        EVT_BLE_DEVICE,
+        EVT_COUNT
+    } event_log_id_t;
+
+    typedef union event_log_arg
+    {
+        int32_t i;
+        float f;
+    } event_log_arg_t;
+
+    typedef struct event_log_record
+    {
+        uint32_t timestamp_ms;
+        uint16_t id;
+        uint8_t argc;
+        uint8_t reserved;
+        event_log_arg_t args[EVENT_LOG_MAX_ARGS];
+    } event_log_record_t;
+
+    // Safe to call from any task, never blocks and never allocates. The oldest
+    // records are overwritten if nobody reads them in time.
+    void event_log_write(event_log_id_t id, uint8_t argc, const event_log_arg_t *args);
+
+    // Copies the next record after *cursor into record and advances the cursor.
+    // Returns false if there is no new record. Records that were overwritten before
+    // they could be read are counted in *lost.
+    bool event_log_read(uint32_t *cursor, event_log_record_t *record, uint32_t *lost);
+    // Cursor pointing to the oldest record still in the ring
+    uint32_t event_log_oldest();
+
+    // Formats a single record as text line, returns the length like snprintf
+    int event_log_format(const event_log_record_t *record, char *buf, size_t len);
+
+    void event_log_start_console();
+
+#ifdef __cplusplus
+}
+
+#include <type_traits>
+
+template <typename T>
+static inline event_log_arg_t event_log_arg(T val)
+{
+    event_log_arg_t arg;
+    if (std::is_floating_point<T>::value)
+    {
+        arg.f = (float)val;
+    }
+    else
+    {
+        arg.i = (int32_t)val;
+    }
+    return arg;
+}
+
+template <typename... Args>
+static inline void event_log(event_log_id_t id, Args... args)
+{
+    static_assert(sizeof...(Args) <= EVENT_LOG_MAX_ARGS, "Too many arguments for an event log record");
+    event_log_arg_t packed[sizeof...(Args) + 1] = {event_log_arg(args)...};
+    event_log_write(id, sizeof...(Args), packed);
+}
+#endif
+
+#endif
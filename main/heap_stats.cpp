@@ -0,0 +1,173 @@
+#include "heap_stats.h"
+
+#include <atomic>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#define HEADER_MAGIC 0x4853
+
+static const char *TAG = "heap-stats";
+
+static const char *tag_names[HEAP_TAG_COUNT] = {
+    "ble",
+    "http",
+    "json",
+    "settings",
+    "upload"};
+
+// Put in front of every tagged block, 8 bytes to keep the alignment malloc gives
+typedef struct block_header
+{
+    uint32_t size;
+    uint16_t tag;
+    uint16_t magic;
+} block_header_t;
+
+static_assert(sizeof(block_header_t) == 8, "The block header has to keep 8 byte alignment");
+
+typedef struct tag_counters
+{
+    std::atomic<int32_t> current_bytes;
+    std::atomic<int32_t> peak_bytes;
+    std::atomic<uint32_t> allocs;
+    std::atomic<uint32_t> failures;
+} tag_counters_t;
+
+static tag_counters_t counters[HEAP_TAG_COUNT];
+
+static heap_sample_t history[HEAP_SAMPLE_COUNT] = {};
+static uint32_t history_count = 0;
+static portMUX_TYPE history_mux = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t sample_timer = NULL;
+
+static void account(heap_tag_t tag, int32_t bytes)
+{
+    tag_counters_t *c = &counters[tag];
+    int32_t current = c->current_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    int32_t peak = c->peak_bytes.load(std::memory_order_relaxed);
+    while (current > peak && !c->peak_bytes.compare_exchange_weak(peak, current, std::memory_order_relaxed))
+    {
+    }
+}
+
+void *heap_stats_malloc(heap_tag_t tag, size_t size)
+{
+    block_header_t *header = (block_header_t *)malloc(sizeof(block_header_t) + size);
+    if (header == NULL)
+    {
+        counters[tag].failures.fetch_add(1, std::memory_order_relaxed);
+        return NULL;
+    }
+    header->size = size;
+    header->tag = tag;
+    header->magic = HEADER_MAGIC;
+    counters[tag].allocs.fetch_add(1, std::memory_order_relaxed);
+    account(tag, size);
+    return header + 1;
+}
+
+void *heap_stats_calloc(heap_tag_t tag, size_t count, size_t size)
+{
+    if (size != 0 && count > SIZE_MAX / size)
+    {
+        counters[tag].failures.fetch_add(1, std::memory_order_relaxed);
+        return NULL;
+    }
+    void *ptr = heap_stats_malloc(tag, count * size);
+    if (ptr != NULL)
+    {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+void heap_stats_free(void *ptr)
+{
+    if (ptr == NULL)
+    {
+        return;
+    }
+    block_header_t *header = (block_header_t *)ptr - 1;
+    if (header->magic != HEADER_MAGIC || header->tag >= HEAP_TAG_COUNT)
+    {
+        // Freeing this with free() would corrupt the heap as well, so fail loudly
+        ESP_LOGE(TAG, "Block %p was not allocated by heap_stats_malloc", ptr);
+        abort();
+    }
+    header->magic = 0;
+    account((heap_tag_t)header->tag, -(int32_t)header->size);
+    free(header);
+}
+
+void heap_stats_add(heap_tag_t tag, int32_t bytes)
+{
+    account(tag, bytes);
+}
+
+void heap_stats_get(heap_tag_t tag, heap_tag_stats_t *stats)
+{
+    stats->current_bytes = counters[tag].current_bytes.load(std::memory_order_relaxed);
+    stats->peak_bytes = counters[tag].peak_bytes.load(std::memory_order_relaxed);
+    stats->allocs = counters[tag].allocs.load(std::memory_order_relaxed);
+    stats->failures = counters[tag].failures.load(std::memory_order_relaxed);
+}
+
+const char *heap_tag_name(heap_tag_t tag)
+{
+    return tag < HEAP_TAG_COUNT ? tag_names[tag] : "unknown";
+}
+
+heap_sample_t heap_stats_sample_now()
+{
+    heap_sample_t sample;
+    sample.uptime_s = esp_timer_get_time() / 1000000;
+    sample.free_bytes = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    sample.largest_free_block = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    sample.fragmentation = 0;
+    if (sample.free_bytes > 0)
+    {
+        sample.fragmentation = 1000 - (uint64_t)sample.largest_free_block * 1000 / sample.free_bytes;
+    }
+    return sample;
+}
+
+static void sample_heap(void *arg)
+{
+    heap_sample_t sample = heap_stats_sample_now();
+    portENTER_CRITICAL(&history_mux);
+    history[history_count % HEAP_SAMPLE_COUNT] = sample;
+    history_count++;
+    portEXIT_CRITICAL(&history_mux);
+}
+
+size_t heap_stats_history(heap_sample_t *samples, size_t max_samples)
+{
+    portENTER_CRITICAL(&history_mux);
+    size_t available = history_count < HEAP_SAMPLE_COUNT ? history_count : HEAP_SAMPLE_COUNT;
+    size_t count = available < max_samples ? available : max_samples;
+    uint32_t first = history_count - count;
+    for (size_t i = 0; i < count; i++)
+    {
+        samples[i] = history[(first + i) % HEAP_SAMPLE_COUNT];
+    }
+    portEXIT_CRITICAL(&history_mux);
+    return count;
+}
+
+void heap_stats_init()
+{
+    if (sample_timer == NULL)
+    {
+        esp_timer_create_args_t timer_args = {};
+        timer_args.callback = sample_heap;
+        timer_args.name = "heap_sample";
+        ESP_ERROR_CHECK(esp_timer_create(&timer_args, &sample_timer));
+        ESP_ERROR_CHECK(esp_timer_start_periodic(sample_timer, HEAP_SAMPLE_INTERVAL_S * 1000000LL));
+        sample_heap(NULL);
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef HEAP_STATS_H
+#define HEAP_STATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Seconds between two samples of the free heap, and the number of samples kept
+#define HEAP_SAMPLE_INTERVAL_S 10
+#define HEAP_SAMPLE_COUNT 60
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Every tag maps to a name in heap_stats.cpp, keep both in the same order
+    typedef enum heap_tag
+    {
+        HEAP_TAG_BLE,
+        HEAP_TAG_HTTP,
+        HEAP_TAG_JSON,
+        HEAP_TAG_SETTINGS,
+        HEAP_TAG_UPLOAD,
+        HEAP_TAG_COUNT
+    } heap_tag_t;
+
+    typedef struct heap_tag_stats
+    {
+        int32_t current_bytes;
+        int32_t peak_bytes;
+        uint32_t allocs;
+        uint32_t failures;
+    } heap_tag_stats_t;
+
+    typedef struct heap_sample
+    {
+        uint32_t uptime_s;
+        uint32_t free_bytes;
+        uint32_t largest_free_block;
+        // 1 - largest_free_block / free_bytes in per mille, 0 means not fragmented at all
+        uint16_t fragmentation;
+    } heap_sample_t;
+
+    // Starts sampling the heap
+    void heap_stats_init();
+
+    // Allocations through these are counted for their tag. The size and tag are kept
+    // in front of the block, so heap_stats_free() has to be used to release them.
+    void *heap_stats_malloc(heap_tag_t tag, size_t size);
+    void *heap_stats_calloc(heap_tag_t tag, size_t count, size_t size);
+    void heap_stats_free(void *ptr);
+    // Accounts memory allocated by code that can't use the functions above,
+    // for example the heap a library took during its initialisation
+    void heap_stats_add(heap_tag_t tag, int32_t bytes);
+
+    void heap_stats_get(heap_tag_t tag, heap_tag_stats_t *stats);
+    const char *heap_tag_name(heap_tag_t tag);
+    heap_sample_t heap_stats_sample_now();
+    // Copies the samples oldest first, returns the number copied
+    size_t heap_stats_history(heap_sample_t *samples, size_t max_samples);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
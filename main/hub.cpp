@@ -0,0 +1,386 @@
+#include "hub.h"
+
+#include <string.h>
+#include <math.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+#include "mdns.h"
+
+#include "sample_multicast.h"
+#include "TaskRegistry.h"
+#include "task_plan.h"
+
+static const char *TAG = "hub";
+
+#if defined(HUB_MODE) && !defined(SAMPLE_MULTICAST)
+#error "HUB_MODE merges the datagrams of SAMPLE_MULTICAST, enable it in sample_multicast.h"
+#endif
+
+#ifdef HUB_MODE
+#define RECEIVE_TIMEOUT_MS 1000
+#define DISCOVERY_TIMEOUT_MS 2000
+#define DISCOVERY_MAX_RESULTS 16
+// A datagram sent this much earlier than the newest one is from before a reboot of the gateway
+#define REORDER_WINDOW_MS 10000
+
+typedef struct hub_entry
+{
+    bool used;
+    hub_source_t source;
+    uint32_t next_sequence;
+    uint32_t last_uptime_ms;
+    int64_t last_seen_us;
+    // Smallest difference between our clock and the uptime of the gateway, the transfer time
+    // of the fastest datagram. Everything above it is lag.
+    int64_t min_offset_ms;
+    size_t history_head;
+} hub_entry_t;
+
+static TaskHandle_t task = NULL;
+static TaskHandle_t discovery_task = NULL;
+static SemaphoreHandle_t lock = NULL;
+static ibbq_state_t *bbq_state = NULL;
+static uint8_t own_device_id[6];
+// The first entry is this gateway
+static hub_entry_t entries[HUB_MAX_SOURCES] = {};
+// Set when a gateway shows up, its name is looked up right away instead of with the next discovery.
+// Only the hub task uses it.
+static bool new_source = false;
+
+static hub_entry_t *find_entry(const uint8_t *device_id)
+{
+    hub_entry_t *free_entry = NULL;
+    hub_entry_t *stalest = NULL;
+    for (size_t i = 1; i < HUB_MAX_SOURCES; i++)
+    {
+        hub_entry_t *entry = &entries[i];
+        if (!entry->used)
+        {
+            free_entry = free_entry != NULL ? free_entry : entry;
+            continue;
+        }
+        if (memcmp(entry->source.device_id, device_id, sizeof(entry->source.device_id)) == 0)
+        {
+            return entry;
+        }
+        if (stalest == NULL || entry->last_seen_us < stalest->last_seen_us)
+        {
+            stalest = entry;
+        }
+    }
+
+    hub_entry_t *entry = free_entry;
+    if (entry == NULL && esp_timer_get_time() - stalest->last_seen_us > HUB_STALE_MS * 1000LL)
+    {
+        ESP_LOGI(TAG, "Replacing stale source %s", stalest->source.host);
+        entry = stalest;
+    }
+    if (entry == NULL)
+    {
+        return NULL;
+    }
+    memset(entry, 0, sizeof(*entry));
+    entry->used = true;
+    new_source = true;
+    memcpy(entry->source.device_id, device_id, sizeof(entry->source.device_id));
+    return entry;
+}
+
+// Loss and reorder accounting, in the same way as tools/sample_receiver.py
+static void count_sequence(hub_entry_t *entry, uint32_t sequence, uint32_t uptime_ms)
+{
+    hub_source_t *source = &entry->source;
+    if (source->received > 0 && sequence < entry->next_sequence && uptime_ms + REORDER_WINDOW_MS < entry->last_uptime_ms)
+    {
+        ESP_LOGI(TAG, "Gateway %s restarted", source->host);
+        source->received = 0;
+        entry->min_offset_ms = 0;
+    }
+
+    if (source->received == 0 || sequence == entry->next_sequence)
+    {
+        entry->next_sequence = sequence + 1;
+    }
+    else if (sequence > entry->next_sequence)
+    {
+        source->lost += sequence - entry->next_sequence;
+        entry->next_sequence = sequence + 1;
+    }
+    else
+    {
+        // Late, it was counted as lost when the gap was noticed
+        source->reordered++;
+        if (source->lost > 0)
+        {
+            source->lost--;
+        }
+    }
+    source->received++;
+    if (uptime_ms > entry->last_uptime_ms || source->received == 1)
+    {
+        entry->last_uptime_ms = uptime_ms;
+    }
+}
+
+static void handle_datagram(const uint8_t *data, size_t len, uint32_t ip)
+{
+    sample_frame_t frame;
+    if (!sample_datagram_decode(data, len, &frame))
+    {
+        return;
+    }
+    // Our own datagrams, if the network loops them back, are already the local source
+    if (memcmp(frame.device_id, own_device_id, sizeof(own_device_id)) == 0)
+    {
+        return;
+    }
+
+    int64_t now_us = esp_timer_get_time();
+    uint32_t uptime_ms = frame.uptime_ms;
+    xSemaphoreTake(lock, portMAX_DELAY);
+    hub_entry_t *entry = find_entry(frame.device_id);
+    if (entry == NULL)
+    {
+        xSemaphoreGive(lock);
+        ESP_LOGW(TAG, "Ignoring gateway, all %d sources are in use", HUB_MAX_SOURCES);
+        return;
+    }
+    count_sequence(entry, frame.sequence, uptime_ms);
+
+    hub_source_t *source = &entry->source;
+    source->ip = ip;
+    source->probe_count = frame.probe_count;
+    source->battery_percent = frame.battery_percent;
+    memcpy(source->deci_degrees, frame.deci_degrees, frame.probe_count * sizeof(int16_t));
+    entry->last_seen_us = now_us;
+
+    int64_t offset_ms = now_us / 1000 - uptime_ms;
+    if (source->received == 1 || offset_ms < entry->min_offset_ms)
+    {
+        entry->min_offset_ms = offset_ms;
+    }
+    source->lag_ms = offset_ms - entry->min_offset_ms;
+    if (source->lag_ms > source->max_lag_ms)
+    {
+        source->max_lag_ms = source->lag_ms;
+    }
+    xSemaphoreGive(lock);
+}
+
+static void update_local()
+{
+    hub_entry_t *entry = &entries[0];
+    xSemaphoreTake(lock, portMAX_DELAY);
+    entry->used = true;
+    entry->source.local = true;
+    memcpy(entry->source.device_id, own_device_id, sizeof(own_device_id));
+    if (bbq_state->connected)
+    {
+        size_t probe_count = bbq_state->probe_count < MAX_PROBE_COUNT ? bbq_state->probe_count : MAX_PROBE_COUNT;
+        entry->source.probe_count = probe_count;
+        entry->source.battery_percent = bbq_state->battery_percent;
+        for (size_t i = 0; i < probe_count; i++)
+        {
+            float temp = bbq_state->probes.temps[i];
+            entry->source.deci_degrees[i] = temp > MAX_VALID_TEMP ? SAMPLE_NO_VALUE : (int16_t)lroundf(temp * 10);
+        }
+        entry->last_seen_us = bbq_state->probes.updated_us;
+    }
+    xSemaphoreGive(lock);
+}
+
+static void record_history()
+{
+    xSemaphoreTake(lock, portMAX_DELAY);
+    for (size_t i = 0; i < HUB_MAX_SOURCES; i++)
+    {
+        hub_entry_t *entry = &entries[i];
+        if (!entry->used)
+        {
+            continue;
+        }
+        int16_t *row = entry->source.history[entry->history_head];
+        bool stale = esp_timer_get_time() - entry->last_seen_us > HUB_STALE_MS * 1000LL;
+        for (size_t j = 0; j < MAX_PROBE_COUNT; j++)
+        {
+            row[j] = !stale && j < entry->source.probe_count ? entry->source.deci_degrees[j] : SAMPLE_NO_VALUE;
+        }
+        entry->history_head = (entry->history_head + 1) % HUB_HISTORY_SIZE;
+        if (entry->source.history_count < HUB_HISTORY_SIZE)
+        {
+            entry->source.history_count++;
+        }
+    }
+    xSemaphoreGive(lock);
+}
+
+// Names the sources after the gateways that announce the same device id via mDNS. The query waits
+// up to DISCOVERY_TIMEOUT_MS for answers, so it runs in a task of its own.
+static void discover_peers()
+{
+    mdns_result_t *results = NULL;
+    esp_err_t err = mdns_query_ptr("_http", "_tcp", DISCOVERY_TIMEOUT_MS, DISCOVERY_MAX_RESULTS, &results);
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "mDNS query failed: %s", esp_err_to_name(err));
+        return;
+    }
+
+    size_t found = 0;
+    for (mdns_result_t *result = results; result != NULL; result = result->next)
+    {
+        const char *device = NULL;
+        for (size_t i = 0; i < result->txt_count; i++)
+        {
+            if (strcmp(result->txt[i].key, "device") == 0)
+            {
+                device = result->txt[i].value;
+            }
+        }
+        uint8_t device_id[6];
+        if (device == NULL || result->hostname == NULL ||
+            sscanf(device, "%2hhx%2hhx%2hhx%2hhx%2hhx%2hhx", &device_id[0], &device_id[1], &device_id[2],
+                   &device_id[3], &device_id[4], &device_id[5]) != 6)
+        {
+            // Some other web server
+            continue;
+        }
+        found++;
+        xSemaphoreTake(lock, portMAX_DELAY);
+        for (size_t i = 0; i < HUB_MAX_SOURCES; i++)
+        {
+            hub_source_t *source = &entries[i].source;
+            if (entries[i].used && memcmp(source->device_id, device_id, sizeof(device_id)) == 0)
+            {
+                strncpy(source->host, result->hostname, sizeof(source->host));
+                source->host[sizeof(source->host) - 1] = '\0';
+            }
+        }
+        xSemaphoreGive(lock);
+    }
+    mdns_query_results_free(results);
+    ESP_LOGD(TAG, "Discovered %d gateways", found);
+}
+
+static void hub_discovery_task(void *arg)
+{
+    while (true)
+    {
+        discover_peers();
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(HUB_DISCOVERY_INTERVAL_MS));
+    }
+}
+
+static void hub_task(void *arg)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0)
+    {
+        ESP_LOGE(TAG, "Failed to create socket: errno %d", errno);
+        vTaskDelete(NULL);
+        return;
+    }
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(SAMPLE_MULTICAST_PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    struct ip_mreq membership = {};
+    inet_aton(SAMPLE_MULTICAST_GROUP, &membership.imr_multiaddr);
+    membership.imr_interface.s_addr = htonl(INADDR_ANY);
+    struct timeval timeout = {};
+    timeout.tv_sec = RECEIVE_TIMEOUT_MS / 1000;
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) < 0 ||
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0)
+    {
+        ESP_LOGE(TAG, "Failed to join %s:%d: errno %d", SAMPLE_MULTICAST_GROUP, SAMPLE_MULTICAST_PORT, errno);
+        close(sock);
+        vTaskDelete(NULL);
+        return;
+    }
+    ESP_LOGI(TAG, "Listening for gateways on %s:%d", SAMPLE_MULTICAST_GROUP, SAMPLE_MULTICAST_PORT);
+
+    int64_t next_history_us = esp_timer_get_time();
+    uint8_t data[sizeof(sample_datagram_t)];
+    while (true)
+    {
+        struct sockaddr_in sender = {};
+        socklen_t sender_len = sizeof(sender);
+        int len = recvfrom(sock, data, sizeof(data), 0, (struct sockaddr *)&sender, &sender_len);
+        if (len > 0)
+        {
+            handle_datagram(data, len, sender.sin_addr.s_addr);
+        }
+
+        int64_t now_us = esp_timer_get_time();
+        update_local();
+        if (now_us >= next_history_us)
+        {
+            record_history();
+            next_history_us += HUB_HISTORY_INTERVAL_MS * 1000LL;
+        }
+        if (new_source)
+        {
+            new_source = false;
+            xTaskNotifyGive(discovery_task);
+        }
+    }
+}
+#endif
+
+void hub_start(ibbq_state_t *state)
+{
+#ifdef HUB_MODE
+    if (task != NULL)
+    {
+        return;
+    }
+    bbq_state = state;
+    esp_read_mac(own_device_id, ESP_MAC_WIFI_STA);
+    lock = xSemaphoreCreateMutex();
+    TaskRegistry::add("hub_discovery", HUB_DISCOVERY_STACK_SIZE);
+    xTaskCreatePinnedToCore(&hub_discovery_task, "hub_discovery", HUB_DISCOVERY_STACK_SIZE, NULL,
+                            TASK_PRIO_HUB_DISCOVERY, &discovery_task, TASK_CORE_NET);
+    TaskRegistry::add("hub", HUB_STACK_SIZE);
+    xTaskCreatePinnedToCore(&hub_task, "hub", HUB_STACK_SIZE, NULL, TASK_PRIO_HUB, &task, TASK_CORE_NET);
+#else
+    ESP_LOGD(TAG, "Hub mode disabled");
+#endif
+}
+
+bool hub_get_source(size_t index, hub_source_t *source)
+{
+#ifdef HUB_MODE
+    if (lock == NULL)
+    {
+        return false;
+    }
+    // Sources may be replaced between two calls, so the used ones are counted on every call
+    xSemaphoreTake(lock, portMAX_DELAY);
+    for (size_t i = 0; i < HUB_MAX_SOURCES; i++)
+    {
+        hub_entry_t *entry = &entries[i];
+        if (!entry->used || index-- > 0)
+        {
+            continue;
+        }
+        *source = entry->source;
+        source->age_ms = (esp_timer_get_time() - entry->last_seen_us) / 1000;
+        // Rotate the ring, so the copy is oldest first
+        size_t start = (entry->history_head + HUB_HISTORY_SIZE - entry->source.history_count) % HUB_HISTORY_SIZE;
+        for (size_t j = 0; j < entry->source.history_count; j++)
+        {
+            memcpy(source->history[j], entry->source.history[(start + j) % HUB_HISTORY_SIZE], sizeof(source->history[j]));
+        }
+        xSemaphoreGive(lock);
+        return true;
+    }
+    xSemaphoreGive(lock);
+#endif
+    return false;
+}
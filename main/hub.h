@@ -0,0 +1,60 @@
+#ifndef HUB_H
+#define HUB_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "ibbq.h"
+
+// Merge the probes of every gateway on the network into GET /hub. The other gateways
+// need SAMPLE_MULTICAST, the hub listens to their datagrams and finds their names via mDNS.
+//#define HUB_MODE
+
+#define HUB_MAX_SOURCES 8
+#define HUB_HISTORY_SIZE 60
+#define HUB_HISTORY_INTERVAL_MS 10000
+#define HUB_DISCOVERY_INTERVAL_MS 60000
+// Sources that sent nothing for this long are shown as stale and are replaced first
+#define HUB_STALE_MS 30000
+#define HUB_STACK_SIZE 4096
+#define HUB_DISCOVERY_STACK_SIZE 3072
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef struct hub_source
+    {
+        uint8_t device_id[6];
+        bool local;
+        // mDNS host name, empty until the gateway was discovered
+        char host[32];
+        // Sender of the last datagram, network byte order
+        uint32_t ip;
+        uint8_t probe_count;
+        uint8_t battery_percent;
+        int16_t deci_degrees[MAX_PROBE_COUNT];
+        uint32_t received;
+        uint32_t lost;
+        uint32_t reordered;
+        uint32_t age_ms;
+        // Delay of the last datagram beyond the fastest one seen from the same gateway
+        uint32_t lag_ms;
+        uint32_t max_lag_ms;
+        // Oldest first, one row every HUB_HISTORY_INTERVAL_MS
+        uint16_t history_count;
+        int16_t history[HUB_HISTORY_SIZE][MAX_PROBE_COUNT];
+    } hub_source_t;
+
+    // Starts listening for other gateways, later calls do nothing. The probes of this
+    // gateway are always the first source.
+    void hub_start(ibbq_state_t *state);
+    // Copies a source, returns false once index is past the last one
+    bool hub_get_source(size_t index, hub_source_t *source);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
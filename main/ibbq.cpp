@@ -4,15 +4,26 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include <map>
+#include <string.h>
 
 #include "esp_log.h"
 #include "ibbq_events.h"
-#include "esp_event_base.h"
 #include "esp_timer.h"
+#include "Channel.h"
+#include "boot.h"
+#include "event_log.h"
+#include "TaskRegistry.h"
+#include "heap_stats.h"
+#include "sample_multicast.h"
+#include "ble_capture.h"
+#include "ibbq_notify.h"
+#include "radio_coex.h"
+#include "jitter_stats.h"
+#include "task_plan.h"
 
-#define MAX_VOLTAGE 6550
 #define BATTERY_INTERVAL 30000000
 #define BLE_CONNECT_TIMEOUT 10000000
+#define BLE_TASK_STACK_SIZE 4096
 
 static const char *TAG = "iBBQ-BLE";
 
@@ -31,17 +42,69 @@ static uint8_t enableRealTimeData[] = {0x0B, 0x01, 0x00, 0x00, 0x00, 0x00};
 static uint8_t unitCelsius[] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x00};
 static uint8_t batteryLevel[] = {0x08, 0x24, 0x00, 0x00, 0x00, 0x00};
 
-ESP_EVENT_DEFINE_BASE(IBBQ_EVENTS)
+static probe_config_t probe_config = {};
+static ibbq_state_t ctx = {&probe_config};
 
-esp_event_loop_handle_t ble_loop;
+// Posted from the BLE callbacks, the timers and the handlers themselves, handled by ble_task
+static MpscChannel<ibbq_event_t, IBBQ_EVENT_QUEUE_SIZE> events;
+static ibbq_event_stats_t event_stats = {};
+static portMUX_TYPE event_stats_mux = portMUX_INITIALIZER_UNLOCKED;
 
-static ibbq_state_t ctx = {};
+static const char *event_names[] = {
+    "start_scan",
+    "discovered",
+    "connected",
+    "authenticated",
+    "request_state"};
+
+static_assert(sizeof(event_names) / sizeof(event_names[0]) == IBBQ_EVENT_COUNT, "Every iBBQ event needs a name");
+static_assert(sizeof(ibbq_event_t) <= 24, "iBBQ events are copied into the queue, keep them small");
 
 static void battery_timer_callback(void *arg);
 static void connect_timeout_timer_callback(void *arg);
 static esp_timer_handle_t ble_timeout_timer;
 static esp_timer_handle_t battery_timer;
 
+// Never blocks, so timers and BLE callbacks can post. A full queue drops the event.
+static bool post_event(ibbq_event_t event)
+{
+    event.posted_us = esp_timer_get_time();
+    bool sent = ibbq_event_admit(event.type, events.size()) && events.trySend(event);
+    size_t queued = events.size();
+    portENTER_CRITICAL(&event_stats_mux);
+    if (sent)
+    {
+        event_stats.posted[event.type]++;
+    }
+    else
+    {
+        event_stats.dropped[event.type]++;
+    }
+    if (queued > event_stats.max_queued)
+    {
+        event_stats.max_queued = queued;
+    }
+    portEXIT_CRITICAL(&event_stats_mux);
+    if (!sent)
+    {
+        ESP_LOGE(TAG, "BLE event queue full, dropped %s", ibbq_event_name((ibbq_event_type_t)event.type));
+        if (event.type != IBBQ_REQUEST_STATE)
+        {
+            // Nothing else would move the state machine on, the connect timeout restarts BLE and scans again.
+            // Fails harmlessly if the timeout is already running.
+            esp_timer_start_once(ble_timeout_timer, BLE_CONNECT_TIMEOUT);
+        }
+    }
+    return sent;
+}
+
+static bool post_event(ibbq_event_type_t type)
+{
+    ibbq_event_t event = {};
+    event.type = type;
+    return post_event(event);
+}
+
 static esp_timer_create_args_t ble_timeout_timer_args = {
     .callback = &connect_timeout_timer_callback,
     .arg = (void *)&ctx,
@@ -65,8 +128,10 @@ class MyBLECLientCallbacks : public BLEClientCallbacks
     void onDisconnect(BLEClient *pClient)
     {
         //pClient->disconnect();
+        ble_capture_record(BLE_CAPTURE_DISCONNECTED, 0, NULL, 0);
+        radio_coex_ble_connecting(false);
         esp_timer_stop(battery_timer);
-        ESP_ERROR_CHECK(esp_event_post_to(ble_loop, IBBQ_EVENTS, IBBQ_START_SCAN, NULL, 0, portMAX_DELAY));
+        post_event(IBBQ_START_SCAN);
     }
 };
 
@@ -88,12 +153,14 @@ static void init_ble(ibbq_state_t *ctx)
 
 static void battery_timer_callback(void *arg)
 {
-    ESP_ERROR_CHECK(esp_event_post_to(ble_loop, IBBQ_EVENTS, IBBQ_REQUEST_STATE, NULL, 0, portMAX_DELAY));
+    post_event(IBBQ_REQUEST_STATE);
 }
 
 static void connect_timeout_timer_callback(void *arg)
 {
     ESP_LOGW(TAG, "BLE connection timed out, restarting BLE");
+    ble_capture_record(BLE_CAPTURE_TIMEOUT, 0, NULL, 0);
+    radio_coex_ble_connecting(false);
     ibbq_state_t *ctx = (ibbq_state_t *)arg;
     ctx->pClient->setClientCallbacks(NULL);
     ESP_LOGI(TAG, "Forcing disconnect");
@@ -102,7 +169,7 @@ static void connect_timeout_timer_callback(void *arg)
     ESP_LOGI(TAG, "BLE deinit for full restart");
     BLEDevice::deinit(true);
     init_ble(ctx);
-    ESP_ERROR_CHECK(esp_event_post_to(ble_loop, IBBQ_EVENTS, IBBQ_START_SCAN, ctx, sizeof(ibbq_state_t), portMAX_DELAY));
+    post_event(IBBQ_START_SCAN);
 }
 
 static void start_battery_timer(ibbq_state_t *ctx)
@@ -110,11 +177,40 @@ static void start_battery_timer(ibbq_state_t *ctx)
     ESP_ERROR_CHECK(esp_timer_start_once(battery_timer, BATTERY_INTERVAL));
 }
 
-uint16_t littleEndianInt(uint8_t *pData)
+static uint16_t shortUUID(BLEUUID uuid)
 {
-    uint16_t val = pData[1] << 8;
-    val = val | pData[0];
-    return val;
+    esp_bt_uuid_t *native = uuid.getNative();
+    if (native->len == ESP_UUID_LEN_16)
+    {
+        return native->uuid.uuid16;
+    }
+    if (native->len == ESP_UUID_LEN_128)
+    {
+        // Little endian, the short UUID of the Bluetooth base UUID sits in bytes 12 and 13
+        return native->uuid.uuid128[12] | (native->uuid.uuid128[13] << 8);
+    }
+    return 0;
+}
+
+// Shared by the notifications and the replay of captures
+static void handle_temperatures(const uint16_t *raw_values, size_t count, int64_t received_us)
+{
+    radio_coex_notification();
+    ibbq_update_probes(&ctx, raw_values, count, received_us);
+    ctx.probe_count = count;
+    for (size_t i = 0; i < count; i++)
+    {
+        event_log(EVT_PROBE_TEMP, i, ctx.probes.temps[i]);
+    }
+    sample_multicast_publish(raw_values, count, ctx.battery_percent);
+    jitter_notification(received_us);
+    boot_phase_done(BOOT_PHASE_FIRST_TEMP, ESP_OK);
+}
+
+static void handle_battery(float battery_percent)
+{
+    ctx.battery_percent = battery_percent;
+    event_log(EVT_BATTERY_LEVEL, ctx.battery_percent);
 }
 
 static void realtimeDataCallback(
@@ -123,17 +219,11 @@ static void realtimeDataCallback(
     size_t length,
     bool isNotify)
 {
-    ctx.probe_count = length / 2;
-
-    uint8_t probeId = 0;
-    for (int i = 0; i < length; i += 2)
-    {
-        uint16_t val = littleEndianInt(&pData[i]);
-        float temp = val / 10;
-        ESP_LOGI(TAG, "Probe %d has value %f", probeId, temp);
-        ctx.temps[i] = temp;
-        probeId++;
-    }
+    int64_t received_us = esp_timer_get_time();
+    ble_capture_record(BLE_CAPTURE_NOTIFY, IBBQ_UUID_REALTIME_DATA, pData, length);
+    uint16_t raw_values[MAX_PROBE_COUNT];
+    size_t count = ibbq_parse_realtime(pData, length, raw_values);
+    handle_temperatures(raw_values, count, received_us);
 }
 
 static void settingsResultCallback(
@@ -142,20 +232,14 @@ static void settingsResultCallback(
     size_t length,
     bool isNotify)
 {
-    if (length < 5)
+    ble_capture_record(BLE_CAPTURE_NOTIFY, IBBQ_UUID_SETTINGS_RESULT, pData, length);
+    float battery_percent;
+    if (!ibbq_parse_battery(pData, length, &battery_percent))
     {
         ESP_LOGE(TAG, "Length of received settings is too short");
         return;
     }
-    uint16_t voltage = littleEndianInt(&pData[1]);
-    uint16_t maxVoltage = littleEndianInt(&pData[3]);
-
-    if (maxVoltage == 0)
-    {
-        maxVoltage = MAX_VOLTAGE;
-    }
-    ctx.battery_percent = (100 * voltage) / maxVoltage;
-    ESP_LOGI(TAG, "Current battery level %f %%", ctx.battery_percent);
+    handle_battery(battery_percent);
 }
 
 bool readSettings(BLEClient *pClient)
@@ -176,6 +260,7 @@ bool readSettings(BLEClient *pClient)
 
     // TODO probably return value???
     std::string value = pRemoteCharacteristic->readValue();
+    ble_capture_record(BLE_CAPTURE_READ, IBBQ_UUID_SETTINGS, (const uint8_t *)value.data(), value.length());
     return true;
 }
 
@@ -202,6 +287,7 @@ bool writeSetting(BLEClient *pClient, uint8_t *data, size_t length)
         return false;
     }
 
+    ble_capture_record(BLE_CAPTURE_WRITE, IBBQ_UUID_SETTINGS, data, length);
     pRemoteCharacteristic->writeValue(data, length, false);
     return true;
 }
@@ -235,10 +321,12 @@ bool subscribeToCharacteristic(BLEClient *pClient, BLEUUID uuid, void (*notifyCa
     }
 
     std::string value = pRemoteCharacteristic->readValue();
+    ble_capture_record(BLE_CAPTURE_READ, shortUUID(uuid), (const uint8_t *)value.data(), value.length());
     pRemoteCharacteristic->registerForNotify(notifyCallback);
 
     // const uint8_t bothOn[]         = {0x3, 0x0};
     const uint8_t notificationOn[] = {0x1, 0x0};
+    ble_capture_record(BLE_CAPTURE_WRITE, IBBQ_UUID_CLIENT_CONFIG, notificationOn, sizeof(notificationOn));
     pRemoteCharacteristic->getDescriptor(BLEUUID((uint16_t)0x2902))->writeValue((uint8_t *)notificationOn, 2, true);
 
     return true;
@@ -246,44 +334,56 @@ bool subscribeToCharacteristic(BLEClient *pClient, BLEUUID uuid, void (*notifyCa
 
 void ble_scan_finished(BLEScanResults results)
 {
-    ESP_LOGI(TAG, "Discovered %d BLE devices", results.getCount());
+    event_log(EVT_BLE_SCAN_FINISHED, results.getCount());
     for (uint32_t i = 0; i < results.getCount(); i++)
     {
         BLEAdvertisedDevice dev = results.getDevice(i);
-        ESP_LOGI(TAG, "Discovered device %s", dev.toString().c_str());
+        uint8_t *mac = *dev.getAddress().getNative();
+        event_log(EVT_BLE_DEVICE, (mac[0] << 16) | (mac[1] << 8) | mac[2], (mac[3] << 16) | (mac[4] << 8) | mac[5], dev.getRSSI());
         if (dev.getName() == "iBBQ" || dev.isAdvertisingService(serviceUUID))
         {
             //dev.getScan()->stop();
             ESP_LOGI(TAG, "Found iBBQ device (%s)", dev.getAddress().toString().c_str());
             ESP_LOGI(TAG, "Remote service UUID is %s", dev.getServiceUUID().toString().c_str());
-            ESP_ERROR_CHECK(esp_event_post_to(ble_loop, IBBQ_EVENTS, IBBQ_DISCOVERED, &dev, sizeof(dev), portMAX_DELAY));
+            uint8_t discovered[7] = {mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], (uint8_t)dev.getRSSI()};
+            ble_capture_record(BLE_CAPTURE_DISCOVERED, 0, discovered, sizeof(discovered));
+            // Only the address goes into the event, the scan results are cleared before the next scan
+            ibbq_event_t event = {};
+            event.type = IBBQ_DISCOVERED;
+            memcpy(event.data.discovered.address, mac, sizeof(event.data.discovered.address));
+            event.data.discovered.address_type = dev.getAddressType();
+            event.data.discovered.rssi = dev.getRSSI();
+            post_event(event);
             return;
         }
     }
     ESP_LOGI(TAG, "No iBBQ device found, posting scan event again");
-    ESP_ERROR_CHECK(esp_event_post_to(ble_loop, IBBQ_EVENTS, IBBQ_START_SCAN, NULL, 0, portMAX_DELAY));
+    post_event(IBBQ_START_SCAN);
 }
 
-static void device_discovered(void *handler_args, esp_event_base_t base, int32_t id, void *event_dat)
+static void device_discovered(ibbq_state_t *ctx, const ibbq_event_t *event)
 {
-    ibbq_state_t *ctx = (ibbq_state_t *)handler_args;
-    BLEAdvertisedDevice *dev = (BLEAdvertisedDevice *)event_dat;
-
-    //ESP_LOGI(TAG, "Discovered device: %s", dev->toString().c_str());
+    esp_bd_addr_t mac;
+    memcpy(mac, event->data.discovered.address, sizeof(mac));
+    BLEAddress address(mac);
 
     ESP_LOGI(TAG, "Connecting to device address (%s), starting timeout timer for %d seconds",
-             dev->getAddress().toString().c_str(), (BLE_CONNECT_TIMEOUT / 1000000));
+             address.toString().c_str(), (BLE_CONNECT_TIMEOUT / 1000000));
+    // Still running if a dropped event armed it, starting it again would fail
+    esp_timer_stop(ble_timeout_timer);
     ESP_ERROR_CHECK(esp_timer_start_once(ble_timeout_timer, BLE_CONNECT_TIMEOUT));
-    if (!ctx->pClient->connect(dev->getAddress()))
+    radio_coex_ble_connecting(true);
+    uint8_t connected = ctx->pClient->connect(address, (esp_ble_addr_type_t)event->data.discovered.address_type);
+    ble_capture_record(BLE_CAPTURE_CONNECT, 0, &connected, sizeof(connected));
+    if (!connected)
     {
-        ESP_LOGE(TAG, "Failed to connect to device %s", dev->getAddress().toString().c_str());
+        ESP_LOGE(TAG, "Failed to connect to device %s", address.toString().c_str());
     }
-    ESP_ERROR_CHECK(esp_event_post_to(ble_loop, IBBQ_EVENTS, IBBQ_CONNECTED, NULL, 0, portMAX_DELAY));
+    post_event(IBBQ_CONNECTED);
 }
 
-static void device_connected(void *handler_args, esp_event_base_t base, int32_t id, void *event_dat)
+static void device_connected(ibbq_state_t *ctx, const ibbq_event_t *event)
 {
-    ibbq_state_t *ctx = (ibbq_state_t *)handler_args;
     if (!ctx->pClient->isConnected())
     {
         ESP_LOGE(TAG, "Connection doesn't seem to be established");
@@ -331,14 +431,14 @@ static void device_connected(void *handler_args, esp_event_base_t base, int32_t
         return;
     }
     ESP_LOGI(TAG, "Found our characteristic, writing credentials");
+    ble_capture_record(BLE_CAPTURE_WRITE, IBBQ_UUID_ACCOUNT_VERIFY, credentials, sizeof(credentials));
     pRemoteCharacteristic->writeValue(credentials, sizeof(credentials), false);
     ESP_LOGI(TAG, "Authentication with iBBQ was successfull");
-    ESP_ERROR_CHECK(esp_event_post_to(ble_loop, IBBQ_EVENTS, IBBQ_AUTHENTICATED, NULL, 0, portMAX_DELAY));
+    post_event(IBBQ_AUTHENTICATED);
 }
 
-static void device_authenticated(void *handler_args, esp_event_base_t base, int32_t id, void *event_dat)
+static void device_authenticated(ibbq_state_t *ctx, const ibbq_event_t *event)
 {
-    ibbq_state_t *ctx = (ibbq_state_t *)handler_args;
 
     ESP_LOGI(TAG, "Setting units to Celsius");
     if (!writeSetting(ctx->pClient, unitCelsius, sizeof(unitCelsius)))
@@ -369,14 +469,17 @@ static void device_authenticated(void *handler_args, esp_event_base_t base, int3
         return;
     }
     ctx->connected = true;
-    ESP_ERROR_CHECK(esp_event_post_to(ble_loop, IBBQ_EVENTS, IBBQ_REQUEST_STATE, ctx, sizeof(*ctx), portMAX_DELAY));
+    ble_capture_record(BLE_CAPTURE_READY, 0, NULL, 0);
+    radio_coex_ble_connecting(false);
+    boot_phase_done(BOOT_PHASE_IBBQ_CONNECTED, ESP_OK);
+    post_event(IBBQ_REQUEST_STATE);
 }
 
-static void request_device_state(void *handler_args, esp_event_base_t base, int32_t id, void *event_data)
+static void request_device_state(ibbq_state_t *ctx, const ibbq_event_t *event)
 {
     ESP_LOGI(TAG, "Free heap after during BLE operation: %d", esp_get_free_heap_size());
-    ibbq_state_t *ctx = (ibbq_state_t *)handler_args;
     ctx->rssi = ctx->pClient->getRssi();
+    ble_capture_record(BLE_CAPTURE_RSSI, 0, &ctx->rssi, sizeof(ctx->rssi));
     if (!writeSetting(ctx->pClient, batteryLevel, sizeof(batteryLevel)))
     {
         ESP_LOGE(TAG, "Failed to request device status like battery");
@@ -387,9 +490,8 @@ static void request_device_state(void *handler_args, esp_event_base_t base, int3
     start_battery_timer(ctx);
 }
 
-static void start_discovery_handler(void *handler_args, esp_event_base_t base, int32_t id, void *event_data)
+static void start_discovery_handler(ibbq_state_t *state, const ibbq_event_t *event)
 {
-    ibbq_state_t *state = (ibbq_state_t *)handler_args;
     state->connected = false;
     state->probe_count = 0;
     //state->pBLEScan->setAdvertisedDeviceCallbacks(scanCallback);
@@ -398,31 +500,114 @@ static void start_discovery_handler(void *handler_args, esp_event_base_t base, i
     ESP_LOGI(TAG, "Starting discovery of iBBQ devices");
 }
 
+typedef void (*ibbq_event_handler_t)(ibbq_state_t *ctx, const ibbq_event_t *event);
+
+// Indexed by the event type, so dispatching is a single lookup
+static const ibbq_event_handler_t event_handlers[] = {
+    start_discovery_handler,
+    device_discovered,
+    device_connected,
+    device_authenticated,
+    request_device_state};
+
+static_assert(sizeof(event_handlers) / sizeof(event_handlers[0]) == IBBQ_EVENT_COUNT, "Every iBBQ event needs a handler");
+
+static void ble_task(void *arg)
+{
+    ibbq_state_t *state = (ibbq_state_t *)arg;
+    ibbq_event_t event;
+    while (true)
+    {
+        if (!events.receive(event))
+        {
+            continue;
+        }
+        jitter_record(JITTER_BLE_QUEUE, esp_timer_get_time() - event.posted_us);
+        if (event.type < IBBQ_EVENT_COUNT)
+        {
+            event_handlers[event.type](state, &event);
+        }
+        portENTER_CRITICAL(&event_stats_mux);
+        event_stats.handled++;
+        portEXIT_CRITICAL(&event_stats_mux);
+    }
+}
+
+#ifdef BLE_REPLAY
+static capture_replay_state_t replay_state = {};
+
+// Records of an uploaded capture take the same paths as the events of a real thermometer
+static void replay_record(const ble_capture_record_t *record, const uint8_t *data)
+{
+    switch (capture_replay_apply(&replay_state, record, data))
+    {
+    case CAPTURE_REPLAY_CONNECTED:
+        ctx.connected = true;
+        boot_phase_done(BOOT_PHASE_IBBQ_CONNECTED, ESP_OK);
+        break;
+    case CAPTURE_REPLAY_DISCONNECTED:
+        ctx.connected = false;
+        ctx.probe_count = 0;
+        break;
+    case CAPTURE_REPLAY_TEMPS:
+        ble_capture_record(BLE_CAPTURE_NOTIFY, IBBQ_UUID_REALTIME_DATA, data, record->length);
+        handle_temperatures(replay_state.raw_values, replay_state.probe_count, esp_timer_get_time());
+        break;
+    case CAPTURE_REPLAY_BATTERY:
+        ble_capture_record(BLE_CAPTURE_NOTIFY, IBBQ_UUID_SETTINGS_RESULT, data, record->length);
+        handle_battery(replay_state.battery_percent);
+        break;
+    case CAPTURE_REPLAY_RSSI:
+        ctx.rssi = replay_state.rssi;
+        break;
+    case CAPTURE_REPLAY_NONE:
+        break;
+    }
+}
+#endif
+
 ibbq_state_t *init_ibbq()
 {
+#ifdef BLE_REPLAY
+    ESP_LOGI(TAG, "BLE replay enabled, POST a capture to /capture instead of connecting to a thermometer");
+    ble_capture_init(replay_record);
+    return &ctx;
+#else
     esp_bt_controller_mem_release(ESP_BT_MODE_CLASSIC_BT);
     ESP_LOGI(TAG, "Initialising BLE for iBBQ");
+    // The BLE stack allocates on its own, so charge what its initialisation took. WiFi starts at the
+    // same time, so this is only an estimate.
+    size_t free_before = esp_get_free_heap_size();
     init_ble(&ctx);
-
-    esp_event_loop_args_t ble_loop_args = {
-        .queue_size = 2,
-        .task_name = "ble_task", // task will be created
-        .task_priority = uxTaskPriorityGet(NULL),
-        .task_stack_size = 4096,
-        .task_core_id = tskNO_AFFINITY};
+    heap_stats_add(HEAP_TAG_BLE, (int32_t)free_before - (int32_t)esp_get_free_heap_size());
 
     ESP_ERROR_CHECK(esp_timer_create(&battery_timer_args, &battery_timer));
     ESP_ERROR_CHECK(esp_timer_create(&ble_timeout_timer_args, &ble_timeout_timer));
 
-    ESP_ERROR_CHECK(esp_event_loop_create(&ble_loop_args, &ble_loop));
-    ESP_ERROR_CHECK(esp_event_handler_register_with(ble_loop, IBBQ_EVENTS, IBBQ_START_SCAN, start_discovery_handler, &ctx));
-    ESP_ERROR_CHECK(esp_event_handler_register_with(ble_loop, IBBQ_EVENTS, IBBQ_DISCOVERED, device_discovered, &ctx));
-    ESP_ERROR_CHECK(esp_event_handler_register_with(ble_loop, IBBQ_EVENTS, IBBQ_CONNECTED, device_connected, &ctx));
-    ESP_ERROR_CHECK(esp_event_handler_register_with(ble_loop, IBBQ_EVENTS, IBBQ_AUTHENTICATED, device_authenticated, &ctx));
-    ESP_ERROR_CHECK(esp_event_handler_register_with(ble_loop, IBBQ_EVENTS, IBBQ_REQUEST_STATE, request_device_state, &ctx));
+    xTaskCreatePinnedToCore(&ble_task, "ble_task", BLE_TASK_STACK_SIZE, &ctx, TASK_PRIO_BLE_LOOP, NULL, TASK_CORE_BLE);
+    TaskRegistry::add("ble_task", BLE_TASK_STACK_SIZE);
 
-    ESP_ERROR_CHECK(esp_event_post_to(ble_loop, IBBQ_EVENTS, IBBQ_START_SCAN, &ctx, sizeof(ibbq_state_t), portMAX_DELAY));
+    ble_capture_init(NULL);
+    post_event(IBBQ_START_SCAN);
+
+    return &ctx;
+#endif
+}
 
+ibbq_state_t *get_ibbq_state()
+{
     return &ctx;
 }
+
+void ibbq_get_event_stats(ibbq_event_stats_t *stats)
+{
+    portENTER_CRITICAL(&event_stats_mux);
+    *stats = event_stats;
+    portEXIT_CRITICAL(&event_stats_mux);
+}
+
+const char *ibbq_event_name(ibbq_event_type_t type)
+{
+    return type < IBBQ_EVENT_COUNT ? event_names[type] : "unknown";
+}
 #endif
\ No newline at end of file
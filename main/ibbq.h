@@ -2,8 +2,7 @@
 #define IBBQ_H
 
 #include "BLEDevice.h"
-
-#define MAX_PROBE_COUNT 8
+#include "probe_state.h"
 
 //#define MOCK_IBBQ
 
@@ -12,25 +11,13 @@ extern "C"
 {
 #endif
 
-    const uint8_t ALARM_LOCAL = 0x01;
-    const uint8_t ALARM_CLOUD = 0x02;
-    const uint8_t ALARM_IBBQ = 0x04;
-
-    typedef struct probe_data
-    {
-        float min;
-        float max;
-        char color[8];
-        uint8_t alarm;
-        char name[128];
-    } probe_data_t;
-
     typedef struct ibbq_state
     {
+        // Names and colors live apart from the samples, first so a static state can point to them
+        probe_config_t *config;
         bool connected;
         uint8_t rssi;
-        probe_data_t probes[MAX_PROBE_COUNT];
-        float temps[MAX_PROBE_COUNT];
+        probe_hot_t probes;
         size_t probe_count;
         float battery_percent;
         BLEScan *pBLEScan;
@@ -38,6 +25,15 @@ extern "C"
     } ibbq_state_t;
 
     ibbq_state_t *init_ibbq();
+    ibbq_state_t *get_ibbq_state();
+
+    // The web server changes names, colors and the min, max and alarm of the probes while the BLE
+    // callback, the uploader and other requests read them, so they are only copied in and out
+    // through these. limits carries the thresholds, its samples are ignored. Either may be NULL.
+    void ibbq_get_config(const ibbq_state_t *state, probe_config_t *config, probe_hot_t *limits);
+    void ibbq_set_config(ibbq_state_t *state, const probe_config_t *config, const probe_hot_t *limits);
+    // probe_hot_update under the same lock, a sample is never checked against half changed thresholds
+    void ibbq_update_probes(ibbq_state_t *state, const uint16_t *raw_values, size_t count, int64_t now_us);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,47 @@
+#include "ibbq.h"
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+
+// Shared by the real and the simulated thermometer, there is only one state. A copy of the config
+// takes a few microseconds, short enough for a critical section the BLE callback can wait for.
+static portMUX_TYPE config_mux = portMUX_INITIALIZER_UNLOCKED;
+
+void ibbq_get_config(const ibbq_state_t *state, probe_config_t *config, probe_hot_t *limits)
+{
+    portENTER_CRITICAL(&config_mux);
+    if (config != NULL)
+    {
+        *config = *state->config;
+    }
+    if (limits != NULL)
+    {
+        memcpy(limits->min, state->probes.min, sizeof(limits->min));
+        memcpy(limits->max, state->probes.max, sizeof(limits->max));
+        memcpy(limits->alarm, state->probes.alarm, sizeof(limits->alarm));
+    }
+    portEXIT_CRITICAL(&config_mux);
+}
+
+void ibbq_set_config(ibbq_state_t *state, const probe_config_t *config, const probe_hot_t *limits)
+{
+    portENTER_CRITICAL(&config_mux);
+    if (config != NULL)
+    {
+        *state->config = *config;
+    }
+    if (limits != NULL)
+    {
+        memcpy(state->probes.min, limits->min, sizeof(limits->min));
+        memcpy(state->probes.max, limits->max, sizeof(limits->max));
+        memcpy(state->probes.alarm, limits->alarm, sizeof(limits->alarm));
+    }
+    portEXIT_CRITICAL(&config_mux);
+}
+
+void ibbq_update_probes(ibbq_state_t *state, const uint16_t *raw_values, size_t count, int64_t now_us)
+{
+    portENTER_CRITICAL(&config_mux);
+    probe_hot_update(&state->probes, raw_values, count, now_us);
+    portEXIT_CRITICAL(&config_mux);
+}
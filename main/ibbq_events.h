@@ -1,29 +1,73 @@
 #ifndef IBBQ_EVENTS_H
 #define IBBQ_EVENTS_H
 
-#include "esp_event.h"
-#include "esp_event_loop.h"
-#include "esp_timer.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Events that can wait for the BLE task, a full queue drops new events instead of blocking the poster
+#define IBBQ_EVENT_QUEUE_SIZE 8
+// Slots only the state machine may fill. Each of its handlers posts the next step, so besides that
+// one at most a scan after a disconnect or a connect timeout is waiting.
+#define IBBQ_EVENT_RESERVED 2
 
 #ifdef __cplusplus
 extern "C"
 {
 #endif
 
-    ESP_EVENT_DECLARE_BASE(IBBQ_EVENTS);
-
-    enum
+    // Every type maps to a handler in ibbq.cpp, keep both in the same order
+    typedef enum ibbq_event_type
     {
         IBBQ_START_SCAN,
         IBBQ_DISCOVERED,
         IBBQ_CONNECTED,
         IBBQ_AUTHENTICATED,
         IBBQ_REQUEST_STATE,
-        IBBQ_DISCONNECT
-    };
+        IBBQ_EVENT_COUNT
+    } ibbq_event_type_t;
+
+    typedef struct ibbq_discovered
+    {
+        uint8_t address[6];
+        uint8_t address_type;
+        int8_t rssi;
+    } ibbq_discovered_t;
+
+    // Events are copied into the queue, so they only carry what their handler needs and
+    // never a pointer to state the poster might change meanwhile
+    typedef struct ibbq_event
+    {
+        int64_t posted_us;
+        uint8_t type;
+        union
+        {
+            ibbq_discovered_t discovered;
+        } data;
+    } ibbq_event_t;
+
+    typedef struct ibbq_event_stats
+    {
+        uint32_t posted[IBBQ_EVENT_COUNT];
+        uint32_t dropped[IBBQ_EVENT_COUNT];
+        uint32_t handled;
+        uint8_t max_queued;
+    } ibbq_event_stats_t;
+
+    // Whether an event may join queued others. Every event but IBBQ_REQUEST_STATE moves the state
+    // machine on and nothing posts it again if it is dropped, so the periodic requests leave the
+    // reserved slots to those.
+    static inline bool ibbq_event_admit(uint8_t type, size_t queued)
+    {
+        size_t limit = type == IBBQ_REQUEST_STATE ? IBBQ_EVENT_QUEUE_SIZE - IBBQ_EVENT_RESERVED : IBBQ_EVENT_QUEUE_SIZE;
+        return queued < limit;
+    }
+
+    void ibbq_get_event_stats(ibbq_event_stats_t *stats);
+    const char *ibbq_event_name(ibbq_event_type_t type);
 
 #ifdef __cplusplus
 }
 #endif
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,33 @@
+#include "ibbq_notify.h"
+
+static uint16_t little_endian(const uint8_t *data)
+{
+    return (uint16_t)(data[1] << 8 | data[0]);
+}
+
+size_t ibbq_parse_realtime(const uint8_t *data, size_t length, uint16_t *raw_values)
+{
+    size_t count = length / 2 < MAX_PROBE_COUNT ? length / 2 : MAX_PROBE_COUNT;
+    for (size_t i = 0; i < count; i++)
+    {
+        raw_values[i] = little_endian(&data[i * 2]);
+    }
+    return count;
+}
+
+bool ibbq_parse_battery(const uint8_t *data, size_t length, float *battery_percent)
+{
+    if (length < 5)
+    {
+        return false;
+    }
+    uint16_t voltage = little_endian(&data[1]);
+    uint16_t max_voltage = little_endian(&data[3]);
+    if (max_voltage == 0)
+    {
+        max_voltage = IBBQ_MAX_VOLTAGE;
+    }
+    // Whole percent
+    *battery_percent = (100 * voltage) / max_voltage;
+    return true;
+}
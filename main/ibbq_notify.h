@@ -0,0 +1,37 @@
+#ifndef IBBQ_NOTIFY_H
+#define IBBQ_NOTIFY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "probe_state.h"
+
+// Decoding of the notifications of an iBBQ thermometer, shared by the BLE callbacks and the
+// replay of captures. Doesn't pull in the BLE headers so it also builds on a PC.
+
+// Short UUIDs of the characteristics, the ones captures record
+#define IBBQ_UUID_ACCOUNT_VERIFY 0xfff2
+#define IBBQ_UUID_REALTIME_DATA 0xfff4
+#define IBBQ_UUID_SETTINGS 0xfff5
+#define IBBQ_UUID_SETTINGS_RESULT 0xfff1
+#define IBBQ_UUID_CLIENT_CONFIG 0x2902
+
+// Assumed when the thermometer reports a maximum voltage of 0
+#define IBBQ_MAX_VOLTAGE 6550
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // One little endian value per probe, returns the number of probes, at most MAX_PROBE_COUNT
+    size_t ibbq_parse_realtime(const uint8_t *data, size_t length, uint16_t *raw_values);
+    // Answer to the battery request, returns false if it is too short
+    bool ibbq_parse_battery(const uint8_t *data, size_t length, float *battery_percent);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,196 @@
+#include "ibbq_sim.h"
+
+#include <string.h>
+#include <math.h>
+
+// Measurement noise of a probe, the iBBQ reports tenths of a degree
+#define PROBE_NOISE 0.2f
+// Fraction of the difference to the room temperature the pit loses per minute with the lid open.
+// A 110 degree pit drops by about 25 degrees in a minute and is back within 5 degrees
+// of the set point about eight minutes after the lid was closed.
+#define LID_OPEN_COOLING 0.3f
+// Width of the transition into the stall in degrees
+#define STALL_WIDTH 2.0f
+
+static uint32_t next_random(sim_device_t *device)
+{
+    // xorshift32, never returns 0 as long as the state isn't 0
+    uint32_t x = device->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    device->rng = x;
+    return x;
+}
+
+// Uniform in [0, 1)
+static float random_float(sim_device_t *device)
+{
+    return (next_random(device) >> 8) / 16777216.0f;
+}
+
+static uint32_t random_duration(sim_device_t *device, uint32_t min_s, uint32_t max_s)
+{
+    return min_s + next_random(device) % (max_s - min_s + 1);
+}
+
+static bool random_event(sim_device_t *device, float per_hour)
+{
+    return per_hour > 0 && random_float(device) < per_hour / 3600.0f;
+}
+
+void sim_default_config(sim_device_config_t *config, uint32_t seed)
+{
+    memset(config, 0, sizeof(*config));
+    config->probe_count = 4;
+    config->probes[0] = {SIM_PROBE_MEAT, 5.0f, 0.006f, 68.0f, 180.0f};
+    config->probes[1] = {SIM_PROBE_MEAT, 5.0f, 0.015f, 65.0f, 60.0f};
+    config->probes[2] = {SIM_PROBE_PIT, 0, 0, 0, 0};
+    config->probes[3] = {SIM_PROBE_UNPLUGGED, 0, 0, 0, 0};
+    config->ambient_temp = 20.0f;
+    config->pit_set_point = 110.0f;
+    config->pit_heat_rate = 0.2f;
+    config->lid_opens_per_hour = 2.0f;
+    config->dropouts_per_hour = 1.0f;
+    config->unplugs_per_hour = 0.5f;
+    config->battery_drain = 3.0f;
+    config->seed = seed;
+}
+
+void sim_device_init(sim_device_t *device, const sim_device_config_t *config)
+{
+    memset(device, 0, sizeof(*device));
+    device->config = *config;
+    if (device->config.probe_count > SIM_MAX_PROBES)
+    {
+        device->config.probe_count = SIM_MAX_PROBES;
+    }
+    device->pit_temp = config->ambient_temp;
+    for (size_t i = 0; i < device->config.probe_count; i++)
+    {
+        device->temps[i] = config->probes[i].start_temp;
+        device->moisture[i] = 1.0f;
+    }
+    device->battery_percent = 100.0f;
+    device->rng = config->seed != 0 ? config->seed : 1;
+}
+
+static void step_pit(sim_device_t *device)
+{
+    const sim_device_config_t *config = &device->config;
+    if (device->lid_open_left_s > 0)
+    {
+        device->lid_open_left_s--;
+        device->pit_temp += LID_OPEN_COOLING / 60.0f * (config->ambient_temp - device->pit_temp);
+    }
+    else
+    {
+        device->pit_temp += config->pit_heat_rate / 60.0f * (config->pit_set_point - device->pit_temp);
+        if (random_event(device, config->lid_opens_per_hour))
+        {
+            device->lid_open_left_s = random_duration(device, 30, 90);
+        }
+    }
+}
+
+static void step_meat(sim_device_t *device, size_t i)
+{
+    const sim_probe_config_t *probe = &device->config.probes[i];
+    float rate = probe->heat_rate / 60.0f;
+    float heating = rate * (device->pit_temp - device->temps[i]);
+
+    // Evaporation cancels the heating at the stall temperature until the surface is dry
+    float evaporation = 0;
+    if (device->moisture[i] > 0 && probe->stall_minutes > 0)
+    {
+        float onset = 1.0f / (1.0f + expf((probe->stall_temp - device->temps[i]) / STALL_WIDTH));
+        evaporation = onset * rate * (device->config.pit_set_point - probe->stall_temp);
+        device->moisture[i] -= onset / (probe->stall_minutes * 60.0f);
+        if (device->moisture[i] < 0)
+        {
+            device->moisture[i] = 0;
+        }
+    }
+    device->temps[i] += heating - evaporation;
+}
+
+static void step_unplugs(sim_device_t *device)
+{
+    const sim_device_config_t *config = &device->config;
+    for (size_t i = 0; i < config->probe_count; i++)
+    {
+        if (device->unplugged_left_s[i] > 0)
+        {
+            device->unplugged_left_s[i]--;
+        }
+    }
+    if (config->probe_count > 0 && random_event(device, config->unplugs_per_hour))
+    {
+        size_t i = next_random(device) % config->probe_count;
+        if (config->probes[i].kind != SIM_PROBE_UNPLUGGED)
+        {
+            device->unplugged_left_s[i] = random_duration(device, 10, 120);
+        }
+    }
+}
+
+static uint16_t to_raw(sim_device_t *device, float temp)
+{
+    temp += (random_float(device) * 2.0f - 1.0f) * PROBE_NOISE;
+    if (temp <= 0)
+    {
+        return 0;
+    }
+    return (uint16_t)lroundf(temp * 10.0f);
+}
+
+bool sim_device_step(sim_device_t *device, uint16_t *raw_values)
+{
+    const sim_device_config_t *config = &device->config;
+    device->elapsed_s++;
+
+    step_pit(device);
+    for (size_t i = 0; i < config->probe_count; i++)
+    {
+        if (config->probes[i].kind == SIM_PROBE_MEAT)
+        {
+            step_meat(device, i);
+        }
+    }
+    step_unplugs(device);
+
+    device->battery_percent -= config->battery_drain / 3600.0f;
+    if (device->battery_percent < 0)
+    {
+        device->battery_percent = 0;
+    }
+
+    // The meat keeps cooking while the radio link is down
+    if (device->dropout_left_s > 0)
+    {
+        device->dropout_left_s--;
+        return false;
+    }
+    if (random_event(device, config->dropouts_per_hour))
+    {
+        device->dropout_left_s = random_duration(device, 5, 60);
+        return false;
+    }
+
+    for (size_t i = 0; i < config->probe_count; i++)
+    {
+        switch (config->probes[i].kind)
+        {
+        case SIM_PROBE_PIT:
+            raw_values[i] = device->unplugged_left_s[i] > 0 ? SIM_RAW_UNPLUGGED : to_raw(device, device->pit_temp);
+            break;
+        case SIM_PROBE_MEAT:
+            raw_values[i] = device->unplugged_left_s[i] > 0 ? SIM_RAW_UNPLUGGED : to_raw(device, device->temps[i]);
+            break;
+        default:
+            raw_values[i] = SIM_RAW_UNPLUGGED;
+            break;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,83 @@
+#ifndef IBBQ_SIM_H
+#define IBBQ_SIM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Same as MAX_PROBE_COUNT, this header doesn't pull in the BLE headers so the model also builds on a PC
+#define SIM_MAX_PROBES 8
+// Raw value of the iBBQ protocol for a probe that is not plugged in
+#define SIM_RAW_UNPLUGGED 0xFFF6
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef enum sim_probe_kind
+    {
+        SIM_PROBE_UNPLUGGED,
+        // Measures the air in the smoker, which follows the set point and dips whenever the lid is opened
+        SIM_PROBE_PIT,
+        // Heats towards the pit temperature and stalls while moisture evaporates from the surface
+        SIM_PROBE_MEAT
+    } sim_probe_kind_t;
+
+    typedef struct sim_probe_config
+    {
+        sim_probe_kind_t kind;
+        // Meat probes only, pit probes always show the air temperature
+        float start_temp;
+        // Fraction of the difference to the pit temperature gained per minute
+        float heat_rate;
+        // Temperature of the plateau and how long it lasts in minutes
+        float stall_temp;
+        float stall_minutes;
+    } sim_probe_config_t;
+
+    typedef struct sim_device_config
+    {
+        uint8_t probe_count;
+        sim_probe_config_t probes[SIM_MAX_PROBES];
+        float ambient_temp;
+        float pit_set_point;
+        // Fraction of the difference to the set point the pit gains per minute
+        float pit_heat_rate;
+        // Random events, each lid opening lasts 30 to 90 s, each dropout 5 to 60 s
+        // and each unplugged probe stays out for 10 to 120 s
+        float lid_opens_per_hour;
+        float dropouts_per_hour;
+        float unplugs_per_hour;
+        // Percent per hour
+        float battery_drain;
+        uint32_t seed;
+    } sim_device_config_t;
+
+    typedef struct sim_device
+    {
+        sim_device_config_t config;
+        float pit_temp;
+        float temps[SIM_MAX_PROBES];
+        // 1 at the start of the cook, the stall ends once it is used up
+        float moisture[SIM_MAX_PROBES];
+        uint32_t lid_open_left_s;
+        uint32_t dropout_left_s;
+        uint32_t unplugged_left_s[SIM_MAX_PROBES];
+        float battery_percent;
+        uint32_t rng;
+        uint32_t elapsed_s;
+    } sim_device_t;
+
+    // A brisket, a rack of ribs, a pit probe and one empty socket on a smoker at 110 degrees
+    void sim_default_config(sim_device_config_t *config, uint32_t seed);
+    void sim_device_init(sim_device_t *device, const sim_device_config_t *config);
+    // Advances the model by one second. Returns false while the radio link is down, otherwise
+    // fills raw_values with what the thermometer would send: tenths of a degree or SIM_RAW_UNPLUGGED.
+    bool sim_device_step(sim_device_t *device, uint16_t *raw_values);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,263 @@
+#include "influx.h"
+
+#include <string.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_http_client.h"
+#include "lwip/apps/sntp.h"
+
+#include "settings.h"
+#include "influx_line.h"
+#include "heap_stats.h"
+#include "TaskRegistry.h"
+#include "task_plan.h"
+
+#define NTP_SERVER "pool.ntp.org"
+// Anything earlier means the clock was not set yet
+#define MIN_VALID_TIME 1577836800
+#define DISABLED_POLL_MS 60000
+
+static const char *TAG = "influx";
+
+static TaskHandle_t task = NULL;
+static ibbq_state_t *bbq_state = NULL;
+static influx_settings_t settings = {};
+static esp_http_client_handle_t client = NULL;
+static influx_queue_t queue = {};
+
+static portMUX_TYPE stats_mux = portMUX_INITIALIZER_UNLOCKED;
+static influx_stats_t stats = {};
+// Only take_sample uses it, kept off the stack of the task
+static probe_config_t sample_config = {};
+
+static void count_dropped(uint16_t points)
+{
+    if (points == 0)
+    {
+        return;
+    }
+    portENTER_CRITICAL(&stats_mux);
+    stats.points_dropped += points;
+    portEXIT_CRITICAL(&stats_mux);
+    ESP_LOGW(TAG, "Dropping %d points", points);
+}
+
+static void append_line(const char *line, size_t len)
+{
+    count_dropped(influx_queue_append(&queue, line, len, esp_timer_get_time()));
+}
+
+static void take_sample()
+{
+    time_t now = time(NULL);
+    if (now < MIN_VALID_TIME)
+    {
+        ESP_LOGD(TAG, "Waiting for the clock to be set before sampling");
+        return;
+    }
+    if (!bbq_state->connected)
+    {
+        return;
+    }
+
+    char line[INFLUX_LINE_MAX];
+    ibbq_get_config(bbq_state, &sample_config, NULL);
+    for (size_t i = 0; i < bbq_state->probe_count; i++)
+    {
+        float temp = bbq_state->probes.temps[i];
+        if (temp > MAX_VALID_TEMP)
+        {
+            continue;
+        }
+        size_t len = influx_temperature_line(line, sizeof(line), i + 1, probe_config_name(&sample_config, i),
+                                             temp, (long)now);
+        if (len > 0)
+        {
+            append_line(line, len);
+        }
+    }
+    size_t len = influx_device_line(line, sizeof(line), bbq_state->battery_percent, bbq_state->rssi, (long)now);
+    if (len > 0)
+    {
+        append_line(line, len);
+    }
+}
+
+static void open_client()
+{
+    if (client != NULL)
+    {
+        esp_http_client_cleanup(client);
+        client = NULL;
+    }
+    if (!settings.enabled || settings.url[0] == '\0')
+    {
+        return;
+    }
+
+    // The handle is kept for all requests, so the connection stays open as long as the server allows
+    // Timestamps are sent in seconds, 9 bytes per point less than the default nanoseconds
+    char url[sizeof(settings.url) + 16];
+    snprintf(url, sizeof(url), "%s", settings.url);
+    if (strstr(url, "precision=") == NULL)
+    {
+        strncat(url, strchr(url, '?') != NULL ? "&precision=s" : "?precision=s", sizeof(url) - strlen(url) - 1);
+    }
+
+    esp_http_client_config_t config = {};
+    config.url = url;
+    config.method = HTTP_METHOD_POST;
+    config.timeout_ms = INFLUX_TIMEOUT_MS;
+    client = esp_http_client_init(&config);
+    if (client == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to create HTTP client for %s", settings.url);
+        return;
+    }
+    esp_http_client_set_header(client, "Content-Type", "text/plain; charset=utf-8");
+    if (settings.token[0] != '\0')
+    {
+        char auth[sizeof(settings.token) + 8];
+        snprintf(auth, sizeof(auth), "Token %s", settings.token);
+        esp_http_client_set_header(client, "Authorization", auth);
+    }
+}
+
+static void send(const influx_batch_t *batch)
+{
+    esp_http_client_set_post_field(client, batch->data, batch->len);
+    esp_err_t err = esp_http_client_perform(client);
+    int status = err == ESP_OK ? esp_http_client_get_status_code(client) : 0;
+
+    portENTER_CRITICAL(&stats_mux);
+    stats.requests++;
+    stats.last_status = status;
+    portEXIT_CRITICAL(&stats_mux);
+
+    if (status >= 200 && status < 300)
+    {
+        portENTER_CRITICAL(&stats_mux);
+        stats.points_sent += batch->points;
+        stats.bytes_sent += batch->len;
+        portEXIT_CRITICAL(&stats_mux);
+        influx_queue_sent(&queue);
+        return;
+    }
+
+    portENTER_CRITICAL(&stats_mux);
+    stats.failures++;
+    portEXIT_CRITICAL(&stats_mux);
+    uint16_t dropped = influx_queue_failed(&queue, status, esp_random(), esp_timer_get_time());
+    if (dropped > 0)
+    {
+        ESP_LOGE(TAG, "Server rejected batch with status %d", status);
+        count_dropped(dropped);
+        return;
+    }
+    ESP_LOGW(TAG, "Upload failed: %s, status %d", esp_err_to_name(err), status);
+}
+
+static void update_stats()
+{
+    portENTER_CRITICAL(&stats_mux);
+    stats.enabled = client != NULL;
+    stats.pending_batches = influx_queue_pending(&queue);
+    stats.backoff_ms = queue.backoff_ms;
+    portEXIT_CRITICAL(&stats_mux);
+}
+
+static void upload_task(void *arg)
+{
+    loadSettings(INFLUX_SETTINGS, &settings);
+    open_client();
+    int64_t next_sample_us = esp_timer_get_time();
+
+    while (true)
+    {
+        update_stats();
+        int64_t now_us = esp_timer_get_time();
+        int64_t wake_us =
+            client != NULL ? influx_queue_wake_us(&queue, next_sample_us) : now_us + DISABLED_POLL_MS * 1000LL;
+        if (wake_us > now_us && ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS((wake_us - now_us) / 1000 + 1)) > 0)
+        {
+            loadSettings(INFLUX_SETTINGS, &settings);
+            open_client();
+            influx_queue_reset_backoff(&queue);
+            ESP_LOGI(TAG, "Uploading %s", client != NULL ? settings.url : "disabled");
+        }
+        if (client == NULL)
+        {
+            continue;
+        }
+
+        now_us = esp_timer_get_time();
+        if (now_us >= next_sample_us)
+        {
+            take_sample();
+            next_sample_us += INFLUX_SAMPLE_INTERVAL_MS * 1000LL;
+            if (next_sample_us < now_us)
+            {
+                next_sample_us = now_us + INFLUX_SAMPLE_INTERVAL_MS * 1000LL;
+            }
+        }
+        influx_queue_seal_if_due(&queue, now_us);
+        const influx_batch_t *batch = influx_queue_next(&queue, now_us);
+        if (batch != NULL)
+        {
+            send(batch);
+        }
+    }
+}
+
+void influx_start(ibbq_state_t *state)
+{
+    if (task != NULL)
+    {
+        return;
+    }
+    char *buffers[INFLUX_BATCH_COUNT];
+    for (size_t i = 0; i < INFLUX_BATCH_COUNT; i++)
+    {
+        buffers[i] = (char *)heap_stats_malloc(HEAP_TAG_UPLOAD, INFLUX_BATCH_SIZE);
+        if (buffers[i] == NULL)
+        {
+            ESP_LOGE(TAG, "No memory for %d upload batches", INFLUX_BATCH_COUNT);
+            for (size_t j = 0; j < i; j++)
+            {
+                heap_stats_free(buffers[j]);
+            }
+            return;
+        }
+    }
+    influx_queue_init(&queue, buffers);
+
+    if (!sntp_enabled())
+    {
+        sntp_setoperatingmode(SNTP_OPMODE_POLL);
+        sntp_setservername(0, (char *)NTP_SERVER);
+        sntp_init();
+    }
+
+    bbq_state = state;
+    xTaskCreatePinnedToCore(&upload_task, "influx", INFLUX_STACK_SIZE, NULL, TASK_PRIO_INFLUX, &task, TASK_CORE_NET);
+    TaskRegistry::add("influx", INFLUX_STACK_SIZE);
+}
+
+void influx_reload()
+{
+    if (task != NULL)
+    {
+        xTaskNotifyGive(task);
+    }
+}
+
+void influx_get_stats(influx_stats_t *out)
+{
+    portENTER_CRITICAL(&stats_mux);
+    *out = stats;
+    portEXIT_CRITICAL(&stats_mux);
+}
@@ -0,0 +1,46 @@
+#ifndef INFLUX_H
+#define INFLUX_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "ibbq.h"
+#include "influx_queue.h"
+
+// A sample of every probe is taken this often while uploading is enabled
+#define INFLUX_SAMPLE_INTERVAL_MS 5000
+#define INFLUX_TIMEOUT_MS 5000
+#define INFLUX_STACK_SIZE 4096
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef struct influx_stats
+    {
+        bool enabled;
+        uint32_t points_sent;
+        uint32_t points_dropped;
+        uint32_t requests;
+        uint32_t failures;
+        uint32_t bytes_sent;
+        // Batches waiting to be sent, including the one being filled
+        uint8_t pending_batches;
+        // HTTP status of the last request, 0 if it failed before a response arrived
+        int last_status;
+        uint32_t backoff_ms;
+    } influx_stats_t;
+
+    // Starts the uploader task once, later calls do nothing. Samples are only
+    // taken once the clock was set via SNTP, InfluxDB needs absolute timestamps.
+    void influx_start(ibbq_state_t *state);
+    // Applies changed INFLUX_SETTINGS, pending batches are kept
+    void influx_reload();
+    void influx_get_stats(influx_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,51 @@
+#include "influx_line.h"
+
+#include <stdio.h>
+
+void influx_escape_tag(const char *value, char *out, size_t out_len)
+{
+    size_t pos = 0;
+    for (; *value != '\0' && pos + 2 < out_len; value++)
+    {
+        if ((unsigned char)*value < 0x20 || *value == 0x7F)
+        {
+            continue;
+        }
+        if (*value == ',' || *value == ' ' || *value == '=' || *value == '\\')
+        {
+            out[pos++] = '\\';
+        }
+        out[pos++] = *value;
+    }
+    out[pos] = '\0';
+}
+
+// snprintf returns the length the line would have had, which is too long once it was cut off
+static size_t line_length(int len, size_t line_len)
+{
+    return len > 0 && (size_t)len < line_len ? len : 0;
+}
+
+size_t influx_temperature_line(char *line, size_t line_len, size_t probe, const char *name, float temp,
+                               long timestamp)
+{
+    char tag[INFLUX_TAG_MAX];
+    influx_escape_tag(name, tag, sizeof(tag));
+    int len;
+    if (tag[0] == '\0')
+    {
+        len = snprintf(line, line_len, "temperature,probe=%d value=%.1f %ld\n", (int)probe, temp, timestamp);
+    }
+    else
+    {
+        len = snprintf(line, line_len, "temperature,probe=%d,name=%s value=%.1f %ld\n", (int)probe, tag, temp,
+                       timestamp);
+    }
+    return line_length(len, line_len);
+}
+
+size_t influx_device_line(char *line, size_t line_len, float battery_percent, int rssi, long timestamp)
+{
+    int len = snprintf(line, line_len, "device battery=%.0f,rssi=%di %ld\n", battery_percent, rssi, timestamp);
+    return line_length(len, line_len);
+}
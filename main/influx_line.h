@@ -0,0 +1,32 @@
+#ifndef INFLUX_LINE_H
+#define INFLUX_LINE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Longest line a point is formatted into, points that don't fit are skipped
+#define INFLUX_LINE_MAX 192
+// Escaped probe names longer than this are cut off
+#define INFLUX_TAG_MAX 64
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Escapes commas, spaces, equal signs and backslashes for a tag value in line protocol and
+    // drops control characters, which would end the line. Cuts the value off to fit out_len.
+    void influx_escape_tag(const char *value, char *out, size_t out_len);
+
+    // Formats the point of a probe into line, probe is counted from 1. The name tag is left out
+    // if the escaped name is empty, InfluxDB rejects a whole batch for an empty tag value.
+    // Returns the length of the line or 0 if it did not fit.
+    size_t influx_temperature_line(char *line, size_t line_len, size_t probe, const char *name, float temp,
+                                   long timestamp);
+    size_t influx_device_line(char *line, size_t line_len, float battery_percent, int rssi, long timestamp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,129 @@
+#include "influx_queue.h"
+
+#include <string.h>
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+static influx_batch_t *filling(influx_queue_t *queue)
+{
+    return &queue->batches[(queue->head + queue->sealed) % INFLUX_BATCH_COUNT];
+}
+
+static uint16_t release_head(influx_queue_t *queue)
+{
+    influx_batch_t *batch = &queue->batches[queue->head];
+    uint16_t points = batch->points;
+    batch->len = 0;
+    batch->points = 0;
+    queue->head = (queue->head + 1) % INFLUX_BATCH_COUNT;
+    queue->sealed--;
+    return points;
+}
+
+static uint16_t seal(influx_queue_t *queue)
+{
+    uint16_t dropped = 0;
+    if (filling(queue)->points == 0)
+    {
+        return 0;
+    }
+    queue->sealed++;
+    if (queue->sealed == INFLUX_BATCH_COUNT)
+    {
+        dropped = release_head(queue);
+    }
+    filling(queue)->len = 0;
+    filling(queue)->points = 0;
+    return dropped;
+}
+
+void influx_queue_init(influx_queue_t *queue, char *const *buffers)
+{
+    memset(queue, 0, sizeof(*queue));
+    for (size_t i = 0; i < INFLUX_BATCH_COUNT; i++)
+    {
+        queue->batches[i].data = buffers[i];
+    }
+}
+
+uint16_t influx_queue_append(influx_queue_t *queue, const char *line, size_t len, int64_t now_us)
+{
+    uint16_t dropped = 0;
+    if (filling(queue)->len + len > INFLUX_BATCH_SIZE)
+    {
+        dropped = seal(queue);
+    }
+    influx_batch_t *batch = filling(queue);
+    if (batch->points == 0)
+    {
+        queue->batch_started_us = now_us;
+    }
+    memcpy(batch->data + batch->len, line, len);
+    batch->len += len;
+    batch->points++;
+    return dropped;
+}
+
+void influx_queue_seal_if_due(influx_queue_t *queue, int64_t now_us)
+{
+    // While older batches wait for the server, the current one is filled up, so an outage is bridged for longer
+    if (queue->sealed == 0 && filling(queue)->points > 0 &&
+        now_us - queue->batch_started_us >= INFLUX_FLUSH_INTERVAL_MS * 1000LL)
+    {
+        seal(queue);
+    }
+}
+
+const influx_batch_t *influx_queue_next(const influx_queue_t *queue, int64_t now_us)
+{
+    if (queue->sealed == 0 || now_us < queue->retry_at_us)
+    {
+        return NULL;
+    }
+    return &queue->batches[queue->head];
+}
+
+void influx_queue_sent(influx_queue_t *queue)
+{
+    release_head(queue);
+    influx_queue_reset_backoff(queue);
+}
+
+uint16_t influx_queue_failed(influx_queue_t *queue, int status, uint32_t random, int64_t now_us)
+{
+    if (status >= 400 && status < 500 && status != 408 && status != 429)
+    {
+        // The server will never accept this batch, retrying would block everything behind it
+        return release_head(queue);
+    }
+    queue->backoff_ms =
+        queue->backoff_ms == 0 ? INFLUX_BACKOFF_MIN_MS : MIN(queue->backoff_ms * 2, INFLUX_BACKOFF_MAX_MS);
+    // Up to a quarter more, so gateways that lost the server at the same time don't retry in step
+    uint32_t jitter = random % (queue->backoff_ms / 4 + 1);
+    queue->retry_at_us = now_us + (int64_t)(queue->backoff_ms + jitter) * 1000;
+    return 0;
+}
+
+void influx_queue_reset_backoff(influx_queue_t *queue)
+{
+    queue->backoff_ms = 0;
+    queue->retry_at_us = 0;
+}
+
+int64_t influx_queue_wake_us(const influx_queue_t *queue, int64_t wake_us)
+{
+    if (queue->sealed == 0 && queue->batches[queue->head].points > 0)
+    {
+        wake_us = MIN(wake_us, queue->batch_started_us + INFLUX_FLUSH_INTERVAL_MS * 1000LL);
+    }
+    if (queue->sealed > 0)
+    {
+        wake_us = MIN(wake_us, queue->retry_at_us);
+    }
+    return wake_us;
+}
+
+uint8_t influx_queue_pending(const influx_queue_t *queue)
+{
+    return queue->sealed + (queue->batches[(queue->head + queue->sealed) % INFLUX_BATCH_COUNT].points > 0 ? 1 : 0);
+}
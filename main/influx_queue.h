@@ -0,0 +1,67 @@
+#ifndef INFLUX_QUEUE_H
+#define INFLUX_QUEUE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// A batch is sent once it is full or this old, whatever comes first
+#define INFLUX_FLUSH_INTERVAL_MS 30000
+#define INFLUX_BATCH_SIZE 2048
+// Batches kept while the server is unreachable, the oldest is dropped when all are in use
+#define INFLUX_BATCH_COUNT 4
+#define INFLUX_BACKOFF_MIN_MS 1000
+#define INFLUX_BACKOFF_MAX_MS (5 * 60 * 1000)
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef struct influx_batch
+    {
+        char *data;
+        size_t len;
+        uint16_t points;
+    } influx_batch_t;
+
+    // Ring of batches, sealed ones from head on, followed by the one being filled. Times are those
+    // of esp_timer_get_time(), passed in so the queue can be run without the uploader task.
+    typedef struct influx_queue
+    {
+        influx_batch_t batches[INFLUX_BATCH_COUNT];
+        size_t head;
+        size_t sealed;
+        int64_t batch_started_us;
+        uint32_t backoff_ms;
+        int64_t retry_at_us;
+    } influx_queue_t;
+
+    // Each of buffers has room for INFLUX_BATCH_SIZE bytes
+    void influx_queue_init(influx_queue_t *queue, char *const *buffers);
+
+    // Copies a line into the batch being filled, sealing it first if the line doesn't fit. Returns the
+    // points of the oldest batch if it was dropped to make room, 0 otherwise.
+    uint16_t influx_queue_append(influx_queue_t *queue, const char *line, size_t len, int64_t now_us);
+    // Seals the batch being filled once it is INFLUX_FLUSH_INTERVAL_MS old and nothing else waits
+    void influx_queue_seal_if_due(influx_queue_t *queue, int64_t now_us);
+
+    // The oldest sealed batch once its retry is due, NULL if there is none
+    const influx_batch_t *influx_queue_next(const influx_queue_t *queue, int64_t now_us);
+    // The batch from influx_queue_next was accepted, it is released and the backoff ends
+    void influx_queue_sent(influx_queue_t *queue);
+    // Sending it failed with the HTTP status, 0 if there was no response. A batch the server will never
+    // accept is dropped and its points are returned, otherwise the next try is delayed by a backoff
+    // that doubles up to INFLUX_BACKOFF_MAX_MS, plus up to a quarter taken from random.
+    uint16_t influx_queue_failed(influx_queue_t *queue, int status, uint32_t random, int64_t now_us);
+    void influx_queue_reset_backoff(influx_queue_t *queue);
+
+    // When the queue needs the uploader next, at the latest wake_us
+    int64_t influx_queue_wake_us(const influx_queue_t *queue, int64_t wake_us);
+    // Batches waiting to be sent, including the one being filled
+    uint8_t influx_queue_pending(const influx_queue_t *queue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
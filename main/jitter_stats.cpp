@@ -0,0 +1,98 @@
+#include "jitter_stats.h"
+
+#include <string.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+static const char *metric_names[JITTER_COUNT] = {
+    "ingest",
+    "interval",
+    "ble_queue"};
+
+static jitter_histogram_t histograms[JITTER_COUNT] = {};
+static int64_t last_notification_us = 0;
+static portMUX_TYPE jitter_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static size_t bucket_index(uint32_t us)
+{
+    size_t index = us == 0 ? 0 : 32 - __builtin_clz(us);
+    return index < JITTER_BUCKETS ? index : JITTER_BUCKETS - 1;
+}
+
+void jitter_record(jitter_metric_t metric, uint32_t us)
+{
+    if (metric >= JITTER_COUNT)
+    {
+        return;
+    }
+    portENTER_CRITICAL(&jitter_mux);
+    jitter_histogram_t *histogram = &histograms[metric];
+    histogram->buckets[bucket_index(us)]++;
+    histogram->count++;
+    histogram->total_us += us;
+    if (us > histogram->max_us)
+    {
+        histogram->max_us = us;
+    }
+    portEXIT_CRITICAL(&jitter_mux);
+}
+
+void jitter_notification(int64_t received_us)
+{
+    jitter_record(JITTER_INGEST, esp_timer_get_time() - received_us);
+
+    portENTER_CRITICAL(&jitter_mux);
+    int64_t interval_us = last_notification_us > 0 ? received_us - last_notification_us : 0;
+    last_notification_us = received_us;
+    portEXIT_CRITICAL(&jitter_mux);
+    // Longer silences are dropouts or reconnects, GET /coex counts those
+    if (interval_us > 0 && interval_us < 2 * JITTER_NOTIFY_INTERVAL_US)
+    {
+        int64_t deviation_us = interval_us - JITTER_NOTIFY_INTERVAL_US;
+        jitter_record(JITTER_INTERVAL, deviation_us < 0 ? -deviation_us : deviation_us);
+    }
+}
+
+void jitter_get(jitter_metric_t metric, jitter_histogram_t *histogram)
+{
+    if (metric >= JITTER_COUNT)
+    {
+        memset(histogram, 0, sizeof(*histogram));
+        return;
+    }
+    portENTER_CRITICAL(&jitter_mux);
+    *histogram = histograms[metric];
+    portEXIT_CRITICAL(&jitter_mux);
+}
+
+void jitter_reset()
+{
+    portENTER_CRITICAL(&jitter_mux);
+    memset(histograms, 0, sizeof(histograms));
+    portEXIT_CRITICAL(&jitter_mux);
+}
+
+const char *jitter_metric_name(jitter_metric_t metric)
+{
+    return metric < JITTER_COUNT ? metric_names[metric] : "unknown";
+}
+
+uint32_t jitter_percentile(const jitter_histogram_t *histogram, uint8_t percent)
+{
+    if (histogram->count == 0)
+    {
+        return 0;
+    }
+    uint64_t wanted = ((uint64_t)histogram->count * percent + 99) / 100;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < JITTER_BUCKETS; i++)
+    {
+        seen += histogram->buckets[i];
+        if (seen >= wanted && seen > 0)
+        {
+            uint32_t upper_us = i == 0 ? 0 : (1u << i) - 1;
+            return i == JITTER_BUCKETS - 1 || upper_us > histogram->max_us ? histogram->max_us : upper_us;
+        }
+    }
+    return histogram->max_us;
+}
@@ -0,0 +1,50 @@
+#ifndef JITTER_STATS_H
+#define JITTER_STATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Bucket 0 counts 0 us, bucket i counts [2^(i-1), 2^i) us, the last one everything above
+#define JITTER_BUCKETS 24
+// The iBBQ notifies once a second
+#define JITTER_NOTIFY_INTERVAL_US 1000000
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Every metric maps to a name in jitter_stats.cpp, keep both in the same order
+    typedef enum jitter_metric
+    {
+        // From entering the notification callback until the sample is published
+        JITTER_INGEST,
+        // Deviation of the time between two notifications from JITTER_NOTIFY_INTERVAL_US
+        JITTER_INTERVAL,
+        // From posting an iBBQ event until the BLE task starts handling it
+        JITTER_BLE_QUEUE,
+        JITTER_COUNT
+    } jitter_metric_t;
+
+    typedef struct jitter_histogram
+    {
+        uint32_t buckets[JITTER_BUCKETS];
+        uint32_t count;
+        uint32_t max_us;
+        uint64_t total_us;
+    } jitter_histogram_t;
+
+    void jitter_record(jitter_metric_t metric, uint32_t us);
+    // Records both metrics for a notification received at received_us that was just published
+    void jitter_notification(int64_t received_us);
+    void jitter_get(jitter_metric_t metric, jitter_histogram_t *histogram);
+    void jitter_reset();
+    const char *jitter_metric_name(jitter_metric_t metric);
+    // Upper bound of the bucket holding the given percentile, 0 without samples
+    uint32_t jitter_percentile(const jitter_histogram_t *histogram, uint8_t percent);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,517 @@
+#include "json_stream.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum parser_state
+{
+    STATE_VALUE,
+    STATE_VALUE_OR_END, // Right after [
+    STATE_KEY,
+    STATE_KEY_OR_END, // Right after {
+    STATE_COLON,
+    STATE_AFTER_VALUE,
+    STATE_STRING,
+    STATE_ESCAPE,
+    STATE_UNICODE,
+    STATE_NUMBER,
+    STATE_LITERAL,
+    STATE_DONE,
+    STATE_ERROR
+} parser_state_t;
+
+static bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+void json_stream_init(json_stream_t *stream, json_stream_callback_t callback, void *ctx)
+{
+    memset(stream, 0, sizeof(*stream));
+    stream->callback = callback;
+    stream->ctx = ctx;
+    stream->state = STATE_VALUE;
+}
+
+const char *json_stream_key(const json_stream_t *stream, uint8_t depth)
+{
+    if (depth >= stream->depth || stream->containers[depth] != '{')
+    {
+        return NULL;
+    }
+    return stream->keys[depth];
+}
+
+static void emit(json_stream_t *stream, json_stream_value_t *value)
+{
+    value->depth = stream->depth;
+    value->key = NULL;
+    value->index = -1;
+    if (stream->depth > 0)
+    {
+        uint8_t parent = stream->depth - 1;
+        if (stream->containers[parent] == '{')
+        {
+            value->key = stream->keys[parent];
+        }
+        else
+        {
+            value->index = stream->indexes[parent];
+        }
+    }
+    stream->callback(stream, value, stream->ctx);
+}
+
+static void emit_simple(json_stream_t *stream, json_stream_type_t type)
+{
+    json_stream_value_t value = {};
+    value.type = type;
+    emit(stream, &value);
+}
+
+static void value_done(json_stream_t *stream)
+{
+    stream->state = stream->depth == 0 ? STATE_DONE : STATE_AFTER_VALUE;
+}
+
+static bool open_container(json_stream_t *stream, char container)
+{
+    if (stream->depth >= JSON_STREAM_MAX_DEPTH)
+    {
+        return false;
+    }
+    emit_simple(stream, container == '{' ? JSON_STREAM_OBJECT_START : JSON_STREAM_ARRAY_START);
+    stream->containers[stream->depth] = container;
+    stream->indexes[stream->depth] = 0;
+    stream->keys[stream->depth][0] = '\0';
+    stream->depth++;
+    stream->state = container == '{' ? STATE_KEY_OR_END : STATE_VALUE_OR_END;
+    return true;
+}
+
+static bool close_container(json_stream_t *stream, char c)
+{
+    char expected = c == '}' ? '{' : '[';
+    if (stream->depth == 0 || stream->containers[stream->depth - 1] != expected)
+    {
+        return false;
+    }
+    stream->depth--;
+    emit_simple(stream, c == '}' ? JSON_STREAM_OBJECT_END : JSON_STREAM_ARRAY_END);
+    value_done(stream);
+    return true;
+}
+
+// Appends to the key or string being parsed, cutting it off when full
+static void append(json_stream_t *stream, char c)
+{
+    char *target = stream->in_key ? stream->keys[stream->depth - 1] : stream->buf;
+    size_t max = stream->in_key ? JSON_STREAM_MAX_KEY : JSON_STREAM_MAX_STRING;
+    if (stream->buf_len + 1 < max)
+    {
+        target[stream->buf_len++] = c;
+        target[stream->buf_len] = '\0';
+    }
+    else
+    {
+        stream->truncated = true;
+    }
+}
+
+static void append_utf8(json_stream_t *stream, uint32_t code)
+{
+    if (code < 0x80)
+    {
+        append(stream, code);
+    }
+    else if (code < 0x800)
+    {
+        append(stream, 0xC0 | (code >> 6));
+        append(stream, 0x80 | (code & 0x3F));
+    }
+    else if (code < 0x10000)
+    {
+        append(stream, 0xE0 | (code >> 12));
+        append(stream, 0x80 | ((code >> 6) & 0x3F));
+        append(stream, 0x80 | (code & 0x3F));
+    }
+    else
+    {
+        append(stream, 0xF0 | (code >> 18));
+        append(stream, 0x80 | ((code >> 12) & 0x3F));
+        append(stream, 0x80 | ((code >> 6) & 0x3F));
+        append(stream, 0x80 | (code & 0x3F));
+    }
+}
+
+static void start_string(json_stream_t *stream, bool in_key)
+{
+    stream->in_key = in_key;
+    stream->buf_len = 0;
+    stream->truncated = false;
+    stream->high_surrogate = 0;
+    if (in_key)
+    {
+        stream->keys[stream->depth - 1][0] = '\0';
+    }
+    else
+    {
+        stream->buf[0] = '\0';
+    }
+    stream->state = STATE_STRING;
+}
+
+static void end_string(json_stream_t *stream)
+{
+    if (stream->in_key)
+    {
+        stream->state = STATE_COLON;
+        return;
+    }
+    json_stream_value_t value = {};
+    value.type = JSON_STREAM_STRING;
+    value.string = stream->buf;
+    value.truncated = stream->truncated;
+    emit(stream, &value);
+    value_done(stream);
+}
+
+// A high surrogate has to be followed by a low one right away, a lone surrogate has no
+// UTF-8 encoding and makes the document malformed, like it does for cJSON
+static bool unicode_done(json_stream_t *stream)
+{
+    uint32_t code = stream->unicode;
+    bool high = code >= 0xD800 && code < 0xDC00;
+    bool low = code >= 0xDC00 && code < 0xE000;
+    if (stream->high_surrogate != 0)
+    {
+        if (!low)
+        {
+            return false;
+        }
+        code = 0x10000 + ((stream->high_surrogate - 0xD800) << 10) + (code - 0xDC00);
+        stream->high_surrogate = 0;
+    }
+    else if (high)
+    {
+        stream->high_surrogate = code;
+        return true;
+    }
+    else if (low)
+    {
+        return false;
+    }
+    append_utf8(stream, code);
+    return true;
+}
+
+static bool is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+// Checks the JSON grammar, which is stricter than strtod: -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+static bool is_json_number(const char *p)
+{
+    if (*p == '-')
+    {
+        p++;
+    }
+    if (*p == '0')
+    {
+        p++;
+    }
+    else if (is_digit(*p))
+    {
+        while (is_digit(*p))
+        {
+            p++;
+        }
+    }
+    else
+    {
+        return false;
+    }
+    if (*p == '.')
+    {
+        p++;
+        if (!is_digit(*p))
+        {
+            return false;
+        }
+        while (is_digit(*p))
+        {
+            p++;
+        }
+    }
+    if (*p == 'e' || *p == 'E')
+    {
+        p++;
+        if (*p == '+' || *p == '-')
+        {
+            p++;
+        }
+        if (!is_digit(*p))
+        {
+            return false;
+        }
+        while (is_digit(*p))
+        {
+            p++;
+        }
+    }
+    return *p == '\0';
+}
+
+static bool end_number(json_stream_t *stream)
+{
+    if (!is_json_number(stream->buf))
+    {
+        return false;
+    }
+    json_stream_value_t value = {};
+    value.type = JSON_STREAM_NUMBER;
+    value.number = strtod(stream->buf, NULL);
+    emit(stream, &value);
+    value_done(stream);
+    return true;
+}
+
+static void start_literal(json_stream_t *stream, const char *literal)
+{
+    stream->literal = literal;
+    stream->literal_pos = 1;
+    stream->state = STATE_LITERAL;
+}
+
+static void end_literal(json_stream_t *stream)
+{
+    json_stream_value_t value = {};
+    if (stream->literal[0] == 'n')
+    {
+        value.type = JSON_STREAM_NULL;
+    }
+    else
+    {
+        value.type = JSON_STREAM_BOOL;
+        value.boolean = stream->literal[0] == 't';
+    }
+    emit(stream, &value);
+    value_done(stream);
+}
+
+static bool start_value(json_stream_t *stream, char c)
+{
+    switch (c)
+    {
+    case '{':
+    case '[':
+        return open_container(stream, c);
+    case '"':
+        start_string(stream, false);
+        return true;
+    case 't':
+        start_literal(stream, "true");
+        return true;
+    case 'f':
+        start_literal(stream, "false");
+        return true;
+    case 'n':
+        start_literal(stream, "null");
+        return true;
+    default:
+        if (c == '-' || is_digit(c))
+        {
+            stream->buf[0] = c;
+            stream->buf[1] = '\0';
+            stream->buf_len = 1;
+            stream->state = STATE_NUMBER;
+            return true;
+        }
+        return false;
+    }
+}
+
+// Returns false on a syntax error. Sets *consumed to false if the character ended a number
+// and has to be processed again in the next state.
+static bool step(json_stream_t *stream, char c, bool *consumed)
+{
+    *consumed = true;
+    switch (stream->state)
+    {
+    case STATE_VALUE:
+        return is_space(c) || start_value(stream, c);
+    case STATE_VALUE_OR_END:
+        if (c == ']')
+        {
+            return close_container(stream, c);
+        }
+        return is_space(c) || start_value(stream, c);
+    case STATE_KEY_OR_END:
+        if (c == '}')
+        {
+            return close_container(stream, c);
+        }
+        // fall through
+    case STATE_KEY:
+        if (c == '"')
+        {
+            start_string(stream, true);
+            return true;
+        }
+        return is_space(c);
+    case STATE_COLON:
+        if (c == ':')
+        {
+            stream->state = STATE_VALUE;
+            return true;
+        }
+        return is_space(c);
+    case STATE_AFTER_VALUE:
+        if (c == ',')
+        {
+            if (stream->containers[stream->depth - 1] == '{')
+            {
+                stream->state = STATE_KEY;
+            }
+            else
+            {
+                stream->indexes[stream->depth - 1]++;
+                stream->state = STATE_VALUE;
+            }
+            return true;
+        }
+        if (c == '}' || c == ']')
+        {
+            return close_container(stream, c);
+        }
+        return is_space(c);
+    case STATE_STRING:
+        if (c == '\\')
+        {
+            stream->state = STATE_ESCAPE;
+            return true;
+        }
+        if ((uint8_t)c < 0x20 || stream->high_surrogate != 0)
+        {
+            return false;
+        }
+        if (c == '"')
+        {
+            end_string(stream);
+        }
+        else
+        {
+            append(stream, c);
+        }
+        return true;
+    case STATE_ESCAPE:
+    {
+        static const char escapes[] = "\"\"\\\\//b\bf\fn\nr\rt\t";
+        stream->state = STATE_STRING;
+        if (c == 'u')
+        {
+            stream->unicode = 0;
+            stream->unicode_digits = 0;
+            stream->state = STATE_UNICODE;
+            return true;
+        }
+        if (stream->high_surrogate != 0)
+        {
+            return false;
+        }
+        for (size_t i = 0; i + 1 < sizeof(escapes); i += 2)
+        {
+            if (escapes[i] == c)
+            {
+                append(stream, escapes[i + 1]);
+                return true;
+            }
+        }
+        return false;
+    }
+    case STATE_UNICODE:
+    {
+        uint8_t digit;
+        if (c >= '0' && c <= '9')
+        {
+            digit = c - '0';
+        }
+        else if (c >= 'a' && c <= 'f')
+        {
+            digit = c - 'a' + 10;
+        }
+        else if (c >= 'A' && c <= 'F')
+        {
+            digit = c - 'A' + 10;
+        }
+        else
+        {
+            return false;
+        }
+        stream->unicode = (stream->unicode << 4) | digit;
+        if (++stream->unicode_digits == 4)
+        {
+            stream->state = STATE_STRING;
+            return unicode_done(stream);
+        }
+        return true;
+    }
+    case STATE_NUMBER:
+        if (is_digit(c) || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-')
+        {
+            if (stream->buf_len + 1 >= JSON_STREAM_MAX_NUMBER)
+            {
+                return false;
+            }
+            stream->buf[stream->buf_len++] = c;
+            stream->buf[stream->buf_len] = '\0';
+            return true;
+        }
+        *consumed = false;
+        return end_number(stream);
+    case STATE_LITERAL:
+        if (c != stream->literal[stream->literal_pos])
+        {
+            return false;
+        }
+        if (stream->literal[++stream->literal_pos] == '\0')
+        {
+            end_literal(stream);
+        }
+        return true;
+    case STATE_DONE:
+        return is_space(c);
+    default:
+        return false;
+    }
+}
+
+bool json_stream_feed(json_stream_t *stream, const char *data, size_t len)
+{
+    size_t i = 0;
+    while (i < len && stream->state != STATE_ERROR)
+    {
+        bool consumed;
+        if (!step(stream, data[i], &consumed))
+        {
+            stream->state = STATE_ERROR;
+            break;
+        }
+        if (consumed)
+        {
+            i++;
+        }
+    }
+    return stream->state != STATE_ERROR;
+}
+
+bool json_stream_finish(json_stream_t *stream)
+{
+    // A number at the very end of the document has nothing after it to end it
+    if (stream->state == STATE_NUMBER && stream->depth == 0 && !end_number(stream))
+    {
+        stream->state = STATE_ERROR;
+    }
+    return stream->state == STATE_DONE;
+}
@@ -0,0 +1,89 @@
+#ifndef JSON_STREAM_H
+#define JSON_STREAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Deepest nesting of objects and arrays accepted
+#define JSON_STREAM_MAX_DEPTH 8
+// Longer keys are cut off, so they don't match any known key
+#define JSON_STREAM_MAX_KEY 24
+// Longer strings are cut off and flagged as truncated, fits the longest settings field
+#define JSON_STREAM_MAX_STRING 128
+#define JSON_STREAM_MAX_NUMBER 32
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef enum json_stream_type
+    {
+        JSON_STREAM_STRING,
+        JSON_STREAM_NUMBER,
+        JSON_STREAM_BOOL,
+        JSON_STREAM_NULL,
+        JSON_STREAM_OBJECT_START,
+        JSON_STREAM_OBJECT_END,
+        JSON_STREAM_ARRAY_START,
+        JSON_STREAM_ARRAY_END
+    } json_stream_type_t;
+
+    typedef struct json_stream_value
+    {
+        json_stream_type_t type;
+        // Number of objects and arrays around the value, 0 for the root value
+        uint8_t depth;
+        // Key of the value in the enclosing object, NULL inside an array
+        const char *key;
+        // Position of the value in the enclosing array, -1 inside an object
+        int index;
+        // Only valid during the callback
+        const char *string;
+        bool truncated;
+        double number;
+        bool boolean;
+    } json_stream_value_t;
+
+    typedef struct json_stream json_stream_t;
+    typedef void (*json_stream_callback_t)(json_stream_t *stream, const json_stream_value_t *value, void *ctx);
+
+    // Pull parser that is fed the document in chunks of any size and reports every value with
+    // its key as soon as it is complete. Needs no memory beyond this struct, whatever the size
+    // of the document.
+    struct json_stream
+    {
+        json_stream_callback_t callback;
+        void *ctx;
+        uint8_t state;
+        uint8_t depth;
+        char containers[JSON_STREAM_MAX_DEPTH];
+        int indexes[JSON_STREAM_MAX_DEPTH];
+        char keys[JSON_STREAM_MAX_DEPTH][JSON_STREAM_MAX_KEY];
+        char buf[JSON_STREAM_MAX_STRING];
+        size_t buf_len;
+        bool in_key;
+        bool truncated;
+        const char *literal;
+        uint8_t literal_pos;
+        uint8_t unicode_digits;
+        uint32_t unicode;
+        uint32_t high_surrogate;
+    };
+
+    void json_stream_init(json_stream_t *stream, json_stream_callback_t callback, void *ctx);
+    // Returns false once the document is malformed, everything fed afterwards is ignored
+    bool json_stream_feed(json_stream_t *stream, const char *data, size_t len);
+    // Returns true if exactly one complete document was fed
+    bool json_stream_finish(json_stream_t *stream);
+
+    // Key of the member of an enclosing object at the given depth, for example
+    // json_stream_key(stream, 0) is the key of the root member a value is in
+    const char *json_stream_key(const json_stream_t *stream, uint8_t depth);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
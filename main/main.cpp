@@ -15,6 +15,10 @@
 #include "wifi.h"
 #include "ibbq.h"
 #include "settings.h"
+#include "boot.h"
+#include "event_log.h"
+#include "heap_stats.h"
+#include "request_arena.h"
 
 static const char *TAG = "main";
 
@@ -65,27 +69,16 @@ void print_reset_reason(esp_reset_reason_t reason)
     }
 }
 
-void app_main()
+static void mount_spiffs_task(void *arg)
 {
-    esp_reset_reason_t reset_reason = esp_reset_reason();
-    print_reset_reason(reset_reason);
-
-    esp_err_t ret = nvs_flash_init();
-    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND)
-    {
-        ESP_ERROR_CHECK(nvs_flash_erase());
-        ret = nvs_flash_init();
-    }
-    ESP_ERROR_CHECK(ret);
-    printf("Hello world!\n");
-
+    boot_phase_start(BOOT_PHASE_SPIFFS);
     esp_vfs_spiffs_conf_t conf = {
         .base_path = "/spiffs",
         .partition_label = NULL,
         .max_files = 5,
         .format_if_mount_failed = true};
 
-    ret = esp_vfs_spiffs_register(&conf);
+    esp_err_t ret = esp_vfs_spiffs_register(&conf);
 
     if (ret != ESP_OK)
     {
@@ -101,6 +94,8 @@ void app_main()
         {
             ESP_LOGE(TAG, "Failed to initialize SPIFFS (%s)", esp_err_to_name(ret));
         }
+        boot_phase_done(BOOT_PHASE_SPIFFS, ret);
+        vTaskDelete(NULL);
         return;
     }
 
@@ -114,10 +109,57 @@ void app_main()
     {
         ESP_LOGI(TAG, "Partition size: total: %d, used: %d", total, used);
     }
+    boot_phase_done(BOOT_PHASE_SPIFFS, ESP_OK);
+    vTaskDelete(NULL);
+}
 
-    system_settings_t *sys_settings = (system_settings_t *)malloc(sizeof(system_settings_t));
+static void start_ble_task(void *arg)
+{
+    network_context_t *ctx = (network_context_t *)arg;
+    boot_phase_start(BOOT_PHASE_BLE);
+    // The channel settings live in the same static state the webserver already points to
+    loadSettings(CHANNEL_SETTINGS, ctx->bbq_state);
+    ESP_LOGI(TAG, "Starting iBBQ connection");
+    init_ibbq();
+    boot_phase_done(BOOT_PHASE_BLE, ESP_OK);
+    vTaskDelete(NULL);
+}
+
+void app_main()
+{
+    boot_init();
+    heap_stats_init();
+    request_arena_init();
+    event_log_start_console();
+    esp_reset_reason_t reset_reason = esp_reset_reason();
+    print_reset_reason(reset_reason);
+
+    // NVS is needed by settings, the BT controller and the WiFi driver, so everything else waits for it
+    boot_phase_start(BOOT_PHASE_NVS);
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND)
+    {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        ret = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(ret);
+    boot_phase_done(BOOT_PHASE_NVS, ret);
+
+    // SPIFFS is only needed once the first HTTP request for a static file arrives
+    xTaskCreate(&mount_spiffs_task, "boot_spiffs", 3072, NULL, uxTaskPriorityGet(NULL), NULL);
+
+    boot_phase_start(BOOT_PHASE_SETTINGS);
+    system_settings_t *sys_settings = (system_settings_t *)heap_stats_malloc(HEAP_TAG_SETTINGS, sizeof(system_settings_t));
     loadSettings(SYSTEM_SETTINGS, sys_settings);
+    boot_phase_done(BOOT_PHASE_SETTINGS, ESP_OK);
 
     nCtx.sys_settings = sys_settings;
+    nCtx.bbq_state = get_ibbq_state();
+
+    // BLE does not depend on the WiFi association, so start scanning for the thermometer right away
+    xTaskCreate(&start_ble_task, "boot_ble", 4096, &nCtx, uxTaskPriorityGet(NULL), NULL);
+
+    boot_phase_start(BOOT_PHASE_WIFI);
     wifi_init(&nCtx);
-}
\ No newline at end of file
+    boot_phase_done(BOOT_PHASE_WIFI, ESP_OK);
+}
@@ -4,12 +4,35 @@
 
 #include "esp_log.h"
 #include "esp_timer.h"
+#include "boot.h"
+#include "event_log.h"
+#include "ibbq_sim.h"
+#include "jitter_stats.h"
+#include "sample_multicast.h"
 
-#define MOCK_REFRESH_INTERVAL 1000000
+// Simulated seconds per real second, up to 1000 to load test history and streaming
+#define MOCK_TIME_SCALE 1
+// Thermometers to simulate, the first one is shown by this gateway and every other
+// one only sends multicast datagrams as if it was another gateway
+#define MOCK_DEVICE_COUNT 1
+#define MOCK_SEED 0x1BB0
+// Faster time scales run several simulated seconds per tick instead of ticking more often
+#define MOCK_MIN_TICK_INTERVAL 10000
+#define MOCK_STEPS_PER_TICK ((MOCK_MIN_TICK_INTERVAL * MOCK_TIME_SCALE + 999999) / 1000000)
+#define MOCK_REFRESH_INTERVAL (MOCK_STEPS_PER_TICK * 1000000 / MOCK_TIME_SCALE)
+// Simulated seconds between two log lines with the achieved time scale
+#define MOCK_STATS_INTERVAL 3600
+
+static_assert(SIM_MAX_PROBES == MAX_PROBE_COUNT, "Simulator and iBBQ disagree on the probe count");
+static_assert(MOCK_DEVICE_COUNT >= 1 && MOCK_DEVICE_COUNT <= SAMPLE_MULTICAST_MAX_DEVICES, "Invalid number of simulated devices");
+static_assert(MOCK_TIME_SCALE >= 1 && MOCK_TIME_SCALE <= 1000, "Invalid time scale");
 
 static const char *TAG = "mock-ibbq";
 
-static ibbq_state ctx = {};
+static probe_config_t probe_config = {};
+static ibbq_state ctx = {&probe_config};
+static sim_device_t devices[MOCK_DEVICE_COUNT];
+static int64_t stats_start = 0;
 
 static void mock_timer_callback(void *arg);
 static esp_timer_handle_t mock_timer;
@@ -21,27 +44,92 @@ const esp_timer_create_args_t mock_timer_args = {
     .dispatch_method = ESP_TIMER_TASK,
     .name = "mock_ibbq"};
 
+// Takes the same path as the notifications of a real thermometer
+static void update_state(ibbq_state_t *bbq_state, sim_device_t *device, const uint16_t *raw_values)
+{
+    int64_t received_us = esp_timer_get_time();
+    if (!bbq_state->connected)
+    {
+        ESP_LOGI(TAG, "Simulated iBBQ connected");
+        bbq_state->connected = true;
+        boot_phase_done(BOOT_PHASE_IBBQ_CONNECTED, ESP_OK);
+    }
+    ibbq_update_probes(bbq_state, raw_values, device->config.probe_count, received_us);
+    bbq_state->probe_count = device->config.probe_count;
+    for (size_t i = 0; i < device->config.probe_count; i++)
+    {
+        event_log(EVT_PROBE_TEMP, i, bbq_state->probes.temps[i]);
+    }
+    // The real thermometer is asked for its battery once a minute
+    if (device->elapsed_s % 60 == 1)
+    {
+        bbq_state->battery_percent = device->battery_percent;
+        event_log(EVT_BATTERY_LEVEL, bbq_state->battery_percent);
+    }
+    sample_multicast_publish(raw_values, device->config.probe_count, bbq_state->battery_percent);
+#if MOCK_TIME_SCALE == 1
+    jitter_notification(received_us);
+#else
+    // Notification intervals only mean something in real time
+    jitter_record(JITTER_INGEST, esp_timer_get_time() - received_us);
+#endif
+    boot_phase_done(BOOT_PHASE_FIRST_TEMP, ESP_OK);
+}
+
 static void mock_timer_callback(void *arg)
 {
     ibbq_state_t *bbq_state = (ibbq_state_t *)arg;
-    bbq_state->connected = true;
-    bbq_state->probe_count = MAX_PROBE_COUNT;
-    bbq_state->battery_percent = 52.0f;
-    bbq_state->rssi = 12;
-
-    for (int i = 0; i < MAX_PROBE_COUNT; i++)
+    uint16_t raw_values[MAX_PROBE_COUNT];
+    for (int step = 0; step < MOCK_STEPS_PER_TICK; step++)
     {
-        bbq_state->temps[i] = i * 13;
+        if (sim_device_step(&devices[0], raw_values))
+        {
+            update_state(bbq_state, &devices[0], raw_values);
+        }
+        else if (bbq_state->connected)
+        {
+            ESP_LOGI(TAG, "Simulated iBBQ dropped out for %u s", devices[0].dropout_left_s + 1);
+            bbq_state->connected = false;
+        }
+
+        for (uint8_t i = 1; i < MOCK_DEVICE_COUNT; i++)
+        {
+            if (sim_device_step(&devices[i], raw_values))
+            {
+                sample_multicast_publish_device(i, raw_values, devices[i].config.probe_count, devices[i].battery_percent);
+            }
+        }
+
+        if (devices[0].elapsed_s % MOCK_STATS_INTERVAL == 0)
+        {
+            int64_t now = esp_timer_get_time();
+            ESP_LOGD(TAG, "Simulated %d s in %lld ms, %.1fx real time", MOCK_STATS_INTERVAL,
+                     (now - stats_start) / 1000, MOCK_STATS_INTERVAL * 1000000.0 / (now - stats_start));
+            stats_start = now;
+        }
     }
 }
 
 ibbq_state_t *init_ibbq()
 {
+    ESP_LOGI(TAG, "Starting simulator with %d devices at %dx real time", MOCK_DEVICE_COUNT, MOCK_TIME_SCALE);
+    for (uint8_t i = 0; i < MOCK_DEVICE_COUNT; i++)
+    {
+        sim_device_config_t config;
+        sim_default_config(&config, MOCK_SEED + i);
+        sim_device_init(&devices[i], &config);
+    }
+    ctx.battery_percent = devices[0].battery_percent;
+    stats_start = esp_timer_get_time();
 
-    ESP_LOGI(TAG, "Starting mock");
     ESP_ERROR_CHECK(esp_timer_create(&mock_timer_args, &mock_timer));
     ESP_ERROR_CHECK(esp_timer_start_periodic(mock_timer, MOCK_REFRESH_INTERVAL));
     return &ctx;
 }
 
-#endif
\ No newline at end of file
+ibbq_state_t *get_ibbq_state()
+{
+    return &ctx;
+}
+
+#endif
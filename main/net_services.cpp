@@ -0,0 +1,136 @@
+#include "net_services.h"
+
+#include <stdio.h>
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_event.h"
+#include "mdns.h"
+#include "sdkconfig.h"
+
+#include "webserver.h"
+#include "settings.h"
+#include "heap_stats.h"
+#include "TaskRegistry.h"
+#include "task_plan.h"
+
+static const char *TAG = "net-services";
+
+static httpd_handle_t server = NULL;
+static esp_event_loop_handle_t wifi_scan_loop = NULL;
+static bool mdns_started = false;
+
+static void initialise_mdns(void)
+{
+    system_settings_t *sys_settings = (system_settings_t *)heap_stats_malloc(HEAP_TAG_SETTINGS, sizeof(system_settings_t));
+    loadSettings(SYSTEM_SETTINGS, sys_settings);
+
+    ESP_LOGI(TAG, "Starting to announce our existence via mDNS");
+    static_assert(sizeof(sys_settings->hostname) < CONFIG_MAIN_TASK_STACK_SIZE / 2, "Configured mDNS name consumes more than half of the stack. Please select a shorter host name or extend the main stack size please.");
+    const size_t config_hostname_len = sizeof(sys_settings->hostname) - 1; // without term char
+    char hostname[config_hostname_len + 1 + 3 * 2 + 1];                    // adding underscore + 3 digits + term char
+    uint8_t mac[6];
+
+    // adding 3 LSBs from mac addr to setup a board specific name
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+    snprintf(hostname, sizeof(hostname), "%s_%02x%02X%02X", sys_settings->hostname, mac[3], mac[4], mac[5]);
+
+    //initialize mDNS
+    ESP_ERROR_CHECK(mdns_init());
+    //set mDNS hostname (required if you want to advertise services)
+    ESP_ERROR_CHECK(mdns_hostname_set(hostname));
+    ESP_LOGI(TAG, "mdns hostname set to: [%s]", hostname);
+    //set default mDNS instance name
+    ESP_ERROR_CHECK(mdns_instance_name_set(sys_settings->hostname));
+
+    //structure with TXT records
+    // TODO set usable values
+    //mdns_txt_item_t serviceTxtData[1] = {
+    //    {"board", "esp32"}};
+
+    //initialize service
+    ESP_ERROR_CHECK(mdns_service_add("ibbq-server", "_http", "_tcp", 80, NULL /*serviceTxtData*/, 0));
+    //add another TXT item
+    ESP_ERROR_CHECK(mdns_service_txt_item_set("_http", "_tcp", "path", "/"));
+    // Lets hubs tell gateways from other web servers and match them with their multicast samples
+    char device_id[13];
+    snprintf(device_id, sizeof(device_id), "%02x%02x%02x%02x%02x%02x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    ESP_ERROR_CHECK(mdns_service_txt_item_set("_http", "_tcp", "device", device_id));
+    //change TXT item value
+    //ESP_ERROR_CHECK(mdns_service_txt_item_set("_http", "_tcp", "u", "admin"));
+    heap_stats_free(sys_settings);
+}
+
+httpd_handle_t net_services_start(ibbq_state_t *state)
+{
+    if (server != NULL)
+    {
+        ESP_LOGD(TAG, "Webserver already running, keeping existing connections");
+        return server;
+    }
+
+    static httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.max_uri_handlers = 26;
+    config.stack_size = 8192;
+    config.task_priority = TASK_PRIO_HTTPD;
+    config.core_id = TASK_CORE_NET;
+
+    esp_event_loop_args_t wifi_scan_loop_args = {
+        .queue_size = 5,
+        .task_name = "wifi_scan_loop_task", // task will be created
+        .task_priority = TASK_PRIO_WIFI_SCAN,
+        .task_stack_size = 2048,
+        .task_core_id = TASK_CORE_NET};
+
+    ESP_LOGI(TAG, "Starting server on port: '%d'", config.server_port);
+    size_t free_before = esp_get_free_heap_size();
+    esp_err_t ret = httpd_start(&server, &config);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to start webserver: %s", esp_err_to_name(ret));
+        esp_restart();
+        return NULL;
+    }
+    // The server allocates its task, sockets and handler table itself
+    heap_stats_add(HEAP_TAG_HTTP, (int32_t)free_before - (int32_t)esp_get_free_heap_size());
+    TaskRegistry::add("httpd", config.stack_size);
+    register_webserver_routes(server, state);
+
+    if (wifi_scan_loop == NULL)
+    {
+        ESP_ERROR_CHECK(esp_event_loop_create(&wifi_scan_loop_args, &wifi_scan_loop));
+        TaskRegistry::addEventLoop(wifi_scan_loop, wifi_scan_loop_args.task_name, wifi_scan_loop_args.task_stack_size);
+        wifi_scan_attach(wifi_scan_loop);
+    }
+    if (!mdns_started)
+    {
+        initialise_mdns();
+        mdns_started = true;
+    }
+    return server;
+}
+
+void net_services_stop()
+{
+    if (mdns_started)
+    {
+        ESP_LOGD(TAG, "Freeing mDNS");
+        mdns_free();
+        mdns_started = false;
+    }
+    if (server != NULL)
+    {
+        ESP_LOGD(TAG, "Stopping httpd");
+        esp_err_t ret = httpd_stop(server);
+        if (ret != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to stop httpd server: %s", esp_err_to_name(ret));
+        }
+        server = NULL;
+    }
+    if (wifi_scan_loop != NULL)
+    {
+        ESP_LOGD(TAG, "Deleting WiFi scan event loop");
+        esp_event_loop_delete(wifi_scan_loop);
+        wifi_scan_loop = NULL;
+    }
+}
@@ -0,0 +1,25 @@
+#ifndef NET_SERVICES_H
+#define NET_SERVICES_H
+
+#include "esp_http_server.h"
+
+#include "ibbq.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Starts httpd with all routes, the WiFi scan loop and mDNS on the first call and returns the
+    // running server on every later one. httpd listens on the wildcard address and mDNS follows
+    // interface changes through mdns_handle_system_event, so nothing has to be restarted or rebound
+    // when WiFi reconnects or switches to access point mode.
+    httpd_handle_t net_services_start(ibbq_state_t *state);
+    // Stops all of them for a deliberate shutdown, the next start begins from scratch
+    void net_services_stop();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,237 @@
+#include "ota.h"
+
+#include <string.h>
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_ota_ops.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "cJSON.h"
+#include "ota_stream.h"
+
+// Flash writes are most efficient in multiples of the flash sector size
+#define OTA_CHUNK_SIZE 4096
+#define OTA_PROGRESS_LOG_INTERVAL (64 * 1024)
+#define OTA_RESTART_DELAY_MS 1000
+#define OTA_SHA256_HEADER "X-Firmware-SHA256"
+
+static const char *TAG = "ota";
+
+typedef struct ota_status
+{
+    bool in_progress;
+    size_t received;
+    size_t total;
+    int64_t started_us;
+    int64_t finished_us;
+    esp_err_t result;
+} ota_status_t;
+
+typedef struct ota_update
+{
+    httpd_req_t *req;
+    esp_ota_handle_t handle;
+    size_t next_progress_log;
+} ota_update_t;
+
+static ota_status_t status = {};
+
+static cJSON *serialize_status()
+{
+    cJSON *root = cJSON_CreateObject();
+    int64_t end = status.in_progress ? esp_timer_get_time() : status.finished_us;
+    int64_t duration_ms = status.started_us > 0 ? (end - status.started_us) / 1000 : 0;
+    cJSON_AddBoolToObject(root, "in_progress", status.in_progress);
+    cJSON_AddNumberToObject(root, "received", status.received);
+    cJSON_AddNumberToObject(root, "total", status.total);
+    cJSON_AddNumberToObject(root, "progress", status.total > 0 ? (100.0 * status.received) / status.total : 0);
+    cJSON_AddNumberToObject(root, "duration_ms", duration_ms);
+    cJSON_AddNumberToObject(root, "kbytes_per_s", duration_ms > 0 ? status.received / (double)duration_ms : 0);
+    cJSON_AddStringToObject(root, "result", esp_err_to_name(status.result));
+    return root;
+}
+
+static esp_err_t send_status(httpd_req_t *req, cJSON *root)
+{
+    char *jsonString = cJSON_Print(root);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, jsonString, strlen(jsonString));
+    cJSON_Delete(root);
+    cJSON_free(jsonString);
+    return ESP_OK;
+}
+
+static esp_err_t fail_update(httpd_req_t *req, const char *http_status, esp_err_t err, const char *msg)
+{
+    ESP_LOGE(TAG, "Firmware update failed: %s (%s)", msg, esp_err_to_name(err));
+    status.in_progress = false;
+    status.finished_us = esp_timer_get_time();
+    status.result = err;
+    httpd_resp_set_status(req, http_status);
+    httpd_resp_send(req, msg, strlen(msg));
+    return ESP_OK;
+}
+
+static int recv_image(void *ctx, uint8_t *buf, size_t len)
+{
+    ota_update_t *update = (ota_update_t *)ctx;
+    int ret = httpd_req_recv(update->req, (char *)buf, len);
+    return ret == HTTPD_SOCK_ERR_TIMEOUT ? OTA_STREAM_READ_TIMEOUT : ret;
+}
+
+static esp_err_t write_image(void *ctx, const uint8_t *buf, size_t len)
+{
+    ota_update_t *update = (ota_update_t *)ctx;
+    return esp_ota_write(update->handle, buf, len);
+}
+
+static void report_progress(void *ctx, size_t received, size_t total)
+{
+    ota_update_t *update = (ota_update_t *)ctx;
+    status.received = received;
+    if (received >= update->next_progress_log)
+    {
+        int64_t elapsed_ms = (esp_timer_get_time() - status.started_us) / 1000;
+        ESP_LOGI(TAG, "Received %d of %d bytes (%lld kB/s)", received, total,
+                 elapsed_ms > 0 ? (int64_t)received / elapsed_ms : 0);
+        update->next_progress_log += OTA_PROGRESS_LOG_INTERVAL;
+    }
+}
+
+static void restart_timer_callback(void *arg)
+{
+    esp_restart();
+}
+
+static esp_err_t ota_update_handler(httpd_req_t *req)
+{
+    if (status.in_progress)
+    {
+        httpd_resp_set_status(req, "409");
+        httpd_resp_send_chunk(req, NULL, 0);
+        return ESP_OK;
+    }
+
+    // An image is only flashed if it arrived as it was built, a missing hash is no exception
+    uint8_t expected_hash[OTA_SHA256_LEN];
+    char hash_hex[OTA_SHA256_LEN * 2 + 1];
+    if (httpd_req_get_hdr_value_str(req, OTA_SHA256_HEADER, hash_hex, sizeof(hash_hex)) != ESP_OK ||
+        !ota_parse_sha256(hash_hex, expected_hash))
+    {
+        const char *msg = "Missing or invalid " OTA_SHA256_HEADER " header";
+        httpd_resp_set_status(req, "400");
+        httpd_resp_send(req, msg, strlen(msg));
+        return ESP_OK;
+    }
+
+    const esp_partition_t *update_partition = esp_ota_get_next_update_partition(NULL);
+    if (update_partition == NULL)
+    {
+        return fail_update(req, "500", ESP_ERR_NOT_FOUND, "No OTA partition available");
+    }
+    if (req->content_len == 0 || req->content_len > update_partition->size)
+    {
+        return fail_update(req, "413", ESP_ERR_INVALID_SIZE, "Firmware image does not fit into OTA partition");
+    }
+
+    status = {};
+    status.in_progress = true;
+    status.total = req->content_len;
+    status.started_us = esp_timer_get_time();
+    ESP_LOGI(TAG, "Writing %d bytes firmware to partition %s at 0x%x",
+             req->content_len, update_partition->label, update_partition->address);
+
+    // Only erases as many sectors as the image needs
+    esp_ota_handle_t ota_handle;
+    esp_err_t err = esp_ota_begin(update_partition, req->content_len, &ota_handle);
+    if (err != ESP_OK)
+    {
+        return fail_update(req, "500", err, "Failed to start OTA update");
+    }
+
+    uint8_t *buf = (uint8_t *)heap_caps_malloc(OTA_CHUNK_SIZE, MALLOC_CAP_8BIT | MALLOC_CAP_32BIT);
+    if (buf == NULL)
+    {
+        esp_ota_end(ota_handle);
+        return fail_update(req, "503", ESP_ERR_NO_MEM, "Not enough memory for OTA buffer");
+    }
+
+    ota_update_t update = {req, ota_handle, OTA_PROGRESS_LOG_INTERVAL};
+    ota_stream_io_t io = {recv_image, write_image, report_progress, &update};
+    uint8_t hash[OTA_SHA256_LEN];
+    err = ota_stream_copy(&io, status.total, buf, OTA_CHUNK_SIZE, hash);
+    free(buf);
+
+    if (err != ESP_OK)
+    {
+        esp_ota_end(ota_handle);
+        return fail_update(req, "500", err, "Failed to receive or write firmware image");
+    }
+    if (memcmp(hash, expected_hash, OTA_SHA256_LEN) != 0)
+    {
+        esp_ota_end(ota_handle);
+        return fail_update(req, "400", ESP_ERR_INVALID_CRC, "SHA-256 of firmware image does not match");
+    }
+
+    err = esp_ota_end(ota_handle);
+    if (err != ESP_OK)
+    {
+        return fail_update(req, "400", err, "Firmware image is invalid");
+    }
+    err = esp_ota_set_boot_partition(update_partition);
+    if (err != ESP_OK)
+    {
+        return fail_update(req, "500", err, "Failed to switch boot partition");
+    }
+
+    status.in_progress = false;
+    status.finished_us = esp_timer_get_time();
+    status.result = ESP_OK;
+    ESP_LOGI(TAG, "Firmware update finished after %lld ms, restarting", (status.finished_us - status.started_us) / 1000);
+
+    cJSON *root = serialize_status();
+    char hash_str[OTA_SHA256_LEN * 2 + 1];
+    ota_format_sha256(hash, hash_str);
+    cJSON_AddStringToObject(root, "sha256", hash_str);
+    cJSON_AddStringToObject(root, "partition", update_partition->label);
+    send_status(req, root);
+
+    // Restart delayed, so the response still reaches the client
+    static esp_timer_handle_t restart_timer = NULL;
+    esp_timer_create_args_t restart_timer_args = {
+        .callback = &restart_timer_callback,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "ota_restart"};
+    ESP_ERROR_CHECK(esp_timer_create(&restart_timer_args, &restart_timer));
+    ESP_ERROR_CHECK(esp_timer_start_once(restart_timer, OTA_RESTART_DELAY_MS * 1000));
+    return ESP_OK;
+}
+
+// Progress and throughput of a running update, or the result of the last one
+static esp_err_t ota_status_handler(httpd_req_t *req)
+{
+    return send_status(req, serialize_status());
+}
+
+static httpd_uri_t ota_update_route = {
+    .uri = "/ota",
+    .method = HTTP_POST,
+    .handler = ota_update_handler,
+    .user_ctx = NULL};
+
+static httpd_uri_t ota_status_route = {
+    .uri = "/ota",
+    .method = HTTP_GET,
+    .handler = ota_status_handler,
+    .user_ctx = NULL};
+
+void register_ota_routes(httpd_handle_t server)
+{
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    ESP_LOGI(TAG, "Running firmware from partition %s", running->label);
+    httpd_register_uri_handler(server, &ota_update_route);
+    httpd_register_uri_handler(server, &ota_status_route);
+}
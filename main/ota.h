@@ -0,0 +1,19 @@
+#ifndef OTA_H
+#define OTA_H
+
+#include "esp_http_server.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Registers POST /ota to stream a new firmware image into the next OTA slot
+    // and GET /ota to query the progress of a running update or the result of the last one.
+    void register_ota_routes(httpd_handle_t server);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
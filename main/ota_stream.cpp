@@ -0,0 +1,99 @@
+#include "ota_stream.h"
+
+#include <string.h>
+#include <stdio.h>
+#include "mbedtls/sha256.h"
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+esp_err_t ota_stream_copy(const ota_stream_io_t *io, size_t total, uint8_t *buf, size_t chunk_size,
+                          uint8_t hash[OTA_SHA256_LEN])
+{
+    mbedtls_sha256_context sha_ctx;
+    mbedtls_sha256_init(&sha_ctx);
+    mbedtls_sha256_starts_ret(&sha_ctx, 0);
+
+    esp_err_t err = ESP_OK;
+    size_t received = 0;
+    int retries = 0;
+    while (received < total)
+    {
+        // Fill the whole chunk before writing it, so every flash write is a full aligned chunk
+        size_t filled = 0;
+        size_t wanted = MIN(chunk_size, total - received);
+        while (filled < wanted)
+        {
+            int ret = io->read(io->ctx, buf + filled, wanted - filled);
+            if (ret == OTA_STREAM_READ_TIMEOUT && retries++ < OTA_STREAM_MAX_READ_RETRIES)
+            {
+                continue;
+            }
+            if (ret <= 0)
+            {
+                err = ESP_ERR_TIMEOUT;
+                break;
+            }
+            retries = 0;
+            filled += ret;
+        }
+        if (err != ESP_OK)
+        {
+            break;
+        }
+
+        mbedtls_sha256_update_ret(&sha_ctx, buf, filled);
+        err = io->write(io->ctx, buf, filled);
+        if (err != ESP_OK)
+        {
+            break;
+        }
+        received += filled;
+        if (io->progress != NULL)
+        {
+            io->progress(io->ctx, received, total);
+        }
+    }
+
+    mbedtls_sha256_finish_ret(&sha_ctx, hash);
+    mbedtls_sha256_free(&sha_ctx);
+    return err;
+}
+
+bool ota_parse_sha256(const char *hex, uint8_t hash[OTA_SHA256_LEN])
+{
+    if (strlen(hex) != OTA_SHA256_LEN * 2)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < OTA_SHA256_LEN * 2; i++)
+    {
+        char c = hex[i];
+        uint8_t nibble;
+        if (c >= '0' && c <= '9')
+        {
+            nibble = c - '0';
+        }
+        else if (c >= 'a' && c <= 'f')
+        {
+            nibble = c - 'a' + 10;
+        }
+        else if (c >= 'A' && c <= 'F')
+        {
+            nibble = c - 'A' + 10;
+        }
+        else
+        {
+            return false;
+        }
+        hash[i / 2] = (i % 2 == 0) ? nibble << 4 : hash[i / 2] | nibble;
+    }
+    return true;
+}
+
+void ota_format_sha256(const uint8_t hash[OTA_SHA256_LEN], char *hex)
+{
+    for (size_t i = 0; i < OTA_SHA256_LEN; i++)
+    {
+        sprintf(hex + i * 2, "%02x", hash[i]);
+    }
+}
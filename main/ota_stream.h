@@ -0,0 +1,46 @@
+#ifndef OTA_STREAM_H
+#define OTA_STREAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#define OTA_SHA256_LEN 32
+// What read returns when nothing arrived in time, the copy tries again a few times
+#define OTA_STREAM_READ_TIMEOUT (-3)
+#define OTA_STREAM_MAX_READ_RETRIES 5
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Where the image comes from and goes to, httpd and the OTA partition on the device
+    typedef struct ota_stream_io
+    {
+        // Reads up to len bytes into buf. Returns the number of bytes, OTA_STREAM_READ_TIMEOUT or
+        // anything else <= 0 if the connection failed.
+        int (*read)(void *ctx, uint8_t *buf, size_t len);
+        // Writes the next chunk of the image
+        esp_err_t (*write)(void *ctx, const uint8_t *buf, size_t len);
+        // Called after every chunk that was written, may be NULL
+        void (*progress)(void *ctx, size_t received, size_t total);
+        void *ctx;
+    } ota_stream_io_t;
+
+    // Copies total bytes from read to write through buf, which holds one chunk. Every write but
+    // the last is a full chunk. The SHA-256 of what was written is stored in hash, also after an
+    // error. Returns ESP_ERR_TIMEOUT if the connection failed or the error of write.
+    esp_err_t ota_stream_copy(const ota_stream_io_t *io, size_t total, uint8_t *buf, size_t chunk_size,
+                              uint8_t hash[OTA_SHA256_LEN]);
+
+    // Parses 64 hex digits in upper or lower case, returns false for anything else
+    bool ota_parse_sha256(const char *hex, uint8_t hash[OTA_SHA256_LEN]);
+    // Formats the hash as 64 lower case hex digits and a terminating zero
+    void ota_format_sha256(const uint8_t hash[OTA_SHA256_LEN], char *hex);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
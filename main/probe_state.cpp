@@ -0,0 +1,141 @@
+#include "probe_state.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define DEFAULT_COLOR "#22B14C"
+
+static const char *entry_string(const probe_config_t *config, uint16_t offset)
+{
+    return (const char *)&config->strings[offset + 1];
+}
+
+// Reuses an identical string or appends value, cut to max_length
+static bool intern(probe_config_t *config, const char *value, size_t max_length, uint16_t *offset)
+{
+    size_t length = strnlen(value, max_length);
+    for (size_t pos = 0; pos < config->used; pos += config->strings[pos] + 2)
+    {
+        if (config->strings[pos] == length && memcmp(&config->strings[pos + 1], value, length) == 0)
+        {
+            *offset = pos;
+            return true;
+        }
+    }
+    if (config->used + length + 2 > PROBE_STRINGS_SIZE)
+    {
+        return false;
+    }
+    *offset = config->used;
+    config->strings[config->used] = length;
+    memcpy(&config->strings[config->used + 1], value, length);
+    config->strings[config->used + 1 + length] = '\0';
+    config->used += length + 2;
+    return true;
+}
+
+static bool is_entry(const probe_config_t *config, uint16_t offset)
+{
+    for (size_t pos = 0; pos < config->used; pos += config->strings[pos] + 2)
+    {
+        if (pos == offset)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void probe_hot_update(probe_hot_t *hot, const uint16_t *raw_values, size_t count, int64_t now_us)
+{
+    uint8_t alarm_active = 0;
+    for (size_t i = 0; i < count && i < MAX_PROBE_COUNT; i++)
+    {
+        float temp = raw_values[i] / 10.0f;
+        hot->temps[i] = temp;
+        // Unplugged probes are reported as 0xFFF6, they never raise an alarm
+        if (raw_values[i] <= INT16_MAX && hot->max[i] > hot->min[i] && (temp < hot->min[i] || temp > hot->max[i]))
+        {
+            alarm_active |= 1 << i;
+        }
+    }
+    hot->alarm_active = alarm_active;
+    hot->updated_us = now_us;
+}
+
+void probe_config_defaults(probe_config_t *config)
+{
+    memset(config, 0, sizeof(*config));
+    for (size_t i = 0; i < MAX_PROBE_COUNT; i++)
+    {
+        char name[16];
+        snprintf(name, sizeof(name), "Kanal %d", (int)i + 1);
+        intern(config, name, PROBE_NAME_MAX, &config->name[i]);
+        intern(config, DEFAULT_COLOR, PROBE_COLOR_MAX, &config->color[i]);
+    }
+}
+
+const char *probe_config_name(const probe_config_t *config, size_t probe)
+{
+    return probe < MAX_PROBE_COUNT ? entry_string(config, config->name[probe]) : "";
+}
+
+const char *probe_config_color(const probe_config_t *config, size_t probe)
+{
+    return probe < MAX_PROBE_COUNT ? entry_string(config, config->color[probe]) : "";
+}
+
+bool probe_config_set(probe_config_t *config, size_t probe, const char *name, const char *color)
+{
+    if (probe >= MAX_PROBE_COUNT)
+    {
+        return false;
+    }
+    // Building the strings from scratch drops those no probe uses anymore
+    probe_config_t rebuilt;
+    memset(&rebuilt, 0, sizeof(rebuilt));
+    for (size_t i = 0; i < MAX_PROBE_COUNT; i++)
+    {
+        const char *new_name = i == probe && name != NULL ? name : probe_config_name(config, i);
+        const char *new_color = i == probe && color != NULL ? color : probe_config_color(config, i);
+        if (!intern(&rebuilt, new_name, PROBE_NAME_MAX, &rebuilt.name[i]) ||
+            !intern(&rebuilt, new_color, PROBE_COLOR_MAX, &rebuilt.color[i]))
+        {
+            return false;
+        }
+    }
+    *config = rebuilt;
+    return true;
+}
+
+size_t probe_config_size(const probe_config_t *config)
+{
+    return offsetof(probe_config_t, strings) + config->used;
+}
+
+bool probe_config_valid(const probe_config_t *config, size_t size)
+{
+    if (size < offsetof(probe_config_t, strings) || size > sizeof(probe_config_t) ||
+        probe_config_size(config) != size)
+    {
+        return false;
+    }
+    size_t pos = 0;
+    while (pos < config->used)
+    {
+        size_t end = pos + config->strings[pos] + 1;
+        if (end >= config->used || config->strings[end] != '\0')
+        {
+            return false;
+        }
+        pos = end + 1;
+    }
+    for (size_t i = 0; i < MAX_PROBE_COUNT; i++)
+    {
+        if (!is_entry(config, config->name[i]) || !is_entry(config, config->color[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,70 @@
+#ifndef PROBE_STATE_H
+#define PROBE_STATE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define MAX_PROBE_COUNT 8
+// Longest name and color of a probe, without the terminating zero
+#define PROBE_NAME_MAX 127
+#define PROBE_COLOR_MAX 7
+// Names and colors of all probes together, identical strings are stored once
+#define PROBE_STRINGS_SIZE 384
+// iBBQ reports unplugged probes as 0xFFF6, anything above this is not a measurement
+#define MAX_VALID_TEMP 1000.0f
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    const uint8_t ALARM_LOCAL = 0x01;
+    const uint8_t ALARM_CLOUD = 0x02;
+    const uint8_t ALARM_IBBQ = 0x04;
+
+    // Everything a notification writes or checks, one array per field so a sample
+    // only touches a few cache lines
+    typedef struct probe_hot
+    {
+        float temps[MAX_PROBE_COUNT];
+        float min[MAX_PROBE_COUNT];
+        float max[MAX_PROBE_COUNT];
+        // ALARM_* flags, where to raise an alarm
+        uint8_t alarm[MAX_PROBE_COUNT];
+        // Bit i is set while probe i is outside of min and max, ranges with max <= min are off
+        uint8_t alarm_active;
+        // esp_timer time of the last sample
+        int64_t updated_us;
+    } probe_hot_t;
+
+    // Rarely read settings of the probes. Each string is a length byte, the characters and a
+    // terminating zero, name and color hold the offset of that length byte in strings.
+    typedef struct probe_config
+    {
+        uint16_t name[MAX_PROBE_COUNT];
+        uint16_t color[MAX_PROBE_COUNT];
+        // Bytes of strings in use, only those are persisted
+        uint16_t used;
+        uint8_t strings[PROBE_STRINGS_SIZE];
+    } probe_config_t;
+
+    // Stores raw values in tenths of a degree as they come from the thermometer
+    void probe_hot_update(probe_hot_t *hot, const uint16_t *raw_values, size_t count, int64_t now_us);
+
+    void probe_config_defaults(probe_config_t *config);
+    const char *probe_config_name(const probe_config_t *config, size_t probe);
+    const char *probe_config_color(const probe_config_t *config, size_t probe);
+    // Changes name and color of a probe, NULL keeps the current value. Longer strings are cut.
+    // Returns false and leaves the config unchanged if the strings of all probes don't fit.
+    bool probe_config_set(probe_config_t *config, size_t probe, const char *name, const char *color);
+    // Bytes of the config up to the last used string
+    size_t probe_config_size(const probe_config_t *config);
+    // Checks a config of the given size read from flash, strings must be zero after used
+    bool probe_config_valid(const probe_config_t *config, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,211 @@
+#include "radio_coex.h"
+
+#include <string.h>
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_coexist.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "heap_stats.h"
+
+// Records of a single channel, the driver drops the rest
+#define SLICE_MAX_RECORDS 16
+#define DEFER_POLL_MS 50
+
+static const char *TAG = "radio-coex";
+
+static portMUX_TYPE coex_mux = portMUX_INITIALIZER_UNLOCKED;
+static radio_coex_stats_t stats = {};
+static volatile bool ble_connecting = false;
+static int64_t last_notification_us = 0;
+// A slice is running, or the end of the last one
+static bool wifi_active = false;
+static int64_t wifi_active_end_us = 0;
+
+void radio_coex_ble_connecting(bool connecting)
+{
+    if (connecting == ble_connecting)
+    {
+        return;
+    }
+    ble_connecting = connecting;
+    if (connecting)
+    {
+        // Silence until the new connection delivers is no gap
+        portENTER_CRITICAL(&coex_mux);
+        last_notification_us = 0;
+        portEXIT_CRITICAL(&coex_mux);
+    }
+#if CONFIG_SW_COEXIST_ENABLE
+    // The configured preference favours WiFi, which lets its traffic starve the connection attempt
+    esp_coex_preference_set(connecting ? ESP_COEX_PREFER_BT : (esp_coex_prefer_t)CONFIG_SW_COEXIST_PREFERENCE_VALUE);
+#endif
+}
+
+void radio_coex_notification()
+{
+    int64_t now_us = esp_timer_get_time();
+    portENTER_CRITICAL(&coex_mux);
+    stats.notifications++;
+    if (last_notification_us > 0)
+    {
+        uint32_t gap_ms = (now_us - last_notification_us) / 1000;
+        if (gap_ms > COEX_NOTIFY_GAP_MS)
+        {
+            stats.gaps++;
+            if (wifi_active || wifi_active_end_us > last_notification_us)
+            {
+                stats.wifi_gaps++;
+            }
+        }
+        if (gap_ms > stats.max_gap_ms)
+        {
+            stats.max_gap_ms = gap_ms;
+        }
+    }
+    last_notification_us = now_us;
+    portEXIT_CRITICAL(&coex_mux);
+}
+
+static void set_wifi_active(bool active)
+{
+    portENTER_CRITICAL(&coex_mux);
+    wifi_active = active;
+    if (!active)
+    {
+        wifi_active_end_us = esp_timer_get_time();
+    }
+    portEXIT_CRITICAL(&coex_mux);
+}
+
+static void wait_for_ble()
+{
+    if (!ble_connecting)
+    {
+        return;
+    }
+    int64_t start_us = esp_timer_get_time();
+    while (ble_connecting && esp_timer_get_time() - start_us < COEX_CONNECT_DEFER_MS * 1000LL)
+    {
+        vTaskDelay(DEFER_POLL_MS / portTICK_PERIOD_MS);
+    }
+    uint32_t waited_ms = (esp_timer_get_time() - start_us) / 1000;
+    if (ble_connecting)
+    {
+        ESP_LOGW(TAG, "BLE still connecting after %u ms, scanning anyway", waited_ms);
+    }
+    portENTER_CRITICAL(&coex_mux);
+    stats.deferred_slices++;
+    stats.deferred_ms += waited_ms;
+    portEXIT_CRITICAL(&coex_mux);
+}
+
+// Keeps the strongest record per BSSID, sorted by RSSI
+static uint16_t merge_record(wifi_ap_record_t *records, uint16_t count, uint16_t max_records, const wifi_ap_record_t *found)
+{
+    uint16_t pos = count;
+    for (uint16_t i = 0; i < count; i++)
+    {
+        if (memcmp(records[i].bssid, found->bssid, sizeof(found->bssid)) == 0)
+        {
+            if (found->rssi <= records[i].rssi)
+            {
+                return count;
+            }
+            pos = i;
+            break;
+        }
+    }
+    if (pos == count)
+    {
+        if (count < max_records)
+        {
+            count++;
+        }
+        else if (found->rssi > records[count - 1].rssi)
+        {
+            pos = count - 1;
+        }
+        else
+        {
+            return count;
+        }
+    }
+    while (pos > 0 && records[pos - 1].rssi < found->rssi)
+    {
+        records[pos] = records[pos - 1];
+        pos--;
+    }
+    records[pos] = *found;
+    return count;
+}
+
+uint16_t radio_coex_scan(wifi_ap_record_t *records, uint16_t max_records)
+{
+    wifi_country_t country;
+    if (esp_wifi_get_country(&country) != ESP_OK || country.nchan == 0)
+    {
+        country.schan = 1;
+        country.nchan = 13;
+    }
+    wifi_ap_record_t *slice_records = (wifi_ap_record_t *)heap_stats_malloc(HEAP_TAG_HTTP, SLICE_MAX_RECORDS * sizeof(wifi_ap_record_t));
+    if (slice_records == NULL)
+    {
+        ESP_LOGE(TAG, "Not enough memory to scan");
+        return 0;
+    }
+
+    int64_t start_us = esp_timer_get_time();
+    uint16_t count = 0;
+    uint8_t channel;
+    for (channel = country.schan; channel < country.schan + country.nchan; channel++)
+    {
+        wait_for_ble();
+        wifi_scan_config_t config = {};
+        config.channel = channel;
+        config.scan_type = WIFI_SCAN_TYPE_PASSIVE;
+        config.scan_time.passive = COEX_SCAN_SLICE_MS;
+        set_wifi_active(true);
+        esp_err_t err = esp_wifi_scan_start(&config, true);
+        set_wifi_active(false);
+        portENTER_CRITICAL(&coex_mux);
+        stats.slices++;
+        portEXIT_CRITICAL(&coex_mux);
+        if (err != ESP_OK)
+        {
+            ESP_LOGW(TAG, "Scanning channel %d failed: %s", channel, esp_err_to_name(err));
+            if (err != ESP_ERR_WIFI_TIMEOUT)
+            {
+                break;
+            }
+        }
+        else
+        {
+            uint16_t found = SLICE_MAX_RECORDS;
+            if (esp_wifi_scan_get_ap_records(&found, slice_records) == ESP_OK)
+            {
+                for (uint16_t i = 0; i < found; i++)
+                {
+                    count = merge_record(records, count, max_records, &slice_records[i]);
+                }
+            }
+        }
+        vTaskDelay(COEX_SCAN_PAUSE_MS / portTICK_PERIOD_MS);
+    }
+    heap_stats_free(slice_records);
+
+    portENTER_CRITICAL(&coex_mux);
+    stats.scans++;
+    portEXIT_CRITICAL(&coex_mux);
+    ESP_LOGI(TAG, "Scanned %d channels in %lld ms, found %d access points",
+             channel - country.schan, (esp_timer_get_time() - start_us) / 1000, count);
+    return count;
+}
+
+void radio_coex_get_stats(radio_coex_stats_t *out)
+{
+    portENTER_CRITICAL(&coex_mux);
+    *out = stats;
+    portEXIT_CRITICAL(&coex_mux);
+}
@@ -0,0 +1,50 @@
+#ifndef RADIO_COEX_H
+#define RADIO_COEX_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "esp_wifi.h"
+
+// Passive dwell time per channel, a bit longer than the usual beacon interval of 102 ms
+#define COEX_SCAN_SLICE_MS 120
+// The radio belongs to BLE between two channels, enough for a few connection events
+#define COEX_SCAN_PAUSE_MS 200
+// Longest a scan waits for a BLE connection attempt, slightly more than its timeout
+#define COEX_CONNECT_DEFER_MS 12000
+// The iBBQ notifies every second, a longer silence counts as a gap
+#define COEX_NOTIFY_GAP_MS 2500
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef struct radio_coex_stats
+    {
+        uint32_t scans;
+        uint32_t slices;
+        // Slices that had to wait for a BLE connection attempt, and how long all of them waited
+        uint32_t deferred_slices;
+        uint32_t deferred_ms;
+        uint32_t notifications;
+        uint32_t gaps;
+        // Gaps during which WiFi scanned
+        uint32_t wifi_gaps;
+        uint32_t max_gap_ms;
+    } radio_coex_stats_t;
+
+    // Called by the iBBQ client from the start of a connection attempt until it is subscribed or gave up
+    void radio_coex_ble_connecting(bool connecting);
+    // Called for every temperature notification to detect gaps
+    void radio_coex_notification();
+    // Scans all channels of the country one at a time, handing the radio back to BLE in between.
+    // Keeps the strongest record per BSSID, sorted by RSSI, and returns the number of records.
+    uint16_t radio_coex_scan(wifi_ap_record_t *records, uint16_t max_records);
+    void radio_coex_get_stats(radio_coex_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,119 @@
+#include "request_arena.h"
+
+#include <atomic>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "cJSON.h"
+#include "heap_stats.h"
+
+// Keeps doubles in cJSON nodes aligned
+#define ARENA_ALIGNMENT 8
+
+static const char *TAG = "request-arena";
+
+static uint8_t *arena = NULL;
+static size_t arena_used = 0;
+static bool arena_exhausted = false;
+static httpd_req_t *arena_req = NULL;
+// Task serving the bound request, cJSON allocations of every other task go to the heap
+static std::atomic<TaskHandle_t> arena_owner(NULL);
+static request_arena_stats_t stats = {};
+
+static bool in_arena(void *ptr)
+{
+    return arena != NULL && (uint8_t *)ptr >= arena && (uint8_t *)ptr < arena + REQUEST_ARENA_SIZE;
+}
+
+static void *json_malloc(size_t size)
+{
+    if (arena_owner.load(std::memory_order_relaxed) == xTaskGetCurrentTaskHandle())
+    {
+        return request_arena_alloc(arena_req, size);
+    }
+    return heap_stats_malloc(HEAP_TAG_JSON, size);
+}
+
+static void json_free(void *ptr)
+{
+    // Arena blocks are all released by request_arena_end()
+    if (!in_arena(ptr))
+    {
+        heap_stats_free(ptr);
+    }
+}
+
+void request_arena_init()
+{
+    if (arena == NULL)
+    {
+        arena = (uint8_t *)heap_stats_malloc(HEAP_TAG_HTTP, REQUEST_ARENA_SIZE);
+        if (arena == NULL)
+        {
+            ESP_LOGE(TAG, "No memory for the %d byte request arena, requests will fail with 503", REQUEST_ARENA_SIZE);
+        }
+        stats.size = REQUEST_ARENA_SIZE;
+    }
+
+    cJSON_Hooks hooks = {};
+    hooks.malloc_fn = json_malloc;
+    hooks.free_fn = json_free;
+    cJSON_InitHooks(&hooks);
+}
+
+void request_arena_begin(httpd_req_t *req)
+{
+    if (arena_req != NULL)
+    {
+        ESP_LOGE(TAG, "Request arena is still bound to another request");
+    }
+    arena_req = req;
+    arena_used = 0;
+    arena_exhausted = false;
+    stats.requests++;
+    arena_owner.store(xTaskGetCurrentTaskHandle(), std::memory_order_relaxed);
+}
+
+void request_arena_end(httpd_req_t *req)
+{
+    arena_owner.store(NULL, std::memory_order_relaxed);
+    if (arena_used > stats.peak_bytes)
+    {
+        stats.peak_bytes = arena_used;
+    }
+    if (arena_exhausted)
+    {
+        stats.exhausted++;
+        ESP_LOGW(TAG, "Request %s ran out of its %d byte arena", req->uri, REQUEST_ARENA_SIZE);
+    }
+    arena_req = NULL;
+    arena_used = 0;
+}
+
+void *request_arena_alloc(httpd_req_t *req, size_t size)
+{
+    if (req != arena_req || req == NULL)
+    {
+        ESP_LOGE(TAG, "Allocation for a request the arena is not bound to");
+        return NULL;
+    }
+    size_t start = (arena_used + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    if (arena == NULL || start > REQUEST_ARENA_SIZE || size > REQUEST_ARENA_SIZE - start)
+    {
+        arena_exhausted = true;
+        return NULL;
+    }
+    arena_used = start + size;
+    return arena + start;
+}
+
+bool request_arena_exhausted(httpd_req_t *req)
+{
+    return req == arena_req && arena_exhausted;
+}
+
+void request_arena_get_stats(request_arena_stats_t *out)
+{
+    *out = stats;
+}
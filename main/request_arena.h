@@ -0,0 +1,45 @@
+#ifndef REQUEST_ARENA_H
+#define REQUEST_ARENA_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_http_server.h"
+
+// Hard cap for everything a single request may allocate
+#define REQUEST_ARENA_SIZE (12 * 1024)
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef struct request_arena_stats
+    {
+        uint32_t size;
+        uint32_t peak_bytes;
+        uint32_t requests;
+        uint32_t exhausted;
+    } request_arena_stats_t;
+
+    // Allocates the arena and routes cJSON through it. Has to run before the first
+    // cJSON allocation, blocks from plain malloc can't be freed through the hooks.
+    void request_arena_init();
+
+    // Binds the arena to a request. Only one request at a time is served by httpd,
+    // so there is a single arena. Allocations from other tasks never use it.
+    void request_arena_begin(httpd_req_t *req);
+    // Releases everything allocated for the request at once
+    void request_arena_end(httpd_req_t *req);
+
+    // Memory that stays valid until request_arena_end(), NULL once the cap is reached
+    void *request_arena_alloc(httpd_req_t *req, size_t size);
+    // True if an allocation for the request failed, the response should be a 503 then
+    bool request_arena_exhausted(httpd_req_t *req);
+
+    void request_arena_get_stats(request_arena_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
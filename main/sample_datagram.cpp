@@ -0,0 +1,92 @@
+#include "sample_datagram.h"
+
+#include <string.h>
+
+// Byte by byte, so the same code runs on the ESP32, on a PC and for unaligned datagrams
+static void put_be16(void *out, uint16_t value)
+{
+    uint8_t *p = (uint8_t *)out;
+    p[0] = value >> 8;
+    p[1] = value;
+}
+
+static void put_be32(void *out, uint32_t value)
+{
+    uint8_t *p = (uint8_t *)out;
+    p[0] = value >> 24;
+    p[1] = value >> 16;
+    p[2] = value >> 8;
+    p[3] = value;
+}
+
+static uint16_t get_be16(const void *in)
+{
+    const uint8_t *p = (const uint8_t *)in;
+    return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+static uint32_t get_be32(const void *in)
+{
+    const uint8_t *p = (const uint8_t *)in;
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+void sample_frame_set_values(sample_frame_t *frame, const uint16_t *raw_values, size_t count, float battery_percent)
+{
+    if (count > MAX_PROBE_COUNT)
+    {
+        count = MAX_PROBE_COUNT;
+    }
+    frame->probe_count = count;
+    // Converting a float out of the range of uint8_t is undefined
+    frame->battery_percent = battery_percent < 0 ? 0 : battery_percent > UINT8_MAX ? UINT8_MAX : (uint8_t)battery_percent;
+    for (size_t i = 0; i < count; i++)
+    {
+        // Unplugged probes are reported as 0xFFF6, far above anything a probe can measure
+        frame->deci_degrees[i] = raw_values[i] > INT16_MAX ? SAMPLE_NO_VALUE : raw_values[i];
+    }
+}
+
+size_t sample_datagram_encode(const sample_frame_t *frame, sample_datagram_t *datagram)
+{
+    size_t count = frame->probe_count < MAX_PROBE_COUNT ? frame->probe_count : MAX_PROBE_COUNT;
+    memset(datagram, 0, sizeof(*datagram));
+    put_be32(&datagram->magic, SAMPLE_DATAGRAM_MAGIC);
+    datagram->version = SAMPLE_DATAGRAM_VERSION;
+    datagram->probe_count = count;
+    datagram->battery_percent = frame->battery_percent;
+    put_be32(&datagram->sequence, frame->sequence);
+    put_be32(&datagram->uptime_ms, frame->uptime_ms);
+    memcpy(datagram->device_id, frame->device_id, sizeof(datagram->device_id));
+    for (size_t i = 0; i < count; i++)
+    {
+        put_be16(&datagram->deci_degrees[i], (uint16_t)frame->deci_degrees[i]);
+    }
+    return offsetof(sample_datagram_t, deci_degrees) + count * sizeof(int16_t);
+}
+
+bool sample_datagram_decode(const uint8_t *data, size_t len, sample_frame_t *frame)
+{
+    const sample_datagram_t *datagram = (const sample_datagram_t *)data;
+    size_t header_len = offsetof(sample_datagram_t, deci_degrees);
+    if (len < header_len || get_be32(&datagram->magic) != SAMPLE_DATAGRAM_MAGIC ||
+        datagram->version != SAMPLE_DATAGRAM_VERSION)
+    {
+        return false;
+    }
+    size_t count = datagram->probe_count < MAX_PROBE_COUNT ? datagram->probe_count : MAX_PROBE_COUNT;
+    if (len < header_len + count * sizeof(int16_t))
+    {
+        return false;
+    }
+    memcpy(frame->device_id, datagram->device_id, sizeof(frame->device_id));
+    frame->sequence = get_be32(&datagram->sequence);
+    frame->uptime_ms = get_be32(&datagram->uptime_ms);
+    frame->battery_percent = datagram->battery_percent;
+    frame->probe_count = count;
+    for (size_t i = 0; i < count; i++)
+    {
+        frame->deci_degrees[i] = (int16_t)get_be16(&datagram->deci_degrees[i]);
+    }
+    return true;
+}
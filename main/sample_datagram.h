@@ -0,0 +1,64 @@
+#ifndef SAMPLE_DATAGRAM_H
+#define SAMPLE_DATAGRAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "probe_state.h"
+
+#define SAMPLE_DATAGRAM_MAGIC 0x69424251 // "iBBQ"
+#define SAMPLE_DATAGRAM_VERSION 1
+// Sent for probes that are not plugged in
+#define SAMPLE_NO_VALUE INT16_MIN
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Wire layout of a datagram, all fields in network byte order. Receivers have to
+    // accept a datagram with fewer probes than MAX_PROBE_COUNT, the length is
+    // offsetof(sample_datagram_t, deci_degrees) + 2 * probe_count.
+    // tools/sample_receiver.py reads the same layout.
+    typedef struct __attribute__((packed)) sample_datagram
+    {
+        uint32_t magic;
+        uint8_t version;
+        uint8_t probe_count;
+        uint8_t battery_percent;
+        uint8_t reserved;
+        // Counts up by one per datagram, starting at 0 on boot
+        uint32_t sequence;
+        uint32_t uptime_ms;
+        // WiFi station MAC of the gateway
+        uint8_t device_id[6];
+        int16_t deci_degrees[MAX_PROBE_COUNT];
+    } sample_datagram_t;
+
+    // The content of a datagram in host byte order
+    typedef struct sample_frame
+    {
+        uint8_t device_id[6];
+        uint32_t sequence;
+        uint32_t uptime_ms;
+        uint8_t battery_percent;
+        uint8_t probe_count;
+        int16_t deci_degrees[MAX_PROBE_COUNT];
+    } sample_frame_t;
+
+    // Takes the raw iBBQ values, which are tenths of a degree Celsius, and the battery level into
+    // frame. More than MAX_PROBE_COUNT values are cut off.
+    void sample_frame_set_values(sample_frame_t *frame, const uint16_t *raw_values, size_t count,
+                                 float battery_percent);
+    // Returns the length of the datagram
+    size_t sample_datagram_encode(const sample_frame_t *frame, sample_datagram_t *datagram);
+    // Returns false for anything that is not a datagram of this version. Probes beyond
+    // MAX_PROBE_COUNT are ignored.
+    bool sample_datagram_decode(const uint8_t *data, size_t len, sample_frame_t *frame);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,79 @@
+#include "sample_multicast.h"
+
+#include <string.h>
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+
+static const char *TAG = "sample-multicast";
+
+#ifdef SAMPLE_MULTICAST
+// Only every n-th failed send is logged, a full socket buffer fails every frame
+#define SEND_FAILURE_LOG_INTERVAL 100
+
+static int sock = -1;
+static struct sockaddr_in group_addr = {};
+static uint8_t device_id[6];
+static uint32_t sequences[SAMPLE_MULTICAST_MAX_DEVICES] = {};
+static uint32_t send_failures = 0;
+#endif
+
+void sample_multicast_start()
+{
+#ifdef SAMPLE_MULTICAST
+    if (sock >= 0)
+    {
+        return;
+    }
+    sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0)
+    {
+        ESP_LOGE(TAG, "Failed to create socket: errno %d", errno);
+        return;
+    }
+    uint8_t ttl = SAMPLE_MULTICAST_TTL;
+    if (setsockopt(sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) < 0)
+    {
+        ESP_LOGW(TAG, "Failed to set multicast TTL: errno %d", errno);
+    }
+
+    group_addr.sin_family = AF_INET;
+    group_addr.sin_port = htons(SAMPLE_MULTICAST_PORT);
+    inet_aton(SAMPLE_MULTICAST_GROUP, &group_addr.sin_addr);
+    esp_read_mac(device_id, ESP_MAC_WIFI_STA);
+    ESP_LOGI(TAG, "Publishing samples to %s:%d", SAMPLE_MULTICAST_GROUP, SAMPLE_MULTICAST_PORT);
+#else
+    ESP_LOGD(TAG, "Sample multicast disabled, samples are available via GET /data");
+#endif
+}
+
+void sample_multicast_publish(const uint16_t *raw_values, size_t count, float battery_percent)
+{
+    sample_multicast_publish_device(0, raw_values, count, battery_percent);
+}
+
+void sample_multicast_publish_device(uint8_t index, const uint16_t *raw_values, size_t count, float battery_percent)
+{
+#ifdef SAMPLE_MULTICAST
+    if (sock < 0 || index >= SAMPLE_MULTICAST_MAX_DEVICES)
+    {
+        return;
+    }
+    sample_frame_t frame = {};
+    memcpy(frame.device_id, device_id, sizeof(device_id));
+    frame.device_id[5] += index;
+    frame.sequence = sequences[index]++;
+    frame.uptime_ms = esp_timer_get_time() / 1000;
+    sample_frame_set_values(&frame, raw_values, count, battery_percent);
+    sample_datagram_t datagram;
+    size_t len = sample_datagram_encode(&frame, &datagram);
+    if (sendto(sock, &datagram, len, MSG_DONTWAIT, (struct sockaddr *)&group_addr, sizeof(group_addr)) < 0)
+    {
+        if (send_failures++ % SEND_FAILURE_LOG_INTERVAL == 0)
+        {
+            ESP_LOGW(TAG, "Failed to send sample: errno %d, %u failures so far", errno, send_failures);
+        }
+    }
+#endif
+}
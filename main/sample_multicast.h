@@ -0,0 +1,40 @@
+#ifndef SAMPLE_MULTICAST_H
+#define SAMPLE_MULTICAST_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "ibbq.h"
+#include "sample_datagram.h"
+
+// Send every temperature frame of the thermometer as one UDP datagram to a multicast group,
+// laid out as in sample_datagram.h
+//#define SAMPLE_MULTICAST
+
+#define SAMPLE_MULTICAST_GROUP "239.255.66.81"
+#define SAMPLE_MULTICAST_PORT 6681
+// Datagrams never leave the local network
+#define SAMPLE_MULTICAST_TTL 1
+
+// Including the gateway itself, the others are virtual thermometers of the iBBQ simulator
+#define SAMPLE_MULTICAST_MAX_DEVICES 8
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Opens the socket once the station has an address, later calls do nothing
+    void sample_multicast_start();
+    // Sends one frame with the raw iBBQ values, which are tenths of a degree Celsius.
+    // Never blocks, a datagram that doesn't fit the socket buffer is dropped.
+    void sample_multicast_publish(const uint16_t *raw_values, size_t count, float battery_percent);
+    // Same for a virtual device, which sends as the MAC of the gateway with index added to
+    // the last byte and counts its own sequence. Index 0 is the gateway itself.
+    void sample_multicast_publish_device(uint8_t index, const uint16_t *raw_values, size_t count, float battery_percent);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,5 +1,8 @@
 #include "settings.h"
+#include <stddef.h>
+#include <string.h>
 #include "ibbq.h"
+#include "heap_stats.h"
 
 #include "esp_spiffs.h"
 #include "esp_log.h"
@@ -7,11 +10,33 @@
 #include "nvs.h"
 
 #define STORAGE_NAMESPACE "ibbq"
+#define CHANNEL_SETTINGS_VERSION 2
 
 static const char *TAG = "settings";
 
 static system_settings_t *sys_settings;
 
+// Version 1 stored every name and color at full length, it is converted when loaded
+typedef struct channel_settings_v1
+{
+    uint8_t version;
+    struct
+    {
+        float min;
+        float max;
+        char color[8];
+        uint8_t alarm;
+        char name[128];
+    } probe_configs[MAX_PROBE_COUNT];
+} channel_settings_v1_t;
+
+typedef union stored_channel_settings
+{
+    uint8_t version;
+    channel_settings_v1_t v1;
+    channel_settings_t v2;
+} stored_channel_settings_t;
+
 void writeToFile(const char *key, void *settings, size_t len)
 {
     ESP_LOGI(TAG, "Writing %d bytes to key %s", len, key);
@@ -57,24 +82,35 @@ void readFromFile(const char *key, void *settings, size_t *len)
     nvs_close(my_handle);
 }
 
-probe_data_t *defaultChannelConfig()
+void defaultChannelConfig(probe_config_t *config, probe_hot_t *limits)
 {
-    probe_data_t *pb = (probe_data_t *)malloc(sizeof(probe_data_t) * MAX_PROBE_COUNT);
     for (int i = 0; i < MAX_PROBE_COUNT; i++)
     {
-        pb[i].min = 0.0f;
-        pb[i].max = 0.0f;
-        pb[i].alarm = 0;
-        sprintf(pb[i].color, "%s", "#22B14C");
-        sprintf(pb[i].name, "Kanal %d", i + 1);
+        limits->min[i] = 0.0f;
+        limits->max[i] = 0.0f;
+        limits->alarm[i] = 0;
     }
+    probe_config_defaults(config);
+}
 
-    return pb;
+void migrateChannelConfig(const channel_settings_v1_t *v1, probe_config_t *config, probe_hot_t *limits)
+{
+    defaultChannelConfig(config, limits);
+    for (int i = 0; i < MAX_PROBE_COUNT; i++)
+    {
+        limits->min[i] = v1->probe_configs[i].min;
+        limits->max[i] = v1->probe_configs[i].max;
+        limits->alarm[i] = v1->probe_configs[i].alarm;
+        if (!probe_config_set(config, i, v1->probe_configs[i].name, v1->probe_configs[i].color))
+        {
+            ESP_LOGW(TAG, "Name and color of channel %d don't fit anymore, keeping the defaults", i + 1);
+        }
+    }
 }
 
 system_settings_t *defaultSystemSettings()
 {
-    system_settings_t *settings = (system_settings_t *)malloc(sizeof(system_settings_t));
+    system_settings_t *settings = (system_settings_t *)heap_stats_malloc(HEAP_TAG_SETTINGS, sizeof(system_settings_t));
     sprintf(settings->hostname, "%s", "iBBQ-Gateway");
     sprintf(settings->unit, "%s", "C");
     sprintf(settings->ap_name, "%s", "ibbq-ap");
@@ -90,10 +126,15 @@ void saveSettings(SETTINS_ID type, void *settings)
     {
     case CHANNEL_SETTINGS:
     {
+        ibbq_state_t *state = (ibbq_state_t *)settings;
         channel_settings_t cs = {};
-        cs.version = 1;
-        memcpy(cs.probe_configs, settings, sizeof(cs.probe_configs));
-        writeToFile("channels", (uint8_t *)&cs, sizeof(cs));
+        probe_hot_t limits;
+        cs.version = CHANNEL_SETTINGS_VERSION;
+        ibbq_get_config(state, &cs.config, &limits);
+        memcpy(cs.min, limits.min, sizeof(cs.min));
+        memcpy(cs.max, limits.max, sizeof(cs.max));
+        memcpy(cs.alarm, limits.alarm, sizeof(cs.alarm));
+        writeToFile("channels", (uint8_t *)&cs, offsetof(channel_settings_t, config) + probe_config_size(&cs.config));
         break;
     }
     case SYSTEM_SETTINGS:
@@ -110,6 +151,13 @@ void saveSettings(SETTINS_ID type, void *settings)
         writeToFile("wifi_client", settings, sizeof(wifi_client_config_t));
         break;
     }
+    case INFLUX_SETTINGS:
+    {
+        influx_settings_t *config = (influx_settings_t *)settings;
+        config->version = 1;
+        writeToFile("influx", settings, sizeof(influx_settings_t));
+        break;
+    }
     default:
     {
         ESP_LOGE(TAG, "Unknown settings value");
@@ -126,30 +174,47 @@ bool loadSettings(SETTINS_ID type, void *settings)
     {
     case CHANNEL_SETTINGS:
     {
-        channel_settings_t cs = {};
-        len = sizeof(cs);
-        readFromFile("channels", (uint8_t *)&cs, &len);
+        ibbq_state_t *state = (ibbq_state_t *)settings;
+        // Built apart and applied at once, the web server may already be reading them
+        probe_config_t config;
+        probe_hot_t limits;
+        // Zeroed, so the strings after the stored ones are zero as well
+        stored_channel_settings_t stored;
+        memset(&stored, 0, sizeof(stored));
+        len = sizeof(stored);
+        readFromFile("channels", (uint8_t *)&stored, &len);
         if (len == 0)
         {
-            probe_data_t *def_chan_conf = defaultChannelConfig();
             ESP_LOGI(TAG, "Settings never persited yet");
-            memcpy(settings, def_chan_conf, sizeof(probe_data_t) * MAX_PROBE_COUNT);
+            defaultChannelConfig(&config, &limits);
+            ibbq_set_config(state, &config, &limits);
             ESP_LOGI(TAG, "Returning default channel settings");
-            free(def_chan_conf);
             return false;
         }
 
-        if (cs.version == 1)
+        size_t header = offsetof(channel_settings_t, config);
+        if (stored.version == CHANNEL_SETTINGS_VERSION && len > header &&
+            probe_config_valid(&stored.v2.config, len - header))
+        {
+            memcpy(limits.min, stored.v2.min, sizeof(stored.v2.min));
+            memcpy(limits.max, stored.v2.max, sizeof(stored.v2.max));
+            memcpy(limits.alarm, stored.v2.alarm, sizeof(stored.v2.alarm));
+            ibbq_set_config(state, &stored.v2.config, &limits);
+            ESP_LOGI(TAG, "Loaded %d bytes of channel settings", len);
+            return true;
+        }
+        else if (stored.version == 1 && len == sizeof(channel_settings_v1_t))
         {
-            memcpy(settings, cs.probe_configs, sizeof(cs.probe_configs));
+            migrateChannelConfig(&stored.v1, &config, &limits);
+            ibbq_set_config(state, &config, &limits);
+            ESP_LOGI(TAG, "Converted channel settings from version 1");
             return true;
         }
         else
         {
-            probe_data_t *def_chan_conf = defaultChannelConfig();
-            memcpy(settings, def_chan_conf, sizeof(probe_data_t[MAX_PROBE_COUNT]));
-            ESP_LOGE(TAG, "Unknown version for channel settings: %d", cs.version);
-            free(def_chan_conf);
+            defaultChannelConfig(&config, &limits);
+            ibbq_set_config(state, &config, &limits);
+            ESP_LOGE(TAG, "Unknown version or invalid channel settings: %d", stored.version);
             return false;
         }
         break;
@@ -160,7 +225,9 @@ bool loadSettings(SETTINS_ID type, void *settings)
         readFromFile("system", (uint8_t *)settings, &len);
         if (len == 0)
         {
-            memcpy(settings, defaultSystemSettings(), sizeof(system_settings_t));
+            system_settings_t *def_sys_settings = defaultSystemSettings();
+            memcpy(settings, def_sys_settings, sizeof(system_settings_t));
+            heap_stats_free(def_sys_settings);
             return false;
         }
 
@@ -171,7 +238,9 @@ bool loadSettings(SETTINS_ID type, void *settings)
         }
         else
         {
-            memcpy(settings, defaultSystemSettings(), sizeof(system_settings_t));
+            system_settings_t *def_sys_settings = defaultSystemSettings();
+            memcpy(settings, def_sys_settings, sizeof(system_settings_t));
+            heap_stats_free(def_sys_settings);
             ESP_LOGE(TAG, "Unknown system settings version: %d", sys_settings->version);
             return false;
         }
@@ -192,6 +261,19 @@ bool loadSettings(SETTINS_ID type, void *settings)
         }
         break;
     }
+    case INFLUX_SETTINGS:
+    {
+        len = sizeof(influx_settings_t);
+        readFromFile("influx", (uint8_t *)settings, &len);
+        influx_settings_t *config = (influx_settings_t *)settings;
+        if (len == 0 || config->version != 1)
+        {
+            // Uploading stays off until a server is configured
+            memset(config, 0, sizeof(influx_settings_t));
+            return false;
+        }
+        return true;
+    }
     default:
     {
         ESP_LOGE(TAG, "Unknown settings value");
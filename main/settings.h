@@ -15,6 +15,7 @@ extern "C"
         SYSTEM_SETTINGS,
         GLOBAL_SETTINGS,
         WIFI_SETTINGS,
+        INFLUX_SETTINGS,
     };
 
     typedef struct system_settings
@@ -26,11 +27,6 @@ extern "C"
         char ap_name[32];
     } system_settings_t;
 
-    /*typedef struct global_settings
-    {
-        probe_data_t probe_configs[MAX_PROBE_COUNT];
-    } global_settings_t;*/
-
     typedef struct wifi_client_config
     {
         uint8_t version;
@@ -38,12 +34,28 @@ extern "C"
         char psk[64];
     } wifi_client_config_t;
 
+    typedef struct influx_settings
+    {
+        uint8_t version;
+        bool enabled;
+        // Full write endpoint including the database, for example http://nas:8086/write?db=bbq.
+        // precision=s is added by the uploader.
+        char url[128];
+        // Sent as "Authorization: Token <token>" if set
+        char token[96];
+    } influx_settings_t;
+
     typedef struct channel_settings
     {
         uint8_t version;
-        probe_data_t probe_configs[MAX_PROBE_COUNT];
+        float min[MAX_PROBE_COUNT];
+        float max[MAX_PROBE_COUNT];
+        uint8_t alarm[MAX_PROBE_COUNT];
+        // Stored only up to the last used string
+        probe_config_t config;
     } channel_settings_t;
 
+    // CHANNEL_SETTINGS are read from and written to an ibbq_state_t
     void saveSettings(SETTINS_ID type, void *settings);
     bool loadSettings(SETTINS_ID type, void *settings);
 
@@ -0,0 +1,42 @@
+#ifndef TASK_PLAN_H
+#define TASK_PLAN_H
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// Core and priority of every task the gateway creates, in one place so placements can be
+// compared with GET /jitter under load (tools/http_load.py).
+//
+// With TASK_PLAN_SPLIT_CORES the BLE controller, Bluedroid and the temperature pipeline run on
+// the APP core and WiFi, lwIP and everything serving clients on the PRO core. The tasks of the
+// IDF are placed by sdkconfig, keep CONFIG_BTDM_CONTROLLER_PINNED_TO_CORE and
+// CONFIG_BLUEDROID_PINNED_TO_CORE at TASK_CORE_BLE and CONFIG_TCPIP_TASK_AFFINITY at TASK_CORE_NET.
+// Without it FreeRTOS places the tasks of the gateway freely.
+#define TASK_PLAN_SPLIT_CORES
+
+#ifdef TASK_PLAN_SPLIT_CORES
+#define TASK_CORE_BLE 1
+#define TASK_CORE_NET 0
+#else
+#define TASK_CORE_BLE tskNO_AFFINITY
+#define TASK_CORE_NET tskNO_AFFINITY
+#endif
+
+// Connecting and polling the thermometer must not wait for HTTP requests
+#define TASK_PRIO_BLE_LOOP (tskIDLE_PRIORITY + 6)
+#define TASK_PRIO_BLE_REPLAY (tskIDLE_PRIORITY + 1)
+// Same as the default of esp_http_server
+#define TASK_PRIO_HTTPD (tskIDLE_PRIORITY + 5)
+#define TASK_PRIO_DNS (tskIDLE_PRIORITY + 4)
+#define TASK_PRIO_HUB (tskIDLE_PRIORITY + 2)
+// Waits seconds for mDNS answers, the hub keeps taking datagrams meanwhile
+#define TASK_PRIO_HUB_DISCOVERY (tskIDLE_PRIORITY + 1)
+// A scan takes seconds and is only waited for by the settings page
+#define TASK_PRIO_WIFI_SCAN (tskIDLE_PRIORITY + 2)
+#define TASK_PRIO_INFLUX (tskIDLE_PRIORITY + 1)
+
+#if defined(TASK_PLAN_SPLIT_CORES) && (CONFIG_BTDM_CONTROLLER_PINNED_TO_CORE != TASK_CORE_BLE || CONFIG_BLUEDROID_PINNED_TO_CORE != TASK_CORE_BLE)
+#warning "BLE tasks of the IDF are not pinned to TASK_CORE_BLE, check sdkconfig"
+#endif
+
+#endif
@@ -9,11 +9,30 @@
 #include "esp_event_loop.h"
 #include "esp_timer.h"
 #include "freertos/semphr.h"
-#include "mdns.h"
 #include "cJSON.h"
 #include <string.h>
+#include <stdarg.h>
+#include <stdlib.h>
 
 #include "settings.h"
+#include "boot.h"
+#include "event_log.h"
+#include "ota.h"
+#include "ble_capture.h"
+#include "ibbq_events.h"
+#include "FreeRTOS.h"
+#include "TaskRegistry.h"
+#include "heap_stats.h"
+#include "request_arena.h"
+#include "json_stream.h"
+#include "cbor_stream.h"
+#include "influx.h"
+#include "hub.h"
+#include "sample_multicast.h"
+#include "radio_coex.h"
+#include "jitter_stats.h"
+#include "task_plan.h"
+#include "lwip/inet.h"
 
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 #define MAX_SCAN_APS 15
@@ -24,11 +43,15 @@ ESP_EVENT_DEFINE_BASE(WIFI_SCAN_EVENT)
 static const char *TAG = "webserver";
 
 #define INDEX_FILE "/spiffs/index.html"
+#define SPIFFS_MOUNT_TIMEOUT_MS 2000
+#define LOG_CHUNK_SIZE 512
+#define LOCK_INFO_MAX 16
+#define TASK_INFO_MAX 24
+#define BODY_CHUNK_SIZE 256
+#define ACCEPT_HEADER_MAX 128
+#define ERR_MSG_HUB_DISABLED "Hub mode not enabled"
 
-#define EXAMPLE_MDNS_INSTANCE "ibbq"
-//static const char c_config_hostname[] = "ibbq";
-
-esp_event_loop_handle_t wifi_scan_loop;
+static esp_event_loop_handle_t wifi_scan_loop = NULL;
 
 TaskHandle_t scan_task_handle = NULL;
 static SemaphoreHandle_t wifi_scan_semaphore = NULL;
@@ -42,94 +65,252 @@ typedef struct wifi_scan_data
 
 static wifi_scan_data_t scanned_wifi_data = {};
 
-static cJSON *serialize_system(ibbq_state_t *bbq_state)
+// Runs a handler with the request arena bound to the request, so everything it and cJSON allocate is
+// released at once when it returns
+template <esp_err_t (*handler)(httpd_req_t *)>
+static esp_err_t arena_handler(httpd_req_t *req)
 {
-    cJSON *system = cJSON_CreateObject();
+    request_arena_begin(req);
+    esp_err_t ret = handler(req);
+    request_arena_end(req);
+    return ret;
+}
 
-    system_settings_t *sys_settings = (system_settings_t *)malloc(sizeof(system_settings_t));
-    loadSettings(SYSTEM_SETTINGS, sys_settings);
+static esp_err_t send_unavailable(httpd_req_t *req)
+{
+    httpd_resp_set_status(req, "503 Service Unavailable");
+    httpd_resp_set_hdr(req, "Retry-After", "1");
+    httpd_resp_send(req, NULL, 0);
+    return ESP_OK;
+}
+
+// Takes ownership of root. Nodes that could not be allocated are silently missing from
+// the tree, so an exhausted arena is checked before anything is sent.
+static esp_err_t send_json(httpd_req_t *req, cJSON *root)
+{
+    int64_t start = esp_timer_get_time();
+    char *jsonString = cJSON_Print(root);
+    cJSON_Delete(root);
+    if (jsonString == NULL || request_arena_exhausted(req))
+    {
+        cJSON_free(jsonString);
+        return send_unavailable(req);
+    }
+
+    size_t len = strlen(jsonString);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, jsonString, len);
+    cJSON_free(jsonString);
+    ESP_LOGD(TAG, "Sent %d bytes of JSON for %s in %lld us", len, req->uri, esp_timer_get_time() - start);
+    return ESP_OK;
+}
+
+// True if the client listed CBOR in its Accept header. A header longer than the buffer
+// is only searched as far as it was copied.
+static bool accepts_cbor(httpd_req_t *req)
+{
+    char accept[ACCEPT_HEADER_MAX];
+    esp_err_t err = httpd_req_get_hdr_value_str(req, "Accept", accept, sizeof(accept));
+    if (err != ESP_OK && err != ESP_ERR_HTTPD_RESULT_TRUNC)
+    {
+        return false;
+    }
+    return strstr(accept, "application/cbor") != NULL;
+}
+
+static bool send_cbor_chunk(const uint8_t *data, size_t len, void *ctx)
+{
+    return httpd_resp_send_chunk((httpd_req_t *)ctx, (const char *)data, len) == ESP_OK;
+}
+
+static void begin_cbor(httpd_req_t *req, cbor_stream_t *stream)
+{
+    httpd_resp_set_type(req, "application/cbor");
+    httpd_resp_set_hdr(req, "Vary", "Accept");
+    cbor_stream_init(stream, send_cbor_chunk, req);
+}
+
+// The status line is gone with the first chunk, so a failed write can only close the connection
+static esp_err_t end_cbor(httpd_req_t *req, cbor_stream_t *stream, int64_t start)
+{
+    if (!cbor_stream_finish(stream))
+    {
+        ESP_LOGW(TAG, "Sending CBOR for %s failed", req->uri);
+        return ESP_FAIL;
+    }
+    httpd_resp_send_chunk(req, NULL, 0);
+    ESP_LOGD(TAG, "Sent %d bytes of CBOR for %s in %lld us", stream->total, req->uri, esp_timer_get_time() - start);
+    return ESP_OK;
+}
+
+static void cbor_key_string(cbor_stream_t *stream, const char *key, const char *value)
+{
+    cbor_stream_string(stream, key);
+    cbor_stream_string(stream, value);
+}
+
+// Feeds the body to a streaming parser as it arrives, so memory use doesn't depend on its size.
+// Returns false if the body is malformed or the connection failed, the error response was
+// sent already then.
+static bool recv_json(httpd_req_t *req, json_stream_callback_t callback, void *ctx)
+{
+    json_stream_t *stream = (json_stream_t *)request_arena_alloc(req, sizeof(json_stream_t));
+    char *chunk = (char *)request_arena_alloc(req, BODY_CHUNK_SIZE);
+    if (stream == NULL || chunk == NULL)
+    {
+        send_unavailable(req);
+        return false;
+    }
+    json_stream_init(stream, callback, ctx);
+
+    size_t remaining = req->content_len;
+    while (remaining > 0)
+    {
+        int ret = httpd_req_recv(req, chunk, MIN(remaining, BODY_CHUNK_SIZE));
+        if (ret == HTTPD_SOCK_ERR_TIMEOUT)
+        {
+            httpd_resp_send_408(req);
+            return false;
+        }
+        if (ret <= 0)
+        {
+            return false;
+        }
+        remaining -= ret;
+        if (!json_stream_feed(stream, chunk, ret))
+        {
+            break;
+        }
+    }
+    if (!json_stream_finish(stream))
+    {
+        ESP_LOGW(TAG, "Received malformed JSON for %s", req->uri);
+        httpd_resp_set_status(req, "400");
+        httpd_resp_send_chunk(req, NULL, 0);
+        return false;
+    }
+    return true;
+}
+
+static void copy_string(char *dest, size_t size, const json_stream_value_t *value)
+{
+    if (value->type == JSON_STREAM_STRING)
+    {
+        strncpy(dest, value->string, size);
+        dest[size - 1] = '\0';
+    }
+}
+
+typedef struct system_info
+{
+    char serial[13];
+    bool ibbq_connected;
+    uint8_t ibbq_rssi;
+    float soc;
+    bool has_rssi;
+    int8_t rssi;
+    system_settings_t settings;
+} system_info_t;
+
+// Gathers what /setsystem, /data and /settings report about the gateway, shared by the JSON and CBOR encodings
+static system_info_t *load_system_info(httpd_req_t *req, ibbq_state_t *bbq_state)
+{
+    system_info_t *info = (system_info_t *)request_arena_alloc(req, sizeof(system_info_t));
+    if (info == NULL)
+    {
+        return NULL;
+    }
+    memset(info, 0, sizeof(*info));
+    loadSettings(SYSTEM_SETTINGS, &info->settings);
 
     uint8_t mac[6];
     esp_read_mac(mac, ESP_MAC_WIFI_STA);
-    char serial[12];
-    snprintf(serial, sizeof(serial), "%02X%02X%02X%02X%02X%02X", mac[5], mac[4], mac[3], mac[2], mac[1], mac[0]);
-    cJSON_AddStringToObject(system, "serial", serial);
+    snprintf(info->serial, sizeof(info->serial), "%02X%02X%02X%02X%02X%02X", mac[5], mac[4], mac[3], mac[2], mac[1], mac[0]);
     if (bbq_state)
     {
-        cJSON_AddBoolToObject(system, "ibbq_connected", bbq_state->connected);
-        cJSON_AddNumberToObject(system, "ibbq_rssi", bbq_state->rssi);
-        cJSON_AddNumberToObject(system, "soc", bbq_state->battery_percent);
-    }
-    else
-    {
-        cJSON_AddBoolToObject(system, "ibbq_connected", false);
-        cJSON_AddNumberToObject(system, "ibbq_rssi", 0);
-        cJSON_AddNumberToObject(system, "soc", 0);
+        info->ibbq_connected = bbq_state->connected;
+        info->ibbq_rssi = bbq_state->rssi;
+        info->soc = bbq_state->battery_percent;
     }
 
     wifi_ap_record_t ap_info;
     esp_err_t err = esp_wifi_sta_get_ap_info(&ap_info);
     if (err == ESP_OK)
     {
-        cJSON_AddNumberToObject(system, "rssi", ap_info.rssi);
+        info->has_rssi = true;
+        info->rssi = ap_info.rssi;
     }
     else if (err != ESP_ERR_WIFI_NOT_CONNECT)
     {
         ESP_LOGW(TAG, "Failed to retrieve WiFi info due to unknown error: %s", esp_err_to_name(err));
     }
+    return info;
+}
+
+static cJSON *serialize_system(httpd_req_t *req, ibbq_state_t *bbq_state)
+{
+    cJSON *system = cJSON_CreateObject();
+
+    system_info_t *info = load_system_info(req, bbq_state);
+    if (system == NULL || info == NULL)
+    {
+        // The caller answers with 503 as the arena is exhausted
+        return system;
+    }
 
-    cJSON_AddStringToObject(system, "unit", sys_settings->unit);
-    cJSON_AddStringToObject(system, "ap", sys_settings->ap_name);
-    cJSON_AddStringToObject(system, "language", sys_settings->lang);
+    cJSON_AddStringToObject(system, "serial", info->serial);
+    cJSON_AddBoolToObject(system, "ibbq_connected", info->ibbq_connected);
+    cJSON_AddNumberToObject(system, "ibbq_rssi", info->ibbq_rssi);
+    cJSON_AddNumberToObject(system, "soc", info->soc);
+    if (info->has_rssi)
+    {
+        cJSON_AddNumberToObject(system, "rssi", info->rssi);
+    }
+    cJSON_AddStringToObject(system, "unit", info->settings.unit);
+    cJSON_AddStringToObject(system, "ap", info->settings.ap_name);
+    cJSON_AddStringToObject(system, "language", info->settings.lang);
     cJSON_AddStringToObject(system, "hwversion", "iBBQ-Gateway dev");
-    cJSON_AddStringToObject(system, "host", sys_settings->hostname);
+    cJSON_AddStringToObject(system, "host", info->settings.hostname);
     cJSON_AddBoolToObject(system, "autoupd", false);
 
-    free(sys_settings);
-
     return system;
 }
 
-static void initialise_mdns(void)
+// Same keys as serialize_system()
+static void encode_system(cbor_stream_t *stream, const system_info_t *info)
 {
-    system_settings_t *sys_settings = (system_settings_t *)malloc(sizeof(system_settings_t));
-    loadSettings(SYSTEM_SETTINGS, sys_settings);
-
-    ESP_LOGI(TAG, "Starting to announce our existence via mDNS");
-    _Static_assert(sizeof(sys_settings->hostname) < CONFIG_MAIN_TASK_STACK_SIZE / 2, "Configured mDNS name consumes more than half of the stack. Please select a shorter host name or extend the main stack size please.");
-    const size_t config_hostname_len = sizeof(sys_settings->hostname) - 1; // without term char
-    char hostname[config_hostname_len + 1 + 3 * 2 + 1];                    // adding underscore + 3 digits + term char
-    uint8_t mac[6];
-
-    // adding 3 LSBs from mac addr to setup a board specific name
-    esp_read_mac(mac, ESP_MAC_WIFI_STA);
-    snprintf(hostname, sizeof(hostname), "%s_%02x%02X%02X", sys_settings->hostname, mac[3], mac[4], mac[5]);
-
-    //initialize mDNS
-    ESP_ERROR_CHECK(mdns_init());
-    //set mDNS hostname (required if you want to advertise services)
-    ESP_ERROR_CHECK(mdns_hostname_set(hostname));
-    ESP_LOGI(TAG, "mdns hostname set to: [%s]", hostname);
-    //set default mDNS instance name
-    ESP_ERROR_CHECK(mdns_instance_name_set(sys_settings->hostname));
-
-    //structure with TXT records
-    // TODO set usable values
-    //mdns_txt_item_t serviceTxtData[1] = {
-    //    {"board", "esp32"}};
-
-    //initialize service
-    ESP_ERROR_CHECK(mdns_service_add("ibbq-server", "_http", "_tcp", 80, NULL /*serviceTxtData*/, 0));
-    //add another TXT item
-    ESP_ERROR_CHECK(mdns_service_txt_item_set("_http", "_tcp", "path", "/"));
-    //change TXT item value
-    //ESP_ERROR_CHECK(mdns_service_txt_item_set("_http", "_tcp", "u", "admin"));
-    free(sys_settings);
+    cbor_stream_map(stream, info->has_rssi ? 11 : 10);
+    cbor_key_string(stream, "serial", info->serial);
+    cbor_stream_string(stream, "ibbq_connected");
+    cbor_stream_bool(stream, info->ibbq_connected);
+    cbor_stream_string(stream, "ibbq_rssi");
+    cbor_stream_uint(stream, info->ibbq_rssi);
+    cbor_stream_string(stream, "soc");
+    cbor_stream_float(stream, info->soc);
+    if (info->has_rssi)
+    {
+        cbor_stream_string(stream, "rssi");
+        cbor_stream_int(stream, info->rssi);
+    }
+    cbor_key_string(stream, "unit", info->settings.unit);
+    cbor_key_string(stream, "ap", info->settings.ap_name);
+    cbor_key_string(stream, "language", info->settings.lang);
+    cbor_key_string(stream, "hwversion", "iBBQ-Gateway dev");
+    cbor_key_string(stream, "host", info->settings.hostname);
+    cbor_stream_string(stream, "autoupd");
+    cbor_stream_bool(stream, false);
 }
 
 static esp_err_t file_handler(httpd_req_t *req)
 {
     const char *fileName = (const char *)req->user_ctx;
+    if (!boot_phase_wait(BOOT_PHASE_SPIFFS, pdMS_TO_TICKS(SPIFFS_MOUNT_TIMEOUT_MS)))
+    {
+        ESP_LOGW(TAG, "SPIFFS not mounted yet, can't serve %s", fileName);
+        httpd_resp_set_status(req, "503");
+        httpd_resp_send_chunk(req, NULL, 0);
+        return ESP_OK;
+    }
     FILE *f = fopen(fileName, "r");
     if (f == NULL)
     {
@@ -174,12 +355,110 @@ static httpd_uri_t fontello_route = {
     .handler = file_handler,
     .user_ctx = (char *)"/spiffs/fontello.ttf"};
 
+// Names, colors and thresholds of all channels, copied at once so a response never mixes two versions
+typedef struct channel_config
+{
+    probe_config_t config;
+    probe_hot_t limits;
+} channel_config_t;
+
+static channel_config_t *load_channel_config(httpd_req_t *req, ibbq_state_t *bbq_state)
+{
+    channel_config_t *settings = (channel_config_t *)request_arena_alloc(req, sizeof(channel_config_t));
+    if (settings != NULL)
+    {
+        ibbq_get_config(bbq_state, &settings->config, &settings->limits);
+    }
+    return settings;
+}
+
+// CBOR variant of /data. The channels are sent as one array per field instead of one object per
+// channel, so the keys are not repeated for every probe:
+// {"system": {...}, "channel": {"type": "iBBQ", "number": [1, 2], "name": [...], "temp": [...], ...}}
+static esp_err_t data_cbor_handler(httpd_req_t *req, ibbq_state_t *bbq_state)
+{
+    int64_t start = esp_timer_get_time();
+    system_info_t *info = load_system_info(req, bbq_state);
+    if (info == NULL)
+    {
+        return send_unavailable(req);
+    }
+    size_t count = bbq_state ? bbq_state->probe_count : 0;
+    channel_config_t *settings = bbq_state ? load_channel_config(req, bbq_state) : NULL;
+    if (bbq_state && settings == NULL)
+    {
+        return send_unavailable(req);
+    }
+
+    cbor_stream_t stream;
+    begin_cbor(req, &stream);
+    cbor_stream_map(&stream, 2);
+    cbor_stream_string(&stream, "system");
+    encode_system(&stream, info);
+
+    cbor_stream_string(&stream, "channel");
+    cbor_stream_map(&stream, 8);
+    cbor_key_string(&stream, "type", "iBBQ");
+    cbor_stream_string(&stream, "number");
+    cbor_stream_array(&stream, count);
+    for (size_t i = 0; i < count; i++)
+    {
+        cbor_stream_uint(&stream, i + 1);
+    }
+    cbor_stream_string(&stream, "name");
+    cbor_stream_array(&stream, count);
+    for (size_t i = 0; i < count; i++)
+    {
+        cbor_stream_string(&stream, probe_config_name(&settings->config, i));
+    }
+    cbor_stream_string(&stream, "temp");
+    cbor_stream_array(&stream, count);
+    for (size_t i = 0; i < count; i++)
+    {
+        cbor_stream_float(&stream, bbq_state->probes.temps[i]);
+    }
+    cbor_stream_string(&stream, "min");
+    cbor_stream_array(&stream, count);
+    for (size_t i = 0; i < count; i++)
+    {
+        cbor_stream_float(&stream, settings->limits.min[i]);
+    }
+    cbor_stream_string(&stream, "max");
+    cbor_stream_array(&stream, count);
+    for (size_t i = 0; i < count; i++)
+    {
+        cbor_stream_float(&stream, settings->limits.max[i]);
+    }
+    cbor_stream_string(&stream, "color");
+    cbor_stream_array(&stream, count);
+    for (size_t i = 0; i < count; i++)
+    {
+        cbor_stream_string(&stream, probe_config_color(&settings->config, i));
+    }
+    cbor_stream_string(&stream, "alarm");
+    cbor_stream_array(&stream, count);
+    for (size_t i = 0; i < count; i++)
+    {
+        cbor_stream_bool(&stream, bbq_state->probes.alarm_active & (1 << i));
+    }
+    return end_cbor(req, &stream, start);
+}
+
 static esp_err_t data_handler(httpd_req_t *req)
 {
     ibbq_state_t *bbq_state = (ibbq_state_t *)req->user_ctx;
+    if (accepts_cbor(req))
+    {
+        return data_cbor_handler(req, bbq_state);
+    }
+    channel_config_t *settings = bbq_state ? load_channel_config(req, bbq_state) : NULL;
+    if (bbq_state && settings == NULL)
+    {
+        return send_unavailable(req);
+    }
 
     cJSON *root = cJSON_CreateObject();
-    cJSON *system = serialize_system(bbq_state);
+    cJSON *system = serialize_system(req, bbq_state);
     cJSON_AddItemToObject(root, "system", system);
 
     cJSON *channels = cJSON_CreateArray();
@@ -191,34 +470,133 @@ static esp_err_t data_handler(httpd_req_t *req)
             cJSON *data = cJSON_CreateObject();
             cJSON_AddNumberToObject(data, "number", i + 1);
             cJSON_AddStringToObject(data, "type", "iBBQ");
-            cJSON_AddStringToObject(data, "name", bbq_state->probes[i].name);
-            cJSON_AddNumberToObject(data, "temp", bbq_state->temps[i]);
-            cJSON_AddNumberToObject(data, "min", bbq_state->probes[i].min);
-            cJSON_AddNumberToObject(data, "max", bbq_state->probes[i].max);
-            cJSON_AddStringToObject(data, "color", bbq_state->probes[i].color);
-            //cJSON_AddBoolToObject(data, "alarm", bbq_state->probes[i].alarmEnabled);
+            cJSON_AddStringToObject(data, "name", probe_config_name(&settings->config, i));
+            cJSON_AddNumberToObject(data, "temp", bbq_state->probes.temps[i]);
+            cJSON_AddNumberToObject(data, "min", settings->limits.min[i]);
+            cJSON_AddNumberToObject(data, "max", settings->limits.max[i]);
+            cJSON_AddStringToObject(data, "color", probe_config_color(&settings->config, i));
+            cJSON_AddBoolToObject(data, "alarm", bbq_state->probes.alarm_active & (1 << i));
 
             cJSON_AddItemToArray(channels, data);
         }
     }
 
-    char *jsonString = NULL;
-    jsonString = cJSON_Print(root);
-
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_send(req, jsonString, strlen(jsonString));
-    cJSON_Delete(root);
-    free(jsonString);
-    ESP_LOGI(TAG, "Free heap after request: %d", esp_get_free_heap_size());
-    return ESP_OK;
+    return send_json(req, root);
 }
 
 static httpd_uri_t data_route = {
     .uri = "/data",
     .method = HTTP_GET,
-    .handler = data_handler,
+    .handler = arena_handler<data_handler>,
     .user_ctx = NULL};
 
+// The fields of a channel found in a request body
+typedef struct channel_update
+{
+    char name[PROBE_NAME_MAX + 1];
+    char color[PROBE_COLOR_MAX + 1];
+    float min;
+    float max;
+    bool has_name, has_min, has_max, has_color;
+} channel_update_t;
+
+static void parse_channel_field(channel_update_t *update, const json_stream_value_t *value)
+{
+    if (strcmp(value->key, "name") == 0 && value->type == JSON_STREAM_STRING)
+    {
+        copy_string(update->name, sizeof(update->name), value);
+        update->has_name = true;
+    }
+    else if (strcmp(value->key, "min") == 0 && value->type == JSON_STREAM_NUMBER)
+    {
+        update->min = (float)value->number;
+        update->has_min = true;
+    }
+    else if (strcmp(value->key, "max") == 0 && value->type == JSON_STREAM_NUMBER)
+    {
+        update->max = (float)value->number;
+        update->has_max = true;
+    }
+    else if (strcmp(value->key, "color") == 0 && value->type == JSON_STREAM_STRING)
+    {
+        copy_string(update->color, sizeof(update->color), value);
+        update->has_color = true;
+    }
+}
+
+// Returns false if the names and colors of all channels don't fit anymore, nothing changes then
+static bool apply_channel_update(const channel_update_t *update, size_t probe, probe_hot_t *probes, probe_config_t *config)
+{
+    if ((update->has_name || update->has_color) &&
+        !probe_config_set(config, probe, update->has_name ? update->name : NULL, update->has_color ? update->color : NULL))
+    {
+        return false;
+    }
+    if (update->has_min)
+    {
+        probes->min[probe] = update->min;
+    }
+    if (update->has_max)
+    {
+        probes->max[probe] = update->max;
+    }
+    // TODO parse alarm settings
+    return true;
+}
+
+typedef struct data_set_ctx
+{
+    // Changes are applied to copies, so a body with an invalid channel changes nothing. Only the
+    // thresholds of probes are used.
+    probe_hot_t probes;
+    probe_config_t config;
+    channel_update_t channel;
+    int number;
+    bool invalid;
+} data_set_ctx_t;
+
+static void data_set_value(json_stream_t *stream, const json_stream_value_t *value, void *arg)
+{
+    data_set_ctx_t *ctx = (data_set_ctx_t *)arg;
+    const char *list = json_stream_key(stream, 0);
+    if (list == NULL || strcmp(list, "channels") != 0)
+    {
+        return;
+    }
+
+    // Every element of channels is buffered until it ends, the number may come last
+    if (value->depth == 2 && value->type == JSON_STREAM_OBJECT_START)
+    {
+        memset(&ctx->channel, 0, sizeof(ctx->channel));
+        ctx->number = -1;
+    }
+    else if (value->depth == 2 && value->type == JSON_STREAM_OBJECT_END)
+    {
+        if (ctx->number < 0 || ctx->number >= MAX_PROBE_COUNT)
+        {
+            ESP_LOGE(TAG, "Channel config does not have a valid probe number");
+            ctx->invalid = true;
+            return;
+        }
+        if (!apply_channel_update(&ctx->channel, ctx->number, &ctx->probes, &ctx->config))
+        {
+            ESP_LOGE(TAG, "Names and colors of all channels exceed %d bytes", PROBE_STRINGS_SIZE);
+            ctx->invalid = true;
+        }
+    }
+    else if (value->depth == 3 && value->key != NULL)
+    {
+        if (strcmp(value->key, "number") == 0 && value->type == JSON_STREAM_NUMBER)
+        {
+            ctx->number = (int)value->number;
+        }
+        else
+        {
+            parse_channel_field(&ctx->channel, value);
+        }
+    }
+}
+
 static esp_err_t data_set_handler(httpd_req_t *req)
 {
     ibbq_state_t *bbq_state = (ibbq_state_t *)req->user_ctx;
@@ -228,87 +606,29 @@ static esp_err_t data_set_handler(httpd_req_t *req)
         httpd_resp_send(req, ERR_MSG_BLE_NOT_STARTED, sizeof(ERR_MSG_BLE_NOT_STARTED));
         return ESP_OK;
     }
-    char buf[2048];
-    int ret, remaining = req->content_len;
 
-    if (remaining > sizeof(buf))
+    data_set_ctx_t *ctx = (data_set_ctx_t *)request_arena_alloc(req, sizeof(data_set_ctx_t));
+    if (ctx == NULL)
     {
-        ESP_LOGW(TAG, "Received request with %d bytes, which is larger than buf with %d bytes", remaining, sizeof(buf));
-        httpd_resp_set_status(req, "400");
-        httpd_resp_send_chunk(req, NULL, 0);
-        return ESP_OK;
+        return send_unavailable(req);
     }
+    memset(ctx, 0, sizeof(*ctx));
+    ibbq_get_config(bbq_state, &ctx->config, &ctx->probes);
 
-    if ((ret = httpd_req_recv(req, buf,
-                              MIN(remaining, sizeof(buf)))) <= 0)
+    if (!recv_json(req, data_set_value, ctx))
     {
-        if (ret != HTTPD_SOCK_ERR_TIMEOUT)
-        {
-            return ESP_FAIL;
-        }
+        // Closes the connection, the error response is sent already
+        return ESP_FAIL;
     }
-    ESP_LOGI(TAG, "Received settings: %s", buf);
-
-    cJSON *root = cJSON_Parse(buf);
-    if (root == NULL)
+    if (ctx->invalid)
     {
         httpd_resp_set_status(req, "400");
         httpd_resp_send_chunk(req, NULL, 0);
         return ESP_OK;
     }
 
-    cJSON *channels = cJSON_GetObjectItemCaseSensitive(root, "channels");
-    if (channels != NULL)
-    {
-
-        cJSON *channel = NULL;
-        cJSON_ArrayForEach(channel, channels)
-        {
-            int probeId = 0;
-            cJSON *probeNumber = cJSON_GetObjectItem(channel, "number");
-            if (probeNumber != NULL && cJSON_IsNumber(probeNumber))
-            {
-                probeId = probeNumber->valueint;
-            }
-            else
-            {
-                ESP_LOGE(TAG, "Channel config does not have a valid probe number");
-                httpd_resp_set_status(req, "400");
-                httpd_resp_send_chunk(req, NULL, 0);
-                cJSON_Delete(root);
-                return ESP_OK;
-            }
-            cJSON *name = cJSON_GetObjectItem(channel, "name");
-            if (cJSON_IsString(name))
-            {
-                strncpy(bbq_state->probes[probeId].name, name->valuestring, sizeof(bbq_state->probes[probeId].name));
-                bbq_state->probes[probeId].name[sizeof(bbq_state->probes[probeId].name) - 1] = '\0';
-            }
-
-            cJSON *min = cJSON_GetObjectItem(channel, "min");
-            if (cJSON_IsNumber(min))
-            {
-                bbq_state->probes[probeId].min = (float)min->valuedouble;
-            }
-
-            cJSON *max = cJSON_GetObjectItem(channel, "max");
-            if (cJSON_IsNumber(max))
-            {
-                bbq_state->probes[probeId].max = (float)max->valuedouble;
-            }
-
-            cJSON *color = cJSON_GetObjectItem(channel, "color");
-            if (cJSON_IsString(color))
-            {
-                strncpy(bbq_state->probes[probeId].color, color->valuestring, sizeof(bbq_state->probes[probeId].color));
-                bbq_state->probes[probeId].color[sizeof(bbq_state->probes[probeId].color) - 1] = '\0';
-            }
-
-            // TODO parse alarm settings
-        }
-        saveSettings(CHANNEL_SETTINGS, bbq_state->probes);
-    }
-    cJSON_Delete(root);
+    ibbq_set_config(bbq_state, &ctx->config, &ctx->probes);
+    saveSettings(CHANNEL_SETTINGS, bbq_state);
     httpd_resp_send_chunk(req, NULL, 0);
     return ESP_OK;
 }
@@ -316,74 +636,52 @@ static esp_err_t data_set_handler(httpd_req_t *req)
 static httpd_uri_t data_set_route = {
     .uri = "/data",
     .method = HTTP_POST,
-    .handler = data_set_handler,
+    .handler = arena_handler<data_set_handler>,
     .user_ctx = NULL};
 
-static esp_err_t set_system_handler(httpd_req_t *req)
+static void set_system_value(json_stream_t *stream, const json_stream_value_t *value, void *arg)
 {
-    system_settings *sys_settings = (system_settings_t *)malloc(sizeof(system_settings_t));
-    loadSettings(SYSTEM_SETTINGS, sys_settings);
-
-    char buf[2048];
-    int ret, remaining = req->content_len;
-
-    if (remaining > sizeof(buf))
+    system_settings_t *sys_settings = (system_settings_t *)arg;
+    if (value->depth != 1 || value->key == NULL)
     {
-        ESP_LOGW(TAG, "Received request with %d bytes, which is larger than buf with %d bytes", remaining, sizeof(buf));
-        httpd_resp_set_status(req, "400");
-        return ESP_OK;
+        return;
     }
 
-    if ((ret = httpd_req_recv(req, buf,
-                              MIN(remaining, sizeof(buf)))) <= 0)
+    if (strcmp(value->key, "host") == 0)
     {
-        if (ret != HTTPD_SOCK_ERR_TIMEOUT)
-        {
-            return ESP_FAIL;
-        }
+        copy_string(sys_settings->hostname, sizeof(sys_settings->hostname), value);
     }
-    ESP_LOGI(TAG, "Received system settings: %s", buf);
-
-    cJSON *root = cJSON_Parse(buf);
-    if (root == NULL)
+    else if (strcmp(value->key, "unit") == 0)
     {
-        httpd_resp_set_status(req, "400");
-        httpd_resp_send_chunk(req, NULL, 0);
-        return ESP_OK;
+        copy_string(sys_settings->unit, sizeof(sys_settings->unit), value);
     }
-
-    cJSON *host = cJSON_GetObjectItemCaseSensitive(root, "host");
-    if (host != NULL && cJSON_IsString(host))
+    else if (strcmp(value->key, "language") == 0)
     {
-        strncpy(sys_settings->hostname, host->valuestring, sizeof(sys_settings->hostname));
-        sys_settings->hostname[sizeof(sys_settings->hostname) - 1] = '\0';
+        copy_string(sys_settings->lang, sizeof(sys_settings->lang), value);
     }
-
-    cJSON *unit = cJSON_GetObjectItemCaseSensitive(root, "unit");
-    if (unit != NULL && cJSON_IsString(unit))
+    else if (strcmp(value->key, "ap_name") == 0)
     {
-        strncpy(sys_settings->unit, unit->valuestring, sizeof(sys_settings->unit));
-        sys_settings->unit[sizeof(sys_settings->unit) - 1] = '\0';
+        copy_string(sys_settings->ap_name, sizeof(sys_settings->ap_name), value);
     }
+}
 
-    cJSON *lang = cJSON_GetObjectItemCaseSensitive(root, "language");
-    if (lang != NULL && cJSON_IsString(lang))
+static esp_err_t set_system_handler(httpd_req_t *req)
+{
+    system_settings_t *sys_settings = (system_settings_t *)request_arena_alloc(req, sizeof(system_settings_t));
+    if (sys_settings == NULL)
     {
-        strncpy(sys_settings->lang, lang->valuestring, sizeof(sys_settings->lang));
-        sys_settings->lang[sizeof(sys_settings->lang) - 1] = '\0';
+        return send_unavailable(req);
     }
+    loadSettings(SYSTEM_SETTINGS, sys_settings);
 
-    cJSON *ap_name = cJSON_GetObjectItemCaseSensitive(root, "ap_name");
-    if (ap_name != NULL && cJSON_IsString(ap_name))
+    if (!recv_json(req, set_system_value, sys_settings))
     {
-        strncpy(sys_settings->ap_name, ap_name->valuestring, sizeof(sys_settings->ap_name));
-        sys_settings->ap_name[sizeof(sys_settings->ap_name) - 1] = '\0';
+        // Closes the connection, the error response is sent already
+        return ESP_FAIL;
     }
-
-    cJSON_Delete(root);
+    ESP_LOGI(TAG, "Received system settings for host %s", sys_settings->hostname);
 
     saveSettings(SYSTEM_SETTINGS, sys_settings);
-    free(sys_settings);
     httpd_resp_send_chunk(req, NULL, 0);
     return ESP_OK;
 }
@@ -391,30 +689,36 @@ static esp_err_t set_system_handler(httpd_req_t *req)
 static httpd_uri_t set_system_route = {
     .uri = "/setsystem",
     .method = HTTP_POST,
-    .handler = set_system_handler,
+    .handler = arena_handler<set_system_handler>,
     .user_ctx = NULL};
 
 static esp_err_t get_system_handler(httpd_req_t *req)
 {
     ibbq_state_t *bbq_state = (ibbq_state_t *)req->user_ctx;
+    if (accepts_cbor(req))
+    {
+        int64_t start = esp_timer_get_time();
+        system_info_t *info = load_system_info(req, bbq_state);
+        if (info == NULL)
+        {
+            return send_unavailable(req);
+        }
+        cbor_stream_t stream;
+        begin_cbor(req, &stream);
+        encode_system(&stream, info);
+        return end_cbor(req, &stream, start);
+    }
 
-    cJSON *system = serialize_system(bbq_state);
-
-    char *jsonString = cJSON_Print(system);
-
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_send(req, jsonString, strlen(jsonString));
-    cJSON_Delete(system);
-    free(jsonString);
+    cJSON *system = serialize_system(req, bbq_state);
 
-    return ESP_OK;
+    return send_json(req, system);
 }
 
 static httpd_uri_t get_system_route = {
 
     .uri = "/setsystem",
     .method = HTTP_GET,
-    .handler = set_system_handler,
+    .handler = arena_handler<get_system_handler>,
     .user_ctx = NULL};
 
 /*
@@ -439,9 +743,27 @@ static httpd_uri_t get_system_route = {
 static esp_err_t settings_get_handler(httpd_req_t *req)
 {
     ibbq_state_t *bbq_state = (ibbq_state_t *)req->user_ctx;
+    if (accepts_cbor(req))
+    {
+        int64_t start = esp_timer_get_time();
+        system_info_t *info = load_system_info(req, bbq_state);
+        if (info == NULL)
+        {
+            return send_unavailable(req);
+        }
+        cbor_stream_t stream;
+        begin_cbor(req, &stream);
+        cbor_stream_map(&stream, 2);
+        cbor_stream_string(&stream, "system");
+        encode_system(&stream, info);
+        cbor_stream_string(&stream, "sensors");
+        cbor_stream_array(&stream, 1);
+        cbor_stream_string(&stream, "iBBQ");
+        return end_cbor(req, &stream, start);
+    }
 
     cJSON *root = cJSON_CreateObject();
-    cJSON *system = serialize_system(bbq_state);
+    cJSON *system = serialize_system(req, bbq_state);
     cJSON_AddItemToObject(root, "system", system);
 
     cJSON *sensors = cJSON_CreateArray();
@@ -449,56 +771,606 @@ static esp_err_t settings_get_handler(httpd_req_t *req)
     cJSON *sensorType = cJSON_CreateString("iBBQ");
     cJSON_AddItemToArray(sensors, sensorType);
 
-    char *jsonString = NULL;
-    jsonString = cJSON_Print(root);
-
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_send(req, jsonString, strlen(jsonString));
-
-    cJSON_Delete(root);
-    ESP_LOGI(TAG, "Returning settings: %s", jsonString);
-    free(jsonString);
-
-    return ESP_OK;
+    return send_json(req, root);
 }
 
 static httpd_uri_t settings_get_route = {
     .uri = "/settings",
     .method = HTTP_GET,
-    .handler = settings_get_handler,
+    .handler = arena_handler<settings_get_handler>,
     .user_ctx = NULL};
 
-void scan_task(void *handler_args, esp_event_base_t base, int32_t id, void *event_data)
+static esp_err_t boot_timeline_handler(httpd_req_t *req)
 {
-    ESP_LOGI(TAG, "Scanning for neighbouring access points");
-    wifi_scan_data_t *ctx = (wifi_scan_data_t *)handler_args;
-    if (ctx->scanned_aps_count > 0)
-    {
-        ctx->scanned_aps_count = 0;
-    }
-    wifi_scan_config_t config = {};
-    config.scan_type = WIFI_SCAN_TYPE_ACTIVE;
-    esp_err_t err = esp_wifi_scan_start(&config, true);
-    if (err == ESP_ERR_WIFI_TIMEOUT)
-    {
-        ESP_LOGW(TAG, "WiFi timeout during scanning");
-    }
-    else if (err != ESP_OK)
-    {
-        ESP_LOGE(TAG, "Unexpected error during WiFi scanning: %s", esp_err_to_name(err));
-    }
+    const boot_phase_record_t *timeline = boot_timeline();
 
-    ESP_ERROR_CHECK(esp_wifi_scan_get_ap_num(&ctx->scanned_aps_count));
-    ESP_LOGI(TAG, "Found %d access points", ctx->scanned_aps_count);
-    ctx->scanned_aps_count = MIN(ctx->scanned_aps_count, MAX_SCAN_APS);
-    if (ctx->scanned_aps_count > 0)
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddNumberToObject(root, "uptime_ms", esp_timer_get_time() / 1000);
+    cJSON *phases = cJSON_CreateArray();
+    cJSON_AddItemToObject(root, "phases", phases);
+    for (int i = 0; i < BOOT_PHASE_COUNT; i++)
     {
-        ESP_ERROR_CHECK(esp_wifi_scan_get_ap_records(&ctx->scanned_aps_count, ctx->scanned_aps));
+        cJSON *phase = cJSON_CreateObject();
+        cJSON_AddStringToObject(phase, "name", boot_phase_name((boot_phase_t)i));
+        cJSON_AddBoolToObject(phase, "done", boot_phase_is_done((boot_phase_t)i));
+        cJSON_AddNumberToObject(phase, "started_ms", timeline[i].started_us / 1000.0);
+        cJSON_AddNumberToObject(phase, "done_ms", timeline[i].done_us / 1000.0);
+        cJSON_AddStringToObject(phase, "result", esp_err_to_name(timeline[i].result));
+        cJSON_AddItemToArray(phases, phase);
     }
-    xSemaphoreGive(wifi_scan_semaphore);
-}
 
-void initiate_wifi_scan()
+    char *jsonString = cJSON_Print(root);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, jsonString, strlen(jsonString));
+    cJSON_Delete(root);
+    cJSON_free(jsonString);
+    return ESP_OK;
+}
+
+static httpd_uri_t boot_timeline_route = {
+    .uri = "/boot",
+    .method = HTTP_GET,
+    .handler = boot_timeline_handler,
+    .user_ctx = NULL};
+
+static esp_err_t event_log_handler(httpd_req_t *req)
+{
+    char chunk[LOG_CHUNK_SIZE];
+    size_t used = 0;
+    uint32_t cursor = event_log_oldest();
+    uint32_t lost = 0;
+    event_log_record_t record;
+
+    httpd_resp_set_type(req, "text/plain");
+    while (event_log_read(&cursor, &record, &lost))
+    {
+        int len = event_log_format(&record, chunk + used, sizeof(chunk) - used);
+        if (len >= 0 && used + len >= sizeof(chunk))
+        {
+            // Line didn't fit anymore, flush and format it again at the start of the chunk
+            if (httpd_resp_send_chunk(req, chunk, used) != ESP_OK)
+            {
+                return ESP_FAIL;
+            }
+            used = 0;
+            len = event_log_format(&record, chunk, sizeof(chunk));
+        }
+        if (len > 0)
+        {
+            used += MIN((size_t)len, sizeof(chunk) - 1);
+        }
+    }
+    if (lost > 0)
+    {
+        used += snprintf(chunk + used, sizeof(chunk) - used, "%u events overwritten while reading\n", (unsigned)lost);
+        used = MIN(used, sizeof(chunk) - 1);
+    }
+    if (used > 0)
+    {
+        httpd_resp_send_chunk(req, chunk, used);
+    }
+    httpd_resp_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
+
+static httpd_uri_t event_log_route = {
+    .uri = "/log",
+    .method = HTTP_GET,
+    .handler = event_log_handler,
+    .user_ctx = NULL};
+
+static esp_err_t locks_handler(httpd_req_t *req)
+{
+    FreeRTOS::Semaphore::Info infos[LOCK_INFO_MAX];
+    size_t count = FreeRTOS::Semaphore::getAllInfo(infos, LOCK_INFO_MAX);
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddNumberToObject(root, "count", count);
+    cJSON *locks = cJSON_CreateArray();
+    cJSON_AddItemToObject(root, "locks", locks);
+    for (size_t i = 0; i < MIN(count, (size_t)LOCK_INFO_MAX); i++)
+    {
+        cJSON *lock = cJSON_CreateObject();
+        cJSON_AddStringToObject(lock, "name", infos[i].name);
+        cJSON_AddStringToObject(lock, "owner", infos[i].owner);
+        cJSON_AddNumberToObject(lock, "takes", infos[i].stats.takeCount);
+        cJSON_AddNumberToObject(lock, "contended", infos[i].stats.contentionCount);
+        cJSON_AddNumberToObject(lock, "timeouts", infos[i].stats.timeoutCount);
+        cJSON_AddNumberToObject(lock, "total_wait_us", infos[i].stats.totalWaitUs);
+        cJSON_AddNumberToObject(lock, "max_wait_us", infos[i].stats.maxWaitUs);
+        cJSON_AddItemToArray(locks, lock);
+    }
+
+    char *jsonString = cJSON_Print(root);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, jsonString, strlen(jsonString));
+    cJSON_Delete(root);
+    cJSON_free(jsonString);
+    return ESP_OK;
+}
+
+static httpd_uri_t locks_route = {
+    .uri = "/locks",
+    .method = HTTP_GET,
+    .handler = locks_handler,
+    .user_ctx = NULL};
+
+static esp_err_t tasks_handler(httpd_req_t *req)
+{
+    TaskRegistry::Info *infos = (TaskRegistry::Info *)heap_stats_malloc(HEAP_TAG_HTTP, TASK_INFO_MAX * sizeof(TaskRegistry::Info));
+    if (infos == NULL)
+    {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    size_t count = TaskRegistry::sample(infos, TASK_INFO_MAX);
+
+    cJSON *root = cJSON_CreateArray();
+    for (size_t i = 0; i < count; i++)
+    {
+        cJSON *task = cJSON_CreateObject();
+        cJSON_AddStringToObject(task, "name", infos[i].name);
+        cJSON_AddNumberToObject(task, "priority", infos[i].priority);
+        cJSON_AddNumberToObject(task, "cpu_percent", infos[i].cpuPermille / 10.0);
+        cJSON_AddNumberToObject(task, "stack_free_min", infos[i].stackFreeMin);
+        if (infos[i].stackSize > 0)
+        {
+            cJSON_AddNumberToObject(task, "stack_size", infos[i].stackSize);
+        }
+        if (infos[i].latencyCount > 0)
+        {
+            cJSON_AddNumberToObject(task, "latency_avg_us", (double)infos[i].latencyTotalUs / infos[i].latencyCount);
+            cJSON_AddNumberToObject(task, "latency_max_us", infos[i].latencyMaxUs);
+        }
+        cJSON_AddItemToArray(root, task);
+    }
+    heap_stats_free(infos);
+
+    char *jsonString = cJSON_Print(root);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, jsonString, strlen(jsonString));
+    cJSON_Delete(root);
+    cJSON_free(jsonString);
+    return ESP_OK;
+}
+
+static httpd_uri_t tasks_route = {
+    .uri = "/tasks",
+    .method = HTTP_GET,
+    .handler = tasks_handler,
+    .user_ctx = NULL};
+
+// CBOR variant of /heap with the history sent as one array per field:
+// "history": {"uptime_s": [...], "free": [...], "largest_free_block": [...], "fragmentation": [...]}
+static esp_err_t heap_cbor_handler(httpd_req_t *req, const heap_sample_t *samples, size_t sample_count, const heap_sample_t *now)
+{
+    int64_t start = esp_timer_get_time();
+    cbor_stream_t stream;
+    begin_cbor(req, &stream);
+    cbor_stream_map(&stream, 7);
+    cbor_stream_string(&stream, "free");
+    cbor_stream_uint(&stream, now->free_bytes);
+    cbor_stream_string(&stream, "min_free");
+    cbor_stream_uint(&stream, esp_get_minimum_free_heap_size());
+    cbor_stream_string(&stream, "largest_free_block");
+    cbor_stream_uint(&stream, now->largest_free_block);
+    cbor_stream_string(&stream, "fragmentation");
+    cbor_stream_float(&stream, now->fragmentation / 1000.0f);
+
+    cbor_stream_string(&stream, "tags");
+    cbor_stream_map(&stream, HEAP_TAG_COUNT);
+    for (int i = 0; i < HEAP_TAG_COUNT; i++)
+    {
+        heap_tag_stats_t stats;
+        heap_stats_get((heap_tag_t)i, &stats);
+        cbor_stream_string(&stream, heap_tag_name((heap_tag_t)i));
+        cbor_stream_map(&stream, 4);
+        cbor_stream_string(&stream, "current");
+        cbor_stream_int(&stream, stats.current_bytes);
+        cbor_stream_string(&stream, "peak");
+        cbor_stream_int(&stream, stats.peak_bytes);
+        cbor_stream_string(&stream, "allocs");
+        cbor_stream_uint(&stream, stats.allocs);
+        cbor_stream_string(&stream, "failures");
+        cbor_stream_uint(&stream, stats.failures);
+    }
+
+    request_arena_stats_t arena_stats;
+    request_arena_get_stats(&arena_stats);
+    cbor_stream_string(&stream, "request_arena");
+    cbor_stream_map(&stream, 4);
+    cbor_stream_string(&stream, "size");
+    cbor_stream_uint(&stream, arena_stats.size);
+    cbor_stream_string(&stream, "peak");
+    cbor_stream_uint(&stream, arena_stats.peak_bytes);
+    cbor_stream_string(&stream, "requests");
+    cbor_stream_uint(&stream, arena_stats.requests);
+    cbor_stream_string(&stream, "exhausted");
+    cbor_stream_uint(&stream, arena_stats.exhausted);
+
+    cbor_stream_string(&stream, "history");
+    cbor_stream_map(&stream, 4);
+    cbor_stream_string(&stream, "uptime_s");
+    cbor_stream_array(&stream, sample_count);
+    for (size_t i = 0; i < sample_count; i++)
+    {
+        cbor_stream_uint(&stream, samples[i].uptime_s);
+    }
+    cbor_stream_string(&stream, "free");
+    cbor_stream_array(&stream, sample_count);
+    for (size_t i = 0; i < sample_count; i++)
+    {
+        cbor_stream_uint(&stream, samples[i].free_bytes);
+    }
+    cbor_stream_string(&stream, "largest_free_block");
+    cbor_stream_array(&stream, sample_count);
+    for (size_t i = 0; i < sample_count; i++)
+    {
+        cbor_stream_uint(&stream, samples[i].largest_free_block);
+    }
+    cbor_stream_string(&stream, "fragmentation");
+    cbor_stream_array(&stream, sample_count);
+    for (size_t i = 0; i < sample_count; i++)
+    {
+        cbor_stream_float(&stream, samples[i].fragmentation / 1000.0f);
+    }
+    return end_cbor(req, &stream, start);
+}
+
+static esp_err_t heap_handler(httpd_req_t *req)
+{
+    heap_sample_t *samples = (heap_sample_t *)heap_stats_malloc(HEAP_TAG_HTTP, HEAP_SAMPLE_COUNT * sizeof(heap_sample_t));
+    if (samples == NULL)
+    {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    size_t sample_count = heap_stats_history(samples, HEAP_SAMPLE_COUNT);
+    heap_sample_t now = heap_stats_sample_now();
+    if (accepts_cbor(req))
+    {
+        esp_err_t ret = heap_cbor_handler(req, samples, sample_count, &now);
+        heap_stats_free(samples);
+        return ret;
+    }
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddNumberToObject(root, "free", now.free_bytes);
+    cJSON_AddNumberToObject(root, "min_free", esp_get_minimum_free_heap_size());
+    cJSON_AddNumberToObject(root, "largest_free_block", now.largest_free_block);
+    cJSON_AddNumberToObject(root, "fragmentation", now.fragmentation / 1000.0);
+
+    cJSON *tags = cJSON_CreateObject();
+    cJSON_AddItemToObject(root, "tags", tags);
+    for (int i = 0; i < HEAP_TAG_COUNT; i++)
+    {
+        heap_tag_stats_t stats;
+        heap_stats_get((heap_tag_t)i, &stats);
+        cJSON *tag = cJSON_CreateObject();
+        cJSON_AddNumberToObject(tag, "current", stats.current_bytes);
+        cJSON_AddNumberToObject(tag, "peak", stats.peak_bytes);
+        cJSON_AddNumberToObject(tag, "allocs", stats.allocs);
+        cJSON_AddNumberToObject(tag, "failures", stats.failures);
+        cJSON_AddItemToObject(tags, heap_tag_name((heap_tag_t)i), tag);
+    }
+
+    request_arena_stats_t arena_stats;
+    request_arena_get_stats(&arena_stats);
+    cJSON *arena = cJSON_CreateObject();
+    cJSON_AddItemToObject(root, "request_arena", arena);
+    cJSON_AddNumberToObject(arena, "size", arena_stats.size);
+    cJSON_AddNumberToObject(arena, "peak", arena_stats.peak_bytes);
+    cJSON_AddNumberToObject(arena, "requests", arena_stats.requests);
+    cJSON_AddNumberToObject(arena, "exhausted", arena_stats.exhausted);
+
+    cJSON *history = cJSON_CreateArray();
+    cJSON_AddItemToObject(root, "history", history);
+    for (size_t i = 0; i < sample_count; i++)
+    {
+        cJSON *sample = cJSON_CreateObject();
+        cJSON_AddNumberToObject(sample, "uptime_s", samples[i].uptime_s);
+        cJSON_AddNumberToObject(sample, "free", samples[i].free_bytes);
+        cJSON_AddNumberToObject(sample, "largest_free_block", samples[i].largest_free_block);
+        cJSON_AddNumberToObject(sample, "fragmentation", samples[i].fragmentation / 1000.0);
+        cJSON_AddItemToArray(history, sample);
+    }
+    heap_stats_free(samples);
+
+    char *jsonString = cJSON_PrintUnformatted(root);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, jsonString, strlen(jsonString));
+    cJSON_Delete(root);
+    cJSON_free(jsonString);
+    return ESP_OK;
+}
+
+static httpd_uri_t heap_route = {
+    .uri = "/heap",
+    .method = HTTP_GET,
+    .handler = heap_handler,
+    .user_ctx = NULL};
+
+static esp_err_t influx_get_handler(httpd_req_t *req)
+{
+    influx_settings_t *influx_settings = (influx_settings_t *)request_arena_alloc(req, sizeof(influx_settings_t));
+    if (influx_settings == NULL)
+    {
+        return send_unavailable(req);
+    }
+    loadSettings(INFLUX_SETTINGS, influx_settings);
+    influx_stats_t stats;
+    influx_get_stats(&stats);
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddBoolToObject(root, "enabled", influx_settings->enabled);
+    cJSON_AddStringToObject(root, "url", influx_settings->url);
+    // The token itself is never sent back
+    cJSON_AddBoolToObject(root, "has_token", influx_settings->token[0] != '\0');
+    cJSON_AddBoolToObject(root, "running", stats.enabled);
+    cJSON_AddNumberToObject(root, "points_sent", stats.points_sent);
+    cJSON_AddNumberToObject(root, "points_dropped", stats.points_dropped);
+    cJSON_AddNumberToObject(root, "requests", stats.requests);
+    cJSON_AddNumberToObject(root, "failures", stats.failures);
+    cJSON_AddNumberToObject(root, "bytes_per_point", stats.points_sent > 0 ? (double)stats.bytes_sent / stats.points_sent : 0);
+    cJSON_AddNumberToObject(root, "pending_batches", stats.pending_batches);
+    cJSON_AddNumberToObject(root, "last_status", stats.last_status);
+    cJSON_AddNumberToObject(root, "backoff_ms", stats.backoff_ms);
+    return send_json(req, root);
+}
+
+static httpd_uri_t influx_get_route = {
+    .uri = "/influx",
+    .method = HTTP_GET,
+    .handler = arena_handler<influx_get_handler>,
+    .user_ctx = NULL};
+
+static void influx_set_value(json_stream_t *stream, const json_stream_value_t *value, void *arg)
+{
+    influx_settings_t *influx_settings = (influx_settings_t *)arg;
+    if (value->depth != 1 || value->key == NULL)
+    {
+        return;
+    }
+
+    if (strcmp(value->key, "enabled") == 0 && value->type == JSON_STREAM_BOOL)
+    {
+        influx_settings->enabled = value->boolean;
+    }
+    else if (strcmp(value->key, "url") == 0)
+    {
+        copy_string(influx_settings->url, sizeof(influx_settings->url), value);
+    }
+    else if (strcmp(value->key, "token") == 0)
+    {
+        copy_string(influx_settings->token, sizeof(influx_settings->token), value);
+    }
+}
+
+static esp_err_t influx_set_handler(httpd_req_t *req)
+{
+    influx_settings_t *influx_settings = (influx_settings_t *)request_arena_alloc(req, sizeof(influx_settings_t));
+    if (influx_settings == NULL)
+    {
+        return send_unavailable(req);
+    }
+    loadSettings(INFLUX_SETTINGS, influx_settings);
+
+    if (!recv_json(req, influx_set_value, influx_settings))
+    {
+        // Closes the connection, the error response is sent already
+        return ESP_FAIL;
+    }
+
+    saveSettings(INFLUX_SETTINGS, influx_settings);
+    influx_reload();
+    httpd_resp_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
+
+static httpd_uri_t influx_set_route = {
+    .uri = "/influx",
+    .method = HTTP_POST,
+    .handler = arena_handler<influx_set_handler>,
+    .user_ctx = NULL};
+
+// Collects formatted text and sends it in chunks, for responses too large to build in memory
+typedef struct chunk_writer
+{
+    httpd_req_t *req;
+    char buf[LOG_CHUNK_SIZE];
+    size_t used;
+    bool failed;
+} chunk_writer_t;
+
+static void chunk_flush(chunk_writer_t *writer)
+{
+    if (writer->used > 0 && !writer->failed)
+    {
+        writer->failed = httpd_resp_send_chunk(writer->req, writer->buf, writer->used) != ESP_OK;
+    }
+    writer->used = 0;
+}
+
+static void chunk_printf(chunk_writer_t *writer, const char *format, ...)
+{
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+        va_list args;
+        va_start(args, format);
+        int len = vsnprintf(writer->buf + writer->used, sizeof(writer->buf) - writer->used, format, args);
+        va_end(args);
+        if (len >= 0 && writer->used + len < sizeof(writer->buf))
+        {
+            writer->used += len;
+            return;
+        }
+        // Didn't fit anymore, flush and format it again at the start of the buffer
+        chunk_flush(writer);
+    }
+    ESP_LOGW(TAG, "Dropped output longer than %d bytes", LOG_CHUNK_SIZE);
+}
+
+static void format_device_id(const uint8_t *device_id, char *out, size_t len)
+{
+    snprintf(out, len, "%02x:%02x:%02x:%02x:%02x:%02x",
+             device_id[0], device_id[1], device_id[2], device_id[3], device_id[4], device_id[5]);
+}
+
+// Escapes a string for a JSON string literal, cutting it off where the next character doesn't fit
+static void escape_json(const char *value, char *out, size_t len)
+{
+    size_t pos = 0;
+    for (; *value != '\0'; value++)
+    {
+        char c = *value;
+        char escaped[7];
+        if (c == '"' || c == '\\')
+        {
+            snprintf(escaped, sizeof(escaped), "\\%c", c);
+        }
+        else if ((uint8_t)c < 0x20)
+        {
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+        }
+        else
+        {
+            escaped[0] = c;
+            escaped[1] = '\0';
+        }
+        size_t escaped_len = strlen(escaped);
+        if (pos + escaped_len >= len)
+        {
+            break;
+        }
+        memcpy(out + pos, escaped, escaped_len);
+        pos += escaped_len;
+    }
+    out[pos] = '\0';
+}
+
+static void print_deci_degrees(chunk_writer_t *writer, int16_t value)
+{
+    if (value == SAMPLE_NO_VALUE)
+    {
+        chunk_printf(writer, "null");
+    }
+    else
+    {
+        chunk_printf(writer, "%s%d.%d", value < 0 ? "-" : "", abs(value / 10), abs(value % 10));
+    }
+}
+
+/*
+{
+    "sources": [{"device": "", "host": "", "ip": "", "local": bool, "stale": bool, "battery": int, "age_ms": int,
+                 "lag_ms": int, "max_lag_ms": int, "received": int, "lost": int, "reordered": int}],
+    "channel": [{"source": "", "number": int, "temp": float or null}],
+    "history": {"interval_s": int, "<device>": [[probe 1 temps oldest first], [probe 2 temps], ...]}
+}
+*/
+static esp_err_t hub_handler(httpd_req_t *req)
+{
+    hub_source_t *source = (hub_source_t *)request_arena_alloc(req, sizeof(hub_source_t));
+    chunk_writer_t *writer = (chunk_writer_t *)request_arena_alloc(req, sizeof(chunk_writer_t));
+    if (source == NULL || writer == NULL)
+    {
+        return send_unavailable(req);
+    }
+    if (!hub_get_source(0, source))
+    {
+        httpd_resp_set_status(req, "404");
+        httpd_resp_send(req, ERR_MSG_HUB_DISABLED, sizeof(ERR_MSG_HUB_DISABLED));
+        return ESP_OK;
+    }
+    memset(writer, 0, sizeof(*writer));
+    writer->req = req;
+    httpd_resp_set_type(req, "application/json");
+
+    // Every section walks the sources again, so only one copy is held at a time
+    chunk_printf(writer, "{\"sources\":[");
+    for (size_t i = 0; hub_get_source(i, source); i++)
+    {
+        char ip[16];
+        inet_ntoa_r(source->ip, ip, sizeof(ip));
+        char device[18];
+        format_device_id(source->device_id, device, sizeof(device));
+        // The host name comes from the mDNS answer of the other gateway
+        char host[2 * sizeof(source->host)];
+        escape_json(source->host, host, sizeof(host));
+        chunk_printf(writer, "%s{\"device\":\"%s\",\"host\":\"%s\",\"ip\":\"%s\",\"local\":%s,\"stale\":%s,"
+                             "\"battery\":%d,\"age_ms\":%u,\"lag_ms\":%u,\"max_lag_ms\":%u,"
+                             "\"received\":%u,\"lost\":%u,\"reordered\":%u}",
+                     i > 0 ? "," : "", device, host, source->local ? "" : ip,
+                     source->local ? "true" : "false", source->age_ms > HUB_STALE_MS ? "true" : "false",
+                     source->battery_percent, source->age_ms, source->lag_ms, source->max_lag_ms,
+                     source->received, source->lost, source->reordered);
+    }
+
+    chunk_printf(writer, "],\"channel\":[");
+    bool first = true;
+    for (size_t i = 0; hub_get_source(i, source); i++)
+    {
+        char device[18];
+        format_device_id(source->device_id, device, sizeof(device));
+        for (size_t j = 0; j < source->probe_count; j++)
+        {
+            chunk_printf(writer, "%s{\"source\":\"%s\",\"number\":%d,\"temp\":", first ? "" : ",", device, (int)j + 1);
+            print_deci_degrees(writer, source->deci_degrees[j]);
+            chunk_printf(writer, "}");
+            first = false;
+        }
+    }
+
+    chunk_printf(writer, "],\"history\":{\"interval_s\":%d", HUB_HISTORY_INTERVAL_MS / 1000);
+    for (size_t i = 0; hub_get_source(i, source); i++)
+    {
+        char device[18];
+        format_device_id(source->device_id, device, sizeof(device));
+        chunk_printf(writer, ",\"%s\":[", device);
+        for (size_t j = 0; j < source->probe_count; j++)
+        {
+            chunk_printf(writer, "%s[", j > 0 ? "," : "");
+            for (size_t k = 0; k < source->history_count; k++)
+            {
+                chunk_printf(writer, "%s", k > 0 ? "," : "");
+                print_deci_degrees(writer, source->history[k][j]);
+            }
+            chunk_printf(writer, "]");
+        }
+        chunk_printf(writer, "]");
+    }
+    chunk_printf(writer, "}}");
+    chunk_flush(writer);
+    if (writer->failed)
+    {
+        return ESP_FAIL;
+    }
+    httpd_resp_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
+
+static httpd_uri_t hub_route = {
+    .uri = "/hub",
+    .method = HTTP_GET,
+    .handler = arena_handler<hub_handler>,
+    .user_ctx = NULL};
+
+void scan_task(void *handler_args, esp_event_base_t base, int32_t id, void *event_data)
+{
+    ESP_LOGI(TAG, "Scanning for neighbouring access points");
+    wifi_scan_data_t *ctx = (wifi_scan_data_t *)handler_args;
+    // Held for the whole scan, so the list isn't read while it is filled
+    xSemaphoreTake(wifi_scan_semaphore, portMAX_DELAY);
+    // One channel at a time, a blocking scan of all channels stalls the BLE connection for seconds
+    ctx->scanned_aps_count = radio_coex_scan(ctx->scanned_aps, MAX_SCAN_APS);
+    xSemaphoreGive(wifi_scan_semaphore);
+}
+
+void initiate_wifi_scan()
 {
     if (xSemaphoreTake(wifi_scan_semaphore, (TickType_t)10))
     {
@@ -519,6 +1391,99 @@ static esp_err_t networkscan_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
+static esp_err_t coex_handler(httpd_req_t *req)
+{
+    radio_coex_stats_t stats;
+    radio_coex_get_stats(&stats);
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddNumberToObject(root, "scans", stats.scans);
+    cJSON_AddNumberToObject(root, "slices", stats.slices);
+    cJSON_AddNumberToObject(root, "deferred_slices", stats.deferred_slices);
+    cJSON_AddNumberToObject(root, "deferred_ms", stats.deferred_ms);
+    cJSON_AddNumberToObject(root, "notifications", stats.notifications);
+    cJSON_AddNumberToObject(root, "gaps", stats.gaps);
+    cJSON_AddNumberToObject(root, "wifi_gaps", stats.wifi_gaps);
+    cJSON_AddNumberToObject(root, "max_gap_ms", stats.max_gap_ms);
+    return send_json(req, root);
+}
+
+static esp_err_t jitter_handler(httpd_req_t *req)
+{
+    cJSON *root = cJSON_CreateObject();
+#ifdef TASK_PLAN_SPLIT_CORES
+    cJSON_AddBoolToObject(root, "split_cores", true);
+#else
+    cJSON_AddBoolToObject(root, "split_cores", false);
+#endif
+    cJSON *metrics = cJSON_CreateArray();
+    cJSON_AddItemToObject(root, "metrics", metrics);
+    for (int i = 0; i < JITTER_COUNT; i++)
+    {
+        jitter_histogram_t histogram;
+        jitter_get((jitter_metric_t)i, &histogram);
+        cJSON *metric = cJSON_CreateObject();
+        cJSON_AddStringToObject(metric, "name", jitter_metric_name((jitter_metric_t)i));
+        cJSON_AddNumberToObject(metric, "count", histogram.count);
+        cJSON_AddNumberToObject(metric, "avg_us", histogram.count > 0 ? histogram.total_us / histogram.count : 0);
+        cJSON_AddNumberToObject(metric, "p50_us", jitter_percentile(&histogram, 50));
+        cJSON_AddNumberToObject(metric, "p99_us", jitter_percentile(&histogram, 99));
+        cJSON_AddNumberToObject(metric, "max_us", histogram.max_us);
+        // Bucket i counts values below 2^i us
+        cJSON *buckets = cJSON_CreateArray();
+        cJSON_AddItemToObject(metric, "buckets", buckets);
+        for (int j = 0; j < JITTER_BUCKETS; j++)
+        {
+            cJSON_AddItemToArray(buckets, cJSON_CreateNumber(histogram.buckets[j]));
+        }
+        cJSON_AddItemToArray(metrics, metric);
+    }
+#ifndef MOCK_IBBQ
+    ibbq_event_stats_t event_stats;
+    ibbq_get_event_stats(&event_stats);
+    cJSON *events = cJSON_CreateObject();
+    cJSON_AddItemToObject(root, "ble_events", events);
+    cJSON_AddNumberToObject(events, "handled", event_stats.handled);
+    cJSON_AddNumberToObject(events, "max_queued", event_stats.max_queued);
+    cJSON_AddNumberToObject(events, "queue_size", IBBQ_EVENT_QUEUE_SIZE);
+    cJSON *types = cJSON_CreateArray();
+    cJSON_AddItemToObject(events, "types", types);
+    for (int i = 0; i < IBBQ_EVENT_COUNT; i++)
+    {
+        cJSON *type = cJSON_CreateObject();
+        cJSON_AddStringToObject(type, "name", ibbq_event_name((ibbq_event_type_t)i));
+        cJSON_AddNumberToObject(type, "posted", event_stats.posted[i]);
+        cJSON_AddNumberToObject(type, "dropped", event_stats.dropped[i]);
+        cJSON_AddItemToArray(types, type);
+    }
+#endif
+
+    // ?reset=1 starts a new measurement, e.g. before generating load
+    char query[16];
+    char reset[4] = "";
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK)
+    {
+        httpd_query_key_value(query, "reset", reset, sizeof(reset));
+    }
+    if (strcmp(reset, "1") == 0)
+    {
+        jitter_reset();
+    }
+    return send_json(req, root);
+}
+
+static httpd_uri_t jitter_route = {
+    .uri = "/jitter",
+    .method = HTTP_GET,
+    .handler = arena_handler<jitter_handler>,
+    .user_ctx = NULL};
+
+static httpd_uri_t coex_route = {
+    .uri = "/coex",
+    .method = HTTP_GET,
+    .handler = arena_handler<coex_handler>,
+    .user_ctx = NULL};
+
 static httpd_uri_t networkscan_route = {
     .uri = "/networkscan",
     .method = HTTP_GET,
@@ -552,77 +1517,57 @@ static esp_err_t networklist_handler(httpd_req_t *req)
         // TODO add encryption info
         cJSON_AddItemToArray(scan, ap);
     }
-    char *jsonString = NULL;
-    jsonString = cJSON_Print(root);
-
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_send(req, jsonString, strlen(jsonString));
-
-    cJSON_Delete(root);
+    esp_err_t ret = send_json(req, root);
     if (semaphore_taken)
     {
         ESP_LOGI(TAG, "Releasing semaphore for WiFi scan after listing available WiFis");
         xSemaphoreGive(wifi_scan_semaphore);
     }
-    return ESP_OK;
+    return ret;
 }
 
 static httpd_uri_t networklist_route = {
     .uri = "/networklist",
     .method = HTTP_GET,
-    .handler = networklist_handler,
+    .handler = arena_handler<networklist_handler>,
     .user_ctx = NULL};
 
-static esp_err_t setnetwork_handler(httpd_req_t *req)
+static void setnetwork_value(json_stream_t *stream, const json_stream_value_t *value, void *arg)
 {
-    char buf[1024];
-    int ret, remaining = req->content_len;
-
-    if (remaining > sizeof(buf))
+    wifi_client_config_t *wifi_config = (wifi_client_config_t *)arg;
+    if (value->depth != 1 || value->key == NULL)
     {
-        ESP_LOGW(TAG, "Received request with %d bytes, which is larger than buf with %d bytes", remaining, sizeof(buf));
-        httpd_resp_set_status(req, "400");
-        return ESP_OK;
+        return;
     }
 
-    if ((ret = httpd_req_recv(req, buf,
-                              MIN(remaining, sizeof(buf)))) <= 0)
+    if (strcmp(value->key, "ssid") == 0)
     {
-        if (ret != HTTPD_SOCK_ERR_TIMEOUT)
-        {
-            return ESP_FAIL;
-        }
+        copy_string(wifi_config->ssid, sizeof(wifi_config->ssid), value);
     }
-
-    cJSON *root = cJSON_Parse(buf);
-    if (root == NULL)
+    else if (strcmp(value->key, "password") == 0)
     {
-        httpd_resp_set_status(req, "400");
-        httpd_resp_send_chunk(req, NULL, 0);
-        return ESP_OK;
+        copy_string(wifi_config->psk, sizeof(wifi_config->psk), value);
     }
+}
 
-    wifi_client_config_t *wifi_config = (wifi_client_config_t *)malloc(sizeof(wifi_client_config_t));
-    loadSettings(WIFI_SETTINGS, wifi_config);
-
-    cJSON *ssid = cJSON_GetObjectItemCaseSensitive(root, "ssid");
-    if (ssid != NULL && cJSON_IsString(ssid))
+static esp_err_t setnetwork_handler(httpd_req_t *req)
+{
+    wifi_client_config_t *wifi_config = (wifi_client_config_t *)request_arena_alloc(req, sizeof(wifi_client_config_t));
+    if (wifi_config == NULL)
     {
-        strncpy(wifi_config->ssid, ssid->valuestring, 32);
-        wifi_config->ssid[31] = '\0';
+        return send_unavailable(req);
     }
-    cJSON *password = cJSON_GetObjectItemCaseSensitive(root, "password");
-    if (password != NULL && cJSON_IsString(password))
+    loadSettings(WIFI_SETTINGS, wifi_config);
+
+    if (!recv_json(req, setnetwork_value, wifi_config))
     {
-        strncpy(wifi_config->psk, password->valuestring, 64);
-        wifi_config->ssid[63] = '\0';
+        // Closes the connection, the error response is sent already
+        return ESP_FAIL;
     }
 
     saveSettings(WIFI_SETTINGS, wifi_config);
     // TODO apply these settings
     httpd_resp_send_chunk(req, NULL, 0);
-    cJSON_Delete(root);
-    free(wifi_config);
     esp_restart();
     return ESP_OK;
 }
@@ -630,9 +1575,36 @@ static esp_err_t setnetwork_handler(httpd_req_t *req)
 static httpd_uri_t setnetwork_route{
     .uri = "/setnetwork",
     .method = HTTP_POST,
-    .handler = setnetwork_handler,
+    .handler = arena_handler<setnetwork_handler>,
     .user_ctx = NULL};
 
+typedef struct setchannels_ctx
+{
+    // Copies like in data_set_ctx_t, applied once the update fits
+    probe_hot_t probes;
+    probe_config_t config;
+    channel_update_t channel;
+    int number;
+} setchannels_ctx_t;
+
+static void setchannels_value(json_stream_t *stream, const json_stream_value_t *value, void *arg)
+{
+    setchannels_ctx_t *ctx = (setchannels_ctx_t *)arg;
+    if (value->depth != 1 || value->key == NULL)
+    {
+        return;
+    }
+
+    if (strcmp(value->key, "number") == 0 && value->type == JSON_STREAM_NUMBER)
+    {
+        ctx->number = (int)value->number;
+    }
+    else
+    {
+        parse_channel_field(&ctx->channel, value);
+    }
+}
+
 static esp_err_t setchannels_handler(httpd_req_t *req)
 {
     ibbq_state_t *bbq_state = (ibbq_state_t *)req->user_ctx;
@@ -643,86 +1615,45 @@ static esp_err_t setchannels_handler(httpd_req_t *req)
         return ESP_OK;
     }
 
-    char buf[1024];
-    int ret, remaining = req->content_len;
-
-    if (remaining > sizeof(buf))
+    setchannels_ctx_t *ctx = (setchannels_ctx_t *)request_arena_alloc(req, sizeof(setchannels_ctx_t));
+    if (ctx == NULL)
     {
-        ESP_LOGW(TAG, "Received request with %d bytes, which is larger than buf with %d bytes", remaining, sizeof(buf));
-        httpd_resp_set_status(req, "400");
-        return ESP_OK;
+        return send_unavailable(req);
     }
+    memset(ctx, 0, sizeof(*ctx));
 
-    if ((ret = httpd_req_recv(req, buf,
-                              MIN(remaining, sizeof(buf)))) <= 0)
+    if (!recv_json(req, setchannels_value, ctx))
     {
-        if (ret != HTTPD_SOCK_ERR_TIMEOUT)
-        {
-            return ESP_FAIL;
-        }
+        // Closes the connection, the error response is sent already
+        return ESP_FAIL;
     }
-    ESP_LOGI(TAG, "Received channel config: %s", buf);
-    cJSON *root = cJSON_Parse(buf);
-    if (root == NULL)
+
+    // Channel numbers start at 1
+    if (ctx->number < 1 || ctx->number > MAX_PROBE_COUNT)
     {
         httpd_resp_set_status(req, "400");
         httpd_resp_send_chunk(req, NULL, 0);
         return ESP_OK;
     }
-
-    size_t probeId = 0;
-
-    cJSON *number = cJSON_GetObjectItemCaseSensitive(root, "number");
-    if (number != NULL && cJSON_IsNumber(number) && number->valueint > 0)
-    {
-        probeId = number->valueint - 1;
-    }
-    else
+    size_t probeId = ctx->number - 1;
+    ibbq_get_config(bbq_state, &ctx->config, &ctx->probes);
+    if (!apply_channel_update(&ctx->channel, probeId, &ctx->probes, &ctx->config))
     {
+        const char *msg = "Names and colors of all channels are too long";
         httpd_resp_set_status(req, "400");
-        httpd_resp_send_chunk(req, NULL, 0);
-    }
-
-    probe_data_t *probe_data = &bbq_state->probes[probeId];
-
-    cJSON *name = cJSON_GetObjectItemCaseSensitive(root, "name");
-    if (name != NULL && cJSON_IsString(name))
-    {
-        strncpy(probe_data->name, name->valuestring, sizeof(probe_data->name));
-        probe_data->name[sizeof(probe_data->name) - 1] = '\0';
-    }
-
-    cJSON *min = cJSON_GetObjectItemCaseSensitive(root, "min");
-    if (min != NULL && cJSON_IsNumber(min))
-    {
-        probe_data->min = min->valueint;
-    }
-
-    cJSON *max = cJSON_GetObjectItemCaseSensitive(root, "max");
-    if (max != NULL && cJSON_IsNumber(max))
-    {
-        probe_data->max = max->valueint;
-    }
-
-    cJSON *color = cJSON_GetObjectItemCaseSensitive(root, "color");
-    if (color != NULL && cJSON_IsString(color))
-    {
-        strncpy(probe_data->color, color->valuestring, sizeof(probe_data->color));
-        probe_data->color[sizeof(probe_data->color) - 1] = '\0';
+        httpd_resp_send(req, msg, strlen(msg));
+        return ESP_OK;
     }
 
-    // TODO handle alarms
-
     ESP_LOGI(TAG, "Updating probe %d with name %s, min %f, max %f and color %s",
              probeId,
-             bbq_state->probes[probeId].name,
-             bbq_state->probes[probeId].min,
-             bbq_state->probes[probeId].max,
-             bbq_state->probes[probeId].color);
-
-    saveSettings(CHANNEL_SETTINGS, bbq_state->probes);
+             probe_config_name(&ctx->config, probeId),
+             ctx->probes.min[probeId],
+             ctx->probes.max[probeId],
+             probe_config_color(&ctx->config, probeId));
 
-    cJSON_Delete(root);
+    ibbq_set_config(bbq_state, &ctx->config, &ctx->probes);
+    saveSettings(CHANNEL_SETTINGS, bbq_state);
     httpd_resp_send_chunk(req, NULL, 0);
 
     return ESP_OK;
@@ -731,76 +1662,55 @@ static esp_err_t setchannels_handler(httpd_req_t *req)
 static httpd_uri_t setchannels_route = {
     .uri = "/setchannels",
     .method = HTTP_POST,
-    .handler = setchannels_handler,
+    .handler = arena_handler<setchannels_handler>,
     .user_ctx = NULL};
 
-httpd_handle_t init_webserver(ibbq_state_t *state)
-{
-    static httpd_handle_t server = NULL;
-    static httpd_config_t config = HTTPD_DEFAULT_CONFIG();
-    config.max_uri_handlers = 12;
-    config.stack_size = 8192;
-
-    wifi_scan_semaphore = xSemaphoreCreateBinary();
-    xSemaphoreGive(wifi_scan_semaphore);
 
-    esp_event_loop_args_t wifi_scan_loop_args = {
-        .queue_size = 5,
-        .task_name = "wifi_scan_loop_task", // task will be created
-        .task_priority = uxTaskPriorityGet(NULL),
-        .task_stack_size = 2048,
-        .task_core_id = tskNO_AFFINITY};
-
-    ESP_LOGI(TAG, "Starting server on port: '%d'", config.server_port);
-    esp_err_t ret = httpd_start(&server, &config);
-    if (ret == ESP_OK)
-    {
-        scanned_wifi_data.scanned_aps_count = 0;
-        ESP_ERROR_CHECK(esp_event_loop_create(&wifi_scan_loop_args, &wifi_scan_loop));
-        ESP_ERROR_CHECK(esp_event_handler_register_with(wifi_scan_loop, WIFI_SCAN_EVENT, WIFI_SCAN_REQUESTED, scan_task, &scanned_wifi_data));
-        initiate_wifi_scan();
-
-        // Set URI handlers
-        ESP_LOGI(TAG, "Registering URI handlers");
-        httpd_register_uri_handler(server, &index_route);
-        httpd_register_uri_handler(server, &font_route);
-        httpd_register_uri_handler(server, &fontello_route);
-        data_route.user_ctx = (void *)state;
-        httpd_register_uri_handler(server, &data_route);
-        data_set_route.user_ctx = (void *)state;
-        httpd_register_uri_handler(server, &data_set_route);
-        settings_get_route.user_ctx = (void *)state;
-        httpd_register_uri_handler(server, &settings_get_route);
-        setchannels_route.user_ctx = (void *)state;
-        httpd_register_uri_handler(server, &setchannels_route);
-        httpd_register_uri_handler(server, &set_system_route);
-        get_system_route.user_ctx = (void *)state;
-        httpd_register_uri_handler(server, &get_system_route);
-        networklist_route.user_ctx = (void *)&scanned_wifi_data;
-        httpd_register_uri_handler(server, &networklist_route);
-        networkscan_route.user_ctx = (void *)&scanned_wifi_data;
-        httpd_register_uri_handler(server, &networkscan_route);
-        httpd_register_uri_handler(server, &setnetwork_route);
-        initialise_mdns();
-        return server;
-    }
-    else
-    {
-        ESP_LOGE(TAG, "Failed to start webserver: %s", esp_err_to_name(ret));
-        esp_restart();
-    }
-    return NULL;
+void register_webserver_routes(httpd_handle_t server, ibbq_state_t *state)
+{
+    ESP_LOGI(TAG, "Registering URI handlers");
+    httpd_register_uri_handler(server, &index_route);
+    httpd_register_uri_handler(server, &font_route);
+    httpd_register_uri_handler(server, &fontello_route);
+    data_route.user_ctx = (void *)state;
+    httpd_register_uri_handler(server, &data_route);
+    data_set_route.user_ctx = (void *)state;
+    httpd_register_uri_handler(server, &data_set_route);
+    settings_get_route.user_ctx = (void *)state;
+    httpd_register_uri_handler(server, &settings_get_route);
+    setchannels_route.user_ctx = (void *)state;
+    httpd_register_uri_handler(server, &setchannels_route);
+    httpd_register_uri_handler(server, &set_system_route);
+    get_system_route.user_ctx = (void *)state;
+    httpd_register_uri_handler(server, &get_system_route);
+    networklist_route.user_ctx = (void *)&scanned_wifi_data;
+    httpd_register_uri_handler(server, &networklist_route);
+    networkscan_route.user_ctx = (void *)&scanned_wifi_data;
+    httpd_register_uri_handler(server, &networkscan_route);
+    httpd_register_uri_handler(server, &coex_route);
+    httpd_register_uri_handler(server, &jitter_route);
+    httpd_register_uri_handler(server, &setnetwork_route);
+    httpd_register_uri_handler(server, &boot_timeline_route);
+    httpd_register_uri_handler(server, &event_log_route);
+    httpd_register_uri_handler(server, &locks_route);
+    httpd_register_uri_handler(server, &tasks_route);
+    httpd_register_uri_handler(server, &heap_route);
+    httpd_register_uri_handler(server, &influx_get_route);
+    httpd_register_uri_handler(server, &influx_set_route);
+    httpd_register_uri_handler(server, &hub_route);
+    register_ota_routes(server);
+    register_capture_routes(server);
 }
 
-void stop_webserver(httpd_handle_t server)
+void wifi_scan_attach(esp_event_loop_handle_t loop)
 {
-    ESP_LOGD(TAG, "Freesing mDNS");
-    mdns_free();
-    // Stop the httpd server
-    ESP_LOGD(TAG, "Stopping httpd");
-    esp_err_t ret = httpd_stop(server);
-    if (ret != ESP_OK)
+    if (wifi_scan_semaphore == NULL)
     {
-        ESP_LOGE(TAG, "Failed to stop httpd server: %s", esp_err_to_name(ret));
+        wifi_scan_semaphore = xSemaphoreCreateBinary();
+        xSemaphoreGive(wifi_scan_semaphore);
     }
-}
\ No newline at end of file
+    wifi_scan_loop = loop;
+    scanned_wifi_data.scanned_aps_count = 0;
+    ESP_ERROR_CHECK(esp_event_handler_register_with(wifi_scan_loop, WIFI_SCAN_EVENT, WIFI_SCAN_REQUESTED, scan_task, &scanned_wifi_data));
+    initiate_wifi_scan();
+}
@@ -13,8 +13,10 @@ extern "C"
 {
 #endif
 
-    httpd_handle_t init_webserver(ibbq_state_t *state);
-    void stop_webserver(httpd_handle_t server);
+    // Registers all routes of the web interface, called once for every start of httpd
+    void register_webserver_routes(httpd_handle_t server, ibbq_state_t *state);
+    // Lets the WiFi scan handler run on loop and starts the first scan
+    void wifi_scan_attach(esp_event_loop_handle_t loop);
 
     ESP_EVENT_DECLARE_BASE(WIFI_SCAN_EVENT);
     enum
@@ -1,5 +1,9 @@
 #include "wifi.h"
+#include "influx.h"
+#include "sample_multicast.h"
+#include "hub.h"
 
+#include <string.h>
 #include "esp_wifi.h"
 #include "freertos/event_groups.h"
 #include "esp_event_loop.h"
@@ -8,10 +12,14 @@
 #include "mdns.h"
 #include "esp_timer.h"
 
-#include "webserver.h"
+#include "net_services.h"
 #include "settings.h"
 #include "dns_server.h"
 #include "ibbq.h"
+#include "boot.h"
+#include "heap_stats.h"
+#include "TaskRegistry.h"
+#include "task_plan.h"
 
 #define CONFIG_ESP_MAXIMUM_RETRY 3
 #define MAX_STA_CONN 5
@@ -21,7 +29,9 @@ static const char *TAG = "wifi station";
 
 static dns_server_config_t dns_config = {
     .answer_all = false,
-    .hostname = "ibbq.gateway."};
+    .hostname = "ibbq.gateway.",
+    .task_priority = TASK_PRIO_DNS,
+    .task_core_id = TASK_CORE_NET};
 
 void wifi_init_ap(network_context_t *ctx);
 
@@ -45,23 +55,20 @@ static esp_err_t esp_wifi_event_handler(void *ctx, system_event_t *event)
     {
         ESP_LOGI(TAG, "Connected to AP");
         //tcpip_adapter_create_ip6_linklocal(TCPIP_ADAPTER_IF_STA);
-        ESP_LOGI(TAG, "Starting iBBQ connection");
-        ibbq_state_t *bbq_state = init_ibbq();
-        loadSettings(CHANNEL_SETTINGS, bbq_state->probes);
-        nCtx->bbq_state = bbq_state;
         break;
     }
     case SYSTEM_EVENT_STA_GOT_IP:
     {
         ESP_LOGI(TAG, "Got IPv4: %s", ip4addr_ntoa(&event->event_info.got_ip.ip_info.ip));
         s_retry_num = 0;
-        if (nCtx->webserver)
-        {
-            ESP_LOGD(TAG, "Stopping webserver");
-            stop_webserver(nCtx->webserver);
-            nCtx->webserver = NULL;
-        }
-        nCtx->webserver = init_webserver(nCtx->bbq_state);
+        boot_phase_done(BOOT_PHASE_NETWORK_UP, ESP_OK);
+        // Only the first call starts httpd and mDNS, reconnects keep the running instance
+        nCtx->webserver = net_services_start(nCtx->bbq_state);
+        boot_phase_done(BOOT_PHASE_WEBSERVER, ESP_OK);
+        // Only the station has a route to the InfluxDB server
+        influx_start(nCtx->bbq_state);
+        sample_multicast_start();
+        hub_start(nCtx->bbq_state);
         break;
     }
     case SYSTEM_EVENT_AP_STA_GOT_IP6:
@@ -98,24 +105,18 @@ static esp_err_t esp_wifi_event_handler(void *ctx, system_event_t *event)
     case SYSTEM_EVENT_AP_START:
     {
         ESP_LOGI(TAG, "AP started");
+        boot_phase_done(BOOT_PHASE_NETWORK_UP, ESP_OK);
         init_dns_server(&dns_config);
-        if (nCtx->webserver != NULL)
-        {
-            stop_webserver(nCtx->webserver);
-            nCtx->webserver = NULL;
-        }
-        nCtx->webserver = init_webserver(nCtx->bbq_state);
+        TaskRegistry::add("receive_thread", DNS_SERVER_STACK_SIZE);
+        nCtx->webserver = net_services_start(nCtx->bbq_state);
+        boot_phase_done(BOOT_PHASE_WEBSERVER, ESP_OK);
         ESP_LOGI(TAG, "Waiting for WiFi clients to connect");
         break;
     }
     case SYSTEM_EVENT_AP_STOP:
     {
-        ESP_LOGI(TAG, "AP stopped, shutting down webserver and DNS server");
-        if (nCtx->webserver != NULL)
-        {
-            stop_webserver(nCtx->webserver);
-            nCtx->webserver = NULL;
-        }
+        // The webserver keeps running, it is bound to all interfaces and the STA side may still be up
+        ESP_LOGI(TAG, "AP stopped");
         // TODO stop DNS server
         break;
     }
@@ -144,7 +145,7 @@ static esp_err_t esp_wifi_event_handler(void *ctx, system_event_t *event)
 void wifi_init_ap(network_context_t *ctx)
 {
     ESP_LOGI(TAG, "WiFi unconfigured, starting AP...");
-    system_settings_t *sys_settings = (system_settings_t *)malloc(sizeof(system_settings_t));
+    system_settings_t *sys_settings = (system_settings_t *)heap_stats_malloc(HEAP_TAG_SETTINGS, sizeof(system_settings_t));
     loadSettings(SYSTEM_SETTINGS, sys_settings);
 
     wifi_config_t wifi_config = {};
@@ -159,7 +160,7 @@ void wifi_init_ap(network_context_t *ctx)
     //ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_AP));
     ESP_ERROR_CHECK(esp_wifi_set_config(ESP_IF_WIFI_AP, &wifi_config));
     ESP_ERROR_CHECK(esp_wifi_start());
-    free(sys_settings);
+    heap_stats_free(sys_settings);
 }
 
 void wifi_init(network_context_t *ctx)
@@ -181,7 +182,7 @@ void wifi_init(network_context_t *ctx)
     ESP_LOGI(TAG, "wifi_init_sta finished. connecting to ap SSID: %s", wifi_config.sta.password);
 #else
     //#error "Standalone AP mode is net yet supported, please specific WIFI_SSID and WIFI_PSK in wifi_creds.h"
-    wifi_client_config_t *client_config = (wifi_client_config_t *)malloc(sizeof(wifi_client_config_t));
+    wifi_client_config_t *client_config = (wifi_client_config_t *)heap_stats_malloc(HEAP_TAG_SETTINGS, sizeof(wifi_client_config_t));
     if (!loadSettings(WIFI_SETTINGS, client_config))
     {
         wifi_init_ap(ctx);
@@ -199,6 +200,6 @@ void wifi_init(network_context_t *ctx)
         ESP_LOGI(TAG, "wifi_init_sta finished.");
         ESP_LOGI(TAG, "connect to ap SSID: %s", client_config->ssid);
     }
-    free(client_config);
+    heap_stats_free(client_config);
 #endif
 }
\ No newline at end of file
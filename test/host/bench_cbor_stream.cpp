@@ -0,0 +1,281 @@
+#include "cbor_stream.h"
+
+#include <math.h>
+#include <string.h>
+#include <string>
+
+#include "check.h"
+
+#define BENCH_ROUNDS 200000
+
+typedef struct probe
+{
+    const char *name;
+    const char *color;
+    float temp, min, max;
+    bool alarm;
+} probe_t;
+
+static const probe_t probes[] = {
+    {"Kanal 1", "#0C4C88", 23.5f, 10.0f, 35.0f, false},
+    {"Brisket", "#22B14C", 71.3f, 60.0f, 95.0f, false},
+    {"Pit", "#EF562D", 118.0f, 100.0f, 130.0f, false},
+    {"Kanal 4", "#FFC100", 6552.6f, 10.0f, 35.0f, true},
+    {"Kanal 5", "#A349A4", 20.1f, 10.0f, 35.0f, false},
+    {"Kanal 6", "#804000", 20.2f, 10.0f, 35.0f, false},
+    {"Kanal 7", "#5587A2", 20.3f, 10.0f, 35.0f, false},
+    {"Kanal 8", "#5C7148", 20.4f, 10.0f, 35.0f, false},
+};
+
+static bool discard(const uint8_t *data, size_t len, void *ctx)
+{
+    // Keeps the compiler from dropping the encoding
+    *(uint8_t *)ctx ^= data[len - 1];
+    return true;
+}
+
+static void cbor_key_string(cbor_stream_t *stream, const char *key, const char *value)
+{
+    cbor_stream_string(stream, key);
+    cbor_stream_string(stream, value);
+}
+
+// Same layout as data_cbor_handler() in webserver.cpp, the channels as one array per field
+static size_t encode_cbor(size_t count, uint8_t *check)
+{
+    cbor_stream_t stream;
+    cbor_stream_init(&stream, discard, check);
+    cbor_stream_map(&stream, 2);
+    cbor_stream_string(&stream, "system");
+    cbor_stream_map(&stream, 11);
+    cbor_key_string(&stream, "serial", "A4CF12345678");
+    cbor_stream_string(&stream, "ibbq_connected");
+    cbor_stream_bool(&stream, true);
+    cbor_stream_string(&stream, "ibbq_rssi");
+    cbor_stream_uint(&stream, 187);
+    cbor_stream_string(&stream, "soc");
+    cbor_stream_float(&stream, 87.5f);
+    cbor_stream_string(&stream, "rssi");
+    cbor_stream_int(&stream, -61);
+    cbor_key_string(&stream, "unit", "C");
+    cbor_key_string(&stream, "ap", "ibbq-ap");
+    cbor_key_string(&stream, "language", "de");
+    cbor_key_string(&stream, "hwversion", "iBBQ-Gateway dev");
+    cbor_key_string(&stream, "host", "ibbq");
+    cbor_stream_string(&stream, "autoupd");
+    cbor_stream_bool(&stream, false);
+
+    cbor_stream_string(&stream, "channel");
+    cbor_stream_map(&stream, 8);
+    cbor_key_string(&stream, "type", "iBBQ");
+    cbor_stream_string(&stream, "number");
+    cbor_stream_array(&stream, count);
+    for (size_t i = 0; i < count; i++)
+    {
+        cbor_stream_uint(&stream, i + 1);
+    }
+    cbor_stream_string(&stream, "name");
+    cbor_stream_array(&stream, count);
+    for (size_t i = 0; i < count; i++)
+    {
+        cbor_stream_string(&stream, probes[i].name);
+    }
+    cbor_stream_string(&stream, "temp");
+    cbor_stream_array(&stream, count);
+    for (size_t i = 0; i < count; i++)
+    {
+        cbor_stream_float(&stream, probes[i].temp);
+    }
+    cbor_stream_string(&stream, "min");
+    cbor_stream_array(&stream, count);
+    for (size_t i = 0; i < count; i++)
+    {
+        cbor_stream_float(&stream, probes[i].min);
+    }
+    cbor_stream_string(&stream, "max");
+    cbor_stream_array(&stream, count);
+    for (size_t i = 0; i < count; i++)
+    {
+        cbor_stream_float(&stream, probes[i].max);
+    }
+    cbor_stream_string(&stream, "color");
+    cbor_stream_array(&stream, count);
+    for (size_t i = 0; i < count; i++)
+    {
+        cbor_stream_string(&stream, probes[i].color);
+    }
+    cbor_stream_string(&stream, "alarm");
+    cbor_stream_array(&stream, count);
+    for (size_t i = 0; i < count; i++)
+    {
+        cbor_stream_bool(&stream, probes[i].alarm);
+    }
+    CHECK(cbor_stream_finish(&stream));
+    return stream.total;
+}
+
+// Writes JSON laid out like cJSON_Print (formatted) or cJSON_PrintUnformatted
+typedef struct json_writer
+{
+    std::string out;
+    bool formatted;
+    int depth;
+    bool first;
+} json_writer_t;
+
+static void json_separator(json_writer_t *w, bool in_object)
+{
+    if (!w->first)
+    {
+        w->out += w->formatted && !in_object ? ", " : ",";
+    }
+    if (w->formatted && in_object)
+    {
+        w->out += "\n";
+        w->out.append(w->depth, '\t');
+    }
+    w->first = false;
+}
+
+static void json_key(json_writer_t *w, const char *key)
+{
+    json_separator(w, true);
+    w->out += "\"";
+    w->out += key;
+    w->out += w->formatted ? "\":\t" : "\":";
+}
+
+static void json_open(json_writer_t *w, char c)
+{
+    w->out += c;
+    w->depth++;
+    w->first = true;
+}
+
+static void json_close(json_writer_t *w, char c)
+{
+    w->depth--;
+    if (w->formatted && c == '}')
+    {
+        w->out += "\n";
+        w->out.append(w->depth, '\t');
+    }
+    w->out += c;
+    w->first = false;
+}
+
+static void json_number(json_writer_t *w, double value)
+{
+    char number[32];
+    if (value == floor(value) && fabs(value) < 1e9)
+    {
+        snprintf(number, sizeof(number), "%d", (int)value);
+    }
+    else
+    {
+        snprintf(number, sizeof(number), "%1.15g", value);
+    }
+    w->out += number;
+}
+
+static void json_string(json_writer_t *w, const char *value)
+{
+    w->out += "\"";
+    w->out += value;
+    w->out += "\"";
+}
+
+// Same layout as data_handler() in webserver.cpp, one object per channel
+static size_t encode_json(size_t count, bool formatted, uint8_t *check)
+{
+    json_writer_t w;
+    w.formatted = formatted;
+    w.depth = 0;
+    w.first = true;
+    w.out.reserve(2048);
+    json_open(&w, '{');
+    json_key(&w, "system");
+    json_open(&w, '{');
+    json_key(&w, "serial");
+    json_string(&w, "A4CF12345678");
+    json_key(&w, "ibbq_connected");
+    w.out += "true";
+    json_key(&w, "ibbq_rssi");
+    json_number(&w, 187);
+    json_key(&w, "soc");
+    json_number(&w, 87.5f);
+    json_key(&w, "rssi");
+    json_number(&w, -61);
+    json_key(&w, "unit");
+    json_string(&w, "C");
+    json_key(&w, "ap");
+    json_string(&w, "ibbq-ap");
+    json_key(&w, "language");
+    json_string(&w, "de");
+    json_key(&w, "hwversion");
+    json_string(&w, "iBBQ-Gateway dev");
+    json_key(&w, "host");
+    json_string(&w, "ibbq");
+    json_key(&w, "autoupd");
+    w.out += "false";
+    json_close(&w, '}');
+    json_key(&w, "channel");
+    json_open(&w, '[');
+    for (size_t i = 0; i < count; i++)
+    {
+        json_separator(&w, false);
+        json_open(&w, '{');
+        json_key(&w, "number");
+        json_number(&w, i + 1);
+        json_key(&w, "type");
+        json_string(&w, "iBBQ");
+        json_key(&w, "name");
+        json_string(&w, probes[i].name);
+        json_key(&w, "temp");
+        json_number(&w, probes[i].temp);
+        json_key(&w, "min");
+        json_number(&w, probes[i].min);
+        json_key(&w, "max");
+        json_number(&w, probes[i].max);
+        json_key(&w, "color");
+        json_string(&w, probes[i].color);
+        json_key(&w, "alarm");
+        w.out += probes[i].alarm ? "true" : "false";
+        json_close(&w, '}');
+    }
+    json_close(&w, ']');
+    json_close(&w, '}');
+    *check ^= w.out.back();
+    return w.out.size();
+}
+
+static void run(size_t count)
+{
+    uint8_t check = 0;
+    size_t cbor = encode_cbor(count, &check);
+    size_t json = encode_json(count, true, &check);
+    size_t compact = encode_json(count, false, &check);
+
+    int64_t start = now_ns();
+    for (int i = 0; i < BENCH_ROUNDS; i++)
+    {
+        encode_cbor(count, &check);
+    }
+    double cbor_ns = (double)(now_ns() - start) / BENCH_ROUNDS;
+    start = now_ns();
+    for (int i = 0; i < BENCH_ROUNDS; i++)
+    {
+        encode_json(count, false, &check);
+    }
+    double json_ns = (double)(now_ns() - start) / BENCH_ROUNDS;
+
+    printf("%zu probes: CBOR %4zu bytes %6.0f ns, JSON %4zu bytes (%4zu compact) %6.0f ns [%02x]\n", count, cbor,
+           cbor_ns, json, compact, json_ns, check);
+}
+
+int main()
+{
+    run(4);
+    run(8);
+    return 0;
+}
@@ -0,0 +1,154 @@
+#include "Channel.h"
+#include "FreeRTOS.h"
+
+#include <thread>
+#include <vector>
+
+#include "check.h"
+
+#define BENCH_ITEMS 10000000
+// The threaded runs switch tasks all the time on a single core, fewer items do
+#define THREADED_ITEMS 1000000
+// Room for 8 events like the channels, each item carries an 8 byte header
+#define RINGBUFFER_SIZE (8 * (sizeof(event_t) + 8))
+
+// Same size as ibbq_event_t, the events of the BLE task
+typedef struct event
+{
+    int64_t posted_us;
+    uint8_t type;
+    uint8_t data[15];
+} event_t;
+
+// Cost of the slot handshake alone, one thread sends and receives in turn
+template <bool MultiProducer>
+static void run_uncontended()
+{
+    static Channel<event_t, 8, MultiProducer> channel;
+    event_t event = {};
+    int64_t checksum = 0;
+    int64_t start = now_ns();
+    for (size_t i = 0; i < BENCH_ITEMS; i++)
+    {
+        event.posted_us = i;
+        channel.trySend(event);
+        channel.tryReceive(event);
+        checksum += event.posted_us;
+    }
+    double seconds = (now_ns() - start) / 1e9;
+    printf("%s, one thread: %5.1f ns per send and receive [%lld]\n", MultiProducer ? "MPSC" : "SPSC",
+           seconds * 1e9 / BENCH_ITEMS, (long long)checksum % 10);
+}
+
+// The same with the Ringbuffer wrapper, which copies the item in and hands out a pointer to return
+static void run_ringbuffer_uncontended()
+{
+    static Ringbuffer ringbuffer(RINGBUFFER_SIZE);
+    event_t event = {};
+    int64_t checksum = 0;
+    int64_t start = now_ns();
+    for (size_t i = 0; i < BENCH_ITEMS; i++)
+    {
+        event.posted_us = i;
+        ringbuffer.send(&event, sizeof(event), 0);
+        size_t size;
+        event_t *item = (event_t *)ringbuffer.receive(&size, 0);
+        checksum += item->posted_us;
+        ringbuffer.returnItem(item);
+    }
+    double seconds = (now_ns() - start) / 1e9;
+    printf("Ringbuffer, one thread: %5.1f ns per send and receive [%lld]\n", seconds * 1e9 / BENCH_ITEMS,
+           (long long)checksum % 10);
+}
+
+template <size_t Producers>
+static void run(size_t batch_size)
+{
+    static Channel<event_t, 8, (Producers > 1)> channel;
+    const size_t per_producer = THREADED_ITEMS / Producers;
+    int64_t start = now_ns();
+    std::vector<std::thread> producers;
+    for (size_t p = 0; p < Producers; p++)
+    {
+        producers.emplace_back([per_producer]() {
+            event_t event = {};
+            for (size_t i = 0; i < per_producer; i++)
+            {
+                event.posted_us = i;
+                channel.send(event);
+            }
+        });
+    }
+    event_t batch[8];
+    size_t received = 0;
+    int64_t checksum = 0;
+    while (received < per_producer * Producers)
+    {
+        size_t count = channel.receive(batch, batch_size, Channel<event_t, 8>::WAIT_FOREVER);
+        for (size_t i = 0; i < count; i++)
+        {
+            checksum += batch[i].posted_us;
+        }
+        received += count;
+    }
+    for (auto &thread : producers)
+    {
+        thread.join();
+    }
+    double seconds = (now_ns() - start) / 1e9;
+    printf("%zu producer%s, batches of %zu: %6.1f M events/s, %5.1f ns per event [%lld]\n", Producers,
+           Producers > 1 ? "s" : " ", batch_size, received / seconds / 1e6, seconds * 1e9 / received,
+           (long long)checksum % 10);
+}
+
+// Ringbuffer has no batch receive, every item is received and returned on its own
+template <size_t Producers>
+static void run_ringbuffer()
+{
+    static Ringbuffer ringbuffer(RINGBUFFER_SIZE);
+    const size_t per_producer = THREADED_ITEMS / Producers;
+    int64_t start = now_ns();
+    std::vector<std::thread> producers;
+    for (size_t p = 0; p < Producers; p++)
+    {
+        producers.emplace_back([per_producer]() {
+            event_t event = {};
+            for (size_t i = 0; i < per_producer; i++)
+            {
+                event.posted_us = i;
+                ringbuffer.send(&event, sizeof(event));
+            }
+        });
+    }
+    size_t received = 0;
+    int64_t checksum = 0;
+    while (received < per_producer * Producers)
+    {
+        size_t size;
+        event_t *item = (event_t *)ringbuffer.receive(&size);
+        checksum += item->posted_us;
+        ringbuffer.returnItem(item);
+        received++;
+    }
+    for (auto &thread : producers)
+    {
+        thread.join();
+    }
+    double seconds = (now_ns() - start) / 1e9;
+    printf("%zu producer%s, Ringbuffer:   %6.1f M events/s, %5.1f ns per event [%lld]\n", Producers,
+           Producers > 1 ? "s" : " ", received / seconds / 1e6, seconds * 1e9 / received, (long long)checksum % 10);
+}
+
+int main()
+{
+    run_uncontended<false>();
+    run_uncontended<true>();
+    run_ringbuffer_uncontended();
+    run<1>(1);
+    run<1>(8);
+    run_ringbuffer<1>();
+    run<4>(1);
+    run<4>(8);
+    run_ringbuffer<4>();
+    return 0;
+}
@@ -0,0 +1,174 @@
+#include "HttpParser.h"
+#include "SocketReader.h"
+
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <string>
+#include <thread>
+#include "esp_log.h"
+
+#include "check.h"
+
+#define BENCH_REQUESTS 20000
+#define REQUEST_BUFFER_SIZE 1024
+
+// Requests of the web UI as Chrome sent them to the gateway, the stream repeats them in this order
+static const char *const RECORDED[] = {
+    "GET / HTTP/1.1\r\n"
+    "Host: ibbq.gateway\r\n"
+    "Connection: keep-alive\r\n"
+    "Upgrade-Insecure-Requests: 1\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/76.0.3809.100 "
+    "Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/webp,image/apng,*/*;q=0.8,"
+    "application/signed-exchange;v=b3\r\n"
+    "Accept-Encoding: gzip, deflate\r\n"
+    "Accept-Language: en-US,en;q=0.9,de;q=0.8\r\n"
+    "\r\n",
+    "GET /data HTTP/1.1\r\n"
+    "Host: ibbq.gateway\r\n"
+    "Connection: keep-alive\r\n"
+    "Accept: application/cbor\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/76.0.3809.100 "
+    "Safari/537.36\r\n"
+    "Referer: http://ibbq.gateway/\r\n"
+    "Accept-Encoding: gzip, deflate\r\n"
+    "Accept-Language: en-US,en;q=0.9,de;q=0.8\r\n"
+    "\r\n",
+    "POST /settings HTTP/1.1\r\n"
+    "Host: ibbq.gateway\r\n"
+    "Connection: keep-alive\r\n"
+    "Content-Length: 110\r\n"
+    "Origin: http://ibbq.gateway\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/76.0.3809.100 "
+    "Safari/537.36\r\n"
+    "Content-Type: application/json\r\n"
+    "Accept: */*\r\n"
+    "Referer: http://ibbq.gateway/\r\n"
+    "Accept-Encoding: gzip, deflate\r\n"
+    "Accept-Language: en-US,en;q=0.9,de;q=0.8\r\n"
+    "\r\n"
+    "{\"unit\":\"C\",\"probes\":[{\"name\":\"Brisket\",\"min\":60,\"max\":95},{\"name\":\"Pit\",\"min\":105,\"max\":"
+    "125}],\"influx\":false}"};
+#define RECORDED_COUNT (sizeof(RECORDED) / sizeof(RECORDED[0]))
+
+// Every receive of the server goes through here, the client only uses read() and write()
+static uint64_t receives;
+
+extern "C" ssize_t recv(int fd, void *buf, size_t len, int flags)
+{
+    receives++;
+    return syscall(SYS_recvfrom, fd, buf, len, flags, NULL, NULL);
+}
+
+// Sends the stream, either all at once like a pipelining client or one request per answer
+static void run_client(int fd, bool wait_for_answer)
+{
+    for (int i = 0; i < BENCH_REQUESTS; i++)
+    {
+        const char *request = RECORDED[i % RECORDED_COUNT];
+        size_t len = strlen(request);
+        CHECK(write(fd, request, len) == (ssize_t)len);
+        char answer;
+        CHECK(!wait_for_answer || read(fd, &answer, 1) == 1);
+    }
+    shutdown(fd, SHUT_WR);
+}
+
+// How HttpParser read a request before SocketReader, one receive per byte of the head
+static bool parse_by_line(Socket &socket, std::string *path, std::string *body)
+{
+    std::string line = socket.readToDelim("\r\n");
+    if (line.empty())
+    {
+        return false;
+    }
+    *path = line.substr(line.find(' ') + 1);
+    path->resize(path->find(' '));
+    size_t length = 0;
+    while (!(line = socket.readToDelim("\r\n")).empty())
+    {
+        if (strncasecmp(line.c_str(), "Content-Length:", 15) == 0)
+        {
+            length = atoi(line.c_str() + 15);
+        }
+    }
+    body->resize(length);
+    if (length > 0)
+    {
+        socket.receive((uint8_t *)&(*body)[0], length, true);
+    }
+    return true;
+}
+
+static void bench(const char *title, bool buffered, bool wait_for_answer)
+{
+    Socket listener;
+    CHECK(listener.listen(0) == 0);
+    struct sockaddr_in addr;
+    listener.getBind((struct sockaddr *)&addr);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    CHECK(connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+    Socket peer = listener.accept();
+    // A wrong length would stall both sides instead of failing
+    CHECK(peer.setTimeout(5) == 0);
+
+    receives = 0;
+    int64_t start = now_ns();
+    std::thread client(run_client, fd, wait_for_answer);
+    SocketReader reader(peer, REQUEST_BUFFER_SIZE);
+    int requests = 0;
+    size_t body_bytes = 0;
+    while (true)
+    {
+        std::string path;
+        std::string body;
+        if (buffered)
+        {
+            HttpParser parser;
+            if (!parser.parse(reader))
+            {
+                CHECK(parser.getErrorStatus() == 0);
+                break;
+            }
+            path = parser.getURL();
+            body = parser.getBody();
+        }
+        else if (!parse_by_line(peer, &path, &body))
+        {
+            break;
+        }
+        CHECK(path[0] == '/');
+        body_bytes += body.size();
+        requests++;
+        CHECK(!wait_for_answer || write(peer.getFD(), "", 1) == 1);
+    }
+    double seconds = (now_ns() - start) / 1e9;
+    client.join();
+    CHECK(requests == BENCH_REQUESTS);
+    CHECK(body_bytes == BENCH_REQUESTS / RECORDED_COUNT * 110);
+    peer.close();
+    close(fd);
+    listener.close();
+    printf("%-14s %-12s %6.2f receives/request %8.0f requests/s\n", title,
+           wait_for_answer ? "one by one" : "pipelined", (double)receives / requests, requests / seconds);
+}
+
+int main()
+{
+    esp_log_level_set("*", ESP_LOG_NONE);
+    size_t bytes = 0;
+    for (size_t i = 0; i < RECORDED_COUNT; i++)
+    {
+        bytes += strlen(RECORDED[i]);
+    }
+    printf("%d requests, %zu bytes per request on average\n", BENCH_REQUESTS, bytes / RECORDED_COUNT);
+    bench("readToDelim", false, true);
+    bench("SocketReader", true, true);
+    bench("readToDelim", false, false);
+    bench("SocketReader", true, false);
+    return 0;
+}
@@ -0,0 +1,157 @@
+#include "HttpRouter.h"
+
+#include <regex>
+#include <string>
+#include <vector>
+#include "esp_log.h"
+
+#include "check.h"
+
+#define ROUTES 50
+#define BENCH_MATCHES 200000
+
+typedef struct route
+{
+    const char *method;
+    std::string pattern;
+} route_t;
+
+// How HttpServer matched before the router, a regex per handler searched in the order they were added
+typedef struct regex_route
+{
+    std::string method;
+    std::regex regex;
+} regex_route_t;
+
+// The routes of the gateway and, to make 50, the CRUD routes of a larger API
+static std::vector<route_t> routes()
+{
+    std::vector<route_t> table = {
+        {"GET", "/data"},
+        {"GET", "/settings"},
+        {"POST", "/settings"},
+        {"GET", "/heap"},
+        {"GET", "/tasks"},
+        {"GET", "/events"},
+        {"POST", "/ota"},
+        {"GET", "/api/probes/:id"},
+        {"PUT", "/api/probes/:id/alarm/:kind"},
+        {"GET", "/static/*"},
+    };
+    const char *resources[] = {"devices", "sessions", "cooks", "recipes", "alarms", "users", "logs", "schedules"};
+    for (const char *resource : resources)
+    {
+        std::string base = std::string("/api/v1/") + resource;
+        table.push_back({"GET", base});
+        table.push_back({"POST", base});
+        table.push_back({"GET", base + "/:id"});
+        table.push_back({"PUT", base + "/:id"});
+        table.push_back({"DELETE", base + "/:id"});
+    }
+    CHECK(table.size() == ROUTES);
+    return table;
+}
+
+static std::string to_regex(const std::string &pattern)
+{
+    std::string regex = "^";
+    size_t pos = 1;
+    while (pos <= pattern.size())
+    {
+        size_t end = pattern.find('/', pos);
+        if (end == std::string::npos)
+        {
+            end = pattern.size();
+        }
+        std::string segment = pattern.substr(pos, end - pos);
+        if (segment == "*")
+        {
+            regex += "/(.*)";
+        }
+        else if (segment[0] == ':')
+        {
+            regex += "/([^/]+)";
+        }
+        else
+        {
+            regex += "/" + segment;
+        }
+        pos = end + 1;
+    }
+    return regex + "$";
+}
+
+typedef struct request
+{
+    const char *method;
+    std::string path;
+    int route;
+} request_t;
+
+int main()
+{
+    esp_log_level_set("*", ESP_LOG_NONE);
+    std::vector<route_t> table = routes();
+    HttpRouter router;
+    std::vector<regex_route_t> regexes;
+    for (size_t i = 0; i < table.size(); i++)
+    {
+        CHECK(router.addRoute(table[i].method, table[i].pattern, i));
+        regexes.push_back({table[i].method, std::regex(to_regex(table[i].pattern))});
+    }
+
+    // What the web UI asks for most, some API calls all over the table and paths nothing matches
+    std::vector<request_t> requests = {
+        {"GET", "/data", 0},
+        {"GET", "/data", 0},
+        {"GET", "/data", 0},
+        {"GET", "/settings", 1},
+        {"GET", "/static/js/app.js", 9},
+        {"GET", "/api/probes/2", 7},
+        {"PUT", "/api/probes/2/alarm/max", 8},
+        {"GET", "/api/v1/devices/17", 12},
+        {"POST", "/api/v1/cooks", 21},
+        {"DELETE", "/api/v1/schedules/4", 49},
+        {"GET", "/api/v1/logs", 40},
+        {"GET", "/favicon.ico", -1},
+        {"GET", "/api/v2/devices", -1},
+    };
+
+    int64_t start = now_ns();
+    size_t found = 0;
+    for (int i = 0; i < BENCH_MATCHES; i++)
+    {
+        const request_t &request = requests[i % requests.size()];
+        size_t value;
+        HttpRouteParams params;
+        bool matched = router.match(request.method, request.path.c_str(), request.path.length(), &value, &params);
+        CHECK(matched ? (int)value == request.route : request.route == -1);
+        found += matched;
+    }
+    double trie_ns = (double)(now_ns() - start) / BENCH_MATCHES;
+
+    start = now_ns();
+    size_t regex_found = 0;
+    for (int i = 0; i < BENCH_MATCHES; i++)
+    {
+        const request_t &request = requests[i % requests.size()];
+        int value = -1;
+        for (size_t j = 0; j < regexes.size(); j++)
+        {
+            if (regexes[j].method == request.method && std::regex_search(request.path, regexes[j].regex))
+            {
+                value = j;
+                break;
+            }
+        }
+        CHECK(value == request.route);
+        regex_found += value >= 0;
+    }
+    double regex_ns = (double)(now_ns() - start) / BENCH_MATCHES;
+    CHECK(found == regex_found);
+
+    printf("%d routes, %d matches, %zu found\n", ROUTES, BENCH_MATCHES, found);
+    printf("regex_search %8.0f ns/match %10.0f matches/s\n", regex_ns, 1e9 / regex_ns);
+    printf("HttpRouter   %8.0f ns/match %10.0f matches/s  %.0fx\n", trie_ns, 1e9 / trie_ns, regex_ns / trie_ns);
+    return 0;
+}
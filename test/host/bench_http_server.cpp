@@ -0,0 +1,189 @@
+#include "HttpServer.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "esp_log.h"
+
+#include "check.h"
+
+#define PORT 18633
+#define BENCH_REQUESTS 32000
+#define SLOW_CLIENTS 4
+
+// What the web UI polls, the probe temperatures
+static const std::string DATA = "{\"unit\":\"C\",\"probes\":[{\"t\":21.5},{\"t\":64.0},{\"t\":null},{\"t\":null}]}";
+
+static const char REQUEST[] = "GET /data HTTP/1.1\r\n"
+                              "Host: ibbq.gateway\r\n"
+                              "Connection: keep-alive\r\n"
+                              "Accept: application/json\r\n"
+                              "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) "
+                              "Chrome/76.0.3809.100 Safari/537.36\r\n"
+                              "Referer: http://ibbq.gateway/\r\n"
+                              "\r\n";
+
+static void send_data(HttpRequest *request, HttpResponse *response)
+{
+    response->setStatus(HttpResponse::HTTP_STATUS_OK, "OK");
+    response->addHeader(HttpRequest::HTTP_HEADER_CONTENT_LENGTH, std::to_string(DATA.size()));
+    response->sendData(DATA);
+    response->close();
+}
+
+static int connect_client()
+{
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    for (int attempt = 0; attempt < 100; attempt++)
+    {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        CHECK(fd >= 0);
+        if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0)
+        {
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            return fd;
+        }
+        close(fd);
+        usleep(10 * 1000);
+    }
+    CHECK(false);
+    return -1;
+}
+
+// The answer of the handler is always the same, so its length is known
+static void read_answer(int fd, size_t length)
+{
+    char buf[512];
+    CHECK(length <= sizeof(buf));
+    size_t got = 0;
+    while (got < length)
+    {
+        ssize_t n = recv(fd, buf, length - got, 0);
+        CHECK(n > 0);
+        got += n;
+    }
+}
+
+static size_t answer_length()
+{
+    int fd = connect_client();
+    CHECK(send(fd, REQUEST, strlen(REQUEST), 0) == (ssize_t)strlen(REQUEST));
+    std::string answer;
+    while (answer.size() < DATA.size() || answer.compare(answer.size() - DATA.size(), DATA.size(), DATA) != 0)
+    {
+        char buf[512];
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        CHECK(n > 0);
+        answer.append(buf, n);
+    }
+    close(fd);
+    return answer.size();
+}
+
+// One keep-alive client, sends a request once it got the answer to the last one
+static void run_client(int fd, int requests, size_t length, std::vector<int64_t> *latencies)
+{
+    size_t request_length = strlen(REQUEST);
+    for (int i = 0; i < requests; i++)
+    {
+        int64_t start = now_ns();
+        CHECK(send(fd, REQUEST, request_length, 0) == (ssize_t)request_length);
+        read_answer(fd, length);
+        latencies->push_back(now_ns() - start);
+    }
+}
+
+// Sends its request a byte every 10 ms, so the head is never complete while the clients are measured
+static void run_slow_client(std::atomic<bool> *stop)
+{
+    int fd = connect_client();
+    for (size_t i = 0; i < strlen(REQUEST) && !*stop; i++)
+    {
+        CHECK(send(fd, REQUEST + i, 1, 0) == 1);
+        usleep(10 * 1000);
+    }
+    close(fd);
+}
+
+static void bench(int clients, int slow_clients, size_t length)
+{
+    std::atomic<bool> stop(false);
+    std::vector<std::thread> slow;
+    for (int i = 0; i < slow_clients; i++)
+    {
+        slow.push_back(std::thread(run_slow_client, &stop));
+    }
+    usleep(50 * 1000);
+
+    std::vector<int> fds;
+    for (int i = 0; i < clients; i++)
+    {
+        fds.push_back(connect_client());
+    }
+    std::vector<std::vector<int64_t>> latencies(clients);
+    std::vector<std::thread> threads;
+    int64_t start = now_ns();
+    for (int i = 0; i < clients; i++)
+    {
+        threads.push_back(std::thread(run_client, fds[i], BENCH_REQUESTS / clients, length, &latencies[i]));
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    double seconds = (now_ns() - start) / 1e9;
+    stop = true;
+    for (auto &thread : slow)
+    {
+        thread.join();
+    }
+    for (int fd : fds)
+    {
+        close(fd);
+    }
+
+    std::vector<int64_t> all;
+    for (auto &client : latencies)
+    {
+        all.insert(all.end(), client.begin(), client.end());
+    }
+    std::sort(all.begin(), all.end());
+    printf("%2d clients %d slow %8.0f requests/s  p50 %7.1f us  p99 %7.1f us\n", clients, slow_clients,
+           all.size() / seconds, all[all.size() / 2] / 1e3, all[all.size() * 99 / 100] / 1e3);
+}
+
+int main()
+{
+    esp_log_level_set("*", ESP_LOG_NONE);
+    HttpServer server;
+    server.addPathHandler("GET", "/data", send_data);
+    // The defaults of the gateway, except for enough connections for every client
+    server.setMaxConnections(32 + SLOW_CLIENTS);
+    server.start(PORT);
+    size_t length = answer_length();
+    printf("%d requests of %zu bytes, answers of %zu bytes, 2 workers\n", BENCH_REQUESTS, strlen(REQUEST), length);
+    bench(1, 0, length);
+    bench(8, 0, length);
+    bench(32, 0, length);
+    // Clients that take their time with the head of a request
+    bench(1, SLOW_CLIENTS, length);
+    bench(8, SLOW_CLIENTS, length);
+    bench(32, SLOW_CLIENTS, length);
+    server.stop();
+    // The tasks end right after stop() returned, exit() must not run while their threads unwind
+    usleep(100 * 1000);
+    return 0;
+}
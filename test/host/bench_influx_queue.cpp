@@ -0,0 +1,97 @@
+#include "influx_queue.h"
+#include "influx_line.h"
+
+#include <string.h>
+#include "esp_http_client.h"
+#include "esp_log.h"
+
+#include "check.h"
+#include "influx_stand_in.h"
+
+#define PORT 18637
+#define BENCH_SAMPLES 50000
+#define PROBES 4
+
+static const char URL[] = "http://127.0.0.1:18637/api/v2/write?org=home&bucket=bbq&precision=s";
+static const char *NAMES[PROBES] = {"Brisket", "Pit", "", "Pork shoulder"};
+
+static char s_buffers[INFLUX_BATCH_COUNT][INFLUX_BATCH_SIZE];
+
+static esp_http_client_handle_t open_client()
+{
+    esp_http_client_config_t config = {};
+    config.url = URL;
+    config.method = HTTP_METHOD_POST;
+    config.timeout_ms = 5000;
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    CHECK(client != NULL);
+    esp_http_client_set_header(client, "Content-Type", "text/plain; charset=utf-8");
+    esp_http_client_set_header(client, "Authorization", "Token secret");
+    return client;
+}
+
+// Takes samples as take_sample() does, four probes and the device line, and uploads every batch as
+// soon as it is sealed. Without keep-alive every request opens a connection of its own.
+static void bench(bool keep_alive)
+{
+    InfluxStandIn server(PORT);
+    esp_http_client_handle_t client = open_client();
+    char *buffers[INFLUX_BATCH_COUNT];
+    for (size_t i = 0; i < INFLUX_BATCH_COUNT; i++)
+    {
+        buffers[i] = s_buffers[i];
+    }
+    influx_queue_t queue;
+    influx_queue_init(&queue, buffers);
+
+    char line[INFLUX_LINE_MAX];
+    uint32_t points = 0;
+    uint32_t dropped = 0;
+    int64_t start = now_ns();
+    for (uint32_t sample = 0; sample < BENCH_SAMPLES; sample++)
+    {
+        long timestamp = 1700000000 + sample * 5;
+        for (size_t probe = 0; probe < PROBES; probe++)
+        {
+            size_t len = influx_temperature_line(line, sizeof(line), probe + 1, NAMES[probe],
+                                                 80.0f + (sample + probe) % 400 / 10.0f, timestamp);
+            dropped += influx_queue_append(&queue, line, len, 0);
+        }
+        size_t len = influx_device_line(line, sizeof(line), 87, -64, timestamp);
+        dropped += influx_queue_append(&queue, line, len, 0);
+        points += PROBES + 1;
+
+        if (sample == BENCH_SAMPLES - 1)
+        {
+            influx_queue_seal_if_due(&queue, INFLUX_FLUSH_INTERVAL_MS * 1000LL);
+        }
+        const influx_batch_t *batch;
+        while ((batch = influx_queue_next(&queue, 0)) != NULL)
+        {
+            esp_http_client_set_post_field(client, batch->data, batch->len);
+            CHECK(esp_http_client_perform(client) == ESP_OK && esp_http_client_get_status_code(client) == 204);
+            influx_queue_sent(&queue);
+            if (!keep_alive)
+            {
+                esp_http_client_cleanup(client);
+                client = open_client();
+            }
+        }
+    }
+    double seconds = (now_ns() - start) / 1e9;
+    esp_http_client_cleanup(client);
+
+    CHECK(dropped == 0 && server.lines().size() == points);
+    printf("%-13s %8.0f points/s  %5u requests  %5u connections  %5.1f points/request  %4.1f bytes/point\n",
+           keep_alive ? "keep-alive" : "new connection", points / seconds, (uint32_t)server.requests,
+           (uint32_t)server.connections, (double)points / server.requests, (double)server.bodyBytes / points);
+}
+
+int main()
+{
+    esp_log_level_set("*", ESP_LOG_NONE);
+    printf("%d samples of %d probes and the device, %d byte batches\n", BENCH_SAMPLES, PROBES, INFLUX_BATCH_SIZE);
+    bench(true);
+    bench(false);
+    return 0;
+}
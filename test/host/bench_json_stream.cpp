@@ -0,0 +1,59 @@
+#include "json_stream.h"
+
+#include <string>
+
+#include "check.h"
+
+#define BENCH_BYTES (64 * 1024 * 1024)
+
+static void count(json_stream_t *stream, const json_stream_value_t *value, void *ctx)
+{
+    (*(size_t *)ctx)++;
+}
+
+// A /setchannels body for eight probes, the largest body the web UI posts
+static std::string channels_body()
+{
+    std::string body = "[";
+    for (int i = 0; i < 8; i++)
+    {
+        char channel[160];
+        snprintf(channel, sizeof(channel),
+                 "%s{\"number\":%d,\"name\":\"Kanal %d \\u00e4\",\"typ\":0,\"min\":%d.5,\"max\":%d,"
+                 "\"alarm\":false,\"color\":\"#5587A2\"}",
+                 i > 0 ? "," : "", i + 1, i + 1, 10 + i, 200 + i);
+        body += channel;
+    }
+    return body + "]";
+}
+
+static void run(const std::string &body, size_t chunk)
+{
+    size_t values = 0;
+    size_t documents = BENCH_BYTES / body.size();
+    int64_t start = now_ns();
+    for (size_t d = 0; d < documents; d++)
+    {
+        json_stream_t stream;
+        json_stream_init(&stream, count, &values);
+        for (size_t pos = 0; pos < body.size(); pos += chunk)
+        {
+            size_t len = chunk < body.size() - pos ? chunk : body.size() - pos;
+            json_stream_feed(&stream, body.data() + pos, len);
+        }
+        CHECK(json_stream_finish(&stream));
+    }
+    double seconds = (now_ns() - start) / 1e9;
+    printf("chunk %5zu: %7.1f MB/s, %6.2f us per %zu byte body\n", chunk,
+           documents * body.size() / seconds / 1e6, seconds * 1e6 / documents, body.size());
+}
+
+int main()
+{
+    std::string body = channels_body();
+    run(body, 1);
+    run(body, 64);
+    run(body, 1024);
+    run(body, body.size());
+    return 0;
+}
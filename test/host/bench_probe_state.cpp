@@ -0,0 +1,108 @@
+#include "ibbq.h"
+#include "ibbq_notify.h"
+#include "settings.h"
+
+#include <string.h>
+
+#include "check.h"
+
+#define BENCH_NOTIFICATIONS 20000000
+
+// ibbq_state_t before the probes were split into samples and config, every probe carried its
+// name and color at full length
+typedef struct legacy_probe_data
+{
+    float min;
+    float max;
+    char color[8];
+    uint8_t alarm;
+    char name[128];
+} legacy_probe_data_t;
+
+typedef struct legacy_ibbq_state
+{
+    bool connected;
+    uint8_t rssi;
+    legacy_probe_data_t probes[MAX_PROBE_COUNT];
+    float temps[MAX_PROBE_COUNT];
+    size_t probe_count;
+    float battery_percent;
+    BLEScan *pBLEScan;
+    BLEClient *pClient;
+} legacy_ibbq_state_t;
+
+// Version 1 of the channel settings, the probes as they were
+typedef struct legacy_channel_settings
+{
+    uint8_t version;
+    legacy_probe_data_t probe_configs[MAX_PROBE_COUNT];
+} legacy_channel_settings_t;
+
+static legacy_ibbq_state_t legacy_state;
+static probe_config_t config;
+static ibbq_state_t state = {};
+
+// What realtimeDataCallback did before, without the logging and publishing both versions share
+static void publish_legacy(const uint8_t *data, size_t length, uint16_t *raw_values)
+{
+    size_t count = length / 2 < MAX_PROBE_COUNT ? length / 2 : MAX_PROBE_COUNT;
+    legacy_state.probe_count = count;
+    for (size_t i = 0; i < count; i++)
+    {
+        raw_values[i] = (uint16_t)(data[i * 2 + 1] << 8 | data[i * 2]);
+        legacy_state.temps[i] = raw_values[i] / 10.0f;
+    }
+}
+
+// Decoding, the thresholds checked under the config lock, and the values for sample_multicast_publish()
+static void publish(const uint8_t *data, size_t length, uint16_t *raw_values)
+{
+    size_t count = ibbq_parse_realtime(data, length, raw_values);
+    ibbq_update_probes(&state, raw_values, count, 0);
+    state.probe_count = count;
+}
+
+static double run(const char *title, void (*fn)(const uint8_t *, size_t, uint16_t *))
+{
+    uint8_t data[2 * MAX_PROBE_COUNT];
+    uint16_t raw_values[MAX_PROBE_COUNT];
+    int64_t start = now_ns();
+    for (int n = 0; n < BENCH_NOTIFICATIONS; n++)
+    {
+        for (size_t i = 0; i < MAX_PROBE_COUNT; i++)
+        {
+            data[2 * i] = n + i;
+            data[2 * i + 1] = 0x04;
+        }
+        fn(data, sizeof(data), raw_values);
+        __asm__ volatile("" : : "r"(raw_values) : "memory");
+    }
+    double ns = (double)(now_ns() - start) / BENCH_NOTIFICATIONS;
+    printf("%-32s %7.1f ns per 8 probe notification\n", title, ns);
+    return ns;
+}
+
+int main()
+{
+    state.config = &config;
+    probe_config_defaults(&config);
+    for (size_t i = 0; i < MAX_PROBE_COUNT; i++)
+    {
+        state.probes.min[i] = 50;
+        state.probes.max[i] = 150;
+    }
+
+    // The hot block and the config hold no pointers, they are the same size on the ESP32
+    printf("%-32s %7zu bytes\n", "state before", sizeof(legacy_ibbq_state_t));
+    printf("%-32s %7zu bytes, %zu of them hot\n", "state now", sizeof(ibbq_state_t), sizeof(probe_hot_t));
+    printf("%-32s %7zu bytes, %u used by the defaults\n", "config", sizeof(probe_config_t), config.used);
+    printf("%-32s %7zu bytes\n", "state and config now", sizeof(ibbq_state_t) + sizeof(probe_config_t));
+    printf("%-32s %7zu bytes\n", "saved settings, version 1", sizeof(legacy_channel_settings_t));
+    printf("%-32s %7zu bytes\n", "saved settings, version 2",
+           offsetof(channel_settings_t, config) + probe_config_size(&config));
+
+    double legacy = run("decode to publish before", publish_legacy);
+    double now = run("decode to publish now", publish);
+    printf("now adds %.1f ns to a notification, the thermometer sends one a second\n", now - legacy);
+    return 0;
+}
@@ -0,0 +1,126 @@
+#include "request_arena.h"
+#include "heap_stats.h"
+#include "cJSON.h"
+
+#include <malloc.h>
+#include <string.h>
+#include <unistd.h>
+#include <initializer_list>
+#include <sys/wait.h>
+#include "esp_log.h"
+
+#include "check.h"
+
+#define BENCH_REQUESTS 100000
+#define REQUEST_NODES 24
+#define BACKGROUND_BLOCKS 64
+
+// The target links with --wrap=free for the test, the benchmark passes it through
+extern "C" void __real_free(void *ptr);
+
+extern "C" void __wrap_free(void *ptr)
+{
+    __real_free(ptr);
+}
+
+static httpd_req_t s_req = {};
+
+// What a JSON handler allocates: a cJSON node and a key or value string per item, then the print
+// buffer cJSON grows by doubling and copies to its exact length, since no realloc hook is set
+static void serve_request(uint32_t *seed)
+{
+    void *nodes[2 * REQUEST_NODES];
+    for (int i = 0; i < REQUEST_NODES; i++)
+    {
+        nodes[2 * i] = cJSON_malloc(64);
+        nodes[2 * i + 1] = cJSON_malloc(8 + xorshift(seed) % 24);
+        CHECK(nodes[2 * i] != NULL && nodes[2 * i + 1] != NULL);
+    }
+    void *buffer = NULL;
+    for (size_t size = 256; size <= 1024; size *= 2)
+    {
+        void *grown = cJSON_malloc(size);
+        CHECK(grown != NULL);
+        cJSON_free(buffer);
+        buffer = grown;
+    }
+    void *printed = cJSON_malloc(500 + xorshift(seed) % 200);
+    CHECK(printed != NULL);
+    cJSON_free(buffer);
+    for (int i = 0; i < 2 * REQUEST_NODES; i++)
+    {
+        cJSON_free(nodes[i]);
+    }
+    cJSON_free(printed);
+}
+
+// Runs the requests with blocks of other tasks coming and going in between, a readings queue entry or
+// a BLE notification that outlives the request, then reports the heap glibc is left with
+static void run(bool use_arena)
+{
+    mallopt(M_MMAP_THRESHOLD, 1024 * 1024);
+    request_arena_init();
+    uint32_t seed = 1;
+    void *background[BACKGROUND_BLOCKS] = {};
+    size_t peak_heap = 0;
+    int64_t start = now_ns();
+    for (int i = 0; i < BENCH_REQUESTS; i++)
+    {
+        void **slot = &background[xorshift(&seed) % BACKGROUND_BLOCKS];
+        heap_stats_free(*slot);
+        *slot = heap_stats_malloc(HEAP_TAG_BLE, 32 + xorshift(&seed) % 224);
+        if (use_arena)
+        {
+            request_arena_begin(&s_req);
+        }
+        serve_request(&seed);
+        if (use_arena)
+        {
+            CHECK(!request_arena_exhausted(&s_req));
+            request_arena_end(&s_req);
+        }
+        if (i % 1000 == 0)
+        {
+            struct mallinfo2 info = mallinfo2();
+            peak_heap = info.arena > peak_heap ? info.arena : peak_heap;
+        }
+    }
+    double ns = (double)(now_ns() - start) / BENCH_REQUESTS;
+
+    heap_tag_stats_t json;
+    heap_stats_get(HEAP_TAG_JSON, &json);
+    CHECK(json.current_bytes == 0);
+    struct mallinfo2 info = mallinfo2();
+    // What is free below the top of the heap is held in holes between live blocks, the top chunk glibc
+    // can give back or grow into is not fragmentation
+    size_t holes = info.fordblks - info.keepcost;
+    printf("%-14s %5.0f ns per request  %7u JSON mallocs  heap %6zu B (peak %6zu)  in use %6zu B  "
+           "%5zu B free in %2zu holes, %4.1f%% of the heap below the top\n",
+           use_arena ? "request arena" : "heap per node", ns, json.allocs, info.arena, peak_heap, info.uordblks,
+           holes, info.ordblks - 1, 100.0 * holes / (info.arena - info.keepcost));
+}
+
+// Each mode runs in a child of its own, so both start from a fresh glibc heap
+int main()
+{
+    esp_log_level_set("*", ESP_LOG_NONE);
+    printf("%d requests, %d nodes each, %d long lived blocks in between\n", BENCH_REQUESTS, REQUEST_NODES,
+           BACKGROUND_BLOCKS);
+    for (bool use_arena : {false, true})
+    {
+        fflush(stdout);
+        pid_t pid = fork();
+        CHECK(pid >= 0);
+        if (pid == 0)
+        {
+            run(use_arena);
+            fflush(stdout);
+            _exit(0);
+        }
+        int status;
+        CHECK(waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+    printf("glibc bins freed blocks by size where the ESP32's multi_heap keeps one "
+           "free list, the\nnumbers compare the two modes, not the firmware\n");
+    return 0;
+}
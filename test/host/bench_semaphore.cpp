@@ -0,0 +1,131 @@
+#include "FreeRTOS.h"
+
+#include <stdlib.h>
+#include <atomic>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+#include "esp_log.h"
+
+#include "check.h"
+
+#define BENCH_PAIRS 2000000
+#define CONTENDED_PAIRS 200000
+
+static std::atomic<size_t> s_allocations(0);
+
+void *operator new(size_t size)
+{
+    s_allocations++;
+    void *p = malloc(size);
+    if (p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+// How take() and give() kept the owner before, a std::string passed by value and assigned
+class LegacySemaphore
+{
+public:
+    LegacySemaphore() : m_semaphore(xSemaphoreCreateMutex()), m_owner("<N/A>") {}
+    ~LegacySemaphore() { vSemaphoreDelete(m_semaphore); }
+    void take(std::string owner)
+    {
+        xSemaphoreTake(m_semaphore, portMAX_DELAY);
+        m_owner = owner;
+    }
+    void give()
+    {
+        m_owner = std::string("<N/A>");
+        xSemaphoreGive(m_semaphore);
+    }
+
+private:
+    SemaphoreHandle_t m_semaphore;
+    std::string m_owner;
+};
+
+// The longest tag in the BLE classes and the one of the RSSI query
+static const char LONG_TAG[] = "registerForNotify";
+static const char SHORT_TAG[] = "getRssi";
+
+static void report(const char *name, int64_t ns, size_t pairs, size_t allocations)
+{
+    printf("%-34s %6.1f ns per take/give  %4.2f allocations\n", name, (double)ns / pairs, (double)allocations / pairs);
+}
+
+template <typename Take, typename Give>
+static void run_uncontended(const char *name, Take take, Give give)
+{
+    size_t allocations = s_allocations;
+    int64_t start = now_ns();
+    for (size_t i = 0; i < BENCH_PAIRS; i++)
+    {
+        take();
+        give();
+    }
+    int64_t ns = now_ns() - start;
+    report(name, ns, BENCH_PAIRS, s_allocations - allocations);
+}
+
+// Threads take turns on one semaphore, every take after a switch has to wait
+static void run_contended(size_t threads)
+{
+    FreeRTOS::Semaphore semaphore("bench");
+    int64_t start = now_ns();
+    std::vector<std::thread> takers;
+    for (size_t t = 0; t < threads; t++)
+    {
+        takers.emplace_back([&semaphore]() {
+            for (size_t i = 0; i < CONTENDED_PAIRS; i++)
+            {
+                semaphore.take(SHORT_TAG);
+                semaphore.give();
+            }
+        });
+    }
+    for (auto &taker : takers)
+    {
+        taker.join();
+    }
+    int64_t ns = now_ns() - start;
+    FreeRTOS::Semaphore::Stats stats = semaphore.getStats();
+    CHECK(stats.takeCount == threads * CONTENDED_PAIRS && stats.timeoutCount == 0);
+    printf("Semaphore, %zu threads %19.1f ns per take/give  %u contended, longest wait %u us\n", threads,
+           (double)ns / stats.takeCount, stats.contentionCount, stats.maxWaitUs);
+}
+
+int main()
+{
+    esp_log_level_set("*", ESP_LOG_NONE);
+    SemaphoreHandle_t raw = xSemaphoreCreateMutex();
+    run_uncontended(
+        "xSemaphoreTake/Give", [raw]() { xSemaphoreTake(raw, portMAX_DELAY); }, [raw]() { xSemaphoreGive(raw); });
+    vSemaphoreDelete(raw);
+
+    LegacySemaphore legacy;
+    run_uncontended(
+        "std::string owner, short tag", [&legacy]() { legacy.take(SHORT_TAG); }, [&legacy]() { legacy.give(); });
+    run_uncontended(
+        "std::string owner, long tag", [&legacy]() { legacy.take(LONG_TAG); }, [&legacy]() { legacy.give(); });
+
+    FreeRTOS::Semaphore semaphore("bench");
+    run_uncontended(
+        "Semaphore, short tag", [&semaphore]() { semaphore.take(SHORT_TAG); }, [&semaphore]() { semaphore.give(); });
+    run_uncontended(
+        "Semaphore, long tag", [&semaphore]() { semaphore.take(LONG_TAG); }, [&semaphore]() { semaphore.give(); });
+    FreeRTOS::Semaphore::Stats stats = semaphore.getStats();
+    CHECK(stats.takeCount == 2 * BENCH_PAIRS && stats.contentionCount == 0);
+
+    run_contended(2);
+    run_contended(4);
+    return 0;
+}
@@ -0,0 +1,131 @@
+#include "WebSocket.h"
+
+#include <sched.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "esp_log.h"
+
+#include "check.h"
+
+#define PORT 18635
+#define BENCH_FRAMES 10000
+#define BATCH_FRAMES 50
+
+// What the gateway pushes to the web UI on every reading
+static const std::string DATA = "{\"unit\":\"C\",\"probes\":[{\"t\":21.5},{\"t\":64.0},{\"t\":null},{\"t\":null}]}";
+
+// Counts what a client received, the sender waits for every client after each batch
+static void read_bytes(int fd, size_t length, std::atomic<size_t> *received)
+{
+    char buf[16384];
+    while (*received < length)
+    {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        CHECK(n > 0);
+        *received += n;
+    }
+}
+
+static void connect_clients(Socket *listener, int clients, std::vector<int> *fds, std::vector<WebSocket *> *sockets)
+{
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    for (int i = 0; i < clients; i++)
+    {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        CHECK(connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+        fds->push_back(fd);
+        sockets->push_back(new WebSocket(listener->accept()));
+    }
+}
+
+// Sends every frame to every client, either through the broadcaster or with a send per client, and
+// returns frames per second.  The frames go out in batches that fit the socket buffers, so that the
+// broadcaster never has to drop a client that is just slow to be scheduled.
+static double bench(Socket *listener, int clients, bool broadcast)
+{
+    std::vector<int> fds;
+    std::vector<WebSocket *> sockets;
+    connect_clients(listener, clients, &fds, &sockets);
+    WebSocketBroadcaster broadcaster(64 * 1024);
+    if (broadcast)
+    {
+        for (WebSocket *pWebSocket : sockets)
+        {
+            broadcaster.addSubscriber(pWebSocket);
+        }
+    }
+    uint8_t header[WebSocket::MAX_FRAME_HEADER];
+    size_t frame_length = WebSocket::buildFrameHeader(header, 0x01, DATA.size()) + DATA.size();
+
+    std::vector<std::atomic<size_t>> received(clients);
+    std::vector<std::thread> readers;
+    for (int i = 0; i < clients; i++)
+    {
+        received[i] = 0;
+        readers.push_back(std::thread(read_bytes, fds[i], frame_length * BENCH_FRAMES, &received[i]));
+    }
+    int64_t start = now_ns();
+    for (int sent = 0; sent < BENCH_FRAMES; )
+    {
+        for (int i = 0; i < BATCH_FRAMES; i++, sent++)
+        {
+            if (broadcast)
+            {
+                broadcaster.broadcast(DATA);
+            }
+            else
+            {
+                for (WebSocket *pWebSocket : sockets)
+                {
+                    pWebSocket->send(DATA, WebSocket::SEND_TYPE_TEXT);
+                }
+            }
+        }
+        for (int i = 0; i < clients; i++)
+        {
+            while (received[i] < frame_length * sent)
+            {
+                sched_yield();
+            }
+        }
+    }
+    double seconds = (now_ns() - start) / 1e9;
+    for (auto &reader : readers)
+    {
+        reader.join();
+    }
+    CHECK(broadcaster.getDroppedCount() == 0 && broadcaster.getSubscriberCount() == (broadcast ? (size_t)clients : 0));
+    for (size_t i = 0; i < sockets.size(); i++)
+    {
+        delete sockets[i];
+        close(fds[i]);
+    }
+    return BENCH_FRAMES / seconds;
+}
+
+int main()
+{
+    esp_log_level_set("*", ESP_LOG_NONE);
+    Socket listener;
+    CHECK(listener.listen(PORT, false, true) == 0);
+    printf("%d frames of %zu bytes to every client\n", BENCH_FRAMES, DATA.size());
+    int counts[] = {1, 8, 32, 64};
+    for (int clients : counts)
+    {
+        double direct = bench(&listener, clients, false);
+        double broadcast = bench(&listener, clients, true);
+        printf("%2d clients  send loop %8.0f frames/s %9.0f client frames/s  broadcaster %8.0f frames/s "
+               "%9.0f client frames/s  %.2fx\n",
+               clients, direct, direct * clients, broadcast, broadcast * clients, broadcast / direct);
+    }
+    listener.close();
+    return 0;
+}
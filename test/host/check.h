@@ -0,0 +1,37 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+// Aborts the test with the failed expression, the sanitizers already report everything else
+#define CHECK(expr)                                                                   \
+    do                                                                                \
+    {                                                                                 \
+        if (!(expr))                                                                  \
+        {                                                                             \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #expr); \
+            abort();                                                                  \
+        }                                                                             \
+    } while (0)
+
+static inline int64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Deterministic, so a failing fuzz run can be repeated with the printed seed
+static inline uint32_t xorshift(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+#endif
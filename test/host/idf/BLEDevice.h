@@ -0,0 +1,9 @@
+#ifndef HOST_BLEDEVICE_H
+#define HOST_BLEDEVICE_H
+
+// ibbq.h only keeps pointers to these, the BLE stack itself doesn't exist on the host
+
+class BLEScan;
+class BLEClient;
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef HOST_CJSON_H
+#define HOST_CJSON_H
+
+// Only the allocation hooks of cJSON, code that builds or prints trees is not built on the host
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef struct cJSON_Hooks
+    {
+        void *(*malloc_fn)(size_t sz);
+        void (*free_fn)(void *ptr);
+    } cJSON_Hooks;
+
+    // NULL hooks restore malloc and free
+    void cJSON_InitHooks(cJSON_Hooks *hooks);
+    // What every node and printed string of cJSON is allocated and freed with
+    void *cJSON_malloc(size_t size);
+    void cJSON_free(void *object);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,23 @@
+// The allocation hooks of cJSON on the host
+
+#include <stdlib.h>
+#include "cJSON.h"
+
+static void *(*malloc_fn)(size_t) = malloc;
+static void (*free_fn)(void *) = free;
+
+void cJSON_InitHooks(cJSON_Hooks *hooks)
+{
+    malloc_fn = hooks != NULL && hooks->malloc_fn != NULL ? hooks->malloc_fn : malloc;
+    free_fn = hooks != NULL && hooks->free_fn != NULL ? hooks->free_fn : free;
+}
+
+void *cJSON_malloc(size_t size)
+{
+    return malloc_fn(size);
+}
+
+void cJSON_free(void *object)
+{
+    free_fn(object);
+}
@@ -0,0 +1,204 @@
+// Event loops of esp_event and the system event loop of ESP-IDF 3.3 on the host
+
+#include <string.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include "esp_event.h"
+#include "esp_event_loop.h"
+#include "freertos/task.h"
+
+struct host_event_handler
+{
+    esp_event_base_t base;
+    int32_t id;
+    esp_event_handler_t handler;
+    void *arg;
+};
+
+struct host_event
+{
+    esp_event_base_t base;
+    int32_t id;
+    std::vector<uint8_t> data;
+};
+
+struct host_event_loop
+{
+    std::mutex mutex;
+    // Signals events and the stop request to the task
+    std::condition_variable pending;
+    // Signals room in the queue and the end of the task
+    std::condition_variable room;
+    std::deque<host_event> queue;
+    size_t queue_size;
+    std::vector<host_event_handler> handlers;
+    bool stop;
+    bool stopped;
+};
+
+static void loop_task(void *arg)
+{
+    host_event_loop *loop = (host_event_loop *)arg;
+    std::unique_lock<std::mutex> lock(loop->mutex);
+    for (;;)
+    {
+        loop->pending.wait(lock, [loop] { return loop->stop || !loop->queue.empty(); });
+        if (loop->stop)
+        {
+            break;
+        }
+        host_event event = std::move(loop->queue.front());
+        loop->queue.pop_front();
+        loop->room.notify_all();
+        // Handlers may register others or post to the same loop
+        std::vector<host_event_handler> handlers = loop->handlers;
+        lock.unlock();
+        for (const host_event_handler &h : handlers)
+        {
+            if ((h.base == ESP_EVENT_ANY_BASE || h.base == event.base) && (h.id == ESP_EVENT_ANY_ID || h.id == event.id))
+            {
+                h.handler(h.arg, event.base, event.id, event.data.empty() ? NULL : event.data.data());
+            }
+        }
+        lock.lock();
+    }
+    loop->stopped = true;
+    loop->room.notify_all();
+    lock.unlock();
+    vTaskDelete(NULL);
+}
+
+esp_err_t esp_event_loop_create(const esp_event_loop_args_t *args, esp_event_loop_handle_t *loop)
+{
+    if (args == NULL || loop == NULL || args->task_name == NULL || args->queue_size <= 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    host_event_loop *l = new host_event_loop();
+    l->queue_size = args->queue_size;
+    if (xTaskCreatePinnedToCore(loop_task, args->task_name, args->task_stack_size, l, args->task_priority, NULL,
+                                args->task_core_id) != pdPASS)
+    {
+        delete l;
+        return ESP_ERR_NO_MEM;
+    }
+    *loop = l;
+    return ESP_OK;
+}
+
+esp_err_t esp_event_loop_delete(esp_event_loop_handle_t loop)
+{
+    {
+        std::unique_lock<std::mutex> lock(loop->mutex);
+        loop->stop = true;
+        loop->pending.notify_all();
+        loop->room.wait(lock, [loop] { return loop->stopped; });
+    }
+    delete loop;
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_register_with(esp_event_loop_handle_t loop, esp_event_base_t base, int32_t id,
+                                          esp_event_handler_t handler, void *handler_arg)
+{
+    if (loop == NULL || handler == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    std::lock_guard<std::mutex> lock(loop->mutex);
+    loop->handlers.push_back({base, id, handler, handler_arg});
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_unregister_with(esp_event_loop_handle_t loop, esp_event_base_t base, int32_t id,
+                                            esp_event_handler_t handler)
+{
+    std::lock_guard<std::mutex> lock(loop->mutex);
+    for (size_t i = 0; i < loop->handlers.size(); i++)
+    {
+        const host_event_handler &h = loop->handlers[i];
+        if (h.base == base && h.id == id && h.handler == handler)
+        {
+            loop->handlers.erase(loop->handlers.begin() + i);
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t esp_event_post_to(esp_event_loop_handle_t loop, esp_event_base_t base, int32_t id, void *data,
+                            size_t size, TickType_t ticks)
+{
+    if (loop == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    std::unique_lock<std::mutex> lock(loop->mutex);
+    auto has_room = [loop] { return loop->queue.size() < loop->queue_size; };
+    if (ticks == portMAX_DELAY)
+    {
+        loop->room.wait(lock, has_room);
+    }
+    else if (!loop->room.wait_for(lock, std::chrono::milliseconds((uint64_t)ticks * portTICK_PERIOD_MS), has_room))
+    {
+        return ESP_ERR_TIMEOUT;
+    }
+    host_event event;
+    event.base = base;
+    event.id = id;
+    if (data != NULL && size > 0)
+    {
+        event.data.assign((const uint8_t *)data, (const uint8_t *)data + size);
+    }
+    loop->queue.push_back(std::move(event));
+    loop->pending.notify_one();
+    return ESP_OK;
+}
+
+// The system event loop is an esp_event loop with a single handler for all events
+
+#define SYSTEM_EVENT_QUEUE_SIZE 32
+#define SYSTEM_EVENT_TASK_STACK_SIZE 2304
+
+static esp_event_base_t SYSTEM_EVENT = "SYSTEM_EVENT";
+static esp_event_loop_handle_t system_loop = NULL;
+static system_event_cb_t system_cb = NULL;
+static void *system_ctx = NULL;
+
+static void system_event_handler(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    system_cb(system_ctx, (system_event_t *)data);
+}
+
+esp_err_t esp_event_loop_init(system_event_cb_t cb, void *ctx)
+{
+    if (system_loop != NULL)
+    {
+        return ESP_FAIL;
+    }
+    system_cb = cb;
+    system_ctx = ctx;
+    esp_event_loop_args_t args = {};
+    args.queue_size = SYSTEM_EVENT_QUEUE_SIZE;
+    args.task_name = "eventTask";
+    args.task_priority = configMAX_PRIORITIES - 5;
+    args.task_stack_size = SYSTEM_EVENT_TASK_STACK_SIZE;
+    args.task_core_id = 0;
+    esp_err_t ret = esp_event_loop_create(&args, &system_loop);
+    if (ret == ESP_OK)
+    {
+        ret = esp_event_handler_register_with(system_loop, SYSTEM_EVENT, ESP_EVENT_ANY_ID, system_event_handler, NULL);
+    }
+    return ret;
+}
+
+esp_err_t esp_event_send(system_event_t *event)
+{
+    if (system_loop == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return esp_event_post_to(system_loop, SYSTEM_EVENT, event->event_id, event, sizeof(*event), portMAX_DELAY);
+}
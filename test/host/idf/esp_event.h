@@ -0,0 +1,39 @@
+#ifndef HOST_ESP_EVENT_H
+#define HOST_ESP_EVENT_H
+
+#include <stddef.h>
+#include "esp_err.h"
+#include "esp_event_base.h"
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef struct
+    {
+        int32_t queue_size;
+        const char *task_name;
+        UBaseType_t task_priority;
+        uint32_t task_stack_size;
+        BaseType_t task_core_id;
+    } esp_event_loop_args_t;
+
+    // Every loop has a task of its own, loops without a task are not supported
+    esp_err_t esp_event_loop_create(const esp_event_loop_args_t *args, esp_event_loop_handle_t *loop);
+    // Waits for the handler that runs, events still in the queue are dropped
+    esp_err_t esp_event_loop_delete(esp_event_loop_handle_t loop);
+    esp_err_t esp_event_handler_register_with(esp_event_loop_handle_t loop, esp_event_base_t base, int32_t id,
+                                              esp_event_handler_t handler, void *handler_arg);
+    esp_err_t esp_event_handler_unregister_with(esp_event_loop_handle_t loop, esp_event_base_t base, int32_t id,
+                                                esp_event_handler_t handler);
+    // The data is copied, ESP_ERR_TIMEOUT if the queue stays full for ticks
+    esp_err_t esp_event_post_to(esp_event_loop_handle_t loop, esp_event_base_t base, int32_t id, void *data,
+                                size_t size, TickType_t ticks);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef HOST_ESP_EVENT_BASE_H
+#define HOST_ESP_EVENT_BASE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef const char *esp_event_base_t;
+    typedef struct host_event_loop *esp_event_loop_handle_t;
+    typedef void (*esp_event_handler_t)(void *handler_arg, esp_event_base_t base, int32_t id, void *event_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define ESP_EVENT_DECLARE_BASE(id) extern esp_event_base_t id
+#define ESP_EVENT_DEFINE_BASE(id) esp_event_base_t id = #id;
+
+#define ESP_EVENT_ANY_BASE NULL
+#define ESP_EVENT_ANY_ID -1
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef HOST_ESP_EVENT_LOOP_H
+#define HOST_ESP_EVENT_LOOP_H
+
+// The system event loop of ESP-IDF 3.3, as far as the WiFi code uses it
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_event.h"
+#include "tcpip_adapter.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef enum
+    {
+        SYSTEM_EVENT_WIFI_READY = 0,
+        SYSTEM_EVENT_SCAN_DONE,
+        SYSTEM_EVENT_STA_START,
+        SYSTEM_EVENT_STA_STOP,
+        SYSTEM_EVENT_STA_CONNECTED,
+        SYSTEM_EVENT_STA_DISCONNECTED,
+        SYSTEM_EVENT_STA_AUTHMODE_CHANGE,
+        SYSTEM_EVENT_STA_GOT_IP,
+        SYSTEM_EVENT_STA_LOST_IP,
+        SYSTEM_EVENT_STA_WPS_ER_SUCCESS,
+        SYSTEM_EVENT_STA_WPS_ER_FAILED,
+        SYSTEM_EVENT_STA_WPS_ER_TIMEOUT,
+        SYSTEM_EVENT_STA_WPS_ER_PIN,
+        SYSTEM_EVENT_STA_WPS_ER_PBC_OVERLAP,
+        SYSTEM_EVENT_AP_START,
+        SYSTEM_EVENT_AP_STOP,
+        SYSTEM_EVENT_AP_STACONNECTED,
+        SYSTEM_EVENT_AP_STADISCONNECTED,
+        SYSTEM_EVENT_AP_STAIPASSIGNED,
+        SYSTEM_EVENT_AP_PROBEREQRECVED,
+        SYSTEM_EVENT_GOT_IP6,
+        SYSTEM_EVENT_MAX
+    } system_event_id_t;
+
+#define SYSTEM_EVENT_AP_STA_GOT_IP6 SYSTEM_EVENT_GOT_IP6
+
+    typedef struct
+    {
+        uint8_t ssid[32];
+        uint8_t ssid_len;
+        uint8_t bssid[6];
+        uint8_t reason;
+    } system_event_sta_disconnected_t;
+
+    typedef struct
+    {
+        tcpip_adapter_ip_info_t ip_info;
+        bool ip_changed;
+    } system_event_sta_got_ip_t;
+
+    typedef struct
+    {
+        uint8_t mac[6];
+        uint8_t aid;
+    } system_event_ap_staconnected_t;
+
+    typedef system_event_ap_staconnected_t system_event_ap_stadisconnected_t;
+
+    typedef union
+    {
+        system_event_sta_disconnected_t disconnected;
+        system_event_sta_got_ip_t got_ip;
+        system_event_ap_staconnected_t sta_connected;
+        system_event_ap_stadisconnected_t sta_disconnected;
+    } system_event_info_t;
+
+    typedef struct
+    {
+        system_event_id_t event_id;
+        system_event_info_t event_info;
+    } system_event_t;
+
+    typedef esp_err_t (*system_event_cb_t)(void *ctx, system_event_t *event);
+
+    // Starts the event task that calls cb for every event, like the system event loop of the device
+    esp_err_t esp_event_loop_init(system_event_cb_t cb, void *ctx);
+    // Queues an event for cb, the WiFi driver and tests post with it
+    esp_err_t esp_event_send(system_event_t *event);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef HOST_ESP_HEAP_CAPS_H
+#define HOST_ESP_HEAP_CAPS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_DEFAULT (1 << 12)
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Both are esp_get_free_heap_size, the host heap isn't fragmented in a way that can be seen
+    size_t heap_caps_get_free_size(uint32_t caps);
+    size_t heap_caps_get_largest_free_block(uint32_t caps);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,247 @@
+// esp_http_client on the host, a blocking HTTP/1.1 client that keeps its connection open like the IDF one
+
+#include "esp_http_client.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <string>
+#include <vector>
+
+struct esp_http_client
+{
+    std::string host;
+    std::string port;
+    std::string path;
+    esp_http_client_method_t method;
+    int timeout_ms;
+    std::vector<std::pair<std::string, std::string>> headers;
+    const char *post_data;
+    int post_len;
+    int fd;
+    int status;
+    uint32_t connections;
+};
+
+static bool parse_url(const char *url, esp_http_client *client)
+{
+    const char *scheme = "http://";
+    if (strncmp(url, scheme, strlen(scheme)) != 0)
+    {
+        return false;
+    }
+    const char *host = url + strlen(scheme);
+    const char *path = strchr(host, '/');
+    std::string authority = path != NULL ? std::string(host, path - host) : std::string(host);
+    client->path = path != NULL ? path : "/";
+    size_t colon = authority.find(':');
+    client->host = authority.substr(0, colon);
+    client->port = colon != std::string::npos ? authority.substr(colon + 1) : "80";
+    return !client->host.empty();
+}
+
+static void disconnect(esp_http_client *client)
+{
+    if (client->fd >= 0)
+    {
+        close(client->fd);
+        client->fd = -1;
+    }
+}
+
+static bool connect_to_server(esp_http_client *client)
+{
+    struct addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo *addrs = NULL;
+    if (getaddrinfo(client->host.c_str(), client->port.c_str(), &hints, &addrs) != 0)
+    {
+        return false;
+    }
+    int fd = socket(addrs->ai_family, addrs->ai_socktype, 0);
+    bool connected = fd >= 0 && connect(fd, addrs->ai_addr, addrs->ai_addrlen) == 0;
+    freeaddrinfo(addrs);
+    if (!connected)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return false;
+    }
+    struct timeval timeout = {client->timeout_ms / 1000, (client->timeout_ms % 1000) * 1000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    // Headers and body go out in two writes, with Nagle the body waits for the delayed ACK of the headers
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    client->fd = fd;
+    client->connections++;
+    return true;
+}
+
+static bool send_all(int fd, const char *data, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n <= 0)
+        {
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+// Reads the status line, the headers and a body of Content-Length bytes, which is thrown away
+static bool read_response(esp_http_client *client, bool *keep_alive)
+{
+    std::string head;
+    char c;
+    while (head.size() < 4 || head.compare(head.size() - 4, 4, "\r\n\r\n") != 0)
+    {
+        if (recv(client->fd, &c, 1, 0) != 1 || head.size() > 8192)
+        {
+            return false;
+        }
+        head += c;
+    }
+    if (sscanf(head.c_str(), "HTTP/1.%*d %d", &client->status) != 1)
+    {
+        return false;
+    }
+    size_t content_length = 0;
+    *keep_alive = true;
+    for (size_t pos = head.find("\r\n") + 2; pos < head.size() - 2; pos = head.find("\r\n", pos) + 2)
+    {
+        const char *line = head.c_str() + pos;
+        if (strncasecmp(line, "Content-Length:", 15) == 0)
+        {
+            content_length = strtoul(line + 15, NULL, 10);
+        }
+        else if (strncasecmp(line, "Connection:", 11) == 0 && strncasecmp(line + 11, " close", 6) == 0)
+        {
+            *keep_alive = false;
+        }
+    }
+    char buf[512];
+    while (content_length > 0)
+    {
+        ssize_t n = recv(client->fd, buf, content_length < sizeof(buf) ? content_length : sizeof(buf), 0);
+        if (n <= 0)
+        {
+            return false;
+        }
+        content_length -= n;
+    }
+    return true;
+}
+
+static esp_err_t request(esp_http_client *client)
+{
+    std::string head = std::string(client->method == HTTP_METHOD_POST ? "POST " : "GET ") + client->path +
+                       " HTTP/1.1\r\nHost: " + client->host + "\r\n";
+    for (const auto &header : client->headers)
+    {
+        head += header.first + ": " + header.second + "\r\n";
+    }
+    head += "Content-Length: " + std::to_string(client->post_data != NULL ? client->post_len : 0) + "\r\n\r\n";
+    bool keep_alive;
+    if (!send_all(client->fd, head.data(), head.size()) ||
+        (client->post_data != NULL && !send_all(client->fd, client->post_data, client->post_len)) ||
+        !read_response(client, &keep_alive))
+    {
+        disconnect(client);
+        return ESP_FAIL;
+    }
+    if (!keep_alive)
+    {
+        disconnect(client);
+    }
+    return ESP_OK;
+}
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config)
+{
+    esp_http_client *client = new esp_http_client();
+    if (config->url == NULL || !parse_url(config->url, client))
+    {
+        delete client;
+        return NULL;
+    }
+    client->method = config->method;
+    client->timeout_ms = config->timeout_ms > 0 ? config->timeout_ms : 5000;
+    client->post_data = NULL;
+    client->post_len = 0;
+    client->fd = -1;
+    client->status = 0;
+    client->connections = 0;
+    return client;
+}
+
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t client, const char *key, const char *value)
+{
+    for (auto &header : client->headers)
+    {
+        if (strcasecmp(header.first.c_str(), key) == 0)
+        {
+            header.second = value;
+            return ESP_OK;
+        }
+    }
+    client->headers.push_back(std::make_pair(std::string(key), std::string(value)));
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_post_field(esp_http_client_handle_t client, const char *data, int len)
+{
+    client->post_data = data;
+    client->post_len = len;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_perform(esp_http_client_handle_t client)
+{
+    client->status = 0;
+    bool reused = client->fd >= 0;
+    if (!reused && !connect_to_server(client))
+    {
+        return ESP_FAIL;
+    }
+    esp_err_t err = request(client);
+    // The server may have closed a kept-alive connection in the meantime, that is retried once
+    if (err != ESP_OK && reused && connect_to_server(client))
+    {
+        err = request(client);
+    }
+    return err;
+}
+
+int esp_http_client_get_status_code(esp_http_client_handle_t client)
+{
+    return client->status;
+}
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client)
+{
+    if (client != NULL)
+    {
+        disconnect(client);
+        delete client;
+    }
+    return ESP_OK;
+}
+
+uint32_t host_http_client_connections(esp_http_client_handle_t client)
+{
+    return client->connections;
+}
@@ -0,0 +1,45 @@
+#ifndef HOST_ESP_HTTP_CLIENT_H
+#define HOST_ESP_HTTP_CLIENT_H
+
+// Plain HTTP over a kept-alive socket, enough to POST to a server on localhost. No TLS, no redirects,
+// no chunked responses.
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef enum
+    {
+        HTTP_METHOD_GET = 0,
+        HTTP_METHOD_POST,
+    } esp_http_client_method_t;
+
+    typedef struct
+    {
+        const char *url;
+        esp_http_client_method_t method;
+        int timeout_ms;
+    } esp_http_client_config_t;
+
+    typedef struct esp_http_client *esp_http_client_handle_t;
+
+    esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config);
+    esp_err_t esp_http_client_set_header(esp_http_client_handle_t client, const char *key, const char *value);
+    // The data is not copied, it has to stay valid until esp_http_client_perform() returns
+    esp_err_t esp_http_client_set_post_field(esp_http_client_handle_t client, const char *data, int len);
+    esp_err_t esp_http_client_perform(esp_http_client_handle_t client);
+    int esp_http_client_get_status_code(esp_http_client_handle_t client);
+    esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client);
+
+    // Connections the client opened, a kept-alive connection is counted once
+    uint32_t host_http_client_connections(esp_http_client_handle_t client);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,62 @@
+// httpd on the host keeps the heap the server of the device takes, but doesn't listen
+
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "esp_http_server.h"
+
+struct host_httpd
+{
+    httpd_config_t config;
+    // The task stack and the handler table are what the server of the device allocates
+    void *stack;
+    std::vector<httpd_uri_t> handlers;
+};
+
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config)
+{
+    if (handle == NULL || config == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    host_httpd *server = new host_httpd();
+    server->config = *config;
+    server->stack = malloc(config->stack_size);
+    server->handlers.reserve(config->max_uri_handlers);
+    *handle = server;
+    return ESP_OK;
+}
+
+esp_err_t httpd_stop(httpd_handle_t handle)
+{
+    host_httpd *server = (host_httpd *)handle;
+    if (server == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    free(server->stack);
+    delete server;
+    return ESP_OK;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler)
+{
+    host_httpd *server = (host_httpd *)handle;
+    if (server == NULL || uri_handler == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (const httpd_uri_t &h : server->handlers)
+    {
+        if (h.method == uri_handler->method && strcmp(h.uri, uri_handler->uri) == 0)
+        {
+            return ESP_ERR_HTTPD_HANDLER_EXISTS;
+        }
+    }
+    if (server->handlers.size() == server->config.max_uri_handlers)
+    {
+        return ESP_ERR_HTTPD_HANDLERS_FULL;
+    }
+    server->handlers.push_back(*uri_handler);
+    return ESP_OK;
+}
@@ -0,0 +1,93 @@
+#ifndef HOST_ESP_HTTP_SERVER_H
+#define HOST_ESP_HTTP_SERVER_H
+
+// The server keeps its handlers, it doesn't listen on a socket
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define ESP_ERR_HTTPD_BASE 0x8000
+#define ESP_ERR_HTTPD_HANDLERS_FULL (ESP_ERR_HTTPD_BASE + 1)
+#define ESP_ERR_HTTPD_HANDLER_EXISTS (ESP_ERR_HTTPD_BASE + 2)
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef void *httpd_handle_t;
+
+    typedef enum
+    {
+        HTTP_DELETE = 0,
+        HTTP_GET,
+        HTTP_HEAD,
+        HTTP_POST,
+        HTTP_PUT,
+    } httpd_method_t;
+
+    typedef struct httpd_req
+    {
+        httpd_handle_t handle;
+        int method;
+        const char uri[512 + 1];
+        size_t content_len;
+        void *aux;
+        void *user_ctx;
+        void *sess_ctx;
+    } httpd_req_t;
+
+    typedef struct httpd_uri
+    {
+        const char *uri;
+        httpd_method_t method;
+        esp_err_t (*handler)(httpd_req_t *r);
+        void *user_ctx;
+    } httpd_uri_t;
+
+    typedef struct httpd_config
+    {
+        unsigned task_priority;
+        size_t stack_size;
+        BaseType_t core_id;
+        uint16_t server_port;
+        uint16_t ctrl_port;
+        uint16_t max_open_sockets;
+        uint16_t max_uri_handlers;
+        uint16_t max_resp_headers;
+        uint16_t backlog_conn;
+        bool lru_purge_enable;
+        uint16_t recv_wait_timeout;
+        uint16_t send_wait_timeout;
+    } httpd_config_t;
+
+#define HTTPD_DEFAULT_CONFIG()                  \
+    {                                           \
+        .task_priority = tskIDLE_PRIORITY + 5,  \
+        .stack_size = 4096,                     \
+        .core_id = tskNO_AFFINITY,              \
+        .server_port = 80,                      \
+        .ctrl_port = 32768,                     \
+        .max_open_sockets = 7,                  \
+        .max_uri_handlers = 8,                  \
+        .max_resp_headers = 8,                  \
+        .backlog_conn = 5,                      \
+        .lru_purge_enable = false,              \
+        .recv_wait_timeout = 5,                 \
+        .send_wait_timeout = 5,                 \
+    }
+
+    // Takes the heap httpd takes on the device for its task and handler table
+    esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config);
+    esp_err_t httpd_stop(httpd_handle_t handle);
+    esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
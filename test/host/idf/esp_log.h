@@ -0,0 +1,37 @@
+#ifndef HOST_ESP_LOG_H
+#define HOST_ESP_LOG_H
+
+#include <stdint.h>
+
+typedef enum
+{
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE
+} esp_log_level_t;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Only the level of all tags, "*", is supported. Tests start with warnings and errors.
+    void esp_log_level_set(const char *tag, esp_log_level_t level);
+    // Adds the level, the time and the tag in front and a line break at the end like ESP-IDF does
+    void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+        __attribute__((format(printf, 3, 4)));
+
+#ifdef __cplusplus
+}
+#endif
+
+#define ESP_LOGE(tag, format, ...) esp_log_write(ESP_LOG_ERROR, tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) esp_log_write(ESP_LOG_WARN, tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) esp_log_write(ESP_LOG_INFO, tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) esp_log_write(ESP_LOG_DEBUG, tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) esp_log_write(ESP_LOG_VERBOSE, tag, format, ##__VA_ARGS__)
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef HOST_ESP_SPIFFS_H
+#define HOST_ESP_SPIFFS_H
+
+// settings.cpp includes this, the host has no SPIFFS partition
+
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    esp_err_t esp_spiffs_info(const char *partition_label, size_t *total_bytes, size_t *used_bytes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,165 @@
+// esp_err, esp_log, the heap and the clock of esp_timer on the host
+
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <malloc.h>
+#include <atomic>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+
+// Provided by ASan and TSan, the tests run with one of them
+extern "C" size_t __sanitizer_get_current_allocated_bytes() __attribute__((weak));
+
+static std::atomic<int> log_level(ESP_LOG_WARN);
+
+static int64_t monotonic_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Taken when the program is loaded, so the first call doesn't return 0
+static const int64_t start_us = monotonic_us();
+
+int64_t esp_timer_get_time()
+{
+    return monotonic_us() - start_us;
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code)
+    {
+    case ESP_OK:
+        return "ESP_OK";
+    case ESP_FAIL:
+        return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:
+        return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:
+        return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE:
+        return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:
+        return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND:
+        return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED:
+        return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT:
+        return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_INVALID_RESPONSE:
+        return "ESP_ERR_INVALID_RESPONSE";
+    case ESP_ERR_INVALID_CRC:
+        return "ESP_ERR_INVALID_CRC";
+    case ESP_ERR_INVALID_VERSION:
+        return "ESP_ERR_INVALID_VERSION";
+    default:
+        return "UNKNOWN ERROR";
+    }
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    log_level = level;
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    if (level > log_level)
+    {
+        return;
+    }
+    static const char letters[] = "NEWIDV";
+    char line[512];
+    int len = snprintf(line, sizeof(line), "%c (%lld) %s: ", letters[level], (long long)(esp_timer_get_time() / 1000), tag);
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line + len, sizeof(line) - len, format, args);
+    va_end(args);
+    // One write per line, so lines of several threads don't mix
+    fprintf(stderr, "%s\n", line);
+}
+
+static size_t allocated_bytes()
+{
+    if (__sanitizer_get_current_allocated_bytes != NULL)
+    {
+        return __sanitizer_get_current_allocated_bytes();
+    }
+    return mallinfo2().uordblks;
+}
+
+static std::atomic<uint32_t> minimum_free(HOST_HEAP_SIZE);
+
+uint32_t esp_get_free_heap_size()
+{
+    size_t allocated = allocated_bytes();
+    uint32_t free = allocated < HOST_HEAP_SIZE ? HOST_HEAP_SIZE - allocated : 0;
+    uint32_t minimum = minimum_free.load();
+    while (free < minimum && !minimum_free.compare_exchange_weak(minimum, free))
+    {
+    }
+    return free;
+}
+
+uint32_t esp_get_minimum_free_heap_size()
+{
+    esp_get_free_heap_size();
+    return minimum_free.load();
+}
+
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+    return esp_get_free_heap_size();
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps)
+{
+    return esp_get_free_heap_size();
+}
+
+static uint8_t base_mac[6] = {0x24, 0x0a, 0xc4, 0x12, 0x34, 0x56};
+
+esp_err_t esp_base_mac_addr_set(uint8_t *mac)
+{
+    // Like the device, a multicast address is refused
+    if (mac[0] & 0x01)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(base_mac, mac, sizeof(base_mac));
+    return ESP_OK;
+}
+
+esp_err_t esp_read_mac(uint8_t *mac, esp_mac_type_t type)
+{
+    memcpy(mac, base_mac, sizeof(base_mac));
+    mac[5] += type;
+    return ESP_OK;
+}
+
+void esp_chip_info(esp_chip_info_t *info)
+{
+    info->model = CHIP_ESP32;
+    info->features = 0;
+    info->cores = portNUM_PROCESSORS;
+    info->revision = 1;
+}
+
+const char *esp_get_idf_version()
+{
+    return "v3.3-host";
+}
+
+void esp_restart()
+{
+    fprintf(stderr, "esp_restart: the firmware gave up\n");
+    abort();
+}
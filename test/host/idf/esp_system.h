@@ -0,0 +1,56 @@
+#ifndef HOST_ESP_SYSTEM_H
+#define HOST_ESP_SYSTEM_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+// The heap of the device, the free size of the host is this minus what the process allocated
+#define HOST_HEAP_SIZE (256 * 1024 * 1024)
+
+#define MACSTR "%02x:%02x:%02x:%02x:%02x:%02x"
+#define MAC2STR(a) (a)[0], (a)[1], (a)[2], (a)[3], (a)[4], (a)[5]
+
+typedef enum
+{
+    ESP_MAC_WIFI_STA,
+    ESP_MAC_WIFI_SOFTAP,
+    ESP_MAC_BT,
+    ESP_MAC_ETH,
+} esp_mac_type_t;
+
+typedef enum
+{
+    CHIP_ESP32 = 1,
+} esp_chip_model_t;
+
+typedef struct
+{
+    esp_chip_model_t model;
+    uint32_t features;
+    uint8_t cores;
+    uint8_t revision;
+} esp_chip_info_t;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Counted by the sanitizer allocator, so tests can check that a loop doesn't leak
+    uint32_t esp_get_free_heap_size();
+    uint32_t esp_get_minimum_free_heap_size();
+    // A fixed address per type, the last byte differs like on the device
+    esp_err_t esp_read_mac(uint8_t *mac, esp_mac_type_t type);
+    // The MACs of the interfaces are derived from it, tests set one per simulated gateway
+    esp_err_t esp_base_mac_addr_set(uint8_t *mac);
+    // An ESP32 with two cores, revision 1
+    void esp_chip_info(esp_chip_info_t *info);
+    const char *esp_get_idf_version();
+    // Ends the test, nothing on the host expects a restart
+    void esp_restart() __attribute__((noreturn));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,160 @@
+// esp_timer on the host, one task runs the callbacks of all timers in the order they expire
+
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define TIMER_TASK_STACK_SIZE 4096
+
+struct host_timer
+{
+    esp_timer_cb_t callback;
+    void *arg;
+    const char *name;
+    bool armed;
+    int64_t expiry_us;
+    uint64_t period_us;
+};
+
+// Like on the device a timer may still be armed when the program ends, the timer task keeps running
+// then. Nothing it touches is destroyed by the static destructors.
+static std::mutex &timers_mutex = *new std::mutex();
+static std::condition_variable &timers_cond = *new std::condition_variable();
+static std::vector<host_timer *> &timers = *new std::vector<host_timer *>();
+// The timer whose callback runs right now, delete waits for it
+static host_timer *running = NULL;
+static TaskHandle_t timer_task_handle = NULL;
+
+static host_timer *next_timer()
+{
+    host_timer *next = NULL;
+    for (host_timer *timer : timers)
+    {
+        if (timer->armed && (next == NULL || timer->expiry_us < next->expiry_us))
+        {
+            next = timer;
+        }
+    }
+    return next;
+}
+
+static void timer_task(void *arg)
+{
+    std::unique_lock<std::mutex> lock(timers_mutex);
+    for (;;)
+    {
+        host_timer *timer = next_timer();
+        if (timer == NULL)
+        {
+            timers_cond.wait(lock);
+            continue;
+        }
+        int64_t now = esp_timer_get_time();
+        if (timer->expiry_us > now)
+        {
+            timers_cond.wait_for(lock, std::chrono::microseconds(timer->expiry_us - now));
+            continue;
+        }
+        if (timer->period_us > 0)
+        {
+            // A late callback doesn't shift the following ones
+            timer->expiry_us += timer->period_us;
+            if (timer->expiry_us < now)
+            {
+                timer->expiry_us = now + timer->period_us;
+            }
+        }
+        else
+        {
+            timer->armed = false;
+        }
+        running = timer;
+        lock.unlock();
+        timer->callback(timer->arg);
+        lock.lock();
+        running = NULL;
+        timers_cond.notify_all();
+    }
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *handle)
+{
+    if (args == NULL || args->callback == NULL || handle == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    host_timer *timer = new host_timer();
+    timer->callback = args->callback;
+    timer->arg = args->arg;
+    timer->name = args->name;
+    std::lock_guard<std::mutex> lock(timers_mutex);
+    if (timer_task_handle == NULL)
+    {
+        xTaskCreate(timer_task, "esp_timer", TIMER_TASK_STACK_SIZE, NULL, configMAX_PRIORITIES - 3, &timer_task_handle);
+    }
+    timers.push_back(timer);
+    *handle = timer;
+    return ESP_OK;
+}
+
+static esp_err_t start(host_timer *timer, uint64_t timeout_us, uint64_t period_us)
+{
+    std::lock_guard<std::mutex> lock(timers_mutex);
+    if (timer->armed)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->armed = true;
+    timer->expiry_us = esp_timer_get_time() + timeout_us;
+    timer->period_us = period_us;
+    timers_cond.notify_all();
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    return start(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us)
+{
+    return start(timer, period_us, period_us);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    std::lock_guard<std::mutex> lock(timers_mutex);
+    if (!timer->armed)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->armed = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    std::unique_lock<std::mutex> lock(timers_mutex);
+    if (timer->armed)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (xTaskGetCurrentTaskHandle() != timer_task_handle)
+    {
+        // A callback may delete its own timer, anybody else waits until it returned
+        timers_cond.wait(lock, [timer] { return running != timer; });
+    }
+    for (size_t i = 0; i < timers.size(); i++)
+    {
+        if (timers[i] == timer)
+        {
+            timers.erase(timers.begin() + i);
+            break;
+        }
+    }
+    delete timer;
+    return ESP_OK;
+}
@@ -0,0 +1,42 @@
+#ifndef HOST_ESP_TIMER_H
+#define HOST_ESP_TIMER_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef struct host_timer *esp_timer_handle_t;
+    typedef void (*esp_timer_cb_t)(void *arg);
+
+    typedef enum
+    {
+        ESP_TIMER_TASK,
+    } esp_timer_dispatch_t;
+
+    typedef struct
+    {
+        esp_timer_cb_t callback;
+        void *arg;
+        esp_timer_dispatch_t dispatch_method;
+        const char *name;
+    } esp_timer_create_args_t;
+
+    // Microseconds since the process started, like the time since boot on the device
+    int64_t esp_timer_get_time();
+
+    // Callbacks run one after the other on a single esp_timer task, like on the device
+    esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *handle);
+    esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us);
+    esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us);
+    esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+    esp_err_t esp_timer_delete(esp_timer_handle_t timer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,215 @@
+// A WiFi driver and TCP/IP adapter for the host. It doesn't touch the network of the host, it only
+// sends the events the driver of the device would send.
+
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <mutex>
+#include "esp_wifi.h"
+#include "tcpip_adapter.h"
+#include "host_wifi.h"
+
+// 127.0.0.1 in network byte order, see tcpip_adapter_get_ip_info
+#define HOST_IP 0x0100007f
+
+static std::mutex wifi_mutex;
+static bool initialised = false;
+static bool started = false;
+static bool connected = false;
+static wifi_mode_t mode = WIFI_MODE_NULL;
+static wifi_config_t sta_config = {};
+static wifi_config_t ap_config = {};
+static std::atomic<bool> reachable(true);
+
+static bool has_sta(wifi_mode_t m)
+{
+    return m == WIFI_MODE_STA || m == WIFI_MODE_APSTA;
+}
+
+static bool has_ap(wifi_mode_t m)
+{
+    return m == WIFI_MODE_AP || m == WIFI_MODE_APSTA;
+}
+
+static void send(system_event_id_t id)
+{
+    system_event_t event = {};
+    event.event_id = id;
+    esp_event_send(&event);
+}
+
+static void send_disconnected(uint8_t reason)
+{
+    system_event_t event = {};
+    event.event_id = SYSTEM_EVENT_STA_DISCONNECTED;
+    memcpy(event.event_info.disconnected.ssid, sta_config.sta.ssid, sizeof(event.event_info.disconnected.ssid));
+    event.event_info.disconnected.reason = reason;
+    esp_event_send(&event);
+}
+
+esp_err_t esp_wifi_init(const wifi_init_config_t *config)
+{
+    std::lock_guard<std::mutex> lock(wifi_mutex);
+    initialised = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_storage(wifi_storage_t storage)
+{
+    return initialised ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t esp_wifi_set_mode(wifi_mode_t m)
+{
+    std::lock_guard<std::mutex> lock(wifi_mutex);
+    if (!initialised || m >= WIFI_MODE_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    mode = m;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_mode(wifi_mode_t *m)
+{
+    std::lock_guard<std::mutex> lock(wifi_mutex);
+    *m = mode;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_config(esp_interface_t interface, wifi_config_t *config)
+{
+    std::lock_guard<std::mutex> lock(wifi_mutex);
+    if (!initialised)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (interface == ESP_IF_WIFI_STA)
+    {
+        sta_config = *config;
+    }
+    else
+    {
+        ap_config = *config;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_start()
+{
+    std::lock_guard<std::mutex> lock(wifi_mutex);
+    if (!initialised)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (started)
+    {
+        return ESP_OK;
+    }
+    started = true;
+    if (has_sta(mode))
+    {
+        send(SYSTEM_EVENT_STA_START);
+    }
+    if (has_ap(mode))
+    {
+        send(SYSTEM_EVENT_AP_START);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_stop()
+{
+    std::lock_guard<std::mutex> lock(wifi_mutex);
+    if (!started)
+    {
+        return ESP_OK;
+    }
+    started = false;
+    if (has_sta(mode))
+    {
+        if (connected)
+        {
+            connected = false;
+            send_disconnected(WIFI_REASON_BEACON_TIMEOUT);
+        }
+        send(SYSTEM_EVENT_STA_STOP);
+    }
+    if (has_ap(mode))
+    {
+        send(SYSTEM_EVENT_AP_STOP);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_connect()
+{
+    std::lock_guard<std::mutex> lock(wifi_mutex);
+    if (!started || !has_sta(mode))
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!reachable)
+    {
+        send_disconnected(WIFI_REASON_NO_AP_FOUND);
+        return ESP_OK;
+    }
+    connected = true;
+    send(SYSTEM_EVENT_STA_CONNECTED);
+    system_event_t event = {};
+    event.event_id = SYSTEM_EVENT_STA_GOT_IP;
+    event.event_info.got_ip.ip_info.ip.addr = HOST_IP;
+    esp_event_send(&event);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_disconnect()
+{
+    std::lock_guard<std::mutex> lock(wifi_mutex);
+    if (!connected)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    connected = false;
+    send_disconnected(WIFI_REASON_BEACON_TIMEOUT);
+    return ESP_OK;
+}
+
+void host_wifi_set_reachable(bool r)
+{
+    reachable = r;
+}
+
+void host_wifi_drop_connection()
+{
+    esp_wifi_disconnect();
+}
+
+void tcpip_adapter_init()
+{
+}
+
+esp_err_t tcpip_adapter_set_hostname(tcpip_adapter_if_t tcpip_if, const char *hostname)
+{
+    return hostname != NULL && strlen(hostname) <= 32 ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t tcpip_adapter_get_ip_info(tcpip_adapter_if_t tcpip_if, tcpip_adapter_ip_info_t *ip_info)
+{
+    if (tcpip_if >= TCPIP_ADAPTER_IF_MAX || ip_info == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ip_info->ip.addr = HOST_IP;
+    ip_info->netmask.addr = 0x000000ff;
+    ip_info->gw.addr = HOST_IP;
+    return ESP_OK;
+}
+
+char *ip4addr_ntoa(const ip4_addr_t *addr)
+{
+    static char buffer[16];
+    const uint8_t *b = (const uint8_t *)&addr->addr;
+    snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", b[0], b[1], b[2], b[3]);
+    return buffer;
+}
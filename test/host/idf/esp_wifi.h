@@ -0,0 +1,145 @@
+#ifndef HOST_ESP_WIFI_H
+#define HOST_ESP_WIFI_H
+
+// A WiFi driver that connects right away when the network is reachable, see host_wifi.h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_system.h"
+#include "esp_event_loop.h"
+
+#define ESP_ERR_WIFI_BASE 0x3000
+#define ESP_ERR_WIFI_NOT_INIT (ESP_ERR_WIFI_BASE + 1)
+#define ESP_ERR_WIFI_NOT_STARTED (ESP_ERR_WIFI_BASE + 2)
+#define ESP_ERR_WIFI_NOT_STOPPED (ESP_ERR_WIFI_BASE + 3)
+#define ESP_ERR_WIFI_IF (ESP_ERR_WIFI_BASE + 4)
+#define ESP_ERR_WIFI_MODE (ESP_ERR_WIFI_BASE + 5)
+#define ESP_ERR_WIFI_STATE (ESP_ERR_WIFI_BASE + 6)
+#define ESP_ERR_WIFI_CONN (ESP_ERR_WIFI_BASE + 7)
+#define ESP_ERR_WIFI_NVS (ESP_ERR_WIFI_BASE + 8)
+#define ESP_ERR_WIFI_MAC (ESP_ERR_WIFI_BASE + 9)
+#define ESP_ERR_WIFI_SSID (ESP_ERR_WIFI_BASE + 10)
+#define ESP_ERR_WIFI_PASSWORD (ESP_ERR_WIFI_BASE + 11)
+#define ESP_ERR_WIFI_TIMEOUT (ESP_ERR_WIFI_BASE + 12)
+#define ESP_ERR_WIFI_WAKE_FAIL (ESP_ERR_WIFI_BASE + 13)
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef enum
+    {
+        WIFI_MODE_NULL = 0,
+        WIFI_MODE_STA,
+        WIFI_MODE_AP,
+        WIFI_MODE_APSTA,
+        WIFI_MODE_MAX
+    } wifi_mode_t;
+
+    typedef enum
+    {
+        ESP_IF_WIFI_STA = 0,
+        ESP_IF_WIFI_AP,
+    } esp_interface_t;
+
+    typedef enum
+    {
+        WIFI_AUTH_OPEN = 0,
+        WIFI_AUTH_WEP,
+        WIFI_AUTH_WPA_PSK,
+        WIFI_AUTH_WPA2_PSK,
+        WIFI_AUTH_WPA_WPA2_PSK,
+        WIFI_AUTH_WPA2_ENTERPRISE,
+        WIFI_AUTH_MAX
+    } wifi_auth_mode_t;
+
+    // The reason of a disconnect event, the host driver only ever reports WIFI_REASON_NO_AP_FOUND
+    typedef enum
+    {
+        WIFI_REASON_UNSPECIFIED = 1,
+        WIFI_REASON_AUTH_EXPIRE = 2,
+        WIFI_REASON_AUTH_LEAVE = 3,
+        WIFI_REASON_ASSOC_EXPIRE = 4,
+        WIFI_REASON_ASSOC_TOOMANY = 5,
+        WIFI_REASON_NOT_AUTHED = 6,
+        WIFI_REASON_NOT_ASSOCED = 7,
+        WIFI_REASON_ASSOC_LEAVE = 8,
+        WIFI_REASON_ASSOC_NOT_AUTHED = 9,
+        WIFI_REASON_DISASSOC_PWRCAP_BAD = 10,
+        WIFI_REASON_DISASSOC_SUPCHAN_BAD = 11,
+        WIFI_REASON_IE_INVALID = 13,
+        WIFI_REASON_MIC_FAILURE = 14,
+        WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT = 15,
+        WIFI_REASON_GROUP_KEY_UPDATE_TIMEOUT = 16,
+        WIFI_REASON_IE_IN_4WAY_DIFFERS = 17,
+        WIFI_REASON_GROUP_CIPHER_INVALID = 18,
+        WIFI_REASON_PAIRWISE_CIPHER_INVALID = 19,
+        WIFI_REASON_AKMP_INVALID = 20,
+        WIFI_REASON_UNSUPP_RSN_IE_VERSION = 21,
+        WIFI_REASON_INVALID_RSN_IE_CAP = 22,
+        WIFI_REASON_802_1X_AUTH_FAILED = 23,
+        WIFI_REASON_CIPHER_SUITE_REJECTED = 24,
+        WIFI_REASON_BEACON_TIMEOUT = 200,
+        WIFI_REASON_NO_AP_FOUND = 201,
+        WIFI_REASON_AUTH_FAIL = 202,
+        WIFI_REASON_ASSOC_FAIL = 203,
+        WIFI_REASON_HANDSHAKE_TIMEOUT = 204,
+    } wifi_err_reason_t;
+
+    typedef enum
+    {
+        WIFI_STORAGE_FLASH,
+        WIFI_STORAGE_RAM,
+    } wifi_storage_t;
+
+    typedef struct
+    {
+        uint8_t ssid[32];
+        uint8_t password[64];
+        uint8_t ssid_len;
+        uint8_t channel;
+        wifi_auth_mode_t authmode;
+        uint8_t ssid_hidden;
+        uint8_t max_connection;
+        uint16_t beacon_interval;
+    } wifi_ap_config_t;
+
+    typedef struct
+    {
+        uint8_t ssid[32];
+        uint8_t password[64];
+        bool bssid_set;
+        uint8_t bssid[6];
+        uint8_t channel;
+    } wifi_sta_config_t;
+
+    typedef union
+    {
+        wifi_ap_config_t ap;
+        wifi_sta_config_t sta;
+    } wifi_config_t;
+
+    typedef struct
+    {
+        int magic;
+    } wifi_init_config_t;
+
+#define WIFI_INIT_CONFIG_DEFAULT() {0}
+
+    esp_err_t esp_wifi_init(const wifi_init_config_t *config);
+    esp_err_t esp_wifi_set_storage(wifi_storage_t storage);
+    esp_err_t esp_wifi_set_mode(wifi_mode_t mode);
+    esp_err_t esp_wifi_get_mode(wifi_mode_t *mode);
+    esp_err_t esp_wifi_set_config(esp_interface_t interface, wifi_config_t *config);
+    esp_err_t esp_wifi_start();
+    esp_err_t esp_wifi_stop();
+    esp_err_t esp_wifi_connect();
+    esp_err_t esp_wifi_disconnect();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
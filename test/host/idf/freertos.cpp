@@ -0,0 +1,364 @@
+// Tasks, notifications and event groups of FreeRTOS on pthreads
+
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "esp_timer.h"
+
+// Host code needs more stack than the same code on the device, TSan alone wants 900 KiB for its
+// thread state. The task gets this much on top of its size and only its own size is reported.
+#define HOST_STACK_EXTRA (1024 * 1024)
+#define STACK_PAINT 0xa5
+
+struct host_task
+{
+    char name[configMAX_TASK_NAME_LEN];
+    UBaseType_t number;
+    UBaseType_t priority;
+    TaskFunction_t function;
+    void *arg;
+    uint32_t stack_size;
+    // NULL for threads that were not created by xTaskCreate
+    uint8_t *stack;
+    size_t host_stack_size;
+    pthread_t thread;
+    clockid_t cpu_clock;
+    bool deleted;
+    // The thread was joined and the stack freed
+    bool reaped;
+    uint32_t cpu_us;
+
+    std::mutex notify_mutex;
+    std::condition_variable notify_cond;
+    uint32_t notify;
+};
+
+struct host_event_group
+{
+    std::mutex mutex;
+    std::condition_variable cond;
+    EventBits_t bits;
+};
+
+// Tasks are never freed, a handle stays valid like a static task on the device. Only the stacks of
+// deleted tasks are. The list outlives the static destructors, threads may still run then.
+static std::mutex tasks_mutex;
+static std::vector<host_task *> &tasks = *new std::vector<host_task *>();
+static UBaseType_t next_task_number = 1;
+static thread_local host_task *current_task = NULL;
+
+// A task that deleted itself is only joined when the next one is created, that's no leak
+extern "C" const char *__tsan_default_options()
+{
+    return "report_thread_leaks=0";
+}
+
+static uint32_t cpu_us(clockid_t clock)
+{
+    struct timespec ts;
+    if (clock_gettime(clock, &ts) != 0)
+    {
+        return 0;
+    }
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
+
+static host_task *add_task(const char *name, uint32_t stack_size, UBaseType_t priority)
+{
+    host_task *task = new host_task();
+    strncpy(task->name, name, configMAX_TASK_NAME_LEN - 1);
+    task->stack_size = stack_size;
+    task->priority = priority;
+    std::lock_guard<std::mutex> lock(tasks_mutex);
+    task->number = next_task_number++;
+    tasks.push_back(task);
+    return task;
+}
+
+static void task_exit(host_task *task)
+{
+    std::lock_guard<std::mutex> lock(tasks_mutex);
+    task->cpu_us = cpu_us(task->cpu_clock);
+    task->deleted = true;
+}
+
+static void *run_task(void *arg)
+{
+    host_task *task = (host_task *)arg;
+    current_task = task;
+    task->function(task->arg);
+    // Returning from a task is an error on the device, here it ends the task like vTaskDelete
+    task_exit(task);
+    return NULL;
+}
+
+// Joins the threads of deleted tasks and frees their stacks, a thread runs on its stack until it ended
+static void reap_tasks()
+{
+    std::vector<host_task *> ended;
+    {
+        std::lock_guard<std::mutex> lock(tasks_mutex);
+        for (host_task *task : tasks)
+        {
+            if (task->deleted && task->stack != NULL && !task->reaped)
+            {
+                task->reaped = true;
+                ended.push_back(task);
+            }
+        }
+    }
+    for (host_task *task : ended)
+    {
+        pthread_join(task->thread, NULL);
+        std::lock_guard<std::mutex> lock(tasks_mutex);
+        free(task->stack);
+        task->stack = NULL;
+    }
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stack_size, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core)
+{
+    reap_tasks();
+    host_task *task = add_task(name, stack_size, priority);
+    task->function = function;
+    task->arg = arg;
+    long page = sysconf(_SC_PAGESIZE);
+    task->host_stack_size = (stack_size + HOST_STACK_EXTRA + page - 1) / page * page;
+    task->stack = (uint8_t *)aligned_alloc(page, task->host_stack_size);
+    memset(task->stack, STACK_PAINT, task->host_stack_size);
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstack(&attr, task->stack, task->host_stack_size);
+    // Holds back the task until its clock is known
+    std::lock_guard<std::mutex> lock(tasks_mutex);
+    int rc = pthread_create(&task->thread, &attr, run_task, task);
+    pthread_attr_destroy(&attr);
+    if (rc != 0)
+    {
+        task->deleted = true;
+        task->reaped = true;
+        free(task->stack);
+        task->stack = NULL;
+        return pdFAIL;
+    }
+    pthread_getcpuclockid(task->thread, &task->cpu_clock);
+    if (handle != NULL)
+    {
+        *handle = task;
+    }
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char *name, uint32_t stack_size, void *arg,
+                       UBaseType_t priority, TaskHandle_t *handle)
+{
+    return xTaskCreatePinnedToCore(function, name, stack_size, arg, priority, handle, tskNO_AFFINITY);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+    if (current_task == NULL)
+    {
+        // The main thread or a thread of a test, it becomes a task on first use
+        host_task *task = add_task("main", 0, 1);
+        task->thread = pthread_self();
+        pthread_getcpuclockid(task->thread, &task->cpu_clock);
+        current_task = task;
+    }
+    return current_task;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    if (task != NULL && task != xTaskGetCurrentTaskHandle())
+    {
+        fprintf(stderr, "vTaskDelete: the host port only lets a task delete itself\n");
+        abort();
+    }
+    task_exit(xTaskGetCurrentTaskHandle());
+    pthread_exit(NULL);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    usleep((useconds_t)ticks * portTICK_PERIOD_MS * 1000);
+}
+
+TickType_t xTaskGetTickCount()
+{
+    return (TickType_t)(esp_timer_get_time() / 1000 / portTICK_PERIOD_MS);
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task)
+{
+    return (task != NULL ? task : xTaskGetCurrentTaskHandle())->priority;
+}
+
+char *pcTaskGetTaskName(TaskHandle_t task)
+{
+    return (task != NULL ? task : xTaskGetCurrentTaskHandle())->name;
+}
+
+// Reads the stack of another thread while it runs, which is fine for the untouched paint
+__attribute__((no_sanitize("address", "thread"))) static uint32_t stack_free(const host_task *task)
+{
+    if (task->stack == NULL)
+    {
+        return 0;
+    }
+    size_t untouched = 0;
+    while (untouched < task->host_stack_size && task->stack[untouched] == STACK_PAINT)
+    {
+        untouched++;
+    }
+    size_t used = task->host_stack_size - untouched;
+    return used < task->stack_size ? task->stack_size - used : 0;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+    return stack_free(task != NULL ? task : xTaskGetCurrentTaskHandle());
+}
+
+UBaseType_t uxTaskGetNumberOfTasks()
+{
+    std::lock_guard<std::mutex> lock(tasks_mutex);
+    UBaseType_t count = 0;
+    for (host_task *task : tasks)
+    {
+        count += !task->deleted;
+    }
+    return count;
+}
+
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *status, UBaseType_t count, uint32_t *total_run_time)
+{
+    std::lock_guard<std::mutex> lock(tasks_mutex);
+    UBaseType_t filled = 0;
+    for (host_task *task : tasks)
+    {
+        if (task->deleted)
+        {
+            continue;
+        }
+        if (filled == count)
+        {
+            return 0;
+        }
+        TaskStatus_t *s = &status[filled++];
+        memset(s, 0, sizeof(*s));
+        s->xHandle = task;
+        s->pcTaskName = task->name;
+        s->xTaskNumber = task->number;
+        s->eCurrentState = eReady;
+        s->uxCurrentPriority = task->priority;
+        s->uxBasePriority = task->priority;
+        s->ulRunTimeCounter = cpu_us(task->cpu_clock);
+        s->usStackHighWaterMark = stack_free(task);
+    }
+    if (total_run_time != NULL)
+    {
+        *total_run_time = (uint32_t)esp_timer_get_time();
+    }
+    return filled;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    {
+        std::lock_guard<std::mutex> lock(task->notify_mutex);
+        task->notify++;
+    }
+    task->notify_cond.notify_one();
+    return pdPASS;
+}
+
+static std::chrono::steady_clock::time_point deadline(TickType_t ticks)
+{
+    return std::chrono::steady_clock::now() + std::chrono::milliseconds((uint64_t)ticks * portTICK_PERIOD_MS);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks)
+{
+    host_task *task = xTaskGetCurrentTaskHandle();
+    std::unique_lock<std::mutex> lock(task->notify_mutex);
+    auto pending = [task] { return task->notify > 0; };
+    if (ticks == portMAX_DELAY)
+    {
+        task->notify_cond.wait(lock, pending);
+    }
+    else
+    {
+        task->notify_cond.wait_until(lock, deadline(ticks), pending);
+    }
+    uint32_t value = task->notify;
+    if (value > 0)
+    {
+        task->notify = clear_on_exit ? 0 : value - 1;
+    }
+    return value;
+}
+
+EventGroupHandle_t xEventGroupCreate()
+{
+    return new host_event_group();
+}
+
+void vEventGroupDelete(EventGroupHandle_t group)
+{
+    delete group;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits)
+{
+    std::lock_guard<std::mutex> lock(group->mutex);
+    group->bits |= bits;
+    group->cond.notify_all();
+    return group->bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits)
+{
+    std::lock_guard<std::mutex> lock(group->mutex);
+    EventBits_t before = group->bits;
+    group->bits &= ~bits;
+    return before;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group)
+{
+    std::lock_guard<std::mutex> lock(group->mutex);
+    return group->bits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear_on_exit,
+                                BaseType_t wait_for_all, TickType_t ticks)
+{
+    std::unique_lock<std::mutex> lock(group->mutex);
+    auto reached = [group, bits, wait_for_all] {
+        return wait_for_all ? (group->bits & bits) == bits : (group->bits & bits) != 0;
+    };
+    if (ticks == portMAX_DELAY)
+    {
+        group->cond.wait(lock, reached);
+    }
+    else
+    {
+        group->cond.wait_until(lock, deadline(ticks), reached);
+    }
+    EventBits_t value = group->bits;
+    if (clear_on_exit && reached())
+    {
+        group->bits &= ~bits;
+    }
+    return value;
+}
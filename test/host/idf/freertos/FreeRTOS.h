@@ -0,0 +1,45 @@
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+// FreeRTOS on top of pthreads, as far as the gateway uses it. Ticks, names and priorities
+// follow the sdkconfig of the device.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+// The FreeRTOSConfig.h of ESP-IDF includes it for configASSERT, code relies on that
+#include <assert.h>
+#include "sdkconfig.h"
+
+#define configTICK_RATE_HZ CONFIG_FREERTOS_HZ
+#define configMAX_TASK_NAME_LEN CONFIG_FREERTOS_MAX_TASK_NAME_LEN
+#define configUSE_TRACE_FACILITY 1
+#define configMAX_PRIORITIES 25
+#define portNUM_PROCESSORS 2
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define pdMS_TO_TICKS(ms) ((TickType_t)((uint64_t)(ms) * configTICK_RATE_HZ / 1000))
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+// Critical sections are a recursive mutex, nothing on the host disables interrupts
+typedef struct
+{
+    pthread_mutex_t mutex;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP}
+#define portENTER_CRITICAL(mux) pthread_mutex_lock(&(mux)->mutex)
+#define portEXIT_CRITICAL(mux) pthread_mutex_unlock(&(mux)->mutex)
+#define portENTER_CRITICAL_ISR(mux) portENTER_CRITICAL(mux)
+#define portEXIT_CRITICAL_ISR(mux) portEXIT_CRITICAL(mux)
+#define portYIELD_FROM_ISR()
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef HOST_FREERTOS_QUEUE_H
+#define HOST_FREERTOS_QUEUE_H
+
+#include "freertos/FreeRTOS.h"
+
+#define errQUEUE_EMPTY pdFALSE
+#define errQUEUE_FULL pdFALSE
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Items are copied into a ring of length slots like on the device. Semaphores are queues
+    // without item storage, only the count is kept.
+    typedef struct host_queue *QueueHandle_t;
+
+    QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size);
+    void vQueueDelete(QueueHandle_t queue);
+    BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks);
+    BaseType_t xQueueSendToBack(QueueHandle_t queue, const void *item, TickType_t ticks);
+    BaseType_t xQueueSendToFront(QueueHandle_t queue, const void *item, TickType_t ticks);
+    BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *woken);
+    BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks);
+    BaseType_t xQueueReceiveFromISR(QueueHandle_t queue, void *item, BaseType_t *woken);
+    BaseType_t xQueuePeek(QueueHandle_t queue, void *item, TickType_t ticks);
+    UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+    UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue);
+    BaseType_t xQueueReset(QueueHandle_t queue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef HOST_FREERTOS_RINGBUF_H
+#define HOST_FREERTOS_RINGBUF_H
+
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef enum
+    {
+        RINGBUF_TYPE_NOSPLIT = 0,
+        RINGBUF_TYPE_ALLOWSPLIT,
+        RINGBUF_TYPE_BYTEBUF,
+        RINGBUF_TYPE_MAX,
+    } ringbuf_type_t;
+
+    // The ring buffer of ESP-IDF 3.3 with its 8 byte item headers and 4 byte alignment, so an item
+    // takes the same space as on the device. Items are never split, an item that does not fit at
+    // the end of the buffer wraps around to its start.
+    typedef struct host_ringbuf *RingbufHandle_t;
+
+    RingbufHandle_t xRingbufferCreate(size_t size, ringbuf_type_t type);
+    void vRingbufferDelete(RingbufHandle_t ringbuf);
+    BaseType_t xRingbufferSend(RingbufHandle_t ringbuf, const void *data, size_t size, TickType_t ticks);
+    BaseType_t xRingbufferSendFromISR(RingbufHandle_t ringbuf, const void *data, size_t size, BaseType_t *woken);
+    void *xRingbufferReceive(RingbufHandle_t ringbuf, size_t *size, TickType_t ticks);
+    void *xRingbufferReceiveFromISR(RingbufHandle_t ringbuf, size_t *size);
+    void *xRingbufferReceiveUpTo(RingbufHandle_t ringbuf, size_t *size, TickType_t ticks, size_t max_size);
+    void vRingbufferReturnItem(RingbufHandle_t ringbuf, void *item);
+    void vRingbufferReturnItemFromISR(RingbufHandle_t ringbuf, void *item, BaseType_t *woken);
+    size_t xRingbufferGetMaxItemSize(RingbufHandle_t ringbuf);
+    size_t xRingbufferGetCurFreeSize(RingbufHandle_t ringbuf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef HOST_FREERTOS_SEMPHR_H
+#define HOST_FREERTOS_SEMPHR_H
+
+#include "freertos/queue.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef QueueHandle_t SemaphoreHandle_t;
+
+    // A mutex starts given and remembers no owner, so there is no priority inheritance
+    SemaphoreHandle_t xSemaphoreCreateBinary();
+    SemaphoreHandle_t xSemaphoreCreateMutex();
+    SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count);
+    BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks);
+    BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+    BaseType_t xSemaphoreTakeFromISR(SemaphoreHandle_t semaphore, BaseType_t *woken);
+    BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t semaphore, BaseType_t *woken);
+    UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t semaphore);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define vSemaphoreDelete(semaphore) vQueueDelete(semaphore)
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef HOST_FREERTOS_TASK_H
+#define HOST_FREERTOS_TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+#define tskIDLE_PRIORITY 0
+#define tskNO_AFFINITY 0x7FFFFFFF
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef struct host_task *TaskHandle_t;
+    // The name of FreeRTOS before 8.0, cpp_utils still uses it
+    typedef TaskHandle_t xTaskHandle;
+    typedef void (*TaskFunction_t)(void *);
+
+    typedef enum
+    {
+        eRunning,
+        eReady,
+        eBlocked,
+        eSuspended,
+        eDeleted
+    } eTaskState;
+
+    typedef struct
+    {
+        TaskHandle_t xHandle;
+        const char *pcTaskName;
+        UBaseType_t xTaskNumber;
+        eTaskState eCurrentState;
+        UBaseType_t uxCurrentPriority;
+        UBaseType_t uxBasePriority;
+        // CPU time of the thread in microseconds
+        uint32_t ulRunTimeCounter;
+        // Bytes of the stack never touched, ESP-IDF also counts in bytes
+        uint32_t usStackHighWaterMark;
+    } TaskStatus_t;
+
+    // Every task is a thread with a stack of the given size, painted so the high water mark
+    // can be found like on the device. Threads that were not created here are tasks as well.
+    BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char *name, uint32_t stack_size, void *arg,
+                                       UBaseType_t priority, TaskHandle_t *handle, BaseType_t core);
+    BaseType_t xTaskCreate(TaskFunction_t task, const char *name, uint32_t stack_size, void *arg,
+                           UBaseType_t priority, TaskHandle_t *handle);
+    // Only a task may delete itself
+    void vTaskDelete(TaskHandle_t task);
+    void vTaskDelay(TickType_t ticks);
+    TickType_t xTaskGetTickCount();
+    TaskHandle_t xTaskGetCurrentTaskHandle();
+    UBaseType_t uxTaskPriorityGet(TaskHandle_t task);
+    char *pcTaskGetTaskName(TaskHandle_t task);
+    UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+    UBaseType_t uxTaskGetNumberOfTasks();
+    // The total run time is the time since the start in microseconds
+    UBaseType_t uxTaskGetSystemState(TaskStatus_t *status, UBaseType_t count, uint32_t *total_run_time);
+
+    BaseType_t xTaskNotifyGive(TaskHandle_t task);
+    uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
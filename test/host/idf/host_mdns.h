@@ -0,0 +1,23 @@
+#ifndef HOST_MDNS_CONTROL_H
+#define HOST_MDNS_CONTROL_H
+
+// Controls the mDNS responder of the host port, only tests include this
+
+#include "mdns.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Another host on the network announcing a service, mdns_query_ptr() finds it from then on
+    void host_mdns_add_peer(const char *hostname, const char *service_type, const char *proto, uint16_t port,
+                            const mdns_txt_item_t txt[], size_t num_items);
+    // Queries mdns_query_ptr() was called for so far
+    uint32_t host_mdns_query_count();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
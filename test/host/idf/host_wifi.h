@@ -0,0 +1,20 @@
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+// Controls the WiFi driver of the host port, only tests include this
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Whether esp_wifi_connect finds the configured network, it does by default
+    void host_wifi_set_reachable(bool reachable);
+    // The access point goes away, STA_DISCONNECTED is sent like the driver of the device does
+    void host_wifi_drop_connection();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
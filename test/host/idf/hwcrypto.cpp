@@ -0,0 +1,98 @@
+// SHA-1 of FIPS 180-4 in place of the SHA accelerator, the WebSocket handshake needs it
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "hwcrypto/sha.h"
+
+static inline uint32_t rotl(uint32_t x, int n)
+{
+    return (x << n) | (x >> (32 - n));
+}
+
+static void process(uint32_t state[5], const uint8_t *block)
+{
+    uint32_t w[80];
+    for (int i = 0; i < 16; i++)
+    {
+        w[i] = (uint32_t)block[i * 4] << 24 | (uint32_t)block[i * 4 + 1] << 16 | (uint32_t)block[i * 4 + 2] << 8 |
+               block[i * 4 + 3];
+    }
+    for (int i = 16; i < 80; i++)
+    {
+        w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+    for (int i = 0; i < 80; i++)
+    {
+        uint32_t f, k;
+        if (i < 20)
+        {
+            f = (b & c) | (~b & d);
+            k = 0x5a827999;
+        }
+        else if (i < 40)
+        {
+            f = b ^ c ^ d;
+            k = 0x6ed9eba1;
+        }
+        else if (i < 60)
+        {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8f1bbcdc;
+        }
+        else
+        {
+            f = b ^ c ^ d;
+            k = 0xca62c1d6;
+        }
+        uint32_t t = rotl(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = rotl(b, 30);
+        b = a;
+        a = t;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+}
+
+void esp_sha(esp_sha_type type, const unsigned char *input, size_t ilen, unsigned char *output)
+{
+    if (type != SHA1)
+    {
+        fprintf(stderr, "esp_sha: only SHA1 is there on the host\n");
+        abort();
+    }
+    uint32_t state[5] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+    size_t full = ilen - ilen % 64;
+    for (size_t i = 0; i < full; i += 64)
+    {
+        process(state, input + i);
+    }
+    // The rest, the 0x80 marker and the length in bits fill one or two more blocks
+    uint8_t tail[128] = {0};
+    size_t rest = ilen - full;
+    memcpy(tail, input + full, rest);
+    tail[rest] = 0x80;
+    size_t tail_len = rest < 56 ? 64 : 128;
+    uint64_t bits = (uint64_t)ilen * 8;
+    for (int i = 0; i < 8; i++)
+    {
+        tail[tail_len - 1 - i] = (uint8_t)(bits >> (i * 8));
+    }
+    for (size_t i = 0; i < tail_len; i += 64)
+    {
+        process(state, tail + i);
+    }
+    for (int i = 0; i < 5; i++)
+    {
+        output[i * 4] = state[i] >> 24;
+        output[i * 4 + 1] = state[i] >> 16;
+        output[i * 4 + 2] = state[i] >> 8;
+        output[i * 4 + 3] = state[i];
+    }
+}
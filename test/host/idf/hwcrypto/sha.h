@@ -0,0 +1,30 @@
+#ifndef HOST_HWCRYPTO_SHA_H
+#define HOST_HWCRYPTO_SHA_H
+
+// The one-shot hash of the SHA accelerator of ESP-IDF 3.3, only SHA-1 is there on the host
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef enum
+    {
+        SHA1 = 0,
+        SHA2_256,
+        SHA2_384,
+        SHA2_512,
+        SHA_TYPE_MAX
+    } esp_sha_type;
+
+    // Aborts for anything but SHA1
+    void esp_sha(esp_sha_type type, const unsigned char *input, size_t ilen, unsigned char *output);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef HOST_LWIP_DNS_H
+#define HOST_LWIP_DNS_H
+
+// Included by code of the device, nothing in it is used on the host
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef HOST_LWIP_ERR_H
+#define HOST_LWIP_ERR_H
+
+// Only the success code, socket functions return errno codes on the host
+
+#define ERR_OK 0
+
+#endif
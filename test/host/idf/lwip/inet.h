@@ -0,0 +1,6 @@
+#ifndef HOST_LWIP_INET_H
+#define HOST_LWIP_INET_H
+
+#include <arpa/inet.h>
+
+#endif
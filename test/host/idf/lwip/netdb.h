@@ -0,0 +1,6 @@
+#ifndef HOST_LWIP_NETDB_H
+#define HOST_LWIP_NETDB_H
+
+#include <netdb.h>
+
+#endif
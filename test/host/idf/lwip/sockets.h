@@ -0,0 +1,28 @@
+#ifndef HOST_LWIP_SOCKETS_H
+#define HOST_LWIP_SOCKETS_H
+
+// lwIP has the BSD socket API, on the host it is the one of the system
+
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "lwip/err.h"
+
+// The thread safe names lwIP of ESP-IDF has for the socket functions
+#define lwip_accept_r accept
+#define lwip_bind_r bind
+#define lwip_close_r close
+#define lwip_connect_r connect
+#define lwip_listen_r listen
+#define lwip_recv_r recv
+#define lwip_send_r send
+#define lwip_sendmsg_r sendmsg
+#define closesocket close
+
+#endif
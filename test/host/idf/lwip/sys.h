@@ -0,0 +1,6 @@
+#ifndef HOST_LWIP_SYS_H
+#define HOST_LWIP_SYS_H
+
+// Included by code of the device, nothing in it is used on the host
+
+#endif
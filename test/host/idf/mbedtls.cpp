@@ -0,0 +1,262 @@
+// SHA-256 in place of the one of mbedtls, which the host has no headers for, and an SSL layer that
+// is never available
+
+#include <string.h>
+#include "mbedtls/sha256.h"
+#include "mbedtls/ssl.h"
+
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+static inline uint32_t rotr(uint32_t x, int n)
+{
+    return (x >> n) | (x << (32 - n));
+}
+
+static void process(mbedtls_sha256_context *ctx, const uint8_t *block)
+{
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++)
+    {
+        w[i] = (uint32_t)block[i * 4] << 24 | (uint32_t)block[i * 4 + 1] << 16 | (uint32_t)block[i * 4 + 2] << 8 |
+               block[i * 4 + 3];
+    }
+    for (int i = 16; i < 64; i++)
+    {
+        uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t v[8];
+    memcpy(v, ctx->state, sizeof(v));
+    for (int i = 0; i < 64; i++)
+    {
+        uint32_t s1 = rotr(v[4], 6) ^ rotr(v[4], 11) ^ rotr(v[4], 25);
+        uint32_t ch = (v[4] & v[5]) ^ (~v[4] & v[6]);
+        uint32_t t1 = v[7] + s1 + ch + K[i] + w[i];
+        uint32_t s0 = rotr(v[0], 2) ^ rotr(v[0], 13) ^ rotr(v[0], 22);
+        uint32_t maj = (v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]);
+        memmove(&v[1], &v[0], 7 * sizeof(uint32_t));
+        v[4] += t1;
+        v[0] = t1 + s0 + maj;
+    }
+    for (int i = 0; i < 8; i++)
+    {
+        ctx->state[i] += v[i];
+    }
+}
+
+void mbedtls_sha256_init(mbedtls_sha256_context *ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+void mbedtls_sha256_free(mbedtls_sha256_context *ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+int mbedtls_sha256_starts_ret(mbedtls_sha256_context *ctx, int is224)
+{
+    static const uint32_t initial[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    if (is224)
+    {
+        return -1;
+    }
+    memcpy(ctx->state, initial, sizeof(initial));
+    ctx->length = 0;
+    ctx->buffered = 0;
+    return 0;
+}
+
+int mbedtls_sha256_update_ret(mbedtls_sha256_context *ctx, const unsigned char *input, size_t ilen)
+{
+    ctx->length += ilen;
+    while (ilen > 0)
+    {
+        if (ctx->buffered == 0 && ilen >= sizeof(ctx->buffer))
+        {
+            process(ctx, input);
+            input += sizeof(ctx->buffer);
+            ilen -= sizeof(ctx->buffer);
+            continue;
+        }
+        size_t n = sizeof(ctx->buffer) - ctx->buffered < ilen ? sizeof(ctx->buffer) - ctx->buffered : ilen;
+        memcpy(ctx->buffer + ctx->buffered, input, n);
+        ctx->buffered += n;
+        input += n;
+        ilen -= n;
+        if (ctx->buffered == sizeof(ctx->buffer))
+        {
+            process(ctx, ctx->buffer);
+            ctx->buffered = 0;
+        }
+    }
+    return 0;
+}
+
+int mbedtls_sha256_finish_ret(mbedtls_sha256_context *ctx, unsigned char output[32])
+{
+    uint64_t bits = ctx->length * 8;
+    uint8_t pad = 0x80;
+    mbedtls_sha256_update_ret(ctx, &pad, 1);
+    pad = 0;
+    while (ctx->buffered != 56)
+    {
+        mbedtls_sha256_update_ret(ctx, &pad, 1);
+    }
+    uint8_t trailer[8];
+    for (int i = 0; i < 8; i++)
+    {
+        trailer[i] = (uint8_t)(bits >> (56 - i * 8));
+    }
+    mbedtls_sha256_update_ret(ctx, trailer, sizeof(trailer));
+    for (int i = 0; i < 8; i++)
+    {
+        output[i * 4] = ctx->state[i] >> 24;
+        output[i * 4 + 1] = ctx->state[i] >> 16;
+        output[i * 4 + 2] = ctx->state[i] >> 8;
+        output[i * 4 + 3] = ctx->state[i];
+    }
+    return 0;
+}
+
+void mbedtls_net_init(mbedtls_net_context *ctx)
+{
+    ctx->fd = -1;
+}
+
+int mbedtls_net_send(void *ctx, const unsigned char *buf, size_t len)
+{
+    return MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+}
+
+int mbedtls_net_recv(void *ctx, unsigned char *buf, size_t len)
+{
+    return MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+}
+
+void mbedtls_entropy_init(mbedtls_entropy_context *ctx)
+{
+}
+
+int mbedtls_entropy_func(void *data, unsigned char *output, size_t len)
+{
+    return MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+}
+
+void mbedtls_ctr_drbg_init(mbedtls_ctr_drbg_context *ctx)
+{
+}
+
+int mbedtls_ctr_drbg_seed(mbedtls_ctr_drbg_context *ctx, int (*f_entropy)(void *, unsigned char *, size_t),
+                          void *p_entropy, const unsigned char *custom, size_t len)
+{
+    return MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+}
+
+int mbedtls_ctr_drbg_random(void *p_rng, unsigned char *output, size_t output_len)
+{
+    return MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+}
+
+void mbedtls_debug_set_threshold(int threshold)
+{
+}
+
+void mbedtls_x509_crt_init(mbedtls_x509_crt *crt)
+{
+}
+
+int mbedtls_x509_crt_parse(mbedtls_x509_crt *chain, const unsigned char *buf, size_t buflen)
+{
+    return MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+}
+
+void mbedtls_pk_init(mbedtls_pk_context *ctx)
+{
+}
+
+int mbedtls_pk_parse_key(mbedtls_pk_context *ctx, const unsigned char *key, size_t keylen, const unsigned char *pwd,
+                         size_t pwdlen)
+{
+    return MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+}
+
+void mbedtls_ssl_init(mbedtls_ssl_context *ssl)
+{
+}
+
+void mbedtls_ssl_config_init(mbedtls_ssl_config *conf)
+{
+}
+
+int mbedtls_ssl_config_defaults(mbedtls_ssl_config *conf, int endpoint, int transport, int preset)
+{
+    return MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+}
+
+void mbedtls_ssl_conf_authmode(mbedtls_ssl_config *conf, int authmode)
+{
+}
+
+void mbedtls_ssl_conf_rng(mbedtls_ssl_config *conf, int (*f_rng)(void *, unsigned char *, size_t), void *p_rng)
+{
+}
+
+void mbedtls_ssl_conf_ca_chain(mbedtls_ssl_config *conf, mbedtls_x509_crt *ca_chain, void *ca_crl)
+{
+}
+
+void mbedtls_ssl_conf_dbg(mbedtls_ssl_config *conf, void (*f_dbg)(void *, int, const char *, int, const char *),
+                          void *p_dbg)
+{
+}
+
+int mbedtls_ssl_conf_own_cert(mbedtls_ssl_config *conf, mbedtls_x509_crt *own_cert, mbedtls_pk_context *pk_key)
+{
+    return MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+}
+
+int mbedtls_ssl_setup(mbedtls_ssl_context *ssl, const mbedtls_ssl_config *conf)
+{
+    return MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+}
+
+int mbedtls_ssl_session_reset(mbedtls_ssl_context *ssl)
+{
+    return MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+}
+
+void mbedtls_ssl_set_bio(mbedtls_ssl_context *ssl, void *p_bio, mbedtls_ssl_send_t *f_send,
+                         mbedtls_ssl_recv_t *f_recv, mbedtls_ssl_recv_timeout_t *f_recv_timeout)
+{
+}
+
+int mbedtls_ssl_handshake(mbedtls_ssl_context *ssl)
+{
+    return MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+}
+
+int mbedtls_ssl_read(mbedtls_ssl_context *ssl, unsigned char *buf, size_t len)
+{
+    return MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+}
+
+int mbedtls_ssl_write(mbedtls_ssl_context *ssl, const unsigned char *buf, size_t len)
+{
+    return MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+}
+
+int mbedtls_ssl_close_notify(mbedtls_ssl_context *ssl)
+{
+    return MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+}
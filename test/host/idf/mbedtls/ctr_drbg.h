@@ -0,0 +1,6 @@
+#ifndef HOST_MBEDTLS_CTR_DRBG_H
+#define HOST_MBEDTLS_CTR_DRBG_H
+
+#include "mbedtls/ssl.h"
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef HOST_MBEDTLS_DEBUG_H
+#define HOST_MBEDTLS_DEBUG_H
+
+#include "mbedtls/ssl.h"
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef HOST_MBEDTLS_ENTROPY_H
+#define HOST_MBEDTLS_ENTROPY_H
+
+#include "mbedtls/ssl.h"
+
+#endif
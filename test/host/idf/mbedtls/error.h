@@ -0,0 +1,6 @@
+#ifndef HOST_MBEDTLS_ERROR_H
+#define HOST_MBEDTLS_ERROR_H
+
+#include "mbedtls/ssl.h"
+
+#endif
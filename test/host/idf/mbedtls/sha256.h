@@ -0,0 +1,32 @@
+#ifndef HOST_MBEDTLS_SHA256_H
+#define HOST_MBEDTLS_SHA256_H
+
+// SHA-256 of FIPS 180-4 with the API of mbedtls 2.16 in ESP-IDF 3.3, SHA-224 is not supported
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef struct
+    {
+        uint32_t state[8];
+        uint64_t length;
+        uint8_t buffer[64];
+        size_t buffered;
+    } mbedtls_sha256_context;
+
+    void mbedtls_sha256_init(mbedtls_sha256_context *ctx);
+    void mbedtls_sha256_free(mbedtls_sha256_context *ctx);
+    int mbedtls_sha256_starts_ret(mbedtls_sha256_context *ctx, int is224);
+    int mbedtls_sha256_update_ret(mbedtls_sha256_context *ctx, const unsigned char *input, size_t ilen);
+    int mbedtls_sha256_finish_ret(mbedtls_sha256_context *ctx, unsigned char output[32]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef HOST_MBEDTLS_SSL_H
+#define HOST_MBEDTLS_SSL_H
+
+// The parts of mbedtls Socket.h needs to compile. The host tests never use SSL, a handshake fails.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE -0x7080
+#define MBEDTLS_ERR_SSL_WANT_READ -0x6900
+#define MBEDTLS_ERR_SSL_WANT_WRITE -0x6880
+#define MBEDTLS_SSL_IS_SERVER 1
+#define MBEDTLS_SSL_TRANSPORT_STREAM 0
+#define MBEDTLS_SSL_PRESET_DEFAULT 0
+#define MBEDTLS_SSL_VERIFY_NONE 0
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef struct
+    {
+        int fd;
+    } mbedtls_net_context;
+
+    typedef struct
+    {
+        int unused;
+    } mbedtls_entropy_context, mbedtls_ctr_drbg_context, mbedtls_ssl_config, mbedtls_x509_crt, mbedtls_pk_context;
+
+    typedef struct
+    {
+        int unused;
+    } mbedtls_ssl_context;
+
+    typedef int mbedtls_ssl_send_t(void *ctx, const unsigned char *buf, size_t len);
+    typedef int mbedtls_ssl_recv_t(void *ctx, unsigned char *buf, size_t len);
+    typedef int mbedtls_ssl_recv_timeout_t(void *ctx, unsigned char *buf, size_t len, uint32_t timeout);
+
+    void mbedtls_net_init(mbedtls_net_context *ctx);
+    int mbedtls_net_send(void *ctx, const unsigned char *buf, size_t len);
+    int mbedtls_net_recv(void *ctx, unsigned char *buf, size_t len);
+    void mbedtls_entropy_init(mbedtls_entropy_context *ctx);
+    int mbedtls_entropy_func(void *data, unsigned char *output, size_t len);
+    void mbedtls_ctr_drbg_init(mbedtls_ctr_drbg_context *ctx);
+    int mbedtls_ctr_drbg_seed(mbedtls_ctr_drbg_context *ctx, int (*f_entropy)(void *, unsigned char *, size_t),
+                              void *p_entropy, const unsigned char *custom, size_t len);
+    int mbedtls_ctr_drbg_random(void *p_rng, unsigned char *output, size_t output_len);
+    void mbedtls_debug_set_threshold(int threshold);
+    void mbedtls_x509_crt_init(mbedtls_x509_crt *crt);
+    int mbedtls_x509_crt_parse(mbedtls_x509_crt *chain, const unsigned char *buf, size_t buflen);
+    void mbedtls_pk_init(mbedtls_pk_context *ctx);
+    int mbedtls_pk_parse_key(mbedtls_pk_context *ctx, const unsigned char *key, size_t keylen, const unsigned char *pwd,
+                             size_t pwdlen);
+    void mbedtls_ssl_init(mbedtls_ssl_context *ssl);
+    void mbedtls_ssl_config_init(mbedtls_ssl_config *conf);
+    int mbedtls_ssl_config_defaults(mbedtls_ssl_config *conf, int endpoint, int transport, int preset);
+    void mbedtls_ssl_conf_authmode(mbedtls_ssl_config *conf, int authmode);
+    void mbedtls_ssl_conf_rng(mbedtls_ssl_config *conf, int (*f_rng)(void *, unsigned char *, size_t), void *p_rng);
+    void mbedtls_ssl_conf_ca_chain(mbedtls_ssl_config *conf, mbedtls_x509_crt *ca_chain, void *ca_crl);
+    void mbedtls_ssl_conf_dbg(mbedtls_ssl_config *conf, void (*f_dbg)(void *, int, const char *, int, const char *),
+                              void *p_dbg);
+    int mbedtls_ssl_conf_own_cert(mbedtls_ssl_config *conf, mbedtls_x509_crt *own_cert, mbedtls_pk_context *pk_key);
+    int mbedtls_ssl_setup(mbedtls_ssl_context *ssl, const mbedtls_ssl_config *conf);
+    int mbedtls_ssl_session_reset(mbedtls_ssl_context *ssl);
+    void mbedtls_ssl_set_bio(mbedtls_ssl_context *ssl, void *p_bio, mbedtls_ssl_send_t *f_send,
+                             mbedtls_ssl_recv_t *f_recv, mbedtls_ssl_recv_timeout_t *f_recv_timeout);
+    int mbedtls_ssl_handshake(mbedtls_ssl_context *ssl);
+    int mbedtls_ssl_read(mbedtls_ssl_context *ssl, unsigned char *buf, size_t len);
+    int mbedtls_ssl_write(mbedtls_ssl_context *ssl, const unsigned char *buf, size_t len);
+    int mbedtls_ssl_close_notify(mbedtls_ssl_context *ssl);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
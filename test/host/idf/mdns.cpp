@@ -0,0 +1,220 @@
+// The mDNS responder on the host keeps its names and services on the heap like the one of the device
+
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "mdns.h"
+#include "host_mdns.h"
+
+struct host_mdns_service
+{
+    std::string instance_name;
+    std::string type;
+    std::string proto;
+    uint16_t port;
+    std::map<std::string, std::string> txt;
+};
+
+struct host_mdns
+{
+    std::string hostname;
+    std::string instance_name;
+    std::vector<host_mdns_service> services;
+};
+
+struct host_mdns_peer
+{
+    std::string hostname;
+    host_mdns_service service;
+};
+
+static std::mutex mdns_mutex;
+static host_mdns *server = NULL;
+// Left to leak, the discovery task of a test may still be querying while static objects are destroyed
+static std::vector<host_mdns_peer> &peers = *new std::vector<host_mdns_peer>();
+static uint32_t query_count = 0;
+
+static host_mdns_service *find_service(const char *type, const char *proto)
+{
+    for (host_mdns_service &service : server->services)
+    {
+        if (service.type == type && service.proto == proto)
+        {
+            return &service;
+        }
+    }
+    return NULL;
+}
+
+esp_err_t mdns_init()
+{
+    std::lock_guard<std::mutex> lock(mdns_mutex);
+    if (server != NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    server = new host_mdns();
+    return ESP_OK;
+}
+
+void mdns_free()
+{
+    std::lock_guard<std::mutex> lock(mdns_mutex);
+    delete server;
+    server = NULL;
+}
+
+esp_err_t mdns_hostname_set(const char *hostname)
+{
+    std::lock_guard<std::mutex> lock(mdns_mutex);
+    if (server == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    server->hostname = hostname;
+    return ESP_OK;
+}
+
+esp_err_t mdns_instance_name_set(const char *instance_name)
+{
+    std::lock_guard<std::mutex> lock(mdns_mutex);
+    if (server == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    server->instance_name = instance_name;
+    return ESP_OK;
+}
+
+esp_err_t mdns_service_add(const char *instance_name, const char *service_type, const char *proto, uint16_t port,
+                           mdns_txt_item_t txt[], size_t num_items)
+{
+    std::lock_guard<std::mutex> lock(mdns_mutex);
+    if (server == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (find_service(service_type, proto) != NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    host_mdns_service service;
+    service.instance_name = instance_name != NULL ? instance_name : "";
+    service.type = service_type;
+    service.proto = proto;
+    service.port = port;
+    for (size_t i = 0; i < num_items; i++)
+    {
+        service.txt[txt[i].key] = txt[i].value;
+    }
+    server->services.push_back(service);
+    return ESP_OK;
+}
+
+esp_err_t mdns_service_txt_item_set(const char *service_type, const char *proto, const char *key, const char *value)
+{
+    std::lock_guard<std::mutex> lock(mdns_mutex);
+    if (server == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    host_mdns_service *service = find_service(service_type, proto);
+    if (service == NULL)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    service->txt[key] = value;
+    return ESP_OK;
+}
+
+esp_err_t mdns_handle_system_event(void *ctx, system_event_t *event)
+{
+    return ESP_OK;
+}
+
+esp_err_t mdns_query_ptr(const char *service_type, const char *proto, uint32_t timeout, size_t max_results,
+                         mdns_result_t **results)
+{
+    *results = NULL;
+    mdns_result_t **tail = results;
+    size_t found = 0;
+    {
+        std::lock_guard<std::mutex> lock(mdns_mutex);
+        if (server == NULL)
+        {
+            return ESP_ERR_INVALID_STATE;
+        }
+        query_count++;
+        for (const host_mdns_peer &peer : peers)
+        {
+            if (found == max_results || peer.service.type != service_type || peer.service.proto != proto)
+            {
+                continue;
+            }
+            mdns_result_t *result = (mdns_result_t *)calloc(1, sizeof(mdns_result_t));
+            result->instance_name = strdup(peer.service.instance_name.c_str());
+            result->hostname = strdup(peer.hostname.c_str());
+            result->port = peer.service.port;
+            result->txt = (mdns_txt_item_t *)calloc(peer.service.txt.size(), sizeof(mdns_txt_item_t));
+            for (const auto &item : peer.service.txt)
+            {
+                result->txt[result->txt_count].key = strdup(item.first.c_str());
+                result->txt[result->txt_count].value = strdup(item.second.c_str());
+                result->txt_count++;
+            }
+            *tail = result;
+            tail = &result->next;
+            found++;
+        }
+    }
+    if (found < max_results)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(timeout));
+    }
+    return ESP_OK;
+}
+
+void mdns_query_results_free(mdns_result_t *results)
+{
+    while (results != NULL)
+    {
+        mdns_result_t *next = results->next;
+        for (size_t i = 0; i < results->txt_count; i++)
+        {
+            free((void *)results->txt[i].key);
+            free((void *)results->txt[i].value);
+        }
+        free(results->txt);
+        free(results->instance_name);
+        free(results->hostname);
+        free(results);
+        results = next;
+    }
+}
+
+void host_mdns_add_peer(const char *hostname, const char *service_type, const char *proto, uint16_t port,
+                        const mdns_txt_item_t txt[], size_t num_items)
+{
+    std::lock_guard<std::mutex> lock(mdns_mutex);
+    host_mdns_peer peer;
+    peer.hostname = hostname;
+    peer.service.type = service_type;
+    peer.service.proto = proto;
+    peer.service.port = port;
+    for (size_t i = 0; i < num_items; i++)
+    {
+        peer.service.txt[txt[i].key] = txt[i].value;
+    }
+    peers.push_back(peer);
+}
+
+uint32_t host_mdns_query_count()
+{
+    std::lock_guard<std::mutex> lock(mdns_mutex);
+    return query_count;
+}
@@ -0,0 +1,49 @@
+#ifndef HOST_MDNS_H
+#define HOST_MDNS_H
+
+// The responder only keeps what it was told, nothing is announced on the host network. Queries are
+// answered from the peers a test added with host_mdns_add_peer().
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_event_loop.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef struct
+    {
+        const char *key;
+        const char *value;
+    } mdns_txt_item_t;
+
+    typedef struct mdns_result_s
+    {
+        struct mdns_result_s *next;
+        char *instance_name;
+        char *hostname;
+        uint16_t port;
+        mdns_txt_item_t *txt;
+        size_t txt_count;
+    } mdns_result_t;
+
+    esp_err_t mdns_init();
+    void mdns_free();
+    esp_err_t mdns_hostname_set(const char *hostname);
+    esp_err_t mdns_instance_name_set(const char *instance_name);
+    esp_err_t mdns_service_add(const char *instance_name, const char *service_type, const char *proto, uint16_t port,
+                               mdns_txt_item_t txt[], size_t num_items);
+    esp_err_t mdns_service_txt_item_set(const char *service_type, const char *proto, const char *key, const char *value);
+    esp_err_t mdns_handle_system_event(void *ctx, system_event_t *event);
+    // Like on the device the query waits for answers until the timeout, unless max_results came in before
+    esp_err_t mdns_query_ptr(const char *service_type, const char *proto, uint32_t timeout, size_t max_results,
+                             mdns_result_t **results);
+    void mdns_query_results_free(mdns_result_t *results);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,133 @@
+// NVS on the host, the flash partition is memory of the process
+
+#include "nvs_flash.h"
+#include "nvs.h"
+
+#include <string.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+typedef std::map<std::string, std::vector<uint8_t>> nvs_namespace_t;
+
+struct nvs_open_handle
+{
+    std::string name;
+    bool writable;
+};
+
+// Leaked, tasks may still close handles while the process exits
+static std::mutex &nvs_mutex = *new std::mutex();
+static std::map<std::string, nvs_namespace_t> &namespaces = *new std::map<std::string, nvs_namespace_t>();
+static std::map<nvs_handle, nvs_open_handle> &handles = *new std::map<nvs_handle, nvs_open_handle>();
+static nvs_handle next_handle = 1;
+
+esp_err_t nvs_flash_init()
+{
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase()
+{
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    namespaces.clear();
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode open_mode, nvs_handle *out_handle)
+{
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    if (namespaces.find(name) == namespaces.end())
+    {
+        if (open_mode == NVS_READONLY)
+        {
+            return ESP_ERR_NVS_NOT_FOUND;
+        }
+        namespaces[name];
+    }
+    *out_handle = next_handle++;
+    handles[*out_handle] = {name, open_mode == NVS_READWRITE};
+    return ESP_OK;
+}
+
+// Called with nvs_mutex held
+static nvs_namespace_t *handle_namespace(nvs_handle handle, bool write, esp_err_t *err)
+{
+    auto it = handles.find(handle);
+    if (it == handles.end())
+    {
+        *err = ESP_ERR_NVS_INVALID_HANDLE;
+        return NULL;
+    }
+    if (write && !it->second.writable)
+    {
+        *err = ESP_ERR_NVS_READ_ONLY;
+        return NULL;
+    }
+    *err = ESP_OK;
+    return &namespaces[it->second.name];
+}
+
+esp_err_t nvs_set_blob(nvs_handle handle, const char *key, const void *value, size_t length)
+{
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    esp_err_t err;
+    nvs_namespace_t *entries = handle_namespace(handle, true, &err);
+    if (entries == NULL)
+    {
+        return err;
+    }
+    (*entries)[key].assign((const uint8_t *)value, (const uint8_t *)value + length);
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_blob(nvs_handle handle, const char *key, void *out_value, size_t *length)
+{
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    esp_err_t err;
+    nvs_namespace_t *entries = handle_namespace(handle, false, &err);
+    if (entries == NULL)
+    {
+        return err;
+    }
+    auto it = entries->find(key);
+    if (it == entries->end())
+    {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (out_value != NULL)
+    {
+        if (*length < it->second.size())
+        {
+            return ESP_ERR_NVS_INVALID_LENGTH;
+        }
+        memcpy(out_value, it->second.data(), it->second.size());
+    }
+    *length = it->second.size();
+    return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle handle, const char *key)
+{
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    esp_err_t err;
+    nvs_namespace_t *entries = handle_namespace(handle, true, &err);
+    if (entries == NULL)
+    {
+        return err;
+    }
+    return entries->erase(key) > 0 ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_commit(nvs_handle handle)
+{
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    return handles.count(handle) > 0 ? ESP_OK : ESP_ERR_NVS_INVALID_HANDLE;
+}
+
+void nvs_close(nvs_handle handle)
+{
+    std::lock_guard<std::mutex> lock(nvs_mutex);
+    handles.erase(handle);
+}
@@ -0,0 +1,51 @@
+#ifndef HOST_NVS_H
+#define HOST_NVS_H
+
+// NVS of ESP-IDF 3.3 on the host, only blobs. nvs_flash_erase() clears all namespaces.
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#define ESP_ERR_NVS_BASE 0x1100
+#define ESP_ERR_NVS_NOT_INITIALIZED (ESP_ERR_NVS_BASE + 0x01)
+#define ESP_ERR_NVS_NOT_FOUND (ESP_ERR_NVS_BASE + 0x02)
+#define ESP_ERR_NVS_TYPE_MISMATCH (ESP_ERR_NVS_BASE + 0x03)
+#define ESP_ERR_NVS_READ_ONLY (ESP_ERR_NVS_BASE + 0x04)
+#define ESP_ERR_NVS_NOT_ENOUGH_SPACE (ESP_ERR_NVS_BASE + 0x05)
+#define ESP_ERR_NVS_INVALID_NAME (ESP_ERR_NVS_BASE + 0x06)
+#define ESP_ERR_NVS_INVALID_HANDLE (ESP_ERR_NVS_BASE + 0x07)
+#define ESP_ERR_NVS_REMOVE_FAILED (ESP_ERR_NVS_BASE + 0x08)
+#define ESP_ERR_NVS_KEY_TOO_LONG (ESP_ERR_NVS_BASE + 0x09)
+#define ESP_ERR_NVS_PAGE_FULL (ESP_ERR_NVS_BASE + 0x0a)
+#define ESP_ERR_NVS_INVALID_STATE (ESP_ERR_NVS_BASE + 0x0b)
+#define ESP_ERR_NVS_INVALID_LENGTH (ESP_ERR_NVS_BASE + 0x0c)
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef uint32_t nvs_handle;
+
+    typedef enum
+    {
+        NVS_READONLY,
+        NVS_READWRITE
+    } nvs_open_mode;
+
+    // Opening a namespace that was never created read only fails with ESP_ERR_NVS_NOT_FOUND
+    esp_err_t nvs_open(const char *name, nvs_open_mode open_mode, nvs_handle *out_handle);
+    esp_err_t nvs_set_blob(nvs_handle handle, const char *key, const void *value, size_t length);
+    // With out_value NULL only the length is returned, a buffer shorter than the blob fails with
+    // ESP_ERR_NVS_INVALID_LENGTH
+    esp_err_t nvs_get_blob(nvs_handle handle, const char *key, void *out_value, size_t *length);
+    esp_err_t nvs_erase_key(nvs_handle handle, const char *key);
+    esp_err_t nvs_commit(nvs_handle handle);
+    void nvs_close(nvs_handle handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
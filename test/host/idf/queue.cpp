@@ -0,0 +1,216 @@
+// Queues and semaphores of FreeRTOS on a mutex and two condition variables
+
+#include <string.h>
+#include <stdlib.h>
+#include <condition_variable>
+#include <mutex>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+struct host_queue
+{
+    std::mutex mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t count;
+    UBaseType_t head;
+    uint8_t *items;
+};
+
+static std::chrono::steady_clock::time_point deadline(TickType_t ticks)
+{
+    return std::chrono::steady_clock::now() + std::chrono::milliseconds((uint64_t)ticks * portTICK_PERIOD_MS);
+}
+
+// Waits with the lock held until ready() or the ticks passed, like a blocked task on the device
+template <typename Ready>
+static bool wait(std::unique_lock<std::mutex> &lock, std::condition_variable &cond, TickType_t ticks, Ready ready)
+{
+    if (ticks == 0)
+    {
+        return ready();
+    }
+    if (ticks == portMAX_DELAY)
+    {
+        cond.wait(lock, ready);
+        return true;
+    }
+    return cond.wait_until(lock, deadline(ticks), ready);
+}
+
+static QueueHandle_t create(UBaseType_t length, UBaseType_t item_size, UBaseType_t count)
+{
+    host_queue *queue = new host_queue();
+    queue->length = length;
+    queue->item_size = item_size;
+    queue->count = count;
+    queue->items = item_size > 0 ? (uint8_t *)malloc((size_t)length * item_size) : NULL;
+    return queue;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    return create(length, item_size, 0);
+}
+
+void vQueueDelete(QueueHandle_t queue)
+{
+    free(queue->items);
+    delete queue;
+}
+
+static BaseType_t send(QueueHandle_t queue, const void *item, TickType_t ticks, bool front)
+{
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    if (!wait(lock, queue->not_full, ticks, [queue] { return queue->count < queue->length; }))
+    {
+        return errQUEUE_FULL;
+    }
+    if (queue->item_size > 0)
+    {
+        UBaseType_t slot;
+        if (front)
+        {
+            queue->head = (queue->head + queue->length - 1) % queue->length;
+            slot = queue->head;
+        }
+        else
+        {
+            slot = (queue->head + queue->count) % queue->length;
+        }
+        memcpy(queue->items + (size_t)slot * queue->item_size, item, queue->item_size);
+    }
+    queue->count++;
+    queue->not_empty.notify_one();
+    return pdTRUE;
+}
+
+static BaseType_t receive(QueueHandle_t queue, void *item, TickType_t ticks, bool peek)
+{
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    if (!wait(lock, queue->not_empty, ticks, [queue] { return queue->count > 0; }))
+    {
+        return errQUEUE_EMPTY;
+    }
+    if (queue->item_size > 0)
+    {
+        memcpy(item, queue->items + (size_t)queue->head * queue->item_size, queue->item_size);
+    }
+    if (!peek)
+    {
+        if (queue->item_size > 0)
+        {
+            queue->head = (queue->head + 1) % queue->length;
+        }
+        queue->count--;
+        queue->not_full.notify_one();
+    }
+    return pdTRUE;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks)
+{
+    return send(queue, item, ticks, false);
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void *item, TickType_t ticks)
+{
+    return send(queue, item, ticks, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void *item, TickType_t ticks)
+{
+    return send(queue, item, ticks, true);
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *woken)
+{
+    if (woken != NULL)
+    {
+        *woken = pdFALSE;
+    }
+    return send(queue, item, 0, false);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks)
+{
+    return receive(queue, item, ticks, false);
+}
+
+BaseType_t xQueueReceiveFromISR(QueueHandle_t queue, void *item, BaseType_t *woken)
+{
+    if (woken != NULL)
+    {
+        *woken = pdFALSE;
+    }
+    return receive(queue, item, 0, false);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void *item, TickType_t ticks)
+{
+    return receive(queue, item, ticks, true);
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    return queue->count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue)
+{
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    return queue->length - queue->count;
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue)
+{
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    queue->count = 0;
+    queue->head = 0;
+    queue->not_full.notify_all();
+    return pdPASS;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary()
+{
+    return create(1, 0, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+    return create(1, 0, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count)
+{
+    return create(max_count, 0, initial_count);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks)
+{
+    return receive(semaphore, NULL, ticks, false);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+    return send(semaphore, NULL, 0, false);
+}
+
+BaseType_t xSemaphoreTakeFromISR(SemaphoreHandle_t semaphore, BaseType_t *woken)
+{
+    return xQueueReceiveFromISR(semaphore, NULL, woken);
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t semaphore, BaseType_t *woken)
+{
+    return xQueueSendFromISR(semaphore, NULL, woken);
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t semaphore)
+{
+    return uxQueueMessagesWaiting(semaphore);
+}
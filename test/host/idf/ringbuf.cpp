@@ -0,0 +1,220 @@
+// The no split ring buffer of ESP-IDF on a mutex and two condition variables. Received items may be
+// returned in any order, their space is freed once every older item was returned, like on the device.
+
+#include <string.h>
+#include <stdlib.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include "freertos/FreeRTOS.h"
+#include "freertos/ringbuf.h"
+
+#define HEADER_SIZE 8
+#define ALIGN(size) (((size) + 3) & ~(size_t)3)
+
+typedef struct item
+{
+    size_t start;
+    size_t size;
+    bool received;
+    bool returned;
+} item_t;
+
+struct host_ringbuf
+{
+    std::mutex mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+    uint8_t *storage;
+    size_t size;
+    // Where the oldest item starts and the next one is written, equal if the buffer is empty or full
+    size_t head;
+    size_t tail;
+    size_t used;
+    std::deque<item_t> items;
+};
+
+static std::chrono::steady_clock::time_point deadline(TickType_t ticks)
+{
+    return std::chrono::steady_clock::now() + std::chrono::milliseconds((uint64_t)ticks * portTICK_PERIOD_MS);
+}
+
+template <typename Ready>
+static bool wait(std::unique_lock<std::mutex> &lock, std::condition_variable &cond, TickType_t ticks, Ready ready)
+{
+    if (ticks == 0)
+    {
+        return ready();
+    }
+    if (ticks == portMAX_DELAY)
+    {
+        cond.wait(lock, ready);
+        return true;
+    }
+    return cond.wait_until(lock, deadline(ticks), ready);
+}
+
+RingbufHandle_t xRingbufferCreate(size_t size, ringbuf_type_t type)
+{
+    if (type != RINGBUF_TYPE_NOSPLIT)
+    {
+        // Nothing in the firmware uses the other types
+        abort();
+    }
+    host_ringbuf *ringbuf = new host_ringbuf();
+    ringbuf->size = ALIGN(size);
+    ringbuf->storage = (uint8_t *)malloc(ringbuf->size);
+    return ringbuf;
+}
+
+void vRingbufferDelete(RingbufHandle_t ringbuf)
+{
+    free(ringbuf->storage);
+    delete ringbuf;
+}
+
+size_t xRingbufferGetMaxItemSize(RingbufHandle_t ringbuf)
+{
+    return ringbuf->size / 2 - HEADER_SIZE;
+}
+
+// Where an item of this many bytes with its header goes, or size if it doesn't fit right now. Space
+// left at the end of the buffer is skipped and counted as used until the item is freed.
+static size_t find_space(RingbufHandle_t ringbuf, size_t needed, size_t *skipped)
+{
+    *skipped = 0;
+    if (ringbuf->used == 0)
+    {
+        ringbuf->head = ringbuf->tail = 0;
+        return 0;
+    }
+    if (ringbuf->tail > ringbuf->head)
+    {
+        if (ringbuf->tail + needed <= ringbuf->size)
+        {
+            return ringbuf->tail;
+        }
+        if (needed <= ringbuf->head)
+        {
+            *skipped = ringbuf->size - ringbuf->tail;
+            return 0;
+        }
+        return ringbuf->size;
+    }
+    if (ringbuf->tail < ringbuf->head && ringbuf->tail + needed <= ringbuf->head)
+    {
+        return ringbuf->tail;
+    }
+    return ringbuf->size;
+}
+
+size_t xRingbufferGetCurFreeSize(RingbufHandle_t ringbuf)
+{
+    std::lock_guard<std::mutex> lock(ringbuf->mutex);
+    size_t free = ringbuf->size - ringbuf->used;
+    return free > HEADER_SIZE ? free - HEADER_SIZE : 0;
+}
+
+BaseType_t xRingbufferSend(RingbufHandle_t ringbuf, const void *data, size_t size, TickType_t ticks)
+{
+    if (size > xRingbufferGetMaxItemSize(ringbuf))
+    {
+        return pdFALSE;
+    }
+    size_t needed = HEADER_SIZE + ALIGN(size);
+    size_t skipped;
+    size_t start = 0;
+    std::unique_lock<std::mutex> lock(ringbuf->mutex);
+    if (!wait(lock, ringbuf->not_full, ticks, [&] {
+            start = find_space(ringbuf, needed, &skipped);
+            return start != ringbuf->size;
+        }))
+    {
+        return pdFALSE;
+    }
+    memcpy(ringbuf->storage + start, &size, sizeof(size));
+    memcpy(ringbuf->storage + start + HEADER_SIZE, data, size);
+    ringbuf->items.push_back(item_t{start, size, false, false});
+    ringbuf->tail = (start + needed) % ringbuf->size;
+    ringbuf->used += skipped + needed;
+    ringbuf->not_empty.notify_one();
+    return pdTRUE;
+}
+
+BaseType_t xRingbufferSendFromISR(RingbufHandle_t ringbuf, const void *data, size_t size, BaseType_t *woken)
+{
+    if (woken != NULL)
+    {
+        *woken = pdFALSE;
+    }
+    return xRingbufferSend(ringbuf, data, size, 0);
+}
+
+void *xRingbufferReceive(RingbufHandle_t ringbuf, size_t *size, TickType_t ticks)
+{
+    item_t *next = NULL;
+    std::unique_lock<std::mutex> lock(ringbuf->mutex);
+    if (!wait(lock, ringbuf->not_empty, ticks, [&] {
+            for (auto &item : ringbuf->items)
+            {
+                if (!item.received)
+                {
+                    next = &item;
+                    return true;
+                }
+            }
+            return false;
+        }))
+    {
+        return NULL;
+    }
+    next->received = true;
+    *size = next->size;
+    return ringbuf->storage + next->start + HEADER_SIZE;
+}
+
+void *xRingbufferReceiveFromISR(RingbufHandle_t ringbuf, size_t *size)
+{
+    return xRingbufferReceive(ringbuf, size, 0);
+}
+
+void *xRingbufferReceiveUpTo(RingbufHandle_t ringbuf, size_t *size, TickType_t ticks, size_t max_size)
+{
+    // Only byte buffers support it
+    abort();
+}
+
+void vRingbufferReturnItem(RingbufHandle_t ringbuf, void *data)
+{
+    std::lock_guard<std::mutex> lock(ringbuf->mutex);
+    size_t start = (uint8_t *)data - ringbuf->storage - HEADER_SIZE;
+    for (auto &item : ringbuf->items)
+    {
+        if (item.start == start && item.received && !item.returned)
+        {
+            item.returned = true;
+            break;
+        }
+    }
+    while (!ringbuf->items.empty() && ringbuf->items.front().returned)
+    {
+        ringbuf->items.pop_front();
+        size_t head = ringbuf->items.empty() ? ringbuf->tail : ringbuf->items.front().start;
+        ringbuf->used -= (head + ringbuf->size - ringbuf->head) % ringbuf->size;
+        ringbuf->head = head;
+        if (ringbuf->items.empty())
+        {
+            ringbuf->used = 0;
+        }
+    }
+    ringbuf->not_full.notify_all();
+}
+
+void vRingbufferReturnItemFromISR(RingbufHandle_t ringbuf, void *data, BaseType_t *woken)
+{
+    if (woken != NULL)
+    {
+        *woken = pdFALSE;
+    }
+    vRingbufferReturnItem(ringbuf, data);
+}
@@ -0,0 +1,44 @@
+#ifndef HOST_TCPIP_ADAPTER_H
+#define HOST_TCPIP_ADAPTER_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // In network byte order like lwIP
+    typedef struct
+    {
+        uint32_t addr;
+    } ip4_addr_t;
+
+    typedef struct
+    {
+        ip4_addr_t ip;
+        ip4_addr_t netmask;
+        ip4_addr_t gw;
+    } tcpip_adapter_ip_info_t;
+
+    typedef enum
+    {
+        TCPIP_ADAPTER_IF_STA,
+        TCPIP_ADAPTER_IF_AP,
+        TCPIP_ADAPTER_IF_ETH,
+        TCPIP_ADAPTER_IF_MAX
+    } tcpip_adapter_if_t;
+
+    void tcpip_adapter_init();
+    esp_err_t tcpip_adapter_set_hostname(tcpip_adapter_if_t tcpip_if, const char *hostname);
+    // Every interface of the host port is the loopback interface, so tests reach servers bound to it
+    esp_err_t tcpip_adapter_get_ip_info(tcpip_adapter_if_t tcpip_if, tcpip_adapter_ip_info_t *ip_info);
+    // Formats into a static buffer like lwIP
+    char *ip4addr_ntoa(const ip4_addr_t *addr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,163 @@
+#ifndef INFLUX_STAND_IN_H
+#define INFLUX_STAND_IN_H
+
+// Takes the place of InfluxDB's /api/v2/write on localhost: reads POSTs over kept-alive connections,
+// keeps the lines and answers 204, or the status set with failNext() for the next requests.
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "check.h"
+
+class InfluxStandIn
+{
+public:
+    explicit InfluxStandIn(uint16_t port) : m_listenFd(socket(AF_INET, SOCK_STREAM, 0)), m_clientFd(-1)
+    {
+        int on = 1;
+        setsockopt(m_listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        struct sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        CHECK(bind(m_listenFd, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+        CHECK(listen(m_listenFd, 4) == 0);
+        m_thread = std::thread(&InfluxStandIn::serve, this);
+    }
+
+    ~InfluxStandIn()
+    {
+        shutdown(m_listenFd, SHUT_RDWR);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_clientFd >= 0)
+            {
+                shutdown(m_clientFd, SHUT_RDWR);
+            }
+        }
+        m_thread.join();
+        close(m_listenFd);
+    }
+
+    // The next count requests are answered with status and their lines are not kept
+    void failNext(int count, int status)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_failCount = count;
+        m_failStatus = status;
+    }
+
+    std::vector<std::string> lines()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_lines;
+    }
+
+    std::atomic<uint32_t> requests{0};
+    std::atomic<uint32_t> connections{0};
+    std::atomic<uint64_t> bodyBytes{0};
+
+    // Request line of the last request
+    std::string target()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_target;
+    }
+
+private:
+    void serve()
+    {
+        while (true)
+        {
+            int fd = accept(m_listenFd, NULL, NULL);
+            if (fd < 0)
+            {
+                return;
+            }
+            connections++;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_clientFd = fd;
+            }
+            while (handle(fd))
+            {
+            }
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_clientFd = -1;
+            }
+            close(fd);
+        }
+    }
+
+    bool handle(int fd)
+    {
+        std::string head;
+        char c;
+        while (head.size() < 4 || head.compare(head.size() - 4, 4, "\r\n\r\n") != 0)
+        {
+            if (recv(fd, &c, 1, 0) != 1)
+            {
+                return false;
+            }
+            head += c;
+        }
+        const char *length = strcasestr(head.c_str(), "\r\nContent-Length:");
+        CHECK(length != NULL);
+        std::string body(strtoul(length + 17, NULL, 10), '\0');
+        for (size_t read = 0; read < body.size();)
+        {
+            ssize_t n = recv(fd, &body[read], body.size() - read, 0);
+            if (n <= 0)
+            {
+                return false;
+            }
+            read += n;
+        }
+        requests++;
+        bodyBytes += body.size();
+
+        int status = 204;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_target = head.substr(0, head.find("\r\n"));
+            if (m_failCount > 0)
+            {
+                m_failCount--;
+                status = m_failStatus;
+            }
+            else
+            {
+                for (size_t pos = 0; pos < body.size();)
+                {
+                    size_t end = body.find('\n', pos);
+                    CHECK(end != std::string::npos);
+                    m_lines.push_back(body.substr(pos, end - pos));
+                    pos = end + 1;
+                }
+            }
+        }
+        std::string response = "HTTP/1.1 " + std::to_string(status) + " Status\r\nContent-Length: 0\r\n\r\n";
+        return send(fd, response.data(), response.size(), MSG_NOSIGNAL) == (ssize_t)response.size();
+    }
+
+    int m_listenFd;
+    int m_clientFd;
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::vector<std::string> m_lines;
+    std::string m_target;
+    int m_failCount = 0;
+    int m_failStatus = 0;
+};
+
+#endif
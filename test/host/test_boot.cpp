@@ -0,0 +1,223 @@
+#include "boot.h"
+
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "freertos/task.h"
+
+#include "check.h"
+
+// Durations of the phases in milliseconds on the device, the harness runs them TIME_SCALE times faster.
+// They are rough numbers of a gateway with a stored WiFi network, what matters is their order.
+#define TIME_SCALE 10
+#define NVS_MS 40
+#define SETTINGS_MS 10
+#define SPIFFS_MS 350
+#define BLE_INIT_MS 500
+#define IBBQ_CONNECT_MS 1500
+#define FIRST_NOTIFY_MS 500
+#define WIFI_INIT_MS 200
+#define WIFI_CONNECT_MS 2500
+#define WEBSERVER_MS 100
+
+typedef enum mode
+{
+    // BLE starts next to WiFi, as app_main does now
+    MODE_PARALLEL,
+    // BLE waits for the WiFi association, as it did before the boot orchestration
+    MODE_SERIAL,
+    // The stored network is not reachable, the gateway ends up in access point mode
+    MODE_PARALLEL_AP,
+    MODE_SERIAL_AP,
+} boot_mode_t;
+
+typedef struct result
+{
+    boot_phase_record_t timeline[BOOT_PHASE_COUNT];
+    bool done[BOOT_PHASE_COUNT];
+    bool spiffs_waited;
+} result_t;
+
+static void work(int device_ms)
+{
+    vTaskDelay(pdMS_TO_TICKS(device_ms / TIME_SCALE));
+}
+
+static void spiffs_task(void *arg)
+{
+    boot_phase_start(BOOT_PHASE_SPIFFS);
+    work(SPIFFS_MS);
+    boot_phase_done(BOOT_PHASE_SPIFFS, ESP_OK);
+    vTaskDelete(NULL);
+}
+
+static void ble_task(void *arg)
+{
+    boot_mode_t mode = *(boot_mode_t *)arg;
+    if (mode == MODE_SERIAL || mode == MODE_SERIAL_AP)
+    {
+        // Never returns in access point mode, like the STA_CONNECTED event that never came
+        boot_phase_wait(BOOT_PHASE_NETWORK_UP, portMAX_DELAY);
+    }
+    boot_phase_start(BOOT_PHASE_BLE);
+    work(BLE_INIT_MS);
+    boot_phase_done(BOOT_PHASE_BLE, ESP_OK);
+    work(IBBQ_CONNECT_MS);
+    boot_phase_done(BOOT_PHASE_IBBQ_CONNECTED, ESP_OK);
+    work(FIRST_NOTIFY_MS);
+    boot_phase_done(BOOT_PHASE_FIRST_TEMP, ESP_OK);
+    // Every notification reports it again, only the first one counts
+    boot_phase_done(BOOT_PHASE_FIRST_TEMP, ESP_FAIL);
+    vTaskDelete(NULL);
+}
+
+static void wifi_task(void *arg)
+{
+    boot_mode_t mode = *(boot_mode_t *)arg;
+    if (mode == MODE_PARALLEL_AP || mode == MODE_SERIAL_AP)
+    {
+        vTaskDelete(NULL);
+    }
+    work(WIFI_CONNECT_MS);
+    boot_phase_done(BOOT_PHASE_NETWORK_UP, ESP_OK);
+    boot_phase_start(BOOT_PHASE_WEBSERVER);
+    work(WEBSERVER_MS);
+    boot_phase_done(BOOT_PHASE_WEBSERVER, ESP_OK);
+    vTaskDelete(NULL);
+}
+
+// The same graph as app_main in main.cpp
+static void boot(boot_mode_t *mode)
+{
+    boot_init();
+    boot_phase_start(BOOT_PHASE_NVS);
+    work(NVS_MS);
+    boot_phase_done(BOOT_PHASE_NVS, ESP_OK);
+
+    xTaskCreate(&spiffs_task, "boot_spiffs", 3072, NULL, 1, NULL);
+
+    boot_phase_start(BOOT_PHASE_SETTINGS);
+    work(SETTINGS_MS);
+    boot_phase_done(BOOT_PHASE_SETTINGS, ESP_OK);
+
+    xTaskCreate(&ble_task, "boot_ble", 4096, mode, 1, NULL);
+
+    boot_phase_start(BOOT_PHASE_WIFI);
+    work(WIFI_INIT_MS);
+    boot_phase_done(BOOT_PHASE_WIFI, ESP_OK);
+    xTaskCreate(&wifi_task, "wifi", 4096, mode, 1, NULL);
+}
+
+// Every boot runs in its own process, the timeline is a static that can't be reset
+static result_t run(boot_mode_t mode)
+{
+    int fds[2];
+    CHECK(pipe(fds) == 0);
+    pid_t pid = fork();
+    CHECK(pid >= 0);
+    if (pid == 0)
+    {
+        close(fds[0]);
+        result_t result = {};
+        boot(&mode);
+        // A static file request that arrives right away waits for SPIFFS instead of failing
+        result.spiffs_waited = boot_phase_wait(BOOT_PHASE_SPIFFS, pdMS_TO_TICKS(2 * SPIFFS_MS / TIME_SCALE));
+        // Long enough for every phase that is reached at all
+        boot_phase_wait(BOOT_PHASE_FIRST_TEMP, pdMS_TO_TICKS(10000 / TIME_SCALE));
+        boot_phase_wait(BOOT_PHASE_WEBSERVER, pdMS_TO_TICKS(10000 / TIME_SCALE));
+        memcpy(result.timeline, boot_timeline(), sizeof(result.timeline));
+        for (int i = 0; i < BOOT_PHASE_COUNT; i++)
+        {
+            result.done[i] = boot_phase_is_done((boot_phase_t)i);
+        }
+        CHECK(write(fds[1], &result, sizeof(result)) == sizeof(result));
+        _exit(0);
+    }
+    close(fds[1]);
+    result_t result;
+    CHECK(read(fds[0], &result, sizeof(result)) == sizeof(result));
+    close(fds[0]);
+    int status;
+    CHECK(waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    return result;
+}
+
+// Milliseconds since power on the device. The clock runs since the test started, so it is taken
+// relative to the first phase.
+static int64_t device_ms(const result_t *r, int64_t us)
+{
+    return (us - r->timeline[BOOT_PHASE_NVS].started_us) * TIME_SCALE / 1000;
+}
+
+static int64_t first_temp_ms(const result_t *r)
+{
+    return device_ms(r, r->timeline[BOOT_PHASE_FIRST_TEMP].done_us);
+}
+
+static void check_timeline(const result_t *r)
+{
+    for (int i = 0; i < BOOT_PHASE_COUNT; i++)
+    {
+        if (r->done[i])
+        {
+            CHECK(r->timeline[i].started_us > 0);
+            CHECK(r->timeline[i].done_us >= r->timeline[i].started_us);
+        }
+    }
+    // NVS comes first, everything else needs it
+    const boot_phase_t after_nvs[] = {BOOT_PHASE_SETTINGS, BOOT_PHASE_SPIFFS, BOOT_PHASE_BLE, BOOT_PHASE_WIFI};
+    for (boot_phase_t phase : after_nvs)
+    {
+        CHECK(r->timeline[phase].started_us >= r->timeline[BOOT_PHASE_NVS].done_us);
+    }
+    CHECK(r->spiffs_waited);
+    CHECK(r->timeline[BOOT_PHASE_FIRST_TEMP].result == ESP_OK);
+}
+
+static void print_timeline(const char *title, const result_t *r)
+{
+    printf("%s\n", title);
+    for (int i = 0; i < BOOT_PHASE_COUNT; i++)
+    {
+        if (r->done[i])
+        {
+            printf("  %-15s %5lld .. %5lld ms\n", boot_phase_name((boot_phase_t)i),
+                   (long long)device_ms(r, r->timeline[i].started_us), (long long)device_ms(r, r->timeline[i].done_us));
+        }
+        else
+        {
+            printf("  %-15s not reached\n", boot_phase_name((boot_phase_t)i));
+        }
+    }
+}
+
+int main()
+{
+    result_t parallel = run(MODE_PARALLEL);
+    result_t serial = run(MODE_SERIAL);
+    result_t parallel_ap = run(MODE_PARALLEL_AP);
+    result_t serial_ap = run(MODE_SERIAL_AP);
+
+    check_timeline(&parallel);
+    check_timeline(&serial);
+    check_timeline(&parallel_ap);
+
+    // BLE no longer waits for the association, the first temperature arrives before WiFi is up
+    CHECK(parallel.timeline[BOOT_PHASE_BLE].started_us < parallel.timeline[BOOT_PHASE_NETWORK_UP].done_us);
+    CHECK(parallel.timeline[BOOT_PHASE_FIRST_TEMP].done_us < parallel.timeline[BOOT_PHASE_NETWORK_UP].done_us);
+    CHECK(serial.timeline[BOOT_PHASE_BLE].started_us >= serial.timeline[BOOT_PHASE_NETWORK_UP].done_us);
+    CHECK(first_temp_ms(&parallel) < first_temp_ms(&serial));
+    // Without a network BLE still starts, before it never did
+    CHECK(parallel_ap.done[BOOT_PHASE_FIRST_TEMP]);
+    CHECK(!parallel_ap.done[BOOT_PHASE_NETWORK_UP]);
+    CHECK(!serial_ap.done[BOOT_PHASE_BLE]);
+    CHECK(!serial_ap.done[BOOT_PHASE_FIRST_TEMP]);
+
+    print_timeline("boot: parallel", &parallel);
+    print_timeline("boot: BLE after WiFi", &serial);
+    printf("boot: first temperature after %lld ms, %lld ms when BLE waited for WiFi, "
+           "%lld ms in access point mode where it never came before\n",
+           (long long)first_temp_ms(&parallel), (long long)first_temp_ms(&serial), (long long)first_temp_ms(&parallel_ap));
+    printf("boot: ok\n");
+    return 0;
+}
@@ -0,0 +1,306 @@
+#include "capture_records.h"
+#include "ibbq_notify.h"
+#include "ibbq_sim.h"
+
+#include <string.h>
+#include <vector>
+
+#include "check.h"
+
+#define RING_SIZE 256
+#define RING_RECORDS 100000
+// Chunks of a download, as in capture_get_handler()
+#define CHUNK_SIZE 512
+#define COOK_S (6 * 3600)
+#define BATTERY_INTERVAL_S 30
+#define RSSI_INTERVAL_S 60
+
+static uint8_t pattern(uint32_t sequence, size_t i)
+{
+    return (uint8_t)(sequence * 31 + i * 7);
+}
+
+// What GET /capture sends, the header and then the records in chunks of whole records
+static std::vector<uint8_t> download(const capture_ring_t *ring)
+{
+    ble_capture_header_t header = {};
+    header.magic = BLE_CAPTURE_MAGIC;
+    header.version = BLE_CAPTURE_VERSION;
+    header.dropped = ring->dropped;
+    std::vector<uint8_t> capture((const uint8_t *)&header, (const uint8_t *)&header + sizeof(header));
+    uint8_t chunk[CHUNK_SIZE];
+    uint32_t pos = 0;
+    while (true)
+    {
+        size_t copied = 0;
+        size_t length;
+        while ((length = capture_ring_read(ring, &pos, chunk + copied, sizeof(chunk) - copied)) > 0)
+        {
+            copied += length;
+        }
+        if (copied == 0)
+        {
+            break;
+        }
+        capture.insert(capture.end(), chunk, chunk + copied);
+    }
+    return capture;
+}
+
+// Records of every length, a reader that falls behind while the writer keeps overwriting the
+// ring only ever sees whole records in order and skips the ones it missed
+static void test_ring()
+{
+    uint8_t buffer[RING_SIZE];
+    capture_ring_t ring;
+    capture_ring_init(&ring, buffer, sizeof(buffer));
+    uint32_t seed = 5;
+    uint32_t pos = 0;
+    uint32_t next_expected = 0;
+    uint32_t read = 0;
+    uint32_t skipped = 0;
+    for (uint32_t sequence = 0; sequence < RING_RECORDS; sequence++)
+    {
+        uint8_t data[BLE_CAPTURE_MAX_DATA + 8];
+        size_t length = sequence % sizeof(data);
+        for (size_t i = 0; i < length; i++)
+        {
+            data[i] = pattern(sequence, i);
+        }
+        capture_ring_append(&ring, sequence, BLE_CAPTURE_NOTIFY, sequence & 0xffff, data, length);
+        CHECK(ring.head - ring.tail <= RING_SIZE);
+
+        // The reader gets to run now and then and reads a few records each time
+        if (xorshift(&seed) % 4 != 0)
+        {
+            continue;
+        }
+        for (uint32_t n = xorshift(&seed) % 8; n > 0; n--)
+        {
+            uint8_t out[sizeof(ble_capture_record_t) + BLE_CAPTURE_MAX_DATA];
+            size_t copied = capture_ring_read(&ring, &pos, out, sizeof(out));
+            if (copied == 0)
+            {
+                CHECK(pos == ring.head);
+                break;
+            }
+            ble_capture_record_t record;
+            memcpy(&record, out, sizeof(record));
+            CHECK(record.time_ms >= next_expected);
+            skipped += record.time_ms - next_expected;
+            next_expected = record.time_ms + 1;
+            read++;
+            size_t expected_length = record.time_ms % sizeof(data);
+            if (expected_length > BLE_CAPTURE_MAX_DATA)
+            {
+                expected_length = BLE_CAPTURE_MAX_DATA;
+            }
+            CHECK(record.type == BLE_CAPTURE_NOTIFY && record.uuid == (record.time_ms & 0xffff));
+            CHECK(record.length == expected_length && copied == sizeof(record) + expected_length);
+            for (size_t i = 0; i < record.length; i++)
+            {
+                CHECK(out[sizeof(record) + i] == pattern(record.time_ms, i));
+            }
+        }
+    }
+    CHECK(read > 10000 && skipped > 10000);
+
+    // What is left is the newest records, everything older was counted as dropped
+    std::vector<uint8_t> capture = download(&ring);
+    uint32_t records;
+    CHECK(capture_parse(capture.data(), capture.size(), &records));
+    CHECK(ring.dropped + records == RING_RECORDS);
+    size_t offset = 0;
+    for (uint32_t i = 0; i < records; i++)
+    {
+        ble_capture_record_t record;
+        const uint8_t *data;
+        capture_next_record(capture.data(), &offset, &record, &data);
+        CHECK(record.time_ms == ring.dropped + i);
+    }
+
+    // A record that doesn't fit into what is left of a chunk stays for the next one
+    capture_ring_init(&ring, buffer, sizeof(buffer));
+    const uint8_t data[10] = {};
+    capture_ring_append(&ring, 1, BLE_CAPTURE_NOTIFY, 0, data, sizeof(data));
+    pos = 0;
+    uint8_t small[sizeof(ble_capture_record_t) + sizeof(data) - 1];
+    CHECK(capture_ring_read(&ring, &pos, small, sizeof(small)) == 0 && pos == 0);
+}
+
+static void test_parse()
+{
+    uint8_t buffer[1024];
+    capture_ring_t ring;
+    capture_ring_init(&ring, buffer, sizeof(buffer));
+    const uint8_t payload[] = {1, 2, 3, 4, 5, 6};
+    capture_ring_append(&ring, 10, BLE_CAPTURE_READY, 0, NULL, 0);
+    capture_ring_append(&ring, 20, BLE_CAPTURE_NOTIFY, IBBQ_UUID_REALTIME_DATA, payload, sizeof(payload));
+    std::vector<uint8_t> capture = download(&ring);
+    uint32_t records;
+    CHECK(capture_parse(capture.data(), capture.size(), &records) && records == 2);
+    CHECK(capture_parse(capture.data(), sizeof(ble_capture_header_t), &records) && records == 0);
+
+    // Truncated anywhere, with trailing bytes or from another version
+    for (size_t length = 0; length < capture.size(); length++)
+    {
+        CHECK(!capture_parse(capture.data(), length, &records) || length == sizeof(ble_capture_header_t) ||
+              length == sizeof(ble_capture_header_t) + sizeof(ble_capture_record_t));
+    }
+    capture.push_back(0);
+    CHECK(!capture_parse(capture.data(), capture.size(), &records));
+    capture.pop_back();
+    std::vector<uint8_t> changed = capture;
+    changed[0] ^= 1;
+    CHECK(!capture_parse(changed.data(), changed.size(), &records));
+    changed = capture;
+    changed[offsetof(ble_capture_header_t, version)] = BLE_CAPTURE_VERSION + 1;
+    CHECK(!capture_parse(changed.data(), changed.size(), &records));
+}
+
+static void test_notify()
+{
+    uint16_t raw[MAX_PROBE_COUNT];
+    const uint8_t realtime[] = {0xd7, 0x00, 0xf6, 0xff, 0x51, 0x04, 0x00};
+    CHECK(ibbq_parse_realtime(realtime, sizeof(realtime), raw) == 3);
+    CHECK(raw[0] == 215 && raw[1] == 0xFFF6 && raw[2] == 1105);
+    uint8_t many[2 * MAX_PROBE_COUNT + 4] = {};
+    CHECK(ibbq_parse_realtime(many, sizeof(many), raw) == MAX_PROBE_COUNT);
+
+    float battery = -1;
+    const uint8_t settings[] = {0x24, 0xb0, 0x13, 0x98, 0x19};
+    CHECK(!ibbq_parse_battery(settings, 4, &battery) && battery == -1);
+    CHECK(ibbq_parse_battery(settings, sizeof(settings), &battery) && battery == 100 * 5040 / 6552);
+    // A thermometer without a maximum voltage
+    const uint8_t no_max[] = {0x24, 0x9b, 0x0c, 0x00, 0x00};
+    CHECK(ibbq_parse_battery(no_max, sizeof(no_max), &battery) && battery == 100 * 3227 / IBBQ_MAX_VOLTAGE);
+}
+
+typedef struct expected_sample
+{
+    uint32_t time_ms;
+    size_t count;
+    uint16_t raw[SIM_MAX_PROBES];
+} expected_sample_t;
+
+// Records a simulated cook the way the BLE callbacks of ibbq.cpp would, then replays the download
+// through the same decoding and checks it reproduces every sample and connection change
+static void test_replay()
+{
+    std::vector<uint8_t> buffer(4 * 1024 * 1024);
+    capture_ring_t ring;
+    capture_ring_init(&ring, buffer.data(), buffer.size());
+
+    sim_device_config_t config;
+    sim_default_config(&config, 3);
+    config.dropouts_per_hour = 4;
+    sim_device_t device;
+    sim_device_init(&device, &config);
+
+    std::vector<expected_sample_t> expected;
+    uint32_t connects = 0;
+    uint32_t disconnects = 0;
+    bool connected = false;
+    uint8_t rssi = 0;
+    float battery = 0;
+    for (uint32_t s = 0; s < COOK_S; s++)
+    {
+        uint32_t time_ms = s * 1000;
+        uint16_t raw[SIM_MAX_PROBES];
+        bool link = sim_device_step(&device, raw);
+        if (link && !connected)
+        {
+            const uint8_t discovered[] = {0xc1, 0x23, 0x45, 0x67, 0x89, 0xab, (uint8_t)-60};
+            const uint8_t success = 1;
+            capture_ring_append(&ring, time_ms, BLE_CAPTURE_DISCOVERED, 0, discovered, sizeof(discovered));
+            capture_ring_append(&ring, time_ms, BLE_CAPTURE_CONNECT, 0, &success, 1);
+            capture_ring_append(&ring, time_ms, BLE_CAPTURE_READY, 0, NULL, 0);
+            connected = true;
+            connects++;
+        }
+        else if (!link && connected)
+        {
+            capture_ring_append(&ring, time_ms, BLE_CAPTURE_DISCONNECTED, 0, NULL, 0);
+            connected = false;
+            disconnects++;
+        }
+        if (!link)
+        {
+            continue;
+        }
+
+        uint8_t payload[2 * SIM_MAX_PROBES];
+        expected_sample_t sample = {time_ms, config.probe_count, {}};
+        for (size_t i = 0; i < config.probe_count; i++)
+        {
+            payload[2 * i] = raw[i];
+            payload[2 * i + 1] = raw[i] >> 8;
+            sample.raw[i] = raw[i];
+        }
+        capture_ring_append(&ring, time_ms, BLE_CAPTURE_NOTIFY, IBBQ_UUID_REALTIME_DATA, payload,
+                            2 * config.probe_count);
+        expected.push_back(sample);
+        if (s % BATTERY_INTERVAL_S == 0)
+        {
+            uint16_t voltage = 60 * device.battery_percent;
+            const uint8_t settings[] = {0x24, (uint8_t)voltage, (uint8_t)(voltage >> 8), 0x70, 0x17};
+            capture_ring_append(&ring, time_ms, BLE_CAPTURE_NOTIFY, IBBQ_UUID_SETTINGS_RESULT, settings,
+                                sizeof(settings));
+            battery = 100 * voltage / 6000;
+        }
+        if (s % RSSI_INTERVAL_S == 0)
+        {
+            rssi = (uint8_t)(-50 - (int)(s / RSSI_INTERVAL_S % 30));
+            capture_ring_append(&ring, time_ms, BLE_CAPTURE_RSSI, 0, &rssi, 1);
+        }
+    }
+    CHECK(ring.dropped == 0 && connects > 5 && disconnects > 5);
+
+    std::vector<uint8_t> capture = download(&ring);
+    uint32_t records;
+    CHECK(capture_parse(capture.data(), capture.size(), &records));
+    capture_replay_state_t state = {};
+    size_t offset = 0;
+    size_t samples = 0;
+    uint32_t replayed_connects = 0;
+    uint32_t replayed_disconnects = 0;
+    for (uint32_t i = 0; i < records; i++)
+    {
+        ble_capture_record_t record;
+        const uint8_t *data;
+        capture_next_record(capture.data(), &offset, &record, &data);
+        switch (capture_replay_apply(&state, &record, data))
+        {
+        case CAPTURE_REPLAY_CONNECTED:
+            replayed_connects++;
+            break;
+        case CAPTURE_REPLAY_DISCONNECTED:
+            replayed_disconnects++;
+            CHECK(!state.connected && state.probe_count == 0);
+            break;
+        case CAPTURE_REPLAY_TEMPS:
+        {
+            CHECK(state.connected && samples < expected.size());
+            const expected_sample_t &sample = expected[samples++];
+            CHECK(record.time_ms == sample.time_ms && state.probe_count == sample.count);
+            CHECK(memcmp(state.raw_values, sample.raw, sample.count * sizeof(uint16_t)) == 0);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    CHECK(offset == capture.size());
+    CHECK(samples == expected.size() && replayed_connects == connects && replayed_disconnects == disconnects);
+    CHECK(state.connected == connected && state.battery_percent == battery && state.rssi == rssi);
+}
+
+int main()
+{
+    test_ring();
+    test_parse();
+    test_notify();
+    test_replay();
+    printf("capture_records: ok\n");
+    return 0;
+}
@@ -0,0 +1,151 @@
+#include "cbor_stream.h"
+
+#include <math.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "check.h"
+
+typedef struct sink
+{
+    std::string bytes;
+    std::vector<size_t> writes;
+    // Number of writes that succeed, the ones after fail
+    size_t succeed;
+} sink_t;
+
+static bool write_sink(const uint8_t *data, size_t len, void *ctx)
+{
+    sink_t *sink = (sink_t *)ctx;
+    sink->writes.push_back(len);
+    if (sink->writes.size() > sink->succeed)
+    {
+        return false;
+    }
+    sink->bytes.append((const char *)data, len);
+    return true;
+}
+
+static std::string hex(const std::string &bytes)
+{
+    std::string out;
+    for (size_t i = 0; i < bytes.size(); i++)
+    {
+        char digits[3];
+        snprintf(digits, sizeof(digits), "%02x", (uint8_t)bytes[i]);
+        out += digits;
+    }
+    return out;
+}
+
+#define CHECK_ENCODING(expected, call)                \
+    do                                                \
+    {                                                 \
+        sink_t sink = {};                             \
+        sink.succeed = SIZE_MAX;                      \
+        cbor_stream_t stream;                         \
+        cbor_stream_init(&stream, write_sink, &sink); \
+        call;                                         \
+        CHECK(cbor_stream_finish(&stream));           \
+        CHECK(hex(sink.bytes) == expected);           \
+        CHECK(stream.total == sink.bytes.size());     \
+    } while (0)
+
+// Examples from RFC 7049 appendix A
+static void test_rfc_examples()
+{
+    CHECK_ENCODING("00", cbor_stream_uint(&stream, 0));
+    CHECK_ENCODING("17", cbor_stream_uint(&stream, 23));
+    CHECK_ENCODING("1818", cbor_stream_uint(&stream, 24));
+    CHECK_ENCODING("1903e8", cbor_stream_uint(&stream, 1000));
+    CHECK_ENCODING("1a000f4240", cbor_stream_uint(&stream, 1000000));
+    CHECK_ENCODING("1b000000e8d4a51000", cbor_stream_uint(&stream, 1000000000000ULL));
+    CHECK_ENCODING("1bffffffffffffffff", cbor_stream_uint(&stream, UINT64_MAX));
+    CHECK_ENCODING("20", cbor_stream_int(&stream, -1));
+    CHECK_ENCODING("29", cbor_stream_int(&stream, -10));
+    CHECK_ENCODING("3863", cbor_stream_int(&stream, -100));
+    CHECK_ENCODING("3903e7", cbor_stream_int(&stream, -1000));
+    CHECK_ENCODING("3b7fffffffffffffff", cbor_stream_int(&stream, INT64_MIN));
+    CHECK_ENCODING("f4", cbor_stream_bool(&stream, false));
+    CHECK_ENCODING("f5", cbor_stream_bool(&stream, true));
+    CHECK_ENCODING("f6", cbor_stream_null(&stream));
+    CHECK_ENCODING("60", cbor_stream_string(&stream, ""));
+    CHECK_ENCODING("6449455446", cbor_stream_string(&stream, "IETF"));
+    CHECK_ENCODING("62c3bc", cbor_stream_string(&stream, "\xC3\xBC"));
+    CHECK_ENCODING("80", cbor_stream_array(&stream, 0));
+    CHECK_ENCODING("83010203", cbor_stream_array(&stream, 3); cbor_stream_uint(&stream, 1);
+                   cbor_stream_uint(&stream, 2); cbor_stream_uint(&stream, 3));
+    CHECK_ENCODING("a201020304", cbor_stream_map(&stream, 2); cbor_stream_uint(&stream, 1);
+                   cbor_stream_uint(&stream, 2); cbor_stream_uint(&stream, 3); cbor_stream_uint(&stream, 4));
+}
+
+static void test_floats()
+{
+    // Whole numbers become integers
+    CHECK_ENCODING("00", cbor_stream_float(&stream, 0.0f));
+    CHECK_ENCODING("1a000186a0", cbor_stream_float(&stream, 100000.0f));
+    CHECK_ENCODING("3818", cbor_stream_float(&stream, -25.0f));
+    CHECK_ENCODING("fa3fc00000", cbor_stream_float(&stream, 1.5f));
+    CHECK_ENCODING("fac0833333", cbor_stream_float(&stream, -4.1f));
+    CHECK_ENCODING("fa7f7fffff", cbor_stream_float(&stream, 3.4028234663852886e+38f));
+    CHECK_ENCODING("fa4f000000", cbor_stream_float(&stream, 2147483648.0f));
+    CHECK_ENCODING("fa7f800000", cbor_stream_float(&stream, INFINITY));
+    CHECK_ENCODING("fa7fc00000", cbor_stream_float(&stream, NAN));
+}
+
+static void test_buffering()
+{
+    sink_t sink = {};
+    sink.succeed = SIZE_MAX;
+    cbor_stream_t stream;
+    cbor_stream_init(&stream, write_sink, &sink);
+    std::string expected;
+    std::string text(300, 'x');
+    cbor_stream_array(&stream, 100);
+    expected += "\x98\x64";
+    for (int i = 0; i < 100; i++)
+    {
+        cbor_stream_string(&stream, text.c_str() + (i * 7) % 300);
+        size_t len = 300 - (i * 7) % 300;
+        expected += len < 24 ? std::string(1, 0x60 | len) : len < 256 ? std::string("\x78") + (char)len
+                                                                       : std::string("\x79\x01") + (char)(len & 0xFF);
+        expected += text.substr(0, len);
+    }
+    CHECK(cbor_stream_finish(&stream));
+    CHECK(sink.bytes == expected);
+    CHECK(stream.total == expected.size());
+    for (size_t i = 0; i + 1 < sink.writes.size(); i++)
+    {
+        CHECK(sink.writes[i] == CBOR_STREAM_BUF_SIZE);
+    }
+    CHECK(sink.writes.back() > 0 && sink.writes.back() <= CBOR_STREAM_BUF_SIZE);
+}
+
+static void test_write_failure()
+{
+    sink_t sink = {};
+    sink.succeed = 1;
+    cbor_stream_t stream;
+    cbor_stream_init(&stream, write_sink, &sink);
+    std::string text(200, 'y');
+    for (int i = 0; i < 10; i++)
+    {
+        cbor_stream_string(&stream, text.c_str());
+    }
+    CHECK(!cbor_stream_finish(&stream));
+    // Nothing is written after the first failure
+    CHECK(sink.writes.size() == 2);
+    CHECK(sink.bytes.size() == CBOR_STREAM_BUF_SIZE);
+    CHECK(stream.total == 10 * (2 + text.size()));
+}
+
+int main()
+{
+    test_rfc_examples();
+    test_floats();
+    test_buffering();
+    test_write_failure();
+    printf("cbor_stream: ok\n");
+    return 0;
+}
@@ -0,0 +1,158 @@
+#include "Channel.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "check.h"
+
+#define STRESS_ITEMS 1000000
+#define STRESS_PRODUCERS 4
+
+static int live_items = 0;
+
+// Counts constructions and destructions, so leaked or doubly destroyed items show up
+struct counted
+{
+    int value;
+    counted(int value = 0) : value(value) { live_items++; }
+    counted(const counted &other) : value(other.value) { live_items++; }
+    counted &operator=(const counted &other) = default;
+    ~counted() { live_items--; }
+};
+
+static void test_fifo()
+{
+    Channel<int, 4> channel;
+    CHECK(channel.empty());
+    CHECK(channel.capacity() == 4);
+    for (int i = 0; i < 4; i++)
+    {
+        CHECK(channel.trySend(i));
+    }
+    CHECK(!channel.trySend(4));
+    CHECK(channel.size() == 4);
+    int item;
+    for (int round = 0; round < 10; round++)
+    {
+        CHECK(channel.tryReceive(item));
+        CHECK(item == round);
+        CHECK(channel.trySend(round + 4));
+    }
+    int items[8];
+    CHECK(channel.receive(items, 8, 0) == 4);
+    for (int i = 0; i < 4; i++)
+    {
+        CHECK(items[i] == 10 + i);
+    }
+    CHECK(!channel.tryReceive(item));
+    CHECK(channel.receive(items, 8, 0) == 0);
+}
+
+static void test_move_only()
+{
+    Channel<std::unique_ptr<int>, 2> channel;
+    std::unique_ptr<int> value(new int(7));
+    CHECK(channel.send(std::move(value), 0));
+    CHECK(value == nullptr);
+    CHECK(channel.tryEmplace(new int(8)));
+
+    // A failed send leaves the item with the caller
+    std::unique_ptr<int> kept(new int(9));
+    CHECK(!channel.send(std::move(kept), 0));
+    CHECK(kept != nullptr && *kept == 9);
+
+    std::unique_ptr<int> out;
+    CHECK(channel.tryReceive(out) && *out == 7);
+    CHECK(channel.tryReceive(out) && *out == 8);
+}
+
+static void test_lifetime()
+{
+    {
+        Channel<counted, 8> channel;
+        for (int i = 0; i < 5; i++)
+        {
+            CHECK(channel.tryEmplace(i));
+        }
+        counted item;
+        CHECK(channel.tryReceive(item) && item.value == 0);
+        CHECK(live_items == 5);
+    }
+    // The items still queued were destroyed with the channel
+    CHECK(live_items == 0);
+}
+
+static void test_timeouts()
+{
+    Channel<int, 2> channel;
+    int item;
+    int64_t start = now_ns();
+    CHECK(!channel.receive(item, 50));
+    int64_t waited_ms = (now_ns() - start) / 1000000;
+    CHECK(waited_ms >= 45 && waited_ms < 1000);
+
+    CHECK(channel.trySend(1) && channel.trySend(2));
+    start = now_ns();
+    CHECK(!channel.send(3, 20));
+    CHECK((now_ns() - start) / 1000000 >= 15);
+
+    // A waiting consumer wakes up for an item sent later
+    Channel<int, 2> later;
+    std::thread producer([&later]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        later.trySend(42);
+    });
+    CHECK(later.receive(item, Channel<int, 2>::WAIT_FOREVER) && item == 42);
+    producer.join();
+}
+
+// Items of every producer arrive complete and in the order they were sent
+template <size_t Producers>
+static void stress()
+{
+    static Channel<uint32_t, 64, (Producers > 1)> channel;
+    std::vector<std::thread> producers;
+    for (uint32_t p = 0; p < Producers; p++)
+    {
+        producers.emplace_back([p]() {
+            for (uint32_t i = 0; i < STRESS_ITEMS / Producers; i++)
+            {
+                CHECK(channel.send(p << 24 | i));
+            }
+        });
+    }
+    uint32_t next[Producers] = {};
+    uint32_t received = 0;
+    uint32_t batch[16];
+    while (received < STRESS_ITEMS / Producers * Producers)
+    {
+        size_t count = channel.receive(batch, 16, 1000);
+        CHECK(count > 0);
+        for (size_t i = 0; i < count; i++)
+        {
+            uint32_t producer = batch[i] >> 24;
+            CHECK(producer < Producers);
+            CHECK((batch[i] & 0xFFFFFF) == next[producer]);
+            next[producer]++;
+        }
+        received += count;
+    }
+    for (auto &thread : producers)
+    {
+        thread.join();
+    }
+    CHECK(channel.empty());
+}
+
+int main()
+{
+    test_fifo();
+    test_move_only();
+    test_lifetime();
+    test_timeouts();
+    stress<1>();
+    stress<STRESS_PRODUCERS>();
+    printf("Channel: ok\n");
+    return 0;
+}
@@ -0,0 +1,309 @@
+#include "dns_message.h"
+
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "check.h"
+
+#define FUZZ_ITERATIONS 200000
+#define RCODE_NOERROR 0
+#define RCODE_FORMERR 1
+#define RCODE_NOTIMP 4
+#define RCODE_REFUSED 5
+#define TYPE_A 1
+#define TYPE_AAAA 28
+#define TYPE_ANY 255
+#define HEADER_SIZE 12
+#define OPT_SIZE 11
+
+typedef std::vector<uint8_t> packet_t;
+
+// 192.168.4.1 in network byte order, the address of the access point
+static const uint32_t AP_IP = 0x0104a8c0;
+
+static void put_u16(packet_t *p, uint16_t value)
+{
+    p->push_back(value >> 8);
+    p->push_back(value & 0xff);
+}
+
+static uint16_t get_u16(const packet_t &p, size_t offset)
+{
+    return (uint16_t)(p[offset] << 8 | p[offset + 1]);
+}
+
+static void put_name(packet_t *p, const std::string &name)
+{
+    size_t start = 0;
+    while (start < name.size())
+    {
+        size_t end = name.find('.', start);
+        if (end == std::string::npos)
+        {
+            end = name.size();
+        }
+        p->push_back(end - start);
+        p->insert(p->end(), name.begin() + start, name.begin() + end);
+        start = end + 1;
+    }
+    p->push_back(0);
+}
+
+// A query with one question like a phone sends it, edns_version < 0 leaves out the OPT record
+static packet_t query(const std::string &name, uint16_t qtype, int edns_version = -1)
+{
+    packet_t p;
+    put_u16(&p, 0x1bb0);
+    p.push_back(0x01); // RD
+    p.push_back(0x00);
+    put_u16(&p, 1);
+    put_u16(&p, 0);
+    put_u16(&p, 0);
+    put_u16(&p, edns_version >= 0 ? 1 : 0);
+    put_name(&p, name);
+    put_u16(&p, qtype);
+    put_u16(&p, 1);
+    if (edns_version >= 0)
+    {
+        p.push_back(0);
+        put_u16(&p, 41);
+        put_u16(&p, 1232);
+        p.push_back(0);
+        p.push_back(edns_version);
+        put_u16(&p, 0);
+        put_u16(&p, 0);
+    }
+    return p;
+}
+
+static std::string repeat(char c, size_t count)
+{
+    return std::string(count, c);
+}
+
+typedef struct expected
+{
+    const char *title;
+    packet_t query;
+    // -1 if the query is dropped
+    int rcode;
+    int answers;
+    bool opt;
+} expected_t;
+
+static std::vector<expected_t> corpus()
+{
+    std::vector<expected_t> c;
+    c.push_back({"our name", query("ibbq.gateway", TYPE_A), RCODE_NOERROR, 1, false});
+    c.push_back({"mixed case", query("IBbQ.GateWAY", TYPE_A), RCODE_NOERROR, 1, false});
+    c.push_back({"AAAA", query("ibbq.gateway", TYPE_AAAA), RCODE_NOERROR, 0, false});
+    c.push_back({"ANY", query("ibbq.gateway", TYPE_ANY), RCODE_NOERROR, 1, false});
+    c.push_back({"other name", query("connectivitycheck.gstatic.com", TYPE_A), RCODE_REFUSED, 0, false});
+    c.push_back({"longer name", query("ibbq.gateway.lan", TYPE_A), RCODE_REFUSED, 0, false});
+    c.push_back({"shorter name", query("ibbq", TYPE_A), RCODE_REFUSED, 0, false});
+    c.push_back({"EDNS0", query("ibbq.gateway", TYPE_A, 0), RCODE_NOERROR, 1, true});
+    c.push_back({"EDNS1", query("ibbq.gateway", TYPE_A, 1), RCODE_NOERROR, 0, true});
+    // 3 * 64 + 62 + 1 = 255 bytes, the longest valid name
+    c.push_back({"longest name", query(repeat('a', 63) + "." + repeat('b', 63) + "." + repeat('c', 63) + "." + repeat('d', 61), TYPE_A),
+                 RCODE_REFUSED, 0, false});
+    c.push_back({"name too long", query(repeat('a', 63) + "." + repeat('b', 63) + "." + repeat('c', 63) + "." + repeat('d', 63), TYPE_A),
+                 RCODE_FORMERR, 0, false});
+    c.push_back({"label too long", query(repeat('a', 64) + ".gateway", TYPE_A), RCODE_FORMERR, 0, false});
+
+    packet_t response = query("ibbq.gateway", TYPE_A);
+    response[2] |= 0x80;
+    c.push_back({"response", response, -1, 0, false});
+    c.push_back({"short", packet_t(response.begin(), response.begin() + HEADER_SIZE - 1), -1, 0, false});
+
+    packet_t status = query("ibbq.gateway", TYPE_A);
+    status[2] |= 2 << 3;
+    c.push_back({"opcode STATUS", status, RCODE_NOTIMP, 0, false});
+
+    packet_t two = query("ibbq.gateway", TYPE_A);
+    two[5] = 2;
+    c.push_back({"two questions", two, RCODE_FORMERR, 0, false});
+
+    packet_t pointer = query("ibbq.gateway", TYPE_A);
+    pointer.resize(HEADER_SIZE);
+    pointer.push_back(0xc0);
+    pointer.push_back(HEADER_SIZE);
+    put_u16(&pointer, TYPE_A);
+    put_u16(&pointer, 1);
+    c.push_back({"pointer in question", pointer, RCODE_FORMERR, 0, false});
+
+    packet_t truncated = query("ibbq.gateway", TYPE_A);
+    truncated.resize(truncated.size() - 3);
+    c.push_back({"truncated question", truncated, RCODE_FORMERR, 0, false});
+
+    packet_t missing = query("ibbq.gateway", TYPE_A);
+    missing[11] = 1;
+    c.push_back({"missing additional record", missing, RCODE_FORMERR, 0, false});
+
+    packet_t cut_opt = query("ibbq.gateway", TYPE_A, 0);
+    cut_opt.resize(cut_opt.size() - 4);
+    c.push_back({"cut OPT record", cut_opt, RCODE_FORMERR, 0, false});
+    return c;
+}
+
+// The packet and the response live in blocks of their exact size, so ASan sees every access past them
+static int respond(const dns_responder_t *responder, const packet_t &q, packet_t *resp)
+{
+    uint8_t *pkt = new uint8_t[q.size() + 1];
+    memcpy(pkt, q.data(), q.size());
+    uint8_t *buffer = new uint8_t[DNS_MAX_PACKET_SIZE];
+    size_t len = dns_build_response(responder, pkt, q.size(), buffer);
+    resp->assign(buffer, buffer + len);
+    delete[] buffer;
+    delete[] pkt;
+    return len > 0 ? resp->size() : -1;
+}
+
+// What every response has to be, whatever the query was
+static void check_invariants(const packet_t &q, const packet_t &resp)
+{
+    CHECK(resp.size() >= HEADER_SIZE && resp.size() <= DNS_MAX_PACKET_SIZE);
+    // Never answer a response, two servers would answer each other forever
+    CHECK((q[2] & 0x80) == 0);
+    CHECK(resp[0] == q[0] && resp[1] == q[1]);
+    CHECK(resp[2] & 0x80);
+    uint16_t qdcount = get_u16(resp, 4);
+    uint16_t ancount = get_u16(resp, 6);
+    CHECK(qdcount <= 1 && ancount <= qdcount && get_u16(resp, 8) == 0 && get_u16(resp, 10) <= 1);
+    if (qdcount == 1)
+    {
+        // The question is echoed as it came, with the case of the query
+        size_t question_len = resp.size() - HEADER_SIZE - ancount * DNS_ANSWER_SIZE - get_u16(resp, 10) * OPT_SIZE;
+        CHECK(q.size() >= HEADER_SIZE + question_len);
+        CHECK(memcmp(&q[HEADER_SIZE], &resp[HEADER_SIZE], question_len) == 0);
+    }
+}
+
+static void test_corpus()
+{
+    dns_responder_t responder;
+    CHECK(dns_responder_init(&responder, "ibbq.gateway.", false, AP_IP));
+    for (const expected_t &e : corpus())
+    {
+        packet_t resp;
+        int len = respond(&responder, e.query, &resp);
+        if (e.rcode < 0)
+        {
+            CHECK(len < 0);
+            continue;
+        }
+        if (len < 0)
+        {
+            fprintf(stderr, "%s: dropped\n", e.title);
+        }
+        CHECK(len > 0);
+        check_invariants(e.query, resp);
+        int rcode = resp[3] & 0x0f;
+        if (rcode != e.rcode || get_u16(resp, 6) != e.answers || (get_u16(resp, 10) == 1) != e.opt)
+        {
+            fprintf(stderr, "%s: rcode %d, %d answers, %d additional\n", e.title, rcode, get_u16(resp, 6), get_u16(resp, 10));
+        }
+        CHECK(rcode == e.rcode);
+        CHECK(get_u16(resp, 6) == e.answers);
+        CHECK((get_u16(resp, 10) == 1) == e.opt);
+        if (e.answers == 1)
+        {
+            // The answer points back to the question and carries the address of the access point
+            size_t answer = resp.size() - DNS_ANSWER_SIZE - (e.opt ? OPT_SIZE : 0);
+            CHECK(resp[answer] == 0xc0 && resp[answer + 1] == HEADER_SIZE);
+            CHECK(memcmp(&resp[answer + 12], &AP_IP, 4) == 0);
+        }
+        if (e.opt)
+        {
+            // BADVERS is the extended rcode 1 in the OPT record
+            CHECK(resp[resp.size() - OPT_SIZE + 5] == (e.answers == 0 ? 1 : 0));
+        }
+    }
+
+    // With answer_all every name gets the address, the captive portal catches all lookups
+    dns_responder_t all;
+    CHECK(dns_responder_init(&all, "ibbq.gateway.", true, AP_IP));
+    packet_t resp;
+    CHECK(respond(&all, query("connectivitycheck.gstatic.com", TYPE_A), &resp) > 0);
+    CHECK((resp[3] & 0x0f) == RCODE_NOERROR && get_u16(resp, 6) == 1);
+
+    dns_responder_t invalid;
+    CHECK(!dns_responder_init(&invalid, "ibbq..gateway", false, AP_IP));
+    CHECK(respond(&invalid, query("ibbq.gateway", TYPE_A), &resp) > 0);
+    CHECK((resp[3] & 0x0f) == RCODE_REFUSED);
+}
+
+static void mutate(uint32_t *seed, packet_t *p)
+{
+    size_t pos = p->empty() ? 0 : xorshift(seed) % p->size();
+    switch (xorshift(seed) % 5)
+    {
+    case 0:
+        if (!p->empty())
+        {
+            (*p)[pos] ^= 1 << (xorshift(seed) % 8);
+        }
+        break;
+    case 1:
+        if (!p->empty())
+        {
+            // Label lengths, counts and pointers are where the parser is most likely wrong
+            static const uint8_t interesting[] = {0x00, 0x01, 0x3f, 0x40, 0xc0, 0xff};
+            (*p)[pos] = interesting[xorshift(seed) % sizeof(interesting)];
+        }
+        break;
+    case 2:
+        p->resize(pos);
+        break;
+    case 3:
+        p->insert(p->begin() + pos, xorshift(seed) & 0xff);
+        break;
+    default:
+        if (p->size() < DNS_MAX_PACKET_SIZE)
+        {
+            size_t len = 1 + xorshift(seed) % (p->size() - pos + 1);
+            packet_t copy(p->begin() + pos, p->begin() + std::min(pos + len, p->size()));
+            p->insert(p->end(), copy.begin(), copy.end());
+        }
+        break;
+    }
+}
+
+static void test_fuzz()
+{
+    uint32_t seed = 0xd5a1;
+    std::vector<expected_t> seeds = corpus();
+    dns_responder_t responders[2];
+    CHECK(dns_responder_init(&responders[0], "ibbq.gateway.", false, AP_IP));
+    CHECK(dns_responder_init(&responders[1], "ibbq.gateway.", true, AP_IP));
+    int outcomes[16 + 1] = {};
+    for (int i = 0; i < FUZZ_ITERATIONS; i++)
+    {
+        packet_t q = seeds[xorshift(&seed) % seeds.size()].query;
+        int mutations = 1 + xorshift(&seed) % 4;
+        for (int m = 0; m < mutations; m++)
+        {
+            mutate(&seed, &q);
+        }
+        packet_t resp;
+        int len = respond(&responders[i % 2], q, &resp);
+        if (len < 0)
+        {
+            outcomes[16]++;
+            continue;
+        }
+        check_invariants(q, resp);
+        outcomes[resp[3] & 0x0f]++;
+    }
+    printf("fuzz: %d queries from %zu seeds, %d NOERROR, %d FORMERR, %d NOTIMP, %d REFUSED, %d dropped\n",
+           FUZZ_ITERATIONS, seeds.size(), outcomes[RCODE_NOERROR], outcomes[RCODE_FORMERR], outcomes[RCODE_NOTIMP],
+           outcomes[RCODE_REFUSED], outcomes[16]);
+}
+
+int main()
+{
+    test_corpus();
+    test_fuzz();
+    printf("dns_message: ok\n");
+    return 0;
+}
@@ -0,0 +1,153 @@
+#include "event_log.h"
+
+#include <string.h>
+#include <thread>
+#include <vector>
+#include <atomic>
+
+#include "check.h"
+
+#define WRITERS 4
+#define EVENTS_PER_WRITER 200000
+
+// The ring is a static, every test continues at the head the previous one left
+static uint32_t drain(uint32_t cursor)
+{
+    event_log_record_t record;
+    uint32_t lost = 0;
+    while (event_log_read(&cursor, &record, &lost))
+    {
+    }
+    return cursor;
+}
+
+static void test_order_and_format()
+{
+    uint32_t cursor = drain(event_log_oldest());
+    event_log(EVT_PROBE_TEMP, 3, 23.5f);
+    event_log(EVT_BATTERY_LEVEL, 87.0f);
+    event_log(EVT_BLE_DEVICE, 0xa4c138, 0x2f1e07, -71);
+
+    event_log_record_t record;
+    uint32_t lost = 0;
+    char line[64];
+    const char *expected[] = {"Probe 3 has value 23.5\n", "Current battery level 87 %\n",
+                              "Discovered device A4C1382F1E07 with RSSI -71\n"};
+    for (const char *text : expected)
+    {
+        CHECK(event_log_read(&cursor, &record, &lost));
+        int len = event_log_format(&record, line, sizeof(line));
+        CHECK(len == (int)strlen(line));
+        // The timestamp comes first
+        const char *message = strstr(line, ": ");
+        CHECK(message != NULL && strcmp(message + 2, text) == 0);
+    }
+    CHECK(!event_log_read(&cursor, &record, &lost));
+    CHECK(lost == 0);
+}
+
+static void test_truncation()
+{
+    event_log_record_t record = {};
+    record.timestamp_ms = 1234;
+    record.id = EVT_PROBE_TEMP;
+    record.argc = 2;
+    record.args[0].i = 1;
+    record.args[1].f = 99.25f;
+    char full[64];
+    int len = event_log_format(&record, full, sizeof(full));
+    CHECK(strcmp(full, "1234: Probe 1 has value 99.2\n") == 0 || strcmp(full, "1234: Probe 1 has value 99.3\n") == 0);
+    // Like snprintf it returns the full length and never writes past the buffer, ASan sees both
+    for (size_t size = 0; size < (size_t)len + 2; size++)
+    {
+        char *buf = new char[size + 1];
+        CHECK(event_log_format(&record, size > 0 ? buf : NULL, size) == len);
+        if (size > 0)
+        {
+            CHECK(strlen(buf) == (size <= (size_t)len ? size - 1 : (size_t)len));
+            CHECK(strncmp(buf, full, strlen(buf)) == 0);
+        }
+        delete[] buf;
+    }
+
+    record.id = EVT_COUNT + 3;
+    CHECK(event_log_format(&record, full, sizeof(full)) > 0);
+    CHECK(strcmp(full, "1234: unknown event 7\n") == 0);
+}
+
+static void test_overwrite()
+{
+    uint32_t cursor = drain(event_log_oldest());
+    for (int i = 0; i < EVENT_LOG_SIZE + 10; i++)
+    {
+        event_log(EVT_BLE_SCAN_FINISHED, i);
+    }
+    event_log_record_t record;
+    uint32_t lost = 0;
+    int expected = 10;
+    while (event_log_read(&cursor, &record, &lost))
+    {
+        CHECK(record.args[0].i == expected++);
+    }
+    CHECK(lost == 10);
+    CHECK(expected == EVENT_LOG_SIZE + 10);
+}
+
+// Writers on several threads against one reader. Every record carries its writer, its number and
+// a check value, a torn record or one of another lap shows up as a wrong check value.
+static void test_concurrent()
+{
+    uint32_t cursor = drain(event_log_oldest());
+    std::atomic<int> running(WRITERS);
+    std::vector<std::thread> writers;
+    for (int w = 0; w < WRITERS; w++)
+    {
+        writers.emplace_back([w, &running] {
+            for (int n = 0; n < EVENTS_PER_WRITER; n++)
+            {
+                event_log(EVT_BLE_DEVICE, w, n, w * 0x10001 ^ n);
+            }
+            running--;
+        });
+    }
+
+    int next[WRITERS] = {};
+    uint32_t read = 0;
+    uint32_t lost = 0;
+    event_log_record_t record;
+    bool done = false;
+    while (!done)
+    {
+        done = running == 0;
+        while (event_log_read(&cursor, &record, &lost))
+        {
+            int w = record.args[0].i;
+            int n = record.args[1].i;
+            CHECK(record.id == EVT_BLE_DEVICE && record.argc == 3);
+            CHECK(w >= 0 && w < WRITERS);
+            CHECK(record.args[2].i == (w * 0x10001 ^ n));
+            // A writer's records come in its order, lost ones leave gaps
+            CHECK(n >= next[w]);
+            next[w] = n + 1;
+            read++;
+        }
+    }
+    for (std::thread &t : writers)
+    {
+        t.join();
+    }
+    // The last pass started after every writer was done, it read up to the head
+    CHECK(read + lost == WRITERS * EVENTS_PER_WRITER);
+    printf("concurrent: %u of %d records read, %u overwritten before the reader came\n", read,
+           WRITERS * EVENTS_PER_WRITER, lost);
+}
+
+int main()
+{
+    test_order_and_format();
+    test_truncation();
+    test_overwrite();
+    test_concurrent();
+    printf("event_log: ok\n");
+    return 0;
+}
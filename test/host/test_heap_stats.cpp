@@ -0,0 +1,214 @@
+#include "heap_stats.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "esp_log.h"
+
+#include "check.h"
+
+#define HEADER_SIZE 8
+#define THREADS 4
+#define THREAD_ALLOCATIONS 100000
+
+// The allocator heap_stats.cpp calls, linked with --wrap=malloc,--wrap=free. It keeps the size of every
+// live block on its own, so the counters of heap_stats can be checked against what really went through
+// malloc.
+extern "C" void *__real_malloc(size_t size);
+extern "C" void __real_free(void *ptr);
+
+static std::mutex s_blocks_mutex;
+static std::unordered_map<void *, size_t> s_blocks;
+static std::atomic<int64_t> s_live_bytes(0);
+static std::atomic<uint32_t> s_mallocs(0);
+static std::atomic<bool> s_fail(false);
+
+extern "C" void *__wrap_malloc(size_t size)
+{
+    if (s_fail)
+    {
+        return NULL;
+    }
+    void *ptr = __real_malloc(size);
+    if (ptr != NULL)
+    {
+        std::lock_guard<std::mutex> lock(s_blocks_mutex);
+        s_blocks[ptr] = size;
+        s_live_bytes += size;
+        s_mallocs++;
+    }
+    return ptr;
+}
+
+extern "C" void __wrap_free(void *ptr)
+{
+    if (ptr != NULL)
+    {
+        std::lock_guard<std::mutex> lock(s_blocks_mutex);
+        auto block = s_blocks.find(ptr);
+        CHECK(block != s_blocks.end());
+        s_live_bytes -= block->second;
+        s_blocks.erase(block);
+    }
+    __real_free(ptr);
+}
+
+static heap_tag_stats_t stats(heap_tag_t tag)
+{
+    heap_tag_stats_t s;
+    heap_stats_get(tag, &s);
+    return s;
+}
+
+static void test_counts_match_malloc()
+{
+    heap_tag_stats_t json = stats(HEAP_TAG_JSON);
+    heap_tag_stats_t http = stats(HEAP_TAG_HTTP);
+    int64_t live = s_live_bytes;
+    uint32_t mallocs = s_mallocs;
+
+    std::vector<void *> blocks;
+    int32_t json_bytes = 0;
+    for (size_t size = 1; size <= 4096; size *= 2)
+    {
+        blocks.push_back(heap_stats_malloc(HEAP_TAG_JSON, size));
+        json_bytes += size;
+    }
+    void *zeroed = heap_stats_calloc(HEAP_TAG_HTTP, 10, 100);
+    for (int i = 0; i < 1000; i++)
+    {
+        CHECK(((uint8_t *)zeroed)[i] == 0);
+    }
+    // Blocks keep the 8 byte alignment of malloc
+    for (void *block : blocks)
+    {
+        CHECK(block != NULL && ((uintptr_t)block & 7) == 0);
+    }
+
+    CHECK(stats(HEAP_TAG_JSON).current_bytes == json.current_bytes + json_bytes);
+    CHECK(stats(HEAP_TAG_JSON).allocs == json.allocs + blocks.size());
+    CHECK(stats(HEAP_TAG_HTTP).current_bytes == http.current_bytes + 1000);
+    CHECK(s_mallocs == mallocs + blocks.size() + 1);
+    // What malloc handed out is the accounted bytes plus a header per block
+    CHECK(s_live_bytes - live == json_bytes + 1000 + (int64_t)(blocks.size() + 1) * HEADER_SIZE);
+
+    // The peak stays when the blocks go
+    for (size_t i = 0; i < blocks.size(); i += 2)
+    {
+        heap_stats_free(blocks[i]);
+    }
+    int32_t peak = stats(HEAP_TAG_JSON).peak_bytes;
+    CHECK(peak >= json.current_bytes + json_bytes);
+    for (size_t i = 1; i < blocks.size(); i += 2)
+    {
+        heap_stats_free(blocks[i]);
+    }
+    heap_stats_free(zeroed);
+    heap_stats_free(NULL);
+    CHECK(stats(HEAP_TAG_JSON).current_bytes == json.current_bytes);
+    CHECK(stats(HEAP_TAG_JSON).peak_bytes == peak);
+    CHECK(stats(HEAP_TAG_HTTP).current_bytes == http.current_bytes);
+    CHECK(s_live_bytes == live);
+}
+
+static void test_failures()
+{
+    heap_tag_stats_t before = stats(HEAP_TAG_UPLOAD);
+    uint32_t mallocs = s_mallocs;
+    // An overflowing calloc never gets to malloc
+    CHECK(heap_stats_calloc(HEAP_TAG_UPLOAD, SIZE_MAX / 2, 4) == NULL);
+    CHECK(s_mallocs == mallocs);
+    s_fail = true;
+    CHECK(heap_stats_malloc(HEAP_TAG_UPLOAD, 100) == NULL);
+    s_fail = false;
+    heap_tag_stats_t after = stats(HEAP_TAG_UPLOAD);
+    CHECK(after.failures == before.failures + 2);
+    CHECK(after.allocs == before.allocs && after.current_bytes == before.current_bytes);
+}
+
+// Memory a library took on its own is accounted without going through malloc here
+static void test_add()
+{
+    heap_tag_stats_t before = stats(HEAP_TAG_BLE);
+    int64_t live = s_live_bytes;
+    heap_stats_add(HEAP_TAG_BLE, 30000);
+    CHECK(stats(HEAP_TAG_BLE).current_bytes == before.current_bytes + 30000);
+    CHECK(stats(HEAP_TAG_BLE).peak_bytes >= before.current_bytes + 30000);
+    heap_stats_add(HEAP_TAG_BLE, -30000);
+    CHECK(stats(HEAP_TAG_BLE).current_bytes == before.current_bytes);
+    CHECK(s_live_bytes == live);
+    CHECK(strcmp(heap_tag_name(HEAP_TAG_SETTINGS), "settings") == 0);
+    CHECK(strcmp(heap_tag_name(HEAP_TAG_COUNT), "unknown") == 0);
+}
+
+// The counters are updated without a lock, tasks allocating at once must not lose an update
+static void test_threads()
+{
+    heap_tag_stats_t before[HEAP_TAG_COUNT];
+    for (int tag = 0; tag < HEAP_TAG_COUNT; tag++)
+    {
+        before[tag] = stats((heap_tag_t)tag);
+    }
+    int64_t live = s_live_bytes;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; t++)
+    {
+        threads.emplace_back([t]() {
+            uint32_t seed = t + 1;
+            void *held[16] = {};
+            for (int i = 0; i < THREAD_ALLOCATIONS; i++)
+            {
+                void **slot = &held[xorshift(&seed) % 16];
+                heap_stats_free(*slot);
+                *slot = heap_stats_malloc((heap_tag_t)(xorshift(&seed) % HEAP_TAG_COUNT), xorshift(&seed) % 512);
+            }
+            for (void *ptr : held)
+            {
+                heap_stats_free(ptr);
+            }
+        });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    uint32_t allocs = 0;
+    for (int tag = 0; tag < HEAP_TAG_COUNT; tag++)
+    {
+        heap_tag_stats_t after = stats((heap_tag_t)tag);
+        CHECK(after.current_bytes == before[tag].current_bytes);
+        CHECK(after.peak_bytes <= before[tag].current_bytes + THREADS * 16 * 512);
+        allocs += after.allocs - before[tag].allocs;
+    }
+    CHECK(allocs == THREADS * THREAD_ALLOCATIONS);
+    CHECK(s_live_bytes == live);
+}
+
+static void test_samples()
+{
+    heap_sample_t sample = heap_stats_sample_now();
+    CHECK(sample.free_bytes > 0 && sample.largest_free_block <= sample.free_bytes);
+    // The host reports the whole free heap as one block
+    CHECK(sample.fragmentation == 0);
+    heap_sample_t history[HEAP_SAMPLE_COUNT];
+    CHECK(heap_stats_history(history, HEAP_SAMPLE_COUNT) == 0);
+    heap_stats_init();
+    CHECK(heap_stats_history(history, HEAP_SAMPLE_COUNT) == 1);
+    CHECK(history[0].free_bytes > 0);
+}
+
+int main()
+{
+    esp_log_level_set("*", ESP_LOG_NONE);
+    test_counts_match_malloc();
+    test_failures();
+    test_add();
+    test_threads();
+    test_samples();
+    printf("heap_stats: ok\n");
+    return 0;
+}
@@ -0,0 +1,263 @@
+#include "HttpRequestParser.h"
+#include "HttpParser.h"
+#include "SocketReader.h"
+
+#include <string.h>
+#include <string>
+#include "esp_log.h"
+
+#include "check.h"
+
+// The parser only points into the request, which has to outlive the checks of the result
+static std::string parsed;
+
+static HttpRequestParser::Result parse_all(HttpRequestParser *parser, const std::string &request)
+{
+    parsed = request;
+    parser->reset();
+    return parser->parse(parsed.data(), parsed.size());
+}
+
+static int error_status(const std::string &request, size_t max_head_size = 2048)
+{
+    HttpRequestParser parser(max_head_size);
+    CHECK(parse_all(&parser, request) == HttpRequestParser::RESULT_ERROR);
+    return parser.getErrorStatus();
+}
+
+static std::string headers(int count)
+{
+    std::string text;
+    for (int i = 0; i < count; i++)
+    {
+        text += "X-Header-" + std::to_string(i) + ": " + std::to_string(i) + "\r\n";
+    }
+    return text;
+}
+
+static void test_request()
+{
+    const std::string request = "\r\nGET /data?probe=1 HTTP/1.1\r\nHost: ibbq.gateway\r\n"
+                                "Accept:application/cbor \r\nContent-Length: 0\r\n\r\nGET /next";
+    HttpRequestParser parser;
+    CHECK(parse_all(&parser, request) == HttpRequestParser::RESULT_COMPLETE);
+    CHECK(parser.getMethod().equals("GET"));
+    CHECK(parser.getPath().equals("/data?probe=1"));
+    CHECK(parser.getVersion().equals("HTTP/1.1"));
+    CHECK(parser.getHeaderCount() == 3);
+    HttpStringView value;
+    CHECK(parser.getHeader("accept", &value) && value.equals("application/cbor"));
+    CHECK(!parser.getHeader("Connection", &value));
+    CHECK(parser.getContentLength() == 0);
+    // The pipelined request is not part of the head
+    CHECK(parser.getHeadLength() == request.size() - strlen("GET /next"));
+
+    // Fed one byte at a time the parser ends up at the same place and never looks past the head
+    HttpRequestParser incremental;
+    size_t length = 0;
+    while (incremental.parse(request.data(), length) == HttpRequestParser::RESULT_INCOMPLETE)
+    {
+        length++;
+    }
+    CHECK(length == parser.getHeadLength());
+    CHECK(incremental.getPath().equals("/data?probe=1"));
+    CHECK(incremental.getHeaderCount() == 3);
+}
+
+static void test_limits()
+{
+    HttpRequestParser parser;
+    std::string path = "/" + std::string(HttpRequestParser::MAX_URL_LENGTH - 1, 'a');
+    CHECK(parse_all(&parser, "GET " + path + " HTTP/1.1\r\n\r\n") == HttpRequestParser::RESULT_COMPLETE);
+    CHECK(error_status("GET " + path + "a HTTP/1.1\r\n\r\n") == 414);
+
+    CHECK(parse_all(&parser, "GET / HTTP/1.1\r\n" + headers(HttpRequestParser::MAX_HEADERS) + "\r\n") ==
+          HttpRequestParser::RESULT_COMPLETE);
+    CHECK(error_status("GET / HTTP/1.1\r\n" + headers(HttpRequestParser::MAX_HEADERS + 1) + "\r\n") == 431);
+
+    // A head that doesn't end within the limit, with or without a complete request line
+    CHECK(error_status("GET / HTTP/1.1\r\nCookie: " + std::string(300, 'c'), 256) == 431);
+    CHECK(error_status("GET /" + std::string(300, 'a'), 256) == 414);
+    HttpRequestParser small(256);
+    std::string request = "GET / HTTP/1.1\r\nCookie: " + std::string(200, 'c') + "\r\n\r\n";
+    CHECK(request.size() < 256);
+    CHECK(parse_all(&small, request) == HttpRequestParser::RESULT_COMPLETE);
+}
+
+static void test_malformed()
+{
+    CHECK(error_status("GET / HTTP/2.0\r\n\r\n") == 505);
+    CHECK(error_status("GET / HTTP/1.10\r\n\r\n") == 505);
+    CHECK(error_status("GET /\r\n\r\n") == 400);
+    CHECK(error_status(" / HTTP/1.1\r\n\r\n") == 400);
+    CHECK(error_status("GET  HTTP/1.1\r\n\r\n") == 400);
+    // Obsolete line folding, a missing colon and whitespace before the colon
+    CHECK(error_status("GET / HTTP/1.1\r\nX-A: 1\r\n  folded\r\n\r\n") == 400);
+    CHECK(error_status("GET / HTTP/1.1\r\nX-A 1\r\n\r\n") == 400);
+    CHECK(error_status("GET / HTTP/1.1\r\nContent-Length : 5\r\n\r\n") == 400);
+    CHECK(error_status("GET / HTTP/1.1\r\n: 5\r\n\r\n") == 400);
+}
+
+// Every way the end of the body could be read differently by us and a proxy in front of us
+static void test_framing()
+{
+    CHECK(error_status("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nhello\r\n0\r\n\r\n") == 501);
+    CHECK(error_status("POST / HTTP/1.1\r\ntransfer-encoding: identity\r\nContent-Length: 5\r\n\r\n") == 501);
+    CHECK(error_status("POST / HTTP/1.1\r\nContent-Length: 5\r\nContent-Length: 5\r\n\r\n") == 400);
+    CHECK(error_status("POST / HTTP/1.1\r\nContent-Length: 5\r\ncontent-length: 6\r\n\r\n") == 400);
+    CHECK(error_status("POST / HTTP/1.1\r\nContent-Length: -1\r\n\r\n") == 400);
+    CHECK(error_status("POST / HTTP/1.1\r\nContent-Length: 5, 5\r\n\r\n") == 400);
+    CHECK(error_status("POST / HTTP/1.1\r\nContent-Length: 0x10\r\n\r\n") == 400);
+    CHECK(error_status("POST / HTTP/1.1\r\nContent-Length:\r\n\r\n") == 400);
+    CHECK(error_status("POST / HTTP/1.1\r\nContent-Length: 1234567890\r\n\r\n") == 400);
+
+    HttpRequestParser parser;
+    CHECK(parse_all(&parser, "POST / HTTP/1.1\r\nContent-Length: 123456789\r\n\r\n") ==
+          HttpRequestParser::RESULT_COMPLETE);
+    CHECK(parser.getContentLength() == 123456789);
+    CHECK(parse_all(&parser, "GET / HTTP/1.1\r\n\r\n") == HttpRequestParser::RESULT_COMPLETE);
+    CHECK(parser.getContentLength() == -1);
+}
+
+static void test_keep_alive()
+{
+    HttpRequestParser parser;
+    CHECK(parse_all(&parser, "GET / HTTP/1.1\r\n\r\n") == HttpRequestParser::RESULT_COMPLETE);
+    CHECK(parser.isKeepAlive());
+    CHECK(parse_all(&parser, "GET / HTTP/1.1\r\nConnection: Close\r\n\r\n") == HttpRequestParser::RESULT_COMPLETE);
+    CHECK(!parser.isKeepAlive());
+    CHECK(parse_all(&parser, "GET / HTTP/1.0\r\n\r\n") == HttpRequestParser::RESULT_COMPLETE);
+    CHECK(!parser.isKeepAlive());
+    CHECK(parse_all(&parser, "GET / HTTP/1.0\r\nConnection: keep-alive\r\n\r\n") ==
+          HttpRequestParser::RESULT_COMPLETE);
+    CHECK(parser.isKeepAlive());
+}
+
+// A connection accepted from a socket of the test, which plays the client
+typedef struct connection
+{
+    Socket peer;
+    int client;
+} connection_t;
+
+static Socket listener;
+
+static connection_t connect_client()
+{
+    struct sockaddr_in addr;
+    listener.getBind((struct sockaddr *)&addr);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    connection_t c;
+    c.client = socket(AF_INET, SOCK_STREAM, 0);
+    CHECK(c.client >= 0);
+    CHECK(connect(c.client, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+    c.peer = listener.accept();
+    // A parse that waits for data that never comes fails the test instead of hanging it
+    CHECK(c.peer.setTimeout(5) == 0);
+    return c;
+}
+
+// Sends the requests and ends the stream, so every read of the server returns
+static void send_all(connection_t *c, const std::string &data)
+{
+    CHECK(send(c->client, data.data(), data.size(), 0) == (ssize_t)data.size());
+    CHECK(shutdown(c->client, SHUT_WR) == 0);
+}
+
+static void finish(connection_t *c)
+{
+    c->peer.close();
+    close(c->client);
+}
+
+// A GET with a body whose text is a request of its own, the body must not be served as a request
+static void test_body_of_get()
+{
+    const std::string smuggled = "GET /settings/reset HTTP/1.1\r\n\r\n";
+    connection_t c = connect_client();
+    send_all(&c, "GET /data HTTP/1.1\r\nContent-Length: " + std::to_string(smuggled.size()) + "\r\n\r\n" + smuggled +
+                     "GET /heap HTTP/1.1\r\n\r\n");
+    SocketReader reader(c.peer);
+    HttpParser first;
+    CHECK(first.parse(reader));
+    CHECK(first.getURL() == "/data" && first.getBody() == smuggled);
+    CHECK(first.isKeepAlive());
+    HttpParser second;
+    CHECK(second.parse(reader));
+    CHECK(second.getURL() == "/heap" && second.getBody().empty());
+    HttpParser end;
+    CHECK(!end.parse(reader) && end.getErrorStatus() == 0);
+    finish(&c);
+}
+
+static void test_short_body()
+{
+    connection_t c = connect_client();
+    send_all(&c, "DELETE /probe/1 HTTP/1.1\r\nContent-Length: 10\r\n\r\n1234");
+    SocketReader reader(c.peer);
+    HttpParser parser;
+    CHECK(!parser.parse(reader));
+    CHECK(parser.getErrorStatus() == 400 && !parser.isKeepAlive());
+    CHECK(parser.getBody().empty());
+    finish(&c);
+}
+
+static void test_rejected_bodies()
+{
+    connection_t chunked = connect_client();
+    send_all(&chunked, "POST /settings HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n2\r\n{}\r\n0\r\n\r\n");
+    SocketReader chunked_reader(chunked.peer);
+    HttpParser chunked_parser;
+    CHECK(!chunked_parser.parse(chunked_reader) && chunked_parser.getErrorStatus() == 501);
+    finish(&chunked);
+
+    connection_t large = connect_client();
+    send_all(&large, "PUT /settings HTTP/1.1\r\nContent-Length: " + std::to_string(HttpParser::MAX_BODY_SIZE + 1) +
+                         "\r\n\r\n{}");
+    SocketReader large_reader(large.peer);
+    HttpParser large_parser;
+    CHECK(!large_parser.parse(large_reader));
+    CHECK(large_parser.getErrorStatus() == 413 && !large_parser.isKeepAlive());
+    finish(&large);
+}
+
+static void test_bodies_without_length()
+{
+    // Without a length a GET has no body and the next request follows right away
+    connection_t get = connect_client();
+    send_all(&get, "GET /data HTTP/1.1\r\n\r\nGET /heap HTTP/1.1\r\n\r\n");
+    SocketReader get_reader(get.peer);
+    HttpParser first;
+    CHECK(first.parse(get_reader) && first.getBody().empty() && first.isKeepAlive());
+    HttpParser second;
+    CHECK(second.parse(get_reader) && second.getURL() == "/heap");
+    finish(&get);
+
+    // A POST gets what was sent with it and the connection is closed after the answer
+    connection_t post = connect_client();
+    send_all(&post, "POST /settings HTTP/1.1\r\n\r\n{\"unit\":\"C\"}");
+    SocketReader post_reader(post.peer);
+    HttpParser parser;
+    CHECK(parser.parse(post_reader));
+    CHECK(parser.getBody() == "{\"unit\":\"C\"}" && !parser.isKeepAlive());
+    finish(&post);
+}
+
+int main()
+{
+    esp_log_level_set("*", ESP_LOG_NONE);
+    test_request();
+    test_limits();
+    test_malformed();
+    test_framing();
+    test_keep_alive();
+
+    CHECK(listener.listen(0) == 0);
+    test_body_of_get();
+    test_short_body();
+    test_rejected_bodies();
+    test_bodies_without_length();
+    listener.close();
+    printf("http_parser: ok\n");
+    return 0;
+}
@@ -0,0 +1,180 @@
+#include "HttpRouter.h"
+
+#include <string.h>
+#include <string>
+#include "esp_log.h"
+
+#include "check.h"
+
+// The value of the matching route, -1 if none matched. The captures are left in params.
+static int match(const HttpRouter &router, const char *method, const std::string &path, HttpRouteParams *params)
+{
+    size_t value;
+    if (!router.match(method, path.c_str(), path.length(), &value, params))
+    {
+        return -1;
+    }
+    return (int)value;
+}
+
+static std::string param(const HttpRouteParams &params, const char *name, const std::string &path)
+{
+    int index = params.indexOf(name);
+    CHECK(index >= 0);
+    return params.getValue(index, path);
+}
+
+static void test_literals()
+{
+    HttpRouter router;
+    CHECK(router.addRoute("GET", "/", 0));
+    CHECK(router.addRoute("GET", "/data", 1));
+    CHECK(router.addRoute("POST", "/data", 2));
+    CHECK(router.addRoute("GET", "/api/probes", 3));
+    HttpRouteParams params;
+    CHECK(match(router, "GET", "/", &params) == 0);
+    CHECK(match(router, "GET", "", &params) == 0);
+    CHECK(match(router, "GET", "/data", &params) == 1);
+    CHECK(match(router, "POST", "/data", &params) == 2);
+    CHECK(match(router, "PUT", "/data", &params) == -1);
+    CHECK(match(router, "GET", "/api/probes", &params) == 3);
+    CHECK(params.getCount() == 0);
+    // Empty segments, a query and a fragment are not part of the path
+    CHECK(match(router, "GET", "//api//probes/", &params) == 3);
+    CHECK(match(router, "GET", "/data?probe=1/2", &params) == 1);
+    CHECK(match(router, "GET", "/data#top", &params) == 1);
+    // Segments have to match whole
+    CHECK(match(router, "GET", "/dat", &params) == -1);
+    CHECK(match(router, "GET", "/datas", &params) == -1);
+    CHECK(match(router, "GET", "/api", &params) == -1);
+    CHECK(match(router, "GET", "/api/probes/1", &params) == -1);
+    CHECK(router.getRouteCount() == 4);
+}
+
+static void test_params()
+{
+    HttpRouter router;
+    CHECK(router.addRoute("GET", "/api/probes/:id", 0));
+    CHECK(router.addRoute("PUT", "/api/probes/:id/alarm/:kind", 1));
+    HttpRouteParams params;
+    std::string path = "/api/probes/3";
+    CHECK(match(router, "GET", path, &params) == 0);
+    CHECK(params.getCount() == 1 && strcmp(params.getName(0), "id") == 0);
+    CHECK(param(params, "id", path) == "3");
+    CHECK(params.indexOf("kind") == -1);
+
+    path = "/api/probes/brisket%20point/alarm/max?unit=C";
+    CHECK(match(router, "PUT", path, &params) == 1);
+    CHECK(params.getCount() == 2);
+    // Values stay URL encoded
+    CHECK(param(params, "id", path) == "brisket%20point");
+    CHECK(param(params, "kind", path) == "max");
+    // A capture matches exactly one segment
+    CHECK(match(router, "GET", "/api/probes", &params) == -1);
+    CHECK(match(router, "GET", "/api/probes/3/4", &params) == -1);
+    // Out of range is empty, also for a path shorter than the one matched
+    CHECK(params.getValue(5, path) == "" && strcmp(params.getName(5), "") == 0);
+    CHECK(params.getValue(0, "/") == "");
+}
+
+static void test_wildcard()
+{
+    HttpRouter router;
+    CHECK(router.addRoute("GET", "/static/*", 0));
+    CHECK(router.addRoute("GET", "/*", 1));
+    HttpRouteParams params;
+    std::string path = "/static/css/ui.css?v=3";
+    CHECK(match(router, "GET", path, &params) == 0);
+    CHECK(params.getCount() == 1 && strcmp(params.getName(0), "*") == 0);
+    CHECK(param(params, "*", path) == "css/ui.css");
+    // The rest may be empty
+    path = "/static/";
+    CHECK(match(router, "GET", path, &params) == 0);
+    CHECK(param(params, "*", path) == "");
+    path = "/index.html";
+    CHECK(match(router, "GET", path, &params) == 1);
+    CHECK(param(params, "*", path) == "index.html");
+    CHECK(match(router, "GET", "/", &params) == 1);
+    CHECK(match(router, "POST", "/static/x", &params) == -1);
+}
+
+static void test_precedence_and_backtracking()
+{
+    HttpRouter router;
+    CHECK(router.addRoute("GET", "/probes/new", 0));
+    CHECK(router.addRoute("GET", "/probes/:id", 1));
+    CHECK(router.addRoute("GET", "/probes/*", 2));
+    CHECK(router.addRoute("GET", "/a/b/c", 3));
+    CHECK(router.addRoute("GET", "/a/:x/d", 4));
+    CHECK(router.addRoute("GET", "/a/:x/:y/e", 5));
+    CHECK(router.addRoute("GET", "/a/*", 6));
+    HttpRouteParams params;
+    // Literals win over captures and captures over the wildcard
+    CHECK(match(router, "GET", "/probes/new", &params) == 0 && params.getCount() == 0);
+    CHECK(match(router, "GET", "/probes/7", &params) == 1);
+    CHECK(match(router, "GET", "/probes/7/log", &params) == 2);
+
+    // The literal b fails one segment further down, the capture takes over
+    std::string path = "/a/b/d";
+    CHECK(match(router, "GET", path, &params) == 4);
+    CHECK(params.getCount() == 1 && param(params, "x", path) == "b");
+    path = "/a/b/c/e";
+    CHECK(match(router, "GET", path, &params) == 5);
+    CHECK(params.getCount() == 2 && param(params, "x", path) == "b" && param(params, "y", path) == "c");
+    // Every specific branch fails, the captures they made are dropped again
+    path = "/a/b/c/f";
+    CHECK(match(router, "GET", path, &params) == 6);
+    CHECK(params.getCount() == 1 && param(params, "*", path) == "b/c/f");
+    // A route for another method at the end of a branch is no match either
+    CHECK(match(router, "POST", "/a/b/c", &params) == -1);
+}
+
+static void test_max_params()
+{
+    HttpRouter router;
+    CHECK(router.addRoute("GET", "/:a/:b/:c/:d", 0));
+    CHECK(router.addRoute("GET", "/x/:a/:b/:c/*", 1));
+    CHECK(!router.addRoute("GET", "/:a/:b/:c/:d/:e", 2));
+    CHECK(!router.addRoute("GET", "/:a/:b/:c/:d/*", 2));
+    HttpRouteParams params;
+    std::string path = "/1/2/3/4";
+    CHECK(match(router, "GET", path, &params) == 0 && params.getCount() == HttpRouteParams::MAX_PARAMS);
+    CHECK(param(params, "d", path) == "4");
+    path = "/x/1/2/rest/of/it";
+    CHECK(match(router, "GET", path, &params) == 1 && params.getCount() == HttpRouteParams::MAX_PARAMS);
+    CHECK(param(params, "c", path) == "rest" && param(params, "*", path) == "of/it");
+}
+
+static void test_invalid_routes()
+{
+    HttpRouter router;
+    CHECK(router.addRoute("GET", "/probes/:id", 0));
+    CHECK(!router.addRoute("GET", "/probes/*/log", 1));
+    CHECK(!router.addRoute("GET", "/probes/:", 1));
+    CHECK(!router.addRoute("GET", "/:id/probes/:id", 1));
+    // Another name for a capture at the same place would make one of them unreachable
+    CHECK(!router.addRoute("GET", "/probes/:name/log", 1));
+    CHECK(!router.addRoute("GET", "/probes/:id", 1));
+    CHECK(!router.addRoute("GET", "probes/:id/", 1));
+    CHECK(router.getRouteCount() == 1);
+    // Nothing of the rejected routes was added
+    HttpRouteParams params;
+    CHECK(match(router, "GET", "/probes/3/log", &params) == -1);
+    CHECK(match(router, "GET", "/3/probes/4", &params) == -1);
+    CHECK(router.addRoute("POST", "/probes/:id", 1));
+    CHECK(router.addRoute("GET", "/probes/:id/log", 2));
+    CHECK(match(router, "GET", "/probes/3/log", &params) == 2);
+}
+
+int main()
+{
+    esp_log_level_set("*", ESP_LOG_NONE);
+    test_literals();
+    test_params();
+    test_wildcard();
+    test_precedence_and_backtracking();
+    test_max_params();
+    test_invalid_routes();
+    printf("http_router: ok\n");
+    return 0;
+}
@@ -0,0 +1,206 @@
+#include "HttpServer.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <string>
+#include "esp_log.h"
+
+#include "check.h"
+
+#define PORT 18632
+#define CLIENT_TIMEOUT_S 1
+
+static const std::string DATA = "{\"probes\":[21.5,64.0,-1,-1]}";
+
+static void send_data(HttpRequest *request, HttpResponse *response)
+{
+    response->setStatus(HttpResponse::HTTP_STATUS_OK, "OK");
+    response->addHeader(HttpRequest::HTTP_HEADER_CONTENT_LENGTH, std::to_string(DATA.size()));
+    response->sendData(DATA);
+    response->close();
+}
+
+// Answers with the length of the body, which only matches if the whole body was read
+static void echo_length(HttpRequest *request, HttpResponse *response)
+{
+    std::string length = std::to_string(request->getBody().size());
+    response->setStatus(HttpResponse::HTTP_STATUS_OK, "OK");
+    response->addHeader(HttpRequest::HTTP_HEADER_CONTENT_LENGTH, std::to_string(length.size()));
+    response->sendData(length);
+    response->close();
+}
+
+// The server listens a moment after start() returned
+static int connect_client()
+{
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    for (int attempt = 0; attempt < 100; attempt++)
+    {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        CHECK(fd >= 0);
+        if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0)
+        {
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            // An answer that never comes fails the test instead of hanging it
+            struct timeval timeout = {5, 0};
+            setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            return fd;
+        }
+        close(fd);
+        usleep(10 * 1000);
+    }
+    CHECK(false);
+    return -1;
+}
+
+static void send_text(int fd, const std::string &text)
+{
+    CHECK(send(fd, text.data(), text.size(), 0) == (ssize_t)text.size());
+}
+
+// Reads one response framed by its Content-Length and returns its body, "" once the server closed
+static std::string read_response(int fd, std::string *rest)
+{
+    size_t head_end;
+    while ((head_end = rest->find("\r\n\r\n")) == std::string::npos)
+    {
+        char buf[512];
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0)
+        {
+            return "";
+        }
+        rest->append(buf, n);
+    }
+    size_t length_at = rest->find("Content-Length: ");
+    CHECK(length_at != std::string::npos && length_at < head_end);
+    size_t length = atoi(rest->c_str() + length_at + 16);
+    while (rest->size() < head_end + 4 + length)
+    {
+        char buf[512];
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        CHECK(n > 0);
+        rest->append(buf, n);
+    }
+    std::string body = rest->substr(head_end + 4, length);
+    rest->erase(0, head_end + 4 + length);
+    return body;
+}
+
+static const char GET_DATA[] = "GET /data HTTP/1.1\r\nHost: ibbq.gateway\r\n\r\n";
+
+static void test_keep_alive_and_pipelining()
+{
+    int fd = connect_client();
+    std::string rest;
+    for (int i = 0; i < 3; i++)
+    {
+        send_text(fd, GET_DATA);
+        CHECK(read_response(fd, &rest) == DATA);
+    }
+    // Three requests in one segment and one split in the middle of a header
+    send_text(fd, std::string(GET_DATA) + GET_DATA + GET_DATA + "GET /data HTTP/1.1\r\nHo");
+    for (int i = 0; i < 3; i++)
+    {
+        CHECK(read_response(fd, &rest) == DATA);
+    }
+    usleep(50 * 1000);
+    send_text(fd, "st: ibbq.gateway\r\n\r\n");
+    CHECK(read_response(fd, &rest) == DATA);
+    CHECK(rest.empty());
+    close(fd);
+}
+
+static void test_body_in_pieces()
+{
+    int fd = connect_client();
+    std::string body(700, 'b');
+    std::string request = "POST /echo HTTP/1.1\r\nContent-Length: 700\r\n\r\n" + body;
+    std::string rest;
+    // The head alone, then the body in two parts
+    send_text(fd, request.substr(0, request.size() - 700));
+    usleep(20 * 1000);
+    send_text(fd, request.substr(request.size() - 700, 300));
+    usleep(20 * 1000);
+    send_text(fd, request.substr(request.size() - 400));
+    CHECK(read_response(fd, &rest) == "700");
+    // A body larger than the request buffer is read by the worker
+    std::string large(4000, 'l');
+    send_text(fd, "POST /echo HTTP/1.1\r\nContent-Length: 4000\r\n\r\n" + large.substr(0, 100));
+    usleep(20 * 1000);
+    send_text(fd, large.substr(100));
+    CHECK(read_response(fd, &rest) == "4000");
+    close(fd);
+}
+
+// With a single worker a client that stops in the middle of its head used to block every other one
+static void test_slow_header()
+{
+    int slow = connect_client();
+    send_text(slow, "GET /data HTTP/1.1\r\nHost: ibb");
+    usleep(50 * 1000);
+    int64_t start = now_ns();
+    int fast = connect_client();
+    std::string rest;
+    for (int i = 0; i < 20; i++)
+    {
+        send_text(fast, GET_DATA);
+        CHECK(read_response(fast, &rest) == DATA);
+    }
+    CHECK(now_ns() - start < 500 * 1000000LL);
+    close(fast);
+
+    // The slow client is closed once it didn't complete a request within the client timeout
+    char byte;
+    CHECK(recv(slow, &byte, 1, 0) == 0);
+    int64_t closed_after = now_ns() - start;
+    CHECK(closed_after > (CLIENT_TIMEOUT_S * 1000 - 100) * 1000000LL);
+    CHECK(closed_after < (CLIENT_TIMEOUT_S * 1000 + 1500) * 1000000LL);
+    close(slow);
+}
+
+static void test_client_closes()
+{
+    int fd = connect_client();
+    send_text(fd, "GET /data HTTP/1.1\r\n");
+    close(fd);
+    fd = connect_client();
+    std::string rest;
+    send_text(fd, GET_DATA);
+    CHECK(read_response(fd, &rest) == DATA);
+    close(fd);
+}
+
+int main()
+{
+    esp_log_level_set("*", ESP_LOG_NONE);
+    HttpServer server;
+    server.addPathHandler("GET", "/data", send_data);
+    server.addPathHandler("POST", "/echo", echo_length);
+    server.setWorkerCount(1);
+    server.setClientTimeout(CLIENT_TIMEOUT_S);
+    server.start(PORT);
+    test_keep_alive_and_pipelining();
+    test_body_in_pieces();
+    test_slow_header();
+    test_client_closes();
+    server.stop();
+
+    // The tasks of the first start are deleted, LeakSanitizer reports any that are not
+    server.start(PORT);
+    test_keep_alive_and_pipelining();
+    server.stop();
+    // The tasks end right after stop() returned, exit() must not run while their threads unwind
+    usleep(100 * 1000);
+    printf("http_server: ok\n");
+    return 0;
+}
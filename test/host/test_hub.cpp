@@ -0,0 +1,152 @@
+#include "hub.h"
+#include "sample_multicast.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "esp_log.h"
+#include "esp_system.h"
+#include "host_mdns.h"
+
+#include "check.h"
+
+#define GATEWAYS 3
+#define FRAMES 600
+#define FRAME_INTERVAL_US 5000
+// Time the hub gets to join the group before the gateways start sending
+#define START_DELAY_US (300 * 1000)
+
+static ibbq_state_t s_state = {};
+
+static void gateway_mac(int gateway, uint8_t *mac)
+{
+    const uint8_t base[6] = {0x02, 0xba, 0x5e, 0x00, 0x00, 0x00};
+    memcpy(mac, base, sizeof(base));
+    mac[4] = gateway + 1;
+}
+
+static uint16_t value(int gateway, uint8_t device, int frame, size_t probe)
+{
+    return probe == 2 ? 0xFFF6 : 1000 * gateway + 100 * device + 10 * probe + frame % 10;
+}
+
+// A gateway of its own, with its own MAC and sequence numbers, the last one also sends as a
+// simulated second thermometer
+static void run_gateway(int gateway)
+{
+    uint8_t mac[6];
+    gateway_mac(gateway, mac);
+    CHECK(esp_base_mac_addr_set(mac) == ESP_OK);
+    usleep(START_DELAY_US);
+    sample_multicast_start();
+    for (int frame = 0; frame < FRAMES; frame++)
+    {
+        uint16_t raw[4];
+        for (size_t probe = 0; probe < 4; probe++)
+        {
+            raw[probe] = value(gateway, 0, frame, probe);
+        }
+        sample_multicast_publish(raw, 4, 50 + gateway);
+        if (gateway == GATEWAYS - 1)
+        {
+            for (size_t probe = 0; probe < 4; probe++)
+            {
+                raw[probe] = value(gateway, 1, frame, probe);
+            }
+            sample_multicast_publish_device(1, raw, 3, 70);
+        }
+        usleep(FRAME_INTERVAL_US);
+    }
+}
+
+static bool find_source(const uint8_t *device_id, hub_source_t *source)
+{
+    for (size_t i = 0; hub_get_source(i, source); i++)
+    {
+        if (memcmp(source->device_id, device_id, 6) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void announce(int gateway, const char *hostname)
+{
+    uint8_t mac[6];
+    gateway_mac(gateway, mac);
+    char device[13];
+    snprintf(device, sizeof(device), "%02x%02x%02x%02x%02x%02x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    mdns_txt_item_t txt[] = {{"path", "/"}, {"device", device}};
+    host_mdns_add_peer(hostname, "_http", "_tcp", 80, txt, 2);
+}
+
+int main()
+{
+    esp_log_level_set("*", ESP_LOG_NONE);
+    // Before any task of the hub runs, the gateways must not inherit its threads
+    pid_t gateways[GATEWAYS];
+    for (int gateway = 0; gateway < GATEWAYS; gateway++)
+    {
+        gateways[gateway] = fork();
+        CHECK(gateways[gateway] >= 0);
+        if (gateways[gateway] == 0)
+        {
+            run_gateway(gateway);
+            _exit(0);
+        }
+    }
+
+    CHECK(mdns_init() == ESP_OK);
+    announce(0, "smoker");
+    announce(1, "kettle");
+    // The last gateway doesn't answer mDNS, it is listed without a name
+    hub_start(&s_state);
+    for (int gateway = 0; gateway < GATEWAYS; gateway++)
+    {
+        int status;
+        CHECK(waitpid(gateways[gateway], &status, 0) == gateways[gateway] && WIFEXITED(status) &&
+              WEXITSTATUS(status) == 0);
+    }
+    // The first query started with the hub, the gateways showing up started a second one
+    for (int i = 0; i < 100 && host_mdns_query_count() < 2; i++)
+    {
+        usleep(50 * 1000);
+    }
+    usleep(2500 * 1000);
+
+    hub_source_t *source = new hub_source_t;
+    CHECK(hub_get_source(0, source) && source->local);
+    size_t count = 0;
+    while (hub_get_source(count, source))
+    {
+        count++;
+    }
+    CHECK(count == 1 + GATEWAYS + 1);
+
+    for (int gateway = 0; gateway < GATEWAYS; gateway++)
+    {
+        for (uint8_t device = 0; device < (gateway == GATEWAYS - 1 ? 2 : 1); device++)
+        {
+            uint8_t device_id[6];
+            gateway_mac(gateway, device_id);
+            device_id[5] += device;
+            CHECK(find_source(device_id, source));
+            // Every datagram was taken, even while a query waited two seconds for mDNS answers
+            CHECK(source->received == FRAMES && source->lost == 0 && source->reordered == 0);
+            CHECK(source->max_lag_ms < 500);
+            size_t probes = device == 0 ? 4 : 3;
+            CHECK(source->probe_count == probes && source->battery_percent == (device == 0 ? 50 + gateway : 70));
+            for (size_t probe = 0; probe < probes; probe++)
+            {
+                int16_t expected = probe == 2 ? SAMPLE_NO_VALUE : value(gateway, device, FRAMES - 1, probe);
+                CHECK(source->deci_degrees[probe] == expected);
+            }
+            const char *host = gateway == 0 ? "smoker" : gateway == 1 ? "kettle" : "";
+            CHECK(strcmp(source->host, device == 0 ? host : "") == 0);
+        }
+    }
+    delete source;
+    printf("hub: ok\n");
+    return 0;
+}
@@ -0,0 +1,87 @@
+#include "ibbq_events.h"
+#include "Channel.h"
+
+#include <atomic>
+#include <thread>
+
+#include "check.h"
+
+#define CHAIN_STEPS 200000
+
+typedef MpscChannel<ibbq_event_t, IBBQ_EVENT_QUEUE_SIZE> event_queue_t;
+
+static bool post(event_queue_t &queue, uint8_t type)
+{
+    ibbq_event_t event = {};
+    event.type = type;
+    return ibbq_event_admit(type, queue.size()) && queue.trySend(event);
+}
+
+// Requests stop short of the reserved slots, which still take a step of the state machine and a
+// scan after a disconnect
+static void test_reserved()
+{
+    event_queue_t queue;
+    size_t requests = 0;
+    while (post(queue, IBBQ_REQUEST_STATE))
+    {
+        requests++;
+    }
+    CHECK(requests == IBBQ_EVENT_QUEUE_SIZE - IBBQ_EVENT_RESERVED);
+    CHECK(post(queue, IBBQ_AUTHENTICATED));
+    CHECK(post(queue, IBBQ_START_SCAN));
+    CHECK(!post(queue, IBBQ_START_SCAN));
+}
+
+// The battery timer floods the queue while the BLE task is slow, as during a long GATT write.
+// Every handler posts the next step, none of those may get lost or the state machine stops.
+static void test_flood()
+{
+    static event_queue_t queue;
+    std::atomic<bool> done(false);
+    std::atomic<uint32_t> requests_dropped(0);
+    std::thread timer([&]() {
+        while (!done)
+        {
+            if (!post(queue, IBBQ_REQUEST_STATE))
+            {
+                requests_dropped++;
+            }
+        }
+    });
+
+    // The scan after a disconnect comes when the requests already filled their part of the queue
+    while (requests_dropped == 0)
+    {
+        std::this_thread::yield();
+    }
+    CHECK(post(queue, IBBQ_START_SCAN));
+    uint32_t steps = 0;
+    uint32_t requests = 0;
+    ibbq_event_t event;
+    while (steps < CHAIN_STEPS)
+    {
+        if (!queue.tryReceive(event))
+        {
+            continue;
+        }
+        if (event.type == IBBQ_REQUEST_STATE)
+        {
+            requests++;
+            continue;
+        }
+        steps++;
+        CHECK(post(queue, (event.type + 1) % IBBQ_REQUEST_STATE));
+    }
+    done = true;
+    timer.join();
+    CHECK(requests > 0);
+}
+
+int main()
+{
+    test_reserved();
+    test_flood();
+    printf("ibbq_events: ok\n");
+    return 0;
+}
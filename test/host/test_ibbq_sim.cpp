@@ -0,0 +1,159 @@
+#include "ibbq_sim.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "check.h"
+
+#define HOUR_S 3600
+
+// No random events, so the thermal model can be checked on its own
+static void quiet_config(sim_device_config_t *config)
+{
+    sim_default_config(config, 1);
+    config->lid_opens_per_hour = 0;
+    config->dropouts_per_hour = 0;
+    config->unplugs_per_hour = 0;
+}
+
+static void run(sim_device_t *device, uint32_t seconds)
+{
+    uint16_t raw[SIM_MAX_PROBES];
+    for (uint32_t i = 0; i < seconds; i++)
+    {
+        sim_device_step(device, raw);
+    }
+}
+
+static void test_deterministic()
+{
+    sim_device_config_t config;
+    sim_default_config(&config, 42);
+    sim_device_t a, b;
+    sim_device_init(&a, &config);
+    sim_device_init(&b, &config);
+    for (int i = 0; i < 4 * HOUR_S; i++)
+    {
+        uint16_t raw_a[SIM_MAX_PROBES] = {};
+        uint16_t raw_b[SIM_MAX_PROBES] = {};
+        CHECK(sim_device_step(&a, raw_a) == sim_device_step(&b, raw_b));
+        CHECK(memcmp(raw_a, raw_b, sizeof(raw_a)) == 0);
+    }
+}
+
+static void test_pit()
+{
+    sim_device_config_t config;
+    quiet_config(&config);
+    sim_device_t device;
+    sim_device_init(&device, &config);
+    run(&device, 30 * 60);
+    CHECK(fabsf(device.pit_temp - config.pit_set_point) < 1.0f);
+
+    // A one minute lid opening costs a noticeable but plausible amount of heat
+    device.lid_open_left_s = 60;
+    run(&device, 60);
+    float drop = config.pit_set_point - device.pit_temp;
+    CHECK(drop > 15.0f && drop < 35.0f);
+    uint32_t recovered_s = 0;
+    while (config.pit_set_point - device.pit_temp > 5.0f)
+    {
+        run(&device, 1);
+        recovered_s++;
+    }
+    CHECK(recovered_s > 5 * 60 && recovered_s < 10 * 60);
+
+    // The longest opening doesn't cool the pit down to the room
+    sim_device_init(&device, &config);
+    run(&device, 30 * 60);
+    device.lid_open_left_s = 90;
+    run(&device, 90);
+    CHECK(device.pit_temp > 60.0f);
+}
+
+static void test_stall()
+{
+    sim_device_config_t config;
+    quiet_config(&config);
+    sim_device_t device;
+    sim_device_init(&device, &config);
+    const sim_probe_config_t *brisket = &config.probes[0];
+
+    // The brisket levels off a few degrees above the stall temperature, where heating and
+    // evaporation are in balance, and stays there for about the configured stall
+    uint32_t stalled_s = 0;
+    for (int i = 0; i < 16 * HOUR_S && device.temps[0] < brisket->stall_temp + 10; i++)
+    {
+        run(&device, 1);
+        if (device.temps[0] > brisket->stall_temp && device.temps[0] < brisket->stall_temp + 5)
+        {
+            stalled_s++;
+        }
+    }
+    CHECK(stalled_s > brisket->stall_minutes * 60 * 0.8f);
+    CHECK(device.moisture[0] == 0);
+    run(&device, 8 * HOUR_S);
+    CHECK(device.temps[0] < device.pit_temp);
+    CHECK(device.temps[0] > config.pit_set_point - 10);
+}
+
+static void test_raw_values()
+{
+    sim_device_config_t config;
+    quiet_config(&config);
+    sim_device_t device;
+    sim_device_init(&device, &config);
+    run(&device, HOUR_S);
+    uint16_t raw[SIM_MAX_PROBES];
+    CHECK(sim_device_step(&device, raw));
+    CHECK(raw[3] == SIM_RAW_UNPLUGGED);
+    CHECK(fabsf(raw[2] / 10.0f - device.pit_temp) <= 0.3f);
+    CHECK(fabsf(raw[0] / 10.0f - device.temps[0]) <= 0.3f);
+
+    device.unplugged_left_s[0] = 2;
+    CHECK(sim_device_step(&device, raw));
+    CHECK(raw[0] == SIM_RAW_UNPLUGGED);
+    device.dropout_left_s = 2;
+    CHECK(!sim_device_step(&device, raw));
+    CHECK(!sim_device_step(&device, raw));
+    CHECK(sim_device_step(&device, raw));
+    CHECK(raw[0] != SIM_RAW_UNPLUGGED);
+}
+
+// The rates of the random events match the configuration over a long run
+static void test_events()
+{
+    sim_device_config_t config;
+    sim_default_config(&config, 7);
+    sim_device_t device;
+    sim_device_init(&device, &config);
+    uint32_t lid_opens = 0, dropouts = 0, offline_s = 0;
+    const int hours = 200;
+    for (int i = 0; i < hours * HOUR_S; i++)
+    {
+        bool lid_was_closed = device.lid_open_left_s == 0;
+        bool was_online = device.dropout_left_s == 0;
+        uint16_t raw[SIM_MAX_PROBES];
+        if (!sim_device_step(&device, raw))
+        {
+            offline_s++;
+            dropouts += was_online;
+        }
+        lid_opens += lid_was_closed && device.lid_open_left_s > 0;
+    }
+    CHECK(lid_opens > hours * config.lid_opens_per_hour * 0.7f && lid_opens < hours * config.lid_opens_per_hour * 1.3f);
+    CHECK(dropouts > hours * config.dropouts_per_hour * 0.7f && dropouts < hours * config.dropouts_per_hour * 1.3f);
+    CHECK(offline_s < hours * HOUR_S / 50);
+    CHECK(device.battery_percent == 0);
+}
+
+int main()
+{
+    test_deterministic();
+    test_pit();
+    test_stall();
+    test_raw_values();
+    test_events();
+    printf("ibbq_sim: ok\n");
+    return 0;
+}
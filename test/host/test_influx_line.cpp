@@ -0,0 +1,77 @@
+#include "influx_line.h"
+
+#include <string.h>
+#include <string>
+
+#include "check.h"
+
+static std::string escape(const char *value, size_t out_len = INFLUX_TAG_MAX)
+{
+    char out[INFLUX_TAG_MAX];
+    CHECK(out_len <= sizeof(out));
+    influx_escape_tag(value, out, out_len);
+    return out;
+}
+
+static void test_escape_tag()
+{
+    CHECK(escape("Brisket") == "Brisket");
+    CHECK(escape("") == "");
+    CHECK(escape("Kanal 1") == "Kanal\\ 1");
+    CHECK(escape("a,b=c") == "a\\,b\\=c");
+    CHECK(escape("C:\\") == "C:\\\\");
+    CHECK(escape("a\nb\tc\x7F") == "abc");
+    CHECK(escape("\xC3\xA4") == "\xC3\xA4");
+    CHECK(escape("\r\n") == "");
+
+    // Cut off to fit, never in the middle of an escape
+    CHECK(escape("abcdef", 4) == "ab");
+    CHECK(escape("ab cd", 4) == "ab");
+    CHECK(escape("a cd", 4) == "a\\ ");
+    std::string longest(200, 'x');
+    CHECK(escape(longest.c_str()) == longest.substr(0, INFLUX_TAG_MAX - 2));
+}
+
+static std::string temperature(size_t probe, const char *name, float temp, long timestamp)
+{
+    char line[INFLUX_LINE_MAX];
+    size_t len = influx_temperature_line(line, sizeof(line), probe, name, temp, timestamp);
+    CHECK(len == 0 || len == strlen(line));
+    return std::string(line, len);
+}
+
+static void test_temperature_line()
+{
+    CHECK(temperature(1, "Brisket", 71.25f, 1700000000) ==
+          "temperature,probe=1,name=Brisket value=71.2 1700000000\n");
+    CHECK(temperature(2, "Kanal 2", -5.0f, 1700000005) ==
+          "temperature,probe=2,name=Kanal\\ 2 value=-5.0 1700000005\n");
+    // An empty tag value makes InfluxDB reject the whole batch
+    CHECK(temperature(3, "", 20.0f, 1700000010) == "temperature,probe=3 value=20.0 1700000010\n");
+    CHECK(temperature(4, "\n", 20.0f, 1700000010) == "temperature,probe=4 value=20.0 1700000010\n");
+
+    std::string name(200, 'n');
+    std::string line = temperature(8, name.c_str(), 999.9f, 1700000000);
+    CHECK(line == "temperature,probe=8,name=" + name.substr(0, INFLUX_TAG_MAX - 2) + " value=999.9 1700000000\n");
+
+    char small[16];
+    CHECK(influx_temperature_line(small, sizeof(small), 1, "Brisket", 71.0f, 1700000000) == 0);
+}
+
+static void test_device_line()
+{
+    char line[INFLUX_LINE_MAX];
+    size_t len = influx_device_line(line, sizeof(line), 87.6f, -61, 1700000000);
+    CHECK(std::string(line, len) == "device battery=88,rssi=-61i 1700000000\n");
+    char small[8];
+    CHECK(influx_device_line(small, sizeof(small), 87.6f, -61, 1700000000) == 0);
+}
+
+int main()
+{
+    test_escape_tag();
+    test_temperature_line();
+    test_device_line();
+    printf("influx_line: ok\n");
+    return 0;
+}
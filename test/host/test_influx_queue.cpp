@@ -0,0 +1,264 @@
+#include "influx_queue.h"
+#include "influx_line.h"
+
+#include <string.h>
+#include <string>
+#include <vector>
+#include "esp_http_client.h"
+#include "esp_log.h"
+
+#include "check.h"
+#include "influx_stand_in.h"
+
+#define PORT 18636
+#define SECOND_US 1000000LL
+
+static char s_buffers[INFLUX_BATCH_COUNT][INFLUX_BATCH_SIZE];
+
+static void init(influx_queue_t *queue)
+{
+    char *buffers[INFLUX_BATCH_COUNT];
+    for (size_t i = 0; i < INFLUX_BATCH_COUNT; i++)
+    {
+        buffers[i] = s_buffers[i];
+    }
+    influx_queue_init(queue, buffers);
+}
+
+// A point whose timestamp tells the points apart, all lines have the same length
+static std::string line(long i)
+{
+    char line[INFLUX_LINE_MAX];
+    size_t len = influx_temperature_line(line, sizeof(line), 1, "Brisket", 95.5f, 1700000000 + i);
+    CHECK(len > 0);
+    return std::string(line, len);
+}
+
+static uint16_t append(influx_queue_t *queue, long i, int64_t now_us)
+{
+    std::string point = line(i);
+    return influx_queue_append(queue, point.data(), point.size(), now_us);
+}
+
+#define LINE_LEN 55
+#define POINTS_PER_BATCH (INFLUX_BATCH_SIZE / LINE_LEN)
+
+static void test_batch_by_size()
+{
+    CHECK(line(0).size() == LINE_LEN);
+    influx_queue_t queue;
+    init(&queue);
+    CHECK(influx_queue_pending(&queue) == 0);
+    for (size_t i = 0; i < POINTS_PER_BATCH; i++)
+    {
+        CHECK(append(&queue, i, 0) == 0);
+    }
+    // Full, but nothing to send until the next line doesn't fit
+    CHECK(influx_queue_next(&queue, 0) == NULL);
+    CHECK(influx_queue_pending(&queue) == 1);
+    CHECK(append(&queue, POINTS_PER_BATCH, 0) == 0);
+    CHECK(influx_queue_pending(&queue) == 2);
+    const influx_batch_t *batch = influx_queue_next(&queue, 0);
+    CHECK(batch != NULL && batch->points == POINTS_PER_BATCH && batch->len == POINTS_PER_BATCH * LINE_LEN);
+    CHECK(std::string(batch->data, LINE_LEN) == line(0));
+    influx_queue_sent(&queue);
+    CHECK(influx_queue_next(&queue, 0) == NULL && influx_queue_pending(&queue) == 1);
+}
+
+static void test_flush_by_time()
+{
+    influx_queue_t queue;
+    init(&queue);
+    int64_t start_us = 5 * SECOND_US;
+    CHECK(influx_queue_wake_us(&queue, 100 * SECOND_US) == 100 * SECOND_US);
+    append(&queue, 0, start_us);
+    append(&queue, 1, start_us + SECOND_US);
+    // The first point decides when the batch goes out
+    int64_t due_us = start_us + INFLUX_FLUSH_INTERVAL_MS * 1000LL;
+    CHECK(influx_queue_wake_us(&queue, 100 * SECOND_US) == due_us);
+    CHECK(influx_queue_wake_us(&queue, SECOND_US) == SECOND_US);
+    influx_queue_seal_if_due(&queue, due_us - 1);
+    CHECK(influx_queue_next(&queue, due_us - 1) == NULL);
+    influx_queue_seal_if_due(&queue, due_us);
+    const influx_batch_t *batch = influx_queue_next(&queue, due_us);
+    CHECK(batch != NULL && batch->points == 2);
+    // An empty batch is never sealed
+    influx_queue_sent(&queue);
+    influx_queue_seal_if_due(&queue, 1000 * SECOND_US);
+    CHECK(influx_queue_next(&queue, 1000 * SECOND_US) == NULL && influx_queue_pending(&queue) == 0);
+}
+
+// With the server gone the batches fill up, the oldest is given up for the newest points
+static void test_drop_oldest()
+{
+    influx_queue_t queue;
+    init(&queue);
+    long i = 0;
+    for (size_t batch = 0; batch < INFLUX_BATCH_COUNT; batch++)
+    {
+        for (size_t point = 0; point < POINTS_PER_BATCH; point++)
+        {
+            CHECK(append(&queue, i++, 0) == 0);
+        }
+    }
+    CHECK(influx_queue_pending(&queue) == INFLUX_BATCH_COUNT);
+    CHECK(append(&queue, i++, 0) == POINTS_PER_BATCH);
+    CHECK(influx_queue_pending(&queue) == INFLUX_BATCH_COUNT);
+    const influx_batch_t *batch = influx_queue_next(&queue, 0);
+    CHECK(std::string(batch->data, LINE_LEN) == line(POINTS_PER_BATCH));
+
+    // Only the batch being filled is sealed when it gets old, it never pushes out another one
+    influx_queue_t aged;
+    init(&aged);
+    append(&aged, 0, 0);
+    for (size_t n = 0; n < 10; n++)
+    {
+        influx_queue_seal_if_due(&aged, (n + 1) * INFLUX_FLUSH_INTERVAL_MS * 1000LL);
+        append(&aged, n + 1, (n + 1) * INFLUX_FLUSH_INTERVAL_MS * 1000LL);
+    }
+    CHECK(influx_queue_pending(&aged) == 2 && influx_queue_next(&aged, 0)->points == 1);
+}
+
+static void test_backoff()
+{
+    influx_queue_t queue;
+    init(&queue);
+    append(&queue, 0, 0);
+    influx_queue_seal_if_due(&queue, INFLUX_FLUSH_INTERVAL_MS * 1000LL);
+    int64_t now_us = INFLUX_FLUSH_INTERVAL_MS * 1000LL;
+
+    uint32_t expected_ms = INFLUX_BACKOFF_MIN_MS;
+    for (int failure = 0; failure < 12; failure++)
+    {
+        CHECK(influx_queue_next(&queue, now_us) != NULL);
+        CHECK(influx_queue_failed(&queue, failure % 2 == 0 ? 503 : 0, 0, now_us) == 0);
+        CHECK(queue.backoff_ms == expected_ms);
+        CHECK(influx_queue_wake_us(&queue, now_us + 3600 * SECOND_US) == now_us + expected_ms * 1000LL);
+        CHECK(influx_queue_next(&queue, now_us + expected_ms * 1000LL - 1) == NULL);
+        now_us += expected_ms * 1000LL;
+        expected_ms = expected_ms * 2 < INFLUX_BACKOFF_MAX_MS ? expected_ms * 2 : INFLUX_BACKOFF_MAX_MS;
+    }
+    CHECK(queue.backoff_ms == INFLUX_BACKOFF_MAX_MS);
+    // The jitter adds at most a quarter
+    influx_queue_failed(&queue, 429, INFLUX_BACKOFF_MAX_MS / 4, now_us);
+    CHECK(queue.retry_at_us == now_us + (INFLUX_BACKOFF_MAX_MS + INFLUX_BACKOFF_MAX_MS / 4) * 1000LL);
+    influx_queue_failed(&queue, 408, INFLUX_BACKOFF_MAX_MS / 4 + 1, now_us);
+    CHECK(queue.retry_at_us == now_us + INFLUX_BACKOFF_MAX_MS * 1000LL);
+
+    // A success ends the backoff, the next failure starts over
+    influx_queue_sent(&queue);
+    CHECK(queue.backoff_ms == 0 && queue.retry_at_us == 0);
+    append(&queue, 1, now_us);
+    append(&queue, 2, now_us);
+    influx_queue_seal_if_due(&queue, now_us + INFLUX_FLUSH_INTERVAL_MS * 1000LL);
+    now_us += INFLUX_FLUSH_INTERVAL_MS * 1000LL;
+    influx_queue_failed(&queue, 500, 0, now_us);
+    CHECK(queue.backoff_ms == INFLUX_BACKOFF_MIN_MS);
+
+    // A batch the server refuses is dropped without waiting
+    CHECK(influx_queue_failed(&queue, 400, 0, now_us) == 2);
+    CHECK(queue.backoff_ms == INFLUX_BACKOFF_MIN_MS && influx_queue_pending(&queue) == 0);
+    influx_queue_reset_backoff(&queue);
+    CHECK(queue.backoff_ms == 0);
+}
+
+// Sends what is due the way the uploader task does, returns the status
+static int upload(influx_queue_t *queue, esp_http_client_handle_t client, int64_t now_us, uint16_t *dropped)
+{
+    const influx_batch_t *batch = influx_queue_next(queue, now_us);
+    CHECK(batch != NULL);
+    esp_http_client_set_post_field(client, batch->data, batch->len);
+    esp_err_t err = esp_http_client_perform(client);
+    int status = err == ESP_OK ? esp_http_client_get_status_code(client) : 0;
+    if (status >= 200 && status < 300)
+    {
+        influx_queue_sent(queue);
+    }
+    else
+    {
+        *dropped += influx_queue_failed(queue, status, 0, now_us);
+    }
+    return status;
+}
+
+// Every point arrives once and in order over one connection, though the server fails in between
+static void test_stand_in()
+{
+    InfluxStandIn server(PORT);
+    esp_http_client_config_t config = {};
+    config.url = "http://127.0.0.1:18636/api/v2/write?org=home&bucket=bbq&precision=s";
+    config.method = HTTP_METHOD_POST;
+    config.timeout_ms = 5000;
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    CHECK(client != NULL);
+    esp_http_client_set_header(client, "Content-Type", "text/plain; charset=utf-8");
+    esp_http_client_set_header(client, "Authorization", "Token secret");
+
+    influx_queue_t queue;
+    init(&queue);
+    const size_t POINTS = 1000;
+    int64_t now_us = 0;
+    uint16_t dropped = 0;
+    uint32_t failures = 0;
+    std::vector<std::string> rejected;
+    for (size_t i = 0; i < POINTS; i++)
+    {
+        now_us += SECOND_US;
+        dropped += append(&queue, i, now_us);
+        if (i == 100)
+        {
+            server.failNext(3, 503);
+        }
+        if (i == 500)
+        {
+            server.failNext(1, 400);
+        }
+        influx_queue_seal_if_due(&queue, now_us);
+        if (influx_queue_next(&queue, now_us) != NULL)
+        {
+            const influx_batch_t *batch = influx_queue_next(&queue, now_us);
+            std::string body(batch->data, batch->len);
+            int status = upload(&queue, client, now_us, &dropped);
+            if (status == 400)
+            {
+                rejected.push_back(body);
+            }
+            failures += status == 204 ? 0 : 1;
+        }
+    }
+    influx_queue_seal_if_due(&queue, now_us + INFLUX_FLUSH_INTERVAL_MS * 1000LL);
+    while (influx_queue_next(&queue, INT64_MAX) != NULL)
+    {
+        upload(&queue, client, INT64_MAX, &dropped);
+    }
+
+    CHECK(failures == 4 && rejected.size() == 1);
+    std::vector<std::string> lines = server.lines();
+    CHECK(dropped > 0 && lines.size() == POINTS - dropped);
+    size_t expected = 0;
+    for (const std::string &received : lines)
+    {
+        while (rejected[0].find(line(expected)) != std::string::npos)
+        {
+            expected++;
+        }
+        CHECK(received + "\n" == line(expected));
+        expected++;
+    }
+    CHECK(expected == POINTS);
+    CHECK(server.connections == 1 && host_http_client_connections(client) == 1);
+    CHECK(server.target() == "POST /api/v2/write?org=home&bucket=bbq&precision=s HTTP/1.1");
+    esp_http_client_cleanup(client);
+}
+
+int main()
+{
+    esp_log_level_set("*", ESP_LOG_NONE);
+    test_batch_by_size();
+    test_flush_by_time();
+    test_drop_oldest();
+    test_backoff();
+    test_stand_in();
+    printf("influx_queue: ok\n");
+    return 0;
+}
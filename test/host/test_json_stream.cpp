@@ -0,0 +1,277 @@
+#include "json_stream.h"
+
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "check.h"
+
+#define FUZZ_DOCUMENTS 20000
+
+typedef struct result
+{
+    bool ok;
+    std::string trace;
+} result_t;
+
+static void record(json_stream_t *stream, const json_stream_value_t *value, void *ctx)
+{
+    std::string *trace = (std::string *)ctx;
+    char line[JSON_STREAM_MAX_STRING + 64];
+    const char *key = value->key != NULL ? value->key : "";
+    switch (value->type)
+    {
+    case JSON_STREAM_STRING:
+        snprintf(line, sizeof(line), "%d %s %d s:%s%s\n", value->depth, key, value->index, value->string,
+                 value->truncated ? "..." : "");
+        break;
+    case JSON_STREAM_NUMBER:
+        snprintf(line, sizeof(line), "%d %s %d n:%.17g\n", value->depth, key, value->index, value->number);
+        break;
+    case JSON_STREAM_BOOL:
+        snprintf(line, sizeof(line), "%d %s %d b:%d\n", value->depth, key, value->index, value->boolean);
+        break;
+    default:
+        snprintf(line, sizeof(line), "%d %s %d t:%d\n", value->depth, key, value->index, value->type);
+        break;
+    }
+    trace->append(line);
+}
+
+// Feeds the document in chunks of the given sizes, repeating the last size until the end
+static result_t parse(const std::string &doc, const std::vector<size_t> &chunks)
+{
+    result_t result;
+    json_stream_t stream;
+    json_stream_init(&stream, record, &result.trace);
+    size_t pos = 0;
+    size_t i = 0;
+    bool ok = true;
+    while (pos < doc.size())
+    {
+        size_t len = chunks.empty() ? doc.size() : chunks[i < chunks.size() ? i++ : chunks.size() - 1];
+        len = len < doc.size() - pos ? len : doc.size() - pos;
+        ok = json_stream_feed(&stream, doc.data() + pos, len) && ok;
+        pos += len;
+    }
+    result.ok = json_stream_finish(&stream) && ok;
+    return result;
+}
+
+static result_t parse(const std::string &doc)
+{
+    return parse(doc, std::vector<size_t>());
+}
+
+// Every split into two chunks and byte by byte have to give the same result as a single chunk
+static void check_splits(const std::string &doc)
+{
+    result_t whole = parse(doc);
+    for (size_t split = 1; split < doc.size(); split++)
+    {
+        result_t parts = parse(doc, {split, doc.size()});
+        CHECK(parts.ok == whole.ok);
+        CHECK(parts.trace == whole.trace);
+    }
+    result_t bytes = parse(doc, {1});
+    CHECK(bytes.ok == whole.ok);
+    CHECK(bytes.trace == whole.trace);
+}
+
+static void test_values()
+{
+    result_t r = parse("{\"a\":1,\"b\":[true,null,\"x\"],\"c\":{\"d\":-1.5e2}}");
+    CHECK(r.ok);
+    CHECK(r.trace == "0  -1 t:4\n"
+                     "1 a -1 n:1\n"
+                     "1 b -1 t:6\n"
+                     "2  0 b:1\n"
+                     "2  1 t:3\n"
+                     "2  2 s:x\n"
+                     "1 b -1 t:7\n"
+                     "1 c -1 t:4\n"
+                     "2 d -1 n:-150\n"
+                     "1 c -1 t:5\n"
+                     "0  -1 t:5\n");
+
+    CHECK(parse(" 42 ").ok);
+    CHECK(parse("42").trace == "0  -1 n:42\n");
+    CHECK(parse("\"\\\"\\\\\\/\\b\\f\\n\\r\\t\"").trace == "0  -1 s:\"\\/\b\f\n\r\t\n");
+    CHECK(parse("[]").ok);
+    CHECK(parse("{}").ok);
+}
+
+static void test_malformed()
+{
+    static const char *docs[] = {
+        "", "{", "[1,]", "{\"a\"}", "{\"a\":}", "{\"a\":1,}", "[1 2]", "01", "1.", "-", "1e", "+1", ".5",
+        "tru", "nul", "[}", "{]", "\"a", "\"\\x\"", "\"\\u12\"", "\"\\u12g4\"", "1 2", "{} {}", "\"a\nb\"",
+        "{1:2}", "[\"a\":1]",
+    };
+    for (size_t i = 0; i < sizeof(docs) / sizeof(docs[0]); i++)
+    {
+        CHECK(!parse(docs[i]).ok);
+        check_splits(docs[i]);
+    }
+}
+
+static void test_unicode()
+{
+    CHECK(parse("\"\\u00e4\\u20AC\"").trace == "0  -1 s:\xC3\xA4\xE2\x82\xAC\n");
+    CHECK(parse("\"\\ud83d\\ude00\"").trace == "0  -1 s:\xF0\x9F\x98\x80\n");
+    CHECK(parse("\"\xC3\xA4\"").trace == "0  -1 s:\xC3\xA4\n");
+    // Lone surrogates have no UTF-8 encoding
+    CHECK(!parse("\"\\ud83d\"").ok);
+    CHECK(!parse("\"\\ude00\"").ok);
+    CHECK(!parse("\"\\ud83dx\"").ok);
+    CHECK(!parse("\"\\ud83d\\n\"").ok);
+    CHECK(!parse("\"\\ud83d\\ud83d\"").ok);
+    CHECK(!parse("{\"\\ude00\":1}").ok);
+    check_splits("\"a\\ud83d\\ude00b\"");
+}
+
+static void test_limits()
+{
+    std::string nested;
+    for (int i = 0; i < JSON_STREAM_MAX_DEPTH; i++)
+    {
+        nested = "[" + nested + "]";
+    }
+    CHECK(parse(nested).ok);
+    CHECK(!parse("[" + nested + "]").ok);
+
+    std::string fits(JSON_STREAM_MAX_STRING - 1, 'x');
+    CHECK(parse("\"" + fits + "\"").trace == "0  -1 s:" + fits + "\n");
+    CHECK(parse("\"" + fits + "y\"").trace == "0  -1 s:" + fits + "...\n");
+
+    std::string key(JSON_STREAM_MAX_KEY + 10, 'k');
+    result_t r = parse("{\"" + key + "\":1}");
+    CHECK(r.ok);
+    CHECK(r.trace.find("1 " + key.substr(0, JSON_STREAM_MAX_KEY - 1) + " -1 n:1\n") != std::string::npos);
+
+    std::string number(JSON_STREAM_MAX_NUMBER, '1');
+    CHECK(!parse(number).ok);
+}
+
+static void generate(uint32_t *seed, int depth, std::string *doc)
+{
+    static const char *strings[] = {"", "probe", "a b", "\\\"", "\\u00e4", "\\ud83d\\ude00", "\xC3\xA4", "\\n"};
+    static const char *numbers[] = {"0", "-0", "1", "-12", "3.25", "1e3", "-2.5E-3", "123456789"};
+    uint32_t kind = xorshift(seed) % (depth < JSON_STREAM_MAX_DEPTH ? 7 : 5);
+    switch (kind)
+    {
+    case 0:
+        *doc += "\"" + std::string(strings[xorshift(seed) % 8]) + "\"";
+        break;
+    case 1:
+        *doc += numbers[xorshift(seed) % 8];
+        break;
+    case 2:
+        *doc += xorshift(seed) % 2 ? "true" : "false";
+        break;
+    case 3:
+        *doc += "null";
+        break;
+    case 4:
+        *doc += " ";
+        *doc += numbers[xorshift(seed) % 8];
+        *doc += "\t";
+        break;
+    default:
+    {
+        bool object = kind == 5;
+        *doc += object ? "{" : "[";
+        uint32_t count = xorshift(seed) % 4;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            if (i > 0)
+            {
+                *doc += ",";
+            }
+            if (object)
+            {
+                *doc += "\"" + std::string(strings[xorshift(seed) % 8]) + "\":";
+            }
+            generate(seed, depth + 1, doc);
+        }
+        *doc += object ? "}" : "]";
+        break;
+    }
+    }
+}
+
+static void mutate(uint32_t *seed, std::string *doc)
+{
+    static const char bytes[] = "{}[]\",:\\u0e-.tfn \x01\xff";
+    size_t pos = doc->empty() ? 0 : xorshift(seed) % doc->size();
+    char c = bytes[xorshift(seed) % (sizeof(bytes) - 1)];
+    switch (xorshift(seed) % 3)
+    {
+    case 0:
+        doc->insert(pos, 1, c);
+        break;
+    case 1:
+        if (!doc->empty())
+        {
+            doc->erase(pos, 1);
+        }
+        break;
+    default:
+        if (!doc->empty())
+        {
+            (*doc)[pos] = c;
+        }
+        break;
+    }
+}
+
+static std::vector<size_t> random_chunks(uint32_t *seed)
+{
+    std::vector<size_t> chunks;
+    for (int i = 0; i < 8; i++)
+    {
+        chunks.push_back(1 + xorshift(seed) % 16);
+    }
+    return chunks;
+}
+
+static void test_fuzz()
+{
+    uint32_t seed = 0x1BB0;
+    size_t rejected = 0;
+    for (int i = 0; i < FUZZ_DOCUMENTS; i++)
+    {
+        std::string doc;
+        generate(&seed, 0, &doc);
+        result_t whole = parse(doc);
+        if (!whole.ok)
+        {
+            fprintf(stderr, "rejected generated document %s\n", doc.c_str());
+        }
+        CHECK(whole.ok);
+        CHECK(parse(doc, random_chunks(&seed)).trace == whole.trace);
+
+        int mutations = 1 + xorshift(&seed) % 3;
+        for (int m = 0; m < mutations; m++)
+        {
+            mutate(&seed, &doc);
+        }
+        whole = parse(doc);
+        result_t chunked = parse(doc, random_chunks(&seed));
+        CHECK(chunked.ok == whole.ok);
+        CHECK(chunked.trace == whole.trace);
+        rejected += !whole.ok;
+    }
+    printf("fuzz: %d documents, %zu rejected after mutation\n", FUZZ_DOCUMENTS, rejected);
+}
+
+int main()
+{
+    test_values();
+    test_malformed();
+    test_unicode();
+    test_limits();
+    test_fuzz();
+    printf("json_stream: ok\n");
+    return 0;
+}
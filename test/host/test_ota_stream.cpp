@@ -0,0 +1,262 @@
+#include "ota_stream.h"
+
+#include <string.h>
+#include <string>
+#include <vector>
+#include "mbedtls/sha256.h"
+
+#include "check.h"
+
+#define CHUNK_SIZE 4096
+// Larger than the firmware and no multiple of the chunk size
+#define IMAGE_SIZE (1536 * 1024 + 123)
+#define PARTITION_SIZE (1792 * 1024)
+
+typedef std::vector<uint8_t> bytes_t;
+
+// The OTA slot, backed by a temporary file. Writes past its end fail like esp_ota_write.
+typedef struct partition
+{
+    FILE *file;
+    size_t size;
+    size_t written;
+    int writes;
+    // Writes that were not a full chunk, only the last may be one
+    int partial_writes;
+    bool partial_before_last;
+} partition_t;
+
+// The connection: short reads like TCP delivers them, timeouts in between and an early close
+typedef struct source
+{
+    const bytes_t *image;
+    size_t pos;
+    uint32_t seed;
+    // Every read times out this many times before it gets data
+    int timeouts;
+    // The connection closes or stalls with timeouts at this offset
+    size_t closes_at;
+    bool stalls;
+} source_t;
+
+typedef struct update
+{
+    source_t source;
+    partition_t partition;
+    std::vector<size_t> progress;
+    int timeouts_left;
+} update_t;
+
+static int read_source(void *ctx, uint8_t *buf, size_t len)
+{
+    update_t *u = (update_t *)ctx;
+    source_t *s = &u->source;
+    if (s->pos >= s->closes_at)
+    {
+        return s->stalls ? OTA_STREAM_READ_TIMEOUT : 0;
+    }
+    if (u->timeouts_left > 0)
+    {
+        u->timeouts_left--;
+        return OTA_STREAM_READ_TIMEOUT;
+    }
+    u->timeouts_left = s->timeouts;
+    size_t n = 1 + xorshift(&s->seed) % 1460;
+    n = std::min(n, std::min(len, s->closes_at - s->pos));
+    memcpy(buf, s->image->data() + s->pos, n);
+    s->pos += n;
+    return (int)n;
+}
+
+static esp_err_t write_partition(void *ctx, const uint8_t *buf, size_t len)
+{
+    partition_t *p = &((update_t *)ctx)->partition;
+    if (p->written + len > p->size)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (p->partial_writes > 0)
+    {
+        p->partial_before_last = true;
+    }
+    if (len != CHUNK_SIZE)
+    {
+        p->partial_writes++;
+    }
+    CHECK(fwrite(buf, 1, len, p->file) == len);
+    p->written += len;
+    p->writes++;
+    return ESP_OK;
+}
+
+static void record_progress(void *ctx, size_t received, size_t total)
+{
+    update_t *u = (update_t *)ctx;
+    CHECK(received == u->partition.written);
+    CHECK(u->progress.empty() || received > u->progress.back());
+    CHECK(received <= total);
+    u->progress.push_back(received);
+}
+
+static bytes_t image(size_t size, uint32_t seed)
+{
+    bytes_t data(size);
+    for (size_t i = 0; i < size; i++)
+    {
+        data[i] = xorshift(&seed) & 0xff;
+    }
+    return data;
+}
+
+static void sha256(const uint8_t *data, size_t len, uint8_t hash[OTA_SHA256_LEN])
+{
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    CHECK(mbedtls_sha256_starts_ret(&ctx, 0) == 0);
+    CHECK(mbedtls_sha256_update_ret(&ctx, data, len) == 0);
+    CHECK(mbedtls_sha256_finish_ret(&ctx, hash) == 0);
+    mbedtls_sha256_free(&ctx);
+}
+
+static std::string sha256_hex(const std::string &text)
+{
+    uint8_t hash[OTA_SHA256_LEN];
+    sha256((const uint8_t *)text.data(), text.size(), hash);
+    char hex[OTA_SHA256_LEN * 2 + 1];
+    ota_format_sha256(hash, hex);
+    return hex;
+}
+
+// Vectors of FIPS 180-2, the stand-in for mbedtls has to be right for the rest to mean anything
+static void test_sha256_vectors()
+{
+    CHECK(sha256_hex("") == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    CHECK(sha256_hex("abc") == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    CHECK(sha256_hex("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq") ==
+          "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+    CHECK(sha256_hex(std::string(1000000, 'a')) == "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+}
+
+static void test_parse_sha256()
+{
+    const char *hex = "BA7816BF8F01CFEA414140DE5DAE2223b00361a396177a9cb410ff61f20015ad";
+    uint8_t hash[OTA_SHA256_LEN];
+    CHECK(ota_parse_sha256(hex, hash));
+    char formatted[OTA_SHA256_LEN * 2 + 1];
+    ota_format_sha256(hash, formatted);
+    CHECK(strcasecmp(formatted, hex) == 0);
+
+    CHECK(!ota_parse_sha256("", hash));
+    CHECK(!ota_parse_sha256(std::string(hex, 63).c_str(), hash));
+    CHECK(!ota_parse_sha256((std::string(hex) + "0").c_str(), hash));
+    std::string invalid = hex;
+    invalid[10] = 'g';
+    CHECK(!ota_parse_sha256(invalid.c_str(), hash));
+}
+
+static esp_err_t run(update_t *u, const bytes_t &data, uint8_t hash[OTA_SHA256_LEN])
+{
+    u->source.image = &data;
+    u->partition.file = tmpfile();
+    CHECK(u->partition.file != NULL);
+    if (u->partition.size == 0)
+    {
+        u->partition.size = PARTITION_SIZE;
+    }
+    if (u->source.closes_at == 0)
+    {
+        u->source.closes_at = data.size();
+    }
+    u->timeouts_left = u->source.timeouts;
+    ota_stream_io_t io = {read_source, write_partition, record_progress, u};
+    // Only one chunk is ever buffered, ASan sees any access past it
+    uint8_t *buf = new uint8_t[CHUNK_SIZE];
+    esp_err_t err = ota_stream_copy(&io, data.size(), buf, CHUNK_SIZE, hash);
+    delete[] buf;
+    return err;
+}
+
+static bytes_t read_back(partition_t *p)
+{
+    bytes_t data(p->written);
+    rewind(p->file);
+    CHECK(fread(data.data(), 1, data.size(), p->file) == data.size());
+    fclose(p->file);
+    return data;
+}
+
+static void test_complete_image()
+{
+    bytes_t data = image(IMAGE_SIZE, 0x0a1);
+    update_t u = {};
+    u.source.seed = 0x5eed;
+    // As many timeouts in a row as are retried
+    u.source.timeouts = OTA_STREAM_MAX_READ_RETRIES;
+    uint8_t hash[OTA_SHA256_LEN];
+    CHECK(run(&u, data, hash) == ESP_OK);
+
+    CHECK(read_back(&u.partition) == data);
+    uint8_t expected[OTA_SHA256_LEN];
+    sha256(data.data(), data.size(), expected);
+    CHECK(memcmp(hash, expected, OTA_SHA256_LEN) == 0);
+    // Full chunks to the flash and only the rest of the image at the end
+    CHECK(u.partition.writes == (IMAGE_SIZE + CHUNK_SIZE - 1) / CHUNK_SIZE);
+    CHECK(u.partition.partial_writes == 1 && !u.partition.partial_before_last);
+    CHECK(u.progress.size() == (size_t)u.partition.writes);
+    CHECK(u.progress.back() == IMAGE_SIZE);
+
+    // One flipped bit and the hash no longer matches what the client sent
+    data[IMAGE_SIZE / 2] ^= 0x10;
+    update_t tampered = {};
+    tampered.source.seed = 0x5eed;
+    CHECK(run(&tampered, data, hash) == ESP_OK);
+    read_back(&tampered.partition);
+    CHECK(memcmp(hash, expected, OTA_SHA256_LEN) != 0);
+}
+
+static void test_failures()
+{
+    bytes_t data = image(IMAGE_SIZE, 0x0a2);
+    uint8_t hash[OTA_SHA256_LEN];
+
+    // One timeout more than is retried ends the update
+    update_t impatient = {};
+    impatient.source.seed = 1;
+    impatient.source.timeouts = OTA_STREAM_MAX_READ_RETRIES + 1;
+    CHECK(run(&impatient, data, hash) == ESP_ERR_TIMEOUT);
+    CHECK(read_back(&impatient.partition).empty());
+
+    // The client stalls in the middle, what came in full chunks is written
+    update_t stalled = {};
+    stalled.source.seed = 2;
+    stalled.source.closes_at = 10 * CHUNK_SIZE + 100;
+    stalled.source.stalls = true;
+    CHECK(run(&stalled, data, hash) == ESP_ERR_TIMEOUT);
+    CHECK(read_back(&stalled.partition) == bytes_t(data.begin(), data.begin() + 10 * CHUNK_SIZE));
+    CHECK(stalled.progress.back() == 10 * CHUNK_SIZE);
+
+    // The client closes the connection
+    update_t closed = {};
+    closed.source.seed = 3;
+    closed.source.closes_at = 3 * CHUNK_SIZE - 1;
+    CHECK(run(&closed, data, hash) == ESP_ERR_TIMEOUT);
+    CHECK(read_back(&closed.partition).size() == 2 * CHUNK_SIZE);
+
+    // The image does not fit, the error of the partition is returned
+    update_t full = {};
+    full.source.seed = 4;
+    full.partition.size = 64 * CHUNK_SIZE;
+    CHECK(run(&full, data, hash) == ESP_ERR_INVALID_SIZE);
+    CHECK(read_back(&full.partition).size() == 64 * CHUNK_SIZE);
+    CHECK(full.source.pos < 66 * CHUNK_SIZE);
+}
+
+int main()
+{
+    test_sha256_vectors();
+    test_parse_sha256();
+    test_complete_image();
+    test_failures();
+    printf("ota_stream: ok\n");
+    return 0;
+}
@@ -0,0 +1,205 @@
+#include "probe_state.h"
+
+#include <string.h>
+#include <string>
+
+#include "check.h"
+
+// Length byte, characters and terminating zero
+static size_t entry_size(const char *value)
+{
+    return strlen(value) + 2;
+}
+
+static void test_defaults()
+{
+    probe_config_t config;
+    probe_config_defaults(&config);
+    for (size_t i = 0; i < MAX_PROBE_COUNT; i++)
+    {
+        char name[16];
+        snprintf(name, sizeof(name), "Kanal %d", (int)i + 1);
+        CHECK(strcmp(probe_config_name(&config, i), name) == 0);
+        CHECK(strcmp(probe_config_color(&config, i), "#22B14C") == 0);
+        // All probes share one color string
+        CHECK(config.color[i] == config.color[0]);
+    }
+    CHECK(config.used == MAX_PROBE_COUNT * entry_size("Kanal 1") + entry_size("#22B14C"));
+    CHECK(strcmp(probe_config_name(&config, MAX_PROBE_COUNT), "") == 0);
+    CHECK(probe_config_valid(&config, probe_config_size(&config)));
+}
+
+static void test_intern()
+{
+    probe_config_t config;
+    probe_config_defaults(&config);
+    uint16_t used = config.used;
+    // A name that equals a color or another name is stored once
+    CHECK(probe_config_set(&config, 0, "Brisket", "#FF0000"));
+    CHECK(probe_config_set(&config, 1, "Brisket", "#FF0000"));
+    CHECK(config.name[0] == config.name[1] && config.color[0] == config.color[1]);
+    CHECK(probe_config_set(&config, 2, "#FF0000", NULL));
+    CHECK(config.name[2] == config.color[0]);
+    CHECK(strcmp(probe_config_color(&config, 2), "#22B14C") == 0);
+    CHECK(config.used == used - 3 * entry_size("Kanal 1") + entry_size("Brisket") + entry_size("#FF0000"));
+
+    // Longer strings are cut, the cut string is what is compared
+    std::string long_name(PROBE_NAME_MAX + 20, 'x');
+    CHECK(probe_config_set(&config, 3, long_name.c_str(), "#0000FFAA"));
+    CHECK(strlen(probe_config_name(&config, 3)) == PROBE_NAME_MAX);
+    CHECK(strcmp(probe_config_color(&config, 3), "#0000FF") == 0);
+    CHECK(probe_config_set(&config, 4, std::string(PROBE_NAME_MAX, 'x').c_str(), "#0000FF"));
+    CHECK(config.name[4] == config.name[3] && config.color[4] == config.color[3]);
+    CHECK(probe_config_valid(&config, probe_config_size(&config)));
+
+    // An empty name is a string like any other
+    CHECK(probe_config_set(&config, 5, "", NULL));
+    CHECK(strcmp(probe_config_name(&config, 5), "") == 0);
+    CHECK(!probe_config_set(&config, MAX_PROBE_COUNT, "Too far", NULL));
+}
+
+// Changes rebuild the pool, strings no probe uses anymore are gone and the pool never fills up
+static void test_rebuild()
+{
+    probe_config_t config;
+    probe_config_defaults(&config);
+    uint32_t seed = 9;
+    for (int round = 0; round < 10000; round++)
+    {
+        size_t probe = xorshift(&seed) % MAX_PROBE_COUNT;
+        char name[40];
+        snprintf(name, sizeof(name), "Probe %u", xorshift(&seed) % 1000);
+        char color[8];
+        snprintf(color, sizeof(color), "#%06X", xorshift(&seed) % 4 * 0x111111);
+        CHECK(probe_config_set(&config, probe, name, color));
+        CHECK(strcmp(probe_config_name(&config, probe), name) == 0);
+        CHECK(strcmp(probe_config_color(&config, probe), color) == 0);
+
+        // Exactly the strings in use, each once
+        size_t expected = 0;
+        for (size_t i = 0; i < MAX_PROBE_COUNT; i++)
+        {
+            bool name_seen = false;
+            bool color_seen = false;
+            for (size_t j = 0; j < i; j++)
+            {
+                name_seen |= strcmp(probe_config_name(&config, i), probe_config_name(&config, j)) == 0 ||
+                             strcmp(probe_config_name(&config, i), probe_config_color(&config, j)) == 0;
+                color_seen |= strcmp(probe_config_color(&config, i), probe_config_name(&config, j)) == 0 ||
+                              strcmp(probe_config_color(&config, i), probe_config_color(&config, j)) == 0;
+            }
+            expected += name_seen ? 0 : entry_size(probe_config_name(&config, i));
+            bool color_is_name = strcmp(probe_config_color(&config, i), probe_config_name(&config, i)) == 0;
+            expected += color_seen || color_is_name ? 0 : entry_size(probe_config_color(&config, i));
+        }
+        CHECK(config.used == expected);
+        CHECK(probe_config_valid(&config, probe_config_size(&config)));
+    }
+
+    // Eight different long names don't fit, the change is refused and nothing changes
+    probe_config_defaults(&config);
+    size_t probe = 0;
+    while (true)
+    {
+        std::string name(PROBE_NAME_MAX, 'a' + probe);
+        probe_config_t before = config;
+        if (!probe_config_set(&config, probe, name.c_str(), NULL))
+        {
+            CHECK(memcmp(&before, &config, sizeof(config)) == 0);
+            break;
+        }
+        probe++;
+    }
+    CHECK(probe == 2);
+    // Shorter names of the other probes make room again
+    CHECK(probe_config_set(&config, 0, "Short", NULL));
+    CHECK(probe_config_set(&config, 2, std::string(PROBE_NAME_MAX, 'c').c_str(), NULL));
+}
+
+static void test_valid()
+{
+    probe_config_t config;
+    probe_config_defaults(&config);
+    CHECK(probe_config_set(&config, 1, "Ribs", "#FF0000"));
+    size_t size = probe_config_size(&config);
+    CHECK(probe_config_valid(&config, size));
+    CHECK(!probe_config_valid(&config, size - 1));
+    CHECK(!probe_config_valid(&config, size + 1));
+    CHECK(!probe_config_valid(&config, offsetof(probe_config_t, strings) - 1));
+    CHECK(!probe_config_valid(&config, sizeof(probe_config_t) + 1));
+
+    probe_config_t corrupt = config;
+    // A length running past the pool
+    corrupt.strings[config.name[1]] = 200;
+    CHECK(!probe_config_valid(&corrupt, size));
+    // A missing terminating zero
+    corrupt = config;
+    corrupt.strings[config.name[1] + 1 + strlen("Ribs")] = 'x';
+    CHECK(!probe_config_valid(&corrupt, size));
+    // An offset into the middle of a string or past the pool
+    corrupt = config;
+    corrupt.name[3] = config.name[1] + 1;
+    CHECK(!probe_config_valid(&corrupt, size));
+    corrupt = config;
+    corrupt.color[7] = config.used;
+    CHECK(!probe_config_valid(&corrupt, size));
+    corrupt = config;
+    corrupt.used = PROBE_STRINGS_SIZE + 1;
+    CHECK(!probe_config_valid(&corrupt, probe_config_size(&corrupt)));
+
+    // Random damage is either refused or leaves every string terminated inside the pool
+    uint32_t seed = 17;
+    for (int round = 0; round < 100000; round++)
+    {
+        corrupt = config;
+        uint8_t *bytes = (uint8_t *)&corrupt;
+        for (uint32_t n = 1 + xorshift(&seed) % 3; n > 0; n--)
+        {
+            bytes[xorshift(&seed) % size] ^= 1 << (xorshift(&seed) % 8);
+        }
+        size_t damaged_size = xorshift(&seed) % 8 == 0 ? xorshift(&seed) % sizeof(corrupt) : size;
+        if (!probe_config_valid(&corrupt, damaged_size))
+        {
+            continue;
+        }
+        for (size_t i = 0; i < MAX_PROBE_COUNT; i++)
+        {
+            const char *name = probe_config_name(&corrupt, i);
+            const char *color = probe_config_color(&corrupt, i);
+            CHECK(name >= (const char *)corrupt.strings && name + strlen(name) < (const char *)corrupt.strings + corrupt.used);
+            CHECK(color >= (const char *)corrupt.strings && color + strlen(color) < (const char *)corrupt.strings + corrupt.used);
+        }
+    }
+}
+
+static void test_hot_update()
+{
+    probe_hot_t hot = {};
+    hot.min[0] = 100;
+    hot.max[0] = 120;
+    hot.min[1] = 50;
+    hot.max[1] = 60;
+    // max <= min switches the range off
+    hot.min[2] = 80;
+    hot.max[2] = 80;
+    hot.min[3] = 10;
+    hot.max[3] = 20;
+    const uint16_t raw[] = {1105, 615, 50, 0xFFF6};
+    probe_hot_update(&hot, raw, 4, 1234);
+    CHECK(hot.temps[0] == 110.5f && hot.temps[1] == 61.5f && hot.temps[2] == 5.0f);
+    CHECK(hot.alarm_active == 0x02 && hot.updated_us == 1234);
+    const uint16_t cold[] = {995};
+    probe_hot_update(&hot, cold, 1, 5678);
+    CHECK(hot.alarm_active == 0x01);
+}
+
+int main()
+{
+    test_defaults();
+    test_intern();
+    test_rebuild();
+    test_valid();
+    test_hot_update();
+    printf("probe_state: ok\n");
+    return 0;
+}
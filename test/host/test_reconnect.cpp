@@ -0,0 +1,225 @@
+#include "wifi.h"
+
+#include <string.h>
+#include <condition_variable>
+#include <mutex>
+#include "esp_log.h"
+#include "esp_system.h"
+#include "host_wifi.h"
+
+#include "net_services.h"
+#include "boot.h"
+#include "webserver.h"
+#include "influx.h"
+#include "sample_multicast.h"
+#include "hub.h"
+#include "dns_server.h"
+#include "TaskRegistry.h"
+
+#include "check.h"
+
+#define RECONNECTS 1000
+#define WARMUP_RECONNECTS 10
+#define WAIT_MS 2000
+// What the allocator may still move around after the warm up, one leaked httpd is 8 KiB
+#define HEAP_TOLERANCE 1024
+
+// The routes, the uploaders and the DNS server are modules of their own, here they only count
+// how often the WiFi events start them
+static std::mutex counts_mutex;
+static std::condition_variable counts_cond;
+static int routes_registered = 0;
+static int scans_attached = 0;
+static int station_ups = 0;
+static int dns_starts = 0;
+
+static void count(int *counter)
+{
+    std::lock_guard<std::mutex> lock(counts_mutex);
+    (*counter)++;
+    counts_cond.notify_all();
+}
+
+static bool wait_for(const int *counter, int value)
+{
+    std::unique_lock<std::mutex> lock(counts_mutex);
+    return counts_cond.wait_for(lock, std::chrono::milliseconds(WAIT_MS), [counter, value] { return *counter >= value; });
+}
+
+static int get(const int *counter)
+{
+    std::lock_guard<std::mutex> lock(counts_mutex);
+    return *counter;
+}
+
+static esp_err_t dummy_handler(httpd_req_t *req)
+{
+    return ESP_OK;
+}
+
+void register_webserver_routes(httpd_handle_t server, ibbq_state_t *state)
+{
+    static const char *uris[] = {"/", "/data", "/settings", "/ota", "/capture"};
+    for (const char *uri : uris)
+    {
+        httpd_uri_t route = {uri, HTTP_GET, dummy_handler, state};
+        CHECK(httpd_register_uri_handler(server, &route) == ESP_OK);
+    }
+    count(&routes_registered);
+}
+
+static void scan_handler(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+}
+
+void wifi_scan_attach(esp_event_loop_handle_t loop)
+{
+    CHECK(esp_event_handler_register_with(loop, ESP_EVENT_ANY_BASE, ESP_EVENT_ANY_ID, scan_handler, NULL) == ESP_OK);
+    count(&scans_attached);
+}
+
+void influx_start(ibbq_state_t *state)
+{
+    count(&station_ups);
+}
+
+void sample_multicast_start()
+{
+}
+
+void hub_start(ibbq_state_t *state)
+{
+}
+
+void init_dns_server(dns_server_config_t *cfg)
+{
+    count(&dns_starts);
+}
+
+bool TaskRegistry::add(const char *name, uint32_t stackSize)
+{
+    return true;
+}
+
+bool TaskRegistry::addEventLoop(esp_event_loop_handle_t loop, const char *name, uint32_t stackSize)
+{
+    return true;
+}
+
+bool loadSettings(SETTINS_ID type, void *settings)
+{
+    if (type == WIFI_SETTINGS)
+    {
+        wifi_client_config_t *wifi = (wifi_client_config_t *)settings;
+        memset(wifi, 0, sizeof(*wifi));
+        strcpy(wifi->ssid, "garden");
+        strcpy(wifi->psk, "secret");
+        return true;
+    }
+    if (type == SYSTEM_SETTINGS)
+    {
+        system_settings_t *system = (system_settings_t *)settings;
+        memset(system, 0, sizeof(*system));
+        strcpy(system->hostname, "ibbq");
+        strcpy(system->ap_name, "iBBQ-Gateway");
+        return true;
+    }
+    return false;
+}
+
+void saveSettings(SETTINS_ID type, void *settings)
+{
+}
+
+// Waits until the event task handled everything sent so far. It handles one event after the other,
+// AP_START starts the DNS server before the web server, so only a later event tells that it is done.
+static void settle()
+{
+    system_event_t got_ip = {};
+    got_ip.event_id = SYSTEM_EVENT_STA_GOT_IP;
+    int ups = get(&station_ups);
+    CHECK(esp_event_send(&got_ip) == ESP_OK);
+    CHECK(wait_for(&station_ups, ups + 1));
+}
+
+// Station drops and reconnects, the services have to stay as they are
+static int64_t station_soak(int64_t heap_before)
+{
+    int ups = get(&station_ups);
+    for (int i = 0; i < RECONNECTS; i++)
+    {
+        host_wifi_drop_connection();
+        CHECK(wait_for(&station_ups, ++ups));
+    }
+    return heap_before - (int64_t)esp_get_free_heap_size();
+}
+
+// The access point restarts, every AP_START used to start httpd and the DNS server again
+static int64_t ap_soak(int64_t heap_before)
+{
+    int starts = get(&dns_starts);
+    for (int i = 0; i < RECONNECTS; i++)
+    {
+        CHECK(esp_wifi_stop() == ESP_OK);
+        CHECK(esp_wifi_start() == ESP_OK);
+        CHECK(wait_for(&dns_starts, ++starts));
+    }
+    return heap_before - (int64_t)esp_get_free_heap_size();
+}
+
+int main()
+{
+    esp_log_level_set("*", ESP_LOG_ERROR);
+    boot_init();
+    static ibbq_state_t state = {};
+    static system_settings_t system = {};
+    loadSettings(SYSTEM_SETTINGS, &system);
+    static network_context_t ctx = {NULL, &state, &system};
+
+    wifi_init(&ctx);
+    CHECK(wait_for(&station_ups, 1));
+    CHECK(ctx.webserver != NULL);
+    httpd_handle_t server = ctx.webserver;
+
+    // The first reconnects may still grow pools of the allocator and the event loop
+    for (int i = 0; i < WARMUP_RECONNECTS; i++)
+    {
+        host_wifi_drop_connection();
+        CHECK(wait_for(&station_ups, 2 + i));
+    }
+    int64_t heap_before = esp_get_free_heap_size();
+    int64_t station_growth = station_soak(heap_before);
+    CHECK(ctx.webserver == server);
+    CHECK(get(&routes_registered) == 1);
+    CHECK(get(&scans_attached) == 1);
+    CHECK(station_growth < HEAP_TOLERANCE);
+
+    // Three failed retries switch to access point mode
+    host_wifi_set_reachable(false);
+    host_wifi_drop_connection();
+    CHECK(wait_for(&dns_starts, 1));
+    for (int i = 0; i < WARMUP_RECONNECTS; i++)
+    {
+        CHECK(esp_wifi_stop() == ESP_OK);
+        CHECK(esp_wifi_start() == ESP_OK);
+        CHECK(wait_for(&dns_starts, 2 + i));
+    }
+    heap_before = esp_get_free_heap_size();
+    int64_t ap_growth = ap_soak(heap_before);
+    settle();
+    CHECK(ctx.webserver == server);
+    CHECK(get(&routes_registered) == 1);
+    CHECK(get(&scans_attached) == 1);
+    CHECK(ap_growth < HEAP_TOLERANCE);
+
+    // A deliberate stop frees everything and the next start begins from scratch
+    net_services_stop();
+    CHECK(net_services_start(&state) != NULL);
+    CHECK(get(&routes_registered) == 2);
+    CHECK(get(&scans_attached) == 2);
+
+    printf("reconnect: %d station reconnects grew the heap by %lld bytes, %d access point restarts by %lld bytes\n",
+           RECONNECTS, (long long)station_growth, RECONNECTS, (long long)ap_growth);
+    printf("reconnect: ok\n");
+    return 0;
+}
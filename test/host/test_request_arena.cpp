@@ -0,0 +1,148 @@
+#include "request_arena.h"
+#include "heap_stats.h"
+#include "cJSON.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include "esp_log.h"
+
+#include "check.h"
+
+// Linked with --wrap=free, so the test sees whether releasing memory reached the heap at all
+extern "C" void __real_free(void *ptr);
+
+static std::atomic<uint32_t> s_frees(0);
+
+extern "C" void __wrap_free(void *ptr)
+{
+    if (ptr != NULL)
+    {
+        s_frees++;
+    }
+    __real_free(ptr);
+}
+
+static httpd_req_t s_req = {};
+static httpd_req_t s_other_req = {};
+
+static int32_t json_bytes()
+{
+    heap_tag_stats_t stats;
+    heap_stats_get(HEAP_TAG_JSON, &stats);
+    return stats.current_bytes;
+}
+
+static void test_bump_and_reset()
+{
+    request_arena_begin(&s_req);
+    uint8_t *first = (uint8_t *)request_arena_alloc(&s_req, 100);
+    uint8_t *second = (uint8_t *)request_arena_alloc(&s_req, 1);
+    uint8_t *third = (uint8_t *)request_arena_alloc(&s_req, 8);
+    CHECK(first != NULL && ((uintptr_t)first & 7) == 0);
+    // Blocks follow each other, each starting at the next multiple of 8
+    CHECK(second == first + 104 && third == first + 112);
+    // Only the request the arena is bound to allocates from it
+    CHECK(request_arena_alloc(&s_other_req, 8) == NULL);
+    CHECK(request_arena_alloc(NULL, 8) == NULL);
+    CHECK(!request_arena_exhausted(&s_req));
+
+    // However much was allocated, the end of a request frees nothing and walks nothing, the next one
+    // starts at the beginning again
+    for (int i = 0; i < 1000; i++)
+    {
+        CHECK(request_arena_alloc(&s_req, 8) != NULL);
+    }
+    uint32_t frees = s_frees;
+    request_arena_end(&s_req);
+    CHECK(s_frees == frees);
+    request_arena_begin(&s_other_req);
+    CHECK(request_arena_alloc(&s_other_req, 16) == first);
+    request_arena_end(&s_other_req);
+
+    request_arena_stats_t stats;
+    request_arena_get_stats(&stats);
+    CHECK(stats.size == REQUEST_ARENA_SIZE && stats.peak_bytes == 120 + 1000 * 8);
+}
+
+// cJSON_Delete and cJSON_free of a node in the arena must not hand it to the heap
+static void test_json_frees_are_noops()
+{
+    int32_t json = json_bytes();
+    request_arena_begin(&s_req);
+    uint8_t *node = (uint8_t *)cJSON_malloc(64);
+    CHECK(node != NULL);
+    memset(node, 0x5a, 64);
+    uint32_t frees = s_frees;
+    cJSON_free(node);
+    CHECK(s_frees == frees);
+    // The block isn't handed out again within the request either
+    uint8_t *next = (uint8_t *)cJSON_malloc(64);
+    CHECK(next == node + 64);
+    for (int i = 0; i < 64; i++)
+    {
+        CHECK(node[i] == 0x5a);
+    }
+    CHECK(json_bytes() == json);
+
+    // Other tasks keep using the heap while a request is served
+    std::thread other([]() {
+        void *ptr = cJSON_malloc(32);
+        CHECK(json_bytes() > 0);
+        cJSON_free(ptr);
+    });
+    other.join();
+    CHECK(s_frees == frees + 1);
+    request_arena_end(&s_req);
+
+    // So does this one once the request has ended
+    void *ptr = cJSON_malloc(48);
+    CHECK(json_bytes() == json + 48);
+    cJSON_free(ptr);
+    CHECK(json_bytes() == json);
+}
+
+// An exhausted arena makes send_json answer 503 instead of sending a tree with nodes missing
+static void test_exhaustion()
+{
+    request_arena_stats_t before;
+    request_arena_get_stats(&before);
+    request_arena_begin(&s_req);
+    size_t allocated = 0;
+    while (cJSON_malloc(1000) != NULL)
+    {
+        allocated += 1000;
+    }
+    CHECK(allocated == REQUEST_ARENA_SIZE / 1000 * 1000);
+    CHECK(request_arena_exhausted(&s_req));
+    // Smaller nodes still fit, the request stays marked anyway
+    CHECK(cJSON_malloc(8) != NULL);
+    CHECK(request_arena_exhausted(&s_req));
+    CHECK(!request_arena_exhausted(&s_other_req));
+    CHECK(request_arena_alloc(&s_req, REQUEST_ARENA_SIZE + 1) == NULL);
+    CHECK(request_arena_alloc(&s_req, SIZE_MAX) == NULL);
+    request_arena_end(&s_req);
+
+    request_arena_stats_t after;
+    request_arena_get_stats(&after);
+    CHECK(after.exhausted == before.exhausted + 1 && after.requests == before.requests + 1);
+    CHECK(after.peak_bytes <= REQUEST_ARENA_SIZE && after.peak_bytes > REQUEST_ARENA_SIZE - 1000);
+    // The next request has the whole arena again
+    request_arena_begin(&s_req);
+    CHECK(!request_arena_exhausted(&s_req));
+    CHECK(request_arena_alloc(&s_req, REQUEST_ARENA_SIZE) != NULL);
+    CHECK(!request_arena_exhausted(&s_req));
+    request_arena_end(&s_req);
+}
+
+int main()
+{
+    esp_log_level_set("*", ESP_LOG_NONE);
+    request_arena_init();
+    test_bump_and_reset();
+    test_json_frees_are_noops();
+    test_exhaustion();
+    printf("request_arena: ok\n");
+    return 0;
+}
@@ -0,0 +1,203 @@
+#include "sample_datagram.h"
+
+#include <string.h>
+#include <sys/wait.h>
+#include <string>
+#include <vector>
+
+#include "check.h"
+
+// The layout of tools/sample_receiver.py, struct "!IBBBBII6s" followed by the values
+#define PY_HEADER_SIZE 22
+
+static const uint8_t DEVICE_ID[6] = {0x24, 0x0a, 0xc4, 0x12, 0x34, 0x56};
+
+// What sample_multicast_publish_device() sends for a frame of the thermometer
+static size_t publish(uint8_t index, uint32_t sequence, uint32_t uptime_ms, const uint16_t *raw_values,
+                      size_t count, float battery_percent, sample_datagram_t *datagram)
+{
+    sample_frame_t frame = {};
+    memcpy(frame.device_id, DEVICE_ID, sizeof(DEVICE_ID));
+    frame.device_id[5] += index;
+    frame.sequence = sequence;
+    frame.uptime_ms = uptime_ms;
+    sample_frame_set_values(&frame, raw_values, count, battery_percent);
+    return sample_datagram_encode(&frame, datagram);
+}
+
+static std::string hex(const void *data, size_t len)
+{
+    std::string out;
+    char byte[3];
+    for (size_t i = 0; i < len; i++)
+    {
+        snprintf(byte, sizeof(byte), "%02x", ((const uint8_t *)data)[i]);
+        out += byte;
+    }
+    return out;
+}
+
+static void test_layout()
+{
+    CHECK(offsetof(sample_datagram_t, deci_degrees) == PY_HEADER_SIZE);
+    uint16_t raw[] = {215, 0xFFF6, 1105, 0};
+    sample_datagram_t datagram;
+    size_t len = publish(2, 0x01020304, 0xA0B0C0D0, raw, 4, 87.9f, &datagram);
+    CHECK(len == PY_HEADER_SIZE + 4 * 2);
+    CHECK(hex(&datagram, len) == "69424251"         // magic
+                                 "01"               // version
+                                 "04"               // probe count
+                                 "57"               // battery 87
+                                 "00"               // reserved
+                                 "01020304"         // sequence
+                                 "a0b0c0d0"         // uptime
+                                 "240ac4123458"     // device id, index added to the last byte
+                                 "00d7" "8000" "0451" "0000");
+}
+
+static void test_round_trip()
+{
+    uint32_t seed = 7;
+    for (int n = 0; n < 10000; n++)
+    {
+        uint16_t raw[MAX_PROBE_COUNT + 2];
+        size_t count = xorshift(&seed) % (MAX_PROBE_COUNT + 3);
+        for (size_t i = 0; i < count; i++)
+        {
+            uint32_t r = xorshift(&seed);
+            raw[i] = r % 4 == 0 ? 0xFFF6 : r % 3000;
+        }
+        uint32_t sequence = xorshift(&seed);
+        uint32_t uptime_ms = xorshift(&seed);
+        float battery = xorshift(&seed) % 101;
+        sample_datagram_t datagram;
+        size_t len = publish(n % 8, sequence, uptime_ms, raw, count, battery, &datagram);
+
+        sample_frame_t frame;
+        CHECK(sample_datagram_decode((const uint8_t *)&datagram, len, &frame));
+        size_t expected = count < MAX_PROBE_COUNT ? count : MAX_PROBE_COUNT;
+        CHECK(frame.probe_count == expected && len == PY_HEADER_SIZE + 2 * expected);
+        CHECK(frame.sequence == sequence && frame.uptime_ms == uptime_ms && frame.battery_percent == battery);
+        CHECK(memcmp(frame.device_id, DEVICE_ID, 5) == 0 && frame.device_id[5] == DEVICE_ID[5] + n % 8);
+        for (size_t i = 0; i < expected; i++)
+        {
+            CHECK(frame.deci_degrees[i] == (raw[i] == 0xFFF6 ? SAMPLE_NO_VALUE : raw[i]));
+        }
+        // Anything cut short is refused
+        CHECK(!sample_datagram_decode((const uint8_t *)&datagram, len - 1, &frame) || len == PY_HEADER_SIZE);
+    }
+}
+
+static void test_invalid()
+{
+    uint16_t raw[] = {215, 643};
+    sample_datagram_t datagram;
+    size_t len = publish(0, 1, 1, raw, 2, 50, &datagram);
+    sample_frame_t frame;
+    CHECK(!sample_datagram_decode((const uint8_t *)&datagram, PY_HEADER_SIZE - 1, &frame));
+    CHECK(!sample_datagram_decode((const uint8_t *)&datagram, len - 1, &frame));
+
+    sample_datagram_t changed = datagram;
+    changed.version = SAMPLE_DATAGRAM_VERSION + 1;
+    CHECK(!sample_datagram_decode((const uint8_t *)&changed, len, &frame));
+    changed = datagram;
+    ((uint8_t *)&changed.magic)[0] ^= 1;
+    CHECK(!sample_datagram_decode((const uint8_t *)&changed, len, &frame));
+
+    // A gateway with more probes than this one, the hub only receives the first MAX_PROBE_COUNT values
+    uint8_t larger[sizeof(sample_datagram_t)];
+    uint16_t many[MAX_PROBE_COUNT];
+    for (size_t i = 0; i < MAX_PROBE_COUNT; i++)
+    {
+        many[i] = 100 + i;
+    }
+    len = publish(0, 1, 1, many, MAX_PROBE_COUNT, 50, (sample_datagram_t *)larger);
+    larger[5] = MAX_PROBE_COUNT + 2;
+    CHECK(sample_datagram_decode(larger, len, &frame) && frame.probe_count == MAX_PROBE_COUNT);
+    CHECK(frame.deci_degrees[MAX_PROBE_COUNT - 1] == 100 + MAX_PROBE_COUNT - 1);
+
+    // Out of range battery levels don't wrap around
+    len = publish(0, 1, 1, raw, 2, -5, &datagram);
+    CHECK(datagram.battery_percent == 0);
+    len = publish(0, 1, 1, raw, 2, 300, &datagram);
+    CHECK(datagram.battery_percent == 255);
+}
+
+// Feeds datagrams to parse() of the reference receiver and compares what it read
+static void test_sample_receiver()
+{
+    const char *script =
+        "import sys\n"
+        "sys.path.insert(0, '../../tools')\n"
+        "import sample_receiver as r\n"
+        "assert r.HEADER.size == 22\n"
+        "for line in sys.stdin:\n"
+        "    device, sequence, uptime_ms, battery, temps = r.parse(bytes.fromhex(line.strip()))\n"
+        "    values = ','.join('-' if t is None else str(round(t * 10)) for t in temps)\n"
+        "    print(device, sequence, uptime_ms, battery, values)\n";
+    FILE *file = fopen("build/sample_receiver_check.py", "w");
+    CHECK(file != NULL);
+    fputs(script, file);
+    fclose(file);
+
+    std::vector<std::string> expected;
+    std::string input;
+    uint32_t seed = 11;
+    for (int n = 0; n < 200; n++)
+    {
+        uint16_t raw[MAX_PROBE_COUNT];
+        size_t count = 1 + xorshift(&seed) % MAX_PROBE_COUNT;
+        std::string values;
+        for (size_t i = 0; i < count; i++)
+        {
+            uint32_t r = xorshift(&seed);
+            raw[i] = r % 5 == 0 ? 0xFFF6 : r % 4000;
+            values += (i > 0 ? "," : "") + (raw[i] == 0xFFF6 ? std::string("-") : std::to_string(raw[i]));
+        }
+        sample_datagram_t datagram;
+        size_t len = publish(n % 3, n * 1000003u, n * 997u, raw, count, n % 101, &datagram);
+        input += hex(&datagram, len) + "\n";
+        char line[256];
+        snprintf(line, sizeof(line), "24:0a:c4:12:34:%02x %u %u %d %s", DEVICE_ID[5] + n % 3, n * 1000003u,
+                 n * 997u, n % 101, values.c_str());
+        expected.push_back(line);
+    }
+    FILE *input_file = fopen("build/sample_receiver_input.txt", "w");
+    CHECK(input_file != NULL);
+    fputs(input.c_str(), input_file);
+    fclose(input_file);
+
+    FILE *pipe = popen("python3 build/sample_receiver_check.py < build/sample_receiver_input.txt 2>&1", "r");
+    CHECK(pipe != NULL);
+    std::vector<std::string> lines;
+    char line[512];
+    while (fgets(line, sizeof(line), pipe) != NULL)
+    {
+        lines.push_back(std::string(line, strcspn(line, "\n")));
+    }
+    int status = pclose(pipe);
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 127)
+    {
+        printf("sample_datagram: python3 not found, tools/sample_receiver.py not checked\n");
+        return;
+    }
+    if (status != 0)
+    {
+        for (const std::string &output : lines)
+        {
+            fprintf(stderr, "%s\n", output.c_str());
+        }
+    }
+    CHECK(status == 0);
+    CHECK(lines == expected);
+}
+
+int main()
+{
+    test_layout();
+    test_round_trip();
+    test_invalid();
+    test_sample_receiver();
+    printf("sample_datagram: ok\n");
+    return 0;
+}
@@ -0,0 +1,237 @@
+#include "settings.h"
+
+#include <string.h>
+#include <string>
+#include <vector>
+#include "esp_log.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+
+#include "check.h"
+
+// The layout of version 1 in settings.cpp, every name and color at full length
+typedef struct channel_settings_v1
+{
+    uint8_t version;
+    struct
+    {
+        float min;
+        float max;
+        char color[8];
+        uint8_t alarm;
+        char name[128];
+    } probe_configs[MAX_PROBE_COUNT];
+} channel_settings_v1_t;
+
+static_assert(sizeof(channel_settings_v1_t) == 1188, "Version 1 is what the firmware stored before");
+
+static probe_config_t s_config;
+static ibbq_state_t s_state = {};
+
+// Forgets the channels, as after a reboot
+static void reset()
+{
+    memset(&s_config, 0, sizeof(s_config));
+    memset(&s_state, 0, sizeof(s_state));
+    s_state.config = &s_config;
+}
+
+static void erase()
+{
+    CHECK(nvs_flash_erase() == ESP_OK);
+    reset();
+}
+
+static void write_blob(const void *data, size_t length)
+{
+    nvs_handle handle;
+    CHECK(nvs_open("ibbq", NVS_READWRITE, &handle) == ESP_OK);
+    CHECK(nvs_set_blob(handle, "channels", data, length) == ESP_OK);
+    nvs_close(handle);
+}
+
+static std::vector<uint8_t> read_blob()
+{
+    nvs_handle handle;
+    CHECK(nvs_open("ibbq", NVS_READONLY, &handle) == ESP_OK);
+    size_t length = 0;
+    CHECK(nvs_get_blob(handle, "channels", NULL, &length) == ESP_OK);
+    std::vector<uint8_t> blob(length);
+    CHECK(nvs_get_blob(handle, "channels", blob.data(), &length) == ESP_OK);
+    nvs_close(handle);
+    return blob;
+}
+
+static void check_defaults()
+{
+    probe_config_t defaults;
+    probe_config_defaults(&defaults);
+    CHECK(memcmp(&s_config, &defaults, sizeof(defaults)) == 0);
+    for (size_t i = 0; i < MAX_PROBE_COUNT; i++)
+    {
+        CHECK(s_state.probes.min[i] == 0 && s_state.probes.max[i] == 0 && s_state.probes.alarm[i] == 0);
+    }
+}
+
+static void test_never_saved()
+{
+    erase();
+    CHECK(!loadSettings(CHANNEL_SETTINGS, &s_state));
+    check_defaults();
+}
+
+static void test_round_trip()
+{
+    erase();
+    probe_config_defaults(&s_config);
+    CHECK(probe_config_set(&s_config, 0, "Brisket", "#FF0000"));
+    CHECK(probe_config_set(&s_config, 1, "Pit", NULL));
+    s_state.probes.min[0] = 60;
+    s_state.probes.max[0] = 95;
+    s_state.probes.alarm[0] = ALARM_LOCAL | ALARM_CLOUD;
+    s_state.probes.max[1] = 130;
+    probe_config_t saved = s_config;
+    saveSettings(CHANNEL_SETTINGS, &s_state);
+
+    // Only the used part of the pool is stored
+    std::vector<uint8_t> blob = read_blob();
+    CHECK(blob.size() == offsetof(channel_settings_t, config) + probe_config_size(&saved));
+    CHECK(blob[0] == 2);
+
+    reset();
+    CHECK(loadSettings(CHANNEL_SETTINGS, &s_state));
+    CHECK(memcmp(&s_config, &saved, probe_config_size(&saved)) == 0);
+    CHECK(strcmp(probe_config_name(&s_config, 0), "Brisket") == 0);
+    CHECK(strcmp(probe_config_color(&s_config, 0), "#FF0000") == 0);
+    CHECK(s_state.probes.min[0] == 60 && s_state.probes.max[0] == 95 && s_state.probes.max[1] == 130);
+    CHECK(s_state.probes.alarm[0] == (ALARM_LOCAL | ALARM_CLOUD));
+}
+
+static void fill_v1(channel_settings_v1_t *v1)
+{
+    memset(v1, 0, sizeof(*v1));
+    v1->version = 1;
+    for (size_t i = 0; i < MAX_PROBE_COUNT; i++)
+    {
+        v1->probe_configs[i].min = 10 * i;
+        v1->probe_configs[i].max = 10 * i + 50;
+        v1->probe_configs[i].alarm = i % 2 == 0 ? ALARM_LOCAL : ALARM_IBBQ;
+        snprintf(v1->probe_configs[i].name, sizeof(v1->probe_configs[i].name), "Channel %d", (int)i + 1);
+        snprintf(v1->probe_configs[i].color, sizeof(v1->probe_configs[i].color), "#00%02X00", (int)i * 16);
+    }
+}
+
+static void test_migrate_v1()
+{
+    erase();
+    channel_settings_v1_t v1;
+    fill_v1(&v1);
+    strcpy(v1.probe_configs[3].name, "Brisket");
+    strcpy(v1.probe_configs[5].name, "Brisket");
+    write_blob(&v1, sizeof(v1));
+    CHECK(loadSettings(CHANNEL_SETTINGS, &s_state));
+    for (size_t i = 0; i < MAX_PROBE_COUNT; i++)
+    {
+        CHECK(strcmp(probe_config_name(&s_config, i), v1.probe_configs[i].name) == 0);
+        CHECK(strcmp(probe_config_color(&s_config, i), v1.probe_configs[i].color) == 0);
+        CHECK(s_state.probes.min[i] == v1.probe_configs[i].min && s_state.probes.max[i] == v1.probe_configs[i].max);
+        CHECK(s_state.probes.alarm[i] == v1.probe_configs[i].alarm);
+    }
+    CHECK(s_config.name[3] == s_config.name[5]);
+    CHECK(probe_config_valid(&s_config, probe_config_size(&s_config)));
+
+    // Saving again writes version 2, which loads to the same
+    probe_config_t migrated = s_config;
+    saveSettings(CHANNEL_SETTINGS, &s_state);
+    std::vector<uint8_t> blob = read_blob();
+    CHECK(blob[0] == 2 && blob.size() < sizeof(v1) / 3);
+    reset();
+    CHECK(loadSettings(CHANNEL_SETTINGS, &s_state));
+    CHECK(memcmp(&s_config, &migrated, probe_config_size(&migrated)) == 0);
+}
+
+// Version 1 had room for eight names of 127 characters, the pool hasn't. The channels that don't fit
+// keep their default name and color, their thresholds are still taken over.
+static void test_migrate_v1_too_long()
+{
+    erase();
+    channel_settings_v1_t v1;
+    fill_v1(&v1);
+    for (size_t i = 0; i < MAX_PROBE_COUNT; i++)
+    {
+        // Without a terminating zero, as a name cut by strncpy
+        memset(v1.probe_configs[i].name, 'a' + i, sizeof(v1.probe_configs[i].name));
+    }
+    write_blob(&v1, sizeof(v1));
+    CHECK(loadSettings(CHANNEL_SETTINGS, &s_state));
+    size_t migrated = 0;
+    for (size_t i = 0; i < MAX_PROBE_COUNT; i++)
+    {
+        const char *name = probe_config_name(&s_config, i);
+        if (strlen(name) == PROBE_NAME_MAX)
+        {
+            CHECK(name[0] == 'a' + (char)i);
+            CHECK(strcmp(probe_config_color(&s_config, i), v1.probe_configs[i].color) == 0);
+            migrated++;
+        }
+        else
+        {
+            char expected[16];
+            snprintf(expected, sizeof(expected), "Kanal %d", (int)i + 1);
+            CHECK(strcmp(name, expected) == 0);
+        }
+        CHECK(s_state.probes.max[i] == v1.probe_configs[i].max);
+    }
+    CHECK(migrated == 2);
+    CHECK(probe_config_valid(&s_config, probe_config_size(&s_config)));
+}
+
+static void test_invalid()
+{
+    erase();
+    probe_config_defaults(&s_config);
+    CHECK(probe_config_set(&s_config, 0, "Brisket", NULL));
+    saveSettings(CHANNEL_SETTINGS, &s_state);
+    std::vector<uint8_t> good = read_blob();
+
+    std::vector<std::vector<uint8_t>> bad;
+    // Cut short, one byte too long, an unknown version, a version 1 of the wrong size
+    bad.push_back(std::vector<uint8_t>(good.begin(), good.end() - 1));
+    bad.push_back(good);
+    bad.back().push_back(0);
+    bad.push_back(good);
+    bad.back()[0] = 3;
+    bad.push_back(good);
+    bad.back()[0] = 1;
+    // The name of the first probe pointing into the middle of a string
+    bad.push_back(good);
+    bad.back()[offsetof(channel_settings_t, config) + offsetof(probe_config_t, name)] += 1;
+    bad.push_back(std::vector<uint8_t>(good.begin(), good.begin() + offsetof(channel_settings_t, config)));
+    for (const std::vector<uint8_t> &blob : bad)
+    {
+        erase();
+        write_blob(blob.data(), blob.size());
+        CHECK(!loadSettings(CHANNEL_SETTINGS, &s_state));
+        check_defaults();
+    }
+
+    // A blob larger than any version doesn't fit into the buffer and counts as never saved
+    erase();
+    std::vector<uint8_t> huge(4096, 0);
+    huge[0] = 2;
+    write_blob(huge.data(), huge.size());
+    CHECK(!loadSettings(CHANNEL_SETTINGS, &s_state));
+    check_defaults();
+}
+
+int main()
+{
+    esp_log_level_set("*", ESP_LOG_NONE);
+    test_never_saved();
+    test_round_trip();
+    test_migrate_v1();
+    test_migrate_v1_too_long();
+    test_invalid();
+    printf("settings: ok\n");
+    return 0;
+}
@@ -0,0 +1,207 @@
+#include "TaskRegistry.h"
+#include "Task.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <atomic>
+#include <string>
+#include "esp_log.h"
+
+#include "check.h"
+
+#define STACK_SIZE 32768
+#define STACK_USED 16384
+
+ESP_EVENT_DEFINE_BASE(TEST_EVENT);
+
+static const TaskRegistry::Info *find(const TaskRegistry::Info *infos, size_t count, const char *name)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        if (strcmp(infos[i].name, name) == 0)
+        {
+            return &infos[i];
+        }
+    }
+    return NULL;
+}
+
+static std::atomic<bool> s_stop(false);
+
+static void spin_task(void *arg)
+{
+    while (!s_stop)
+    {
+    }
+    vTaskDelete(NULL);
+}
+
+static void sleep_task(void *arg)
+{
+    // Touch a known part of the stack once, then stay idle
+    volatile uint8_t buffer[STACK_USED];
+    for (size_t i = 0; i < sizeof(buffer); i += 64)
+    {
+        buffer[i] = i;
+    }
+    while (!s_stop)
+    {
+        vTaskDelay(10 / portTICK_PERIOD_MS);
+    }
+    vTaskDelete(NULL);
+}
+
+static void test_add_and_remove()
+{
+    char name[configMAX_TASK_NAME_LEN];
+    for (int i = 0; i < TaskRegistry::MAX_TASKS; i++)
+    {
+        snprintf(name, sizeof(name), "task_%d", i);
+        CHECK(TaskRegistry::add(name, 1024 + i));
+    }
+    CHECK(!TaskRegistry::add("one_too_many", 1024));
+    // Adding again updates the entry instead of taking another one
+    CHECK(TaskRegistry::add("task_3", 2048));
+    TaskRegistry::remove("task_3");
+    CHECK(TaskRegistry::add("one_too_many", 1024));
+    CHECK(!TaskRegistry::add("task_3", 2048));
+    for (int i = 0; i < TaskRegistry::MAX_TASKS; i++)
+    {
+        snprintf(name, sizeof(name), "task_%d", i);
+        TaskRegistry::remove(name);
+    }
+    TaskRegistry::remove("one_too_many");
+    TaskRegistry::remove("not_registered");
+}
+
+class ShortTask : public Task
+{
+public:
+    ShortTask(std::string name) : Task(name, STACK_SIZE) {}
+    std::atomic<bool> release{false};
+    std::atomic<bool> released{false};
+    void run(void *data) override
+    {
+        while (!release)
+        {
+            vTaskDelay(1);
+        }
+        finish(set_released, this);
+    }
+
+private:
+    static void set_released(void *arg)
+    {
+        ((ShortTask *)arg)->released = true;
+    }
+};
+
+// Tasks that end give their entry back, more of them than the registry holds come and go
+static void test_tasks_unregister()
+{
+    for (int i = 0; i < 2 * TaskRegistry::MAX_TASKS; i++)
+    {
+        ShortTask *pTask = new ShortTask("short_" + std::to_string(i));
+        pTask->start();
+        TaskRegistry::Info infos[32];
+        size_t count = TaskRegistry::sample(infos, 32);
+        const TaskRegistry::Info *info = find(infos, count, ("short_" + std::to_string(i)).c_str());
+        CHECK(info != NULL && info->stackSize == STACK_SIZE);
+        pTask->release = true;
+        while (!pTask->released)
+        {
+            usleep(1000);
+        }
+        delete pTask;
+    }
+    char name[configMAX_TASK_NAME_LEN];
+    for (int i = 0; i < TaskRegistry::MAX_TASKS; i++)
+    {
+        snprintf(name, sizeof(name), "task_%d", i);
+        CHECK(TaskRegistry::add(name, 1024));
+    }
+    for (int i = 0; i < TaskRegistry::MAX_TASKS; i++)
+    {
+        snprintf(name, sizeof(name), "task_%d", i);
+        TaskRegistry::remove(name);
+    }
+}
+
+static void test_cpu_and_stack()
+{
+    s_stop = false;
+    TaskHandle_t spinner;
+    TaskHandle_t sleeper;
+    CHECK(TaskRegistry::add("spinner", STACK_SIZE));
+    CHECK(TaskRegistry::add("sleeper", STACK_SIZE));
+    xTaskCreate(spin_task, "spinner", STACK_SIZE, NULL, 5, &spinner);
+    xTaskCreate(sleep_task, "sleeper", STACK_SIZE, NULL, 5, &sleeper);
+    TaskRegistry::Info infos[32];
+    TaskRegistry::sample(infos, 32);
+    usleep(300 * 1000);
+    size_t count = TaskRegistry::sample(infos, 32);
+    s_stop = true;
+
+    const TaskRegistry::Info *spin = find(infos, count, "spinner");
+    const TaskRegistry::Info *sleep = find(infos, count, "sleeper");
+    CHECK(spin != NULL && sleep != NULL);
+    CHECK(spin->stackSize == STACK_SIZE && sleep->stackSize == STACK_SIZE);
+    // The share is of the time of both cores, a task that never sleeps gets up to half
+    CHECK(spin->cpuPermille > 200 && spin->cpuPermille <= 500);
+    CHECK(sleep->cpuPermille < 50);
+#ifndef __SANITIZE_THREAD__
+    // Starting a thread already touches some KiB here, the buffer goes well beyond. TSan's thread state
+    // takes up all the room the port adds to a stack, under TSan every stack looks used up.
+    CHECK(sleep->stackFreeMin < STACK_SIZE - STACK_USED);
+    CHECK(spin->stackFreeMin > sleep->stackFreeMin + STACK_USED / 4);
+#endif
+    // Tasks of the port nobody registered are listed without a stack size
+    const TaskRegistry::Info *main_task = find(infos, count, "main");
+    CHECK(main_task == NULL || main_task->stackSize == 0);
+    TaskRegistry::remove("spinner");
+    TaskRegistry::remove("sleeper");
+    usleep(20 * 1000);
+}
+
+static void block_handler(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    usleep(500 * 1000);
+}
+
+// A handler that keeps the loop busy when a probe arrives shows up as the latency of the loop
+static void test_event_loop_latency()
+{
+    esp_event_loop_args_t args = {};
+    args.queue_size = 8;
+    args.task_name = "probe_loop";
+    args.task_priority = 5;
+    args.task_stack_size = 4096;
+    esp_event_loop_handle_t loop;
+    CHECK(esp_event_loop_create(&args, &loop) == ESP_OK);
+    CHECK(esp_event_handler_register_with(loop, TEST_EVENT, 0, block_handler, NULL) == ESP_OK);
+    CHECK(TaskRegistry::addEventLoop(loop, "probe_loop", 4096));
+    // The first probe comes a second after the loop was added, the loop is blocked from 0.8 to 1.3 s
+    usleep((TaskRegistry::PROBE_INTERVAL_MS - 200) * 1000);
+    CHECK(esp_event_post_to(loop, TEST_EVENT, 0, NULL, 0, portMAX_DELAY) == ESP_OK);
+    usleep((TaskRegistry::PROBE_INTERVAL_MS + 700) * 1000);
+
+    TaskRegistry::Info infos[32];
+    size_t count = TaskRegistry::sample(infos, 32);
+    const TaskRegistry::Info *info = find(infos, count, "probe_loop");
+    CHECK(info != NULL && info->stackSize == 4096);
+    CHECK(info->latencyCount == 2);
+    CHECK(info->latencyMaxUs > 200 * 1000 && info->latencyMaxUs < 450 * 1000);
+    // The second probe found the loop idle
+    CHECK(info->latencyTotalUs - info->latencyMaxUs < 50 * 1000);
+}
+
+int main()
+{
+    esp_log_level_set("*", ESP_LOG_NONE);
+    test_add_and_remove();
+    test_tasks_unregister();
+    test_cpu_and_stack();
+    test_event_loop_latency();
+    printf("task_registry: ok\n");
+    return 0;
+}
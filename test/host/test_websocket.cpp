@@ -0,0 +1,220 @@
+#include "WebSocket.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include "esp_log.h"
+
+#include "check.h"
+
+#define PORT 18634
+#define SMALL_BUFFER 4096
+#define LARGE_FRAME (256 * 1024)
+
+typedef struct frame
+{
+    uint8_t opcode;
+    std::string payload;
+} frame_t;
+
+static void recv_exact(int fd, void *data, size_t length)
+{
+    size_t got = 0;
+    while (got < length)
+    {
+        ssize_t n = recv(fd, (uint8_t *)data + got, length - got, 0);
+        CHECK(n > 0);
+        got += n;
+    }
+}
+
+// Server frames are not masked, the payload follows the length right away
+static frame_t read_frame(int fd)
+{
+    uint8_t head[2];
+    recv_exact(fd, head, 2);
+    CHECK((head[0] & 0x80) != 0 && (head[1] & 0x80) == 0);
+    frame_t frame;
+    frame.opcode = head[0] & 0x0f;
+    uint64_t length = head[1] & 0x7f;
+    if (length == 126)
+    {
+        uint8_t ext[2];
+        recv_exact(fd, ext, 2);
+        length = (ext[0] << 8) | ext[1];
+    }
+    else if (length == 127)
+    {
+        uint8_t ext[8];
+        recv_exact(fd, ext, 8);
+        length = 0;
+        for (int i = 0; i < 8; i++)
+        {
+            length = (length << 8) | ext[i];
+        }
+    }
+    frame.payload.resize(length);
+    recv_exact(fd, &frame.payload[0], length);
+    return frame;
+}
+
+static std::string pattern(size_t length)
+{
+    std::string data(length, 0);
+    for (size_t i = 0; i < length; i++)
+    {
+        data[i] = 'a' + i % 23;
+    }
+    return data;
+}
+
+// A connected pair with small buffers, so that a large frame is only partly taken by the socket
+static WebSocket *connect_pair(Socket *listener, int *client)
+{
+    *client = socket(AF_INET, SOCK_STREAM, 0);
+    int size = SMALL_BUFFER;
+    setsockopt(*client, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    CHECK(connect(*client, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+    Socket socket = listener->accept();
+    setsockopt(socket.getFD(), SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    return new WebSocket(socket);
+}
+
+static void test_frame_header()
+{
+    uint8_t header[WebSocket::MAX_FRAME_HEADER];
+    CHECK(WebSocket::buildFrameHeader(header, 0x01, 0) == 2 && header[0] == 0x81 && header[1] == 0);
+    CHECK(WebSocket::buildFrameHeader(header, 0x02, 125) == 2 && header[0] == 0x82 && header[1] == 125);
+    CHECK(WebSocket::buildFrameHeader(header, 0x02, 126) == 4 && header[1] == 126);
+    CHECK(header[2] == 0 && header[3] == 126);
+    CHECK(WebSocket::buildFrameHeader(header, 0x02, 65535) == 4 && header[2] == 0xff && header[3] == 0xff);
+    CHECK(WebSocket::buildFrameHeader(header, 0x02, 65536) == 10 && header[1] == 127);
+    CHECK(header[2] == 0 && header[3] == 0 && header[4] == 0 && header[5] == 0);
+    CHECK(header[6] == 0 && header[7] == 1 && header[8] == 0 && header[9] == 0);
+}
+
+// WebSocket::send() used to write its frame straight into the middle of a broadcast the socket had only
+// taken part of
+static void test_send_behind_partial_broadcast(Socket *listener)
+{
+    int client;
+    WebSocket *pWebSocket = connect_pair(listener, &client);
+    WebSocketBroadcaster broadcaster(2 * LARGE_FRAME);
+    broadcaster.addSubscriber(pWebSocket);
+    std::string large = pattern(LARGE_FRAME);
+    broadcaster.broadcast((const uint8_t *)large.data(), large.size());
+    pWebSocket->send("direct", WebSocket::SEND_TYPE_TEXT);
+    broadcaster.broadcast("after");
+
+    frame_t frames[3];
+    std::atomic<bool> done(false);
+    std::thread reader([&] {
+        for (int i = 0; i < 3; i++)
+        {
+            frames[i] = read_frame(client);
+        }
+        done = true;
+    });
+    // Nothing else sends for the broadcaster here, the queue only moves on with flush()
+    for (int i = 0; i < 10000 && !done; i++)
+    {
+        broadcaster.flush();
+        usleep(100);
+    }
+    reader.join();
+    CHECK(frames[0].opcode == 0x02 && frames[0].payload == large);
+    CHECK(frames[1].opcode == 0x01 && frames[1].payload == "direct");
+    CHECK(frames[2].opcode == 0x01 && frames[2].payload == "after");
+    CHECK(broadcaster.getDroppedCount() == 0 && broadcaster.getSubscriberCount() == 1);
+    delete pWebSocket;
+    CHECK(broadcaster.getSubscriberCount() == 0);
+    close(client);
+}
+
+// Removing a subscriber completes the frame on the wire and discards those not started
+static void test_remove_completes_partial_frame(Socket *listener)
+{
+    int client;
+    WebSocket *pWebSocket = connect_pair(listener, &client);
+    WebSocketBroadcaster broadcaster(2 * LARGE_FRAME);
+    broadcaster.addSubscriber(pWebSocket);
+    std::string large = pattern(LARGE_FRAME);
+    broadcaster.broadcast((const uint8_t *)large.data(), large.size());
+    broadcaster.broadcast("discarded");
+
+    frame_t frames[2];
+    std::thread reader([&] {
+        frames[0] = read_frame(client);
+        frames[1] = read_frame(client);
+    });
+    broadcaster.removeSubscriber(pWebSocket);
+    CHECK(broadcaster.getSubscriberCount() == 0);
+    pWebSocket->send("own");
+    reader.join();
+    CHECK(frames[0].payload == large);
+    CHECK(frames[1].payload == "own");
+
+    // Subscribed again, close() does the same before its close frame
+    broadcaster.addSubscriber(pWebSocket);
+    broadcaster.broadcast((const uint8_t *)large.data(), large.size());
+    std::thread closer([&] {
+        frames[0] = read_frame(client);
+        frames[1] = read_frame(client);
+    });
+    pWebSocket->close(WebSocket::CLOSE_GOING_AWAY, "bye");
+    closer.join();
+    CHECK(frames[0].payload == large);
+    CHECK(frames[1].opcode == 0x08 && frames[1].payload.substr(2) == "bye");
+    CHECK(broadcaster.getSubscriberCount() == 0);
+    delete pWebSocket;
+    close(client);
+}
+
+static void test_drop_on_backlog(Socket *listener)
+{
+    int client;
+    WebSocket *pWebSocket = connect_pair(listener, &client);
+    WebSocketBroadcaster broadcaster(4096);
+    broadcaster.addSubscriber(pWebSocket);
+    std::string data = pattern(1024);
+    int broadcasts = 0;
+    while (broadcaster.getSubscriberCount() == 1)
+    {
+        broadcaster.broadcast((const uint8_t *)data.data(), data.size());
+        CHECK(++broadcasts < 1000);
+    }
+    CHECK(broadcaster.getDroppedCount() == 1);
+    // The client gets what was sent up to the drop, then the end of the stream
+    size_t received = 0;
+    char buf[4096];
+    ssize_t n;
+    while ((n = recv(client, buf, sizeof(buf), 0)) > 0)
+    {
+        received += n;
+    }
+    CHECK(n == 0 && received > 0 && received < broadcasts * (data.size() + 4));
+    delete pWebSocket;
+    close(client);
+}
+
+int main()
+{
+    esp_log_level_set("*", ESP_LOG_NONE);
+    Socket listener;
+    CHECK(listener.listen(PORT, false, true) == 0);
+    test_frame_header();
+    test_send_behind_partial_broadcast(&listener);
+    test_remove_completes_partial_frame(&listener);
+    test_drop_on_backlog(&listener);
+    listener.close();
+    printf("websocket: ok\n");
+    return 0;
+}
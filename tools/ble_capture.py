@@ -0,0 +1,130 @@
+#!/usr/bin/env python3
+"""Download, decode and replay captures of the BLE traffic between the iBBQ-Gateway and the thermometer.
+
+Enable BLE_CAPTURE in main/ble_capture.h on the gateway that talks to the thermometer, and BLE_REPLAY
+on the one that should replay the capture. The format is described in main/ble_capture.h.
+
+    ble_capture.py --download http://ibbq.gateway cook.ibqc             save the capture of a gateway
+    ble_capture.py cook.ibqc                                           print the records and statistics
+    ble_capture.py --quiet cook.ibqc                                   only print the statistics
+    ble_capture.py --replay http://ibbq.gateway --max-speed cook.ibqc  feed it into a gateway again
+"""
+
+import argparse
+import struct
+import sys
+import urllib.request
+
+MAGIC = 0x43514269
+VERSION = 1
+HEADER = struct.Struct("<IB3xI")
+RECORD = struct.Struct("<IBBH")
+UNPLUGGED = 0xFFF6
+TYPES = {
+    1: "DISCOVERED",
+    2: "CONNECT",
+    3: "READY",
+    4: "DISCONNECTED",
+    5: "TIMEOUT",
+    6: "READ",
+    7: "WRITE",
+    8: "NOTIFY",
+    9: "RSSI",
+}
+UUID_REALTIME_DATA = 0xFFF4
+UUID_SETTINGS_RESULT = 0xFFF1
+
+
+def parse(data):
+    """Returns the number of dropped records and a list of (time_ms, type, uuid, payload)."""
+    if len(data) < HEADER.size:
+        raise ValueError("too short for a capture")
+    magic, version, dropped = HEADER.unpack_from(data)
+    if magic != MAGIC or version != VERSION:
+        raise ValueError("not a capture of version %d" % VERSION)
+    records = []
+    pos = HEADER.size
+    while pos + RECORD.size <= len(data):
+        time_ms, kind, length, uuid = RECORD.unpack_from(data, pos)
+        pos += RECORD.size
+        records.append((time_ms, kind, uuid, data[pos:pos + length]))
+        pos += length
+    if pos != len(data):
+        raise ValueError("truncated after %d records" % len(records))
+    return dropped, records
+
+
+def describe(kind, uuid, payload):
+    if kind == 8 and uuid == UUID_REALTIME_DATA:
+        values = struct.unpack("<%dH" % (len(payload) // 2), payload[:len(payload) // 2 * 2])
+        return " ".join("--" if v == UNPLUGGED else "%.1f" % (v / 10) for v in values)
+    if kind == 8 and uuid == UUID_SETTINGS_RESULT and len(payload) >= 5:
+        voltage, max_voltage = struct.unpack_from("<HH", payload, 1)
+        return "battery %d/%d mV" % (voltage, max_voltage)
+    if kind == 1 and len(payload) == 7:
+        return "%s rssi %d" % (":".join("%02x" % b for b in payload[:6]), struct.unpack("b", payload[6:])[0])
+    if kind == 9 and payload:
+        return "rssi %d" % struct.unpack("b", payload[:1])[0]
+    return payload.hex()
+
+
+def print_stats(dropped, records):
+    notify_times = [r[0] for r in records if r[1] == 8 and r[2] == UUID_REALTIME_DATA]
+    gaps = sorted(b - a for a, b in zip(notify_times, notify_times[1:]))
+    duration = records[-1][0] - records[0][0] if records else 0
+    print("%d records over %.1f s, %d dropped before the download" % (len(records), duration / 1000, dropped))
+    print("%d temperature notifications, %d disconnects, %d timeouts" % (
+        len(notify_times), sum(1 for r in records if r[1] == 4), sum(1 for r in records if r[1] == 5)))
+    if gaps:
+        print("notification gaps: median %d ms, p99 %d ms, max %d ms, %d over 2 s" % (
+            gaps[len(gaps) // 2], gaps[min(len(gaps) - 1, len(gaps) * 99 // 100)], gaps[-1],
+            sum(1 for g in gaps if g > 2000)))
+
+
+def download(url, path):
+    with urllib.request.urlopen(url.rstrip("/") + "/capture") as response:
+        data = response.read()
+    dropped, records = parse(data)
+    with open(path, "wb") as f:
+        f.write(data)
+    print("Saved %d records to %s" % (len(records), path))
+
+
+def replay(url, path, max_speed):
+    with open(path, "rb") as f:
+        data = f.read()
+    parse(data)
+    request = urllib.request.Request(url.rstrip("/") + "/capture" + ("?speed=max" if max_speed else ""), data=data,
+                                     headers={"Content-Type": "application/octet-stream"})
+    with urllib.request.urlopen(request) as response:
+        print(response.read().decode())
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("file")
+    parser.add_argument("--download", metavar="URL", help="save the capture of the gateway at URL to file")
+    parser.add_argument("--replay", metavar="URL", help="replay file on the gateway at URL")
+    parser.add_argument("--max-speed", action="store_true", help="replay as fast as possible")
+    parser.add_argument("--quiet", action="store_true", help="only print statistics")
+    args = parser.parse_args()
+    try:
+        if args.download:
+            download(args.download, args.file)
+        elif args.replay:
+            replay(args.replay, args.file, args.max_speed)
+        else:
+            with open(args.file, "rb") as f:
+                dropped, records = parse(f.read())
+            if not args.quiet:
+                start = records[0][0] if records else 0
+                for time_ms, kind, uuid, payload in records:
+                    print("%10.3f %-12s %04x %s" % ((time_ms - start) / 1000, TYPES.get(kind, str(kind)), uuid,
+                                                    describe(kind, uuid, payload)))
+            print_stats(dropped, records)
+    except ValueError as e:
+        sys.exit("%s: %s" % (args.file, e))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+"""Synthetic HTTP load for the iBBQ-Gateway, to compare task placements (main/task_plan.h).
+
+Resets the jitter histograms of the gateway, requests the given paths from several threads and
+prints the request latencies and the notify-to-publish jitter the gateway measured meanwhile.
+
+    http_load.py http://ibbq.gateway                          load /data for 60 s with 4 threads
+    http_load.py --threads 8 --path /data --path /settings http://ibbq.gateway
+"""
+
+import argparse
+import json
+import threading
+import time
+import urllib.error
+import urllib.request
+
+
+def percentile(values, percent):
+    if not values:
+        return 0
+    values = sorted(values)
+    return values[min(len(values) - 1, len(values) * percent // 100)]
+
+
+def get_json(url):
+    with urllib.request.urlopen(url, timeout=10) as response:
+        return json.loads(response.read())
+
+
+def worker(base, paths, deadline, latencies, errors, lock):
+    i = 0
+    while time.monotonic() < deadline:
+        path = paths[i % len(paths)]
+        i += 1
+        start = time.monotonic()
+        try:
+            with urllib.request.urlopen(base + path, timeout=10) as response:
+                response.read()
+        except (urllib.error.URLError, OSError):
+            with lock:
+                errors[0] += 1
+            continue
+        with lock:
+            latencies.append((time.monotonic() - start) * 1000)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("url")
+    parser.add_argument("--path", action="append", help="path to request, can be repeated (default /data)")
+    parser.add_argument("--threads", type=int, default=4)
+    parser.add_argument("--duration", type=float, default=60.0, help="seconds of load")
+    args = parser.parse_args()
+    base = args.url.rstrip("/")
+    paths = args.path or ["/data"]
+
+    get_json(base + "/jitter?reset=1")
+    latencies = []
+    errors = [0]
+    lock = threading.Lock()
+    deadline = time.monotonic() + args.duration
+    threads = [threading.Thread(target=worker, args=(base, paths, deadline, latencies, errors, lock))
+               for _ in range(args.threads)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    jitter = get_json(base + "/jitter")
+
+    print("%d requests, %.1f/s, %d errors" % (len(latencies), len(latencies) / args.duration, errors[0]))
+    print("latency ms: p50 %.1f, p99 %.1f, max %.1f" % (
+        percentile(latencies, 50), percentile(latencies, 99), max(latencies, default=0)))
+    print("split cores: %s" % jitter["split_cores"])
+    for metric in jitter["metrics"]:
+        print("%-8s %6d samples, avg %d us, p50 %d us, p99 %d us, max %d us" % (
+            metric["name"], metric["count"], metric["avg_us"], metric["p50_us"], metric["p99_us"], metric["max_us"]))
+
+
+if __name__ == "__main__":
+    main()
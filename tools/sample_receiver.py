@@ -0,0 +1,170 @@
+#!/usr/bin/env python3
+"""Reference receiver for the UDP multicast samples of the iBBQ-Gateway.
+
+Enable SAMPLE_MULTICAST in main/sample_multicast.h to make the gateway send them. The datagram
+layout is described there.
+
+    sample_receiver.py                 print every sample and loss statistics
+    sample_receiver.py --quiet         only print the statistics
+    sample_receiver.py --send 100000   act as a gateway, e.g. to measure receiver throughput
+"""
+
+import argparse
+import socket
+import struct
+import time
+
+GROUP = "239.255.66.81"
+PORT = 6681
+MAGIC = 0x69424251
+VERSION = 1
+NO_VALUE = -32768
+# Datagrams sent this much earlier than the newest one are not reordered but from before a reboot
+REORDER_WINDOW_MS = 10000
+HEADER = struct.Struct("!IBBBBII6s")
+
+
+class DeviceStats:
+    """Loss and reorder accounting for the datagrams of one gateway."""
+
+    def __init__(self):
+        self.expected = None
+        self.received = 0
+        self.lost = 0
+        self.reordered = 0
+        self.duplicates = 0
+        self.restarts = 0
+        self.last_uptime = 0
+        # Sequence numbers that were counted as lost, so a late arrival can be told from a duplicate
+        self.missing = set()
+
+    def add(self, sequence, uptime_ms):
+        self.received += 1
+        if (self.expected is not None and sequence < self.expected
+                and uptime_ms + REORDER_WINDOW_MS < self.last_uptime):
+            # Far too old to be a late datagram, the gateway rebooted and started counting at 0 again
+            self.restarts += 1
+            self.expected = None
+            self.missing.clear()
+        self.last_uptime = uptime_ms if self.expected is None else max(self.last_uptime, uptime_ms)
+
+        if self.expected is None or sequence == self.expected:
+            self.expected = sequence + 1
+        elif sequence > self.expected:
+            gap = sequence - self.expected
+            self.lost += gap
+            if gap <= 4096:
+                self.missing.update(range(self.expected, sequence))
+            self.expected = sequence + 1
+        elif sequence in self.missing:
+            self.missing.discard(sequence)
+            self.lost -= 1
+            self.reordered += 1
+        else:
+            self.duplicates += 1
+
+    def __str__(self):
+        total = self.received - self.duplicates + self.lost
+        loss = 100.0 * self.lost / total if total else 0.0
+        return (f"received {self.received}, lost {self.lost} ({loss:.2f}%), reordered {self.reordered}, "
+                f"duplicates {self.duplicates}, restarts {self.restarts}")
+
+
+def parse(data):
+    if len(data) < HEADER.size:
+        return None
+    magic, version, probe_count, battery, _, sequence, uptime_ms, device_id = HEADER.unpack_from(data)
+    if magic != MAGIC or version != VERSION or len(data) < HEADER.size + 2 * probe_count:
+        return None
+    values = struct.unpack_from(f"!{probe_count}h", data, HEADER.size)
+    temps = [None if v == NO_VALUE else v / 10.0 for v in values]
+    return device_id.hex(":"), sequence, uptime_ms, battery, temps
+
+
+def open_receiver(group, port):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 1 << 20)
+    sock.bind(("", port))
+    membership = struct.pack("4s4s", socket.inet_aton(group), socket.inet_aton("0.0.0.0"))
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, membership)
+    return sock
+
+
+def receive(args):
+    sock = open_receiver(args.group, args.port)
+    sock.settimeout(args.stats_interval)
+    devices = {}
+    started = time.monotonic()
+    last_report = started
+    invalid = 0
+    try:
+        while args.count == 0 or sum(d.received for d in devices.values()) < args.count:
+            try:
+                data, sender = sock.recvfrom(512)
+            except socket.timeout:
+                data = None
+            if data is not None:
+                sample = parse(data)
+                if sample is None:
+                    invalid += 1
+                    continue
+                device, sequence, uptime_ms, battery, temps = sample
+                devices.setdefault(device, DeviceStats()).add(sequence, uptime_ms)
+                if not args.quiet:
+                    shown = " ".join("--" if t is None else f"{t:.1f}" for t in temps)
+                    print(f"{device} #{sequence} {uptime_ms / 1000:.1f}s battery {battery}% {shown}")
+            now = time.monotonic()
+            if now - last_report >= args.stats_interval:
+                report(devices, invalid, now - started)
+                last_report = now
+    except KeyboardInterrupt:
+        pass
+    report(devices, invalid, time.monotonic() - started)
+
+
+def report(devices, invalid, elapsed):
+    received = sum(d.received for d in devices.values())
+    rate = received / elapsed if elapsed > 0 else 0.0
+    print(f"{received} datagrams in {elapsed:.1f}s ({rate:.0f}/s), {invalid} invalid")
+    for device, stats in devices.items():
+        print(f"  {device}: {stats}")
+
+
+def send(args):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, 1)
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_LOOP, 1)
+    device_id = bytes.fromhex(args.device.replace(":", ""))
+    started = time.monotonic()
+    for sequence in range(args.send):
+        uptime_ms = int((time.monotonic() - started) * 1000)
+        values = [215 + sequence % 10, 643, NO_VALUE, 1105]
+        data = HEADER.pack(MAGIC, VERSION, len(values), 80, 0, sequence, uptime_ms, device_id)
+        data += struct.pack(f"!{len(values)}h", *values)
+        sock.sendto(data, (args.group, args.port))
+        if args.rate:
+            time.sleep(1.0 / args.rate)
+    elapsed = time.monotonic() - started
+    print(f"Sent {args.send} datagrams in {elapsed:.2f}s ({args.send / elapsed:.0f}/s)")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--group", default=GROUP)
+    parser.add_argument("--port", type=int, default=PORT)
+    parser.add_argument("--quiet", action="store_true", help="only print statistics")
+    parser.add_argument("--stats-interval", type=float, default=10.0, help="seconds between statistics")
+    parser.add_argument("--count", type=int, default=0, help="stop after this many datagrams")
+    parser.add_argument("--send", type=int, default=0, metavar="N", help="send N test datagrams instead")
+    parser.add_argument("--rate", type=float, default=0, help="datagrams per second to send, 0 for unlimited")
+    parser.add_argument("--device", default="02:ba:5e:ba:11:ed", help="device ID to send as")
+    args = parser.parse_args()
+    if args.send:
+        send(args)
+    else:
+        receive(args)
+
+
+if __name__ == "__main__":
+    main()